@@ -0,0 +1,338 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AcquisitionEngine.h"
+#include "SoftwareTrigger.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		AcquisitionEngineConfiguration::AcquisitionEngineConfiguration() {
+
+			Native::AcquisitionEngineConfig defaults =
+				Native::DefaultAcquisitionEngineConfig();
+
+			Channels = (int)defaults.channels;
+			SamplesPerBlock = (int)defaults.samplesPerBlock;
+			RingBlocks = (int)defaults.ringBlocks;
+			Format = (SampleFormat)defaults.format;
+			FillMode = (ReadbacklFillMode)defaults.fillMode;
+			DeliveredFillMode = Nullable<ReadbacklFillMode>();
+			ReadTimeout = defaults.readTimeout;
+			OwnsTask = defaults.ownsTask;
+		}
+
+		Native::AcquisitionEngineConfig AcquisitionEngineConfiguration::ToNative() {
+
+			Native::AcquisitionEngineConfig config =
+				Native::DefaultAcquisitionEngineConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.samplesPerBlock = (uInt32)Math::Max(SamplesPerBlock, 0);
+			config.ringBlocks = (uInt32)Math::Max(RingBlocks, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.fillMode = (int32)FillMode;
+			config.deliveredFillMode = DeliveredFillMode.HasValue
+				? (int32)DeliveredFillMode.Value : Native::FillModeAsRead;
+			config.readTimeout = ReadTimeout;
+			config.ownsTask = OwnsTask;
+			return config;
+		}
+
+
+		AcquisitionEngine::AcquisitionEngine() {
+			_core = new Native::AcquisitionEngineCore();
+		}
+
+		AcquisitionEngine::~AcquisitionEngine() {
+			this->!AcquisitionEngine();
+		}
+
+		AcquisitionEngine::!AcquisitionEngine() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+			_UnlinkStages();
+		}
+
+		int AcquisitionEngine::Attach(IntPtr taskHandle,
+			AcquisitionEngineConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::AcquisitionEngineConfig config = configuration->ToNative();
+			return _core->Attach((TaskHandle)taskHandle.ToPointer(), config);
+		}
+
+		int AcquisitionEngine::Detach() {
+
+			// The core lets go of its stages, once no callback runs them.
+			int result = (_core != nullptr) ? _core->Detach() : 0;
+			_UnlinkStages();
+			return result;
+		}
+
+		int AcquisitionEngine::Start() {
+			return (_core != nullptr) ? _core->Start()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int AcquisitionEngine::Stop() {
+			return (_core != nullptr) ? _core->Stop()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int AcquisitionEngine::SetDecimator(Decimator^ decimator) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			Native::DecimatorCore* stage = nullptr;
+
+			if (decimator != nullptr) {
+				if (decimator->_engine != nullptr && decimator->_engine != this) {
+					return Native::NativeErrorInvalidState;
+				}
+				stage = decimator->_GetCore();
+				if (stage == nullptr) {
+					return Native::NativeErrorInvalidState;
+				}
+			}
+
+			int result = _core->SetDecimator(stage);
+
+			if (result == Native::NativeSuccess) {
+				if (_decimator != nullptr) {
+					_decimator->_engine = nullptr;
+				}
+				_decimator = decimator;
+				if (decimator != nullptr) {
+					decimator->_engine = this;
+				}
+			}
+			return result;
+		}
+
+		int AcquisitionEngine::SetStatistics(BlockStatistics^ statistics) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			Native::BlockStatisticsCore* stage = nullptr;
+
+			if (statistics != nullptr) {
+				if (statistics->_engine != nullptr && statistics->_engine != this) {
+					return Native::NativeErrorInvalidState;
+				}
+				stage = statistics->_GetCore();
+				if (stage == nullptr) {
+					return Native::NativeErrorInvalidState;
+				}
+			}
+
+			int result = _core->SetStatistics(stage);
+
+			if (result == Native::NativeSuccess) {
+				if (_statistics != nullptr) {
+					_statistics->_engine = nullptr;
+				}
+				_statistics = statistics;
+				if (statistics != nullptr) {
+					statistics->_engine = this;
+				}
+			}
+			return result;
+		}
+
+		int AcquisitionEngine::SetTrigger(SoftwareTrigger^ trigger) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			Native::SoftwareTriggerCore* stage = nullptr;
+
+			if (trigger != nullptr) {
+				if (trigger->_engine != nullptr && trigger->_engine != this) {
+					return Native::NativeErrorInvalidState;
+				}
+				stage = trigger->_GetCore();
+				if (stage == nullptr) {
+					return Native::NativeErrorInvalidState;
+				}
+			}
+
+			int result = _core->SetTrigger(stage);
+
+			if (result == Native::NativeSuccess) {
+				if (_trigger != nullptr) {
+					_trigger->_engine = nullptr;
+				}
+				_trigger = trigger;
+				if (trigger != nullptr) {
+					trigger->_engine = this;
+				}
+			}
+			return result;
+		}
+
+		int AcquisitionEngine::SetClockEstimator(ClockDriftEstimator^ estimator) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			Native::ClockDriftEstimatorCore* stage = nullptr;
+
+			if (estimator != nullptr) {
+				if (estimator->_engine != nullptr && estimator->_engine != this) {
+					return Native::NativeErrorInvalidState;
+				}
+				stage = estimator->_GetCore();
+				if (stage == nullptr) {
+					return Native::NativeErrorInvalidState;
+				}
+			}
+
+			int result = _core->SetClockEstimator(stage);
+
+			if (result == Native::NativeSuccess) {
+				if (_clockEstimator != nullptr) {
+					_clockEstimator->_engine = nullptr;
+				}
+				_clockEstimator = estimator;
+				if (estimator != nullptr) {
+					estimator->_engine = this;
+				}
+			}
+			return result;
+		}
+
+		bool AcquisitionEngine::IsRunning::get() {
+			return _core != nullptr && _core->IsRunning();
+		}
+
+		bool AcquisitionEngine::TryAcquireBlock(
+			[Out] AcquisitionBlock% block) {
+
+			Native::BlockView view;
+
+			if (_core == nullptr || !_core->TryAcquireBlock(view)) {
+				block = AcquisitionBlock();
+				return false;
+			}
+
+			_FillBlock(view, block);
+			return true;
+		}
+
+		bool AcquisitionEngine::WaitForBlock(int timeoutMs,
+			[Out] AcquisitionBlock% block) {
+
+			Native::BlockView view;
+
+			if (_core == nullptr
+				|| !_core->WaitAcquireBlock(view, (uInt32)Math::Max(timeoutMs, 0))) {
+				block = AcquisitionBlock();
+				return false;
+			}
+
+			_FillBlock(view, block);
+			return true;
+		}
+
+		void AcquisitionEngine::ReleaseBlock() {
+			if (_core != nullptr) {
+				_core->ReleaseBlock();
+			}
+		}
+
+		int AcquisitionEngine::PendingBlocks::get() {
+			return (_core != nullptr) ? (int)_core->PendingBlocks() : 0;
+		}
+
+		UInt64 AcquisitionEngine::BlocksRead::get() {
+			return (_core != nullptr) ? _core->Counters().blocksRead : 0;
+		}
+
+		UInt64 AcquisitionEngine::BlocksDropped::get() {
+			return (_core != nullptr) ? _core->Counters().blocksDropped : 0;
+		}
+
+		UInt64 AcquisitionEngine::ReadErrors::get() {
+			return (_core != nullptr) ? _core->Counters().readErrors : 0;
+		}
+
+		int AcquisitionEngine::LastError::get() {
+			return (_core != nullptr) ? _core->Counters().lastError : 0;
+		}
+
+		void AcquisitionEngine::_ReleaseStage() {
+			Detach();
+		}
+
+		void AcquisitionEngine::_UnlinkStages() {
+
+			if (_decimator != nullptr) {
+				_decimator->_engine = nullptr;
+				_decimator = nullptr;
+			}
+			if (_statistics != nullptr) {
+				_statistics->_engine = nullptr;
+				_statistics = nullptr;
+			}
+			if (_trigger != nullptr) {
+				_trigger->_engine = nullptr;
+				_trigger = nullptr;
+			}
+			if (_clockEstimator != nullptr) {
+				_clockEstimator->_engine = nullptr;
+				_clockEstimator = nullptr;
+			}
+		}
+
+		void AcquisitionEngine::_FillBlock(const Native::BlockView& view,
+			AcquisitionBlock% block) {
+
+			block.Data = IntPtr(const_cast<void*>(view.data));
+			block.SamplesPerChannel = (int)view.samplesPerChannel;
+			block.Channels = (int)view.channels;
+			block.Format = (SampleFormat)view.format;
+			block.FillMode = (ReadbacklFillMode)view.fillMode;
+			block.FirstSample = view.firstSample;
+			block.Sequence = view.sequence;
+			block.Status = view.status;
+			block.HostTimestampNs = view.hostTimestampNs;
+			block.SamplesAcquired = view.samplesAcquired;
+		}
+	}
+}
@@ -0,0 +1,287 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "Native/AcquisitionEngineCore.h"
+#include "BlockStatistics.h"
+#include "ClockDriftEstimator.h"
+#include "Decimator.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		ref class SoftwareTrigger;
+
+		public enum class SampleFormat
+		{
+			Float64 = (int)Native::SampleFormat::Float64,	// Scaled, DAQmxReadAnalogF64
+			Int16 = (int)Native::SampleFormat::Int16,		// Unscaled, DAQmxReadBinaryI16
+			Int32 = (int)Native::SampleFormat::Int32,		// Unscaled, DAQmxReadBinaryI32
+			UInt16 = (int)Native::SampleFormat::UInt16,		// Unscaled, DAQmxReadBinaryU16
+			UInt32 = (int)Native::SampleFormat::UInt32		// Unscaled, DAQmxReadBinaryU32
+		};
+
+		/**
+		* @brief Zero-copy view of one block acquired by an `AcquisitionEngine`.
+		*
+		* `Data` points into the native ring of the engine. It is valid until
+		* `AcquisitionEngine::ReleaseBlock` is called. From C# wrap it without
+		* copying, e.g. `new ReadOnlySpan<short>((void*)block.Data, block.SampleCount)`.
+		*/
+		public value struct AcquisitionBlock
+		{
+			IntPtr Data;
+			int SamplesPerChannel;
+			int Channels;
+			SampleFormat Format;
+			ReadbacklFillMode FillMode;
+			UInt64 FirstSample;
+			UInt64 Sequence;
+			int Status;
+
+			/** `ClockDriftEstimator::HostTimeNs` when the driver signalled
+			*   the block. */
+			Int64 HostTimestampNs;
+
+			/** Samples per channel acquired by the driver at
+			*   `HostTimestampNs`, at the full rate; `0` if unknown. */
+			UInt64 SamplesAcquired;
+
+			property int SampleCount {
+				int get() { return SamplesPerChannel * Channels; }
+			}
+		};
+
+		/**
+		* @brief Settings of an `AcquisitionEngine`.
+		*/
+		public ref class AcquisitionEngineConfiguration
+		{
+		public:
+			AcquisitionEngineConfiguration();
+
+			/** Number of channels in the task. */
+			property int Channels;
+
+			/** Samples per channel in a block; the N of the EveryNSamples event. */
+			property int SamplesPerBlock;
+
+			/** Number of blocks buffered between the driver and the consumer. */
+			property int RingBlocks;
+
+			/** Sample format used for the reads. */
+			property SampleFormat Format;
+
+			/** Layout the driver reads the samples in. */
+			property ReadbacklFillMode FillMode;
+
+			/** Layout of the blocks handed out by the engine. When set and
+			*   different from `FillMode`, every block is transposed in native
+			*   code before it is published; `null` delivers blocks as read. */
+			property Nullable<ReadbacklFillMode> DeliveredFillMode;
+
+			/** Timeout, in seconds, of the reads issued by the engine. */
+			property double ReadTimeout;
+
+			/** If `true`, the engine clears the task when disposed. */
+			property bool OwnsTask;
+
+		internal:
+			Native::AcquisitionEngineConfig ToNative();
+		};
+
+		/**
+		* @brief Continuous acquisition engine running entirely in native code.
+		*
+		* The engine attaches to a configured DAQmx task and registers a native
+		* EveryNSamples callback. Every block is read inside that callback, on the
+		* driver thread, into a preallocated lock-free ring. Managed consumers
+		* take blocks from the ring as zero-copy views, so no delegate is invoked
+		* and nothing is allocated per block.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the engine.
+		*/
+		public ref class AcquisitionEngine
+		{
+		private:
+			Native::AcquisitionEngineCore* _core;
+			Decimator^ _decimator;
+			BlockStatistics^ _statistics;
+			SoftwareTrigger^ _trigger;
+			ClockDriftEstimator^ _clockEstimator;
+
+		public:
+			AcquisitionEngine();
+			~AcquisitionEngine();
+			!AcquisitionEngine();
+
+			/**
+			* @brief Attaches the engine to a configured, not yet started task.
+			*
+			* @param[in] taskHandle The task to acquire from.
+			* @param[in] configuration Engine settings.
+			*
+			* @return `0` on success, a negative status code otherwise.
+			*/
+			int Attach(IntPtr taskHandle,
+				AcquisitionEngineConfiguration^ configuration);
+
+			/**
+			* @brief Stops the engine and unregisters its callback. Clears the task
+			*        if the engine owns it.
+			*/
+			int Detach();
+
+			/**
+			* @brief Starts the task and the acquisition.
+			*/
+			int Start();
+
+			/**
+			* @brief Stops the task. Blocks already acquired stay readable.
+			*/
+			int Stop();
+
+			/**
+			* @brief Filters and decimates every block in native code before it
+			*        reaches the ring; `nullptr` removes the stage.
+			*
+			* Call after `Attach` and before `Start`. The decimator must be
+			* configured for the channels of the engine and for blocks of
+			* `SamplesPerBlock` samples; the engine must read `Float64` or
+			* `Int16`. Blocks are then delivered decimated, in the same format,
+			* and `AcquisitionBlock::FirstSample` counts decimated samples. The
+			* decimator serves one engine at a time; disposing of it detaches
+			* the engine.
+			*/
+			int SetDecimator(Decimator^ decimator);
+
+			/**
+			* @brief Updates `statistics` with every block in native code, right
+			*        after it is read; `nullptr` removes the stage.
+			*
+			* Call after `Attach` and before `Start`. The statistics must be
+			* configured for the channels of the engine, which must read
+			* `Float64` or `Int16`. They cover the full-rate data, before any
+			* decimator, and include blocks dropped because the ring was full.
+			* `Start` resets them. They serve one engine at a time; disposing
+			* of them detaches the engine.
+			*/
+			int SetStatistics(BlockStatistics^ statistics);
+
+			/**
+			* @brief Scans every block with `trigger` in native code, right after
+			*        it is read; `nullptr` removes the stage.
+			*
+			* Call after `Attach` and before `Start`. The trigger must be
+			* configured for the channels and the format of the engine and for
+			* blocks of `SamplesPerBlock` samples. Its sample indices count the
+			* full-rate samples since `Start`, including blocks dropped because
+			* the ring was full. Take the windows from the trigger. It serves
+			* one engine at a time; disposing of it detaches the engine.
+			*/
+			int SetTrigger(SoftwareTrigger^ trigger);
+
+			/**
+			* @brief Feeds `estimator` in native code with the samples acquired
+			*        and the host time of every block; `nullptr` removes it.
+			*
+			* Call after `Attach` and before `Start`, which resets it. Blocks
+			* dropped because the ring was full are included. The estimator
+			* then gives any sample since `Start` a host timestamp. It serves
+			* one engine at a time; disposing of it detaches the engine.
+			*/
+			int SetClockEstimator(ClockDriftEstimator^ estimator);
+
+			property bool IsRunning {
+				bool get();
+			}
+
+			/**
+			* @brief Gets the oldest unconsumed block without waiting.
+			*
+			* @param[out] block The block view.
+			*
+			* @return `true` if a block was available. The block must be returned
+			*         with `ReleaseBlock`.
+			*/
+			bool TryAcquireBlock([Out] AcquisitionBlock% block);
+
+			/**
+			* @brief Waits for the next block.
+			*
+			* @param[in] timeoutMs Maximum time to wait, in milliseconds.
+			* @param[out] block The block view.
+			*
+			* @return `true` if a block was available before the timeout. The block
+			*         must be returned with `ReleaseBlock`.
+			*/
+			bool WaitForBlock(int timeoutMs, [Out] AcquisitionBlock% block);
+
+			/**
+			* @brief Returns the block obtained by the last acquire to the engine.
+			*/
+			void ReleaseBlock();
+
+			property int PendingBlocks {
+				int get();
+			}
+
+			property UInt64 BlocksRead {
+				UInt64 get();
+			}
+
+			property UInt64 BlocksDropped {
+				UInt64 get();
+			}
+
+			property UInt64 ReadErrors {
+				UInt64 get();
+			}
+
+			property int LastError {
+				int get();
+			}
+
+		internal:
+			/**
+			* @brief Detaches the engine before one of its stages frees its
+			*        core, which callbacks in flight may still be calling.
+			*
+			* Finalizers run in no particular order, so a stage may be
+			* finalized before the engine that runs it.
+			*/
+			void _ReleaseStage();
+
+		private:
+			void _UnlinkStages();
+
+			static void _FillBlock(const Native::BlockView& view,
+				AcquisitionBlock% block);
+		};
+	}
+}
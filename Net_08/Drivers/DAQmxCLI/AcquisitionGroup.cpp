@@ -0,0 +1,227 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AcquisitionGroup.h"
+
+#include <cstring>
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace {
+
+			void CopyTerminal(String^ terminal, char* target) {
+
+				target[0] = '\0';
+
+				if (String::IsNullOrEmpty(terminal)) {
+					return;
+				}
+
+				char* cString = DAQmxCLIWrapper::ConvertToCString(terminal);
+				std::strncpy(target, cString, Native::AcquisitionGroupTerminalBytes - 1);
+				target[Native::AcquisitionGroupTerminalBytes - 1] = '\0';
+				DAQmxCLIWrapper::FreeCString(cString);
+			}
+		}
+
+		AcquisitionGroupConfiguration::AcquisitionGroupConfiguration() {
+
+			Native::AcquisitionGroupConfig defaults =
+				Native::DefaultAcquisitionGroupConfig();
+
+			SampleRate = defaults.sampleRate;
+			SamplesPerBlock = (int)defaults.samplesPerBlock;
+			RingBlocks = (int)defaults.ringBlocks;
+			FrameCapacity = (int)defaults.frameCapacity;
+			Format = (SampleFormat)defaults.format;
+			FillMode = (ReadbacklFillMode)defaults.fillMode;
+			ReadTimeout = defaults.readTimeout;
+			ClockTerminal = String::Empty;
+			TriggerTerminal = String::Empty;
+		}
+
+		Native::AcquisitionGroupConfig AcquisitionGroupConfiguration::ToNative() {
+
+			Native::AcquisitionGroupConfig config =
+				Native::DefaultAcquisitionGroupConfig();
+
+			config.sampleRate = SampleRate;
+			config.samplesPerBlock = (uInt32)Math::Max(SamplesPerBlock, 0);
+			config.ringBlocks = (uInt32)Math::Max(RingBlocks, 0);
+			config.frameCapacity = (uInt32)Math::Max(FrameCapacity, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.fillMode = (int32)FillMode;
+			config.readTimeout = ReadTimeout;
+			CopyTerminal(ClockTerminal, config.clockTerminal);
+			CopyTerminal(TriggerTerminal, config.triggerTerminal);
+			return config;
+		}
+
+		AcquisitionGroup::AcquisitionGroup() {
+			_core = new Native::AcquisitionGroupCore();
+		}
+
+		AcquisitionGroup::~AcquisitionGroup() {
+			this->!AcquisitionGroup();
+		}
+
+		AcquisitionGroup::!AcquisitionGroup() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int AcquisitionGroup::AddMember(String^ physicalChannels,
+			AiTermination terminalConfig, double minVal, double maxVal) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (String::IsNullOrEmpty(physicalChannels)) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			char* cString = DAQmxCLIWrapper::ConvertToCString(physicalChannels);
+			int result = _core->AddMember(cString, (int32)terminalConfig, minVal, maxVal);
+			DAQmxCLIWrapper::FreeCString(cString);
+			return result;
+		}
+
+		int AcquisitionGroup::MemberCount::get() {
+			return (_core != nullptr) ? (int)_core->MemberCount() : 0;
+		}
+
+		IntPtr AcquisitionGroup::MemberTask(int member) {
+			return (_core != nullptr && member >= 0)
+				? IntPtr(_core->MemberTask((uInt32)member)) : IntPtr::Zero;
+		}
+
+		int AcquisitionGroup::MemberChannels(int member) {
+			return (_core != nullptr && member >= 0)
+				? (int)_core->MemberChannels((uInt32)member) : 0;
+		}
+
+		int AcquisitionGroup::Configure(AcquisitionGroupConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::AcquisitionGroupConfig config = configuration->ToNative();
+			return _core->Configure(config);
+		}
+
+		int AcquisitionGroup::Start() {
+			return (_core != nullptr) ? _core->Start()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int AcquisitionGroup::Stop() {
+			return (_core != nullptr) ? _core->Stop()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		bool AcquisitionGroup::IsRunning::get() {
+			return _core != nullptr && _core->IsRunning();
+		}
+
+		bool AcquisitionGroup::TryAcquireFrame([Out] AcquisitionFrame% frame) {
+
+			Native::FrameView view;
+
+			if (_core == nullptr || !_core->TryAcquireFrame(view)) {
+				frame = AcquisitionFrame();
+				return false;
+			}
+
+			_FillFrame(view, frame);
+			return true;
+		}
+
+		bool AcquisitionGroup::WaitForFrame(int timeoutMs,
+			[Out] AcquisitionFrame% frame) {
+
+			Native::FrameView view;
+
+			if (_core == nullptr
+				|| !_core->WaitAcquireFrame(view, (uInt32)Math::Max(timeoutMs, 0))) {
+				frame = AcquisitionFrame();
+				return false;
+			}
+
+			_FillFrame(view, frame);
+			return true;
+		}
+
+		void AcquisitionGroup::ReleaseFrame() {
+			if (_core != nullptr) {
+				_core->ReleaseFrame();
+			}
+		}
+
+		int AcquisitionGroup::PendingFrames::get() {
+			return (_core != nullptr) ? (int)_core->PendingFrames() : 0;
+		}
+
+		UInt64 AcquisitionGroup::FramesMerged::get() {
+			return (_core != nullptr) ? _core->Counters().framesMerged : 0;
+		}
+
+		UInt64 AcquisitionGroup::FramesDropped::get() {
+			return (_core != nullptr) ? _core->Counters().framesDropped : 0;
+		}
+
+		UInt64 AcquisitionGroup::BlocksDiscarded::get() {
+			return (_core != nullptr) ? _core->Counters().blocksDiscarded : 0;
+		}
+
+		UInt64 AcquisitionGroup::MemberBlocksDropped::get() {
+			return (_core != nullptr) ? _core->Counters().memberBlocksDropped : 0;
+		}
+
+		int AcquisitionGroup::LastError::get() {
+			return (_core != nullptr) ? _core->Counters().lastError : 0;
+		}
+
+		void AcquisitionGroup::_FillFrame(const Native::FrameView& view,
+			AcquisitionFrame% frame) {
+
+			frame.Data = IntPtr(const_cast<void*>(view.data));
+			frame.SamplesPerChannel = (int)view.samplesPerChannel;
+			frame.Channels = (int)view.channels;
+			frame.Format = (SampleFormat)view.format;
+			frame.FillMode = (ReadbacklFillMode)view.fillMode;
+			frame.FirstSample = view.firstSample;
+			frame.Sequence = view.sequence;
+			frame.Status = view.status;
+			frame.HostTimestampNs = view.hostTimestampNs;
+		}
+	}
+}
@@ -0,0 +1,221 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "AcquisitionEngine.h"
+#include "Native/AcquisitionGroupCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Zero-copy view of one frame merged by an `AcquisitionGroup`.
+		*
+		* `Data` points into the native ring of the group and holds the
+		* channels of all members, those of member 0 first. It is valid
+		* until `AcquisitionGroup::ReleaseFrame` is called.
+		*/
+		public value struct AcquisitionFrame
+		{
+			IntPtr Data;
+			int SamplesPerChannel;
+			int Channels;
+			SampleFormat Format;
+			ReadbacklFillMode FillMode;
+
+			/** Index, per channel, of the first sample since the start
+			*   trigger; the same for every member. */
+			UInt64 FirstSample;
+			UInt64 Sequence;
+
+			/** First failed status of the member reads, or `0`. */
+			int Status;
+
+			/** Latest host timestamp of the member blocks. */
+			Int64 HostTimestampNs;
+
+			property int SampleCount {
+				int get() { return SamplesPerChannel * Channels; }
+			}
+		};
+
+		/**
+		* @brief Settings of an `AcquisitionGroup`.
+		*/
+		public ref class AcquisitionGroupConfiguration
+		{
+		public:
+			AcquisitionGroupConfiguration();
+
+			/** Sample clock rate of the master, in Hz. */
+			property double SampleRate;
+
+			/** Samples per channel of every block and frame. */
+			property int SamplesPerBlock;
+
+			/** Blocks buffered by the engine of each member. */
+			property int RingBlocks;
+
+			/** Merged frames buffered for the consumer. */
+			property int FrameCapacity;
+
+			property SampleFormat Format;
+
+			/** Layout of the frames. */
+			property ReadbacklFillMode FillMode;
+
+			/** Timeout, in seconds, of the reads of the members. */
+			property double ReadTimeout;
+
+			/** Terminal the master exports its sample clock to, e.g.
+			*   `/Dev1/PFI5` or `/Dev1/RTSI0`. Required with several members. */
+			property String^ ClockTerminal;
+
+			/** Terminal the master exports its start trigger to. Required
+			*   with several members. */
+			property String^ TriggerTerminal;
+
+		internal:
+			Native::AcquisitionGroupConfig ToNative();
+		};
+
+		/**
+		* @brief Synchronized acquisition from several devices.
+		*
+		* Each member is an analog input task on one device; the first is
+		* the master. `Configure` exports the sample clock and the start
+		* trigger of the master and routes them to the other members;
+		* `Start` arms the other members before it starts the master. Every
+		* member runs its own native acquisition engine, and a native thread
+		* merges their blocks by sample index into frames of all channels.
+		* Blocks a member dropped are discarded from the others too, so the
+		* frames stay aligned.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the group.
+		*/
+		public ref class AcquisitionGroup
+		{
+		private:
+			Native::AcquisitionGroupCore* _core;
+
+		public:
+			AcquisitionGroup();
+			~AcquisitionGroup();
+			!AcquisitionGroup();
+
+			/**
+			* @brief Creates the task of a new member.
+			*
+			* @param[in] physicalChannels Analog input channels of one device,
+			*            e.g. `Dev2/ai0:3`.
+			*
+			* @return The index of the member, or a negative status code.
+			*/
+			int AddMember(String^ physicalChannels, AiTermination terminalConfig,
+				double minVal, double maxVal);
+
+			property int MemberCount {
+				int get();
+			}
+
+			/**
+			* @brief The task of a member, to adjust its channels before
+			*        `Configure`. The group owns it.
+			*/
+			IntPtr MemberTask(int member);
+
+			int MemberChannels(int member);
+
+			/**
+			* @brief Configures timing, routing and the member engines.
+			*/
+			int Configure(AcquisitionGroupConfiguration^ configuration);
+
+			/**
+			* @brief Starts the members, the master last, and the merge.
+			*/
+			int Start();
+
+			/**
+			* @brief Stops the members, the master first. Frames already
+			*        merged stay readable.
+			*/
+			int Stop();
+
+			property bool IsRunning {
+				bool get();
+			}
+
+			/**
+			* @brief Gets the oldest unconsumed frame without waiting.
+			*
+			* @return `true` if a frame was available. It must be returned with
+			*         `ReleaseFrame`.
+			*/
+			bool TryAcquireFrame([Out] AcquisitionFrame% frame);
+
+			/**
+			* @brief Waits up to `timeoutMs` milliseconds for the next frame.
+			*/
+			bool WaitForFrame(int timeoutMs, [Out] AcquisitionFrame% frame);
+
+			/**
+			* @brief Returns the frame obtained by the last acquire to the group.
+			*/
+			void ReleaseFrame();
+
+			property int PendingFrames {
+				int get();
+			}
+
+			property UInt64 FramesMerged {
+				UInt64 get();
+			}
+
+			property UInt64 FramesDropped {
+				UInt64 get();
+			}
+
+			/** Member blocks without partners, discarded after a drop. */
+			property UInt64 BlocksDiscarded {
+				UInt64 get();
+			}
+
+			property UInt64 MemberBlocksDropped {
+				UInt64 get();
+			}
+
+			property int LastError {
+				int get();
+			}
+
+		private:
+			static void _FillFrame(const Native::FrameView& view,
+				AcquisitionFrame% frame);
+		};
+	}
+}
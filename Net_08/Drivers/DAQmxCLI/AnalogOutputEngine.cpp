@@ -0,0 +1,230 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AnalogOutputEngine.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		AnalogOutputEngineConfiguration::AnalogOutputEngineConfiguration() {
+
+			Native::AnalogOutputEngineConfig defaults =
+				Native::DefaultAnalogOutputEngineConfig();
+
+			Channels = (int)defaults.channels;
+			SamplesPerBlock = (int)defaults.samplesPerBlock;
+			RingBlocks = (int)defaults.ringBlocks;
+			BufferBlocks = (int)defaults.bufferBlocks;
+			Format = (SampleFormat)defaults.format;
+			FillMode = (ReadbacklFillMode)defaults.fillMode;
+			Regeneration = defaults.regeneration;
+			HoldOnUnderrun = defaults.holdOnUnderrun;
+			WriteTimeout = defaults.writeTimeout;
+			OwnsTask = defaults.ownsTask;
+		}
+
+		Native::AnalogOutputEngineConfig AnalogOutputEngineConfiguration::ToNative() {
+
+			Native::AnalogOutputEngineConfig config =
+				Native::DefaultAnalogOutputEngineConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.samplesPerBlock = (uInt32)Math::Max(SamplesPerBlock, 0);
+			config.ringBlocks = (uInt32)Math::Max(RingBlocks, 0);
+			config.bufferBlocks = (uInt32)Math::Max(BufferBlocks, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.fillMode = (int32)FillMode;
+			config.regeneration = Regeneration;
+			config.holdOnUnderrun = HoldOnUnderrun;
+			config.writeTimeout = WriteTimeout;
+			config.ownsTask = OwnsTask;
+			return config;
+		}
+
+		AnalogOutputEngine::AnalogOutputEngine() {
+			_core = new Native::AnalogOutputEngineCore();
+		}
+
+		AnalogOutputEngine::~AnalogOutputEngine() {
+			this->!AnalogOutputEngine();
+		}
+
+		AnalogOutputEngine::!AnalogOutputEngine() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int AnalogOutputEngine::Attach(IntPtr taskHandle,
+			AnalogOutputEngineConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::AnalogOutputEngineConfig config = configuration->ToNative();
+			return _core->Attach((TaskHandle)taskHandle.ToPointer(), config);
+		}
+
+		int AnalogOutputEngine::Detach() {
+			return (_core != nullptr) ? _core->Detach() : 0;
+		}
+
+		int AnalogOutputEngine::Start() {
+			return (_core != nullptr) ? _core->Start()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int AnalogOutputEngine::Stop() {
+			return (_core != nullptr) ? _core->Stop()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		bool AnalogOutputEngine::IsRunning::get() {
+			return _core != nullptr && _core->IsRunning();
+		}
+
+		int AnalogOutputEngine::WriteBlock(Memory<double> block, int timeoutMs) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _WriteBlock(handle.Pointer, block.Length, SampleFormat::Float64, timeoutMs);
+			handle.Dispose();
+			return result;
+		}
+
+		int AnalogOutputEngine::WriteBlock(Memory<Int16> block, int timeoutMs) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _WriteBlock(handle.Pointer, block.Length, SampleFormat::Int16, timeoutMs);
+			handle.Dispose();
+			return result;
+		}
+
+		int AnalogOutputEngine::_WriteBlock(const void* data, Int64 length,
+			SampleFormat format, int timeoutMs) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (_core->Task() == NULL) {
+				return Native::NativeErrorNotAttached;
+			}
+
+			const Native::AnalogOutputEngineConfig& config = _core->Config();
+
+			if ((SampleFormat)config.format != format) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if (length < (Int64)config.channels * config.samplesPerBlock) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			return _core->WriteBlock(data, (uInt32)Math::Max(timeoutMs, 0));
+		}
+
+		int AnalogOutputEngine::WriteWaveform(WaveformGenerator^ generator, int timeoutMs) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (_core->Task() == NULL) {
+				return Native::NativeErrorNotAttached;
+			}
+			if (generator == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::WaveformGeneratorCore* source = generator->_GetCore();
+
+			if (source == nullptr || !source->IsConfigured()) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			const Native::AnalogOutputEngineConfig& config = _core->Config();
+
+			if (source->Config().format != config.format) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if (source->Config().channels != config.channels
+				|| source->Config().fillMode != config.fillMode) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			void* slot = _core->WaitWriteBlock((uInt32)Math::Max(timeoutMs, 0));
+
+			if (slot == nullptr) {
+				return Native::NativeErrorTimeout;
+			}
+
+			int result = source->Render(slot, config.samplesPerBlock);
+			GC::KeepAlive(generator);
+
+			// A failed render leaves the slot to the next write, unpublished.
+			if (result >= 0) {
+				_core->CommitWriteBlock();
+			}
+			return result;
+		}
+
+		int AnalogOutputEngine::FreeBlocks::get() {
+			return (_core != nullptr) ? (int)_core->FreeBlocks() : 0;
+		}
+
+		int AnalogOutputEngine::PendingBlocks::get() {
+			return (_core != nullptr) ? (int)_core->PendingBlocks() : 0;
+		}
+
+		UInt64 AnalogOutputEngine::SamplesGenerated::get() {
+			return (_core != nullptr) ? _core->SamplesGenerated() : 0;
+		}
+
+		UInt64 AnalogOutputEngine::BlocksWritten::get() {
+			return (_core != nullptr) ? _core->Counters().blocksWritten : 0;
+		}
+
+		UInt64 AnalogOutputEngine::Underruns::get() {
+			return (_core != nullptr) ? _core->Counters().underruns : 0;
+		}
+
+		UInt64 AnalogOutputEngine::BlocksHeld::get() {
+			return (_core != nullptr) ? _core->Counters().blocksHeld : 0;
+		}
+
+		UInt64 AnalogOutputEngine::SamplesRegenerated::get() {
+			return (_core != nullptr) ? _core->Counters().samplesRegenerated : 0;
+		}
+
+		UInt64 AnalogOutputEngine::WriteErrors::get() {
+			return (_core != nullptr) ? _core->Counters().writeErrors : 0;
+		}
+
+		int AnalogOutputEngine::LastError::get() {
+			return (_core != nullptr) ? _core->Counters().lastError : 0;
+		}
+	}
+}
@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+
+#include "DAQmxCLIWrapper.h"
+#include "AcquisitionEngine.h"
+#include "WaveformGenerator.h"
+#include "Native/AnalogOutputEngineCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Settings of an `AnalogOutputEngine`.
+		*/
+		public ref class AnalogOutputEngineConfiguration
+		{
+		public:
+			AnalogOutputEngineConfiguration();
+
+			/** Number of channels in the task. */
+			property int Channels;
+
+			/** Samples per channel in one block. */
+			property int SamplesPerBlock;
+
+			/** Blocks the producer can write ahead of the device. */
+			property int RingBlocks;
+
+			/** Size of the device buffer, in blocks; at least 2. */
+			property int BufferBlocks;
+
+			/** `Float64` (volts) or `Int16` (DAC codes). */
+			property SampleFormat Format;
+
+			/** Layout of the blocks written by the producer. */
+			property ReadbacklFillMode FillMode;
+
+			/** If `true`, the device repeats old samples when the producer
+			*   falls behind; if `false`, the generation stops with an error. */
+			property bool Regeneration;
+
+			/** If `true`, missing blocks are replaced with the last written
+			*   values, so the device never runs dry. */
+			property bool HoldOnUnderrun;
+
+			/** Timeout, in seconds, of the native writes to the device. */
+			property double WriteTimeout;
+
+			/** If `true`, `Detach` clears the task. */
+			property bool OwnsTask;
+
+		internal:
+			Native::AnalogOutputEngineConfig ToNative();
+		};
+
+		/**
+		* @brief Streams long, non-repeating waveforms to an analog output
+		*        task.
+		*
+		* The application writes blocks into a native ring; a native thread,
+		* paced by the EveryNSamplesTransferred event of the task, moves them
+		* into the device buffer. No delegate is invoked and nothing is
+		* allocated per block. Underruns are counted and, depending on the
+		* configuration, bridged by regeneration or by holding the last
+		* values.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the engine.
+		*/
+		public ref class AnalogOutputEngine
+		{
+		private:
+			Native::AnalogOutputEngineCore* _core;
+
+		public:
+			AnalogOutputEngine();
+			~AnalogOutputEngine();
+			!AnalogOutputEngine();
+
+			/**
+			* @brief Attaches the engine to a configured, not yet started
+			*        analog output task.
+			*/
+			int Attach(IntPtr taskHandle,
+				AnalogOutputEngineConfiguration^ configuration);
+
+			/**
+			* @brief Stops the engine and unregisters its callback. Clears the
+			*        task if the engine owns it.
+			*/
+			int Detach();
+
+			/**
+			* @brief Writes the first blocks to the device and starts the task.
+			*        At least one block must have been written.
+			*/
+			int Start();
+
+			/**
+			* @brief Stops the task. Blocks not yet generated stay in the ring.
+			*/
+			int Stop();
+
+			property bool IsRunning {
+				bool get();
+			}
+
+			/**
+			* @brief Copies one block of `Float64` samples into the ring,
+			*        waiting up to `timeoutMs` milliseconds for room.
+			*
+			* @return `0`, a timeout or a negative status code.
+			*/
+			int WriteBlock(Memory<double> block, int timeoutMs);
+
+			/**
+			* @brief Copies one block of `Int16` DAC codes into the ring.
+			*/
+			int WriteBlock(Memory<Int16> block, int timeoutMs);
+
+			/**
+			* @brief Renders the next block of `generator` straight into the
+			*        ring, waiting up to `timeoutMs` milliseconds for room.
+			*
+			* The generator must have the channels, format and fill mode of
+			* the engine. A block the generator fails to render is not sent
+			* to the device.
+			*/
+			int WriteWaveform(WaveformGenerator^ generator, int timeoutMs);
+
+			/** Blocks that can be written without waiting. */
+			property int FreeBlocks {
+				int get();
+			}
+
+			/** Blocks in the ring not yet written to the device. */
+			property int PendingBlocks {
+				int get();
+			}
+
+			/** Samples per channel generated since the last `Start`. */
+			property UInt64 SamplesGenerated {
+				UInt64 get();
+			}
+
+			property UInt64 BlocksWritten {
+				UInt64 get();
+			}
+
+			property UInt64 Underruns {
+				UInt64 get();
+			}
+
+			property UInt64 BlocksHeld {
+				UInt64 get();
+			}
+
+			property UInt64 SamplesRegenerated {
+				UInt64 get();
+			}
+
+			property UInt64 WriteErrors {
+				UInt64 get();
+			}
+
+			property int LastError {
+				int get();
+			}
+
+		private:
+			int _WriteBlock(const void* data, Int64 length, SampleFormat format,
+				int timeoutMs);
+		};
+	}
+}
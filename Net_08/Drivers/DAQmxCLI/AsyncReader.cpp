@@ -0,0 +1,359 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AsyncReader.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		AsyncReaderConfiguration::AsyncReaderConfiguration() {
+
+			Native::AsyncReaderConfig defaults = Native::DefaultAsyncReaderConfig();
+
+			Channels = (int)defaults.channels;
+			Format = (SampleFormat)defaults.format;
+			Digital = defaults.digital;
+			FillMode = (ReadbacklFillMode)defaults.fillMode;
+			NotifySamples = (int)defaults.notifySamples;
+			PollIntervalUs = (int)defaults.pollIntervalUs;
+			MaxPendingReads = (int)defaults.maxPending;
+		}
+
+		Native::AsyncReaderConfig AsyncReaderConfiguration::ToNative() {
+
+			Native::AsyncReaderConfig config = Native::DefaultAsyncReaderConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.digital = Digital;
+			config.fillMode = (int32)FillMode;
+			config.notifySamples = (uInt32)Math::Max(NotifySamples, 0);
+			config.pollIntervalUs = (uInt32)Math::Max(PollIntervalUs, 0);
+			config.maxPending = (uInt32)Math::Max(MaxPendingReads, 0);
+			return config;
+		}
+
+
+		void AsyncReader::PendingRead::Cancel() {
+
+			Native::AsyncReaderCore* core = Reader->_core;
+
+			if (core != nullptr) {
+				core->Cancel(Tag);
+			}
+		}
+
+
+		AsyncReader::AsyncReader() {
+			_core = new Native::AsyncReaderCore();
+			_pending = gcnew Dictionary<UInt64, PendingRead^>();
+			_nextTag = 0;
+		}
+
+		AsyncReader::~AsyncReader() {
+			this->!AsyncReader();
+		}
+
+		AsyncReader::!AsyncReader() {
+
+			if (_core != nullptr) {
+				// Cancels the pending reads through the delegate, so the
+				// delegate is released only afterwards.
+				delete _core;
+				_core = nullptr;
+			}
+			if (_completedHandle.IsAllocated) {
+				_completedHandle.Free();
+			}
+		}
+
+		int AsyncReader::Attach(IntPtr taskHandle,
+			AsyncReaderConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			if (_completed == nullptr) {
+				_completed = gcnew AsyncReadCompletedDelegate(this, &AsyncReader::_OnCompleted);
+			}
+
+			int result = _core->Attach((TaskHandle)taskHandle.ToPointer(),
+				configuration->ToNative(),
+				static_cast<Native::AsyncReadCompletion>(
+					Marshal::GetFunctionPointerForDelegate(_completed).ToPointer()),
+				nullptr);
+
+			// The native side calls back until detached; the handle keeps the
+			// delegate, and with it the reader, alive until then.
+			if (result == Native::NativeSuccess && !_completedHandle.IsAllocated) {
+				_completedHandle = GCHandle::Alloc(_completed);
+			}
+			return result;
+		}
+
+		int AsyncReader::Detach() {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			int result = _core->Detach();
+
+			// Refused from a completion: reads are still in flight and the
+			// driver may still call the delegate, so it stays pinned until a
+			// later Detach or Dispose.
+			if (result == Native::NativeSuccess && _completedHandle.IsAllocated) {
+				_completedHandle.Free();
+			}
+			return result;
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadAnalogF64Async(Memory<double> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::Float64, false, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadBinaryI16Async(Memory<Int16> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::Int16, false, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadBinaryUI16Async(Memory<UInt16> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::UInt16, false, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadBinaryI32Async(Memory<Int32> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::Int32, false, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadBinaryUI32Async(Memory<UInt32> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::UInt32, false, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadDigitU32Async(Memory<UInt32> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::UInt32, true, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadDigitU16Async(Memory<UInt16> data,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			return _Submit(SampleFormat::UInt16, true, nullptr, data.Length,
+				data.Pin(), samplesPerChannel, cancellationToken);
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::ReadAsync(IntPtr data, int bufferSizeInSamples,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			if (_core == nullptr || _core->Task() == NULL) {
+				return _Rejected(Native::NativeErrorNotAttached);
+			}
+
+			const Native::AsyncReaderConfig& config = _core->Config();
+
+			return _Submit((SampleFormat)config.format, config.digital, data.ToPointer(),
+				bufferSizeInSamples, System::Buffers::MemoryHandle(), samplesPerChannel,
+				cancellationToken);
+		}
+
+		void AsyncReader::CancelAll() {
+
+			if (_core == nullptr) {
+				return;
+			}
+
+			array<UInt64>^ tags;
+
+			Monitor::Enter(_pending);
+			try {
+				tags = gcnew array<UInt64>(_pending->Count);
+				_pending->Keys->CopyTo(tags, 0);
+			}
+			finally {
+				Monitor::Exit(_pending);
+			}
+
+			for each (UInt64 tag in tags) {
+				_core->Cancel(tag);
+			}
+		}
+
+		int AsyncReader::PendingReads::get() {
+			return (_core != nullptr) ? (int)_core->PendingReads() : 0;
+		}
+
+		UInt64 AsyncReader::ReadsCompleted::get() {
+			return (_core != nullptr) ? _core->Counters().completed : 0;
+		}
+
+		UInt64 AsyncReader::ReadsFailed::get() {
+			return (_core != nullptr) ? _core->Counters().failed : 0;
+		}
+
+		UInt64 AsyncReader::ReadsCancelled::get() {
+			return (_core != nullptr) ? _core->Counters().cancelled : 0;
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::_Submit(SampleFormat format, bool digital,
+			void* data, int bufferSizeInSamples, System::Buffers::MemoryHandle pin,
+			int samplesPerChannel, CancellationToken cancellationToken) {
+
+			// Memory overloads pass their pin; the pointer comes from it.
+			if (data == nullptr) {
+				data = pin.Pointer;
+			}
+
+			int status = Native::NativeSuccess;
+
+			if (_core == nullptr || _core->Task() == NULL) {
+				status = Native::NativeErrorNotAttached;
+			}
+			else if ((SampleFormat)_core->Config().format != format
+				|| _core->Config().digital != digital) {
+				status = Native::NativeErrorUnsupportedFormat;
+			}
+			else if (data == nullptr || samplesPerChannel <= 0 || bufferSizeInSamples < 0) {
+				status = Native::NativeErrorInvalidArgument;
+			}
+
+			if (status != Native::NativeSuccess) {
+				pin.Dispose();
+				return _Rejected(status);
+			}
+
+			if (cancellationToken.IsCancellationRequested) {
+				pin.Dispose();
+				return Task::FromCanceled<AsyncReadResult>(cancellationToken);
+			}
+
+			PendingRead^ read = gcnew PendingRead();
+			read->Reader = this;
+			read->Completion = gcnew TaskCompletionSource<AsyncReadResult>(
+				TaskCreationOptions::RunContinuationsAsynchronously);
+			read->Pin = pin;
+			read->Token = cancellationToken;
+
+			// Registered before the submit: the read may complete inside it.
+			Monitor::Enter(_pending);
+			try {
+				read->Tag = ++_nextTag;
+				_pending->Add(read->Tag, read);
+			}
+			finally {
+				Monitor::Exit(_pending);
+			}
+
+			Native::AsyncReadRequest request;
+			request.data = data;
+			request.bufferSizeInSamples = (uInt32)bufferSizeInSamples;
+			request.samplesPerChannel = (uInt32)samplesPerChannel;
+			request.tag = read->Tag;
+
+			status = _core->Submit(request);
+
+			if (status != Native::NativeSuccess) {
+				_Take(read->Tag);
+				pin.Dispose();
+				return _Rejected(status);
+			}
+
+			if (cancellationToken.CanBeCanceled) {
+				read->Registration = cancellationToken.Register(
+					gcnew Action(read, &PendingRead::Cancel));
+
+				// Completed before the registration existed.
+				if (read->Completion->Task->IsCompleted) {
+					read->Registration.Unregister();
+				}
+			}
+			return read->Completion->Task;
+		}
+
+		void AsyncReader::_OnCompleted(IntPtr context, UInt64 tag, int status,
+			int sampsPerChanRead) {
+
+			PendingRead^ read = _Take(tag);
+
+			if (read == nullptr) {
+				return;
+			}
+
+			read->Pin.Dispose();
+			read->Registration.Unregister();
+
+			if (status == Native::NativeErrorCancelled) {
+				read->Completion->TrySetCanceled(read->Token);
+				return;
+			}
+
+			AsyncReadResult result;
+			result.Status = status;
+			result.SamplesPerChannelRead = sampsPerChanRead;
+			read->Completion->TrySetResult(result);
+		}
+
+		AsyncReader::PendingRead^ AsyncReader::_Take(UInt64 tag) {
+
+			PendingRead^ read = nullptr;
+
+			Monitor::Enter(_pending);
+			try {
+				if (_pending->TryGetValue(tag, read)) {
+					_pending->Remove(tag);
+				}
+			}
+			finally {
+				Monitor::Exit(_pending);
+			}
+			return read;
+		}
+
+		Task<AsyncReadResult>^ AsyncReader::_Rejected(int status) {
+
+			AsyncReadResult result;
+			result.Status = status;
+			result.SamplesPerChannelRead = 0;
+			return Task::FromResult(result);
+		}
+	}
+}
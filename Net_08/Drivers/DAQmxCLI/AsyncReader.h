@@ -0,0 +1,230 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::Runtime::InteropServices;
+using namespace System::Threading;
+using namespace System::Threading::Tasks;
+
+#include "DAQmxCLIWrapper.h"
+#include "AcquisitionEngine.h"
+#include "Native/AsyncReaderCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Outcome of an asynchronous read.
+		*/
+		public value struct AsyncReadResult
+		{
+			/** Status of the DAQmx read, or the native error that kept it
+			*   from being issued. */
+			int Status;
+
+			int SamplesPerChannelRead;
+		};
+
+		/**
+		* @brief Settings of an `AsyncReader`.
+		*/
+		public ref class AsyncReaderConfiguration
+		{
+		public:
+			AsyncReaderConfiguration();
+
+			/** Number of channels in the task. */
+			property int Channels;
+
+			/** Sample format of the reads. */
+			property SampleFormat Format;
+
+			/** Read `UInt32` / `UInt16` with `DAQmxReadDigitalU32` /
+			*   `DAQmxReadDigitalU16` instead of the binary reads. */
+			property bool Digital;
+
+			/** Layout of the samples in the destination buffers. */
+			property ReadbacklFillMode FillMode;
+
+			/** N of the EveryNSamples event that completes the reads; a read
+			*   completes at most N samples after its last sample arrived.
+			*   `0` leaves the event alone and polls the task instead, e.g.
+			*   when an `AcquisitionEngine` or a callback already uses it. */
+			property int NotifySamples;
+
+			/** Polling interval while reads are pending, in microseconds, when
+			*   `NotifySamples` is `0`. */
+			property int PollIntervalUs;
+
+			/** Reads that may be pending at the same time. */
+			property int MaxPendingReads;
+
+		internal:
+			Native::AsyncReaderConfig ToNative();
+		};
+
+		[UnmanagedFunctionPointer(CallingConvention::Cdecl)]
+		delegate void AsyncReadCompletedDelegate(IntPtr context, UInt64 tag,
+			int status, int sampsPerChanRead);
+
+		/**
+		* @brief Awaitable reads that complete in native code once their samples
+		*        are in the buffer.
+		*
+		* Each `Read...Async` call queues a read of N samples per channel and
+		* returns a task at once; no thread waits for it. The reader checks the
+		* task whenever the driver's native EveryNSamples callback fires (or, with
+		* `NotifySamples = 0`, when one poller thread shared by all readers
+		* visits it) and issues the DAQmx read only once all samples are there,
+		* straight into the pinned destination. Reads complete in the order they
+		* were queued. Continuations run on the thread pool, never on the driver
+		* thread.
+		*
+		* The returned task gives the DAQmx status; it is cancelled when the
+		* `CancellationToken` fires before the samples arrived (use a
+		* `CancellationTokenSource` with a delay as timeout) and when the reader
+		* is detached. The destination memory stays pinned until the read
+		* completes.
+		*
+		* While attached, the reader is kept alive by its native callback;
+		* call `Detach` or dispose of it when done.
+		*/
+		public ref class AsyncReader
+		{
+		private:
+			ref class PendingRead
+			{
+			public:
+				AsyncReader^ Reader;
+				UInt64 Tag;
+				TaskCompletionSource<AsyncReadResult>^ Completion;
+				System::Buffers::MemoryHandle Pin;
+				CancellationToken Token;
+				CancellationTokenRegistration Registration;
+
+				void Cancel();
+			};
+
+			Native::AsyncReaderCore* _core;
+			AsyncReadCompletedDelegate^ _completed;
+			GCHandle _completedHandle;
+			Dictionary<UInt64, PendingRead^>^ _pending;
+			UInt64 _nextTag;
+
+		public:
+			AsyncReader();
+			~AsyncReader();
+			!AsyncReader();
+
+			/**
+			* @brief Attaches the reader to a configured task. The task may
+			*        already be running.
+			*
+			* @return `0` on success, a negative status code otherwise.
+			*/
+			int Attach(IntPtr taskHandle, AsyncReaderConfiguration^ configuration);
+
+			/**
+			* @brief Stops watching the task and cancels every pending read.
+			*        The task keeps running.
+			*/
+			int Detach();
+
+			/**
+			* @brief Reads `samplesPerChannel` samples per channel into `data`,
+			*        which must be large enough for all channels.
+			*
+			* The configured `Format` must be `Float64`.
+			*/
+			Task<AsyncReadResult>^ ReadAnalogF64Async(Memory<double> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/** Same as `ReadAnalogF64Async` for `Int16`. */
+			Task<AsyncReadResult>^ ReadBinaryI16Async(Memory<Int16> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/** Same as `ReadAnalogF64Async` for `UInt16`. */
+			Task<AsyncReadResult>^ ReadBinaryUI16Async(Memory<UInt16> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/** Same as `ReadAnalogF64Async` for `Int32`. */
+			Task<AsyncReadResult>^ ReadBinaryI32Async(Memory<Int32> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/** Same as `ReadAnalogF64Async` for `UInt32`. */
+			Task<AsyncReadResult>^ ReadBinaryUI32Async(Memory<UInt32> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/** Same as `ReadAnalogF64Async` for `UInt32` with `Digital` set. */
+			Task<AsyncReadResult>^ ReadDigitU32Async(Memory<UInt32> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/** Same as `ReadAnalogF64Async` for `UInt16` with `Digital` set. */
+			Task<AsyncReadResult>^ ReadDigitU16Async(Memory<UInt16> data,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/**
+			* @brief Reads in the configured format into native memory, e.g. a
+			*        buffer rented from a `PinnedBufferPool`.
+			*
+			* @param[in] data Destination; must stay valid until the task completes.
+			* @param[in] bufferSizeInSamples Capacity of `data`, in samples.
+			*/
+			Task<AsyncReadResult>^ ReadAsync(IntPtr data, int bufferSizeInSamples,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			/**
+			* @brief Cancels every pending read.
+			*/
+			void CancelAll();
+
+			property int PendingReads {
+				int get();
+			}
+
+			property UInt64 ReadsCompleted {
+				UInt64 get();
+			}
+
+			property UInt64 ReadsFailed {
+				UInt64 get();
+			}
+
+			property UInt64 ReadsCancelled {
+				UInt64 get();
+			}
+
+		private:
+			Task<AsyncReadResult>^ _Submit(SampleFormat format, bool digital,
+				void* data, int bufferSizeInSamples, System::Buffers::MemoryHandle pin,
+				int samplesPerChannel, CancellationToken cancellationToken);
+
+			void _OnCompleted(IntPtr context, UInt64 tag, int status, int sampsPerChanRead);
+
+			PendingRead^ _Take(UInt64 tag);
+
+			static Task<AsyncReadResult>^ _Rejected(int status);
+		};
+	}
+}
@@ -0,0 +1,200 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BlockStatistics.h"
+#include "AcquisitionEngine.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		BlockStatistics::BlockStatistics() {
+			_core = new Native::BlockStatisticsCore();
+		}
+
+		BlockStatistics::~BlockStatistics() {
+			this->!BlockStatistics();
+		}
+
+		BlockStatistics::!BlockStatistics() {
+
+			// The engine must stop calling the core before it goes.
+			if (_engine != nullptr) {
+				_engine->_ReleaseStage();
+			}
+
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int BlockStatistics::Configure(int channels) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channels <= 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			int result = _core->Configure((uInt32)channels);
+
+			// A scaler for a different channel count no longer applies.
+			if (_scaler != nullptr && _core->SetScaling(_scaler->_GetCore()) != Native::NativeSuccess) {
+				_core->SetScaling(nullptr);
+				_scaler = nullptr;
+			}
+			return result;
+		}
+
+		int BlockStatistics::SetScaling(RawScaler^ scaler) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			int result = _core->SetScaling((scaler != nullptr) ? scaler->_GetCore() : nullptr);
+
+			if (result == Native::NativeSuccess) {
+				_scaler = scaler;
+			}
+			return result;
+		}
+
+		void BlockStatistics::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		int BlockStatistics::Channels::get() {
+			return (_core != nullptr) ? (int)_core->Channels() : 0;
+		}
+
+		UInt64 BlockStatistics::Blocks::get() {
+
+			uInt64 blocks = 0;
+			if (_core != nullptr) {
+				_core->GetStatistics(nullptr, nullptr, 0, blocks);
+			}
+			return blocks;
+		}
+
+		int BlockStatistics::_Accumulate(Array^ data, const void* samples,
+			Native::SampleFormat format, int samplesPerChannel, ReadbacklFillMode fillMode) {
+
+			if ((Int64)data->Length < (Int64)_core->Channels() * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			return _core->Accumulate(samples, format, (uInt32)samplesPerChannel,
+				(int32)fillMode);
+		}
+
+		int BlockStatistics::Accumulate(array<double>^ data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (data == nullptr || data->Length == 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<double> dataPtr = &data[0];
+			return _Accumulate(data, dataPtr, Native::SampleFormat::Float64,
+				samplesPerChannel, fillMode);
+		}
+
+		int BlockStatistics::Accumulate(array<Int16>^ data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (data == nullptr || data->Length == 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<Int16> dataPtr = &data[0];
+			return _Accumulate(data, dataPtr, Native::SampleFormat::Int16,
+				samplesPerChannel, fillMode);
+		}
+
+		int BlockStatistics::GetLastBlock(array<ChannelStatistics>^ statistics) {
+
+			UInt64 blocks;
+			return GetStatistics(statistics, nullptr, blocks);
+		}
+
+		int BlockStatistics::GetTotal(array<ChannelStatistics>^ statistics) {
+
+			UInt64 blocks;
+			return GetStatistics(nullptr, statistics, blocks);
+		}
+
+		int BlockStatistics::GetStatistics(array<ChannelStatistics>^ lastBlock,
+			array<ChannelStatistics>^ total, [Out] UInt64% blocks) {
+
+			blocks = 0;
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if ((lastBlock == nullptr || lastBlock->Length == 0)
+				&& (total == nullptr || total->Length == 0)) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			// Both arrays get the same number of channels.
+			uInt32 capacity = (uInt32)Int32::MaxValue;
+			if (lastBlock != nullptr) {
+				capacity = Math::Min(capacity, (uInt32)lastBlock->Length);
+			}
+			if (total != nullptr) {
+				capacity = Math::Min(capacity, (uInt32)total->Length);
+			}
+			if (capacity == 0) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			// ChannelStatistics has the layout of the native struct.
+			pin_ptr<ChannelStatistics> lastPtr = (lastBlock != nullptr) ? &lastBlock[0] : nullptr;
+			pin_ptr<ChannelStatistics> totalPtr = (total != nullptr) ? &total[0] : nullptr;
+			uInt64 count = 0;
+
+			int result = _core->GetStatistics(
+				reinterpret_cast<Native::ChannelStatistics*>(static_cast<ChannelStatistics*>(lastPtr)),
+				reinterpret_cast<Native::ChannelStatistics*>(static_cast<ChannelStatistics*>(totalPtr)),
+				capacity, count);
+
+			blocks = count;
+			return result;
+		}
+
+		Native::BlockStatisticsCore* BlockStatistics::_GetCore() {
+			return _core;
+		}
+	}
+}
@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "RawScaler.h"
+#include "Native/BlockStatisticsCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		ref class AcquisitionEngine;
+
+		/**
+		* @brief Statistics of one channel. `Mean`, `Rms`, `Variance`, `Min`
+		*        and `Max` are NaN when `Count` is 0.
+		*/
+		[StructLayout(LayoutKind::Sequential)]
+		public value struct ChannelStatistics
+		{
+			UInt64 Count;
+			double Sum;
+			double Min;
+			double Max;
+			double Mean;
+			double Rms;
+			/** Population variance. */
+			double Variance;
+		};
+
+		/**
+		* @brief Native per-block statistics: count, sum, minimum, maximum,
+		*        mean, RMS and variance of every channel, for the last block
+		*        and since the last reset.
+		*
+		* Replaces per-sample integration in managed code. Feed it blocks of
+		* `ReadAnalogF64` or `ReadBinaryI16` data, or give it to
+		* `AcquisitionEngine::SetStatistics` to update it on the driver thread
+		* for every block. The results can be read from any thread at any
+		* time without locks and without allocating.
+		*
+		* Methods return `0` on success or a status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class BlockStatistics
+		{
+		private:
+			Native::BlockStatisticsCore* _core;
+			RawScaler^ _scaler;
+
+		public:
+			BlockStatistics();
+			~BlockStatistics();
+			!BlockStatistics();
+
+			/**
+			* @brief Allocates the accumulators for `channels` channels.
+			*/
+			int Configure(int channels);
+
+			/**
+			* @brief Reports I16 blocks in engineering units using the offset
+			*        and gain of `scaler`; `nullptr` reports raw codes.
+			*/
+			int SetScaling(RawScaler^ scaler);
+
+			/**
+			* @brief Clears the running statistics.
+			*/
+			void Reset();
+
+			property int Channels {
+				int get();
+			}
+
+			/**
+			* @brief Blocks accumulated since the last reset.
+			*/
+			property UInt64 Blocks {
+				UInt64 get();
+			}
+
+			/**
+			* @brief Adds one block of F64 samples.
+			*/
+			int Accumulate(array<double>^ data, int samplesPerChannel,
+				ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Adds one block of raw I16 codes.
+			*/
+			int Accumulate(array<Int16>^ data, int samplesPerChannel,
+				ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Copies the statistics of the last block into `statistics`,
+			*        one entry per channel.
+			*
+			* @return The number of channels written, or a negative status code.
+			*/
+			int GetLastBlock(array<ChannelStatistics>^ statistics);
+
+			/**
+			* @brief Copies the statistics since the last reset into
+			*        `statistics`, one entry per channel.
+			*
+			* @return The number of channels written, or a negative status code.
+			*/
+			int GetTotal(array<ChannelStatistics>^ statistics);
+
+			/**
+			* @brief Copies both from the same block.
+			*/
+			int GetStatistics(array<ChannelStatistics>^ lastBlock,
+				array<ChannelStatistics>^ total, [Out] UInt64% blocks);
+
+		internal:
+			Native::BlockStatisticsCore* _GetCore();
+
+			/** The engine running this stage, if any; see `AcquisitionEngine::_ReleaseStage`. */
+			AcquisitionEngine^ _engine;
+
+		private:
+			int _Accumulate(Array^ data, const void* samples, Native::SampleFormat format,
+				int samplesPerChannel, ReadbacklFillMode fillMode);
+		};
+	}
+}
@@ -18,35 +18,101 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE S
 OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+
 #pragma once
 #include "CallbackHandle.h"
+#include "CallbackService.h"
+#include "Native/HostClock.h"
+#include "Native/NativeStatus.h"
 
 namespace Grumpy {
 
 	namespace DAQmxNetApi {
 
 
+		CallbackConsumer::CallbackConsumer(DAQmxDoneCallbackDelegate^ doneDelegate,
+			DAQmxEveryNSamplesCallbackDelegate^ everyNSamplesDelegate,
+			DAQmxSignalCallbackDelegate^ signalDelegate,
+			DAQmxCallbackBatchDelegate^ batchDelegate, Object^ data) {
+
+			DoneDelegate = doneDelegate;
+			EveryNSamplesDelegate = everyNSamplesDelegate;
+			SignalDelegate = signalDelegate;
+			BatchDelegate = batchDelegate;
+			Data = data;
+
+			// The legacy delegates get the data as a GCHandle, as they did
+			// when DAQmx called them directly; the batch delegate gets the
+			// object itself.
+			if (data != nullptr && batchDelegate == nullptr) {
+				_dataHandle = GCHandle::Alloc(data);
+			}
+		}
+
+		CallbackConsumer::~CallbackConsumer() {
+			this->!CallbackConsumer();
+		}
+
+		// Left to the collector when a delivery replaced or unregistered its
+		// own handle: nothing references the consumer once it returns.
+		CallbackConsumer::!CallbackConsumer() {
+			Free();
+		}
+
+		IntPtr CallbackConsumer::CallbackData() {
+			return _dataHandle.IsAllocated ? GCHandle::ToIntPtr(_dataHandle) : IntPtr::Zero;
+		}
+
+		void CallbackConsumer::Free() {
+
+			if (_dataHandle.IsAllocated) {
+				_dataHandle.Free();
+			}
+		}
+
+
 		CallbackHandle::CallbackHandle(IntPtr taskHandle, DAQmxDoneCallbackDelegate^ del,
 			DAQmxEveryNSamplesCallbackDelegate^ evryNSamplesDel,
+			DAQmxCallbackBatchDelegate^ batchDel,
 			EventType evetType, Object^ data, int nSamples) {
 
 			_taskHandle = taskHandle;
-			_managedDoneDelegate = del;
-			_managedEveryNSamplesDelegate = evryNSamplesDel;
-
-			_managedDataPointer = data;
 			_nSamples = nSamples;
-
+			_signal = 0;
 			_eventType = evetType;
+			_lastError = String::Empty;
 
+			_Register(gcnew CallbackConsumer(del, evryNSamplesDel, nullptr, batchDel, data));
+		}
+
+
+		CallbackHandle::CallbackHandle(IntPtr taskHandle, ExportableSignal signal,
+			DAQmxSignalCallbackDelegate^ del, DAQmxCallbackBatchDelegate^ batchDel,
+			Object^ data) {
+
+			_taskHandle = taskHandle;
+			_nSamples = 0;
+			_signal = (int)signal;
+			_eventType = EventType::Signal;
 			_lastError = String::Empty;
 
+			_Register(gcnew CallbackConsumer(nullptr, nullptr, del, batchDel, data));
+		}
+
+
+		void CallbackHandle::_Register(CallbackConsumer^ consumer) {
+
 			try {
-				_gcCallbackHandle = GCHandle::Alloc(_managedDoneDelegate);
-				if (data != nullptr) {
-					_managedDataPointer = data;
-					_gcDataHandle = GCHandle::Alloc(_managedDataPointer);
+				_consumer = consumer;
+
+				if (CallbackService::_LatencyTracking()) {
+					_latency = gcnew CallbackLatency();
+					if (!_latency->_IsValid()) {
+						delete _latency;
+						_latency = nullptr;
+					}
 				}
+
 				int r = -1;
 				switch (_eventType)
 				{
@@ -59,6 +125,9 @@ namespace Grumpy {
 				case EventType::EveryNSamplesTransferred:
 					r = _RegisterEveryNSamplesEvent(false);
 					break;
+				case EventType::Signal:
+					r = _RegisterSignalEvent();
+					break;
 				default:
 					break;
 				}
@@ -81,27 +150,96 @@ namespace Grumpy {
 
 
 		CallbackHandle::~CallbackHandle() {
-			_FreeResources();
+			Unregister();
 		}
 
 		bool CallbackHandle::IsRegistered() {
 			return _registered;
 		}
 
+		CallbackLatency^ CallbackHandle::Latency::get() {
+			return _latency;
+		}
 
-		int CallbackHandle::_RegisterDoneEvent() {
+		String^ CallbackHandle::LastError::get() {
+			return _lastError;
+		}
+
+
+		int CallbackHandle::Unregister() {
+
+			int r = 0;
+
+			if (_registered) {
+				r = CallbackService::_Unregister(this, _taskHandle, _eventType, _signal, _key);
+				_registered = false;
+			}
+			_FreeResources();
+			return r;
+		}
+
+
+		int CallbackHandle::Replace(DAQmxDoneCallbackDelegate^ del, Object^ data) {
+
+			if (del == nullptr || _eventType != EventType::Done) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			return _Replace(gcnew CallbackConsumer(del, nullptr, nullptr, nullptr, data));
+		}
+
+		int CallbackHandle::Replace(DAQmxEveryNSamplesCallbackDelegate^ del, Object^ data) {
+
+			if (del == nullptr || _eventType == EventType::Done
+				|| _eventType == EventType::Signal) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			return _Replace(gcnew CallbackConsumer(nullptr, del, nullptr, nullptr, data));
+		}
+
+		int CallbackHandle::Replace(DAQmxSignalCallbackDelegate^ del, Object^ data) {
+
+			if (del == nullptr || _eventType != EventType::Signal) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			return _Replace(gcnew CallbackConsumer(nullptr, nullptr, del, nullptr, data));
+		}
+
+		int CallbackHandle::Replace(DAQmxCallbackBatchDelegate^ del, Object^ data) {
+
+			if (del == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			return _Replace(gcnew CallbackConsumer(nullptr, nullptr, nullptr, del, data));
+		}
+
+
+		int CallbackHandle::_Replace(CallbackConsumer^ consumer) {
 
 			if (!_registered) {
+				delete consumer;
+				return Native::NativeErrorInvalidState;
+			}
 
-				int r = 0;
+			CallbackConsumer^ previous =
+				Threading::Interlocked::Exchange<CallbackConsumer^>(_consumer, consumer);
+
+			// A delivery may still hold the previous consumer.
+			if (previous != nullptr && CallbackService::_Quiesce()) {
+				previous->Free();
+			}
+			return 0;
+		}
 
-				r = DAQmxRegisterDoneEvent((TaskHandle)_taskHandle,
-					0,
-					static_cast<DAQmxDoneEventCallbackPtr>(_GetFunctionPointer()),
-					_managedDataPointer != nullptr ?
-					GCHandle::ToIntPtr(_gcDataHandle).ToPointer() :
-					NULL);
 
+		int CallbackHandle::_RegisterDoneEvent() {
+
+			if (!_registered) {
+
+				if (_consumer->DoneDelegate == nullptr && _consumer->BatchDelegate == nullptr) {
+					return Native::NativeErrorInvalidArgument;
+				}
+
+				int r = CallbackService::_RegisterDoneEvent(this, _taskHandle, _key);
 
 				if (r != 0)
 				{
@@ -119,18 +257,35 @@ namespace Grumpy {
 
 			if (!_registered) {
 
-				int r = 0;
+				if (_consumer->EveryNSamplesDelegate == nullptr
+					&& _consumer->BatchDelegate == nullptr) {
+					return Native::NativeErrorInvalidArgument;
+				}
 
-				r = DAQmxRegisterEveryNSamplesEvent(
-					(TaskHandle)_taskHandle,
+				int r = CallbackService::_RegisterEveryNSamplesEvent(this, _taskHandle,
 					read ? DAQmx_Val_Acquired_Into_Buffer : DAQmx_Val_Transferred_From_Buffer,
-					_nSamples,
-					0,
-					static_cast<DAQmxEveryNSamplesEventCallbackPtr>(_GetFunctionPointer()),
-					_managedDataPointer != nullptr ?
-					GCHandle::ToIntPtr(_gcDataHandle).ToPointer() :
-					NULL);
+					_nSamples, _key);
 
+				if (r != 0) {
+					_FreeResources();
+				}
+				_registered = (r == 0);
+				return r;
+			}
+
+			return 0;
+		}
+
+
+		int CallbackHandle::_RegisterSignalEvent() {
+
+			if (!_registered) {
+
+				if (_consumer->SignalDelegate == nullptr && _consumer->BatchDelegate == nullptr) {
+					return Native::NativeErrorInvalidArgument;
+				}
+
+				int r = CallbackService::_RegisterSignalEvent(this, _taskHandle, _signal, _key);
 
 				if (r != 0) {
 					_FreeResources();
@@ -143,37 +298,115 @@ namespace Grumpy {
 		}
 
 
-		void* CallbackHandle::_GetFunctionPointer()
-		{
-			if ((_eventType == EventType::Done && _managedDoneDelegate == nullptr)
-				|| (_eventType != EventType::Done && _managedEveryNSamplesDelegate == nullptr)) {
-				return NULL;
+		void CallbackHandle::_Deliver(const Native::CallbackEvent* events, int count) {
+
+			// One consumer for the whole batch; it may be replaced from
+			// another thread meanwhile.
+			CallbackConsumer^ consumer = _consumer;
+			CallbackLatency^ latency = _latency;
+
+			if (consumer == nullptr) {
+				return;
 			}
 
-			if (_eventType == EventType::Done)
-			{
-				return Marshal::GetFunctionPointerForDelegate(_managedDoneDelegate).ToPointer();
+			// Before the events are converted: that is part of the
+			// transition.
+			Int64 calledNs = (latency != nullptr) ? Native::HostMonotonicNs() : 0;
+
+			try {
+				if (consumer->BatchDelegate != nullptr) {
+
+					// Only the dispatch thread of the task uses the array.
+					if (_batch == nullptr || _batch->Length < count) {
+						_batch = gcnew array<CallbackEvent>(
+							Math::Max(count, (int)CallbackService::_MaxBatch()));
+					}
+
+					for (int k = 0; k < count; k++) {
+						_batch[k].TaskHandle = IntPtr(events[k].task);
+						_batch[k].Type = (events[k].kind == Native::CallbackEventKind::Done)
+							? EventType::Done : _eventType;
+						_batch[k].Status = events[k].status;
+						_batch[k].NSamples = events[k].nSamples;
+						_batch[k].Signal = (events[k].kind == Native::CallbackEventKind::Signal)
+							? (ExportableSignal)events[k].eventType : (ExportableSignal)0;
+						_batch[k].HostTimeNs = events[k].timeNs;
+					}
+
+					consumer->BatchDelegate(_taskHandle, _batch, count, consumer->Data);
+
+					if (latency != nullptr) {
+						latency->_Record(events, count, calledNs, Native::HostMonotonicNs());
+					}
+					return;
+				}
+
+				IntPtr callbackData = consumer->CallbackData();
+
+				for (int k = 0; k < count; k++) {
+
+					// Replaced or unregistered by the previous call.
+					if (_consumer != consumer) {
+						break;
+					}
+
+					if (latency != nullptr && k > 0) {
+						calledNs = Native::HostMonotonicNs();
+					}
+
+					if (events[k].kind == Native::CallbackEventKind::Done) {
+						if (consumer->DoneDelegate != nullptr) {
+							consumer->DoneDelegate(_taskHandle, events[k].status, callbackData);
+						}
+					}
+					else if (events[k].kind == Native::CallbackEventKind::Signal) {
+						if (consumer->SignalDelegate != nullptr) {
+							consumer->SignalDelegate(_taskHandle, events[k].eventType, callbackData);
+						}
+					}
+					else if (consumer->EveryNSamplesDelegate != nullptr) {
+						consumer->EveryNSamplesDelegate(_taskHandle, events[k].eventType,
+							events[k].nSamples, callbackData);
+					}
+
+					if (latency != nullptr) {
+						latency->_Record(events + k, 1, calledNs, Native::HostMonotonicNs());
+					}
+				}
 			}
-			else
-			{
-				return Marshal::GetFunctionPointerForDelegate(_managedEveryNSamplesDelegate).ToPointer();
+			catch (Exception^ ex) {
+				// Nothing may reach the dispatch thread.
+				_lastError = ex->Message;
 			}
+		}
+
 
+		Native::CallbackKey CallbackHandle::_Key() {
+			return _key;
 		}
 
 
-		void CallbackHandle::_FreeResources() {
-			_managedDoneDelegate = nullptr;
-			_managedDoneDelegate = nullptr;
-			_lastError = nullptr;
+		String^ CallbackHandle::_Describe() {
 
-			if (_gcCallbackHandle.IsAllocated) {
-				_gcCallbackHandle.Free();
+			if (_eventType == EventType::Signal) {
+				return String::Format("Task 0x{0:X}, {1} {2}", _taskHandle.ToInt64(),
+					_eventType, (ExportableSignal)_signal);
 			}
-			if (_gcDataHandle.IsAllocated) {
-				_gcDataHandle.Free();
+			return String::Format("Task 0x{0:X}, {1}", _taskHandle.ToInt64(), _eventType);
+		}
+
+
+		void CallbackHandle::_FreeResources() {
+
+			// Registration failed, or the handle was unregistered: no
+			// delivery starts any more. Without waiting (from a delivery),
+			// the finalizer of the consumer frees its data.
+			CallbackConsumer^ consumer =
+				Threading::Interlocked::Exchange<CallbackConsumer^>(_consumer, nullptr);
+
+			if (consumer != nullptr && CallbackService::_Quiesce()) {
+				consumer->Free();
 			}
-			GC::Collect();
 		}
 	}
 }
@@ -18,11 +18,14 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE S
 OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+
 #pragma once
 using namespace System;
 using namespace System::Runtime::InteropServices;
 
+#include "CallbackLatency.h"
 #include "DAQmxCLIWrapper.h"
+#include "Native/CallbackDispatcherCore.h"
 
 namespace Grumpy {
 
@@ -33,18 +36,94 @@ namespace Grumpy {
 		public delegate int32 DAQmxEveryNSamplesCallbackDelegate(
 			IntPtr taskHandle, int32 eventType, UInt32 nSamples, 
 			IntPtr% callbackData);
+		public delegate int32 DAQmxSignalCallbackDelegate(IntPtr taskHandle,
+			int32 signalID, IntPtr% callbackData);
+
+		/**
+		* @brief One driver event, as passed to a `DAQmxCallbackBatchDelegate`.
+		*/
+		public value struct CallbackEvent
+		{
+			IntPtr TaskHandle;
+
+			EventType Type;
+
+			/** Status of a Done event; `0` for other events. */
+			int Status;
+
+			UInt32 NSamples;
+
+			/** The signal of a Signal event. */
+			ExportableSignal Signal;
+
+			/** Host monotonic time, in nanoseconds of the `Stopwatch` time
+			*   base, at which the driver raised the event. */
+			Int64 HostTimeNs;
+		};
+
+		/**
+		* @brief Receives the events of one registration that the dispatcher
+		*        took together, oldest first.
+		*
+		* `events` holds `count` events and is reused once the call returns.
+		*/
+		public delegate void DAQmxCallbackBatchDelegate(IntPtr taskHandle,
+			array<CallbackEvent>^ events, int count, Object^ data);
+
+		/**
+		* @brief The delegates and the data that receive the events of a
+		*        `CallbackHandle`; replaced as a whole.
+		*/
+		ref class CallbackConsumer
+		{
+		public:
+			CallbackConsumer(DAQmxDoneCallbackDelegate^ doneDelegate,
+				DAQmxEveryNSamplesCallbackDelegate^ everyNSamplesDelegate,
+				DAQmxSignalCallbackDelegate^ signalDelegate,
+				DAQmxCallbackBatchDelegate^ batchDelegate, Object^ data);
+
+			~CallbackConsumer();
+			!CallbackConsumer();
+
+			DAQmxDoneCallbackDelegate^ DoneDelegate;
+			DAQmxEveryNSamplesCallbackDelegate^ EveryNSamplesDelegate;
+			DAQmxSignalCallbackDelegate^ SignalDelegate;
+			DAQmxCallbackBatchDelegate^ BatchDelegate;
+			Object^ Data;
 
+			/** The data as the legacy delegates get it. */
+			IntPtr CallbackData();
+
+			/** Frees the GCHandle of the data; only once no delivery uses
+			*   it any more. */
+			void Free();
+
+		private:
+			GCHandle _dataHandle;
+		};
+
+		/**
+		* @brief A registration of a DAQmx event made by `CallbackService`.
+		*
+		* DAQmx calls a native trampoline that only queues the event; the
+		* delegates run on a dispatch thread of `CallbackService`.
+		*
+		* `Unregister`, or disposing of the handle, unregisters the event
+		* from DAQmx and returns once no callback of the handle is in flight.
+		* `Replace` swaps the delegates while the task runs, without
+		* touching the driver registration.
+		*/
 		public ref class CallbackHandle
 		{
 		private:
 			bool _registered;
 			IntPtr _taskHandle;
-			DAQmxDoneCallbackDelegate^ _managedDoneDelegate;
-			DAQmxEveryNSamplesCallbackDelegate^ _managedEveryNSamplesDelegate;
-			Object^ _managedDataPointer;
-			GCHandle _gcCallbackHandle;
-			GCHandle _gcDataHandle;
+			Native::CallbackKey _key;
+			CallbackConsumer^ _consumer;
+			CallbackLatency^ _latency;
+			array<CallbackEvent>^ _batch;
 			int _nSamples;
+			int _signal;
 			EventType _eventType;
 			String^ _lastError;
 
@@ -52,24 +131,88 @@ namespace Grumpy {
 
 			CallbackHandle(IntPtr taskHandle, DAQmxDoneCallbackDelegate^ del,
 				DAQmxEveryNSamplesCallbackDelegate^ evryNSamplesDel,
+				DAQmxCallbackBatchDelegate^ batchDel,
 				EventType evetType, Object^ data, int nSamples);
+
+			CallbackHandle(IntPtr taskHandle, ExportableSignal signal,
+				DAQmxSignalCallbackDelegate^ del, DAQmxCallbackBatchDelegate^ batchDel,
+				Object^ data);
+
+			/**
+			* @brief Calls the delegates for `count` events of this handle; on
+			*        a dispatch thread.
+			*/
+			void _Deliver(const Native::CallbackEvent* events, int count);
+
+			/** Key of the registration in the dispatcher. */
+			Native::CallbackKey _Key();
+
+			/** The task and the event, for reports. */
+			String^ _Describe();
+
 		public:
 			~CallbackHandle();
 
 		public:
 			inline bool IsRegistered();
 
+			/**
+			* @brief Unregisters the event from DAQmx and stops the delivery.
+			*
+			* Returns once the delegates are no longer running on another
+			* thread; called from one of them, the data of the handle is
+			* released by the garbage collector instead.
+			*
+			* @return `0`, or the error of the DAQmx unregistration; the
+			*         delivery stops either way.
+			*/
+			int Unregister();
+
+			/**
+			* @brief Delivers the next events to `del` and `data`.
+			*
+			* Returns once the previous delegates are no longer running on
+			* another thread.
+			*
+			* @return `0`, `NativeErrorInvalidState` if the handle is not
+			*         registered, or `NativeErrorInvalidArgument` for a
+			*         delegate of the other kind of event.
+			*/
+			int Replace(DAQmxDoneCallbackDelegate^ del, Object^ data);
+
+			int Replace(DAQmxEveryNSamplesCallbackDelegate^ del, Object^ data);
+
+			int Replace(DAQmxSignalCallbackDelegate^ del, Object^ data);
+
+			int Replace(DAQmxCallbackBatchDelegate^ del, Object^ data);
+
+			/** Latency of the events of the handle, stage by stage;
+			*   `nullptr` unless `CallbackDispatcherConfiguration::
+			*   LatencyTracking` was on when it was registered. */
+			property CallbackLatency^ Latency {
+				CallbackLatency^ get();
+			}
+
+			/** Message of the last exception thrown by the delegates, or of
+			*   a failed registration. */
+			property String^ LastError {
+				String^ get();
+			}
+
 		protected:
 
 			int _RegisterDoneEvent();
 
 			int _RegisterEveryNSamplesEvent(bool read);
 
-			inline void* _GetFunctionPointer();
+			int _RegisterSignalEvent();
 
 		private:
+			void _Register(CallbackConsumer^ consumer);
+
+			int _Replace(CallbackConsumer^ consumer);
+
 			void _FreeResources();
 		};
 	}
 }
-
@@ -0,0 +1,138 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CallbackLatency.h"
+
+using namespace System::Text;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		CallbackLatency::CallbackLatency() {
+			_core = new Native::CallbackLatencyCore();
+		}
+
+		CallbackLatency::~CallbackLatency() {
+			this->!CallbackLatency();
+		}
+
+		// The handle and its deliveries hold the object while they record,
+		// so the collector frees it only once none does.
+		CallbackLatency::!CallbackLatency() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		bool CallbackLatency::_IsValid() {
+			return _core != nullptr && _core->IsValid();
+		}
+
+		void CallbackLatency::_Record(const Native::CallbackEvent* events, int count,
+			Int64 calledNs, Int64 returnedNs) {
+
+			if (_core != nullptr && count > 0) {
+				_core->Record(events, (uInt32)count, calledNs, returnedNs);
+			}
+		}
+
+		CallbackLatencySummary CallbackLatency::GetSummary(CallbackLatencyStage stage) {
+
+			CallbackLatencySummary summary;
+
+			if (_core == nullptr) {
+				return summary;
+			}
+
+			const Native::LatencySummary s = _core->Summary((Native::CallbackLatencyStage)stage);
+
+			summary.Count = s.count;
+			summary.MinNs = s.minNs;
+			summary.MaxNs = s.maxNs;
+			summary.MeanNs = s.meanNs;
+			summary.P50Ns = s.p50Ns;
+			summary.P90Ns = s.p90Ns;
+			summary.P99Ns = s.p99Ns;
+			summary.P999Ns = s.p999Ns;
+			return summary;
+		}
+
+		Int64 CallbackLatency::ValueAtPercentile(CallbackLatencyStage stage, double percentile) {
+
+			if (_core == nullptr || (int)stage < 0
+				|| (int)stage >= Native::CallbackLatencyStageCount) {
+				return 0;
+			}
+			return _core->Histogram((Native::CallbackLatencyStage)stage).ValueAtPercentile(percentile);
+		}
+
+		int CallbackLatency::GetBuckets(CallbackLatencyStage stage, array<UInt64>^ counts) {
+
+			if (_core == nullptr || counts == nullptr || counts->Length == 0
+				|| (int)stage < 0 || (int)stage >= Native::CallbackLatencyStageCount) {
+				return 0;
+			}
+
+			pin_ptr<UInt64> countsPtr = &counts[0];
+			return (int)_core->Histogram((Native::CallbackLatencyStage)stage)
+				.ReadBuckets(countsPtr, (size_t)counts->Length);
+		}
+
+		int CallbackLatency::BucketCount::get() {
+			return (int)Native::LatencyBucketCount;
+		}
+
+		Int64 CallbackLatency::BucketLowestNs(int bucket) {
+			return Native::LatencyHistogram::BucketLowestNs((uInt32)Math::Max(bucket, 0));
+		}
+
+		Int64 CallbackLatency::BucketHighestNs(int bucket) {
+			return Native::LatencyHistogram::BucketHighestNs((uInt32)Math::Max(bucket, 0));
+		}
+
+		void CallbackLatency::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		String^ CallbackLatency::ToString() {
+
+			StringBuilder^ text = gcnew StringBuilder();
+
+			for (int s = 0; s < Native::CallbackLatencyStageCount; s++) {
+
+				CallbackLatencySummary summary = GetSummary((CallbackLatencyStage)s);
+
+				text->AppendFormat("{0,-10} n {1,8}  p50 {2,9:F1}  p90 {3,9:F1}  p99 {4,9:F1}"
+					"  p99.9 {5,9:F1}  max {6,9:F1} us",
+					((CallbackLatencyStage)s).ToString(), summary.Count,
+					1e-3 * summary.P50Ns, 1e-3 * summary.P90Ns, 1e-3 * summary.P99Ns,
+					1e-3 * summary.P999Ns, 1e-3 * summary.MaxNs);
+				text->AppendLine();
+			}
+			return text->ToString();
+		}
+	}
+}
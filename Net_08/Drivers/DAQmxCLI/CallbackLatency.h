@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "Native/CallbackLatencyCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Stretch of the way of a DAQmx event to its delegate.
+		*/
+		public enum class CallbackLatencyStage {
+			/** Trampoline entry to the queue of the dispatch thread. */
+			Driver = 0,
+			/** Waiting in the queue for the dispatch thread. */
+			Queue = 1,
+			/** Managed transition and fan-out to the handle. */
+			Transition = 2,
+			/** Time spent in the delegate, per call. */
+			Consumer = 3,
+			/** Trampoline entry to the call of the delegate. */
+			EndToEnd = 4
+		};
+
+		/**
+		* @brief Count, extremes and percentiles of one stage, in
+		*        nanoseconds; all `0` when `Count` is 0.
+		*/
+		[StructLayout(LayoutKind::Sequential)]
+		public value struct CallbackLatencySummary
+		{
+			UInt64 Count;
+			Int64 MinNs;
+			Int64 MaxNs;
+			Int64 MeanNs;
+			Int64 P50Ns;
+			Int64 P90Ns;
+			Int64 P99Ns;
+			Int64 P999Ns;
+		};
+
+		/**
+		* @brief Latency histograms of the events of one `CallbackHandle`,
+		*        per `CallbackLatencyStage`.
+		*
+		* Recorded natively on the dispatch thread, around the delegates of
+		* the handle, from the host times the trampoline and the dispatcher
+		* stamp into each event; `CallbackDispatcherConfiguration::
+		* LatencyTracking` turns it on. A late event can thus be put down to
+		* the driver (`Driver`), a busy dispatch thread (`Queue`), the CLR
+		* (`Transition`) or the consumer itself (`Consumer`).
+		*
+		* The histograms keep percentiles to 1/64 of their value and may be
+		* read and reset from any thread while the task runs. They stay
+		* readable after the handle was unregistered.
+		*/
+		public ref class CallbackLatency
+		{
+		private:
+			Native::CallbackLatencyCore* _core;
+
+		internal:
+			CallbackLatency();
+
+			/** `false` if the native histograms could not be allocated. */
+			bool _IsValid();
+
+			/** Records one call of a delegate with `count` events. */
+			void _Record(const Native::CallbackEvent* events, int count,
+				Int64 calledNs, Int64 returnedNs);
+
+		public:
+			~CallbackLatency();
+			!CallbackLatency();
+
+			CallbackLatencySummary GetSummary(CallbackLatencyStage stage);
+
+			/**
+			* @brief The latency of `stage` that `percentile` percent of the
+			*        events do not exceed, in nanoseconds.
+			*
+			* @param[in] percentile 0 to 100.
+			*/
+			Int64 ValueAtPercentile(CallbackLatencyStage stage, double percentile);
+
+			/**
+			* @brief Copies the bucket counts of `stage`; bucket `k` spans
+			*        `BucketLowestNs(k)` to `BucketHighestNs(k)`.
+			*
+			* @return The number of buckets written.
+			*/
+			int GetBuckets(CallbackLatencyStage stage, array<UInt64>^ counts);
+
+			static property int BucketCount {
+				int get();
+			}
+
+			static Int64 BucketLowestNs(int bucket);
+
+			static Int64 BucketHighestNs(int bucket);
+
+			/** Clears every stage. */
+			void Reset();
+
+			/** Count and percentiles of every stage, one line each, in
+			*   microseconds. */
+			String^ ToString() override;
+		};
+	}
+}
@@ -23,19 +23,94 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include "CallbackService.h"
+#include "Native/NativeStatus.h"
 
 using namespace System;
+using namespace System::Threading;
 
 
 namespace Grumpy {
 
 	namespace DAQmxNetApi {
 
+		CallbackThreadConfiguration::CallbackThreadConfiguration(String^ name) {
+
+			Native::ThreadSchedule defaults = Native::DefaultThreadSchedule();
+
+			Name = name;
+			AffinityMask = defaults.affinityMask;
+			Priority = (CallbackThreadPriority)defaults.priority;
+			RealTimePriority = (int)defaults.realTimePriority;
+			BusyPoll = false;
+		}
+
+		Native::CallbackThreadConfig CallbackThreadConfiguration::ToNative() {
+
+			Native::CallbackThreadConfig config;
+
+			config.schedule.affinityMask = AffinityMask;
+			config.schedule.priority = (Native::ThreadPriority)Priority;
+			config.schedule.realTimePriority = RealTimePriority;
+			config.busyPoll = BusyPoll;
+			return config;
+		}
+
+
+		CallbackDispatcherConfiguration::CallbackDispatcherConfiguration() {
+
+			Native::CallbackDispatcherConfig defaults = Native::DefaultCallbackDispatcherConfig();
+
+			Threads = (int)defaults.threads;
+			SharedThreads = gcnew CallbackThreadConfiguration(String::Empty);
+			_dedicatedThreads = gcnew Collections::Generic::List<CallbackThreadConfiguration^>();
+			QueueCapacity = (int)defaults.queueCapacity;
+			MaxBatch = (int)defaults.maxBatch;
+			MaxRegistrations = (int)defaults.maxRegistrations;
+			SignalCapacity = (int)defaults.signalCapacity;
+			LatencyTracking = defaults.stampLatency;
+		}
+
+		Native::CallbackDispatcherConfig CallbackDispatcherConfiguration::ToNative() {
+
+			Native::CallbackDispatcherConfig config = Native::DefaultCallbackDispatcherConfig();
+
+			config.threads = (uInt32)Math::Max(Threads, 0);
+			config.dedicatedThreads = (uInt32)_dedicatedThreads->Count;
+
+			// Too many threads are left for `Start` to refuse.
+			for (uInt32 t = 0; t < Native::CallbackMaxDispatchThreads; t++) {
+
+				if (t < config.threads) {
+					if (SharedThreads != nullptr) {
+						config.thread[t] = SharedThreads->ToNative();
+					}
+				}
+				else if (t - config.threads < config.dedicatedThreads) {
+					CallbackThreadConfiguration^ dedicated = _dedicatedThreads[(int)(t - config.threads)];
+					if (dedicated != nullptr) {
+						config.thread[t] = dedicated->ToNative();
+					}
+				}
+			}
+			config.queueCapacity = (uInt32)Math::Max(QueueCapacity, 0);
+			config.maxBatch = (uInt32)Math::Max(MaxBatch, 0);
+			config.maxRegistrations = (uInt32)Math::Max(MaxRegistrations, 0);
+			config.signalCapacity = (uInt32)Math::Max(SignalCapacity, 0);
+			config.stampLatency = LatencyTracking;
+			return config;
+		}
+
+
+		Collections::Generic::List<CallbackThreadConfiguration^>^
+			CallbackDispatcherConfiguration::DedicatedThreads::get() {
+			return _dedicatedThreads;
+		}
+
 
 		CallbackHandle^ CallbackService::RegisterDoneEvent(IntPtr taskHandle,
 			DAQmxDoneCallbackDelegate^ del, Object^ data) {
 
-			auto r = gcnew CallbackHandle(taskHandle, del, nullptr,
+			auto r = gcnew CallbackHandle(taskHandle, del, nullptr, nullptr,
 				EventType::Done, data, -1);
 
 			return (r->IsRegistered() == true) ? r : nullptr;
@@ -45,7 +120,7 @@ namespace Grumpy {
 			DAQmxEveryNSamplesCallbackDelegate^ del,
 			int nSamples, Object^ data) {
 
-			auto r = gcnew CallbackHandle(taskHandle, nullptr, del,
+			auto r = gcnew CallbackHandle(taskHandle, nullptr, del, nullptr,
 				EventType::EveryNSamplesTransferred, data, nSamples);
 			return (r->IsRegistered() == true) ? r : nullptr;
 		}
@@ -54,10 +129,401 @@ namespace Grumpy {
 			DAQmxEveryNSamplesCallbackDelegate^ del,
 			int nSamples, Object^ data) {
 
-			auto r = gcnew CallbackHandle(taskHandle, nullptr, del,
+			auto r = gcnew CallbackHandle(taskHandle, nullptr, del, nullptr,
 				EventType::EveryNSamplesReceived, data, nSamples);
 			return (r->IsRegistered() == true) ? r : nullptr;
 		}
+
+		CallbackHandle^ CallbackService::RegisterNSamplesWrittenBatch(IntPtr taskHandle,
+			DAQmxCallbackBatchDelegate^ del,
+			int nSamples, Object^ data) {
+
+			auto r = gcnew CallbackHandle(taskHandle, nullptr, nullptr, del,
+				EventType::EveryNSamplesTransferred, data, nSamples);
+			return (r->IsRegistered() == true) ? r : nullptr;
+		}
+
+		CallbackHandle^ CallbackService::RegisterNSamplesReadBatch(IntPtr taskHandle,
+			DAQmxCallbackBatchDelegate^ del,
+			int nSamples, Object^ data) {
+
+			auto r = gcnew CallbackHandle(taskHandle, nullptr, nullptr, del,
+				EventType::EveryNSamplesReceived, data, nSamples);
+			return (r->IsRegistered() == true) ? r : nullptr;
+		}
+
+		CallbackHandle^ CallbackService::RegisterSignalEvent(IntPtr taskHandle,
+			ExportableSignal signal, DAQmxSignalCallbackDelegate^ del, Object^ data) {
+
+			auto r = gcnew CallbackHandle(taskHandle, signal, del, nullptr, data);
+			return (r->IsRegistered() == true) ? r : nullptr;
+		}
+
+		CallbackHandle^ CallbackService::RegisterSignalBatch(IntPtr taskHandle,
+			ExportableSignal signal, DAQmxCallbackBatchDelegate^ del, Object^ data) {
+
+			auto r = gcnew CallbackHandle(taskHandle, signal, nullptr, del, data);
+			return (r->IsRegistered() == true) ? r : nullptr;
+		}
+
+		int CallbackService::ConfigureDispatcher(
+			CallbackDispatcherConfiguration^ configuration) {
+
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Monitor::Enter(_lock);
+			try {
+				if (_dispatcher != nullptr && _dispatcher->IsRunning()) {
+					return Native::NativeErrorAlreadyRunning;
+				}
+				_configuration = configuration;
+				return Native::NativeSuccess;
+			}
+			finally {
+				Monitor::Exit(_lock);
+			}
+		}
+
+		int CallbackService::RouteTask(IntPtr taskHandle, String^ threadName) {
+
+			if (threadName == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			int r = _Start();
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			// Names as in the configuration the dispatcher started with.
+			auto dedicated = _configuration->DedicatedThreads;
+
+			for (int k = 0; k < dedicated->Count; k++) {
+
+				if (dedicated[k] != nullptr && String::Equals(dedicated[k]->Name, threadName,
+					StringComparison::Ordinal)) {
+					return _dispatcher->RouteTask((TaskHandle)taskHandle.ToPointer(),
+						_dispatcher->Config().threads + (uInt32)k);
+				}
+			}
+			return Native::NativeErrorInvalidArgument;
+		}
+
+		int CallbackService::UnrouteTask(IntPtr taskHandle) {
+
+			return (_dispatcher != nullptr)
+				? _dispatcher->UnrouteTask((TaskHandle)taskHandle.ToPointer())
+				: Native::NativeSuccess;
+		}
+
+		String^ CallbackService::LatencyReport(bool reset) {
+
+			Text::StringBuilder^ text = gcnew Text::StringBuilder();
+
+			for (int k = 0; k < _handles->Length; k++) {
+
+				CallbackHandle^ handle = _handles[k];
+				CallbackLatency^ latency = (handle != nullptr) ? handle->Latency : nullptr;
+
+				if (latency == nullptr) {
+					continue;
+				}
+
+				text->AppendLine(handle->_Describe());
+				text->Append(latency->ToString());
+
+				if (reset) {
+					latency->Reset();
+				}
+			}
+			return text->ToString();
+		}
+
+		int CallbackService::StartLatencyReport(int periodMs, IO::TextWriter^ writer, bool reset) {
+
+			if (periodMs <= 0 || writer == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Monitor::Enter(_lock);
+			try {
+				if (_reportTimer != nullptr) {
+					delete _reportTimer;
+				}
+				_reportWriter = IO::TextWriter::Synchronized(writer);
+				_reportReset = reset;
+				_reportTimer = gcnew Threading::Timer(
+					gcnew TimerCallback(&CallbackService::_OnLatencyReport),
+					nullptr, periodMs, periodMs);
+				return Native::NativeSuccess;
+			}
+			finally {
+				Monitor::Exit(_lock);
+			}
+		}
+
+		void CallbackService::StopLatencyReport() {
+
+			Monitor::Enter(_lock);
+			try {
+				if (_reportTimer != nullptr) {
+					delete _reportTimer;
+					_reportTimer = nullptr;
+				}
+				_reportWriter = nullptr;
+			}
+			finally {
+				Monitor::Exit(_lock);
+			}
+		}
+
+		void CallbackService::_OnLatencyReport(Object^ state) {
+
+			IO::TextWriter^ writer = _reportWriter;
+
+			if (writer == nullptr) {
+				return;
+			}
+
+			try {
+				writer->WriteLine("Callback latency at {0:O}", DateTime::Now);
+				writer->Write(LatencyReport(_reportReset));
+				writer->Flush();
+			}
+			catch (Exception^) {
+				// A closed writer must not take the timer thread down; the
+				// next period tries again.
+			}
+		}
+
+		UInt64 CallbackService::EventsReceived::get() {
+			return (_dispatcher != nullptr) ? _dispatcher->Counters().received : 0;
+		}
+
+		UInt64 CallbackService::EventsDelivered::get() {
+			return (_dispatcher != nullptr) ? _dispatcher->Counters().delivered : 0;
+		}
+
+		UInt64 CallbackService::EventBatches::get() {
+			return (_dispatcher != nullptr) ? _dispatcher->Counters().batches : 0;
+		}
+
+		UInt64 CallbackService::EventsDropped::get() {
+			return (_dispatcher != nullptr) ? _dispatcher->Counters().dropped : 0;
+		}
+
+		UInt64 CallbackService::SignalsCoalesced::get() {
+			return (_dispatcher != nullptr) ? _dispatcher->Counters().coalesced : 0;
+		}
+
+		int CallbackService::_RegisterDoneEvent(CallbackHandle^ handle,
+			IntPtr taskHandle, Native::CallbackKey% key) {
+
+			int r = _Start();
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			r = _Add(handle, key);
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			r = _dispatcher->RegisterDoneEvent((TaskHandle)taskHandle.ToPointer(), key);
+
+			if (r != 0) {
+				_Release(handle, key);
+			}
+			return r;
+		}
+
+		int CallbackService::_RegisterEveryNSamplesEvent(CallbackHandle^ handle,
+			IntPtr taskHandle, int eventType, int nSamples, Native::CallbackKey% key) {
+
+			if (nSamples <= 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			int r = _Start();
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			r = _Add(handle, key);
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			r = _dispatcher->RegisterEveryNSamplesEvent((TaskHandle)taskHandle.ToPointer(),
+				eventType, (uInt32)nSamples, key);
+
+			if (r != 0) {
+				_Release(handle, key);
+			}
+			return r;
+		}
+
+		void CallbackService::_Release(CallbackHandle^ handle, Native::CallbackKey key) {
+
+			if (_dispatcher == nullptr) {
+				return;
+			}
+
+			// The slot is cleared while the key is still held, so a new
+			// registration that reuses it is never overwritten.
+			const uInt32 index = Native::CallbackKeyIndex(key);
+
+			if (_handles[index] == handle) {
+				_handles[index] = nullptr;
+			}
+			_dispatcher->Release(key);
+		}
+
+		int CallbackService::_RegisterSignalEvent(CallbackHandle^ handle,
+			IntPtr taskHandle, int signal, Native::CallbackKey% key) {
+
+			int r = _Start();
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			r = _Add(handle, key);
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			r = _dispatcher->RegisterSignalEvent((TaskHandle)taskHandle.ToPointer(), signal, key);
+
+			if (r != 0) {
+				_Release(handle, key);
+			}
+			return r;
+		}
+
+		int CallbackService::_Unregister(CallbackHandle^ handle, IntPtr taskHandle,
+			EventType eventType, int signal, Native::CallbackKey key) {
+
+			if (_dispatcher == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			TaskHandle task = (TaskHandle)taskHandle.ToPointer();
+			int r;
+
+			switch (eventType) {
+			case EventType::Done:
+				r = _dispatcher->UnregisterDoneEvent(task, key);
+				break;
+			case EventType::EveryNSamplesReceived:
+				r = _dispatcher->UnregisterEveryNSamplesEvent(task,
+					DAQmx_Val_Acquired_Into_Buffer, key);
+				break;
+			case EventType::Signal:
+				r = _dispatcher->UnregisterSignalEvent(task, signal, key);
+				break;
+			default:
+				r = _dispatcher->UnregisterEveryNSamplesEvent(task,
+					DAQmx_Val_Transferred_From_Buffer, key);
+				break;
+			}
+
+			// Even when DAQmx refused, e.g. for a cleared task: the released
+			// key turns away whatever it still raises.
+			_Release(handle, key);
+			_Quiesce();
+			return r;
+		}
+
+		bool CallbackService::_Quiesce() {
+			return (_dispatcher != nullptr) ? _dispatcher->Quiesce() : true;
+		}
+
+		uInt32 CallbackService::_MaxBatch() {
+			return (_dispatcher != nullptr) ? _dispatcher->Config().maxBatch : 1;
+		}
+
+		bool CallbackService::_LatencyTracking() {
+			return (_dispatcher != nullptr && _dispatcher->IsRunning())
+				? _dispatcher->Config().stampLatency : _configuration->LatencyTracking;
+		}
+
+		int CallbackService::_Start() {
+
+			Monitor::Enter(_lock);
+			try {
+				if (_dispatcher == nullptr) {
+					_dispatcher = new Native::CallbackDispatcherCore();
+				}
+				if (_dispatcher->IsRunning()) {
+					return Native::NativeSuccess;
+				}
+
+				// Kept in a static field, so the function pointer stays valid
+				// for the life of the process.
+				if (_batchDelegate == nullptr) {
+					_batchDelegate = gcnew CallbackBatchNativeDelegate(&CallbackService::_OnBatch);
+				}
+
+				return _dispatcher->Start(_configuration->ToNative(),
+					static_cast<Native::CallbackBatchFunction>(
+						Marshal::GetFunctionPointerForDelegate(_batchDelegate).ToPointer()),
+					nullptr);
+			}
+			finally {
+				Monitor::Exit(_lock);
+			}
+		}
+
+		int CallbackService::_Add(CallbackHandle^ handle, Native::CallbackKey% key) {
+
+			Native::CallbackKey allocated = 0;
+			int r = _dispatcher->Allocate(&allocated);
+
+			if (r != Native::NativeSuccess) {
+				return r;
+			}
+
+			// Added before the driver registration: the first event may
+			// arrive before it returns.
+			key = allocated;
+			_handles[Native::CallbackKeyIndex(allocated)] = handle;
+			return Native::NativeSuccess;
+		}
+
+		void CallbackService::_OnBatch(IntPtr context, IntPtr events, UInt32 count) {
+
+			const Native::CallbackEvent* e =
+				static_cast<const Native::CallbackEvent*>(events.ToPointer());
+
+			// Consecutive events of one registration go to it together.
+			UInt32 first = 0;
+
+			while (first < count) {
+
+				UInt32 last = first + 1;
+
+				while (last < count && e[last].key == e[first].key) {
+					last++;
+				}
+
+				// A handle disposed of meanwhile, or one that reused the
+				// slot, does not match the key.
+				CallbackHandle^ handle = _handles[Native::CallbackKeyIndex(e[first].key)];
+
+				if (handle != nullptr && handle->_Key() == e[first].key) {
+					handle->_Deliver(e + first, (int)(last - first));
+				}
+				first = last;
+			}
+		}
 	}
 }
-
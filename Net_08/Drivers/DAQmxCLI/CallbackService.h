@@ -18,6 +18,7 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE S
 OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+
 #pragma once
 
 using namespace System;
@@ -25,10 +26,139 @@ using namespace System::Runtime::InteropServices;
 
 #include "DAQmxCLIWrapper.h"
 #include "CallbackHandle.h"
+#include "Native/CallbackDispatcherCore.h"
 namespace Grumpy {
 
 	namespace DAQmxNetApi {
 
+		/**
+		* @brief OS priority of a dispatch thread: the Windows thread
+		*        priorities up to `THREAD_PRIORITY_TIME_CRITICAL` for
+		*        `RealTime`, or nice -5 / -10 and `SCHED_FIFO` on Linux.
+		*/
+		public enum class CallbackThreadPriority {
+			Normal = 0,
+			AboveNormal = 1,
+			Highest = 2,
+			RealTime = 3
+		};
+
+		/**
+		* @brief Settings of a dispatch thread of `CallbackService`.
+		*/
+		public ref class CallbackThreadConfiguration
+		{
+		public:
+			CallbackThreadConfiguration(String^ name);
+
+			/** Name that `CallbackService::RouteTask` picks the thread by. */
+			property String^ Name;
+
+			/** CPUs the thread may run on, bit `k` for CPU `k`; `0` leaves
+			*   it to the OS. */
+			property UInt64 AffinityMask;
+
+			property CallbackThreadPriority Priority;
+
+			/** `SCHED_FIFO` priority of `RealTime` on Linux, 1 to 99. */
+			property int RealTimePriority;
+
+			/** Polls the queue instead of sleeping: less latency, one busy
+			*   CPU. Pin a real-time polling thread to a CPU of its own. */
+			property bool BusyPoll;
+
+		internal:
+			Native::CallbackThreadConfig ToNative();
+		};
+
+		/**
+		* @brief Settings of the dispatcher of `CallbackService`.
+		*/
+		public ref class CallbackDispatcherConfiguration
+		{
+		public:
+			CallbackDispatcherConfiguration();
+
+			/** Shared dispatch threads. The events of a task always run on
+			*   the same one, in order. */
+			property int Threads;
+
+			/** Affinity and priority of every shared thread; its name is
+			*   not used. */
+			property CallbackThreadConfiguration^ SharedThreads;
+
+			/** Named threads after the shared ones that only run the tasks
+			*   routed to them with `CallbackService::RouteTask`. */
+			property Collections::Generic::List<CallbackThreadConfiguration^>^ DedicatedThreads {
+				Collections::Generic::List<CallbackThreadConfiguration^>^ get();
+			}
+
+			/** Events each dispatch thread can hold; the driver drops events
+			*   past that rather than wait. */
+			property int QueueCapacity;
+
+			/** Most events one dispatch thread takes at a time. */
+			property int MaxBatch;
+
+			/** Most registrations live at once. */
+			property int MaxRegistrations;
+
+			/** Signal events each signal registration holds until its
+			*   dispatch thread takes them. */
+			property int SignalCapacity;
+
+			/** Stamps every event on its way to the delegates and keeps a
+			*   `CallbackLatency` per handle; a few clock reads per event. */
+			property bool LatencyTracking;
+
+		internal:
+			Native::CallbackDispatcherConfig ToNative();
+
+		private:
+			Collections::Generic::List<CallbackThreadConfiguration^>^ _dedicatedThreads;
+		};
+
+		[UnmanagedFunctionPointer(CallingConvention::Cdecl)]
+		delegate void CallbackBatchNativeDelegate(IntPtr context, IntPtr events,
+			UInt32 count);
+
+		/**
+		* @brief Registers DAQmx events and delivers them to managed delegates.
+		*
+		* DAQmx calls fixed native trampolines that only queue the event for
+		* a dispatch thread (`Native::CallbackDispatcherCore`); the driver
+		* thread never enters the CLR, so a garbage collection cannot hold
+		* it up. Each dispatch thread makes one managed transition per batch
+		* of events and calls the delegates of every registration in the
+		* batch: the per-event delegates once per event, a
+		* `DAQmxCallbackBatchDelegate` once for all of its events.
+		*
+		* Each registration holds a generation-tagged key of the native
+		* registry, which is the callbackData DAQmx passes back and the index
+		* of the handle in a fixed table here, so registering and disposing
+		* of a handle are O(1), allocate nothing and never block delivery.
+		* Disposing of a handle unregisters its event from DAQmx, releases
+		* the key and waits, through the epoch of the native registry, for
+		* the trampolines and deliveries still in flight, so the consumer of
+		* a running task can be removed or replaced without stopping it.
+		*
+		* Signal events (`RegisterSignalEvent`) are recorded natively with
+		* the host time the driver raised them at; a burst of them costs one
+		* queue entry and reaches the delegates in the same batch.
+		*
+		* With `LatencyTracking`, each handle keeps a `CallbackLatency`:
+		* histograms of the time its events spend in the driver, the queue,
+		* the managed transition and the delegate. `LatencyReport` and
+		* `StartLatencyReport` print them for every handle.
+		*
+		* Tasks share `Threads` dispatch threads. `RouteTask` gives a task one
+		* of the `DedicatedThreads` instead, with its own CPU affinity, OS
+		* priority and, optionally, busy polling, so its consumer is not
+		* pre-empted by UI or logging work.
+		*
+		* The dispatcher starts with the first registration and lives as
+		* long as the process.
+		*/
 		public ref class CallbackService {
 
 			public:
@@ -43,8 +173,167 @@ namespace Grumpy {
 				DAQmxEveryNSamplesCallbackDelegate^ del,
 				int nSamples, Object^ data);
 
+			/**
+			* @brief Same as `RegisterNSamplesWrittenEvent`, with the events
+			*        that arrived together delivered in one call.
+			*/
+			static CallbackHandle^ RegisterNSamplesWrittenBatch(IntPtr taskHandle,
+				DAQmxCallbackBatchDelegate^ del,
+				int nSamples, Object^ data);
+
+			/**
+			* @brief Same as `RegisterNSamplesReadEvent`, with the events that
+			*        arrived together delivered in one call.
+			*/
+			static CallbackHandle^ RegisterNSamplesReadBatch(IntPtr taskHandle,
+				DAQmxCallbackBatchDelegate^ del,
+				int nSamples, Object^ data);
+
+			/**
+			* @brief Registers `DAQmxRegisterSignalEvent` for `signal`, e.g.
+			*        `ChangeDetectionEvent`, `CounterOutputEvent` or
+			*        `SampleClock`.
+			*/
+			static CallbackHandle^ RegisterSignalEvent(IntPtr taskHandle,
+				ExportableSignal signal, DAQmxSignalCallbackDelegate^ del, Object^ data);
+
+			/**
+			* @brief Same as `RegisterSignalEvent`, with every signal that
+			*        arrived while the previous batch ran delivered in one
+			*        call, each with the host time the driver raised it at.
+			*/
+			static CallbackHandle^ RegisterSignalBatch(IntPtr taskHandle,
+				ExportableSignal signal, DAQmxCallbackBatchDelegate^ del, Object^ data);
+
+			/**
+			* @brief Sets up the dispatcher; only before the first
+			*        registration.
+			*
+			* @return `0`, `NativeErrorAlreadyRunning` or
+			*         `NativeErrorInvalidArgument`.
+			*/
+			static int ConfigureDispatcher(CallbackDispatcherConfiguration^ configuration);
+
+			/**
+			* @brief Runs the delegates of `taskHandle` on the dedicated
+			*        dispatch thread `threadName` instead of a shared one;
+			*        before the events of the task are registered.
+			*
+			* @return `0`, `NativeErrorInvalidArgument` for a name not in
+			*         `DedicatedThreads`, or the error of starting the
+			*         dispatcher, e.g. `NativeErrorPermissionDenied` for a
+			*         priority the OS refused.
+			*/
+			static int RouteTask(IntPtr taskHandle, String^ threadName);
+
+			/** Runs the delegates of `taskHandle` on the shared threads
+			*   again. */
+			static int UnrouteTask(IntPtr taskHandle);
+
+			/**
+			* @brief The latency of every registered handle that tracks it,
+			*        one block per handle: see `CallbackLatency::ToString`.
+			*
+			* @param[in] reset Clears the histograms once read, so the next
+			*            report covers the time since this one.
+			*/
+			static String^ LatencyReport(bool reset);
+
+			/**
+			* @brief Writes `LatencyReport` to `writer` every `periodMs`
+			*        milliseconds from a timer thread, until
+			*        `StopLatencyReport`; replaces a report already running.
+			*
+			* @return `0` or `NativeErrorInvalidArgument`.
+			*/
+			static int StartLatencyReport(int periodMs, IO::TextWriter^ writer, bool reset);
+
+			static void StopLatencyReport();
+
+			/** Events raised by the driver. */
+			static property UInt64 EventsReceived {
+				UInt64 get();
+			}
+
+			static property UInt64 EventsDelivered {
+				UInt64 get();
+			}
+
+			/** Managed transitions made to deliver the events. */
+			static property UInt64 EventBatches {
+				UInt64 get();
+			}
+
+			/** Events lost because a dispatch thread fell behind. */
+			static property UInt64 EventsDropped {
+				UInt64 get();
+			}
+
+			/** Signal events delivered behind an earlier one of their
+			*   registration, without a queue entry of their own. */
+			static property UInt64 SignalsCoalesced {
+				UInt64 get();
+			}
+
+		internal:
+			static int _RegisterDoneEvent(CallbackHandle^ handle, IntPtr taskHandle,
+				Native::CallbackKey% key);
+
+			static int _RegisterEveryNSamplesEvent(CallbackHandle^ handle, IntPtr taskHandle,
+				int eventType, int nSamples, Native::CallbackKey% key);
+
+			static int _RegisterSignalEvent(CallbackHandle^ handle, IntPtr taskHandle,
+				int signal, Native::CallbackKey% key);
+
+			/**
+			* @brief Unregisters the event from DAQmx, stops the delivery to
+			*        `handle` and waits for its callbacks in flight.
+			*
+			* @return The status of the DAQmx unregistration.
+			*/
+			static int _Unregister(CallbackHandle^ handle, IntPtr taskHandle,
+				EventType eventType, int signal, Native::CallbackKey key);
+
+			/**
+			* @brief Stops the delivery to `handle` and gives back its key.
+			*/
+			static void _Release(CallbackHandle^ handle, Native::CallbackKey key);
+
+			/**
+			* @brief Waits for the callbacks in flight on other threads.
+			*
+			* @return `false`, without waiting, on a dispatch thread.
+			*/
+			static bool _Quiesce();
+
+			static uInt32 _MaxBatch();
+
+			static bool _LatencyTracking();
+
+		private:
+			static CallbackService() {
+				_lock = gcnew Object();
+				_configuration = gcnew CallbackDispatcherConfiguration();
+				_handles = gcnew array<CallbackHandle^>(Native::CallbackMaxRegistrations);
+			}
+
+			static int _Start();
+
+			static int _Add(CallbackHandle^ handle, Native::CallbackKey% key);
+
+			static void _OnBatch(IntPtr context, IntPtr events, UInt32 count);
+
+			static void _OnLatencyReport(Object^ state);
+
+			static Object^ _lock;
+			static Native::CallbackDispatcherCore* _dispatcher;
+			static CallbackDispatcherConfiguration^ _configuration;
+			static CallbackBatchNativeDelegate^ _batchDelegate;
+			/** Handles by the slot index of their key. */
+			static array<CallbackHandle^>^ _handles;
+			static Threading::Timer^ _reportTimer;
+			static IO::TextWriter^ _reportWriter;
+			static bool _reportReset;
 		};
 	}
 }
-
-
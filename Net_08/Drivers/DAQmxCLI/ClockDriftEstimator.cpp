@@ -0,0 +1,171 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ClockDriftEstimator.h"
+#include "AcquisitionEngine.h"
+#include "Native/HostClock.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		ClockDriftEstimatorConfiguration::ClockDriftEstimatorConfiguration() {
+
+			Native::ClockDriftEstimatorConfig defaults = Native::DefaultClockDriftEstimatorConfig();
+
+			NominalRate = defaults.nominalRate;
+			Window = (int)defaults.window;
+			Warmup = (int)defaults.warmup;
+			OutlierSigma = defaults.outlierSigma;
+			MinOutlierNs = defaults.minOutlierNs;
+			MaxConsecutiveOutliers = (int)defaults.maxConsecutiveOutliers;
+		}
+
+		Native::ClockDriftEstimatorConfig ClockDriftEstimatorConfiguration::ToNative() {
+
+			Native::ClockDriftEstimatorConfig config = Native::DefaultClockDriftEstimatorConfig();
+
+			config.nominalRate = NominalRate;
+			config.window = (uInt32)Math::Max(Window, 0);
+			config.warmup = (uInt32)Math::Max(Warmup, 0);
+			config.outlierSigma = OutlierSigma;
+			config.minOutlierNs = MinOutlierNs;
+			config.maxConsecutiveOutliers = (uInt32)Math::Max(MaxConsecutiveOutliers, 0);
+			return config;
+		}
+
+
+		ClockDriftEstimator::ClockDriftEstimator() {
+			_core = new Native::ClockDriftEstimatorCore();
+		}
+
+		ClockDriftEstimator::~ClockDriftEstimator() {
+			this->!ClockDriftEstimator();
+		}
+
+		ClockDriftEstimator::!ClockDriftEstimator() {
+
+			// The engine must stop calling the core before it goes.
+			if (_engine != nullptr) {
+				_engine->_ReleaseStage();
+			}
+
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		Int64 ClockDriftEstimator::HostTimeNs::get() {
+			return Native::HostMonotonicNs();
+		}
+
+		int ClockDriftEstimator::Configure(ClockDriftEstimatorConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			return _core->Configure(configuration->ToNative());
+		}
+
+		void ClockDriftEstimator::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		bool ClockDriftEstimator::AddObservation(UInt64 samplesAcquired, Int64 hostTimeNs) {
+			return _core != nullptr && _core->AddObservation(samplesAcquired, hostTimeNs);
+		}
+
+		ClockFit ClockDriftEstimator::Fit::get() {
+
+			ClockFit fit;
+
+			if (_core == nullptr) {
+				fit.MeanIndex = fit.MeanTimeNs = Double::NaN;
+				fit.PeriodNs = fit.Rate = fit.DriftPpm = fit.ResidualRmsNs = Double::NaN;
+				return fit;
+			}
+
+			Native::ClockFit native = _core->GetFit();
+
+			fit.Observations = native.observations;
+			fit.Rejected = native.rejected;
+			fit.Reseeds = native.reseeds;
+			fit.BaseTimeNs = native.baseTimeNs;
+			fit.BaseIndex = native.baseIndex;
+			fit.MeanIndex = native.meanIndex;
+			fit.MeanTimeNs = native.meanTimeNs;
+			fit.PeriodNs = native.periodNs;
+			fit.Rate = native.rate;
+			fit.DriftPpm = native.driftPpm;
+			fit.ResidualRmsNs = native.residualRmsNs;
+			return fit;
+		}
+
+		bool ClockDriftEstimator::TryGetSampleHostTime(UInt64 sampleIndex, Int64% hostTimeNs) {
+
+			int64 time = 0;
+			bool found = _core != nullptr && _core->SampleHostTime(sampleIndex, time);
+
+			hostTimeNs = time;
+			return found;
+		}
+
+		int ClockDriftEstimator::InterpolateHostTimes(UInt64 firstSample,
+			array<Int64>^ hostTimesNs) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (hostTimesNs == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if (hostTimesNs->Length == 0) {
+				return Native::NativeSuccess;
+			}
+
+			pin_ptr<Int64> pinned = &hostTimesNs[0];
+
+			return _core->InterpolateHostTimes(firstSample, (uInt32)hostTimesNs->Length,
+				reinterpret_cast<int64*>(pinned));
+		}
+
+		bool ClockDriftEstimator::TryGetSampleAtHostTime(Int64 hostTimeNs, double% sampleIndex) {
+
+			float64 index = 0.0;
+			bool found = _core != nullptr && _core->SampleAtHostTime(hostTimeNs, index);
+
+			sampleIndex = index;
+			return found;
+		}
+
+		Native::ClockDriftEstimatorCore* ClockDriftEstimator::_GetCore() {
+			return _core;
+		}
+	}
+}
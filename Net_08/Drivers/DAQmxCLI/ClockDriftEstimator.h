@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "Native/ClockDriftEstimatorCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		ref class AcquisitionEngine;
+
+		/**
+		* @brief Settings of a `ClockDriftEstimator`.
+		*/
+		public ref class ClockDriftEstimatorConfiguration
+		{
+		public:
+			ClockDriftEstimatorConfiguration();
+
+			/** Configured sample rate per channel; reference of `DriftPpm`
+			*   and period until the fit has two observations. `0` if unknown. */
+			property double NominalRate;
+
+			/** Effective number of observations (blocks) the fit remembers. */
+			property int Window;
+
+			/** Observations accepted before outliers are rejected. */
+			property int Warmup;
+
+			/** Observations further than this many residual RMS from the fit
+			*   are rejected as late callbacks. */
+			property double OutlierSigma;
+
+			/** Lower bound of the rejection threshold, in nanoseconds. */
+			property double MinOutlierNs;
+
+			/** Consecutive rejections after which the fit restarts. */
+			property int MaxConsecutiveOutliers;
+
+		internal:
+			Native::ClockDriftEstimatorConfig ToNative();
+		};
+
+		/**
+		* @brief State of the fit of a `ClockDriftEstimator`. Fields derived
+		*        from the fit are NaN before the first observation.
+		*/
+		[StructLayout(LayoutKind::Sequential)]
+		public value struct ClockFit
+		{
+			UInt64 Observations;
+			UInt64 Rejected;
+			UInt64 Reseeds;
+
+			/** Host time and samples acquired the fit started at. */
+			Int64 BaseTimeNs;
+			UInt64 BaseIndex;
+
+			/** Weighted mean of the observations, relative to the base. */
+			double MeanIndex;
+			double MeanTimeNs;
+
+			/** Sample period in host nanoseconds. */
+			double PeriodNs;
+			/** Sample rate in samples per host second. */
+			double Rate;
+			/** Deviation of `Rate` from the nominal rate, in ppm. */
+			double DriftPpm;
+			/** RMS of the host times around the fit, in nanoseconds. */
+			double ResidualRmsNs;
+		};
+
+		/**
+		* @brief Native streaming fit of the host monotonic clock against the
+		*        sample clock of a task, giving every sample a host timestamp.
+		*
+		* Give it to `AcquisitionEngine::SetClockEstimator`, or feed it the
+		* `SamplesAcquired` and `HostTimestampNs` of each block. It fits them
+		* by least squares as they arrive (the streaming, numerically stable
+		* counterpart of `Regression.LinearLSF`), forgets old blocks so that it
+		* follows drift of either clock, and ignores callbacks delivered late.
+		* The fit is read from any thread without locks.
+		*
+		* Host times are `HostTimeNs`, which uses the same clock as
+		* `Stopwatch.GetTimestamp()`; timestamp Modbus/PLC events with it to
+		* line them up with the samples.
+		*
+		* Methods return `0` on success or a status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class ClockDriftEstimator
+		{
+		private:
+			Native::ClockDriftEstimatorCore* _core;
+
+		public:
+			ClockDriftEstimator();
+			~ClockDriftEstimator();
+			!ClockDriftEstimator();
+
+			/**
+			* @brief Current host monotonic time, in nanoseconds.
+			*/
+			static property Int64 HostTimeNs {
+				Int64 get();
+			}
+
+			/**
+			* @brief Applies the settings and clears the fit.
+			*/
+			int Configure(ClockDriftEstimatorConfiguration^ configuration);
+
+			/**
+			* @brief Clears the fit.
+			*/
+			void Reset();
+
+			/**
+			* @brief Adds one observation: `samplesAcquired` samples per channel
+			*        had been acquired at `hostTimeNs`.
+			*
+			* @return `false` if it was ignored or rejected as an outlier.
+			*/
+			bool AddObservation(UInt64 samplesAcquired, Int64 hostTimeNs);
+
+			/**
+			* @brief The current fit.
+			*/
+			property ClockFit Fit {
+				ClockFit get();
+			}
+
+			/**
+			* @brief Host time of sample `sampleIndex` (0-based, per channel).
+			*
+			* @return `false` if there is no fit yet.
+			*/
+			bool TryGetSampleHostTime(UInt64 sampleIndex, [Out] Int64% hostTimeNs);
+
+			/**
+			* @brief Host times of `hostTimesNs->Length` consecutive samples
+			*        from `firstSample`, e.g. those of a block.
+			*/
+			int InterpolateHostTimes(UInt64 firstSample, array<Int64>^ hostTimesNs);
+
+			/**
+			* @brief Fractional index of the sample taken at `hostTimeNs`.
+			*
+			* @return `false` if there is no fit yet.
+			*/
+			bool TryGetSampleAtHostTime(Int64 hostTimeNs, [Out] double% sampleIndex);
+
+		internal:
+			Native::ClockDriftEstimatorCore* _GetCore();
+
+			/** The engine running this stage, if any; see `AcquisitionEngine::_ReleaseStage`. */
+			AcquisitionEngine^ _engine;
+		};
+	}
+}
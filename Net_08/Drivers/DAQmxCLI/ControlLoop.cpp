@@ -0,0 +1,216 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ControlLoop.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		ControlLoopConfiguration::ControlLoopConfiguration() {
+
+			Native::ControlLoopConfig defaults = Native::DefaultControlLoopConfig();
+
+			InputChannels = (int)defaults.inputChannels;
+			OutputChannels = (int)defaults.outputChannels;
+			DigitalLines = (int)defaults.digitalLines;
+			SampleRate = defaults.sampleRate;
+			Timeout = defaults.timeout;
+			HistogramBins = (int)defaults.histogramBins;
+			HistogramBinNs = (int)defaults.histogramBinNs;
+			WarmupIterations = (int)defaults.warmupIterations;
+			MaxConsecutiveLate = (int)defaults.maxConsecutiveLate;
+			OwnsTasks = defaults.ownsTasks;
+		}
+
+		Native::ControlLoopConfig ControlLoopConfiguration::ToNative() {
+
+			Native::ControlLoopConfig config = Native::DefaultControlLoopConfig();
+
+			config.inputChannels = (uInt32)Math::Max(InputChannels, 0);
+			config.outputChannels = (uInt32)Math::Max(OutputChannels, 0);
+			config.digitalLines = (uInt32)Math::Max(DigitalLines, 0);
+			config.sampleRate = SampleRate;
+			config.timeout = Timeout;
+			config.histogramBins = (uInt32)Math::Max(HistogramBins, 0);
+			config.histogramBinNs = (uInt32)Math::Max(HistogramBinNs, 0);
+			config.warmupIterations = (uInt32)Math::Max(WarmupIterations, 0);
+			config.maxConsecutiveLate = (uInt32)Math::Max(MaxConsecutiveLate, 0);
+			config.ownsTasks = OwnsTasks;
+			return config;
+		}
+
+		ControlLoop::ControlLoop() {
+			_core = new Native::ControlLoopCore();
+		}
+
+		ControlLoop::~ControlLoop() {
+			this->!ControlLoop();
+		}
+
+		ControlLoop::!ControlLoop() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int ControlLoop::Attach(IntPtr inputTaskHandle, IntPtr outputTaskHandle,
+			ControlLoopConfiguration^ configuration) {
+
+			return Attach(inputTaskHandle, outputTaskHandle, IntPtr::Zero, configuration);
+		}
+
+		int ControlLoop::Attach(IntPtr inputTaskHandle, IntPtr outputTaskHandle,
+			IntPtr digitalOutputTaskHandle, ControlLoopConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::ControlLoopConfig config = configuration->ToNative();
+			return _core->Attach((TaskHandle)inputTaskHandle.ToPointer(),
+				(TaskHandle)outputTaskHandle.ToPointer(),
+				(TaskHandle)digitalOutputTaskHandle.ToPointer(), config);
+		}
+
+		int ControlLoop::Detach() {
+			return (_core != nullptr) ? _core->Detach() : 0;
+		}
+
+		int ControlLoop::SetControlLaw(IntPtr function, IntPtr context) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			int result = _core->SetControlLaw(
+				reinterpret_cast<Native::ControlLawFunction>(function.ToPointer()),
+				context.ToPointer());
+
+			if (result == Native::NativeSuccess) {
+				_controller = nullptr;
+			}
+			return result;
+		}
+
+		int ControlLoop::SetController(Controller^ controller) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (controller == nullptr || controller->_GetCore() == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::ControllerCore* core = controller->_GetCore();
+			int result = _core->SetControlLaw(&Native::ControllerCore::Law, core->LawContext());
+
+			// Keeps the controller alive while the loop calls it.
+			if (result == Native::NativeSuccess) {
+				_controller = controller;
+			}
+			return result;
+		}
+
+		int ControlLoop::SetInitialOutputs(array<double>^ outputs) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (outputs == nullptr || outputs->Length == 0) {
+				return _core->SetInitialOutputs(nullptr, 0);
+			}
+
+			pin_ptr<double> outputsPtr = &outputs[0];
+			return _core->SetInitialOutputs(outputsPtr, (uInt32)outputs->Length);
+		}
+
+		int ControlLoop::Start() {
+			return (_core != nullptr) ? _core->Start()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int ControlLoop::Stop() {
+			return (_core != nullptr) ? _core->Stop()
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		bool ControlLoop::IsRunning::get() {
+			return _core != nullptr && _core->IsRunning();
+		}
+
+		UInt64 ControlLoop::Iterations::get() {
+			return (_core != nullptr) ? _core->Counters().iterations : 0;
+		}
+
+		UInt64 ControlLoop::LateIterations::get() {
+			return (_core != nullptr) ? _core->Counters().lateIterations : 0;
+		}
+
+		UInt64 ControlLoop::Overruns::get() {
+			return (_core != nullptr) ? _core->Counters().overruns : 0;
+		}
+
+		UInt64 ControlLoop::MaxLoopNs::get() {
+			return (_core != nullptr) ? _core->Counters().maxLoopNs : 0;
+		}
+
+		UInt64 ControlLoop::MeanLoopNs::get() {
+			return (_core != nullptr) ? _core->Counters().meanLoopNs : 0;
+		}
+
+		UInt64 ControlLoop::MaxPeriodNs::get() {
+			return (_core != nullptr) ? _core->Counters().maxPeriodNs : 0;
+		}
+
+		int ControlLoop::LastError::get() {
+			return (_core != nullptr) ? _core->Counters().lastError : 0;
+		}
+
+		int ControlLoop::GetHistogram(array<UInt64>^ bins) {
+
+			if (_core == nullptr || bins == nullptr || bins->Length == 0) {
+				return 0;
+			}
+
+			pin_ptr<UInt64> binsPtr = &bins[0];
+			return (int)_core->ReadHistogram(binsPtr, (size_t)bins->Length);
+		}
+
+		UInt64 ControlLoop::LoopTimePercentile(double fraction) {
+			return (_core != nullptr) ? _core->LoopTimePercentile(fraction) : 0;
+		}
+
+		void ControlLoop::ResetStatistics() {
+			if (_core != nullptr) {
+				_core->ResetStatistics();
+			}
+		}
+	}
+}
@@ -0,0 +1,202 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+
+#include "DAQmxCLIWrapper.h"
+#include "Controller.h"
+#include "Native/ControlLoopCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Settings of a `ControlLoop`.
+		*/
+		public ref class ControlLoopConfiguration
+		{
+		public:
+			ControlLoopConfiguration();
+
+			/** Channels of the input task. */
+			property int InputChannels;
+
+			/** Channels of the output task; 0 without one. */
+			property int OutputChannels;
+
+			/** Lines of the digital output task; 0 without one. */
+			property int DigitalLines;
+
+			/** Sample clock rate of the tasks, in Hz. */
+			property double SampleRate;
+
+			/** Timeout, in seconds, of the wait, the read and the write. */
+			property double Timeout;
+
+			/** Bins of the loop-time histogram. */
+			property int HistogramBins;
+
+			/** Width of a histogram bin, in nanoseconds. */
+			property int HistogramBinNs;
+
+			/** First iterations kept out of the statistics. */
+			property int WarmupIterations;
+
+			/** Late iterations in a row that stop the loop; 0 never stops it. */
+			property int MaxConsecutiveLate;
+
+			/** If `true`, `Detach` clears the tasks. */
+			property bool OwnsTasks;
+
+		internal:
+			Native::ControlLoopConfig ToNative();
+		};
+
+		/**
+		* @brief Runs a closed control loop on hardware-timed single-point
+		*        tasks: every sample clock, a native thread reads the inputs,
+		*        calls the control law and writes the outputs.
+		*
+		* The law is a `Controller`, or a native function,
+		* `ControlLawFunction` of `Native/ControlLoopCore.h`, exported by a
+		* native library or compiled ahead of time; no managed code runs in
+		* the loop.
+		* The loop counts late iterations reported by the driver and keeps
+		* a histogram of the loop times.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the loop.
+		*/
+		public ref class ControlLoop
+		{
+		private:
+			Native::ControlLoopCore* _core;
+			Controller^ _controller;
+
+		public:
+			ControlLoop();
+			~ControlLoop();
+			!ControlLoop();
+
+			/**
+			* @brief Attaches the loop to configured, not yet started tasks
+			*        timed with `SamplingMode::HWTimedSinglePoint`.
+			*
+			* @param outputTaskHandle `IntPtr::Zero` for a loop without outputs.
+			*/
+			int Attach(IntPtr inputTaskHandle, IntPtr outputTaskHandle,
+				ControlLoopConfiguration^ configuration);
+
+			/**
+			* @brief Attaches the loop to an input task, an analog output
+			*        task and a digital output task; either output may be
+			*        `IntPtr::Zero`.
+			*/
+			int Attach(IntPtr inputTaskHandle, IntPtr outputTaskHandle,
+				IntPtr digitalOutputTaskHandle, ControlLoopConfiguration^ configuration);
+
+			/**
+			* @brief Stops the loop. Clears the tasks if the loop owns them.
+			*/
+			int Detach();
+
+			/**
+			* @brief Sets the native control law and its context; both must
+			*        stay valid while the loop runs.
+			*/
+			int SetControlLaw(IntPtr function, IntPtr context);
+
+			/**
+			* @brief Runs `controller` as the control law. Its settings may
+			*        still be changed while the loop runs.
+			*/
+			int SetController(Controller^ controller);
+
+			/**
+			* @brief Sets the outputs held until the law changes them.
+			*/
+			int SetInitialOutputs(array<double>^ outputs);
+
+			int Start();
+
+			int Stop();
+
+			/** `false` once stopped, also by an error; see `LastError`. */
+			property bool IsRunning {
+				bool get();
+			}
+
+			property UInt64 Iterations {
+				UInt64 get();
+			}
+
+			/** Iterations after which the driver reported a missed sample
+			*   clock. */
+			property UInt64 LateIterations {
+				UInt64 get();
+			}
+
+			/** Iterations whose loop time exceeded the clock period. */
+			property UInt64 Overruns {
+				UInt64 get();
+			}
+
+			/** Longest time from the sample clock to the end of the write,
+			*   in nanoseconds. */
+			property UInt64 MaxLoopNs {
+				UInt64 get();
+			}
+
+			property UInt64 MeanLoopNs {
+				UInt64 get();
+			}
+
+			/** Longest time between two wake-ups, in nanoseconds. */
+			property UInt64 MaxPeriodNs {
+				UInt64 get();
+			}
+
+			property int LastError {
+				int get();
+			}
+
+			/**
+			* @brief Copies the loop-time histogram.
+			*
+			* @return The number of bins copied.
+			*/
+			int GetHistogram(array<UInt64>^ bins);
+
+			/**
+			* @brief Loop time under which `fraction` (0 to 1) of the
+			*        iterations fall, in nanoseconds.
+			*/
+			UInt64 LoopTimePercentile(double fraction);
+
+			void ResetStatistics();
+
+		internal:
+			Native::ControlLoopCore* _GetCore() { return _core; }
+		};
+	}
+}
@@ -0,0 +1,308 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Controller.h"
+
+#include <vector>
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace {
+
+			bool CopyMatrix(array<double, 2>^ matrix, int rows, int columns,
+				std::vector<float64>& values) {
+
+				if (matrix == nullptr || matrix->GetLength(0) != rows
+					|| matrix->GetLength(1) != columns) {
+					return false;
+				}
+
+				values.resize((size_t)rows * columns);
+
+				for (int r = 0; r < rows; r++) {
+					for (int c = 0; c < columns; c++) {
+						values[(size_t)r * columns + c] = matrix[r, c];
+					}
+				}
+				return true;
+			}
+
+			bool CopyVector(array<double>^ vector, int length, std::vector<float64>& values) {
+
+				if (vector == nullptr) {
+					return true;
+				}
+
+				if (vector->Length != length) {
+					return false;
+				}
+
+				values.assign(length, 0.0);
+				for (int k = 0; k < length; k++) {
+					values[k] = vector[k];
+				}
+				return true;
+			}
+		}
+
+		PidSettings::PidSettings() {
+
+			Native::PidChannelSettings defaults = Native::DefaultPidChannelSettings();
+
+			Kp = defaults.kp;
+			Ki = defaults.ki;
+			Kd = defaults.kd;
+			DerivativeTime = defaults.derivativeTime;
+			TrackingGain = defaults.trackingGain;
+			OutputMin = defaults.outputMin;
+			OutputMax = defaults.outputMax;
+			Setpoint = defaults.setpoint;
+		}
+
+		Native::PidChannelSettings PidSettings::ToNative() {
+
+			Native::PidChannelSettings settings;
+			settings.kp = Kp;
+			settings.ki = Ki;
+			settings.kd = Kd;
+			settings.derivativeTime = Math::Max(DerivativeTime, 0.0);
+			settings.trackingGain = TrackingGain;
+			settings.outputMin = OutputMin;
+			settings.outputMax = OutputMax;
+			settings.setpoint = Setpoint;
+			return settings;
+		}
+
+		LeadLagSettings::LeadLagSettings() {
+
+			Native::LeadLagChannelSettings defaults = Native::DefaultLeadLagChannelSettings();
+
+			Gain = defaults.gain;
+			LeadTime = defaults.leadTime;
+			LagTime = defaults.lagTime;
+			OutputMin = defaults.outputMin;
+			OutputMax = defaults.outputMax;
+			Setpoint = defaults.setpoint;
+		}
+
+		Native::LeadLagChannelSettings LeadLagSettings::ToNative() {
+
+			Native::LeadLagChannelSettings settings;
+			settings.gain = Gain;
+			settings.leadTime = Math::Max(LeadTime, 0.0);
+			settings.lagTime = Math::Max(LagTime, 0.0);
+			settings.outputMin = OutputMin;
+			settings.outputMax = OutputMax;
+			settings.setpoint = Setpoint;
+			return settings;
+		}
+
+		Controller::Controller() {
+			_core = new Native::ControllerCore();
+		}
+
+		Controller::~Controller() {
+			this->!Controller();
+		}
+
+		Controller::!Controller() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int Controller::ConfigurePid(int channels) {
+			return (_core != nullptr) ? _core->ConfigurePid((uInt32)Math::Max(channels, 0))
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int Controller::ConfigureLeadLag(int channels) {
+			return (_core != nullptr) ? _core->ConfigureLeadLag((uInt32)Math::Max(channels, 0))
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		int Controller::ConfigureStateSpace(int states, int inputs, int outputs) {
+			return (_core != nullptr) ? _core->ConfigureStateSpace((uInt32)Math::Max(states, 0),
+				(uInt32)Math::Max(inputs, 0), (uInt32)Math::Max(outputs, 0))
+				: (int)Native::NativeErrorInvalidState;
+		}
+
+		ControllerKind Controller::Kind::get() {
+			return (_core != nullptr) ? (ControllerKind)_core->Kind() : ControllerKind::None;
+		}
+
+		int Controller::InputCount::get() {
+			return (_core != nullptr) ? (int)_core->InputCount() : 0;
+		}
+
+		int Controller::OutputCount::get() {
+			return (_core != nullptr) ? (int)_core->OutputCount() : 0;
+		}
+
+		int Controller::Bind(array<int>^ inputs, array<int>^ outputs) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (inputs == nullptr || outputs == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			std::vector<uInt32> inputMap(inputs->Length);
+			std::vector<uInt32> outputMap(outputs->Length);
+
+			for (int k = 0; k < inputs->Length; k++) {
+				if (inputs[k] < 0) {
+					return Native::NativeErrorInvalidArgument;
+				}
+				inputMap[k] = (uInt32)inputs[k];
+			}
+
+			for (int k = 0; k < outputs->Length; k++) {
+				if (outputs[k] < 0) {
+					return Native::NativeErrorInvalidArgument;
+				}
+				outputMap[k] = (uInt32)outputs[k];
+			}
+
+			return _core->Bind(inputMap.data(), (uInt32)inputMap.size(),
+				outputMap.data(), (uInt32)outputMap.size());
+		}
+
+		int Controller::SetPid(int channel, PidSettings^ settings) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (settings == nullptr || channel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->SetPidChannel((uInt32)channel, settings->ToNative());
+		}
+
+		int Controller::SetLeadLag(int channel, LeadLagSettings^ settings) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (settings == nullptr || channel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->SetLeadLagChannel((uInt32)channel, settings->ToNative());
+		}
+
+		int Controller::SetStateSpace(StateSpaceSettings^ settings) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (_core->Kind() != Native::ControllerKind::StateSpace) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (settings == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			const int states = (int)_core->StateCount();
+			const int inputs = (int)_core->InputCount();
+			const int outputs = (int)_core->OutputCount();
+
+			std::vector<float64> a, b, c, d, setpoints, outputMin, outputMax;
+
+			if (!CopyMatrix(settings->A, states, states, a)
+				|| !CopyMatrix(settings->B, states, inputs, b)
+				|| !CopyMatrix(settings->C, outputs, states, c)
+				|| !CopyMatrix(settings->D, outputs, inputs, d)
+				|| !CopyVector(settings->Setpoints, inputs, setpoints)
+				|| !CopyVector(settings->OutputMin, outputs, outputMin)
+				|| !CopyVector(settings->OutputMax, outputs, outputMax)) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::StateSpaceSettings native;
+			native.a = a.data();
+			native.b = b.data();
+			native.c = c.data();
+			native.d = d.data();
+			native.setpoints = setpoints.empty() ? nullptr : setpoints.data();
+			native.outputMin = outputMin.empty() ? nullptr : outputMin.data();
+			native.outputMax = outputMax.empty() ? nullptr : outputMax.data();
+
+			return _core->SetStateSpace(native);
+		}
+
+		int Controller::SetSetpoint(int input, double value) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (input < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->SetSetpoint((uInt32)input, value);
+		}
+
+		void Controller::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		int Controller::Step(array<double>^ inputs, array<double>^ outputs, double dt) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (inputs == nullptr || outputs == nullptr
+				|| inputs->Length == 0 || outputs->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<double> inputsPtr = &inputs[0];
+			pin_ptr<double> outputsPtr = &outputs[0];
+
+			return _core->Step(inputsPtr, (uInt32)inputs->Length,
+				outputsPtr, (uInt32)outputs->Length, dt);
+		}
+
+		UInt64 Controller::Steps::get() {
+			return (_core != nullptr) ? _core->Counters().steps : 0;
+		}
+
+		UInt64 Controller::ParameterUpdates::get() {
+			return (_core != nullptr) ? _core->Counters().parameterUpdates : 0;
+		}
+	}
+}
@@ -0,0 +1,214 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+
+#include "DAQmxCLIWrapper.h"
+#include "Native/ControllerCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Controller run by a `Controller`.
+		*/
+		public enum class ControllerKind {
+			None = (int)Native::ControllerKind::None,
+			Pid = (int)Native::ControllerKind::Pid,
+			LeadLag = (int)Native::ControllerKind::LeadLag,
+			StateSpace = (int)Native::ControllerKind::StateSpace
+		};
+
+		/**
+		* @brief Settings of one channel of a PID controller.
+		*/
+		public ref class PidSettings
+		{
+		public:
+			PidSettings();
+
+			property double Kp;
+			property double Ki;
+			property double Kd;
+
+			/** Time constant of the derivative filter, in seconds. */
+			property double DerivativeTime;
+
+			/** Anti-windup back-calculation gain, in 1/s; 0 disables it. */
+			property double TrackingGain;
+
+			property double OutputMin;
+			property double OutputMax;
+			property double Setpoint;
+
+		internal:
+			Native::PidChannelSettings ToNative();
+		};
+
+		/**
+		* @brief Settings of one channel of a lead-lag controller,
+		*        `Gain (LeadTime s + 1) / (LagTime s + 1)`.
+		*/
+		public ref class LeadLagSettings
+		{
+		public:
+			LeadLagSettings();
+
+			property double Gain;
+
+			/** Time constant of the zero, in seconds. */
+			property double LeadTime;
+
+			/** Time constant of the pole, in seconds. */
+			property double LagTime;
+
+			property double OutputMin;
+			property double OutputMax;
+			property double Setpoint;
+
+		internal:
+			Native::LeadLagChannelSettings ToNative();
+		};
+
+		/**
+		* @brief Matrices of a discrete state-space controller:
+		*        `u = C x + D e`, `x = A x + B e`, with `e = Setpoints - y`.
+		*/
+		public ref class StateSpaceSettings
+		{
+		public:
+			/** States x states. */
+			property array<double, 2>^ A;
+
+			/** States x inputs. */
+			property array<double, 2>^ B;
+
+			/** Outputs x states. */
+			property array<double, 2>^ C;
+
+			/** Outputs x inputs. */
+			property array<double, 2>^ D;
+
+			/** One per input; `nullptr` keeps the current setpoints. */
+			property array<double>^ Setpoints;
+
+			/** One per output; `nullptr` keeps the current limits. */
+			property array<double>^ OutputMin;
+			property array<double>^ OutputMax;
+		};
+
+		/**
+		* @brief A native PID, lead-lag or state-space controller, run by a
+		*        `ControlLoop` on its loop thread or stepped from managed code.
+		*
+		* The controller is compiled for fixed channel counts, so a step of
+		* all its channels costs tens of nanoseconds. Its settings may be
+		* changed while it runs: every setter publishes a complete parameter
+		* set that the loop picks up at its next step, without locking it.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the controller.
+		*/
+		public ref class Controller
+		{
+		private:
+			Native::ControllerCore* _core;
+
+		public:
+			Controller();
+			~Controller();
+			!Controller();
+
+			/**
+			* @brief Replaces the controller with `channels` (up to 16) PID
+			*        loops.
+			*/
+			int ConfigurePid(int channels);
+
+			/**
+			* @brief Replaces the controller with `channels` (up to 16)
+			*        lead-lag compensators.
+			*/
+			int ConfigureLeadLag(int channels);
+
+			/**
+			* @brief Replaces the controller with a state-space controller of
+			*        up to 16 states and 8 inputs and outputs.
+			*/
+			int ConfigureStateSpace(int states, int inputs, int outputs);
+
+			property ControllerKind Kind {
+				ControllerKind get();
+			}
+
+			property int InputCount {
+				int get();
+			}
+
+			property int OutputCount {
+				int get();
+			}
+
+			/**
+			* @brief Maps controller input k to loop input `inputs[k]`, e.g.
+			*        an analog input channel, and controller output k to loop
+			*        output `outputs[k]`: analog output channels, then digital
+			*        lines.
+			*/
+			int Bind(array<int>^ inputs, array<int>^ outputs);
+
+			int SetPid(int channel, PidSettings^ settings);
+
+			int SetLeadLag(int channel, LeadLagSettings^ settings);
+
+			int SetStateSpace(StateSpaceSettings^ settings);
+
+			int SetSetpoint(int input, double value);
+
+			/**
+			* @brief Clears the integrators, filters and states at the next
+			*        step.
+			*/
+			void Reset();
+
+			/**
+			* @brief Runs one step, e.g. on values read with
+			*        `DAQmxCLIWrapper::ReadAnalogScalarF64`, in one call.
+			*
+			* @param dt Period, in seconds.
+			*/
+			int Step(array<double>^ inputs, array<double>^ outputs, double dt);
+
+			property UInt64 Steps {
+				UInt64 get();
+			}
+
+			property UInt64 ParameterUpdates {
+				UInt64 get();
+			}
+
+		internal:
+			Native::ControllerCore* _GetCore() { return _core; }
+		};
+	}
+}
@@ -19,6 +19,9 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "DAQmxCLIWrapper.h"
+#include "Native/BitPackKernels.h"
+#include "Native/NativeStatus.h"
+#include "Native/PackedDigitalLines.h"
 
 using namespace System;
 
@@ -44,6 +47,13 @@ namespace Grumpy{
 
 		String^ DAQmxCLIWrapper::GetErrorDescription(int errorCode) {
 
+			const char* nativeDescription = 
+				Native::NativeStatusDescription(errorCode);
+
+			if (nativeDescription != NULL) {
+				return gcnew String(nativeDescription);
+			}
+
 			char errorString[ErrorBufferSize];
 			DAQmxGetErrorString(errorCode, errorString, ErrorBufferSize);
 			return gcnew String(errorString);
@@ -180,6 +190,36 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadDigitU32(IntPtr taskHandle,
+			int samplesPerChannel, double timeout,
+			ReadbacklFillMode interleaveMode,
+			uInt32* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadDigitalU32((TaskHandle)taskHandle,
+				samplesPerChannel, timeout, (bool32)interleaveMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadDigitU32(IntPtr taskHandle,
+			int samplesPerChannel, double timeout,
+			ReadbacklFillMode interleaveMode,
+			Memory<UInt32> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadDigitalU32((TaskHandle)taskHandle,
+				samplesPerChannel, timeout, (bool32)interleaveMode, (uInt32*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
 		int DAQmxCLIWrapper::ReadDigitU16(IntPtr taskHandle,
 			int samplesPerChannel, double timeout,
 			ReadbacklFillMode interleaveMode, array<uInt16>^ data, 
@@ -196,6 +236,36 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadDigitU16(IntPtr taskHandle,
+			int samplesPerChannel, double timeout,
+			ReadbacklFillMode interleaveMode,
+			uInt16* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadDigitalU16((TaskHandle)taskHandle,
+				samplesPerChannel, timeout, (bool32)interleaveMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadDigitU16(IntPtr taskHandle,
+			int samplesPerChannel, double timeout,
+			ReadbacklFillMode interleaveMode,
+			Memory<UInt16> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadDigitalU16((TaskHandle)taskHandle,
+				samplesPerChannel, timeout, (bool32)interleaveMode, (uInt16*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
 		int DAQmxCLIWrapper::ReadDigitU8(IntPtr taskHandle,
 			int samplesPerChannel, double timeout,
 			ReadbacklFillMode interleaveMode, array<uInt8>^ data, 
@@ -213,6 +283,36 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadDigitU8(IntPtr taskHandle,
+			int samplesPerChannel, double timeout,
+			ReadbacklFillMode interleaveMode,
+			uInt8* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadDigitalU8((TaskHandle)taskHandle,
+				samplesPerChannel, timeout, (bool32)interleaveMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadDigitU8(IntPtr taskHandle,
+			int samplesPerChannel, double timeout,
+			ReadbacklFillMode interleaveMode,
+			Memory<Byte> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadDigitalU8((TaskHandle)taskHandle,
+				samplesPerChannel, timeout, (bool32)interleaveMode, (uInt8*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
 
 
 		int DAQmxCLIWrapper::WriteDigitalLines(IntPtr taskHandle,
@@ -230,6 +330,111 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadDigitalLinesPacked(IntPtr taskHandle,
+			int32 numSampsPerChan, double timeout,
+			ReadbacklFillMode interleaveMode,
+			uInt8* data, uInt32 bufferSizeInBytes,
+			[Out] int% sampsPerChanRead,
+			[Out] int% linesPerChannel) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int32 linesPerChannelLocal = 0;
+			int result = Native::ReadDigitalLinesPacked((TaskHandle)taskHandle,
+				numSampsPerChan, timeout, (int32)interleaveMode, data, bufferSizeInBytes,
+				&sampsPerChanReadLocal, &linesPerChannelLocal);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			linesPerChannel = linesPerChannelLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadDigitalLinesPacked(IntPtr taskHandle,
+			int32 numSampsPerChan, double timeout,
+			ReadbacklFillMode interleaveMode,
+			Memory<Byte> data,
+			[Out] int% sampsPerChanRead,
+			[Out] int% linesPerChannel) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int result = ReadDigitalLinesPacked(taskHandle, numSampsPerChan, timeout,
+				interleaveMode, (uInt8*)handle.Pointer, (uInt32)data.Length,
+				sampsPerChanRead, linesPerChannel);
+			handle.Dispose();
+			return result;
+		}
+
+		int DAQmxCLIWrapper::WriteDigitalLinesPacked(IntPtr taskHandle,
+			int32 numSampsPerChan, bool autoStart, double timeout,
+			ReadbacklFillMode interleaveMode,
+			const uInt8* data, uInt32 bufferSizeInBytes,
+			[Out] int% sampsPerChanWritten) {
+
+			int32 sampsPerChanWrittenLocal = 0;
+			int result = Native::WriteDigitalLinesPacked((TaskHandle)taskHandle,
+				numSampsPerChan, autoStart, timeout, (int32)interleaveMode, data,
+				bufferSizeInBytes, &sampsPerChanWrittenLocal);
+			sampsPerChanWritten = sampsPerChanWrittenLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::WriteDigitalLinesPacked(IntPtr taskHandle,
+			int32 numSampsPerChan, bool autoStart, double timeout,
+			ReadbacklFillMode interleaveMode,
+			Memory<Byte> data,
+			[Out] int% sampsPerChanWritten) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int result = WriteDigitalLinesPacked(taskHandle, numSampsPerChan, autoStart,
+				timeout, interleaveMode, (const uInt8*)handle.Pointer, (uInt32)data.Length,
+				sampsPerChanWritten);
+			handle.Dispose();
+			return result;
+		}
+
+		int DAQmxCLIWrapper::GetPackedDigitalLinesSize(int channels, int linesPerChannel,
+			int samplesPerChannel) {
+
+			return (int)Native::PackedDigitalLinesSize((uInt32)Math::Max(channels, 0),
+				(uInt32)Math::Max(linesPerChannel, 0), (uInt32)Math::Max(samplesPerChannel, 0));
+		}
+
+		int DAQmxCLIWrapper::PackDigitalLines(Memory<Byte> lines, Memory<Byte> bits,
+			int bitOffset) {
+
+			if (bitOffset < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if (Native::PackedLinesSize((size_t)bitOffset + lines.Length) > (size_t)bits.Length) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			System::Buffers::MemoryHandle linesHandle = lines.Pin();
+			System::Buffers::MemoryHandle bitsHandle = bits.Pin();
+			Native::PackLines((const uInt8*)linesHandle.Pointer, (size_t)lines.Length,
+				(uInt8*)bitsHandle.Pointer, (size_t)bitOffset);
+			bitsHandle.Dispose();
+			linesHandle.Dispose();
+			return Native::NativeSuccess;
+		}
+
+		int DAQmxCLIWrapper::UnpackDigitalLines(Memory<Byte> bits, int bitOffset,
+			Memory<Byte> lines) {
+
+			if (bitOffset < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if (Native::PackedLinesSize((size_t)bitOffset + lines.Length) > (size_t)bits.Length) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			System::Buffers::MemoryHandle bitsHandle = bits.Pin();
+			System::Buffers::MemoryHandle linesHandle = lines.Pin();
+			Native::UnpackLines((const uInt8*)bitsHandle.Pointer, (size_t)bitOffset,
+				(size_t)lines.Length, (uInt8*)linesHandle.Pointer);
+			linesHandle.Dispose();
+			bitsHandle.Dispose();
+			return Native::NativeSuccess;
+		}
+
 
 		int DAQmxCLIWrapper::WriteDigitalScalarU32(IntPtr taskHandle,
 			bool autostart, double timeout, uInt32 data) {
@@ -254,6 +459,52 @@ namespace Grumpy{
 		}
 
 
+		int DAQmxCLIWrapper::WriteAnalogF64(IntPtr taskHandle, int32 numSampsPerChan,
+			bool autoStart, double timeout, ReadbacklFillMode interleaveMode,
+			array<float64>^ data, [Out] int% samplesPerChannelWritten) {
+
+			pin_ptr<float64> dataPtr = &data[0];
+			int32 sampsPerChanWrittenLocal;
+
+			int result = DAQmxWriteAnalogF64((TaskHandle)taskHandle,
+				numSampsPerChan, autoStart, timeout,
+				(bool32)interleaveMode, dataPtr, &sampsPerChanWrittenLocal, NULL);
+
+			samplesPerChannelWritten = sampsPerChanWrittenLocal;
+			return result;
+		}
+
+
+		int DAQmxCLIWrapper::WriteBinaryI16(IntPtr taskHandle, int32 numSampsPerChan,
+			bool autoStart, double timeout, ReadbacklFillMode interleaveMode,
+			array<int16>^ data, [Out] int% samplesPerChannelWritten) {
+
+			pin_ptr<int16> dataPtr = &data[0];
+			int32 sampsPerChanWrittenLocal;
+
+			int result = DAQmxWriteBinaryI16((TaskHandle)taskHandle,
+				numSampsPerChan, autoStart, timeout,
+				(bool32)interleaveMode, dataPtr, &sampsPerChanWrittenLocal, NULL);
+
+			samplesPerChannelWritten = sampsPerChanWrittenLocal;
+			return result;
+		}
+
+
+		int DAQmxCLIWrapper::ConfigureOutputBuffer(IntPtr taskHandle,
+			uInt32 samplesPerChannel) {
+
+			return DAQmxCfgOutputBuffer((TaskHandle)taskHandle, samplesPerChannel);
+		}
+
+
+		int DAQmxCLIWrapper::SetWriteRegenerationMode(IntPtr taskHandle,
+			RegenerationMode mode) {
+
+			return DAQmxSetWriteRegenMode((TaskHandle)taskHandle, (int32)mode);
+		}
+
+
 		int DAQmxCLIWrapper::WriteDigitalU16(IntPtr taskHandle, int32 numSampsPerChan,
 			bool autoStart, double timeout, ReadbacklFillMode interleaveMode,
 			array<uInt16>^ data, [Out] int% samplesPerChannelWritten) {
@@ -311,6 +562,46 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadAnalogF64(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			float64* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadAnalogF64((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadAnalogF64(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			Memory<double> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadAnalogF64((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, (float64*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::WaitForNextSampleClock(IntPtr taskHandle,
+			double timeout, [Out] bool% isLate) {
+
+			bool32 late = 0;
+			int result = DAQmxWaitForNextSampleClock((TaskHandle)taskHandle,
+				timeout, &late);
+			isLate = (late != 0);
+			return result;
+		}
+
 		int DAQmxCLIWrapper::ReadAnalogScalarF64(IntPtr taskHandle,
 			double timeout, [Out] double% data) {
 
@@ -335,6 +626,36 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadBinaryI16(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			int16* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryI16((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadBinaryI16(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			Memory<Int16> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryI16((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, (int16*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
 		int DAQmxCLIWrapper::ReadBinaryI32(IntPtr taskHandle,
 			int32 sampsPerChan, double timeout,
 			ReadbacklFillMode groupMode, array<int32>^ dat,
@@ -349,6 +670,36 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadBinaryI32(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			int32* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryI32((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadBinaryI32(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			Memory<Int32> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryI32((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, (int32*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
 		int DAQmxCLIWrapper::ReadBinaryUI16(IntPtr taskHandle,
 			int32 sampsPerChan, double timeout,
 			ReadbacklFillMode groupMode, array<uInt16>^ dat,
@@ -363,6 +714,36 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadBinaryUI16(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			uInt16* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryU16((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadBinaryUI16(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			Memory<UInt16> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryU16((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, (uInt16*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
 
 		int DAQmxCLIWrapper::ReadBinaryUI32(IntPtr taskHandle,
 			int32 sampsPerChan, double timeout,
@@ -378,6 +759,86 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ReadBinaryUI32(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			uInt32* data, uInt32 bufferSizeInSamples,
+			[Out] int% sampsPerChanRead) {
+
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryU32((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, data,
+				bufferSizeInSamples, &sampsPerChanReadLocal, NULL);
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadBinaryUI32(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			ReadbacklFillMode groupMode,
+			Memory<UInt32> data,
+			[Out] int% sampsPerChanRead) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int32 sampsPerChanReadLocal = 0;
+			int result = DAQmxReadBinaryU32((TaskHandle)taskHandle,
+				sampsPerChan, timeout, (bool32)groupMode, (uInt32*)handle.Pointer,
+				(uInt32)data.Length, &sampsPerChanReadLocal, NULL);
+			handle.Dispose();
+			sampsPerChanRead = sampsPerChanReadLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::ReadRaw(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			array<Byte>^ data,
+			[Out] int% sampsRead, [Out] int% bytesPerSample) {
+
+			pin_ptr<Byte> dataPtr = &data[0];
+			return ReadRaw(taskHandle, sampsPerChan, timeout,
+				dataPtr, (uInt32)data->Length, sampsRead, bytesPerSample);
+		}
+
+		int DAQmxCLIWrapper::ReadRaw(IntPtr taskHandle,
+			int32 sampsPerChan, double timeout,
+			void* data, uInt32 bufferSizeInBytes,
+			[Out] int% sampsRead, [Out] int% bytesPerSample) {
+
+			int32 sampsReadLocal = 0;
+			int32 bytesPerSampleLocal = 0;
+			int result = DAQmxReadRaw((TaskHandle)taskHandle,
+				sampsPerChan, timeout, data, bufferSizeInBytes,
+				&sampsReadLocal, &bytesPerSampleLocal, NULL);
+			sampsRead = sampsReadLocal;
+			bytesPerSample = bytesPerSampleLocal;
+			return result;
+		}
+
+		int DAQmxCLIWrapper::GetAIDevScalingCoeff(IntPtr taskHandle,
+			String^ channel,
+			[Out] array<double>^% coefficients) {
+
+			coefficients = nullptr;
+			char* channelChar = ConvertToCString(channel);
+
+			// With a NULL array DAQmx returns the number of coefficients.
+			int result = DAQmxGetAIDevScalingCoeff((TaskHandle)taskHandle,
+				channelChar, NULL, 0);
+
+			if (result > 0) {
+				array<double>^ values = gcnew array<double>(result);
+				pin_ptr<float64> valuesPtr = &values[0];
+				result = DAQmxGetAIDevScalingCoeff((TaskHandle)taskHandle,
+					channelChar, valuesPtr, (uInt32)values->Length);
+				if (result >= 0) {
+					coefficients = values;
+				}
+			}
+
+			FreeCString(channelChar);
+			return result;
+		}
+
 
 		int DAQmxCLIWrapper::CreateCOPulseFrequencyChannel(
 			IntPtr taskHandle, 
@@ -559,6 +1020,21 @@ namespace Grumpy{
 			return result;
 		}
 
+		int DAQmxCLIWrapper::ConfigureDigitalStartTrigger(IntPtr taskHandle,
+			String^ triggerSource, ActiveEdge triggerEdge) {
+
+			char * cString = ConvertToCString(triggerSource);
+			int result = DAQmxCfgDigEdgeStartTrig((TaskHandle) taskHandle,
+				cString, (int)triggerEdge);
+			FreeCString(cString);
+			return result;
+		}
+
+		int DAQmxCLIWrapper::DisableStartTrigger(IntPtr taskHandle) {
+
+			return DAQmxDisableStartTrig((TaskHandle) taskHandle);
+		}
+
 		int DAQmxCLIWrapper::TotalSamplesGenerated(IntPtr taskHandle,
 												   [Out] UInt64 data) {
 
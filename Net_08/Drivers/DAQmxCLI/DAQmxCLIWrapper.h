@@ -35,7 +35,8 @@ namespace Grumpy{
 		{
 			Done = 0,
 			EveryNSamplesReceived = 1,
-			EveryNSamplesTransferred = 2
+			EveryNSamplesTransferred = 2,
+			Signal = 3					// DAQmxRegisterSignalEvent, see ExportableSignal
 		};
 
 		public enum class AiTermination
@@ -71,6 +72,12 @@ namespace Grumpy{
 			ByScan = DAQmx_Val_GroupByScanNumber	// 1  Group by Scan Number
 		};
 
+		public enum class RegenerationMode
+		{
+			Allow = DAQmx_Val_AllowRegen,			// 10097  Allow Regeneration
+			DoNotAllow = DAQmx_Val_DoNotAllowRegen	// 10158  Do Not Allow Regeneration
+		};
+
 		public enum class TaskAction
 		{
 			Start = DAQmx_Val_Task_Start,			//	0  Start
@@ -219,6 +226,9 @@ namespace Grumpy{
 			 *         If the error code is valid, a descriptive string is returned. If the error code is not valid,
 			 *         an appropriate error message is returned.
 			 *
+			 * @note Status codes produced by the native engines (see `Native/NativeStatus.h`) are
+			 *       described without calling into DAQmx.
+			 *
 			 * @see DAQmxGetErrorString
 			 */
 			static String^ GetErrorDescription(int errorCode);
@@ -366,6 +376,32 @@ namespace Grumpy{
 					return DAQmxWaitUntilTaskDone((TaskHandle)taskHandle, 
 						timeToWait);
 			}
+
+			/**
+			* @brief Waits for the next sample clock pulse of a hardware-timed
+			*        single-point task.
+			*
+			* This function wraps the NI-DAQmx `DAQmxWaitForNextSampleClock` function. It returns when the next
+			* pulse of the sample clock arrives, or at once if the loop already missed it.
+			*
+			* @param[in] taskHandle A handle to a task configured with `SamplingMode::HWTimedSinglePoint`. This is
+			*                       passed as an `IntPtr` and cast to the NI-DAQmx `TaskHandle`.
+			* @param[in] timeout The amount of time, in seconds, to wait for the pulse.
+			* @param[out] isLate `true` if at least one sample clock pulse was missed since the previous call.
+			*
+			* @return
+			* - `0` on success.
+			* - A late warning or error (e.g. `DAQmxWarningWaitForNextSampClkDetectedMissedSampClk`) when `isLate`
+			*   is set, depending on the real-time properties of the task.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `ControlLoop` runs the whole read, compute and write cycle in native code; use this function
+			*       for loops paced from managed code at low rates.
+			*
+			* @see DAQmxWaitForNextSampleClock
+			*/
+			static int WaitForNextSampleClock(IntPtr taskHandle,
+				double timeout, [Out] bool% isLate);
 		
 			/**
 			 * @brief Configures the timing for a task's sample clock.
@@ -427,6 +463,63 @@ namespace Grumpy{
 				array<double>^ data,
 				[Out] int% samplsPerChanRead);
 
+			/**
+			* @brief Reads multiple analog samples as 64-bit floating-point numbers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<double>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadAnalogF64
+			*/
+			static int ReadAnalogF64(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				float64* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple analog samples as 64-bit floating-point numbers from a task into a `Memory<double>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadAnalogF64
+			*/
+			static int ReadAnalogF64(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				Memory<double> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			* @brief Reads a single analog sample as a 64-bit floating-point number from a task.
 			*
@@ -482,6 +575,63 @@ namespace Grumpy{
 				ReadbacklFillMode groupMode, array<int16>^ data,
 				uInt32 bufferSizeInSamples, [Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple binary samples as 16-bit signed integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<Int16>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadBinaryI16
+			*/
+			static int ReadBinaryI16(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				int16* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple binary samples as 16-bit signed integers from a task into a `Memory<Int16>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadBinaryI16
+			*/
+			static int ReadBinaryI16(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				Memory<Int16> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			* @brief Reads multiple binary samples as 16-bit unsigned integers from a task.
 			*
@@ -513,6 +663,63 @@ namespace Grumpy{
 				ReadbacklFillMode groupMode, array<uInt16>^ data,
 				uInt32 bufferSizeInSamples, [Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple binary samples as 16-bit unsigned integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<UInt16>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadBinaryU16
+			*/
+			static int ReadBinaryUI16(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				uInt16* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple binary samples as 16-bit unsigned integers from a task into a `Memory<UInt16>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadBinaryU16
+			*/
+			static int ReadBinaryUI16(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				Memory<UInt16> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			* @brief Reads multiple binary samples as 32-bit signed integers from a task.
 			*
@@ -544,6 +751,63 @@ namespace Grumpy{
 				ReadbacklFillMode groupMode, array<int32>^ data,
 				uInt32 bufferSizeInSamples, [Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple binary samples as 32-bit signed integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<Int32>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadBinaryI32
+			*/
+			static int ReadBinaryI32(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				int32* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple binary samples as 32-bit signed integers from a task into a `Memory<Int32>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadBinaryI32
+			*/
+			static int ReadBinaryI32(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				Memory<Int32> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			* @brief Reads multiple binary samples as 32-bit unsigned integers from a task.
 			*
@@ -575,6 +839,138 @@ namespace Grumpy{
 				ReadbacklFillMode groupMode, array<uInt32>^ dat,
 				uInt32 bufferSizeInSamples, [Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple binary samples as 32-bit unsigned integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<UInt32>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadBinaryU32
+			*/
+			static int ReadBinaryUI32(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				uInt32* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple binary samples as 32-bit unsigned integers from a task into a `Memory<UInt32>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] groupMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadBinaryU32
+			*/
+			static int ReadBinaryUI32(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				ReadbacklFillMode groupMode,
+				Memory<UInt32> data,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads raw samples from a task.
+			*
+			* This function wraps the NI-DAQmx `DAQmxReadRaw` function. The samples are returned exactly as the
+			* device produces them, without scaling; for analog input tasks they are interleaved by scan. Together
+			* with `RawScaler` it moves a quarter of the bytes of `ReadAnalogF64` and defers scaling to when, and
+			* for which channels, it is needed.
+			*
+			* @param[in] taskHandle A handle to the task from which to read raw samples.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[out] data A managed byte array where the raw data will be stored.
+			* @param[out] sampsRead A reference to an integer that will store the number of samples read per channel.
+			* @param[out] bytesPerSample A reference to an integer that will store the size of one raw sample, in bytes.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note The `data` array is pinned to allow the DAQmx API to access the managed memory directly.
+			*
+			* @see DAQmxReadRaw
+			*/
+			static int ReadRaw(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				array<Byte>^ data,
+				[Out] int% sampsRead, [Out] int% bytesPerSample);
+
+			/**
+			* @brief Reads raw samples from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, e.g. a `PinnedBufferPool` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read raw samples.
+			* @param[in] sampsPerChan The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[out] data Pointer to the destination buffer.
+			* @param[in] bufferSizeInBytes The size of the buffer, in bytes.
+			* @param[out] sampsRead A reference to an integer that will store the number of samples read per channel.
+			* @param[out] bytesPerSample A reference to an integer that will store the size of one raw sample, in bytes.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadRaw
+			*/
+			static int ReadRaw(IntPtr taskHandle,
+				int32 sampsPerChan, double timeout,
+				void* data, uInt32 bufferSizeInBytes,
+				[Out] int% sampsRead, [Out] int% bytesPerSample);
+
+			/**
+			* @brief Retrieves the device scaling polynomial of an analog input channel.
+			*
+			* This function wraps the NI-DAQmx `DAQmxGetAIDevScalingCoeff` function. The coefficients convert raw
+			* ADC codes, as returned by `ReadBinaryI16` or `ReadRaw`, to the units of the channel:
+			* `y = c[0] + c[1]*x + c[2]*x^2 + ...`.
+			*
+			* @param[in] taskHandle A handle to the task that contains the channel.
+			* @param[in] channel The name of the channel.
+			* @param[out] coefficients Receives a new array with the coefficients, constant term first.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note The coefficients are only final once the task is committed.
+			*
+			* @see DAQmxGetAIDevScalingCoeff
+			*/
+			static int GetAIDevScalingCoeff(IntPtr taskHandle,
+				String^ channel,
+				[Out] array<double>^% coefficients);
+
 			/**
 			* @brief Creates an analog input voltage channel in the specified task.
 			*
@@ -1098,6 +1494,63 @@ namespace Grumpy{
 				array<uInt32> ^data, uInt32 arraySize,
 				[Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple digital samples as unsigned 32-bit integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<UInt32>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] samplesPerChannel The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] interleaveMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadDigitalU32
+			*/
+			static int ReadDigitU32(IntPtr taskHandle,
+				int samplesPerChannel, double timeout,
+				ReadbacklFillMode interleaveMode,
+				uInt32* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple digital samples as unsigned 32-bit integers from a task into a `Memory<UInt32>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] samplesPerChannel The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] interleaveMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadDigitalU32
+			*/
+			static int ReadDigitU32(IntPtr taskHandle,
+				int samplesPerChannel, double timeout,
+				ReadbacklFillMode interleaveMode,
+				Memory<UInt32> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			 * @brief Reads multiple digital samples as unsigned 16-bit integers from a task.
 			 *
@@ -1131,6 +1584,63 @@ namespace Grumpy{
 				array<uInt16>^ data, uInt32 arraySize,
 				[Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple digital samples as unsigned 16-bit integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<UInt16>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] samplesPerChannel The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] interleaveMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadDigitalU16
+			*/
+			static int ReadDigitU16(IntPtr taskHandle,
+				int samplesPerChannel, double timeout,
+				ReadbacklFillMode interleaveMode,
+				uInt16* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple digital samples as unsigned 16-bit integers from a task into a `Memory<UInt16>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] samplesPerChannel The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] interleaveMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadDigitalU16
+			*/
+			static int ReadDigitU16(IntPtr taskHandle,
+				int samplesPerChannel, double timeout,
+				ReadbacklFillMode interleaveMode,
+				Memory<UInt16> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			* @brief Reads multiple digital samples as unsigned 8-bit integers from a task.
 			*
@@ -1164,6 +1674,63 @@ namespace Grumpy{
 				array<uInt8>^ data, uInt32 arraySize,
 				[Out] int% sampsPerChanRead);
 
+			/**
+			* @brief Reads multiple digital samples as unsigned 8-bit integers from a task into native memory.
+			*
+			* Same as the array overload, but `data` is a caller-owned pointer, so
+			* nothing is allocated or pinned per call. Use it with buffers rented
+			* from a `PinnedBufferPool`, with native memory, or from C# with a
+			* `fixed` statement over an array, `Span<Byte>` or `stackalloc` buffer.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] samplesPerChannel The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] interleaveMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data Pointer to the first element of the destination buffer.
+			* @param[in] bufferSizeInSamples The size of the buffer, in samples.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxReadDigitalU8
+			*/
+			static int ReadDigitU8(IntPtr taskHandle,
+				int samplesPerChannel, double timeout,
+				ReadbacklFillMode interleaveMode,
+				uInt8* data, uInt32 bufferSizeInSamples,
+				[Out] int% sampsPerChanRead);
+
+			/**
+			* @brief Reads multiple digital samples as unsigned 8-bit integers from a task into a `Memory<Byte>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size. Lets callers reuse one buffer,
+			* or a slice of a larger one, instead of a fresh array per read.
+			*
+			* @param[in] taskHandle A handle to the task from which to read.
+			* @param[in] samplesPerChannel The number of samples to read per channel.
+			* @param[in] timeout The amount of time, in seconds, to wait for the function to read the requested samples.
+			* @param[in] interleaveMode Specifies whether the data is grouped by channel or interleaved.
+			* @param[out] data The destination buffer.
+			* @param[out] sampsPerChanRead A reference to an integer that will store the number of samples read per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @note `Span<T>` cannot appear in a C++/CLI signature; from a span use
+			*       the pointer overload inside a `fixed` statement.
+			*
+			* @see DAQmxReadDigitalU8
+			*/
+			static int ReadDigitU8(IntPtr taskHandle,
+				int samplesPerChannel, double timeout,
+				ReadbacklFillMode interleaveMode,
+				Memory<Byte> data,
+				[Out] int% sampsPerChanRead);
+
 			/**
 			* @brief Writes multiple digital samples to a task.
 			*
@@ -1197,6 +1764,123 @@ namespace Grumpy{
 				array<Byte>^ data,
 				[Out] int% sampsPerChanWritten);
 
+			/**
+			* @brief Reads digital lines from a task into packed bits, one bit per line.
+			*
+			* Same samples and layout as `ReadDigitalLines`, with each line byte
+			* replaced by one bit: bit `n` of the stream is bit `n % 8` of byte
+			* `n / 8`. A 32-line port read by scan takes 4 bytes per sample
+			* instead of 32. The lines are read in cache-sized chunks and packed
+			* in native code with SIMD kernels, so the byte array is never
+			* materialized.
+			*
+			* @param[in] taskHandle A handle to the task from which to read digital lines.
+			* @param[in] numSampsPerChan The number of samples to read per channel; must be positive.
+			* @param[in] timeout Timeout of the whole read, in seconds.
+			* @param[in] interleaveMode Specifies whether the data is interleaved or grouped by channel.
+			*            Grouped by channel, channel `c` starts at bit
+			*            `c * numSampsPerChan * linesPerChannel`.
+			* @param[out] data The destination buffer.
+			* @param[in] bufferSizeInBytes The size of `data`; see `GetPackedDigitalLinesSize`.
+			* @param[out] sampsPerChanRead The number of samples read per channel.
+			* @param[out] linesPerChannel The number of lines (bits) per channel and sample.
+			*
+			* @return
+			* - `0` on success.
+			* - A DAQmx error code, or `NativeErrorInvalidArgument` / `NativeErrorBufferTooSmall`.
+			*
+			* @see DAQmxReadDigitalLines
+			*/
+			static int ReadDigitalLinesPacked(IntPtr taskHandle,
+				int32 numSampsPerChan, double timeout,
+				ReadbacklFillMode interleaveMode,
+				uInt8* data, uInt32 bufferSizeInBytes,
+				[Out] int% sampsPerChanRead,
+				[Out] int% linesPerChannel);
+
+			/**
+			* @brief Reads digital lines from a task into packed bits in a `Memory<Byte>`.
+			*
+			* The memory is pinned only for the duration of the call and its
+			* `Length` is used as the buffer size.
+			*
+			* @see ReadDigitalLinesPacked
+			*/
+			static int ReadDigitalLinesPacked(IntPtr taskHandle,
+				int32 numSampsPerChan, double timeout,
+				ReadbacklFillMode interleaveMode,
+				Memory<Byte> data,
+				[Out] int% sampsPerChanRead,
+				[Out] int% linesPerChannel);
+
+			/**
+			* @brief Writes digital lines to a task from packed bits, one bit per line.
+			*
+			* The packed counterpart of `WriteDigitalLines`; the bits are laid
+			* out as for `ReadDigitalLinesPacked`, with the lines per channel of
+			* the task's output channels.
+			*
+			* @param[in] taskHandle A handle to the task to which the lines will be written.
+			* @param[in] numSampsPerChan The number of samples to write per channel.
+			* @param[in] autoStart `true` to start the task after writing the samples.
+			* @param[in] timeout The time, in seconds, to wait for the write to complete.
+			* @param[in] interleaveMode Specifies whether the data is interleaved or grouped by channel.
+			* @param[in] data The packed lines.
+			* @param[in] bufferSizeInBytes The size of `data`.
+			* @param[out] sampsPerChanWritten The number of samples written per channel.
+			*
+			* @return
+			* - `0` on success.
+			* - A DAQmx error code, or `NativeErrorInvalidArgument`,
+			*   `NativeErrorBufferTooSmall` / `NativeErrorOutOfMemory`.
+			*
+			* @see DAQmxWriteDigitalLines
+			*/
+			static int WriteDigitalLinesPacked(IntPtr taskHandle,
+				int32 numSampsPerChan, bool autoStart, double timeout,
+				ReadbacklFillMode interleaveMode,
+				const uInt8* data, uInt32 bufferSizeInBytes,
+				[Out] int% sampsPerChanWritten);
+
+			/**
+			* @brief Writes digital lines to a task from packed bits in a `Memory<Byte>`.
+			*
+			* @see WriteDigitalLinesPacked
+			*/
+			static int WriteDigitalLinesPacked(IntPtr taskHandle,
+				int32 numSampsPerChan, bool autoStart, double timeout,
+				ReadbacklFillMode interleaveMode,
+				Memory<Byte> data,
+				[Out] int% sampsPerChanWritten);
+
+			/**
+			* @brief Bytes needed for `samplesPerChannel` packed samples of
+			*        `channels` channels with `linesPerChannel` lines each.
+			*/
+			static int GetPackedDigitalLinesSize(int channels, int linesPerChannel,
+				int samplesPerChannel);
+
+			/**
+			* @brief Packs line bytes (as read by `ReadDigitalLines`; non-zero is
+			*        high) into bits `bitOffset` .. `bitOffset + lines.Length - 1`
+			*        of `bits`. Bits outside that range are left unchanged.
+			*
+			* @return `0`, `NativeErrorBufferTooSmall` if `bits` is too short, or
+			*         `NativeErrorInvalidArgument` for a negative `bitOffset`.
+			*/
+			static int PackDigitalLines(Memory<Byte> lines, Memory<Byte> bits,
+				int bitOffset);
+
+			/**
+			* @brief Expands `lines.Length` bits of `bits`, starting at bit
+			*        `bitOffset`, into one byte of 0 or 1 per line.
+			*
+			* @return `0`, `NativeErrorBufferTooSmall` if `bits` is too short, or
+			*         `NativeErrorInvalidArgument` for a negative `bitOffset`.
+			*/
+			static int UnpackDigitalLines(Memory<Byte> bits, int bitOffset,
+				Memory<Byte> lines);
+
 			/**
 			* @brief Writes a single digital sample as an unsigned 32-bit integer to a task.
 			*
@@ -1317,6 +2001,93 @@ namespace Grumpy{
 				ReadbacklFillMode interleaveMode, 
 				array<uInt32>^ data, [Out] int% samplesPerChannelWritten);
 
+			/**
+			 * @brief Writes multiple analog samples as 64-bit floating point values to a task.
+			 *
+			 * This function wraps the NI-DAQmx `DAQmxWriteAnalogF64` function to write scaled samples to the analog
+			 * output channels of the specified task.
+			 *
+			 * @param[in] taskHandle A handle to the task to which samples will be written. This is passed as an `IntPtr`
+			 *                       and cast to the NI-DAQmx `TaskHandle`.
+			 * @param[in] numSampsPerChan The number of samples to write per channel.
+			 * @param[in] autoStart `true` to start the task after writing the samples, `false` otherwise.
+			 * @param[in] timeout The time, in seconds, to wait for room in the output buffer.
+			 * @param[in] interleaveMode Specifies whether the data is interleaved or organized by channel.
+			 * @param[in] data A managed .NET array with at least `numSampsPerChan` samples per channel.
+			 * @param[out] samplesPerChannelWritten The number of samples written per channel.
+			 *
+			 * @return
+			 * - `0` on success.
+			 * - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			 *
+			 * @note The `data` array is pinned to ensure that the DAQmx API can access the managed memory directly.
+			 *
+			 * @see DAQmxWriteAnalogF64
+			 */
+			static int WriteAnalogF64(IntPtr taskHandle, int32 numSampsPerChan,
+				bool autoStart, double timeout,
+				ReadbacklFillMode interleaveMode,
+				array<float64>^ data, [Out] int% samplesPerChannelWritten);
+
+			/**
+			 * @brief Writes multiple analog samples as raw 16-bit DAC codes to a task.
+			 *
+			 * This function wraps the NI-DAQmx `DAQmxWriteBinaryI16` function. The codes are written unscaled; see
+			 * `DAQmxCLIWrapper::GetAIDevScalingCoeff` and the raw scaler for the conversion from volts.
+			 *
+			 * @param[in] taskHandle A handle to the task to which samples will be written.
+			 * @param[in] numSampsPerChan The number of samples to write per channel.
+			 * @param[in] autoStart `true` to start the task after writing the samples, `false` otherwise.
+			 * @param[in] timeout The time, in seconds, to wait for room in the output buffer.
+			 * @param[in] interleaveMode Specifies whether the data is interleaved or organized by channel.
+			 * @param[in] data A managed .NET array with at least `numSampsPerChan` samples per channel.
+			 * @param[out] samplesPerChannelWritten The number of samples written per channel.
+			 *
+			 * @return
+			 * - `0` on success.
+			 * - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			 *
+			 * @see DAQmxWriteBinaryI16
+			 */
+			static int WriteBinaryI16(IntPtr taskHandle, int32 numSampsPerChan,
+				bool autoStart, double timeout,
+				ReadbacklFillMode interleaveMode,
+				array<int16>^ data, [Out] int% samplesPerChannelWritten);
+
+			/**
+			 * @brief Sets the size of the output buffer of a task.
+			 *
+			 * This function wraps the NI-DAQmx `DAQmxCfgOutputBuffer` function. Call it before the first write; by default
+			 * the buffer holds the samples of the first write.
+			 *
+			 * @param[in] taskHandle A handle to the task.
+			 * @param[in] samplesPerChannel The size of the buffer, in samples per channel.
+			 *
+			 * @return
+			 * - `0` on success.
+			 * - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			 *
+			 * @see DAQmxCfgOutputBuffer
+			 */
+			static int ConfigureOutputBuffer(IntPtr taskHandle, uInt32 samplesPerChannel);
+
+			/**
+			 * @brief Sets whether the device may generate the samples of its buffer again.
+			 *
+			 * This function wraps the NI-DAQmx `DAQmxSetWriteRegenMode` function. With `RegenerationMode::DoNotAllow` a
+			 * continuous generation stops with an error when the application does not write new samples in time.
+			 *
+			 * @param[in] taskHandle A handle to the task.
+			 * @param[in] mode The regeneration mode.
+			 *
+			 * @return
+			 * - `0` on success.
+			 * - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			 *
+			 * @see DAQmxSetWriteRegenMode
+			 */
+			static int SetWriteRegenerationMode(IntPtr taskHandle, RegenerationMode mode);
+
 			/**
 			* @brief Configures the task to export a specific signal to an external terminal.
 			*
@@ -1341,6 +2112,42 @@ namespace Grumpy{
 			static int ExportSignal(IntPtr taskHandle, ExportableSignal signal, 
 				String^ outputTerminal);
 
+			/**
+			* @brief Configures the task to start on a digital edge.
+			*
+			* This function wraps the NI-DAQmx `DAQmxCfgDigEdgeStartTrig` function. Together with `ExportSignal` it lets
+			* several tasks start on the same edge, e.g. the start trigger of another task exported to a PFI or RTSI line.
+			*
+			* @param[in] taskHandle A handle to the task to configure. This is passed as an `IntPtr` and cast to the
+			*                       NI-DAQmx `TaskHandle`.
+			* @param[in] triggerSource The terminal of the digital signal, e.g. `/Dev1/PFI0`.
+			* @param[in] triggerEdge The edge that starts the task, specified using the `ActiveEdge` enum.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxCfgDigEdgeStartTrig
+			*/
+			static int ConfigureDigitalStartTrigger(IntPtr taskHandle,
+				String^ triggerSource, ActiveEdge triggerEdge);
+
+			/**
+			* @brief Makes the task start as soon as it is started, without a trigger.
+			*
+			* This function wraps the NI-DAQmx `DAQmxDisableStartTrig` function.
+			*
+			* @param[in] taskHandle A handle to the task. This is passed as an `IntPtr` and cast to the NI-DAQmx
+			*                       `TaskHandle`.
+			*
+			* @return
+			* - `0` on success.
+			* - Non-zero error code on failure. The error code corresponds to DAQmx status codes.
+			*
+			* @see DAQmxDisableStartTrig
+			*/
+			static int DisableStartTrigger(IntPtr taskHandle);
+
 			/**
 			* @brief Retrieves the total number of samples generated by the task.
 			*
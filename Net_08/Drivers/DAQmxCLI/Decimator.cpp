@@ -0,0 +1,249 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Decimator.h"
+#include "AcquisitionEngine.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		DecimatorConfiguration::DecimatorConfiguration() {
+
+			Native::DecimatorConfig defaults = Native::DefaultDecimatorConfig();
+
+			Channels = (int)defaults.channels;
+			Factor = (int)defaults.factor;
+			MaxSamplesPerChannel = (int)defaults.maxSamplesPerChannel;
+			TapsPerPhase = (int)defaults.tapsPerPhase;
+			Passband = defaults.passband;
+		}
+
+		Native::DecimatorConfig DecimatorConfiguration::ToNative() {
+
+			Native::DecimatorConfig config = Native::DefaultDecimatorConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.factor = (uInt32)Math::Max(Factor, 0);
+			config.maxSamplesPerChannel = (uInt32)Math::Max(MaxSamplesPerChannel, 0);
+			config.tapsPerPhase = (uInt32)Math::Max(TapsPerPhase, 0);
+			config.passband = Passband;
+			return config;
+		}
+
+
+		Decimator::Decimator() {
+			_core = new Native::DecimatorCore();
+		}
+
+		Decimator::~Decimator() {
+			this->!Decimator();
+		}
+
+		Decimator::!Decimator() {
+
+			// The engine must stop calling the core before it goes.
+			if (_engine != nullptr) {
+				_engine->_ReleaseStage();
+			}
+
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int Decimator::Configure(DecimatorConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			int result = _core->Configure(configuration->ToNative());
+
+			// A scaler for a different channel count no longer applies.
+			if (_scaler != nullptr && _core->SetScaling(_scaler->_GetCore()) != Native::NativeSuccess) {
+				_core->SetScaling(nullptr);
+				_scaler = nullptr;
+			}
+			return result;
+		}
+
+		int Decimator::SetChannelFir(int channel, array<double>^ taps) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0 || taps == nullptr || taps->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<float64> tapsPtr = &taps[0];
+			return _core->SetChannelFir((uInt32)channel, tapsPtr, (uInt32)taps->Length);
+		}
+
+		int Decimator::SetChannelCic(int channel, int stages) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0 || stages <= 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->SetChannelCic((uInt32)channel, (uInt32)stages);
+		}
+
+		array<double>^ Decimator::GetChannelTaps(int channel) {
+
+			if (_core == nullptr || channel < 0) {
+				return nullptr;
+			}
+
+			int32 count = _core->GetChannelTaps((uInt32)channel, nullptr, 0);
+			if (count <= 0) {
+				return nullptr;
+			}
+
+			array<double>^ taps = gcnew array<double>(count);
+			pin_ptr<float64> tapsPtr = &taps[0];
+			_core->GetChannelTaps((uInt32)channel, tapsPtr, (uInt32)count);
+			return taps;
+		}
+
+		int Decimator::SetScaling(RawScaler^ scaler) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			int result = _core->SetScaling((scaler != nullptr) ? scaler->_GetCore() : nullptr);
+
+			if (result == Native::NativeSuccess) {
+				_scaler = scaler;
+			}
+			return result;
+		}
+
+		void Decimator::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		int Decimator::Factor::get() {
+			return (_core != nullptr && _core->IsConfigured()) ? (int)_core->Config().factor : 0;
+		}
+
+		UInt64 Decimator::OutputPosition::get() {
+			return (_core != nullptr) ? _core->OutputPosition() : 0;
+		}
+
+		int Decimator::MaxOutputSamples(int samplesPerChannel) {
+			return (_core != nullptr && samplesPerChannel > 0)
+				? (int)_core->MaxOutputSamples((uInt32)samplesPerChannel) : 0;
+		}
+
+		int Decimator::_CheckArrays(Array^ input, int samplesPerChannel, Array^ output) {
+
+			if (_core == nullptr || !_core->IsConfigured()) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (input == nullptr || output == nullptr || input->Length == 0
+				|| output->Length == 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if ((Int64)input->Length < (Int64)_core->Config().channels * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+			return Native::NativeSuccess;
+		}
+
+		int Decimator::Process(array<double>^ input, int samplesPerChannel,
+			ReadbacklFillMode inputFillMode, array<double>^ output,
+			ReadbacklFillMode outputFillMode) {
+
+			int result = _CheckArrays(input, samplesPerChannel, output);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<double> inputPtr = &input[0];
+			pin_ptr<double> outputPtr = &output[0];
+			uInt32 produced = 0;
+
+			result = _core->Process(inputPtr, (uInt32)samplesPerChannel,
+				(int32)inputFillMode, outputPtr, (size_t)output->Length,
+				(int32)outputFillMode, produced);
+
+			return (result < 0) ? result : (int)produced;
+		}
+
+		int Decimator::Process(array<Int16>^ input, int samplesPerChannel,
+			ReadbacklFillMode inputFillMode, array<double>^ output,
+			ReadbacklFillMode outputFillMode) {
+
+			int result = _CheckArrays(input, samplesPerChannel, output);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<Int16> inputPtr = &input[0];
+			pin_ptr<double> outputPtr = &output[0];
+			uInt32 produced = 0;
+
+			result = _core->Process(inputPtr, (uInt32)samplesPerChannel,
+				(int32)inputFillMode, outputPtr, (size_t)output->Length,
+				(int32)outputFillMode, produced);
+
+			return (result < 0) ? result : (int)produced;
+		}
+
+		int Decimator::Process(array<Int16>^ input, int samplesPerChannel,
+			ReadbacklFillMode inputFillMode, array<Int16>^ output,
+			ReadbacklFillMode outputFillMode) {
+
+			int result = _CheckArrays(input, samplesPerChannel, output);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<Int16> inputPtr = &input[0];
+			pin_ptr<Int16> outputPtr = &output[0];
+			uInt32 produced = 0;
+
+			result = _core->Process(inputPtr, (uInt32)samplesPerChannel,
+				(int32)inputFillMode, outputPtr, (size_t)output->Length,
+				(int32)outputFillMode, produced);
+
+			return (result < 0) ? result : (int)produced;
+		}
+
+		Native::DecimatorCore* Decimator::_GetCore() {
+			return _core;
+		}
+	}
+}
@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "RawScaler.h"
+#include "Native/DecimatorCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		ref class AcquisitionEngine;
+
+		/**
+		* @brief Settings of a `Decimator`.
+		*/
+		public ref class DecimatorConfiguration
+		{
+		public:
+			DecimatorConfiguration();
+
+			/** Number of channels in each block. */
+			property int Channels;
+
+			/** Decimation factor, shared by all channels. */
+			property int Factor;
+
+			/** Largest block accepted, in samples per channel. */
+			property int MaxSamplesPerChannel;
+
+			/** Length of the default low-pass filter, in taps per phase. */
+			property int TapsPerPhase;
+
+			/** Cutoff of the default low-pass filter as a fraction of the
+			*   output Nyquist frequency, in (0, 1). */
+			property double Passband;
+
+		internal:
+			Native::DecimatorConfig ToNative();
+		};
+
+		/**
+		* @brief Native polyphase FIR / CIC decimator.
+		*
+		* Filters and decimates blocks of `ReadAnalogF64` or `ReadBinaryI16`
+		* data with SIMD kernels, keeping the filter state from one block to
+		* the next. Use it directly on arrays, or give it to
+		* `AcquisitionEngine::SetDecimator` to decimate every block on the
+		* driver thread before it reaches managed code.
+		*
+		* Methods return `0` on success or a status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class Decimator
+		{
+		private:
+			Native::DecimatorCore* _core;
+			RawScaler^ _scaler;
+
+		public:
+			Decimator();
+			~Decimator();
+			!Decimator();
+
+			/**
+			* @brief Allocates the filter state and gives every channel the
+			*        default low-pass filter.
+			*/
+			int Configure(DecimatorConfiguration^ configuration);
+
+			/**
+			* @brief Replaces the filter of one channel.
+			*/
+			int SetChannelFir(int channel, array<double>^ taps);
+
+			/**
+			* @brief Gives one channel a CIC filter with `stages` stages.
+			*/
+			int SetChannelCic(int channel, int stages);
+
+			/**
+			* @brief Taps of one channel, or `nullptr`.
+			*/
+			array<double>^ GetChannelTaps(int channel);
+
+			/**
+			* @brief Scales I16 input with `scaler` when the output is F64;
+			*        `nullptr` filters the raw codes.
+			*/
+			int SetScaling(RawScaler^ scaler);
+
+			/**
+			* @brief Clears the filter history and the phase.
+			*/
+			void Reset();
+
+			property int Factor {
+				int get();
+			}
+
+			/**
+			* @brief Index of the next output sample since the last reset.
+			*/
+			property UInt64 OutputPosition {
+				UInt64 get();
+			}
+
+			/**
+			* @brief Output size, in samples per channel, sufficient for an input
+			*        block of `samplesPerChannel` samples.
+			*/
+			int MaxOutputSamples(int samplesPerChannel);
+
+			/**
+			* @brief Filters and decimates one block.
+			*
+			* @param[in] input `Channels * samplesPerChannel` samples.
+			* @param[in] samplesPerChannel Samples per channel in `input`.
+			* @param[in] inputFillMode Layout of `input`.
+			* @param[out] output Decimated block.
+			* @param[in] outputFillMode Layout of `output`.
+			*
+			* @return Samples per channel written to `output`, or a negative
+			*         status code.
+			*/
+			int Process(array<double>^ input, int samplesPerChannel,
+				ReadbacklFillMode inputFillMode, array<double>^ output,
+				ReadbacklFillMode outputFillMode);
+
+			/**
+			* @brief Filters raw codes into F64, scaled if `SetScaling` was given
+			*        a scaler.
+			*/
+			int Process(array<Int16>^ input, int samplesPerChannel,
+				ReadbacklFillMode inputFillMode, array<double>^ output,
+				ReadbacklFillMode outputFillMode);
+
+			/**
+			* @brief Filters raw codes into raw codes, rounded and saturated.
+			*/
+			int Process(array<Int16>^ input, int samplesPerChannel,
+				ReadbacklFillMode inputFillMode, array<Int16>^ output,
+				ReadbacklFillMode outputFillMode);
+
+		internal:
+			Native::DecimatorCore* _GetCore();
+
+			/** The engine running this stage, if any; see `AcquisitionEngine::_ReleaseStage`. */
+			AcquisitionEngine^ _engine;
+
+		private:
+			int _CheckArrays(Array^ input, int samplesPerChannel, Array^ output);
+		};
+	}
+}
@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "EdgeExtractor.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		EdgeExtractorConfiguration::EdgeExtractorConfiguration() {
+
+			Native::EdgeExtractorConfig defaults = Native::DefaultEdgeExtractorConfig();
+
+			Channels = (int)defaults.channels;
+			SampleBytes = (int)defaults.sampleBytes;
+			Mask = defaults.mask;
+			MaxSamplesPerChannel = (int)defaults.maxSamplesPerChannel;
+			Capacity = (int)defaults.capacity;
+		}
+
+		Native::EdgeExtractorConfig EdgeExtractorConfiguration::ToNative() {
+
+			Native::EdgeExtractorConfig config = Native::DefaultEdgeExtractorConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.sampleBytes = (uInt32)Math::Max(SampleBytes, 0);
+			config.mask = Mask;
+			config.maxSamplesPerChannel = (uInt32)Math::Max(MaxSamplesPerChannel, 0);
+			config.capacity = (uInt32)Math::Max(Capacity, 0);
+			return config;
+		}
+
+
+		EdgeExtractor::EdgeExtractor() {
+			_core = new Native::EdgeExtractorCore();
+		}
+
+		EdgeExtractor::~EdgeExtractor() {
+			this->!EdgeExtractor();
+		}
+
+		EdgeExtractor::!EdgeExtractor() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int EdgeExtractor::Configure(EdgeExtractorConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->Configure(configuration->ToNative());
+		}
+
+		void EdgeExtractor::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		int EdgeExtractor::Process(Memory<Byte> data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int result = _Process(handle.Pointer, data.Length, 1, samplesPerChannel, fillMode);
+			handle.Dispose();
+			return result;
+		}
+
+		int EdgeExtractor::Process(Memory<UInt16> data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int result = _Process(handle.Pointer, data.Length, 2, samplesPerChannel, fillMode);
+			handle.Dispose();
+			return result;
+		}
+
+		int EdgeExtractor::Process(Memory<UInt32> data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int result = _Process(handle.Pointer, data.Length, 4, samplesPerChannel, fillMode);
+			handle.Dispose();
+			return result;
+		}
+
+		int EdgeExtractor::_Process(const void* data, Int64 length, int sampleBytes,
+			int samplesPerChannel, ReadbacklFillMode fillMode) {
+
+			if (_core == nullptr || !_core->IsConfigured()) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if ((int)_core->Config().sampleBytes != sampleBytes) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if (length < (Int64)_core->Config().channels * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			return _core->Process(data, (uInt32)samplesPerChannel, (int32)fillMode);
+		}
+
+		int EdgeExtractor::ReadTransitions(array<DigitalTransition>^ transitions) {
+
+			if (_core == nullptr || transitions == nullptr) {
+				return 0;
+			}
+
+			const int batchSize = 256;
+			Native::DigitalTransition batch[batchSize];
+			int total = 0;
+
+			while (total < transitions->Length) {
+
+				const size_t n = _core->ReadTransitions(batch,
+					(size_t)Math::Min(batchSize, transitions->Length - total));
+
+				for (size_t k = 0; k < n; k++) {
+					DigitalTransition% t = transitions[total++];
+					t.SampleIndex = batch[k].sampleIndex;
+					t.Channel = (int)batch[k].channel;
+					t.Value = batch[k].value;
+					t.Changed = batch[k].changed;
+				}
+
+				if (n < (size_t)batchSize) {
+					break;
+				}
+			}
+			return total;
+		}
+
+		int EdgeExtractor::PendingTransitions::get() {
+			return (_core != nullptr) ? (int)_core->PendingTransitions() : 0;
+		}
+
+		UInt64 EdgeExtractor::SamplesScanned::get() {
+			return (_core != nullptr) ? _core->Counters().samplesScanned : 0;
+		}
+
+		UInt64 EdgeExtractor::Transitions::get() {
+			return (_core != nullptr) ? _core->Counters().transitions : 0;
+		}
+
+		UInt64 EdgeExtractor::TransitionsDropped::get() {
+			return (_core != nullptr) ? _core->Counters().transitionsDropped : 0;
+		}
+
+		Native::EdgeExtractorCore* EdgeExtractor::_GetCore() {
+			return _core;
+		}
+	}
+}
@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "Native/EdgeExtractorCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief A change of the lines of one digital channel.
+		*/
+		public value struct DigitalTransition
+		{
+			/** Index, per channel, of the first sample with the new value. */
+			UInt64 SampleIndex;
+
+			int Channel;
+
+			/** Value of the watched lines from `SampleIndex` on. */
+			UInt32 Value;
+
+			/** Lines that changed. */
+			UInt32 Changed;
+		};
+
+		/**
+		* @brief Settings of an `EdgeExtractor`.
+		*/
+		public ref class EdgeExtractorConfiguration
+		{
+		public:
+			EdgeExtractorConfiguration();
+
+			/** Number of channels in each block. */
+			property int Channels;
+
+			/** Bytes per sample: 1, 2 or 4, for `ReadDigitU8`, `U16` or `U32`. */
+			property int SampleBytes;
+
+			/** Lines watched; the other lines are ignored. */
+			property UInt32 Mask;
+
+			/** Largest block accepted, in samples per channel. */
+			property int MaxSamplesPerChannel;
+
+			/** Transitions kept until they are read. */
+			property int Capacity;
+
+		internal:
+			Native::EdgeExtractorConfig ToNative();
+		};
+
+		/**
+		* @brief Turns digital samples into transition records: sample index,
+		*        new value and changed lines.
+		*
+		* Feed it the blocks read with `DAQmxCLIWrapper::ReadDigitU8`, `U16`
+		* or `U32`; they are scanned in native code with SIMD kernels and
+		* only the transitions come back, so for signals that change rarely
+		* compared to the sample clock the managed side handles a few records
+		* instead of every word. Every channel starts with all lines low. Use
+		* a `TransitionWriter` to store them.
+		*
+		* Methods return `0` on success or a status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class EdgeExtractor
+		{
+		private:
+			Native::EdgeExtractorCore* _core;
+
+		public:
+			EdgeExtractor();
+			~EdgeExtractor();
+			!EdgeExtractor();
+
+			/**
+			* @brief Allocates the buffers and resets.
+			*/
+			int Configure(EdgeExtractorConfiguration^ configuration);
+
+			/**
+			* @brief Clears the channel states, the counters and the pending
+			*        transitions.
+			*/
+			void Reset();
+
+			/**
+			* @brief Scans one block of `U8` samples.
+			*
+			* @return The number of transitions in the block, or a negative
+			*         status code.
+			*/
+			int Process(Memory<Byte> data, int samplesPerChannel, ReadbacklFillMode fillMode);
+
+			/** Same as the `U8` overload for `U16` samples. */
+			int Process(Memory<UInt16> data, int samplesPerChannel, ReadbacklFillMode fillMode);
+
+			/** Same as the `U8` overload for `U32` samples. */
+			int Process(Memory<UInt32> data, int samplesPerChannel, ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Moves the oldest pending transitions into `transitions`.
+			*
+			* @return The number of transitions moved.
+			*/
+			int ReadTransitions(array<DigitalTransition>^ transitions);
+
+			property int PendingTransitions {
+				int get();
+			}
+
+			/** Samples per channel processed since the last reset. */
+			property UInt64 SamplesScanned {
+				UInt64 get();
+			}
+
+			property UInt64 Transitions {
+				UInt64 get();
+			}
+
+			/** Transitions lost because they were not read in time. */
+			property UInt64 TransitionsDropped {
+				UInt64 get();
+			}
+
+		internal:
+			Native::EdgeExtractorCore* _GetCore();
+
+		private:
+			int _Process(const void* data, Int64 length, int sampleBytes,
+				int samplesPerChannel, ReadbacklFillMode fillMode);
+		};
+	}
+}
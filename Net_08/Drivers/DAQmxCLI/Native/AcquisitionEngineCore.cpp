@@ -0,0 +1,647 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AcquisitionEngineCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+
+#include "AlignedMemory.h"
+#include "BlockStatisticsCore.h"
+#include "CallbackRegistry.h"
+#include "ClockDriftEstimatorCore.h"
+#include "DecimatorCore.h"
+#include "HostClock.h"
+#include "NativeStatus.h"
+#include "SoftwareTriggerCore.h"
+#include "SpscRing.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			struct BlockHeader {
+				uInt32 samplesPerChannel;
+				int32 status;
+				uInt64 firstSample;
+				uInt64 sequence;
+				int64 hostTimestampNs;
+				uInt64 samplesAcquired;
+			};
+
+			struct AcquisitionEngineCore::Impl {
+
+				TaskHandle task;
+				AcquisitionEngineConfig config;
+				SpscBlockRing<BlockHeader> ring;
+
+				// Used when the ring is full so the device buffer is still drained,
+				// and as the staging buffer of the fill mode conversion.
+				void* scratch;
+				uInt32 blockSamples;
+				size_t sampleSize;
+				int32 deliveredFillMode;
+				bool convertLayout;
+
+				// Optional filter stage; the sink takes the output of blocks
+				// dropped because the ring was full.
+				DecimatorCore* decimator;
+				void* decimatorSink;
+
+				// Optional statistics and trigger over the blocks as read.
+				BlockStatisticsCore* statistics;
+				SoftwareTriggerCore* trigger;
+
+				// Optional fit of the host clock against the sample clock.
+				ClockDriftEstimatorCore* clockEstimator;
+
+				std::atomic<bool> running;
+				std::atomic<bool> attached;
+
+				// Passed to DAQmx as callbackData; `0` while detached.
+				CallbackKey key;
+
+				// Detached from a callback, which `Synchronize` cannot wait
+				// for: a callback may still be inside `ReadBlock`.
+				bool unsettled;
+
+				// Written by the callback thread only.
+				std::atomic<uInt64> blocksRead;
+				std::atomic<uInt64> blocksDropped;
+				std::atomic<uInt64> readErrors;
+				std::atomic<int32> lastError;
+				uInt64 samplesAcquired;
+
+				// Consumer wake-up. The callback only takes the mutex when a
+				// consumer announced that it is waiting.
+				std::atomic<int32> waiters;
+				std::mutex waitMutex;
+				std::condition_variable waitCondition;
+
+				Impl() :
+					task(NULL), config(DefaultAcquisitionEngineConfig()),
+					scratch(nullptr), blockSamples(0), sampleSize(0),
+					deliveredFillMode(DAQmx_Val_GroupByChannel), convertLayout(false),
+					decimator(nullptr), decimatorSink(nullptr), statistics(nullptr),
+					trigger(nullptr), clockEstimator(nullptr), running(false), attached(false),
+					key(0), unsettled(false), blocksRead(0), blocksDropped(0), readErrors(0), lastError(0),
+					samplesAcquired(0), waiters(0) {}
+
+				~Impl() {
+					AlignedFree(scratch);
+					AlignedFree(decimatorSink);
+				}
+
+				static int32 CVICALLBACK OnEveryNSamples(TaskHandle /*taskHandle*/,
+					int32 /*everyNsamplesEventType*/, uInt32 /*nSamples*/,
+					void* callbackData) {
+
+					// The key no longer resolves once `Detach` released it.
+					CallbackEpochGuard guard;
+					Impl* impl = static_cast<Impl*>(CallbackRegistry::Instance().Owner(
+						reinterpret_cast<CallbackKey>(callbackData)));
+
+					if (impl != nullptr) {
+						impl->ReadBlock();
+					}
+					return 0;
+				}
+
+				void ReadBlock() {
+
+					if (!running.load(std::memory_order_acquire)) {
+						return;
+					}
+
+					// Taken before the read, whose duration varies with the
+					// block size and the format.
+					const int64 entryNs = HostMonotonicNs();
+					uInt64 totalAcquired = 0;
+
+					if (DAQmxGetReadTotalSampPerChanAcquired(task, &totalAcquired) < 0) {
+						totalAcquired = 0;
+					}
+					else if (clockEstimator != nullptr) {
+						clockEstimator->AddObservation(totalAcquired, entryNs);
+					}
+
+					BlockHeader* header = nullptr;
+					uint8_t* slot = ring.BeginWrite(header);
+					const bool dropped = (slot == nullptr);
+					void* target = (dropped || convertLayout || decimator != nullptr)
+						? scratch : static_cast<void*>(slot);
+
+					int32 read = 0;
+					int32 status = ReadSamples(task, config.format,
+						(int32)config.samplesPerBlock, config.readTimeout,
+						config.fillMode, target, blockSamples, &read);
+
+					if (status < 0) {
+						readErrors.fetch_add(1, std::memory_order_relaxed);
+						lastError.store(status, std::memory_order_relaxed);
+					}
+
+					uInt64 first = samplesAcquired;
+					samplesAcquired += (read > 0) ? (uInt64)read : 0;
+
+					if (statistics != nullptr && read > 0) {
+						statistics->Accumulate(target, config.format, (uInt32)read, config.fillMode);
+					}
+
+					if (trigger != nullptr && read > 0) {
+						trigger->Process(target, (uInt32)read, config.fillMode);
+					}
+
+					if (decimator != nullptr) {
+						first = decimator->OutputPosition();
+						read = Decimate(read, dropped ? decimatorSink : slot, status);
+					}
+
+					if (dropped) {
+						blocksDropped.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+
+					if (convertLayout && decimator == nullptr && read > 0) {
+						ConvertFillMode(scratch, config.fillMode, slot, deliveredFillMode,
+							config.channels, (uInt32)read, sampleSize);
+					}
+
+					const uInt64 sequence = blocksRead.load(std::memory_order_relaxed);
+					header->samplesPerChannel = (read > 0) ? (uInt32)read : 0;
+					header->status = status;
+					header->firstSample = first;
+					header->sequence = sequence;
+					header->hostTimestampNs = entryNs;
+					header->samplesAcquired = totalAcquired;
+
+					ring.CommitWrite();
+					blocksRead.store(sequence + 1, std::memory_order_relaxed);
+
+					// Orders the commit before the waiter check; pairs with the
+					// increment in WaitAcquireBlock.
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if (waiters.load(std::memory_order_relaxed) > 0) {
+						std::lock_guard<std::mutex> lock(waitMutex);
+						waitCondition.notify_all();
+					}
+				}
+
+				// Runs the block in `scratch` through the decimator into `target`;
+				// returns the samples per channel it produced.
+				int32 Decimate(int32 read, void* target, int32& status) {
+
+					if (read <= 0) {
+						return 0;
+					}
+
+					uInt32 produced = 0;
+					int32 r = decimator->Process(scratch, config.format, (uInt32)read,
+						config.fillMode, target, blockSamples, deliveredFillMode, produced);
+
+					if (r < 0) {
+						readErrors.fetch_add(1, std::memory_order_relaxed);
+						lastError.store(r, std::memory_order_relaxed);
+						status = (status < 0) ? status : r;
+					}
+					return (int32)produced;
+				}
+
+				void FillView(const uint8_t* slot, const BlockHeader* header,
+					BlockView& view) const {
+
+					view.data = slot;
+					view.samplesPerChannel = header->samplesPerChannel;
+					view.channels = config.channels;
+					view.format = config.format;
+					view.fillMode = deliveredFillMode;
+					view.firstSample = header->firstSample;
+					view.sequence = header->sequence;
+					view.status = header->status;
+					view.hostTimestampNs = header->hostTimestampNs;
+					view.samplesAcquired = header->samplesAcquired;
+				}
+			};
+
+			AcquisitionEngineCore::AcquisitionEngineCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			AcquisitionEngineCore::~AcquisitionEngineCore() {
+
+				if (_impl != nullptr) {
+					Detach();
+
+					// Destroyed from a callback: left to the process rather
+					// than freed under a callback in flight.
+					if (!_impl->unsettled || CallbackRegistry::Instance().Synchronize()) {
+						delete _impl;
+					}
+					_impl = nullptr;
+				}
+			}
+
+			int32 AcquisitionEngineCore::Attach(TaskHandle task,
+				const AcquisitionEngineConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (_impl->attached.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				// The buffers are about to be replaced.
+				if (_impl->unsettled) {
+					if (!CallbackRegistry::Instance().Synchronize()) {
+						return NativeErrorInvalidState;
+					}
+					_impl->unsettled = false;
+				}
+
+				const size_t sampleSize = SampleSize(config.format);
+
+				if (task == NULL || config.channels == 0
+					|| config.samplesPerBlock == 0 || config.ringBlocks < 2) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (config.deliveredFillMode != FillModeAsRead
+					&& config.deliveredFillMode != DAQmx_Val_GroupByChannel
+					&& config.deliveredFillMode != DAQmx_Val_GroupByScanNumber) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (sampleSize == 0) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				_impl->config = config;
+				_impl->task = task;
+				_impl->blockSamples = config.channels * config.samplesPerBlock;
+				_impl->sampleSize = sampleSize;
+				_impl->deliveredFillMode = (config.deliveredFillMode == FillModeAsRead)
+					? config.fillMode : config.deliveredFillMode;
+				_impl->convertLayout = (_impl->deliveredFillMode != config.fillMode)
+					&& (config.channels > 1);
+
+				const size_t blockBytes = (size_t)_impl->blockSamples * sampleSize;
+
+				if (!_impl->ring.Allocate(config.ringBlocks, blockBytes)) {
+					return NativeErrorOutOfMemory;
+				}
+
+				AlignedFree(_impl->scratch);
+				_impl->scratch = AlignedAlloc(blockBytes);
+
+				// Sized for the new blocks by the next SetDecimator.
+				AlignedFree(_impl->decimatorSink);
+				_impl->decimatorSink = nullptr;
+
+				if (_impl->scratch == nullptr) {
+					_impl->ring.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				int32 r = CallbackRegistry::Instance().Allocate(_impl, _impl->key)
+					? NativeSuccess : NativeErrorOutOfMemory;
+
+				if (r >= 0) {
+					r = DAQmxRegisterEveryNSamplesEvent(task,
+						DAQmx_Val_Acquired_Into_Buffer, config.samplesPerBlock, 0,
+						&Impl::OnEveryNSamples, reinterpret_cast<void*>(_impl->key));
+				}
+
+				if (r < 0) {
+					CallbackRegistry::Instance().Release(_impl->key, _impl);
+					_impl->key = 0;
+					_impl->ring.Free();
+					AlignedFree(_impl->scratch);
+					_impl->scratch = nullptr;
+					_impl->task = NULL;
+					return r;
+				}
+
+				_impl->attached.store(true);
+				return r;
+			}
+
+			int32 AcquisitionEngineCore::Detach() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return 0;
+				}
+
+				Stop();
+
+				// A NULL callback unregisters the event.
+				int32 r = DAQmxRegisterEveryNSamplesEvent(_impl->task,
+					DAQmx_Val_Acquired_Into_Buffer, _impl->config.samplesPerBlock,
+					0, NULL, NULL);
+
+				// DAQmx may still be calling a callback it picked before the
+				// event was unregistered; wait for it before the task goes.
+				CallbackRegistry::Instance().Release(_impl->key, _impl);
+				_impl->key = 0;
+				_impl->unsettled = !CallbackRegistry::Instance().Synchronize();
+
+				if (_impl->config.ownsTask) {
+					int32 c = DAQmxClearTask(_impl->task);
+					r = (r < 0) ? r : c;
+				}
+
+				_impl->attached.store(false);
+				_impl->task = NULL;
+				_impl->decimator = nullptr;
+				_impl->statistics = nullptr;
+				_impl->trigger = nullptr;
+				_impl->clockEstimator = nullptr;
+				return r;
+			}
+
+			int32 AcquisitionEngineCore::Start() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (_impl->running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				_impl->ring.Reset();
+				_impl->samplesAcquired = 0;
+				_impl->blocksRead.store(0);
+				_impl->blocksDropped.store(0);
+				_impl->readErrors.store(0);
+				_impl->lastError.store(0);
+
+				if (_impl->decimator != nullptr) {
+					_impl->decimator->Reset();
+				}
+				if (_impl->statistics != nullptr) {
+					_impl->statistics->Reset();
+				}
+				if (_impl->trigger != nullptr) {
+					_impl->trigger->Reset();
+				}
+				if (_impl->clockEstimator != nullptr) {
+					_impl->clockEstimator->Reset();
+				}
+
+				_impl->running.store(true, std::memory_order_release);
+
+				int32 r = DAQmxStartTask(_impl->task);
+
+				if (r < 0) {
+					_impl->running.store(false);
+				}
+				return r;
+			}
+
+			int32 AcquisitionEngineCore::Stop() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (!_impl->running.exchange(false)) {
+					return 0;
+				}
+
+				int32 r = DAQmxStopTask(_impl->task);
+
+				// Wake up consumers so that they can observe the stop.
+				{
+					std::lock_guard<std::mutex> lock(_impl->waitMutex);
+					_impl->waitCondition.notify_all();
+				}
+				return r;
+			}
+
+			int32 AcquisitionEngineCore::SetDecimator(DecimatorCore* decimator) {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (_impl->running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (decimator == nullptr) {
+					_impl->decimator = nullptr;
+					return NativeSuccess;
+				}
+
+				const AcquisitionEngineConfig& config = _impl->config;
+
+				if (config.format != SampleFormat::Float64 && config.format != SampleFormat::Int16) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				if (!decimator->IsConfigured()
+					|| decimator->Config().channels != config.channels
+					|| decimator->Config().maxSamplesPerChannel < config.samplesPerBlock) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (_impl->decimatorSink == nullptr) {
+					_impl->decimatorSink = AlignedAlloc((size_t)_impl->blockSamples * _impl->sampleSize);
+
+					if (_impl->decimatorSink == nullptr) {
+						return NativeErrorOutOfMemory;
+					}
+				}
+
+				_impl->decimator = decimator;
+				return NativeSuccess;
+			}
+
+			int32 AcquisitionEngineCore::SetStatistics(BlockStatisticsCore* statistics) {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (_impl->running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (statistics != nullptr) {
+
+					const SampleFormat format = _impl->config.format;
+
+					if (format != SampleFormat::Float64 && format != SampleFormat::Int16) {
+						return NativeErrorUnsupportedFormat;
+					}
+					if (statistics->Channels() != _impl->config.channels) {
+						return NativeErrorInvalidArgument;
+					}
+				}
+
+				_impl->statistics = statistics;
+				return NativeSuccess;
+			}
+
+			int32 AcquisitionEngineCore::SetTrigger(SoftwareTriggerCore* trigger) {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (_impl->running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (trigger != nullptr) {
+
+					if (!trigger->IsConfigured()) {
+						return NativeErrorInvalidArgument;
+					}
+
+					const SoftwareTriggerConfig& config = trigger->Config();
+
+					if (config.format != _impl->config.format) {
+						return NativeErrorUnsupportedFormat;
+					}
+					if (config.channels != _impl->config.channels
+						|| config.maxSamplesPerChannel < _impl->config.samplesPerBlock) {
+						return NativeErrorInvalidArgument;
+					}
+				}
+
+				_impl->trigger = trigger;
+				return NativeSuccess;
+			}
+
+			int32 AcquisitionEngineCore::SetClockEstimator(ClockDriftEstimatorCore* estimator) {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (_impl->running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				_impl->clockEstimator = estimator;
+				return NativeSuccess;
+			}
+
+			bool AcquisitionEngineCore::IsRunning() const {
+				return _impl != nullptr && _impl->running.load();
+			}
+
+			bool AcquisitionEngineCore::TryAcquireBlock(BlockView& view) {
+
+				if (_impl == nullptr) {
+					return false;
+				}
+
+				const BlockHeader* header = nullptr;
+				const uint8_t* slot = _impl->ring.BeginRead(header);
+
+				if (slot == nullptr) {
+					return false;
+				}
+
+				_impl->FillView(slot, header, view);
+				return true;
+			}
+
+			bool AcquisitionEngineCore::WaitAcquireBlock(BlockView& view,
+				uInt32 timeoutMs) {
+
+				if (TryAcquireBlock(view)) {
+					return true;
+				}
+
+				if (_impl == nullptr) {
+					return false;
+				}
+
+				const auto deadline = std::chrono::steady_clock::now()
+					+ std::chrono::milliseconds(timeoutMs);
+
+				_impl->waiters.fetch_add(1, std::memory_order_seq_cst);
+
+				bool acquired = false;
+				{
+					std::unique_lock<std::mutex> lock(_impl->waitMutex);
+
+					while (!(acquired = TryAcquireBlock(view))) {
+
+						if (!_impl->running.load()) {
+							break;
+						}
+
+						if (_impl->waitCondition.wait_until(lock, deadline)
+							== std::cv_status::timeout) {
+							acquired = TryAcquireBlock(view);
+							break;
+						}
+					}
+				}
+
+				_impl->waiters.fetch_sub(1, std::memory_order_seq_cst);
+				return acquired;
+			}
+
+			void AcquisitionEngineCore::ReleaseBlock() {
+				if (_impl != nullptr) {
+					_impl->ring.EndRead();
+				}
+			}
+
+			size_t AcquisitionEngineCore::PendingBlocks() const {
+				return (_impl != nullptr) ? _impl->ring.Count() : 0;
+			}
+
+			AcquisitionEngineCounters AcquisitionEngineCore::Counters() const {
+
+				AcquisitionEngineCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.blocksRead = _impl->blocksRead.load(std::memory_order_relaxed);
+					counters.blocksDropped = _impl->blocksDropped.load(std::memory_order_relaxed);
+					counters.readErrors = _impl->readErrors.load(std::memory_order_relaxed);
+					counters.lastError = _impl->lastError.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			TaskHandle AcquisitionEngineCore::Task() const {
+				return (_impl != nullptr) ? _impl->task : NULL;
+			}
+
+			const AcquisitionEngineConfig& AcquisitionEngineCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
@@ -0,0 +1,325 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the native continuous-acquisition engine. This header is safe to
+* include from code compiled with /clr: the implementation (ring, threads,
+* atomics) is hidden behind a pointer to `Impl`.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			class BlockStatisticsCore;
+			class ClockDriftEstimatorCore;
+			class DecimatorCore;
+			class SoftwareTriggerCore;
+
+			/**
+			* @brief Configuration of an `AcquisitionEngineCore`.
+			*/
+			struct AcquisitionEngineConfig {
+
+				/** Number of channels in the task. */
+				uInt32 channels;
+
+				/** Samples per channel in one block; also the N of the
+				*   EveryNSamples event. */
+				uInt32 samplesPerBlock;
+
+				/** Number of blocks the ring can hold before the consumer
+				*   falls behind. Rounded up to a power of two. */
+				uInt32 ringBlocks;
+
+				/** Sample format the blocks are read in. */
+				SampleFormat format;
+
+				/** `DAQmx_Val_GroupByChannel` or `DAQmx_Val_GroupByScanNumber`. */
+				int32 fillMode;
+
+				/** Layout of the blocks handed to the consumer. If it differs
+				*   from `fillMode`, the callback transposes every block into the
+				*   ring with the kernels of TransposeKernels.h, so the driver
+				*   can read in its native (interleaved) order while consumers
+				*   get one contiguous run per channel, or the reverse.
+				*   `FillModeAsRead` delivers blocks as read. */
+				int32 deliveredFillMode;
+
+				/** Timeout, in seconds, of the read issued from the callback.
+				*   The event guarantees that the data is there, so this only
+				*   matters when the driver is late. */
+				float64 readTimeout;
+
+				/** If `true`, the engine clears the task when it is destroyed. */
+				bool ownsTask;
+			};
+
+			/**
+			* @brief `AcquisitionEngineConfig::deliveredFillMode` value that
+			*        delivers blocks in the layout they were read in.
+			*/
+			const int32 FillModeAsRead = -1;
+
+			/**
+			* @brief Returns a configuration with the engine defaults filled in.
+			*/
+			inline AcquisitionEngineConfig DefaultAcquisitionEngineConfig() {
+				AcquisitionEngineConfig config;
+				config.channels = 1;
+				config.samplesPerBlock = 1000;
+				config.ringBlocks = 64;
+				config.format = SampleFormat::Float64;
+				config.fillMode = DAQmx_Val_GroupByChannel;
+				config.deliveredFillMode = FillModeAsRead;
+				config.readTimeout = 1.0;
+				config.ownsTask = false;
+				return config;
+			}
+
+			/**
+			* @brief Read-only view of one acquired block inside the engine ring.
+			*
+			* The view stays valid until `AcquisitionEngineCore::ReleaseBlock` is
+			* called. `data` points directly into the ring; nothing is copied.
+			*/
+			struct BlockView {
+				const void* data;
+				uInt32 samplesPerChannel;
+				uInt32 channels;
+				SampleFormat format;
+				int32 fillMode;
+
+				/** Index, per channel, of the first sample of the block since
+				*   the task was started. */
+				uInt64 firstSample;
+
+				/** Running block number since the engine was started. */
+				uInt64 sequence;
+
+				/** Status of the DAQmx read that filled the block. */
+				int32 status;
+
+				/** `HostMonotonicNs` at the entry of the callback that read the
+				*   block. */
+				int64 hostTimestampNs;
+
+				/** Samples per channel the driver had acquired at
+				*   `hostTimestampNs` (`DAQmxGetReadTotalSampPerChanAcquired`),
+				*   counted at the full rate even behind a decimator; `0` if the
+				*   query failed. */
+				uInt64 samplesAcquired;
+			};
+
+			/**
+			* @brief Counters maintained by the engine. Read without locking.
+			*/
+			struct AcquisitionEngineCounters {
+				uInt64 blocksRead;
+				uInt64 blocksDropped;
+				uInt64 readErrors;
+				int32 lastError;
+			};
+
+			/**
+			* @brief Native continuous-acquisition engine.
+			*
+			* The engine registers a native EveryNSamples callback on a configured
+			* DAQmx task. Each time the driver signals that a block is available
+			* the callback reads it, on the driver thread and without entering the
+			* CLR, straight into the next free slot of a preallocated lock-free
+			* single-producer/single-consumer ring. Consumers take zero-copy views
+			* of the blocks in order and hand them back when done.
+			*
+			* If the consumer falls behind and the ring is full, the block is still
+			* read (into a scratch buffer) so that the device buffer does not
+			* overflow, and it is counted as dropped.
+			*
+			* All methods return DAQmx status codes or `NativeStatus` codes.
+			*/
+			class AcquisitionEngineCore {
+
+			public:
+				AcquisitionEngineCore();
+				~AcquisitionEngineCore();
+
+				AcquisitionEngineCore(const AcquisitionEngineCore&) = delete;
+				AcquisitionEngineCore& operator=(const AcquisitionEngineCore&) = delete;
+
+				/**
+				* @brief Allocates the ring and registers the native callback on the task.
+				*
+				* The task must have its channels and timing configured and must not
+				* be running.
+				*
+				* @param[in] task The DAQmx task to acquire from.
+				* @param[in] config Engine configuration.
+				*
+				* @return `0` on success, a DAQmx or `NativeStatus` error otherwise.
+				*/
+				int32 Attach(TaskHandle task, const AcquisitionEngineConfig& config);
+
+				/**
+				* @brief Stops the engine and unregisters the callback. If the engine
+				*        owns the task, the task is cleared.
+				*
+				* Returns once no driver callback is inside the engine, unless
+				* called from a callback of the callback path; the engine then
+				* waits on the next `Attach` or in its destructor.
+				*/
+				int32 Detach();
+
+				/**
+				* @brief Empties the ring, resets the counters and starts the task.
+				*/
+				int32 Start();
+
+				/**
+				* @brief Stops the task. Blocks already in the ring stay readable.
+				*/
+				int32 Stop();
+
+				/**
+				* @brief Filters and decimates every block between the read and the
+				*        ring, or removes the stage (`nullptr`).
+				*
+				* The decimator must be configured for the channels of the engine
+				* and for blocks of `samplesPerBlock` samples, and the engine must
+				* read `Float64` or `Int16`; the ring then holds decimated blocks in
+				* the same format, laid out in `deliveredFillMode`, and
+				* `BlockView::firstSample` counts output samples. Blocks dropped
+				* because the ring was full still pass through the filter, so its
+				* state and the sample index stay continuous. `Start` resets the
+				* decimator. The engine does not own it; it must stay alive while
+				* attached.
+				*
+				* @return `0`, `NativeErrorNotAttached`, `NativeErrorAlreadyRunning`,
+				*         `NativeErrorInvalidArgument` or `NativeErrorUnsupportedFormat`.
+				*/
+				int32 SetDecimator(DecimatorCore* decimator);
+
+				/**
+				* @brief Runs `statistics` over every block right after it is read,
+				*        or removes the stage (`nullptr`).
+				*
+				* The statistics see the full-rate data as read, before a
+				* decimator and before the fill mode conversion, including blocks
+				* dropped because the ring was full. They must be configured for
+				* the channels of the engine, and the engine must read `Float64`
+				* or `Int16`. `Start` resets them. The engine does not own them;
+				* they must stay alive while attached.
+				*
+				* @return `0`, `NativeErrorNotAttached`, `NativeErrorAlreadyRunning`,
+				*         `NativeErrorInvalidArgument` or `NativeErrorUnsupportedFormat`.
+				*/
+				int32 SetStatistics(BlockStatisticsCore* statistics);
+
+				/**
+				* @brief Runs every block through `trigger` right after it is read,
+				*        or removes the stage (`nullptr`).
+				*
+				* Like the statistics, the trigger sees the full-rate blocks as
+				* read, including dropped ones, so its sample indices match
+				* `BlockView::firstSample` of an engine without a decimator. It
+				* must be configured for the channels and the format of the
+				* engine and for blocks of `samplesPerBlock` samples. `Start`
+				* resets it. The engine does not own it; it must stay alive while
+				* attached.
+				*
+				* @return `0`, `NativeErrorNotAttached`, `NativeErrorAlreadyRunning`,
+				*         `NativeErrorInvalidArgument` or `NativeErrorUnsupportedFormat`.
+				*/
+				int32 SetTrigger(SoftwareTriggerCore* trigger);
+
+				/**
+				* @brief Feeds `estimator` with the samples acquired and the host
+				*        time at the entry of every callback, or removes it
+				*        (`nullptr`).
+				*
+				* Every callback adds one observation, including those of blocks
+				* dropped because the ring was full, so that the estimator can
+				* give each sample of the task a host timestamp (see
+				* `ClockDriftEstimatorCore::InterpolateHostTimes`). `Start`
+				* resets it. The engine does not own it; it must stay alive
+				* while attached.
+				*
+				* @return `0`, `NativeErrorNotAttached` or `NativeErrorAlreadyRunning`.
+				*/
+				int32 SetClockEstimator(ClockDriftEstimatorCore* estimator);
+
+				/**
+				* @brief Returns `true` between a successful `Start` and `Stop`.
+				*/
+				bool IsRunning() const;
+
+				/**
+				* @brief Returns a view of the oldest unconsumed block without waiting.
+				*
+				* @return `true` if a block was available.
+				*/
+				bool TryAcquireBlock(BlockView& view);
+
+				/**
+				* @brief Waits up to `timeoutMs` milliseconds for a block.
+				*
+				* @return `true` if a block was available before the timeout.
+				*/
+				bool WaitAcquireBlock(BlockView& view, uInt32 timeoutMs);
+
+				/**
+				* @brief Returns the block obtained by the last successful acquire
+				*        to the ring. Does nothing if no block is held.
+				*/
+				void ReleaseBlock();
+
+				/**
+				* @brief Number of blocks waiting to be consumed.
+				*/
+				size_t PendingBlocks() const;
+
+				/**
+				* @brief Snapshot of the engine counters.
+				*/
+				AcquisitionEngineCounters Counters() const;
+
+				/**
+				* @brief The attached task, or `NULL`.
+				*/
+				TaskHandle Task() const;
+
+				/**
+				* @brief The configuration passed to `Attach`.
+				*/
+				const AcquisitionEngineConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
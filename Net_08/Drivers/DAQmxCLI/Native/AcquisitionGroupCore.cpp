@@ -0,0 +1,639 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AcquisitionGroupCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#include "AcquisitionEngineCore.h"
+#include "NativeStatus.h"
+#include "SpscRing.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// How long the merge thread waits on one member before it
+				// checks for a stop.
+				const uInt32 MergeWaitMs = 10;
+			}
+
+			struct FrameHeader {
+				uInt32 samplesPerChannel;
+				int32 status;
+				uInt64 firstSample;
+				uInt64 sequence;
+				int64 hostTimestampNs;
+			};
+
+			struct AcquisitionGroupCore::Impl {
+
+				struct Member {
+					TaskHandle task;
+					uInt32 channels;
+					// Offset of the first channel of the member in the frames.
+					uInt32 channelOffset;
+					AcquisitionEngineCore engine;
+					BlockView head;
+					bool hasHead;
+				};
+
+				AcquisitionGroupConfig config;
+				bool configured;
+				Member* members[AcquisitionGroupMaxMembers];
+				uInt32 memberCount;
+				uInt32 totalChannels;
+				size_t sampleSize;
+
+				SpscBlockRing<FrameHeader> ring;
+				std::thread merger;
+				std::atomic<bool> running;
+				std::atomic<bool> stopping;
+				uInt64 sequence;
+
+				std::atomic<uInt64> framesMerged;
+				std::atomic<uInt64> framesDropped;
+				std::atomic<uInt64> blocksDiscarded;
+				std::atomic<int32> lastError;
+
+				std::atomic<int32> waiters;
+				std::mutex waitMutex;
+				std::condition_variable waitCondition;
+
+				Impl() :
+					config(DefaultAcquisitionGroupConfig()), configured(false),
+					memberCount(0), totalChannels(0), sampleSize(0),
+					running(false), stopping(false), sequence(0),
+					framesMerged(0), framesDropped(0), blocksDiscarded(0),
+					lastError(0), waiters(0) {
+
+					for (uInt32 m = 0; m < AcquisitionGroupMaxMembers; m++) {
+						members[m] = nullptr;
+					}
+				}
+
+				~Impl() {
+					for (uInt32 m = 0; m < memberCount; m++) {
+						members[m]->engine.Detach();
+						DAQmxClearTask(members[m]->task);
+						delete members[m];
+					}
+				}
+
+				void ReleaseHeads() {
+					for (uInt32 m = 0; m < memberCount; m++) {
+						if (members[m]->hasHead) {
+							members[m]->engine.ReleaseBlock();
+							members[m]->hasHead = false;
+						}
+					}
+				}
+
+				// Gets the next block of every member that has none. Returns
+				// false if one of them has nothing more to give.
+				bool FillHeads() {
+
+					for (uInt32 m = 0; m < memberCount; m++) {
+
+						Member& member = *members[m];
+
+						while (!member.hasHead) {
+
+							if (stopping.load(std::memory_order_acquire)) {
+								if (!member.engine.TryAcquireBlock(member.head)) {
+									return false;
+								}
+							}
+							else if (!member.engine.WaitAcquireBlock(member.head, MergeWaitMs)) {
+								if (!member.engine.IsRunning()) {
+									// Not started yet or stopped by an error.
+									std::this_thread::sleep_for(std::chrono::milliseconds(1));
+								}
+								if (stopping.load(std::memory_order_acquire)
+									&& member.engine.PendingBlocks() == 0) {
+									return false;
+								}
+								continue;
+							}
+							member.hasHead = true;
+						}
+					}
+					return true;
+				}
+
+				void Merge() {
+
+					FrameHeader* header = nullptr;
+					uint8_t* slot = ring.BeginWrite(header);
+
+					if (slot == nullptr) {
+						framesDropped.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+
+					// A failed or short read leaves the tail of its block
+					// stale; the frame ends where the shortest block does.
+					uInt32 n = config.samplesPerBlock;
+					for (uInt32 m = 0; m < memberCount; m++) {
+						if (members[m]->head.samplesPerChannel < n) {
+							n = members[m]->head.samplesPerChannel;
+						}
+					}
+
+					header->samplesPerChannel = n;
+					header->status = 0;
+					header->firstSample = members[0]->head.firstSample;
+					header->sequence = sequence;
+					header->hostTimestampNs = 0;
+
+					for (uInt32 m = 0; m < memberCount; m++) {
+
+						const Member& member = *members[m];
+						const BlockView& block = member.head;
+
+						if (header->status == 0 && block.status != 0) {
+							header->status = block.status;
+						}
+						if (block.hostTimestampNs > header->hostTimestampNs) {
+							header->hostTimestampNs = block.hostTimestampNs;
+						}
+
+						// Runs of the member block are `samplesPerChannel` long.
+						const uInt32 run = block.samplesPerChannel;
+
+						if (config.fillMode == DAQmx_Val_GroupByChannel) {
+							// The runs of the member follow those of the previous ones.
+							uint8_t* target = slot + (size_t)member.channelOffset * n * sampleSize;
+
+							if (run == n) {
+								std::memcpy(target, block.data, (size_t)member.channels * n * sampleSize);
+							}
+							else {
+								const uint8_t* source = static_cast<const uint8_t*>(block.data);
+								for (uInt32 c = 0; c < member.channels; c++) {
+									std::memcpy(target + (size_t)c * n * sampleSize,
+										source + (size_t)c * run * sampleSize, (size_t)n * sampleSize);
+								}
+							}
+						}
+						else if (n > 0) {
+							// The member blocks are grouped by channel; each run
+							// becomes a column of the scans.
+							TransposeStrided(block.data, run,
+								slot + (size_t)member.channelOffset * sampleSize,
+								totalChannels, member.channels, n, sampleSize);
+						}
+					}
+
+					ring.CommitWrite();
+					sequence++;
+					framesMerged.fetch_add(1, std::memory_order_relaxed);
+
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (waiters.load(std::memory_order_relaxed) > 0) {
+						std::lock_guard<std::mutex> lock(waitMutex);
+						waitCondition.notify_all();
+					}
+				}
+
+				void Run() {
+
+					while (FillHeads()) {
+
+						// Every head must have the index of the newest one;
+						// the older ones lost their partners to a drop.
+						uInt64 target = 0;
+						for (uInt32 m = 0; m < memberCount; m++) {
+							if (members[m]->head.firstSample > target) {
+								target = members[m]->head.firstSample;
+							}
+						}
+
+						bool aligned = true;
+						for (uInt32 m = 0; m < memberCount; m++) {
+							Member& member = *members[m];
+							if (member.head.firstSample < target) {
+								member.engine.ReleaseBlock();
+								member.hasHead = false;
+								blocksDiscarded.fetch_add(1, std::memory_order_relaxed);
+								aligned = false;
+							}
+						}
+
+						if (aligned) {
+							Merge();
+							ReleaseHeads();
+						}
+					}
+
+					ReleaseHeads();
+
+					std::lock_guard<std::mutex> lock(waitMutex);
+					running.store(false);
+					waitCondition.notify_all();
+				}
+			};
+
+			AcquisitionGroupCore::AcquisitionGroupCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			AcquisitionGroupCore::~AcquisitionGroupCore() {
+				if (_impl != nullptr) {
+					Stop();
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 AcquisitionGroupCore::AddMember(const char* physicalChannels,
+				int32 terminalConfig, float64 minVal, float64 maxVal) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.configured) {
+					return NativeErrorInvalidState;
+				}
+
+				if (physicalChannels == nullptr || physicalChannels[0] == '\0') {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (impl.memberCount == AcquisitionGroupMaxMembers) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl::Member* member = new (std::nothrow) Impl::Member();
+
+				if (member == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				member->task = NULL;
+				member->channels = 0;
+				member->channelOffset = 0;
+				member->hasHead = false;
+
+				uInt32 channels = 0;
+				int32 r = DAQmxCreateTask("", &member->task);
+
+				if (r >= 0) {
+					r = DAQmxCreateAIVoltageChan(member->task, physicalChannels, "",
+						terminalConfig, minVal, maxVal, DAQmx_Val_Volts, NULL);
+				}
+				if (r >= 0) {
+					r = DAQmxGetTaskNumChans(member->task, &channels);
+				}
+
+				if (r < 0) {
+					if (member->task != NULL) {
+						DAQmxClearTask(member->task);
+					}
+					delete member;
+					return r;
+				}
+
+				member->channels = channels;
+				impl.members[impl.memberCount] = member;
+				return (int32)impl.memberCount++;
+			}
+
+			uInt32 AcquisitionGroupCore::MemberCount() const {
+				return (_impl != nullptr) ? _impl->memberCount : 0;
+			}
+
+			TaskHandle AcquisitionGroupCore::MemberTask(uInt32 member) const {
+				return (_impl != nullptr && member < _impl->memberCount)
+					? _impl->members[member]->task : NULL;
+			}
+
+			uInt32 AcquisitionGroupCore::MemberChannels(uInt32 member) const {
+				return (_impl != nullptr && member < _impl->memberCount)
+					? _impl->members[member]->channels : 0;
+			}
+
+			int32 AcquisitionGroupCore::Configure(const AcquisitionGroupConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				const size_t sampleSize = SampleSize(config.format);
+
+				if (impl.memberCount == 0 || config.sampleRate <= 0.0
+					|| config.samplesPerBlock == 0 || config.ringBlocks < 2
+					|| config.frameCapacity < 2
+					|| (config.fillMode != DAQmx_Val_GroupByChannel
+						&& config.fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (sampleSize == 0) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				const bool shared = impl.memberCount > 1;
+
+				if (shared && (config.clockTerminal[0] == '\0'
+					|| config.triggerTerminal[0] == '\0')) {
+					return NativeErrorInvalidArgument;
+				}
+
+				impl.configured = false;
+				impl.config = config;
+				impl.config.clockTerminal[AcquisitionGroupTerminalBytes - 1] = '\0';
+				impl.config.triggerTerminal[AcquisitionGroupTerminalBytes - 1] = '\0';
+				impl.sampleSize = sampleSize;
+				impl.totalChannels = 0;
+
+				const char* clockTerminal = impl.config.clockTerminal;
+				const char* triggerTerminal = impl.config.triggerTerminal;
+
+				// The buffer of every task holds the blocks of its engine ring.
+				const uInt64 bufferSize = (uInt64)config.samplesPerBlock * config.ringBlocks;
+
+				for (uInt32 m = 0; m < impl.memberCount; m++) {
+
+					Impl::Member& member = *impl.members[m];
+					member.engine.Detach();
+					member.channelOffset = impl.totalChannels;
+					impl.totalChannels += member.channels;
+
+					int32 r;
+
+					if (m == 0) {
+						r = DAQmxCfgSampClkTiming(member.task, "", config.sampleRate,
+							DAQmx_Val_Rising, DAQmx_Val_ContSamps, bufferSize);
+
+						if (r >= 0 && shared) {
+							r = DAQmxExportSignal(member.task, DAQmx_Val_SampleClock,
+								clockTerminal);
+						}
+						if (r >= 0 && shared) {
+							r = DAQmxExportSignal(member.task, DAQmx_Val_StartTrigger,
+								triggerTerminal);
+						}
+					}
+					else {
+						r = DAQmxCfgSampClkTiming(member.task, clockTerminal,
+							config.sampleRate, DAQmx_Val_Rising, DAQmx_Val_ContSamps,
+							bufferSize);
+
+						if (r >= 0) {
+							r = DAQmxCfgDigEdgeStartTrig(member.task, triggerTerminal,
+								DAQmx_Val_Rising);
+						}
+					}
+
+					if (r >= 0) {
+						AcquisitionEngineConfig engineConfig = DefaultAcquisitionEngineConfig();
+						engineConfig.channels = member.channels;
+						engineConfig.samplesPerBlock = config.samplesPerBlock;
+						engineConfig.ringBlocks = config.ringBlocks;
+						engineConfig.format = config.format;
+						engineConfig.fillMode = DAQmx_Val_GroupByChannel;
+						engineConfig.deliveredFillMode = FillModeAsRead;
+						engineConfig.readTimeout = config.readTimeout;
+						engineConfig.ownsTask = false;
+						r = member.engine.Attach(member.task, engineConfig);
+					}
+
+					if (r < 0) {
+						impl.lastError.store(r);
+						return r;
+					}
+				}
+
+				if (!impl.ring.Allocate(config.frameCapacity,
+					(size_t)impl.totalChannels * config.samplesPerBlock * sampleSize)) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.configured = true;
+				return NativeSuccess;
+			}
+
+			int32 AcquisitionGroupCore::Start() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (impl.merger.joinable()) {
+					impl.merger.join();
+				}
+
+				impl.ring.Reset();
+				impl.sequence = 0;
+				impl.framesMerged.store(0);
+				impl.framesDropped.store(0);
+				impl.blocksDiscarded.store(0);
+				impl.lastError.store(0);
+				impl.stopping.store(false);
+
+				// The other members wait for the trigger of the master, so
+				// they must be armed before it starts.
+				for (uInt32 m = impl.memberCount; m-- > 0;) {
+
+					int32 r = impl.members[m]->engine.Start();
+
+					if (r < 0) {
+						for (uInt32 k = m + 1; k < impl.memberCount; k++) {
+							impl.members[k]->engine.Stop();
+						}
+						impl.lastError.store(r);
+						return r;
+					}
+				}
+
+				impl.running.store(true);
+
+				try {
+					impl.merger = std::thread(&Impl::Run, &impl);
+				}
+				catch (const std::system_error&) {
+					impl.running.store(false);
+					for (uInt32 m = 0; m < impl.memberCount; m++) {
+						impl.members[m]->engine.Stop();
+					}
+					return NativeErrorOutOfMemory;
+				}
+				return NativeSuccess;
+			}
+
+			int32 AcquisitionGroupCore::Stop() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+				int32 r = 0;
+
+				// The master first, so that the other members see no clock
+				// edge it did not see either.
+				for (uInt32 m = 0; m < impl.memberCount; m++) {
+					int32 s = impl.members[m]->engine.Stop();
+					r = (r < 0) ? r : s;
+				}
+
+				impl.stopping.store(true, std::memory_order_release);
+
+				if (impl.merger.joinable()) {
+					impl.merger.join();
+				}
+				return (r < 0) ? r : 0;
+			}
+
+			bool AcquisitionGroupCore::IsRunning() const {
+				return _impl != nullptr && _impl->running.load();
+			}
+
+			bool AcquisitionGroupCore::TryAcquireFrame(FrameView& view) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return false;
+				}
+
+				Impl& impl = *_impl;
+				const FrameHeader* header = nullptr;
+				const uint8_t* slot = impl.ring.BeginRead(header);
+
+				if (slot == nullptr) {
+					return false;
+				}
+
+				view.data = slot;
+				view.samplesPerChannel = header->samplesPerChannel;
+				view.channels = impl.totalChannels;
+				view.format = impl.config.format;
+				view.fillMode = impl.config.fillMode;
+				view.firstSample = header->firstSample;
+				view.sequence = header->sequence;
+				view.status = header->status;
+				view.hostTimestampNs = header->hostTimestampNs;
+				return true;
+			}
+
+			bool AcquisitionGroupCore::WaitAcquireFrame(FrameView& view, uInt32 timeoutMs) {
+
+				if (TryAcquireFrame(view)) {
+					return true;
+				}
+
+				if (_impl == nullptr || !_impl->configured) {
+					return false;
+				}
+
+				Impl& impl = *_impl;
+				const auto deadline = std::chrono::steady_clock::now()
+					+ std::chrono::milliseconds(timeoutMs);
+
+				impl.waiters.fetch_add(1, std::memory_order_seq_cst);
+
+				bool acquired = false;
+				{
+					std::unique_lock<std::mutex> lock(impl.waitMutex);
+
+					while (!(acquired = TryAcquireFrame(view))) {
+
+						if (!impl.running.load()) {
+							break;
+						}
+
+						if (impl.waitCondition.wait_until(lock, deadline)
+							== std::cv_status::timeout) {
+							acquired = TryAcquireFrame(view);
+							break;
+						}
+					}
+				}
+
+				impl.waiters.fetch_sub(1, std::memory_order_seq_cst);
+				return acquired;
+			}
+
+			void AcquisitionGroupCore::ReleaseFrame() {
+				if (_impl != nullptr && _impl->configured) {
+					_impl->ring.EndRead();
+				}
+			}
+
+			size_t AcquisitionGroupCore::PendingFrames() const {
+				return (_impl != nullptr && _impl->configured) ? _impl->ring.Count() : 0;
+			}
+
+			AcquisitionGroupCounters AcquisitionGroupCore::Counters() const {
+
+				AcquisitionGroupCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.framesMerged = _impl->framesMerged.load(std::memory_order_relaxed);
+					counters.framesDropped = _impl->framesDropped.load(std::memory_order_relaxed);
+					counters.blocksDiscarded = _impl->blocksDiscarded.load(std::memory_order_relaxed);
+					counters.lastError = _impl->lastError.load(std::memory_order_relaxed);
+
+					for (uInt32 m = 0; m < _impl->memberCount; m++) {
+
+						const AcquisitionEngineCounters member
+							= _impl->members[m]->engine.Counters();
+
+						counters.memberBlocksDropped += member.blocksDropped;
+						if (counters.lastError == 0 && member.lastError != 0) {
+							counters.lastError = member.lastError;
+						}
+					}
+				}
+				return counters;
+			}
+
+			const AcquisitionGroupConfig& AcquisitionGroupCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
@@ -0,0 +1,255 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the synchronized acquisition group. Safe to include from code
+* compiled with /clr; the member engines, the merge thread and the frame
+* ring live in AcquisitionGroupCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/** Most tasks one group can synchronize. */
+			const uInt32 AcquisitionGroupMaxMembers = 16;
+
+			/** Room for a terminal name in `AcquisitionGroupConfig`. */
+			const size_t AcquisitionGroupTerminalBytes = 256;
+
+			/**
+			* @brief Configuration of an `AcquisitionGroupCore`.
+			*/
+			struct AcquisitionGroupConfig {
+
+				/** Sample clock rate of the master, in Hz; the other members
+				*   run on its clock. */
+				float64 sampleRate;
+
+				/** Samples per channel of every member block and of every
+				*   frame. */
+				uInt32 samplesPerBlock;
+
+				/** Blocks the ring of each member engine holds. */
+				uInt32 ringBlocks;
+
+				/** Frames the output ring holds. */
+				uInt32 frameCapacity;
+
+				/** Sample format of every member and of the frames. */
+				SampleFormat format;
+
+				/** Layout of the frames, over the channels of all members:
+				*   those of member 0 first. */
+				int32 fillMode;
+
+				/** Timeout, in seconds, of the reads of the member engines. */
+				float64 readTimeout;
+
+				/** Terminal the master exports its sample clock to and the
+				*   other members take it from, e.g. `/Dev1/PFI5` or an RTSI
+				*   line. Required with more than one member. */
+				char clockTerminal[AcquisitionGroupTerminalBytes];
+
+				/** Terminal the master exports its start trigger to and the
+				*   other members are armed on. Required with more than one
+				*   member. */
+				char triggerTerminal[AcquisitionGroupTerminalBytes];
+			};
+
+			inline AcquisitionGroupConfig DefaultAcquisitionGroupConfig() {
+
+				AcquisitionGroupConfig config;
+				config.sampleRate = 10000.0;
+				config.samplesPerBlock = 1000;
+				config.ringBlocks = 64;
+				config.frameCapacity = 64;
+				config.format = SampleFormat::Int16;
+				config.fillMode = DAQmx_Val_GroupByScanNumber;
+				config.readTimeout = 1.0;
+				config.clockTerminal[0] = '\0';
+				config.triggerTerminal[0] = '\0';
+				return config;
+			}
+
+			/**
+			* @brief Read-only view of one merged frame inside the group ring.
+			*
+			* The view stays valid until `AcquisitionGroupCore::ReleaseFrame`.
+			*/
+			struct FrameView {
+				const void* data;
+
+				/** `samplesPerBlock`, or fewer when a member read failed or
+				*   came back short: the shortest member block. */
+				uInt32 samplesPerChannel;
+
+				/** Channels of all members. */
+				uInt32 channels;
+				SampleFormat format;
+				int32 fillMode;
+
+				/** Index, per channel, of the first sample of the frame since
+				*   the start trigger; the same for every member. */
+				uInt64 firstSample;
+
+				/** Running frame number since the group was started. */
+				uInt64 sequence;
+
+				/** First failed status of the member reads, or `0`. */
+				int32 status;
+
+				/** Latest `BlockView::hostTimestampNs` of the member blocks. */
+				int64 hostTimestampNs;
+			};
+
+			/**
+			* @brief Counters of the group. Read without locking.
+			*/
+			struct AcquisitionGroupCounters {
+				uInt64 framesMerged;
+				/** Frames lost because the output ring was full. */
+				uInt64 framesDropped;
+				/** Member blocks without a block of the same index from every
+				*   other member, because one of the engines dropped it. */
+				uInt64 blocksDiscarded;
+				/** Sum of the dropped blocks of the member engines. */
+				uInt64 memberBlocksDropped;
+				int32 lastError;
+			};
+
+			/**
+			* @brief Runs several DAQmx tasks, typically on different devices,
+			*        off one sample clock and one start trigger, and merges
+			*        their blocks into frames aligned by sample index.
+			*
+			* `AddMember` creates one analog input task per device; the first
+			* is the master. `Configure` sets the sample clock of the master,
+			* exports its sample clock and start trigger with
+			* `DAQmxExportSignal`, puts the other members on that clock and
+			* arms them on that trigger (`DAQmxCfgDigEdgeStartTrig`), and
+			* attaches an `AcquisitionEngineCore` to each task. `Start` starts
+			* the other members first and the master last, so every member
+			* sees the same first clock edge and sample `k` of every member
+			* is the same instant.
+			*
+			* The engines read concurrently on the driver callbacks. A merge
+			* thread takes their blocks, pairs them by
+			* `BlockView::firstSample`, never by arrival order, and copies
+			* them into one frame of all channels in a lock-free ring. A
+			* block that an engine dropped leaves the blocks of the same
+			* index of the other members without partner; they are discarded
+			* and counted, and the following frames stay aligned.
+			*
+			* All methods return DAQmx status codes or `NativeStatus` codes.
+			*/
+			class AcquisitionGroupCore {
+
+			public:
+				AcquisitionGroupCore();
+				~AcquisitionGroupCore();
+
+				AcquisitionGroupCore(const AcquisitionGroupCore&) = delete;
+				AcquisitionGroupCore& operator=(const AcquisitionGroupCore&) = delete;
+
+				/**
+				* @brief Creates the task of a new member with analog input
+				*        voltage channels.
+				*
+				* @param[in] physicalChannels Channels of one device, e.g.
+				*            `Dev2/ai0:3`.
+				*
+				* @return The index of the member, or a negative status. Not
+				*         allowed once configured.
+				*/
+				int32 AddMember(const char* physicalChannels, int32 terminalConfig,
+					float64 minVal, float64 maxVal);
+
+				uInt32 MemberCount() const;
+
+				/**
+				* @brief The task of a member, e.g. to adjust its channels
+				*        before `Configure`; `NULL` if there is none.
+				*/
+				TaskHandle MemberTask(uInt32 member) const;
+
+				uInt32 MemberChannels(uInt32 member) const;
+
+				/**
+				* @brief Configures timing, routing and the member engines and
+				*        allocates the frame ring.
+				*
+				* @return `0`, a DAQmx error, `NativeErrorInvalidArgument`,
+				*         `NativeErrorAlreadyRunning` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Configure(const AcquisitionGroupConfig& config);
+
+				/**
+				* @brief Empties the rings and starts the members, the master
+				*        last, and the merge thread.
+				*/
+				int32 Start();
+
+				/**
+				* @brief Stops the master, then the other members, and merges
+				*        the blocks they still hold. Frames already merged stay
+				*        readable.
+				*/
+				int32 Stop();
+
+				bool IsRunning() const;
+
+				/**
+				* @brief Returns a view of the oldest unconsumed frame without
+				*        waiting.
+				*/
+				bool TryAcquireFrame(FrameView& view);
+
+				/**
+				* @brief Waits up to `timeoutMs` milliseconds for a frame.
+				*/
+				bool WaitAcquireFrame(FrameView& view, uInt32 timeoutMs);
+
+				/**
+				* @brief Returns the frame obtained by the last successful
+				*        acquire to the ring. Does nothing if no frame is held.
+				*/
+				void ReleaseFrame();
+
+				size_t PendingFrames() const;
+
+				AcquisitionGroupCounters Counters() const;
+
+				const AcquisitionGroupConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
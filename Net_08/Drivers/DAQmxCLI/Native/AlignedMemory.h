@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Cache line size assumed by the native containers.
+			*/
+			constexpr size_t CacheLineSize = 64;
+
+			/**
+			* @brief Allocates a block of memory with the requested alignment.
+			*
+			* @param[in] bytes Number of bytes to allocate.
+			* @param[in] alignment Alignment in bytes, a power of two and at least
+			*                      `sizeof(void*)`.
+			*
+			* @return A pointer to the block, or `nullptr` on failure. The block
+			*         must be released with `AlignedFree`.
+			*/
+			inline void* AlignedAlloc(size_t bytes, size_t alignment = CacheLineSize) {
+
+				if (bytes == 0) {
+					bytes = alignment;
+				}
+#if defined(_WIN32)
+				return _aligned_malloc(bytes, alignment);
+#else
+				void* p = nullptr;
+				return (posix_memalign(&p, alignment, bytes) == 0) ? p : nullptr;
+#endif
+			}
+
+			/**
+			* @brief Releases a block allocated by `AlignedAlloc`.
+			*/
+			inline void AlignedFree(void* p) {
+#if defined(_WIN32)
+				_aligned_free(p);
+#else
+				free(p);
+#endif
+			}
+
+			/**
+			* @brief Rounds a value up to the next power of two.
+			*/
+			inline size_t RoundUpToPowerOfTwo(size_t v) {
+				size_t r = 1;
+				while (r < v) {
+					r <<= 1;
+				}
+				return r;
+			}
+
+			/**
+			* @brief Rounds a byte count up to a whole number of cache lines.
+			*/
+			inline size_t RoundUpToCacheLine(size_t bytes) {
+				return (bytes + CacheLineSize - 1) & ~(CacheLineSize - 1);
+			}
+		}
+	}
+}
@@ -0,0 +1,638 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AnalogOutputEngineCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#include "AlignedMemory.h"
+#include "CallbackRegistry.h"
+#include "NativeStatus.h"
+#include "SpscRing.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Longest the idle feeder sleeps before it looks again; the
+				// wake-ups make it rarely matter.
+				const auto FeederIdleWait = std::chrono::milliseconds(10);
+			}
+
+			struct OutputBlockHeader {
+				uInt64 sequence;
+			};
+
+			struct AnalogOutputEngineCore::Impl {
+
+				TaskHandle task;
+				AnalogOutputEngineConfig config;
+				SpscBlockRing<OutputBlockHeader> ring;
+				size_t sampleSize;
+				size_t blockBytes;
+
+				// Last scan written to the device and the block that repeats
+				// it for `holdOnUnderrun`.
+				uint8_t* lastScan;
+				void* holdBlock;
+
+				std::thread feeder;
+				std::atomic<bool> attached;
+				std::atomic<bool> running;
+				std::atomic<bool> stopping;
+
+				// Passed to DAQmx as callbackData; `0` while detached.
+				CallbackKey key;
+
+				// Detached from a callback, which `Synchronize` cannot wait
+				// for: a callback may still be adding a credit.
+				bool unsettled;
+
+				// Producer side.
+				uInt64 produced;
+
+				// Feeder side: samples per channel written since `Start`,
+				// moved up to the generated count after a regeneration.
+				uInt64 samplesWritten;
+
+				// Blocks the device buffer has room for; one per
+				// EveryNSamplesTransferred event.
+				std::atomic<uInt64> credits;
+
+				std::atomic<uInt64> blocksWritten;
+				std::atomic<uInt64> underruns;
+				std::atomic<uInt64> blocksHeld;
+				std::atomic<uInt64> samplesRegenerated;
+				std::atomic<uInt64> writeErrors;
+				std::atomic<int32> lastError;
+
+				// Feeder wake-up. The callback and the producer only take the
+				// mutex when the feeder announced that it is idle.
+				std::atomic<bool> feederIdle;
+				std::mutex feedMutex;
+				std::condition_variable feedCondition;
+
+				// Producer wake-up, same pattern.
+				std::atomic<int32> waiters;
+				std::mutex waitMutex;
+				std::condition_variable waitCondition;
+
+				Impl() :
+					task(NULL), config(DefaultAnalogOutputEngineConfig()),
+					sampleSize(0), blockBytes(0), lastScan(nullptr), holdBlock(nullptr),
+					attached(false), running(false), stopping(false), key(0), unsettled(false),
+					produced(0), samplesWritten(0), credits(0),
+					blocksWritten(0), underruns(0), blocksHeld(0),
+					samplesRegenerated(0), writeErrors(0), lastError(0),
+					feederIdle(false), waiters(0) {}
+
+				~Impl() {
+					Free();
+				}
+
+				void Free() {
+					ring.Free();
+					AlignedFree(lastScan);
+					AlignedFree(holdBlock);
+					lastScan = nullptr;
+					holdBlock = nullptr;
+				}
+
+				static int32 CVICALLBACK OnEveryNSamples(TaskHandle /*taskHandle*/,
+					int32 /*everyNsamplesEventType*/, uInt32 /*nSamples*/,
+					void* callbackData) {
+
+					// The key no longer resolves once `Detach` released it.
+					CallbackEpochGuard guard;
+					Impl* impl = static_cast<Impl*>(CallbackRegistry::Instance().Owner(
+						reinterpret_cast<CallbackKey>(callbackData)));
+
+					if (impl != nullptr && impl->running.load(std::memory_order_acquire)) {
+						impl->credits.fetch_add(1, std::memory_order_release);
+						impl->WakeFeeder();
+					}
+					return 0;
+				}
+
+				void WakeFeeder() {
+
+					// Orders the state change before the idle check; pairs
+					// with the store in Idle.
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if (feederIdle.load(std::memory_order_relaxed)) {
+						std::lock_guard<std::mutex> lock(feedMutex);
+						feedCondition.notify_one();
+					}
+				}
+
+				void WakeProducer() {
+
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if (waiters.load(std::memory_order_relaxed) > 0) {
+						std::lock_guard<std::mutex> lock(waitMutex);
+						waitCondition.notify_all();
+					}
+				}
+
+				bool HasWork() const {
+					return stopping.load(std::memory_order_acquire)
+						|| (credits.load(std::memory_order_acquire) > 0
+							&& (config.holdOnUnderrun || ring.Count() > 0));
+				}
+
+				void Idle() {
+
+					std::unique_lock<std::mutex> lock(feedMutex);
+					feederIdle.store(true, std::memory_order_seq_cst);
+
+					if (!HasWork()) {
+						feedCondition.wait_for(lock, FeederIdleWait);
+					}
+					feederIdle.store(false, std::memory_order_relaxed);
+				}
+
+				int32 Write(const void* data) {
+
+					uInt64 generated = 0;
+
+					if (config.regeneration
+						&& DAQmxGetWriteTotalSampPerChanGenerated(task, &generated) >= 0
+						&& generated > samplesWritten) {
+
+						// The device went past the written data and repeated
+						// old samples; the write lands after them.
+						samplesRegenerated.fetch_add(generated - samplesWritten,
+							std::memory_order_relaxed);
+						samplesWritten = generated;
+					}
+
+					int32 written = 0;
+					int32 r = WriteSamples(task, config.format, (int32)config.samplesPerBlock,
+						config.writeTimeout, config.fillMode, data, &written);
+
+					samplesWritten += (written > 0) ? (uInt64)written : 0;
+
+					if (r < 0) {
+						writeErrors.fetch_add(1, std::memory_order_relaxed);
+						lastError.store(r, std::memory_order_relaxed);
+					}
+					return r;
+				}
+
+				void KeepLastScan(const uint8_t* block) {
+
+					const uInt32 spb = config.samplesPerBlock;
+
+					if (config.fillMode == DAQmx_Val_GroupByScanNumber || config.channels == 1) {
+						std::memcpy(lastScan, block + (size_t)(spb - 1) * config.channels * sampleSize,
+							config.channels * sampleSize);
+						return;
+					}
+
+					for (uInt32 ch = 0; ch < config.channels; ch++) {
+						std::memcpy(lastScan + ch * sampleSize,
+							block + ((size_t)ch * spb + spb - 1) * sampleSize, sampleSize);
+					}
+				}
+
+				void FillHoldBlock() {
+
+					const uInt32 spb = config.samplesPerBlock;
+					uint8_t* out = static_cast<uint8_t*>(holdBlock);
+
+					for (uInt32 i = 0; i < spb; i++) {
+						for (uInt32 ch = 0; ch < config.channels; ch++) {
+
+							const size_t index = (config.fillMode == DAQmx_Val_GroupByChannel)
+								? (size_t)ch * spb + i : (size_t)i * config.channels + ch;
+							std::memcpy(out + index * sampleSize, lastScan + ch * sampleSize, sampleSize);
+						}
+					}
+				}
+
+				// Writes the oldest block of the ring; returns false if the
+				// ring is empty.
+				bool WriteNext() {
+
+					const OutputBlockHeader* header = nullptr;
+					const uint8_t* slot = ring.BeginRead(header);
+
+					if (slot == nullptr) {
+						return false;
+					}
+
+					if (Write(slot) >= 0) {
+						KeepLastScan(slot);
+						blocksWritten.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					ring.EndRead();
+					WakeProducer();
+					return true;
+				}
+
+				void Run() {
+
+					bool starving = false;
+
+					while (!stopping.load(std::memory_order_acquire)) {
+
+						if (credits.load(std::memory_order_acquire) == 0) {
+							Idle();
+							continue;
+						}
+
+						if (WriteNext()) {
+							credits.fetch_sub(1, std::memory_order_relaxed);
+							starving = false;
+							continue;
+						}
+
+						// The device has room but the producer is late.
+						if (!starving) {
+							underruns.fetch_add(1, std::memory_order_relaxed);
+							starving = true;
+						}
+
+						if (config.holdOnUnderrun) {
+							FillHoldBlock();
+							if (Write(holdBlock) >= 0) {
+								blocksHeld.fetch_add(1, std::memory_order_relaxed);
+							}
+							credits.fetch_sub(1, std::memory_order_relaxed);
+						}
+						else {
+							Idle();
+						}
+					}
+				}
+			};
+
+			AnalogOutputEngineCore::AnalogOutputEngineCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			AnalogOutputEngineCore::~AnalogOutputEngineCore() {
+
+				if (_impl != nullptr) {
+					Detach();
+
+					// Destroyed from a callback: left to the process rather
+					// than freed under a callback in flight.
+					if (!_impl->unsettled || CallbackRegistry::Instance().Synchronize()) {
+						delete _impl;
+					}
+					_impl = nullptr;
+				}
+			}
+
+			int32 AnalogOutputEngineCore::Attach(TaskHandle task,
+				const AnalogOutputEngineConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.attached.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				// The buffers are about to be replaced.
+				if (impl.unsettled) {
+					if (!CallbackRegistry::Instance().Synchronize()) {
+						return NativeErrorInvalidState;
+					}
+					impl.unsettled = false;
+				}
+
+				if (task == NULL || config.channels == 0 || config.samplesPerBlock == 0
+					|| config.ringBlocks < 2 || config.bufferBlocks < 2
+					|| (config.fillMode != DAQmx_Val_GroupByChannel
+						&& config.fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (config.format != SampleFormat::Float64 && config.format != SampleFormat::Int16) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				impl.config = config;
+				impl.task = task;
+				impl.sampleSize = SampleSize(config.format);
+				impl.blockBytes = (size_t)config.channels * config.samplesPerBlock * impl.sampleSize;
+
+				impl.Free();
+				impl.lastScan = static_cast<uint8_t*>(AlignedAlloc(config.channels * impl.sampleSize));
+				impl.holdBlock = AlignedAlloc(impl.blockBytes);
+
+				if (!impl.ring.Allocate(config.ringBlocks, impl.blockBytes)
+					|| impl.lastScan == nullptr || impl.holdBlock == nullptr) {
+					impl.Free();
+					impl.task = NULL;
+					return NativeErrorOutOfMemory;
+				}
+
+				std::memset(impl.lastScan, 0, config.channels * impl.sampleSize);
+				impl.produced = 0;
+
+				int32 r = DAQmxCfgOutputBuffer(task, config.samplesPerBlock * config.bufferBlocks);
+
+				if (r >= 0) {
+					r = DAQmxSetWriteRegenMode(task, config.regeneration
+						? DAQmx_Val_AllowRegen : DAQmx_Val_DoNotAllowRegen);
+				}
+
+				if (r >= 0 && !CallbackRegistry::Instance().Allocate(_impl, impl.key)) {
+					r = NativeErrorOutOfMemory;
+				}
+
+				if (r >= 0) {
+					r = DAQmxRegisterEveryNSamplesEvent(task,
+						DAQmx_Val_Transferred_From_Buffer, config.samplesPerBlock, 0,
+						&Impl::OnEveryNSamples, reinterpret_cast<void*>(impl.key));
+				}
+
+				if (r < 0) {
+					CallbackRegistry::Instance().Release(impl.key, _impl);
+					impl.key = 0;
+					impl.Free();
+					impl.task = NULL;
+					return r;
+				}
+
+				impl.attached.store(true);
+				return r;
+			}
+
+			int32 AnalogOutputEngineCore::Detach() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return 0;
+				}
+
+				Impl& impl = *_impl;
+				Stop();
+
+				// A NULL callback unregisters the event.
+				int32 r = DAQmxRegisterEveryNSamplesEvent(impl.task,
+					DAQmx_Val_Transferred_From_Buffer, impl.config.samplesPerBlock,
+					0, NULL, NULL);
+
+				// DAQmx may still be calling a callback it picked before the
+				// event was unregistered; wait for it before the task goes.
+				CallbackRegistry::Instance().Release(impl.key, _impl);
+				impl.key = 0;
+				impl.unsettled = !CallbackRegistry::Instance().Synchronize();
+
+				if (impl.config.ownsTask) {
+					int32 c = DAQmxClearTask(impl.task);
+					r = (r < 0) ? r : c;
+				}
+
+				impl.attached.store(false);
+				impl.task = NULL;
+				return r;
+			}
+
+			int32 AnalogOutputEngineCore::Start() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (impl.ring.Count() == 0) {
+					return NativeErrorInvalidState;
+				}
+
+				impl.samplesWritten = 0;
+				impl.blocksWritten.store(0);
+				impl.underruns.store(0);
+				impl.blocksHeld.store(0);
+				impl.samplesRegenerated.store(0);
+				impl.writeErrors.store(0);
+				impl.lastError.store(0);
+
+				// Fill the device buffer before the first sample clock edge.
+				uInt32 prefilled = 0;
+
+				while (prefilled < impl.config.bufferBlocks && impl.WriteNext()) {
+
+					if (impl.lastError.load() < 0) {
+						return impl.lastError.load();
+					}
+					prefilled++;
+				}
+
+				impl.credits.store(impl.config.bufferBlocks - prefilled);
+				impl.stopping.store(false);
+				impl.running.store(true, std::memory_order_release);
+
+				int32 r = DAQmxStartTask(impl.task);
+
+				if (r < 0) {
+					impl.running.store(false);
+					return r;
+				}
+
+				try {
+					impl.feeder = std::thread(&Impl::Run, &impl);
+				}
+				catch (const std::system_error&) {
+					impl.running.store(false);
+					DAQmxStopTask(impl.task);
+					return NativeErrorOutOfMemory;
+				}
+				return r;
+			}
+
+			int32 AnalogOutputEngineCore::Stop() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.running.exchange(false)) {
+					return 0;
+				}
+
+				impl.stopping.store(true, std::memory_order_release);
+				impl.WakeFeeder();
+
+				if (impl.feeder.joinable()) {
+					impl.feeder.join();
+				}
+
+				int32 r = DAQmxStopTask(impl.task);
+
+				// Wake up a producer waiting for room so that it can observe
+				// the stop.
+				{
+					std::lock_guard<std::mutex> lock(impl.waitMutex);
+					impl.waitCondition.notify_all();
+				}
+				return r;
+			}
+
+			bool AnalogOutputEngineCore::IsRunning() const {
+				return _impl != nullptr && _impl->running.load();
+			}
+
+			void* AnalogOutputEngineCore::BeginWriteBlock() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return nullptr;
+				}
+
+				OutputBlockHeader* header = nullptr;
+				uint8_t* slot = _impl->ring.BeginWrite(header);
+
+				if (slot != nullptr) {
+					header->sequence = _impl->produced;
+				}
+				return slot;
+			}
+
+			void AnalogOutputEngineCore::CommitWriteBlock() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return;
+				}
+
+				_impl->ring.CommitWrite();
+				_impl->produced++;
+				_impl->WakeFeeder();
+			}
+
+			void* AnalogOutputEngineCore::WaitWriteBlock(uInt32 timeoutMs) {
+
+				void* slot = BeginWriteBlock();
+
+				if (slot != nullptr || _impl == nullptr || !_impl->attached.load()) {
+					return slot;
+				}
+
+				Impl& impl = *_impl;
+				const auto deadline = std::chrono::steady_clock::now()
+					+ std::chrono::milliseconds(timeoutMs);
+
+				impl.waiters.fetch_add(1, std::memory_order_seq_cst);
+				{
+					std::unique_lock<std::mutex> lock(impl.waitMutex);
+
+					while ((slot = BeginWriteBlock()) == nullptr) {
+						if (impl.waitCondition.wait_until(lock, deadline)
+							== std::cv_status::timeout) {
+							slot = BeginWriteBlock();
+							break;
+						}
+					}
+				}
+				impl.waiters.fetch_sub(1, std::memory_order_seq_cst);
+				return slot;
+			}
+
+			int32 AnalogOutputEngineCore::WriteBlock(const void* data, uInt32 timeoutMs) {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				if (data == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				void* slot = WaitWriteBlock(timeoutMs);
+
+				if (slot == nullptr) {
+					return NativeErrorTimeout;
+				}
+
+				std::memcpy(slot, data, _impl->blockBytes);
+				CommitWriteBlock();
+				return NativeSuccess;
+			}
+
+			size_t AnalogOutputEngineCore::FreeBlocks() const {
+				return (_impl != nullptr && _impl->attached.load())
+					? _impl->ring.Capacity() - _impl->ring.Count() : 0;
+			}
+
+			size_t AnalogOutputEngineCore::PendingBlocks() const {
+				return (_impl != nullptr) ? _impl->ring.Count() : 0;
+			}
+
+			uInt64 AnalogOutputEngineCore::SamplesGenerated() const {
+
+				uInt64 generated = 0;
+
+				if (_impl == nullptr || !_impl->attached.load()
+					|| DAQmxGetWriteTotalSampPerChanGenerated(_impl->task, &generated) < 0) {
+					return 0;
+				}
+				return generated;
+			}
+
+			AnalogOutputEngineCounters AnalogOutputEngineCore::Counters() const {
+
+				AnalogOutputEngineCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.blocksWritten = _impl->blocksWritten.load(std::memory_order_relaxed);
+					counters.underruns = _impl->underruns.load(std::memory_order_relaxed);
+					counters.blocksHeld = _impl->blocksHeld.load(std::memory_order_relaxed);
+					counters.samplesRegenerated = _impl->samplesRegenerated.load(std::memory_order_relaxed);
+					counters.writeErrors = _impl->writeErrors.load(std::memory_order_relaxed);
+					counters.lastError = _impl->lastError.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			TaskHandle AnalogOutputEngineCore::Task() const {
+				return (_impl != nullptr) ? _impl->task : NULL;
+			}
+
+			const AnalogOutputEngineConfig& AnalogOutputEngineCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the analog output streaming engine. Safe to include from code
+* compiled with /clr; the producer ring, the feeder thread and the DAQmx
+* callback live in AnalogOutputEngineCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Settings of an `AnalogOutputEngineCore`.
+			*/
+			struct AnalogOutputEngineConfig {
+
+				/** Number of channels in the task. */
+				uInt32 channels;
+
+				/** Samples per channel in one block; also the N of the
+				*   EveryNSamplesTransferred event. */
+				uInt32 samplesPerBlock;
+
+				/** Blocks the producer ring holds ahead of the feeder. */
+				uInt32 ringBlocks;
+
+				/** Size of the device buffer, in blocks; passed to
+				*   `DAQmxCfgOutputBuffer`. */
+				uInt32 bufferBlocks;
+
+				/** `Float64` (`DAQmxWriteAnalogF64`, volts) or `Int16`
+				*   (`DAQmxWriteBinaryI16`, DAC codes). */
+				SampleFormat format;
+
+				/** Layout of the blocks written by the producer. */
+				int32 fillMode;
+
+				/** If `true`, the device repeats old samples when the feeder
+				*   falls behind (`DAQmx_Val_AllowRegen`); if `false`, it stops
+				*   with an error instead. */
+				bool regeneration;
+
+				/** If `true`, an empty ring is bridged with blocks holding the
+				*   last written value of every channel, so the device never
+				*   runs dry. */
+				bool holdOnUnderrun;
+
+				/** Timeout, in seconds, of the writes issued by the feeder. */
+				float64 writeTimeout;
+
+				/** If `true`, the engine clears the task when it is destroyed. */
+				bool ownsTask;
+			};
+
+			inline AnalogOutputEngineConfig DefaultAnalogOutputEngineConfig() {
+
+				AnalogOutputEngineConfig config;
+				config.channels = 1;
+				config.samplesPerBlock = 1000;
+				config.ringBlocks = 64;
+				config.bufferBlocks = 8;
+				config.format = SampleFormat::Float64;
+				config.fillMode = DAQmx_Val_GroupByChannel;
+				config.regeneration = false;
+				config.holdOnUnderrun = false;
+				config.writeTimeout = 1.0;
+				config.ownsTask = false;
+				return config;
+			}
+
+			/**
+			* @brief Counters of the engine. Read without locking.
+			*/
+			struct AnalogOutputEngineCounters {
+
+				/** Producer blocks written to the device. */
+				uInt64 blocksWritten;
+
+				/** Times the device had room but the ring was empty. */
+				uInt64 underruns;
+
+				/** Blocks written by `holdOnUnderrun` in place of missing
+				*   producer blocks. */
+				uInt64 blocksHeld;
+
+				/** Samples per channel the device generated again from old
+				*   data, with regeneration. */
+				uInt64 samplesRegenerated;
+
+				uInt64 writeErrors;
+				int32 lastError;
+			};
+
+			/**
+			* @brief Streams long, non-repeating waveforms to an analog output
+			*        task from native code.
+			*
+			* The producer fills blocks of a preallocated lock-free ring,
+			* either in place (`BeginWriteBlock`/`CommitWriteBlock`) or by
+			* copy (`WriteBlock`). `Start` writes the first blocks into the
+			* device buffer and starts the task. A native EveryNSamples
+			* callback (`DAQmx_Val_Transferred_From_Buffer`) then hands one
+			* credit per block that left the device buffer to a feeder
+			* thread, which refills the device from the ring with
+			* `DAQmxWriteAnalogF64` or `DAQmxWriteBinaryI16`. The callback
+			* never writes or blocks.
+			*
+			* When the ring is empty as the device has room, the engine counts
+			* an underrun. With `holdOnUnderrun` it writes a block holding the
+			* last values instead. Otherwise the device runs dry: with
+			* `regeneration` it repeats old samples, which the engine counts
+			* from `DAQmxGetWriteTotalSampPerChanGenerated`, and without it the
+			* driver stops the task and the next write fails.
+			*
+			* One producer thread may write blocks; `Attach`, `Start`, `Stop`
+			* and `Detach` belong to one controlling thread.
+			*
+			* All methods return DAQmx status codes or `NativeStatus` codes.
+			*/
+			class AnalogOutputEngineCore {
+
+			public:
+				AnalogOutputEngineCore();
+				~AnalogOutputEngineCore();
+
+				AnalogOutputEngineCore(const AnalogOutputEngineCore&) = delete;
+				AnalogOutputEngineCore& operator=(const AnalogOutputEngineCore&) = delete;
+
+				/**
+				* @brief Attaches to a configured, not yet started output task:
+				*        sets its buffer and regeneration mode and registers the
+				*        callback.
+				*/
+				int32 Attach(TaskHandle task, const AnalogOutputEngineConfig& config);
+
+				/**
+				* @brief Stops, unregisters the callback, and clears the task if
+				*        the engine owns it.
+				*
+				* Returns once no driver callback is inside the engine, unless
+				* called from a callback of the callback path; the engine then
+				* waits on the next `Attach` or in its destructor.
+				*/
+				int32 Detach();
+
+				/**
+				* @brief Writes up to `bufferBlocks` blocks of the ring to the
+				*        device, starts the task and the feeder.
+				*
+				* @return `NativeErrorInvalidState` if the ring is empty.
+				*/
+				int32 Start();
+
+				/**
+				* @brief Stops the feeder and the task. Blocks not yet written
+				*        stay in the ring and are written first by the next
+				*        `Start`.
+				*/
+				int32 Stop();
+
+				bool IsRunning() const;
+
+				/**
+				* @brief Returns the next free block of the ring, to be filled
+				*        with `channels * samplesPerBlock` samples in `fillMode`
+				*        layout, or `NULL` if the ring is full.
+				*/
+				void* BeginWriteBlock();
+
+				/**
+				* @brief Like `BeginWriteBlock`, waiting up to `timeoutMs`
+				*        milliseconds for a free block, e.g. to render a
+				*        waveform into it in place.
+				*/
+				void* WaitWriteBlock(uInt32 timeoutMs);
+
+				/**
+				* @brief Publishes the block obtained by `BeginWriteBlock`. A
+				*        block left uncommitted, e.g. after a failed render, is
+				*        not published and is handed out again.
+				*/
+				void CommitWriteBlock();
+
+				/**
+				* @brief Copies one block into the ring, waiting up to
+				*        `timeoutMs` milliseconds for room.
+				*
+				* @return `0`, `NativeErrorTimeout`, `NativeErrorNotAttached` or
+				*         `NativeErrorInvalidArgument`.
+				*/
+				int32 WriteBlock(const void* data, uInt32 timeoutMs);
+
+				/** Blocks the producer can write without waiting. */
+				size_t FreeBlocks() const;
+
+				/** Blocks in the ring not yet written to the device. */
+				size_t PendingBlocks() const;
+
+				/**
+				* @brief Samples per channel generated by the device since the
+				*        last `Start`.
+				*/
+				uInt64 SamplesGenerated() const;
+
+				AnalogOutputEngineCounters Counters() const;
+
+				TaskHandle Task() const;
+
+				const AnalogOutputEngineConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,704 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AsyncReaderCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "CallbackRegistry.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// What the shared poller needs from a reader.
+				struct PollTarget {
+					virtual bool HasWork() const = 0;
+					virtual uInt32 PollIntervalUs() const = 0;
+					virtual void Pump() = 0;
+
+				protected:
+					// Readers are deleted as readers, never through the poller.
+					~PollTarget() = default;
+				};
+
+				// One thread for all readers that have no event. It pumps the
+				// readers with pending reads at the shortest of their intervals
+				// and sleeps while none has work; a submit wakes it up.
+				//
+				// Readers are pumped without the lock, so a completion on the
+				// poller thread may add or remove readers.
+				class SharedPoller {
+
+				public:
+					static SharedPoller& Instance() {
+						// Never destroyed: the thread may outlive static destruction.
+						static SharedPoller* poller = new SharedPoller();
+						return *poller;
+					}
+
+					void Add(PollTarget* target) {
+
+						std::lock_guard<std::mutex> lock(_mutex);
+						_targets.push_back(target);
+
+						if (!_thread.joinable()) {
+							_thread = std::thread(&SharedPoller::Run, this, _generation);
+						}
+					}
+
+					// Returns once the poller is no longer inside `target`, unless
+					// called from the poller thread, which may be inside it.
+					void Remove(PollTarget* target) {
+
+						std::thread finished;
+						{
+							std::unique_lock<std::mutex> lock(_mutex);
+							_targets.erase(std::remove(_targets.begin(), _targets.end(), target),
+								_targets.end());
+
+							const bool onPoller = _thread.joinable()
+								&& _thread.get_id() == std::this_thread::get_id();
+
+							if (_targets.empty() && _thread.joinable()) {
+								_generation++;
+								_wakeup.notify_all();
+
+								// The thread cannot join itself; it leaves once
+								// back from the pump.
+								if (onPoller) {
+									_thread.detach();
+								}
+								else {
+									finished = std::move(_thread);
+								}
+							}
+							else if (!onPoller) {
+								_left.wait(lock, [this, target] { return _current != target; });
+							}
+						}
+
+						if (finished.joinable()) {
+							finished.join();
+						}
+					}
+
+					// Called after a reader got work. Only takes the lock when the
+					// poller sleeps.
+					void Wake() {
+
+						if (_idle.load(std::memory_order_seq_cst)) {
+							std::lock_guard<std::mutex> lock(_mutex);
+							_wakeup.notify_all();
+						}
+					}
+
+				private:
+					SharedPoller() : _current(nullptr), _generation(0), _idle(false) {}
+
+					void Run(uInt64 generation) {
+
+						std::unique_lock<std::mutex> lock(_mutex);
+
+						while (_generation == generation) {
+
+							uInt32 intervalUs = 0;
+
+							// `_visit` keeps its capacity; readers removed while
+							// another was pumped are skipped.
+							_visit.assign(_targets.begin(), _targets.end());
+
+							for (size_t k = 0; k < _visit.size() && _generation == generation; k++) {
+
+								PollTarget* target = _visit[k];
+
+								if (std::find(_targets.begin(), _targets.end(), target) == _targets.end()
+									|| !target->HasWork()) {
+									continue;
+								}
+
+								const uInt32 interval = std::max<uInt32>(target->PollIntervalUs(), 1);
+								intervalUs = (intervalUs == 0) ? interval : std::min(intervalUs, interval);
+
+								_current = target;
+								lock.unlock();
+								target->Pump();
+								lock.lock();
+
+								if (_current == target) {
+									_current = nullptr;
+								}
+								_left.notify_all();
+							}
+
+							if (_generation != generation) {
+								break;
+							}
+
+							if (intervalUs != 0) {
+								_wakeup.wait_for(lock, std::chrono::microseconds(intervalUs));
+								continue;
+							}
+
+							// Pairs with the increment of the pending count before
+							// `Wake`: either the poller sees the work or the
+							// submitter sees the poller idle.
+							_idle.store(true, std::memory_order_seq_cst);
+
+							bool work = false;
+							for (PollTarget* target : _targets) {
+								work = work || target->HasWork();
+							}
+
+							if (!work && _generation == generation) {
+								_wakeup.wait(lock);
+							}
+							_idle.store(false, std::memory_order_seq_cst);
+						}
+					}
+
+					std::mutex _mutex;
+					std::condition_variable _wakeup;
+					std::condition_variable _left;
+					std::vector<PollTarget*> _targets;
+					std::vector<PollTarget*> _visit;
+					PollTarget* _current;
+					std::thread _thread;
+					uInt64 _generation;
+					std::atomic<bool> _idle;
+				};
+
+				// Reader whose completion runs on this thread, if any.
+				thread_local const void* t_completing = nullptr;
+
+				struct PendingRead {
+					AsyncReadRequest request;
+
+					// Cancelled while queued; skipped when it reaches the head.
+					bool cancelled;
+
+					// Head whose samples are being checked or transferred.
+					bool inFlight;
+
+					// Cancel arrived while in flight; honoured if the samples
+					// turn out not to be there yet.
+					bool cancelRequested;
+				};
+			}
+
+			struct AsyncReaderCore::Impl final : PollTarget {
+
+				TaskHandle task;
+				AsyncReaderConfig config;
+				AsyncReadCompletion completion;
+				void* context;
+				bool eventRegistered;
+				bool polled;
+
+				// Passed to DAQmx as callbackData; `0` without an event.
+				CallbackKey key;
+
+				// Detached from a callback, which `Synchronize` cannot wait
+				// for: a callback may still be pumping.
+				bool unsettled;
+
+				// FIFO of `config.maxPending` reads, guarded by `queueMutex`.
+				// Only the thread holding the pump removes the head.
+				std::mutex queueMutex;
+				PendingRead* queue;
+				uInt32 head;
+				uInt32 count;
+
+				// Reads not yet completed (queued minus cancelled).
+				std::atomic<uInt32> live;
+
+				// Number of pump requests since the pumping thread last
+				// looked; non-zero while a thread is pumping.
+				std::atomic<uInt32> pumpRequests;
+				std::atomic<bool> attached;
+
+				std::atomic<uInt64> submitted;
+				std::atomic<uInt64> completed;
+				std::atomic<uInt64> failed;
+				std::atomic<uInt64> cancelled;
+				std::atomic<uInt64> wakeups;
+
+				Impl() :
+					task(NULL), config(DefaultAsyncReaderConfig()), completion(nullptr),
+					context(nullptr), eventRegistered(false), polled(false), key(0), unsettled(false),
+					queue(nullptr), head(0), count(0), live(0), pumpRequests(0),
+					attached(false), submitted(0), completed(0), failed(0),
+					cancelled(0), wakeups(0) {}
+
+				~Impl() {
+					delete[] queue;
+				}
+
+				static int32 CVICALLBACK OnEveryNSamples(TaskHandle /*taskHandle*/,
+					int32 /*everyNsamplesEventType*/, uInt32 /*nSamples*/,
+					void* callbackData) {
+
+					// The key no longer resolves once `Detach` released it.
+					CallbackEpochGuard guard;
+					Impl* impl = static_cast<Impl*>(CallbackRegistry::Instance().Owner(
+						reinterpret_cast<CallbackKey>(callbackData)));
+
+					if (impl != nullptr) {
+						impl->Pump();
+					}
+					return 0;
+				}
+
+				bool HasWork() const override {
+					return live.load(std::memory_order_seq_cst) > 0;
+				}
+
+				uInt32 PollIntervalUs() const override {
+					return config.pollIntervalUs;
+				}
+
+				// Drains the queue, or leaves it to the thread already doing so.
+				void Pump() override {
+
+					if (pumpRequests.fetch_add(1, std::memory_order_acq_rel) != 0) {
+						return;
+					}
+
+					uInt32 seen = 1;
+
+					for (;;) {
+
+						wakeups.fetch_add(1, std::memory_order_relaxed);
+						Drain();
+
+						uInt32 expected = seen;
+						if (pumpRequests.compare_exchange_strong(expected, 0,
+							std::memory_order_acq_rel)) {
+							break;
+						}
+						seen = expected;
+					}
+				}
+
+				void PopHead() {
+					head = (head + 1 == config.maxPending) ? 0 : head + 1;
+					count--;
+				}
+
+				void PopCancelled() {
+					while (count > 0 && queue[head].cancelled) {
+						PopHead();
+					}
+				}
+
+				// Completes reads from the head while their samples are there.
+				// Once detached, completes whatever is left as cancelled.
+				void Drain() {
+
+					for (;;) {
+
+						PendingRead* pending;
+						AsyncReadRequest request;
+						bool detached;
+						{
+							std::lock_guard<std::mutex> lock(queueMutex);
+							PopCancelled();
+
+							if (count == 0) {
+								return;
+							}
+
+							pending = &queue[head];
+							request = pending->request;
+							detached = !attached.load(std::memory_order_acquire);
+
+							if (detached) {
+								PopHead();
+								live.fetch_sub(1, std::memory_order_seq_cst);
+							}
+							else {
+								pending->inFlight = true;
+							}
+						}
+
+						if (detached) {
+							Complete(request.tag, NativeErrorCancelled, 0);
+							continue;
+						}
+
+						uInt32 available = 0;
+						int32 status = DAQmxGetReadAvailSampPerChan(task, &available);
+						int32 read = 0;
+
+						if (status >= 0 && available < request.samplesPerChannel) {
+
+							bool cancel;
+							{
+								std::lock_guard<std::mutex> lock(queueMutex);
+								pending->inFlight = false;
+								cancel = pending->cancelRequested;
+
+								if (cancel) {
+									PopHead();
+									live.fetch_sub(1, std::memory_order_seq_cst);
+								}
+							}
+
+							if (cancel) {
+								Complete(request.tag, NativeErrorCancelled, 0);
+								continue;
+							}
+							return;
+						}
+
+						if (status >= 0) {
+							status = Read(request, &read);
+						}
+
+						{
+							std::lock_guard<std::mutex> lock(queueMutex);
+							PopHead();
+							live.fetch_sub(1, std::memory_order_seq_cst);
+						}
+
+						Complete(request.tag, status, read);
+					}
+				}
+
+				// The samples are in the buffer, so the read does not wait.
+				int32 Read(const AsyncReadRequest& request, int32* read) {
+
+					if (config.digital) {
+
+						if (config.format == SampleFormat::UInt32) {
+							return DAQmxReadDigitalU32(task, (int32)request.samplesPerChannel,
+								0.0, (bool32)config.fillMode, static_cast<uInt32*>(request.data),
+								request.bufferSizeInSamples, read, NULL);
+						}
+						return DAQmxReadDigitalU16(task, (int32)request.samplesPerChannel,
+							0.0, (bool32)config.fillMode, static_cast<uInt16*>(request.data),
+							request.bufferSizeInSamples, read, NULL);
+					}
+
+					return ReadSamples(task, config.format, (int32)request.samplesPerChannel,
+						0.0, config.fillMode, request.data, request.bufferSizeInSamples, read);
+				}
+
+				void Complete(uInt64 tag, int32 status, int32 read) {
+
+					if (status == NativeErrorCancelled) {
+						cancelled.fetch_add(1, std::memory_order_relaxed);
+					}
+					else if (status < 0) {
+						failed.fetch_add(1, std::memory_order_relaxed);
+					}
+					else {
+						completed.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					const void* outer = t_completing;
+					t_completing = this;
+					completion(context, tag, status, (status < 0) ? 0 : read);
+					t_completing = outer;
+				}
+			};
+
+			AsyncReaderCore::AsyncReaderCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			AsyncReaderCore::~AsyncReaderCore() {
+
+				if (_impl != nullptr) {
+					Detach();
+
+					// Destroyed from a callback: left to the process rather
+					// than freed under a callback in flight.
+					if (!_impl->unsettled || CallbackRegistry::Instance().Synchronize()) {
+						delete _impl;
+					}
+					_impl = nullptr;
+				}
+			}
+
+			int32 AsyncReaderCore::Attach(TaskHandle task, const AsyncReaderConfig& config,
+				AsyncReadCompletion completion, void* context) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (_impl->attached.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				// The queue is about to be replaced.
+				if (_impl->unsettled) {
+					if (!CallbackRegistry::Instance().Synchronize()) {
+						return NativeErrorInvalidState;
+					}
+					_impl->unsettled = false;
+				}
+
+				if (task == NULL || completion == nullptr || config.channels == 0
+					|| config.maxPending == 0
+					|| (config.notifySamples == 0 && config.pollIntervalUs == 0)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (config.fillMode != DAQmx_Val_GroupByChannel
+					&& config.fillMode != DAQmx_Val_GroupByScanNumber) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (SampleSize(config.format) == 0 || (config.digital
+					&& config.format != SampleFormat::UInt32
+					&& config.format != SampleFormat::UInt16)) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				delete[] _impl->queue;
+				_impl->queue = new (std::nothrow) PendingRead[config.maxPending];
+
+				if (_impl->queue == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				_impl->task = task;
+				_impl->config = config;
+				_impl->completion = completion;
+				_impl->context = context;
+				_impl->head = 0;
+				_impl->count = 0;
+				_impl->live.store(0);
+				_impl->submitted.store(0);
+				_impl->completed.store(0);
+				_impl->failed.store(0);
+				_impl->cancelled.store(0);
+				_impl->wakeups.store(0);
+				_impl->attached.store(true, std::memory_order_release);
+
+				if (config.notifySamples != 0) {
+
+					int32 r = CallbackRegistry::Instance().Allocate(_impl, _impl->key)
+						? NativeSuccess : NativeErrorOutOfMemory;
+
+					if (r >= 0) {
+						r = DAQmxRegisterEveryNSamplesEvent(task,
+							DAQmx_Val_Acquired_Into_Buffer, config.notifySamples, 0,
+							&Impl::OnEveryNSamples, reinterpret_cast<void*>(_impl->key));
+					}
+
+					if (r < 0) {
+						CallbackRegistry::Instance().Release(_impl->key, _impl);
+						_impl->key = 0;
+						_impl->attached.store(false);
+						_impl->task = NULL;
+						return r;
+					}
+					_impl->eventRegistered = true;
+				}
+				else {
+					SharedPoller::Instance().Add(_impl);
+					_impl->polled = true;
+				}
+				return NativeSuccess;
+			}
+
+			int32 AsyncReaderCore::Detach() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return 0;
+				}
+
+				// It would wait for the pump it is called from.
+				if (t_completing == _impl) {
+					return NativeErrorInvalidState;
+				}
+
+				_impl->attached.store(false, std::memory_order_release);
+
+				int32 r = 0;
+
+				if (_impl->eventRegistered) {
+					// A NULL callback unregisters the event.
+					r = DAQmxRegisterEveryNSamplesEvent(_impl->task,
+						DAQmx_Val_Acquired_Into_Buffer, _impl->config.notifySamples,
+						0, NULL, NULL);
+					_impl->eventRegistered = false;
+
+					// DAQmx may still be calling a callback it picked before
+					// the event was unregistered.
+					CallbackRegistry::Instance().Release(_impl->key, _impl);
+					_impl->key = 0;
+					_impl->unsettled = !CallbackRegistry::Instance().Synchronize();
+				}
+
+				if (_impl->polled) {
+					SharedPoller::Instance().Remove(_impl);
+					_impl->polled = false;
+				}
+
+				// Let a pass that started before the flag was cleared finish,
+				// then cancel what is left. A read submitted concurrently is
+				// cancelled by the pass of its own submit.
+				while (_impl->pumpRequests.load(std::memory_order_acquire) != 0) {
+					std::this_thread::yield();
+				}
+
+				_impl->Pump();
+				return r;
+			}
+
+			int32 AsyncReaderCore::Submit(const AsyncReadRequest& request) {
+
+				if (_impl == nullptr || !_impl->attached.load(std::memory_order_acquire)) {
+					return NativeErrorNotAttached;
+				}
+
+				if (request.data == nullptr || request.samplesPerChannel == 0
+					|| request.samplesPerChannel > 0x7FFFFFFFu) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if ((uInt64)request.samplesPerChannel * _impl->config.channels
+					> request.bufferSizeInSamples) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(_impl->queueMutex);
+					_impl->PopCancelled();
+
+					if (_impl->count == _impl->config.maxPending) {
+						return NativeErrorQueueFull;
+					}
+
+					uInt32 tail = _impl->head + _impl->count;
+					tail -= (tail >= _impl->config.maxPending) ? _impl->config.maxPending : 0;
+
+					PendingRead& pending = _impl->queue[tail];
+					pending.request = request;
+					pending.cancelled = false;
+					pending.inFlight = false;
+					pending.cancelRequested = false;
+					_impl->count++;
+					_impl->live.fetch_add(1, std::memory_order_seq_cst);
+				}
+
+				_impl->submitted.fetch_add(1, std::memory_order_relaxed);
+
+				// The samples may already be there.
+				_impl->Pump();
+
+				if (_impl->polled) {
+					SharedPoller::Instance().Wake();
+				}
+				return NativeSuccess;
+			}
+
+			bool AsyncReaderCore::Cancel(uInt64 tag) {
+
+				if (_impl == nullptr || _impl->queue == nullptr) {
+					return false;
+				}
+
+				bool found = false;
+				bool completeNow = false;
+				{
+					std::lock_guard<std::mutex> lock(_impl->queueMutex);
+
+					for (uInt32 i = 0; i < _impl->count && !found; i++) {
+
+						uInt32 index = _impl->head + i;
+						index -= (index >= _impl->config.maxPending) ? _impl->config.maxPending : 0;
+						PendingRead& pending = _impl->queue[index];
+
+						if (pending.cancelled || pending.request.tag != tag) {
+							continue;
+						}
+
+						found = true;
+
+						if (pending.inFlight) {
+							pending.cancelRequested = true;
+						}
+						else {
+							pending.cancelled = true;
+							completeNow = true;
+							_impl->live.fetch_sub(1, std::memory_order_seq_cst);
+						}
+					}
+
+					_impl->PopCancelled();
+				}
+
+				if (completeNow) {
+					_impl->Complete(tag, NativeErrorCancelled, 0);
+				}
+				return found;
+			}
+
+			void AsyncReaderCore::Poll() {
+
+				if (_impl != nullptr && _impl->attached.load(std::memory_order_acquire)) {
+					_impl->Pump();
+				}
+			}
+
+			size_t AsyncReaderCore::PendingReads() const {
+				return (_impl != nullptr) ? _impl->live.load(std::memory_order_relaxed) : 0;
+			}
+
+			AsyncReaderCounters AsyncReaderCore::Counters() const {
+
+				AsyncReaderCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.submitted = _impl->submitted.load(std::memory_order_relaxed);
+					counters.completed = _impl->completed.load(std::memory_order_relaxed);
+					counters.failed = _impl->failed.load(std::memory_order_relaxed);
+					counters.cancelled = _impl->cancelled.load(std::memory_order_relaxed);
+					counters.wakeups = _impl->wakeups.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			TaskHandle AsyncReaderCore::Task() const {
+				return (_impl != nullptr) ? _impl->task : NULL;
+			}
+
+			const AsyncReaderConfig& AsyncReaderCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the asynchronous reader. Safe to include from code compiled with
+* /clr; the request queue, the notification handling and the shared poller
+* live in AsyncReaderCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Settings of an `AsyncReaderCore`.
+			*/
+			struct AsyncReaderConfig {
+
+				/** Number of channels in the task. */
+				uInt32 channels;
+
+				/** Sample format of the reads. */
+				SampleFormat format;
+
+				/** If `true`, `UInt32` and `UInt16` are read with
+				*   `DAQmxReadDigitalU32` / `DAQmxReadDigitalU16` instead of the
+				*   binary reads. Other formats are rejected. */
+				bool digital;
+
+				/** `DAQmx_Val_GroupByChannel` or `DAQmx_Val_GroupByScanNumber`. */
+				int32 fillMode;
+
+				/** N of the EveryNSamples event that drives the reader. A read
+				*   completes at the first event after its samples arrived, so
+				*   this bounds the added latency to N samples. `0` does not
+				*   register the event (e.g. because an engine already owns it);
+				*   the shared poller checks the task instead. */
+				uInt32 notifySamples;
+
+				/** Interval of the shared poller while the reader has pending
+				*   reads, in microseconds. Only used when `notifySamples` is 0. */
+				uInt32 pollIntervalUs;
+
+				/** Reads that may be pending at the same time. */
+				uInt32 maxPending;
+			};
+
+			inline AsyncReaderConfig DefaultAsyncReaderConfig() {
+
+				AsyncReaderConfig config;
+				config.channels = 1;
+				config.format = SampleFormat::Float64;
+				config.digital = false;
+				config.fillMode = DAQmx_Val_GroupByChannel;
+				config.notifySamples = 1000;
+				config.pollIntervalUs = 1000;
+				config.maxPending = 64;
+				return config;
+			}
+
+			/**
+			* @brief One read: `samplesPerChannel` samples per channel into
+			*        `data`, which must stay valid until the read completes.
+			*/
+			struct AsyncReadRequest {
+				void* data;
+				uInt32 bufferSizeInSamples;
+				uInt32 samplesPerChannel;
+
+				/** Caller-chosen key, passed back on completion and used by
+				*   `Cancel`. Must be unique among the pending reads. */
+				uInt64 tag;
+			};
+
+			/**
+			* @brief Called once for every accepted read, with the status of the
+			*        DAQmx read, `NativeErrorCancelled`, or the error that kept it
+			*        from being issued.
+			*
+			* Runs on the thread that completed the read: the DAQmx callback
+			* thread, the shared poller, or the thread calling `Submit`, `Cancel`
+			* or `Detach`. It must return quickly and may submit further reads
+			* and detach other readers, but not its own reader: `Detach` then
+			* returns `NativeErrorInvalidState`.
+			*/
+			typedef void (*AsyncReadCompletion)(void* context, uInt64 tag,
+				int32 status, int32 sampsPerChanRead);
+
+			/**
+			* @brief Counters of the reader. Read without locking.
+			*/
+			struct AsyncReaderCounters {
+				uInt64 submitted;
+				uInt64 completed;
+				uInt64 failed;
+				uInt64 cancelled;
+				/** Notifications (events, polls and submits) that checked the task. */
+				uInt64 wakeups;
+			};
+
+			/**
+			* @brief Completes reads of N samples per channel when the samples are
+			*        in the buffer, without a thread blocked per read or per task.
+			*
+			* Reads are queued per task in a preallocated FIFO. Whenever the
+			* driver signals new data (native EveryNSamples callback) or the
+			* shared poller visits the task, the reader compares the oldest
+			* pending read with `DAQmxGetReadAvailSampPerChan` and issues it only
+			* once all of its samples are there, so the DAQmx read returns
+			* immediately. Reads therefore complete in submission order.
+			*
+			* One thread drives the queue at a time; a notification arriving
+			* while another thread is working on the queue only asks that
+			* thread for another pass, so completions that submit the next read
+			* never recurse or block. All readers without an event share one
+			* poller thread, which sleeps while none of them has a pending read.
+			*
+			* The reader uses the task's EveryNSamples event, which DAQmx allows
+			* to be registered once per task; next to an `AcquisitionEngineCore`
+			* use `notifySamples = 0`.
+			*/
+			class AsyncReaderCore {
+
+			public:
+				AsyncReaderCore();
+				~AsyncReaderCore();
+
+				AsyncReaderCore(const AsyncReaderCore&) = delete;
+				AsyncReaderCore& operator=(const AsyncReaderCore&) = delete;
+
+				/**
+				* @brief Allocates the queue and registers the event or joins the
+				*        shared poller. The task may already be running.
+				*
+				* @return `0`, a DAQmx error, `NativeErrorInvalidState`,
+				*         `NativeErrorInvalidArgument`, `NativeErrorUnsupportedFormat`
+				*         or `NativeErrorOutOfMemory`.
+				*/
+				int32 Attach(TaskHandle task, const AsyncReaderConfig& config,
+					AsyncReadCompletion completion, void* context);
+
+				/**
+				* @brief Stops the notifications and completes every pending read
+				*        with `NativeErrorCancelled`. Does not stop the task.
+				*
+				* Returns once no driver callback is inside the reader, unless
+				* called from a callback of the callback path, e.g. the
+				* completion of an event-driven reader; the reader then waits
+				* on the next `Attach` or in its destructor.
+				*
+				* @return `0`, a DAQmx error, or `NativeErrorInvalidState` when
+				*         called from a completion of this reader.
+				*/
+				int32 Detach();
+
+				/**
+				* @brief Queues a read and completes it right away if its samples
+				*        are already available.
+				*
+				* @return `0` once the read is queued; the completion follows.
+				*         `NativeErrorNotAttached`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorBufferTooSmall` or `NativeErrorQueueFull`
+				*         reject the read without a completion.
+				*/
+				int32 Submit(const AsyncReadRequest& request);
+
+				/**
+				* @brief Cancels the pending read `tag`.
+				*
+				* A queued read completes with `NativeErrorCancelled` on the
+				* calling thread. A read whose samples are being transferred at
+				* that moment completes normally.
+				*
+				* @return `false` if no read with that tag is pending.
+				*/
+				bool Cancel(uInt64 tag);
+
+				/**
+				* @brief Checks the task and completes what it can. Called by the
+				*        event and the poller; callers that own the task's event
+				*        may call it from their own callback instead.
+				*/
+				void Poll();
+
+				size_t PendingReads() const;
+
+				AsyncReaderCounters Counters() const;
+
+				TaskHandle Task() const;
+
+				const AsyncReaderConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
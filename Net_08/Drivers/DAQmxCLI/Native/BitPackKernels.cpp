@@ -0,0 +1,305 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BitPackKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+#if NATIVE_X86 && (defined(_M_X64) || defined(__x86_64__))
+#define NATIVE_HAS_PDEP 1
+#else
+#define NATIVE_HAS_PDEP 0
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const uInt64 LowSevenBits = 0x7F7F7F7F7F7F7F7FULL;
+				const uInt64 LowBits = 0x0101010101010101ULL;
+
+				// Eight line bytes to eight bits. Sets bit 7 of every non-zero
+				// byte without carries between bytes, then moves bit 8i of the
+				// 0/1 bytes to bit 56 + i with one multiply.
+				inline uInt8 PackEight(const uInt8* lines) {
+
+					uInt64 v;
+					std::memcpy(&v, lines, sizeof(v));
+
+					const uInt64 high = (((v & LowSevenBits) + LowSevenBits) | v) & ~LowSevenBits;
+					return (uInt8)(((high >> 7) * 0x0102040810204080ULL) >> 56);
+				}
+
+				struct SpreadTable {
+					uInt64 values[256];
+
+					SpreadTable() {
+						for (uInt32 b = 0; b < 256; b++) {
+							uInt64 v = 0;
+							for (uInt32 k = 0; k < 8; k++) {
+								v |= (uInt64)((b >> k) & 1) << (8 * k);
+							}
+							values[b] = v;
+						}
+					}
+				};
+
+				const SpreadTable& Spread() {
+					static SpreadTable table;
+					return table;
+				}
+
+				// Bit by bit, for the unaligned ends. Keeps the other bits of
+				// the bytes it touches.
+				void PackBitwise(const uInt8* lines, size_t count, uInt8* bits, size_t bitOffset) {
+
+					for (size_t i = 0; i < count; i++) {
+
+						const size_t n = bitOffset + i;
+						const uInt8 mask = (uInt8)(1u << (n & 7));
+
+						bits[n >> 3] = (lines[i] != 0)
+							? (uInt8)(bits[n >> 3] | mask) : (uInt8)(bits[n >> 3] & ~mask);
+					}
+				}
+
+				void UnpackBitwise(const uInt8* bits, size_t bitOffset, size_t count, uInt8* lines) {
+
+					for (size_t i = 0; i < count; i++) {
+						const size_t n = bitOffset + i;
+						lines[i] = (uInt8)((bits[n >> 3] >> (n & 7)) & 1);
+					}
+				}
+
+				void PackScalar(const uInt8* lines, size_t count, uInt8* bits) {
+
+					for (size_t i = 0; i < count; i += 8) {
+						bits[i / 8] = PackEight(lines + i);
+					}
+				}
+
+				void UnpackTable(const uInt8* bits, size_t count, uInt8* lines) {
+
+					const SpreadTable& table = Spread();
+
+					for (size_t i = 0; i < count; i += 8) {
+						std::memcpy(lines + i, &table.values[bits[i / 8]], sizeof(uInt64));
+					}
+				}
+
+#if NATIVE_HAS_PDEP
+				NATIVE_TARGET_BMI2
+				void UnpackPdep(const uInt8* bits, size_t count, uInt8* lines) {
+
+					for (size_t i = 0; i < count; i += 8) {
+						const uInt64 v = _pdep_u64(bits[i / 8], LowBits);
+						std::memcpy(lines + i, &v, sizeof(v));
+					}
+				}
+#endif
+
+#if NATIVE_X86
+				NATIVE_TARGET_AVX2
+				size_t PackAvx2(const uInt8* lines, size_t count, uInt8* bits) {
+
+					const __m256i zero = _mm256_setzero_si256();
+					size_t i = 0;
+
+					for (; i + 64 <= count; i += 64) {
+
+						const uInt64 low = (uInt32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lines + i)), zero));
+						const uInt64 high = (uInt32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lines + i + 32)), zero));
+
+						const uInt64 packed = ~(low | (high << 32));
+						std::memcpy(bits + i / 8, &packed, sizeof(packed));
+					}
+
+					for (; i + 32 <= count; i += 32) {
+
+						const uInt32 packed = ~(uInt32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lines + i)), zero));
+						std::memcpy(bits + i / 8, &packed, sizeof(packed));
+					}
+					return i;
+				}
+
+				NATIVE_TARGET_SSE41
+				size_t PackSse2(const uInt8* lines, size_t count, uInt8* bits) {
+
+					const __m128i zero = _mm_setzero_si128();
+					size_t i = 0;
+
+					for (; i + 16 <= count; i += 16) {
+
+						const uInt16 packed = (uInt16)~_mm_movemask_epi8(_mm_cmpeq_epi8(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(lines + i)), zero));
+						std::memcpy(bits + i / 8, &packed, sizeof(packed));
+					}
+					return i;
+				}
+
+				// Each output byte takes the input byte holding its bit
+				// (`shuffle`), keeps that bit (`select`) and becomes 0 or 1.
+				NATIVE_TARGET_AVX2
+				size_t UnpackAvx2(const uInt8* bits, size_t count, uInt8* lines) {
+
+					const __m256i shuffle = _mm256_setr_epi8(
+						0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+						2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+					const __m256i select = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+					const __m256i one = _mm256_set1_epi8(1);
+					size_t i = 0;
+
+					for (; i + 32 <= count; i += 32) {
+
+						uInt32 word;
+						std::memcpy(&word, bits + i / 8, sizeof(word));
+
+						const __m256i spread = _mm256_shuffle_epi8(_mm256_set1_epi32((int)word), shuffle);
+						const __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(spread, select), select);
+
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(lines + i),
+							_mm256_and_si256(set, one));
+					}
+					return i;
+				}
+
+				NATIVE_TARGET_SSE41
+				size_t UnpackSse41(const uInt8* bits, size_t count, uInt8* lines) {
+
+					const __m128i shuffle = _mm_setr_epi8(
+						0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+					const __m128i select = _mm_set1_epi64x((long long)0x8040201008040201ULL);
+					const __m128i one = _mm_set1_epi8(1);
+					size_t i = 0;
+
+					for (; i + 16 <= count; i += 16) {
+
+						uInt16 word;
+						std::memcpy(&word, bits + i / 8, sizeof(word));
+
+						const __m128i spread = _mm_shuffle_epi8(_mm_set1_epi16((short)word), shuffle);
+						const __m128i set = _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(lines + i), _mm_and_si128(set, one));
+					}
+					return i;
+				}
+#endif
+
+				// `count` is a multiple of 8 and `bits` starts on a byte.
+				void PackAligned(const uInt8* lines, size_t count, uInt8* bits) {
+
+					size_t done = 0;
+#if NATIVE_X86
+					switch (ActiveSimdLevel()) {
+					case SimdLevel::Avx2:
+						done = PackAvx2(lines, count, bits);
+						break;
+					case SimdLevel::Sse41:
+						done = PackSse2(lines, count, bits);
+						break;
+					default:
+						break;
+					}
+#endif
+					PackScalar(lines + done, count - done, bits + done / 8);
+				}
+
+				void UnpackAligned(const uInt8* bits, size_t count, uInt8* lines) {
+
+					size_t done = 0;
+#if NATIVE_X86
+					switch (ActiveSimdLevel()) {
+					case SimdLevel::Avx2:
+						done = UnpackAvx2(bits, count, lines);
+						break;
+					case SimdLevel::Sse41:
+						done = UnpackSse41(bits, count, lines);
+						break;
+					default:
+						break;
+					}
+#endif
+#if NATIVE_HAS_PDEP
+					if (CpuHasBmi2()) {
+						UnpackPdep(bits + done / 8, count - done, lines + done);
+						return;
+					}
+#endif
+					UnpackTable(bits + done / 8, count - done, lines + done);
+				}
+			}
+
+			void PackLines(const uInt8* lines, size_t count, uInt8* bits, size_t bitOffset) {
+
+				// Bits up to the next byte boundary, then whole bytes, then the
+				// rest of the last byte.
+				const size_t head = std::min((8 - (bitOffset & 7)) & 7, count);
+				PackBitwise(lines, head, bits, bitOffset);
+
+				lines += head;
+				count -= head;
+
+				if (count == 0) {
+					return;
+				}
+
+				uInt8* aligned = bits + (bitOffset + head) / 8;
+				const size_t whole = count & ~(size_t)7;
+
+				PackAligned(lines, whole, aligned);
+				PackBitwise(lines + whole, count - whole, aligned, whole);
+			}
+
+			void UnpackLines(const uInt8* bits, size_t bitOffset, size_t count, uInt8* lines) {
+
+				const size_t head = std::min((8 - (bitOffset & 7)) & 7, count);
+				UnpackBitwise(bits, bitOffset, head, lines);
+
+				lines += head;
+				count -= head;
+
+				if (count == 0) {
+					return;
+				}
+
+				const uInt8* aligned = bits + (bitOffset + head) / 8;
+				const size_t whole = count & ~(size_t)7;
+
+				UnpackAligned(aligned, whole, lines);
+				UnpackBitwise(aligned, whole, count - whole, lines + whole);
+			}
+		}
+	}
+}
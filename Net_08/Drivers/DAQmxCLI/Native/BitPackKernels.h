@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized conversions between the one-byte-per-line layout of
+* `DAQmxReadDigitalLines` / `DAQmxWriteDigitalLines` and packed bits.
+*
+* Packing compares 16 (SSE2) or 32 (AVX2) line bytes against zero and
+* collects the results with movemask; unpacking broadcasts the bits,
+* shuffles the byte holding each line's bit into its lane and tests it.
+* Without SSE4.1 eight lines are packed with one multiply, and unpacked
+* with `pdep` where BMI2 is available.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Bytes taken by `lines` packed line states.
+			*/
+			inline size_t PackedLinesSize(size_t lines) {
+				return (lines + 7) / 8;
+			}
+
+			/**
+			* @brief Packs `count` line states, one byte each (non-zero is high),
+			*        into bits `bitOffset` .. `bitOffset + count - 1` of `bits`.
+			*
+			* Bit `n` of the stream is bit `n % 8` of byte `n / 8`. Bits outside
+			* the range are left as they are, so consecutive calls can fill a
+			* stream piece by piece.
+			*/
+			void PackLines(const uInt8* lines, size_t count, uInt8* bits, size_t bitOffset);
+
+			/**
+			* @brief Expands bits `bitOffset` .. `bitOffset + count - 1` of
+			*        `bits` into `count` bytes of 0 or 1.
+			*/
+			void UnpackLines(const uInt8* bits, size_t bitOffset, size_t count, uInt8* lines);
+		}
+	}
+}
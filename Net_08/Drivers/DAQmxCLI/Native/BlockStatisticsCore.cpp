@@ -0,0 +1,338 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BlockStatisticsCore.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "NativeStatus.h"
+#include "RawScalingCore.h"
+#include "StatisticsKernels.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Scans deinterleaved per pass for blocks grouped by scan.
+				const uInt32 PassSamples = 1024;
+
+				const size_t WordsPerStatistics = sizeof(ChannelStatistics) / sizeof(uInt64);
+				static_assert(sizeof(ChannelStatistics) == WordsPerStatistics * sizeof(uInt64),
+					"ChannelStatistics is published as 64-bit words");
+
+				ChannelStatistics ToStatistics(const ChannelMoments& m, float64 offset,
+					float64 gain) {
+
+					ChannelStatistics s;
+					s.count = m.count;
+
+					if (m.count == 0) {
+						const float64 nan = std::numeric_limits<float64>::quiet_NaN();
+						s.sum = 0.0;
+						s.min = s.max = s.mean = s.rms = s.variance = nan;
+						return s;
+					}
+
+					const float64 n = (float64)m.count;
+					const float64 sum = m.sum + m.compensation;
+					const float64 mean = sum / n;
+
+					s.sum = offset * n + gain * sum;
+					s.mean = offset + gain * mean;
+					s.variance = gain * gain * (m.m2 / n);
+					s.rms = std::sqrt(s.variance + s.mean * s.mean);
+					s.min = offset + gain * ((gain < 0.0) ? m.max : m.min);
+					s.max = offset + gain * ((gain < 0.0) ? m.min : m.max);
+					return s;
+				}
+			}
+
+			struct BlockStatisticsCore::Impl {
+
+				uInt32 channels;
+
+				// Writer side.
+				std::vector<ChannelMoments> total;
+				std::vector<ChannelMoments> block;
+				std::vector<float64> offsets;
+				std::vector<float64> gains;
+				void* scratch;
+				uInt64 blocks;
+
+				// Published snapshot: per channel the last block then the total,
+				// each as `WordsPerStatistics` words, guarded by `sequence` (odd
+				// while the writer is updating).
+				std::unique_ptr<std::atomic<uInt64>[]> published;
+				std::atomic<uInt64> publishedBlocks;
+				std::atomic<uInt64> sequence;
+
+				Impl() : channels(0), scratch(nullptr), blocks(0),
+					publishedBlocks(0), sequence(0) {}
+
+				~Impl() {
+					AlignedFree(scratch);
+				}
+
+				void AddRun(uInt32 channel, const void* run, SampleFormat format, size_t count) {
+
+					const ChannelMoments m = (format == SampleFormat::Float64)
+						? ComputeMomentsF64(static_cast<const float64*>(run), count)
+						: ComputeMomentsI16(static_cast<const int16*>(run), count);
+
+					MergeMoments(block[channel], m);
+				}
+
+				void Publish() {
+
+					const uInt64 s = sequence.load(std::memory_order_relaxed);
+					sequence.store(s + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_release);
+
+					uInt64 words[2 * WordsPerStatistics];
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+
+						const ChannelStatistics last = ToStatistics(block[ch], offsets[ch], gains[ch]);
+						const ChannelStatistics all = ToStatistics(total[ch], offsets[ch], gains[ch]);
+						std::memcpy(words, &last, sizeof(last));
+						std::memcpy(words + WordsPerStatistics, &all, sizeof(all));
+
+						std::atomic<uInt64>* target = &published[(size_t)ch * 2 * WordsPerStatistics];
+						for (size_t w = 0; w < 2 * WordsPerStatistics; w++) {
+							target[w].store(words[w], std::memory_order_relaxed);
+						}
+					}
+
+					publishedBlocks.store(blocks, std::memory_order_relaxed);
+					sequence.store(s + 2, std::memory_order_release);
+				}
+			};
+
+			BlockStatisticsCore::BlockStatisticsCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			BlockStatisticsCore::~BlockStatisticsCore() {
+
+				if (_impl != nullptr) {
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 BlockStatisticsCore::Configure(uInt32 channels) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (channels == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				impl.channels = 0;
+
+				AlignedFree(impl.scratch);
+				impl.scratch = AlignedAlloc((size_t)channels * PassSamples * sizeof(float64));
+
+				if (impl.scratch == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				try {
+					impl.total.assign(channels, EmptyMoments());
+					impl.block.assign(channels, EmptyMoments());
+					impl.offsets.assign(channels, 0.0);
+					impl.gains.assign(channels, 1.0);
+					impl.published.reset(
+						new std::atomic<uInt64>[(size_t)channels * 2 * WordsPerStatistics]);
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.channels = channels;
+				Reset();
+				return NativeSuccess;
+			}
+
+			int32 BlockStatisticsCore::SetScaling(const RawScalingCore* scaling) {
+
+				if (_impl == nullptr || _impl->channels == 0) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+
+				if (scaling == nullptr) {
+					impl.offsets.assign(impl.channels, 0.0);
+					impl.gains.assign(impl.channels, 1.0);
+				}
+				else {
+
+					if (scaling->Channels() != impl.channels) {
+						return NativeErrorInvalidArgument;
+					}
+
+					for (uInt32 ch = 0; ch < impl.channels; ch++) {
+
+						float64 coeffs[MaxScalingCoeffs] = { 0.0, 1.0 };
+						scaling->GetChannelCoefficients(ch, coeffs, MaxScalingCoeffs);
+						impl.offsets[ch] = coeffs[0];
+						impl.gains[ch] = coeffs[1];
+					}
+				}
+
+				impl.Publish();
+				return NativeSuccess;
+			}
+
+			void BlockStatisticsCore::Reset() {
+
+				if (_impl == nullptr || _impl->channels == 0) {
+					return;
+				}
+
+				_impl->total.assign(_impl->channels, EmptyMoments());
+				_impl->block.assign(_impl->channels, EmptyMoments());
+				_impl->blocks = 0;
+				_impl->Publish();
+			}
+
+			uInt32 BlockStatisticsCore::Channels() const {
+				return (_impl != nullptr) ? _impl->channels : 0;
+			}
+
+			int32 BlockStatisticsCore::Accumulate(const void* data, SampleFormat format,
+				uInt32 samplesPerChannel, int32 fillMode) {
+
+				if (_impl == nullptr || _impl->channels == 0) {
+					return NativeErrorInvalidState;
+				}
+				if (format != SampleFormat::Float64 && format != SampleFormat::Int16) {
+					return NativeErrorUnsupportedFormat;
+				}
+				if ((data == nullptr && samplesPerChannel > 0)
+					|| (fillMode != DAQmx_Val_GroupByChannel
+						&& fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				const uInt32 channels = impl.channels;
+				const size_t size = SampleSize(format);
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					impl.block[ch] = EmptyMoments();
+				}
+
+				if (fillMode == DAQmx_Val_GroupByChannel || channels == 1) {
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						impl.AddRun(ch, bytes + (size_t)ch * samplesPerChannel * size,
+							format, samplesPerChannel);
+					}
+				}
+				else {
+
+					for (uInt32 first = 0; first < samplesPerChannel; first += PassSamples) {
+
+						const uInt32 n = (samplesPerChannel - first < PassSamples)
+							? samplesPerChannel - first : PassSamples;
+
+						TransposeStrided(bytes + (size_t)first * channels * size, channels,
+							impl.scratch, n, n, channels, size);
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							impl.AddRun(ch, static_cast<uint8_t*>(impl.scratch)
+								+ (size_t)ch * n * size, format, n);
+						}
+					}
+				}
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					MergeMoments(impl.total[ch], impl.block[ch]);
+				}
+
+				impl.blocks++;
+				impl.Publish();
+				return NativeSuccess;
+			}
+
+			int32 BlockStatisticsCore::GetStatistics(ChannelStatistics* lastBlock,
+				ChannelStatistics* total, uInt32 capacity, uInt64& blocks) const {
+
+				if (_impl == nullptr || _impl->channels == 0) {
+					return NativeErrorInvalidState;
+				}
+
+				const Impl& impl = *_impl;
+				const uInt32 count = (capacity < impl.channels) ? capacity : impl.channels;
+				uInt64 words[2 * WordsPerStatistics];
+
+				for (;;) {
+
+					const uInt64 before = impl.sequence.load(std::memory_order_acquire);
+
+					if ((before & 1) != 0) {
+						std::this_thread::yield();
+						continue;
+					}
+
+					for (uInt32 ch = 0; ch < count; ch++) {
+
+						const std::atomic<uInt64>* source =
+							&impl.published[(size_t)ch * 2 * WordsPerStatistics];
+
+						for (size_t w = 0; w < 2 * WordsPerStatistics; w++) {
+							words[w] = source[w].load(std::memory_order_relaxed);
+						}
+						if (lastBlock != nullptr) {
+							std::memcpy(&lastBlock[ch], words, sizeof(ChannelStatistics));
+						}
+						if (total != nullptr) {
+							std::memcpy(&total[ch], words + WordsPerStatistics, sizeof(ChannelStatistics));
+						}
+					}
+
+					blocks = impl.publishedBlocks.load(std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_acquire);
+
+					if (impl.sequence.load(std::memory_order_relaxed) == before) {
+						return (int32)count;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the per-block statistics stage. Safe to include from code
+* compiled with /clr; the accumulators and the published snapshot live in
+* BlockStatisticsCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			class RawScalingCore;
+
+			/**
+			* @brief Statistics of one channel. Mean, RMS, variance, minimum and
+			*        maximum are NaN when `count` is 0.
+			*/
+			struct ChannelStatistics {
+				uInt64 count;
+				float64 sum;
+				float64 min;
+				float64 max;
+				float64 mean;
+				float64 rms;
+				/** Population variance: squared deviations divided by `count`. */
+				float64 variance;
+			};
+
+			/**
+			* @brief Count, compensated sum, minimum, maximum, mean, RMS and
+			*        variance of every channel, per block and since the last reset.
+			*
+			* `Accumulate` runs the kernels of StatisticsKernels.h over a block
+			* where it lies; blocks grouped by scan are deinterleaved through a
+			* small fixed scratch buffer, so nothing is allocated or copied in
+			* full. It is meant to run on the thread that reads the task, e.g.
+			* inside the callback of `AcquisitionEngineCore` (see
+			* `AcquisitionEngineCore::SetStatistics`).
+			*
+			* After each block the results are published to a snapshot that any
+			* thread can read with `GetStatistics` without locks: the reader
+			* retries if a block was published while it was copying (sequence
+			* lock), so the block and running statistics it gets always belong
+			* together.
+			*
+			* `Accumulate`, `SetScaling` and `Reset` must be called from one
+			* thread at a time; `Configure` must not run concurrently with any
+			* other method.
+			*/
+			class BlockStatisticsCore {
+
+			public:
+				BlockStatisticsCore();
+				~BlockStatisticsCore();
+
+				BlockStatisticsCore(const BlockStatisticsCore&) = delete;
+				BlockStatisticsCore& operator=(const BlockStatisticsCore&) = delete;
+
+				/**
+				* @brief Allocates the accumulators for `channels` channels and
+				*        clears them.
+				*/
+				int32 Configure(uInt32 channels);
+
+				/**
+				* @brief Reports the statistics of raw I16 blocks in engineering
+				*        units, with the offset and gain (first two coefficients)
+				*        of each channel's polynomial. Higher-order terms are
+				*        ignored. The coefficients are copied; `nullptr` reports
+				*        the values as they are.
+				*/
+				int32 SetScaling(const RawScalingCore* scaling);
+
+				/**
+				* @brief Clears the running statistics and publishes empty ones.
+				*/
+				void Reset();
+
+				uInt32 Channels() const;
+
+				/**
+				* @brief Adds one block and publishes its statistics.
+				*
+				* @param[in] data `Channels() * samplesPerChannel` samples.
+				* @param[in] format `Float64` or `Int16`.
+				* @param[in] samplesPerChannel Samples per channel in the block.
+				* @param[in] fillMode Layout of `data`.
+				*/
+				int32 Accumulate(const void* data, SampleFormat format,
+					uInt32 samplesPerChannel, int32 fillMode);
+
+				/**
+				* @brief Copies the published statistics. Safe from any thread.
+				*
+				* @param[out] lastBlock Statistics of the last block, per channel,
+				*             or `nullptr`.
+				* @param[out] total Statistics since the last reset, or `nullptr`.
+				* @param[in] capacity Entries in each array; at most `Channels()`
+				*            are written.
+				* @param[out] blocks Blocks accumulated since the last reset.
+				*
+				* @return The number of channels written, or a negative status.
+				*/
+				int32 GetStatistics(ChannelStatistics* lastBlock, ChannelStatistics* total,
+					uInt32 capacity, uInt64& blocks) const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,200 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BufferPoolCore.h"
+
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			struct BufferPoolCore::Impl {
+
+				size_t bufferBytes;
+				size_t alignment;
+				uInt32 maxBuffers;
+
+				// All sized to maxBuffers in Create, so Rent and Return never
+				// allocate bookkeeping memory.
+				std::vector<void*> freeList;
+				std::unordered_map<void*, bool> rented;
+
+				uInt64 rents;
+				uInt64 misses;
+
+				mutable std::mutex lock;
+
+				Impl() : bufferBytes(0), alignment(CacheLineSize), maxBuffers(0),
+					rents(0), misses(0) {}
+
+				~Impl() {
+					Release();
+				}
+
+				bool AnyRented() const {
+
+					for (const auto& entry : rented) {
+						if (entry.second) {
+							return true;
+						}
+					}
+					return false;
+				}
+
+				bool Grow() {
+
+					void* buffer = AlignedAlloc(bufferBytes, alignment);
+
+					if (buffer == nullptr) {
+						return false;
+					}
+
+					rented.emplace(buffer, false);
+					freeList.push_back(buffer);
+					return true;
+				}
+
+				void Release() {
+
+					for (auto& entry : rented) {
+						AlignedFree(entry.first);
+					}
+
+					rented.clear();
+					freeList.clear();
+				}
+			};
+
+
+			BufferPoolCore::BufferPoolCore() : _impl(new Impl()) {}
+
+			BufferPoolCore::~BufferPoolCore() {
+				delete _impl;
+			}
+
+			int32 BufferPoolCore::Create(size_t bufferBytes, uInt32 initialBuffers,
+				uInt32 maxBuffers, size_t alignment) {
+
+				if (bufferBytes == 0 || maxBuffers == 0 || initialBuffers > maxBuffers
+					|| alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::lock_guard<std::mutex> guard(_impl->lock);
+
+				// Freeing a buffer a caller still holds would leave it dangling.
+				if (_impl->AnyRented()) {
+					return NativeErrorInvalidState;
+				}
+
+				_impl->Release();
+				_impl->bufferBytes = bufferBytes;
+				_impl->alignment = alignment;
+				_impl->maxBuffers = maxBuffers;
+				_impl->rents = 0;
+				_impl->misses = 0;
+
+				try {
+					_impl->freeList.reserve(maxBuffers);
+					_impl->rented.reserve(maxBuffers);
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				for (uInt32 i = 0; i < initialBuffers; i++) {
+					if (!_impl->Grow()) {
+						_impl->Release();
+						return NativeErrorOutOfMemory;
+					}
+				}
+
+				return NativeSuccess;
+			}
+
+			void BufferPoolCore::Destroy() {
+
+				std::lock_guard<std::mutex> guard(_impl->lock);
+				_impl->Release();
+				_impl->maxBuffers = 0;
+			}
+
+			void* BufferPoolCore::Rent() {
+
+				std::lock_guard<std::mutex> guard(_impl->lock);
+
+				if (_impl->freeList.empty()
+					&& (_impl->rented.size() >= _impl->maxBuffers || !_impl->Grow())) {
+					_impl->misses++;
+					return nullptr;
+				}
+
+				void* buffer = _impl->freeList.back();
+				_impl->freeList.pop_back();
+				_impl->rented[buffer] = true;
+				_impl->rents++;
+				return buffer;
+			}
+
+			int32 BufferPoolCore::Return(void* buffer) {
+
+				std::lock_guard<std::mutex> guard(_impl->lock);
+
+				auto entry = _impl->rented.find(buffer);
+
+				if (entry == _impl->rented.end() || !entry->second) {
+					return NativeErrorInvalidArgument;
+				}
+
+				entry->second = false;
+				_impl->freeList.push_back(buffer);
+				return NativeSuccess;
+			}
+
+			size_t BufferPoolCore::BufferBytes() const {
+				return _impl->bufferBytes;
+			}
+
+			size_t BufferPoolCore::Alignment() const {
+				return _impl->alignment;
+			}
+
+			BufferPoolCounters BufferPoolCore::Counters() const {
+
+				std::lock_guard<std::mutex> guard(_impl->lock);
+
+				BufferPoolCounters counters;
+				counters.allocated = (uInt32)_impl->rented.size();
+				counters.available = (uInt32)_impl->freeList.size();
+				counters.rents = _impl->rents;
+				counters.misses = _impl->misses;
+				return counters;
+			}
+		}
+	}
+}
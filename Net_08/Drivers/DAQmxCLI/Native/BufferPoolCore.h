@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the native buffer pool. Safe to include from code compiled
+* with /clr; the free list and its lock live in BufferPoolCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "AlignedMemory.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Counters maintained by a `BufferPoolCore`.
+			*/
+			struct BufferPoolCounters {
+
+				/** Buffers currently allocated by the pool (rented or free). */
+				uInt32 allocated;
+
+				/** Buffers currently available for `Rent`. */
+				uInt32 available;
+
+				/** Successful `Rent` calls since the pool was created. */
+				uInt64 rents;
+
+				/** `Rent` calls that failed because `maxBuffers` was reached. */
+				uInt64 misses;
+			};
+
+			/**
+			* @brief Pool of fixed-size, aligned native buffers.
+			*
+			* The buffers live outside of the managed heap, so the DAQmx read
+			* functions can fill them without a `pin_ptr` and without creating
+			* garbage. A polling loop rents a buffer once (or once per read),
+			* reads straight into it and returns it; after warm-up no memory is
+			* allocated.
+			*
+			* The pool starts with `initialBuffers` buffers and grows one buffer
+			* at a time up to `maxBuffers`. `Rent` and `Return` may be called
+			* from any thread.
+			*/
+			class BufferPoolCore {
+
+			public:
+				BufferPoolCore();
+				~BufferPoolCore();
+
+				BufferPoolCore(const BufferPoolCore&) = delete;
+				BufferPoolCore& operator=(const BufferPoolCore&) = delete;
+
+				/**
+				* @brief Allocates the initial buffers, releasing those of an
+				*        earlier `Create`.
+				*
+				* @param[in] bufferBytes Size of each buffer, in bytes.
+				* @param[in] initialBuffers Number of buffers allocated up front.
+				* @param[in] maxBuffers Upper limit of the pool size; at least `initialBuffers`.
+				* @param[in] alignment Alignment of every buffer, a power of two and at
+				*                      least `sizeof(void*)`. Defaults to a cache line.
+				*
+				* @return
+				* - `0` on success.
+				* - `NativeErrorInvalidArgument` if a size or the alignment is not valid.
+				* - `NativeErrorInvalidState` if a buffer of the pool is still rented.
+				* - `NativeErrorOutOfMemory` if the initial buffers could not be allocated.
+				*/
+				int32 Create(size_t bufferBytes, uInt32 initialBuffers,
+					uInt32 maxBuffers, size_t alignment = CacheLineSize);
+
+				/**
+				* @brief Releases every buffer allocated by the pool.
+				*
+				* @note Buffers that are still rented are released as well; the
+				*       caller must not use them afterwards.
+				*/
+				void Destroy();
+
+				/**
+				* @brief Takes a buffer from the pool.
+				*
+				* @return A buffer of `BufferBytes()` bytes, or `nullptr` if the pool
+				*         is at `maxBuffers` and all of them are rented.
+				*/
+				void* Rent();
+
+				/**
+				* @brief Returns a buffer obtained from `Rent`.
+				*
+				* @return `0` on success, `NativeErrorInvalidArgument` if the buffer
+				*         does not belong to the pool or is already returned.
+				*/
+				int32 Return(void* buffer);
+
+				/**
+				* @brief Size of each buffer, in bytes.
+				*/
+				size_t BufferBytes() const;
+
+				/**
+				* @brief Alignment of each buffer, in bytes.
+				*/
+				size_t Alignment() const;
+
+				/**
+				* @brief Snapshot of the pool counters.
+				*/
+				BufferPoolCounters Counters() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,926 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CallbackDispatcherCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "CallbackRegistry.h"
+#include "HostClock.h"
+#include "MpscQueue.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Longest an idle dispatch thread sleeps before it looks
+				// again; the wake-ups make it rarely matter.
+				const auto DispatcherIdleWait = std::chrono::milliseconds(10);
+
+				// Status of a dispatch thread that has not applied its
+				// schedule yet.
+				const int32 ThreadStarting = 1;
+
+				void UpdateMax(std::atomic<uInt64>& target, uInt64 value) {
+
+					uInt64 current = target.load(std::memory_order_relaxed);
+
+					while (value > current
+						&& !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+					}
+				}
+			}
+
+			struct CallbackDispatcherCore::Impl {
+
+				struct alignas(CacheLineSize) DispatchThread {
+
+					MpscQueue<CallbackEvent> queue;
+					std::vector<CallbackEvent> taken;
+					std::vector<CallbackEvent> batch;
+					std::thread thread;
+
+					// Wake-up. Producers only take the mutex when the thread
+					// announced that it is idle.
+					std::atomic<bool> idle;
+					std::mutex mutex;
+					std::condition_variable wakeup;
+
+					CallbackThreadConfig config;
+					// `ThreadStarting`, then the status of its schedule.
+					std::atomic<int32> status;
+
+					DispatchThread() : idle(false), status(ThreadStarting) {}
+				};
+
+				// A task routed to a dispatch thread. Entries are taken by
+				// open addressing on the task handle and keep their task
+				// until the next `Start`, so the driver threads look them up
+				// without a lock.
+				struct Route {
+					std::atomic<TaskHandle> task;
+					// The thread plus one; `0` once unrouted.
+					std::atomic<uInt32> thread;
+				};
+
+				// Signal events of one registration, the context of its key.
+				struct alignas(CacheLineSize) SignalRing {
+
+					MpscQueue<int64> times;
+					int32 signalId;
+
+					// An event for the ring is queued and not yet taken.
+					std::atomic<bool> pending;
+
+					SignalRing() : signalId(0), pending(false) {}
+				};
+
+				CallbackDispatcherConfig config;
+				CallbackBatchFunction batchFunction;
+				void* context;
+
+				std::vector<std::unique_ptr<DispatchThread>> threads;
+				std::atomic<bool> running;
+				std::atomic<bool> stopping;
+
+				// Keys held and signal rings; changed under `keyMutex`.
+				// Released rings wait in `retiredRings` for a `Quiesce`.
+				std::mutex keyMutex;
+				std::atomic<uInt64> registrations;
+				std::vector<SignalRing*> signalRings;
+				std::vector<SignalRing*> retiredRings;
+
+				// Rings ever retired, and ever freed; `retiredRings` holds
+				// the ones in between, oldest first.
+				uInt64 ringsRetired;
+				uInt64 ringsReclaimed;
+
+				// Taken under `keyMutex`.
+				Route routes[CallbackMaxRoutes];
+				std::atomic<uInt32> routeCount;
+
+				// Written by the driver threads.
+				alignas(CacheLineSize) std::atomic<uInt64> received;
+				std::atomic<uInt64> dropped;
+				std::atomic<uInt64> discarded;
+				std::atomic<uInt64> signals;
+				std::atomic<uInt64> coalesced;
+
+				// Written by the dispatch threads.
+				alignas(CacheLineSize) std::atomic<uInt64> delivered;
+				std::atomic<uInt64> batches;
+				std::atomic<uInt64> maxBatch;
+
+				Impl() :
+					config(DefaultCallbackDispatcherConfig()),
+					batchFunction(nullptr), context(nullptr),
+					running(false), stopping(false), registrations(0),
+					ringsRetired(0), ringsReclaimed(0), routeCount(0),
+					received(0), dropped(0), discarded(0), signals(0), coalesced(0),
+					delivered(0), batches(0), maxBatch(0) {
+
+					ClearRoutes();
+				}
+
+				~Impl() {
+
+					// No trampoline still in flight may reach the freed
+					// queues through a key it looked up before.
+					CallbackRegistry::Instance().ReleaseAll(this);
+					CallbackRegistry::Instance().Synchronize();
+
+					for (SignalRing* ring : signalRings) {
+						delete ring;
+					}
+					for (SignalRing* ring : retiredRings) {
+						delete ring;
+					}
+				}
+
+				static Impl* OwnerOf(CallbackKey key) {
+					return static_cast<Impl*>(CallbackRegistry::Instance().Owner(key));
+				}
+
+				uInt32 ThreadOf(TaskHandle task) const {
+
+					if (routeCount.load(std::memory_order_acquire) != 0) {
+
+						const Route* route = FindRoute(task, false);
+						const uInt32 thread = (route != nullptr)
+							? route->thread.load(std::memory_order_acquire) : 0;
+
+						if (thread != 0) {
+							return thread - 1;
+						}
+					}
+					return (uInt32)(std::hash<TaskHandle>()(task) % config.threads);
+				}
+
+				// The entry of `task`, or with `take` the first free one on
+				// its way, which the caller then fills under `keyMutex`.
+				Route* FindRoute(TaskHandle task, bool take) const {
+
+					uInt32 index = (uInt32)(std::hash<TaskHandle>()(task) & (CallbackMaxRoutes - 1));
+
+					for (uInt32 probe = 0; probe < CallbackMaxRoutes; probe++) {
+
+						Route& route = const_cast<Route&>(routes[index]);
+						const TaskHandle held = route.task.load(std::memory_order_acquire);
+
+						if (held == task) {
+							return &route;
+						}
+						if (held == nullptr) {
+							return take ? &route : nullptr;
+						}
+						index = (index + 1) & (CallbackMaxRoutes - 1);
+					}
+					return nullptr;
+				}
+
+				void ClearRoutes() {
+
+					for (uInt32 k = 0; k < CallbackMaxRoutes; k++) {
+						routes[k].task.store(nullptr, std::memory_order_relaxed);
+						routes[k].thread.store(0, std::memory_order_relaxed);
+					}
+					routeCount.store(0, std::memory_order_release);
+				}
+
+				static int32 CVICALLBACK OnDone(TaskHandle taskHandle, int32 status,
+					void* callbackData) {
+
+					// A key released while the driver still calls it has no
+					// owner any more; the section keeps the owner alive
+					// until the event is queued.
+					const int64 timeNs = HostMonotonicNs();
+					CallbackEpochGuard guard;
+					const CallbackKey key = reinterpret_cast<CallbackKey>(callbackData);
+					Impl* impl = OwnerOf(key);
+
+					if (impl == nullptr) {
+						return 0;
+					}
+
+					CallbackEvent event;
+					event.key = key;
+					event.task = taskHandle;
+					event.kind = CallbackEventKind::Done;
+					event.status = status;
+					event.eventType = 0;
+					event.nSamples = 0;
+					event.timeNs = timeNs;
+					event.queuedNs = 0;
+					event.dispatchNs = 0;
+
+					impl->Enqueue(event);
+					return 0;
+				}
+
+				static int32 CVICALLBACK OnEveryNSamples(TaskHandle taskHandle,
+					int32 everyNsamplesEventType, uInt32 nSamples,
+					void* callbackData) {
+
+					const int64 timeNs = HostMonotonicNs();
+					CallbackEpochGuard guard;
+					const CallbackKey key = reinterpret_cast<CallbackKey>(callbackData);
+					Impl* impl = OwnerOf(key);
+
+					if (impl == nullptr) {
+						return 0;
+					}
+
+					CallbackEvent event;
+					event.key = key;
+					event.task = taskHandle;
+					event.kind = CallbackEventKind::EveryNSamples;
+					event.status = 0;
+					event.eventType = everyNsamplesEventType;
+					event.nSamples = nSamples;
+					event.timeNs = timeNs;
+					event.queuedNs = 0;
+					event.dispatchNs = 0;
+
+					impl->Enqueue(event);
+					return 0;
+				}
+
+				static int32 CVICALLBACK OnSignal(TaskHandle taskHandle, int32 signalID,
+					void* callbackData) {
+
+					const int64 timeNs = HostMonotonicNs();
+					CallbackEpochGuard guard;
+					const CallbackKey key = reinterpret_cast<CallbackKey>(callbackData);
+
+					void* owner = nullptr;
+					void* ringContext = nullptr;
+
+					if (!CallbackRegistry::Instance().Resolve(key, owner, ringContext)
+						|| ringContext == nullptr) {
+						return 0;
+					}
+
+					Impl* impl = static_cast<Impl*>(owner);
+					SignalRing* ring = static_cast<SignalRing*>(ringContext);
+
+					impl->received.fetch_add(1, std::memory_order_relaxed);
+					impl->signals.fetch_add(1, std::memory_order_relaxed);
+
+					if (!impl->running.load(std::memory_order_acquire)) {
+						impl->discarded.fetch_add(1, std::memory_order_relaxed);
+						return 0;
+					}
+
+					if (!ring->times.TryPush(timeNs)) {
+						impl->dropped.fetch_add(1, std::memory_order_relaxed);
+						return 0;
+					}
+
+					// The event queued for an earlier signal delivers this one
+					// too.
+					if (ring->pending.exchange(true, std::memory_order_acq_rel)) {
+						impl->coalesced.fetch_add(1, std::memory_order_relaxed);
+						return 0;
+					}
+
+					CallbackEvent event;
+					event.key = key;
+					event.task = taskHandle;
+					event.kind = CallbackEventKind::Signal;
+					event.status = 0;
+					event.eventType = signalID;
+					event.nSamples = 0;
+					event.timeNs = timeNs;
+					event.queuedNs = 0;
+					event.dispatchNs = 0;
+
+					// The queue is full: the next signal tries again.
+					if (!impl->Queue(event)) {
+						ring->pending.store(false, std::memory_order_release);
+					}
+					return 0;
+				}
+
+				// Driver side: never blocks.
+				int32 Enqueue(const CallbackEvent& event) {
+
+					received.fetch_add(1, std::memory_order_relaxed);
+
+					if (!running.load(std::memory_order_acquire)) {
+						discarded.fetch_add(1, std::memory_order_relaxed);
+						return NativeErrorInvalidState;
+					}
+
+					if (!Queue(event)) {
+						dropped.fetch_add(1, std::memory_order_relaxed);
+						return NativeErrorQueueFull;
+					}
+					return NativeSuccess;
+				}
+
+				bool Queue(CallbackEvent event) {
+
+					DispatchThread& thread = *threads[ThreadOf(event.task)];
+
+					event.queuedNs = config.stampLatency ? HostMonotonicNs() : 0;
+					event.dispatchNs = 0;
+
+					if (!thread.queue.TryPush(event)) {
+						return false;
+					}
+
+					Wake(thread);
+					return true;
+				}
+
+				void Wake(DispatchThread& thread) {
+
+					// Orders the push before the idle check; pairs with the
+					// store in Idle.
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if (thread.idle.load(std::memory_order_relaxed)) {
+						std::lock_guard<std::mutex> lock(thread.mutex);
+						thread.wakeup.notify_one();
+					}
+				}
+
+				void Idle(DispatchThread& thread) {
+
+					std::unique_lock<std::mutex> lock(thread.mutex);
+					thread.idle.store(true, std::memory_order_seq_cst);
+
+					if (thread.queue.Count() == 0 && !stopping.load(std::memory_order_acquire)) {
+						thread.wakeup.wait_for(lock, DispatcherIdleWait);
+					}
+					thread.idle.store(false, std::memory_order_relaxed);
+				}
+
+				void Deliver(DispatchThread& thread, size_t taken) {
+
+					// Whoever releases a key and synchronizes waits for the
+					// batch function to return before freeing its consumer.
+					CallbackEpochGuard guard;
+					uInt32 count = 0;
+
+					for (size_t i = 0; i < taken; i++) {
+
+						const CallbackEvent& event = thread.taken[i];
+
+						void* owner = nullptr;
+						void* ringContext = nullptr;
+
+						// Released while queued.
+						if (!CallbackRegistry::Instance().Resolve(event.key, owner, ringContext)
+							|| owner != this) {
+							discarded.fetch_add(1, std::memory_order_relaxed);
+							continue;
+						}
+
+						if (event.kind != CallbackEventKind::Signal) {
+							thread.batch[count++] = event;
+							Flush(thread, count, false);
+							continue;
+						}
+
+						if (ringContext == nullptr) {
+							continue;
+						}
+
+						// Cleared first: a signal pushed from here on queues
+						// a new event, so none is left behind in the ring.
+						SignalRing& ring = *static_cast<SignalRing*>(ringContext);
+						ring.pending.store(false, std::memory_order_seq_cst);
+
+						const size_t recorded = ring.times.Count();
+						int64 timeNs;
+
+						for (size_t k = 0; k < recorded && ring.times.TryPop(timeNs); k++) {
+							thread.batch[count] = event;
+							thread.batch[count].timeNs = timeNs;
+							thread.batch[count].queuedNs = config.stampLatency ? timeNs : 0;
+							count++;
+							Flush(thread, count, false);
+						}
+					}
+
+					Flush(thread, count, true);
+				}
+
+				// Hands the batch over when it is full, or when `force`d and
+				// not empty.
+				void Flush(DispatchThread& thread, uInt32& count, bool force) {
+
+					if (count == 0 || (!force && count < thread.batch.size())) {
+						return;
+					}
+
+					if (config.stampLatency) {
+
+						const int64 now = HostMonotonicNs();
+
+						for (uInt32 k = 0; k < count; k++) {
+							thread.batch[k].dispatchNs = now;
+						}
+					}
+
+					batchFunction(context, thread.batch.data(), count);
+
+					delivered.fetch_add(count, std::memory_order_relaxed);
+					batches.fetch_add(1, std::memory_order_relaxed);
+					UpdateMax(maxBatch, count);
+					count = 0;
+				}
+
+				void Run(DispatchThread* thread) {
+
+					// `Start` waits for the status; a thread the OS refused
+					// does not run.
+					const int32 status = ApplyThreadSchedule(thread->config.schedule);
+					thread->status.store(status, std::memory_order_release);
+
+					if (status != NativeSuccess) {
+						return;
+					}
+
+					for (;;) {
+
+						const size_t taken = thread->queue.TryPopMany(
+							thread->taken.data(), thread->taken.size());
+
+						if (taken > 0) {
+							Deliver(*thread, taken);
+							continue;
+						}
+
+						// Events queued before the stop are delivered first.
+						if (stopping.load(std::memory_order_acquire)
+							&& thread->queue.Count() == 0) {
+							break;
+						}
+
+						if (thread->config.busyPoll) {
+							std::this_thread::yield();
+						}
+						else {
+							Idle(*thread);
+						}
+					}
+				}
+			};
+
+
+			CallbackDispatcherCore::CallbackDispatcherCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			CallbackDispatcherCore::~CallbackDispatcherCore() {
+				Stop();
+				delete _impl;
+			}
+
+			int32 CallbackDispatcherCore::Start(const CallbackDispatcherConfig& config,
+				CallbackBatchFunction batch, void* context) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.running.load()) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (config.threads == 0 || config.threads > CallbackMaxDispatchThreads
+					|| config.dedicatedThreads > CallbackMaxDispatchThreads - config.threads
+					|| config.queueCapacity < 2
+					|| config.maxBatch == 0 || config.maxRegistrations == 0
+					|| config.signalCapacity < 2 || batch == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				try {
+					impl.threads.clear();
+
+					for (uInt32 t = 0; t < config.threads + config.dedicatedThreads; t++) {
+
+						std::unique_ptr<Impl::DispatchThread> thread(new Impl::DispatchThread());
+						thread->config = config.thread[t];
+
+						if (!thread->queue.Allocate(config.queueCapacity)) {
+							impl.threads.clear();
+							return NativeErrorOutOfMemory;
+						}
+						thread->taken.resize(config.maxBatch);
+						thread->batch.resize(config.maxBatch);
+						impl.threads.push_back(std::move(thread));
+					}
+				}
+				catch (const std::bad_alloc&) {
+					impl.threads.clear();
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.config = config;
+				impl.batchFunction = batch;
+				impl.context = context;
+				impl.stopping.store(false);
+				impl.ClearRoutes();
+				impl.running.store(true, std::memory_order_release);
+
+				for (auto& thread : impl.threads) {
+					try {
+						thread->thread = std::thread(&Impl::Run, &impl, thread.get());
+					}
+					catch (const std::system_error&) {
+						Stop();
+						return NativeErrorOutOfMemory;
+					}
+				}
+
+				int32 status = NativeSuccess;
+
+				for (auto& thread : impl.threads) {
+
+					int32 applied;
+					while ((applied = thread->status.load(std::memory_order_acquire)) == ThreadStarting) {
+						std::this_thread::yield();
+					}
+					if (applied != NativeSuccess && status == NativeSuccess) {
+						status = applied;
+					}
+				}
+
+				if (status != NativeSuccess) {
+					Stop();
+				}
+				return status;
+			}
+
+			int32 CallbackDispatcherCore::Stop() {
+
+				if (_impl == nullptr) {
+					return NativeSuccess;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.running.exchange(false)) {
+					return NativeSuccess;
+				}
+
+				impl.stopping.store(true, std::memory_order_release);
+
+				for (auto& thread : impl.threads) {
+					impl.Wake(*thread);
+				}
+				for (auto& thread : impl.threads) {
+					if (thread->thread.joinable()) {
+						thread->thread.join();
+					}
+				}
+				return NativeSuccess;
+			}
+
+			bool CallbackDispatcherCore::IsRunning() const {
+				return _impl != nullptr && _impl->running.load();
+			}
+
+			int32 CallbackDispatcherCore::RouteTask(TaskHandle task, uInt32 thread) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.running.load()) {
+					return NativeErrorInvalidState;
+				}
+				if (task == NULL || thread >= impl.threads.size()) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::lock_guard<std::mutex> lock(impl.keyMutex);
+
+				Impl::Route* route = impl.FindRoute(task, true);
+
+				if (route == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				// The thread before the task: a driver thread that finds
+				// the task finds its thread too.
+				route->thread.store(thread + 1, std::memory_order_release);
+
+				if (route->task.load(std::memory_order_relaxed) != task) {
+					route->task.store(task, std::memory_order_release);
+					impl.routeCount.fetch_add(1, std::memory_order_release);
+				}
+				return NativeSuccess;
+			}
+
+			int32 CallbackDispatcherCore::UnrouteTask(TaskHandle task) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.keyMutex);
+
+				Impl::Route* route = impl.FindRoute(task, false);
+
+				if (route != nullptr) {
+					route->thread.store(0, std::memory_order_release);
+				}
+				return NativeSuccess;
+			}
+
+			uInt32 CallbackDispatcherCore::ThreadOfTask(TaskHandle task) const {
+				return (_impl != nullptr) ? _impl->ThreadOf(task) : 0;
+			}
+
+			int32 CallbackDispatcherCore::Allocate(CallbackKey* key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (key == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.keyMutex);
+
+				if (impl.registrations.load(std::memory_order_relaxed) >= impl.config.maxRegistrations
+					|| !CallbackRegistry::Instance().Allocate(&impl, *key)) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.registrations.fetch_add(1, std::memory_order_relaxed);
+				return NativeSuccess;
+			}
+
+			int32 CallbackDispatcherCore::Release(CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.keyMutex);
+
+				void* owner = nullptr;
+				void* ringContext = nullptr;
+				CallbackRegistry::Instance().Resolve(key, owner, ringContext);
+
+				if (!CallbackRegistry::Instance().Release(key, &impl)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				// A trampoline may still push into the ring until the next
+				// `Quiesce`. `retiredRings` has room for every ring.
+				if (ringContext != nullptr) {
+
+					Impl::SignalRing* ring = static_cast<Impl::SignalRing*>(ringContext);
+					auto live = std::find(impl.signalRings.begin(), impl.signalRings.end(), ring);
+
+					if (live != impl.signalRings.end()) {
+						impl.signalRings.erase(live);
+						impl.retiredRings.push_back(ring);
+						impl.ringsRetired++;
+					}
+				}
+
+				impl.registrations.fetch_sub(1, std::memory_order_relaxed);
+				return NativeSuccess;
+			}
+
+			int32 CallbackDispatcherCore::RegisterDoneEvent(TaskHandle task, CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (!_impl->running.load()) {
+					return NativeErrorInvalidState;
+				}
+				if (Impl::OwnerOf(key) != _impl) {
+					return NativeErrorInvalidArgument;
+				}
+
+				return DAQmxRegisterDoneEvent(task, 0, &Impl::OnDone,
+					reinterpret_cast<void*>(key));
+			}
+
+			int32 CallbackDispatcherCore::RegisterEveryNSamplesEvent(TaskHandle task,
+				int32 eventType, uInt32 nSamples, CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (!_impl->running.load()) {
+					return NativeErrorInvalidState;
+				}
+				if (Impl::OwnerOf(key) != _impl) {
+					return NativeErrorInvalidArgument;
+				}
+
+				return DAQmxRegisterEveryNSamplesEvent(task, eventType, nSamples, 0,
+					&Impl::OnEveryNSamples, reinterpret_cast<void*>(key));
+			}
+
+			int32 CallbackDispatcherCore::RegisterSignalEvent(TaskHandle task, int32 signalId,
+				CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.running.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(impl.keyMutex);
+
+					void* owner = nullptr;
+					void* ringContext = nullptr;
+
+					if (!CallbackRegistry::Instance().Resolve(key, owner, ringContext)
+						|| owner != &impl || ringContext != nullptr) {
+						return NativeErrorInvalidArgument;
+					}
+
+					std::unique_ptr<Impl::SignalRing> ring(new (std::nothrow) Impl::SignalRing());
+
+					if (ring == nullptr || !ring->times.Allocate(impl.config.signalCapacity)) {
+						return NativeErrorOutOfMemory;
+					}
+					ring->signalId = signalId;
+
+					try {
+						impl.signalRings.reserve(impl.signalRings.size() + 1);
+						impl.retiredRings.reserve(impl.signalRings.size() + impl.retiredRings.size() + 1);
+					}
+					catch (const std::bad_alloc&) {
+						return NativeErrorOutOfMemory;
+					}
+
+					CallbackRegistry::Instance().SetContext(key, &impl, ring.get());
+					impl.signalRings.push_back(ring.release());
+				}
+
+				return DAQmxRegisterSignalEvent(task, signalId, 0, &Impl::OnSignal,
+					reinterpret_cast<void*>(key));
+			}
+
+			int32 CallbackDispatcherCore::UnregisterDoneEvent(TaskHandle task, CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (Impl::OwnerOf(key) != _impl) {
+					return NativeErrorInvalidArgument;
+				}
+
+				return DAQmxRegisterDoneEvent(task, 0, NULL, NULL);
+			}
+
+			int32 CallbackDispatcherCore::UnregisterEveryNSamplesEvent(TaskHandle task,
+				int32 eventType, CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (Impl::OwnerOf(key) != _impl) {
+					return NativeErrorInvalidArgument;
+				}
+
+				return DAQmxRegisterEveryNSamplesEvent(task, eventType, 0, 0, NULL, NULL);
+			}
+
+			int32 CallbackDispatcherCore::UnregisterSignalEvent(TaskHandle task, int32 signalId,
+				CallbackKey key) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (Impl::OwnerOf(key) != _impl) {
+					return NativeErrorInvalidArgument;
+				}
+
+				return DAQmxRegisterSignalEvent(task, signalId, 0, NULL, NULL);
+			}
+
+			bool CallbackDispatcherCore::Quiesce() {
+
+				if (_impl == nullptr) {
+					return CallbackRegistry::Instance().Synchronize();
+				}
+
+				Impl& impl = *_impl;
+				uInt64 horizon;
+
+				{
+					std::lock_guard<std::mutex> lock(impl.keyMutex);
+					horizon = impl.ringsRetired;
+				}
+
+				// Rings retired before the wait are out of reach after it.
+				if (!CallbackRegistry::Instance().Synchronize()) {
+					return false;
+				}
+
+				// Another `Quiesce` may have freed some of them meanwhile, and
+				// rings retired since are left for the next one. Nothing is
+				// copied; `retiredRings` keeps its capacity for `Release`.
+				std::lock_guard<std::mutex> lock(impl.keyMutex);
+
+				if (horizon <= impl.ringsReclaimed) {
+					return true;
+				}
+
+				const size_t count = (size_t)(horizon - impl.ringsReclaimed);
+
+				for (size_t k = 0; k < count; k++) {
+					delete impl.retiredRings[k];
+				}
+				impl.retiredRings.erase(impl.retiredRings.begin(), impl.retiredRings.begin() + count);
+				impl.ringsReclaimed = horizon;
+				return true;
+			}
+
+			int32 CallbackDispatcherCore::Post(const CallbackEvent& event) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				CallbackEpochGuard guard;
+
+				if (Impl::OwnerOf(event.key) != _impl) {
+					return NativeErrorInvalidState;
+				}
+				return _impl->Enqueue(event);
+			}
+
+			CallbackDispatcherCounters CallbackDispatcherCore::Counters() const {
+
+				CallbackDispatcherCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.received = _impl->received.load(std::memory_order_relaxed);
+					counters.delivered = _impl->delivered.load(std::memory_order_relaxed);
+					counters.batches = _impl->batches.load(std::memory_order_relaxed);
+					counters.maxBatch = _impl->maxBatch.load(std::memory_order_relaxed);
+					counters.dropped = _impl->dropped.load(std::memory_order_relaxed);
+					counters.discarded = _impl->discarded.load(std::memory_order_relaxed);
+					counters.registrations = _impl->registrations.load(std::memory_order_relaxed);
+					counters.signals = _impl->signals.load(std::memory_order_relaxed);
+					counters.coalesced = _impl->coalesced.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			const CallbackDispatcherConfig& CallbackDispatcherCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
@@ -0,0 +1,415 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the callback dispatcher. Safe to include from code compiled with
+* /clr; the trampolines, the event queues and the dispatch threads live in
+* CallbackDispatcherCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "ThreadScheduling.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Handle of a registration, passed to DAQmx as the
+			*        callbackData of the trampolines: the index of its slot in
+			*        the low `CallbackKeyIndexBits` bits and the generation of
+			*        the slot above them. A key never matches the registration
+			*        that reuses its slot after a release. `0` is never a key.
+			*/
+			typedef uintptr_t CallbackKey;
+
+			constexpr uInt32 CallbackKeyIndexBits = 16;
+
+			/** Registrations that may be live at once in the process. */
+			constexpr uInt32 CallbackMaxRegistrations = 1u << CallbackKeyIndexBits;
+
+			inline uInt32 CallbackKeyIndex(CallbackKey key) {
+				return (uInt32)(key & (CallbackMaxRegistrations - 1));
+			}
+
+			/**
+			* @brief DAQmx event recorded by a trampoline.
+			*/
+			enum class CallbackEventKind : int32 {
+				Done = 0,
+				EveryNSamples = 1,
+				/** A signal event of `DAQmxRegisterSignalEvent`. */
+				Signal = 2
+			};
+
+			/**
+			* @brief One driver event, as queued by a trampoline and delivered
+			*        to the batch function.
+			*/
+			struct CallbackEvent {
+				/** Key of the registration. */
+				CallbackKey key;
+				TaskHandle task;
+				CallbackEventKind kind;
+				/** Status of a Done event; `0` for other events. */
+				int32 status;
+				/** `DAQmx_Val_Acquired_Into_Buffer` or
+				*   `DAQmx_Val_Transferred_From_Buffer` for EveryNSamples
+				*   events, the signal ID (`DAQmx_Val_SampleClock`,
+				*   `DAQmx_Val_ChangeDetectionEvent`, ...) for Signal events. */
+				int32 eventType;
+				uInt32 nSamples;
+				/** `HostMonotonicNs` when the driver entered the trampoline. */
+				int64 timeNs;
+				/** `HostMonotonicNs` when the event was queued for its
+				*   dispatch thread; `0` without `stampLatency`. */
+				int64 queuedNs;
+				/** `HostMonotonicNs` when the dispatch thread handed the
+				*   batch over; `0` without `stampLatency`. */
+				int64 dispatchNs;
+			};
+
+			/**
+			* @brief Receives the events of one dispatch thread, in the order the
+			*        driver raised them for each task.
+			*
+			* Runs on a dispatch thread, never on a driver thread. `events` is
+			* only valid during the call.
+			*/
+			typedef void (*CallbackBatchFunction)(void* context,
+				const CallbackEvent* events, uInt32 count);
+
+			/** Dispatch threads of a dispatcher, shared and dedicated. */
+			constexpr uInt32 CallbackMaxDispatchThreads = 16;
+
+			/** Tasks that may be routed to a dispatch thread at once. */
+			constexpr uInt32 CallbackMaxRoutes = 256;
+
+			/**
+			* @brief Settings of one dispatch thread.
+			*/
+			struct CallbackThreadConfig {
+
+				/** Affinity and priority the thread sets for itself when it
+				*   starts. */
+				ThreadSchedule schedule;
+
+				/** Polls the queue without sleeping, yielding between looks:
+				*   an event is taken within microseconds of the driver
+				*   raising it, at the cost of a busy CPU. With a real-time
+				*   priority the thread starves the work of lower priority on
+				*   its CPUs, so pin it to a CPU of its own. */
+				bool busyPoll;
+			};
+
+			/**
+			* @brief Settings of a `CallbackDispatcherCore`.
+			*/
+			struct CallbackDispatcherConfig {
+
+				/** Shared dispatch threads, over which the tasks without a
+				*   route are spread. The events of a task always go to the
+				*   same thread, so they stay in order. */
+				uInt32 threads;
+
+				/** Dispatch threads after the shared ones that only take the
+				*   tasks routed to them; `threads + dedicatedThreads` may be
+				*   `CallbackMaxDispatchThreads` at most. */
+				uInt32 dedicatedThreads;
+
+				/** Each dispatch thread, the shared ones first. */
+				CallbackThreadConfig thread[CallbackMaxDispatchThreads];
+
+				/** Events each dispatch thread can hold; the driver drops
+				*   events past that instead of waiting. */
+				uInt32 queueCapacity;
+
+				/** Most events passed to one call of the batch function. */
+				uInt32 maxBatch;
+
+				/** Most keys the dispatcher may hold at once. */
+				uInt32 maxRegistrations;
+
+				/** Signal events each signal registration holds until its
+				*   dispatch thread takes them; the driver drops signals past
+				*   that instead of waiting. */
+				uInt32 signalCapacity;
+
+				/** Stamps `queuedNs` and `dispatchNs` into the events, for
+				*   `CallbackLatencyCore`: one more clock read per event and
+				*   one per batch. */
+				bool stampLatency;
+			};
+
+			inline CallbackDispatcherConfig DefaultCallbackDispatcherConfig() {
+
+				CallbackDispatcherConfig config;
+				config.threads = 2;
+				config.dedicatedThreads = 0;
+
+				for (uInt32 t = 0; t < CallbackMaxDispatchThreads; t++) {
+					config.thread[t].schedule = DefaultThreadSchedule();
+					config.thread[t].busyPoll = false;
+				}
+				config.queueCapacity = 4096;
+				config.maxBatch = 256;
+				config.maxRegistrations = 16384;
+				config.signalCapacity = 1024;
+				config.stampLatency = false;
+				return config;
+			}
+
+			/**
+			* @brief Counters of the dispatcher. Read without locking.
+			*/
+			struct CallbackDispatcherCounters {
+				/** Events raised by the driver or posted. */
+				uInt64 received;
+				uInt64 delivered;
+				/** Calls of the batch function. */
+				uInt64 batches;
+				/** Largest batch delivered. */
+				uInt64 maxBatch;
+				/** Events lost because a queue or a signal ring was full. */
+				uInt64 dropped;
+				/** Events queued for a key that was released before their
+				*   delivery, or raised while stopped. */
+				uInt64 discarded;
+				/** Keys held at the moment. */
+				uInt64 registrations;
+				/** Signal events recorded, of `received`. */
+				uInt64 signals;
+				/** Signal events that reached their dispatch thread behind
+				*   another of the same registration, i.e. without a queue
+				*   entry of their own. */
+				uInt64 coalesced;
+			};
+
+			/**
+			* @brief Receives DAQmx Done and EveryNSamples events in fixed native
+			*        trampolines and delivers them in batches from a small pool
+			*        of dispatch threads.
+			*
+			* The trampolines registered with DAQmx only copy the event into the
+			* lock-free queue of the dispatch thread of the task and wake that
+			* thread if it sleeps; the driver thread never enters managed code,
+			* takes a lock held by a consumer or waits for room. A dispatch
+			* thread takes whatever its queue holds, up to `maxBatch` events,
+			* and hands it to the batch function in one call, so a subscriber
+			* behind a managed transition pays for it once per batch, and a
+			* garbage collection only delays the dispatch threads.
+			*
+			* Each registration is a `CallbackKey` from the process-wide
+			* `CallbackRegistry`. `Allocate` and `Release` are O(1) and do not
+			* allocate once the registry has grown to its working size. A
+			* released key stops matching at once, so the events the driver
+			* still raises for it, or that are still queued, are discarded
+			* even after its slot was reused.
+			*
+			* Tasks spread over the shared dispatch threads by their handle.
+			* `RouteTask` gives a task a thread of its own instead, e.g. a
+			* dedicated thread pinned to an isolated CPU at a real-time
+			* priority, or polling its queue without sleeping, so its
+			* consumer is not pre-empted by the UI or by the consumers of
+			* other tasks.
+			*
+			* Signal events (`RegisterSignalEvent`) can come once per sample
+			* clock tick or digital edge, so they do not go through the queue
+			* one by one: the trampoline stamps the host time and pushes it
+			* into a ring of the registration, and only the first signal
+			* after the ring was drained queues an event. The dispatch thread
+			* then drains the ring and delivers every signal recorded so far,
+			* each with its time, in the same batch. Signals may thus be
+			* delivered ahead of other events of their task that were queued
+			* after the first of them.
+			*
+			* To replace or remove a consumer while its task runs: unregister
+			* the event from DAQmx if it is no longer wanted, release the key,
+			* then `Quiesce`. The driver may still be inside a trampoline, and
+			* a dispatch thread inside the batch function, after the first
+			* two steps; `Quiesce` returns once both have left, and the state
+			* of the consumer may be freed.
+			*/
+			class CallbackDispatcherCore {
+
+			public:
+				CallbackDispatcherCore();
+				~CallbackDispatcherCore();
+
+				CallbackDispatcherCore(const CallbackDispatcherCore&) = delete;
+				CallbackDispatcherCore& operator=(const CallbackDispatcherCore&) = delete;
+
+				/**
+				* @brief Allocates the queues and starts the dispatch threads;
+				*        returns once each has applied its schedule.
+				*
+				* @return `0`, `NativeErrorAlreadyRunning`,
+				*         `NativeErrorInvalidArgument`, `NativeErrorOutOfMemory`
+				*         or, when the OS refused the schedule of a thread, the
+				*         error of `ApplyThreadSchedule`.
+				*/
+				int32 Start(const CallbackDispatcherConfig& config,
+					CallbackBatchFunction batch, void* context);
+
+				/**
+				* @brief Delivers the queued events, then stops the dispatch
+				*        threads. Events raised afterwards are discarded.
+				*/
+				int32 Stop();
+
+				bool IsRunning() const;
+
+				/**
+				* @brief Sends the events of `task` to dispatch thread
+				*        `thread`, e.g. a dedicated one, instead of the
+				*        shared thread it hashes to. Before the events of the
+				*        task are registered: events queued before the call
+				*        may be delivered after later ones.
+				*
+				* @return `0`, `NativeErrorInvalidState` if the dispatcher is
+				*         not running, `NativeErrorInvalidArgument` for a
+				*         thread out of range, or `NativeErrorOutOfMemory` when
+				*         `CallbackMaxRoutes` tasks are routed.
+				*/
+				int32 RouteTask(TaskHandle task, uInt32 thread);
+
+				/** Sends the events of `task` back to the shared threads. */
+				int32 UnrouteTask(TaskHandle task);
+
+				/** The dispatch thread the events of `task` go to. */
+				uInt32 ThreadOfTask(TaskHandle task) const;
+
+				/**
+				* @brief Takes a key for the registrations of one subscriber.
+				*
+				* @return `0`, or `NativeErrorOutOfMemory` when
+				*         `maxRegistrations` keys are held or the registry is
+				*         full.
+				*/
+				int32 Allocate(CallbackKey* key);
+
+				/**
+				* @brief Gives back a key; its events are no longer delivered,
+				*        including those already queued.
+				*
+				* @return `0`, or `NativeErrorInvalidArgument` if the key is not
+				*         held by this dispatcher.
+				*/
+				int32 Release(CallbackKey key);
+
+				/**
+				* @brief Registers the Done event of `task` with a trampoline.
+				*
+				* @return `0`, a DAQmx error, `NativeErrorInvalidState` if the
+				*         dispatcher is not running, or
+				*         `NativeErrorInvalidArgument` for a key not held by it.
+				*/
+				int32 RegisterDoneEvent(TaskHandle task, CallbackKey key);
+
+				/**
+				* @brief Registers the EveryNSamples event of `task` with a
+				*        trampoline.
+				*
+				* @param[in] eventType `DAQmx_Val_Acquired_Into_Buffer` or
+				*            `DAQmx_Val_Transferred_From_Buffer`.
+				*/
+				int32 RegisterEveryNSamplesEvent(TaskHandle task, int32 eventType,
+					uInt32 nSamples, CallbackKey key);
+
+				/**
+				* @brief Registers a signal event of `task` with a trampoline.
+				*        One key takes one signal.
+				*
+				* @param[in] signalId An exportable signal:
+				*            `DAQmx_Val_SampleClock`,
+				*            `DAQmx_Val_ChangeDetectionEvent`,
+				*            `DAQmx_Val_CounterOutputEvent`, ...
+				*
+				* @return `0`, a DAQmx error, `NativeErrorInvalidState` if the
+				*         dispatcher is not running, `NativeErrorInvalidArgument`
+				*         for a key not held by it or already registered, or
+				*         `NativeErrorOutOfMemory`.
+				*/
+				int32 RegisterSignalEvent(TaskHandle task, int32 signalId, CallbackKey key);
+
+				/**
+				* @brief Unregisters the Done event of `task` from DAQmx with a
+				*        NULL callback. The key stays held.
+				*
+				* @return `0`, a DAQmx error, or `NativeErrorInvalidArgument`
+				*         for a key not held by the dispatcher.
+				*/
+				int32 UnregisterDoneEvent(TaskHandle task, CallbackKey key);
+
+				/**
+				* @brief Unregisters the EveryNSamples event of `task` from
+				*        DAQmx with a NULL callback. The key stays held.
+				*
+				* @param[in] eventType As registered.
+				*/
+				int32 UnregisterEveryNSamplesEvent(TaskHandle task, int32 eventType,
+					CallbackKey key);
+
+				/**
+				* @brief Unregisters a signal event of `task` from DAQmx with a
+				*        NULL callback. The key stays held; its ring is freed
+				*        with it.
+				*/
+				int32 UnregisterSignalEvent(TaskHandle task, int32 signalId, CallbackKey key);
+
+				/**
+				* @brief Waits for the trampolines and batch functions in flight,
+				*        of every dispatcher in the process.
+				*
+				* After `Release` and a successful `Quiesce`, nothing is or
+				* will be delivered for the released key.
+				*
+				* @return `false`, without waiting, when called from a batch
+				*         function; the caller must then leave the state of
+				*         the consumer to be freed later.
+				*/
+				bool Quiesce();
+
+				/**
+				* @brief Queues an event as a trampoline would, e.g. a software
+				*        event that must be ordered with the driver events of
+				*        its task.
+				*
+				* @return `0`, `NativeErrorInvalidState` if the dispatcher is
+				*         not running or the key is not held by it, or
+				*         `NativeErrorQueueFull`.
+				*/
+				int32 Post(const CallbackEvent& event);
+
+				CallbackDispatcherCounters Counters() const;
+
+				const CallbackDispatcherConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
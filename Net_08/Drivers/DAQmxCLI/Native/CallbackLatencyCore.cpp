@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CallbackLatencyCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			bool CallbackLatencyCore::IsValid() const {
+
+				for (int32 s = 0; s < CallbackLatencyStageCount; s++) {
+					if (!_stages[s].IsValid()) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			void CallbackLatencyCore::Record(const CallbackEvent* events, uInt32 count,
+				int64 calledNs, int64 returnedNs) {
+
+				if (events == nullptr || count == 0) {
+					return;
+				}
+
+				LatencyHistogram& driver = _stages[(int32)CallbackLatencyStage::Driver];
+				LatencyHistogram& queue = _stages[(int32)CallbackLatencyStage::Queue];
+				LatencyHistogram& transition = _stages[(int32)CallbackLatencyStage::Transition];
+				LatencyHistogram& endToEnd = _stages[(int32)CallbackLatencyStage::EndToEnd];
+
+				for (uInt32 k = 0; k < count; k++) {
+
+					const CallbackEvent& event = events[k];
+
+					// Posted events may come without a driver time.
+					if (event.timeNs != 0) {
+						endToEnd.Record(calledNs - event.timeNs);
+
+						if (event.queuedNs != 0) {
+							driver.Record(event.queuedNs - event.timeNs);
+						}
+					}
+
+					if (event.dispatchNs != 0) {
+						transition.Record(calledNs - event.dispatchNs);
+
+						if (event.queuedNs != 0) {
+							queue.Record(event.dispatchNs - event.queuedNs);
+						}
+					}
+				}
+
+				_stages[(int32)CallbackLatencyStage::Consumer].Record(returnedNs - calledNs);
+			}
+
+			const LatencyHistogram& CallbackLatencyCore::Histogram(CallbackLatencyStage stage) const {
+				return _stages[(int32)stage];
+			}
+
+			LatencySummary CallbackLatencyCore::Summary(CallbackLatencyStage stage) const {
+
+				if ((int32)stage < 0 || (int32)stage >= CallbackLatencyStageCount) {
+					return LatencySummary();
+				}
+				return _stages[(int32)stage].Summary();
+			}
+
+			void CallbackLatencyCore::Reset() {
+
+				for (int32 s = 0; s < CallbackLatencyStageCount; s++) {
+					_stages[s].Reset();
+				}
+			}
+		}
+	}
+}
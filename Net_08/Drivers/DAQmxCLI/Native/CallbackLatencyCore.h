@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Latency of the callback path, stage by stage. Safe to include from code
+* compiled with /clr.
+*/
+
+#include "CallbackDispatcherCore.h"
+#include "LatencyHistogram.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Stretch of the way of an event from the driver to its
+			*        consumer.
+			*/
+			enum class CallbackLatencyStage : int32 {
+				/** From the trampoline entry to the queue of the dispatch
+				*   thread; `0` for signals, which the trampoline puts into
+				*   their ring at once. */
+				Driver = 0,
+				/** Queued until the dispatch thread hands its batch over. */
+				Queue = 1,
+				/** Batch handed over until the consumer is called: the
+				*   managed transition and the fan-out to the handles. */
+				Transition = 2,
+				/** Time spent in the consumer, per call. */
+				Consumer = 3,
+				/** From the trampoline entry to the call of the consumer. */
+				EndToEnd = 4
+			};
+
+			constexpr int32 CallbackLatencyStageCount = 5;
+
+			/**
+			* @brief One `LatencyHistogram` per `CallbackLatencyStage` for the
+			*        events of one registration.
+			*
+			* Reads the times the trampoline and the dispatcher stamp into
+			* each `CallbackEvent` (`timeNs`, and `queuedNs` and `dispatchNs`
+			* with `CallbackDispatcherConfig::stampLatency`) and the times the
+			* consumer was called and returned, so a late event can be put
+			* down to the driver, the dispatcher, the managed transition or
+			* the consumer. Stages whose stamps are missing are skipped.
+			*
+			* `Record` is wait-free; the histograms may be read and reset
+			* from any thread while it runs.
+			*/
+			class CallbackLatencyCore {
+
+			public:
+				CallbackLatencyCore() {}
+
+				CallbackLatencyCore(const CallbackLatencyCore&) = delete;
+				CallbackLatencyCore& operator=(const CallbackLatencyCore&) = delete;
+
+				/** `false` if a histogram could not be allocated. */
+				bool IsValid() const;
+
+				/**
+				* @brief Records `count` events passed to one call of a
+				*        consumer: one Consumer latency, the other stages per
+				*        event.
+				*
+				* @param[in] calledNs   `HostMonotonicNs` before the call.
+				* @param[in] returnedNs `HostMonotonicNs` after it.
+				*/
+				void Record(const CallbackEvent* events, uInt32 count,
+					int64 calledNs, int64 returnedNs);
+
+				const LatencyHistogram& Histogram(CallbackLatencyStage stage) const;
+
+				LatencySummary Summary(CallbackLatencyStage stage) const;
+
+				/** Clears every stage. */
+				void Reset();
+
+			private:
+				LatencyHistogram _stages[CallbackLatencyStageCount];
+			};
+		}
+	}
+}
@@ -0,0 +1,296 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CallbackRegistry.h"
+
+#include <chrono>
+#include <new>
+#include <thread>
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const CallbackKey GenerationStep = (CallbackKey)1 << CallbackKeyIndexBits;
+
+				// Yields before `Synchronize` starts to sleep between looks;
+				// sections are usually a few hundred nanoseconds.
+				const int SynchronizeSpins = 64;
+
+				// Read sections the calling thread is in.
+				thread_local uInt32 t_sections = 0;
+			}
+
+			CallbackRegistry& CallbackRegistry::Instance() {
+				static CallbackRegistry registry;
+				return registry;
+			}
+
+			CallbackRegistry::CallbackRegistry() :
+				_slotCount(0), _live(0), _epoch(0) {
+
+				_readers[0].store(0, std::memory_order_relaxed);
+				_readers[1].store(0, std::memory_order_relaxed);
+
+				for (uInt32 c = 0; c < ChunkCount; c++) {
+					_chunks[c].store(nullptr, std::memory_order_relaxed);
+				}
+			}
+
+			// Only at process exit; the driver no longer calls by then.
+			CallbackRegistry::~CallbackRegistry() {
+
+				for (uInt32 c = 0; c < ChunkCount; c++) {
+					delete[] _chunks[c].load(std::memory_order_relaxed);
+				}
+			}
+
+			CallbackRegistry::Slot* CallbackRegistry::SlotOf(uInt32 index) const {
+
+				Slot* chunk = _chunks[index >> ChunkBits].load(std::memory_order_acquire);
+				return (chunk != nullptr) ? &chunk[index & (ChunkSize - 1)] : nullptr;
+			}
+
+			bool CallbackRegistry::Allocate(void* owner, CallbackKey& key) {
+
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				uInt32 index;
+
+				if (!_free.empty()) {
+					index = _free.back();
+					_free.pop_back();
+				}
+				else {
+					if (_slotCount == CallbackMaxRegistrations) {
+						return false;
+					}
+
+					index = _slotCount;
+
+					if ((index & (ChunkSize - 1)) == 0) {
+
+						Slot* chunk = new (std::nothrow) Slot[ChunkSize];
+
+						if (chunk == nullptr) {
+							return false;
+						}
+
+						// Room for every slot to come back, so `Release`
+						// never allocates.
+						try {
+							_free.reserve(_slotCount + ChunkSize);
+						}
+						catch (const std::bad_alloc&) {
+							delete[] chunk;
+							return false;
+						}
+
+						for (uInt32 k = 0; k < ChunkSize; k++) {
+							chunk[k].key.store(0, std::memory_order_relaxed);
+							chunk[k].owner.store(nullptr, std::memory_order_relaxed);
+							chunk[k].context.store(nullptr, std::memory_order_relaxed);
+							chunk[k].generation = GenerationStep;
+						}
+						_chunks[index >> ChunkBits].store(chunk, std::memory_order_release);
+					}
+					_slotCount++;
+				}
+
+				Slot& slot = *SlotOf(index);
+				key = slot.generation | index;
+
+				// The owner first: a reader that sees the key sees its owner,
+				// and one that sees the new owner also sees the key change.
+				slot.owner.store(owner, std::memory_order_release);
+				slot.context.store(nullptr, std::memory_order_release);
+				slot.key.store(key, std::memory_order_release);
+				_live++;
+				return true;
+			}
+
+			void CallbackRegistry::Free(Slot& slot, uInt32 index) {
+
+				slot.key.store(0, std::memory_order_release);
+
+				// Generation 0 would make key 0 for index 0.
+				slot.generation += GenerationStep;
+				if (slot.generation == 0) {
+					slot.generation = GenerationStep;
+				}
+
+				_free.push_back(index);
+				_live--;
+			}
+
+			bool CallbackRegistry::Release(CallbackKey key, const void* owner) {
+
+				const uInt32 index = CallbackKeyIndex(key);
+
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				if (index >= _slotCount) {
+					return false;
+				}
+
+				Slot& slot = *SlotOf(index);
+
+				if (key == 0 || slot.key.load(std::memory_order_relaxed) != key
+					|| slot.owner.load(std::memory_order_relaxed) != owner) {
+					return false;
+				}
+
+				Free(slot, index);
+				return true;
+			}
+
+			size_t CallbackRegistry::ReleaseAll(const void* owner) {
+
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				size_t released = 0;
+
+				for (uInt32 index = 0; index < _slotCount; index++) {
+
+					Slot& slot = *SlotOf(index);
+
+					if (slot.key.load(std::memory_order_relaxed) != 0
+						&& slot.owner.load(std::memory_order_relaxed) == owner) {
+						Free(slot, index);
+						released++;
+					}
+				}
+				return released;
+			}
+
+			void* CallbackRegistry::Owner(CallbackKey key) const {
+
+				void* owner = nullptr;
+				void* context = nullptr;
+				return Resolve(key, owner, context) ? owner : nullptr;
+			}
+
+			bool CallbackRegistry::SetContext(CallbackKey key, const void* owner, void* context) {
+
+				const uInt32 index = CallbackKeyIndex(key);
+
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				if (key == 0 || index >= _slotCount) {
+					return false;
+				}
+
+				Slot& slot = *SlotOf(index);
+
+				if (slot.key.load(std::memory_order_relaxed) != key
+					|| slot.owner.load(std::memory_order_relaxed) != owner) {
+					return false;
+				}
+
+				slot.context.store(context, std::memory_order_release);
+				return true;
+			}
+
+			bool CallbackRegistry::Resolve(CallbackKey key, void*& owner, void*& context) const {
+
+				if (key == 0) {
+					return false;
+				}
+
+				const Slot* slot = SlotOf(CallbackKeyIndex(key));
+
+				if (slot == nullptr || slot->key.load(std::memory_order_acquire) != key) {
+					return false;
+				}
+
+				owner = slot->owner.load(std::memory_order_acquire);
+				context = slot->context.load(std::memory_order_acquire);
+
+				// Released and reused in between: the key changed.
+				return slot->key.load(std::memory_order_acquire) == key;
+			}
+
+			size_t CallbackRegistry::LiveCount() const {
+				std::lock_guard<std::mutex> lock(_mutex);
+				return _live;
+			}
+
+			size_t CallbackRegistry::SlotCount() const {
+				std::lock_guard<std::mutex> lock(_mutex);
+				return _slotCount;
+			}
+
+			uInt32 CallbackRegistry::EnterEpoch() {
+
+				for (;;) {
+					const uInt64 epoch = _epoch.load(std::memory_order_seq_cst);
+					const uInt32 counter = (uInt32)(epoch & 1);
+
+					_readers[counter].fetch_add(1, std::memory_order_seq_cst);
+
+					// The epoch moved on before the increment was seen:
+					// `Synchronize` may already have found the counter
+					// empty, so enter again on the current one. Nothing was
+					// read yet.
+					if (_epoch.load(std::memory_order_seq_cst) == epoch) {
+						t_sections++;
+						return counter;
+					}
+					_readers[counter].fetch_sub(1, std::memory_order_release);
+				}
+			}
+
+			void CallbackRegistry::ExitEpoch(uInt32 counter) {
+				t_sections--;
+				_readers[counter].fetch_sub(1, std::memory_order_release);
+			}
+
+			bool CallbackRegistry::Synchronize() {
+
+				if (t_sections != 0) {
+					return false;
+				}
+
+				std::lock_guard<std::mutex> lock(_epochMutex);
+
+				// New sections go to the other counter from here on.
+				const uInt32 counter = (uInt32)(_epoch.fetch_add(1, std::memory_order_seq_cst) & 1);
+
+				int spins = 0;
+
+				while (_readers[counter].load(std::memory_order_acquire) != 0) {
+
+					if (spins < SynchronizeSpins) {
+						spins++;
+						std::this_thread::yield();
+					}
+					else {
+						std::this_thread::sleep_for(std::chrono::microseconds(100));
+					}
+				}
+				return true;
+			}
+		}
+	}
+}
@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Native only: uses <atomic> and must not be included from code compiled
+* with /clr. Managed wrappers reach the registry through
+* CallbackDispatcherCore.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "CallbackDispatcherCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Process-wide slot map that turns the `CallbackKey` passed
+			*        to DAQmx as callbackData back into its owner.
+			*
+			* Slots live in chunks of 1024 that are allocated when the number
+			* of live registrations first grows into them and are never freed,
+			* so a trampoline may look up any key at any time, even one the
+			* driver held on to after its release. Released slots go on a
+			* free list and come back with the next generation, so `Allocate`
+			* and `Release` are O(1) and allocation-free once the registry has
+			* grown to its working size, and a stale key never matches the
+			* registration that reused its slot.
+			*
+			* `Allocate` and `Release` take a short lock; `Owner` is wait-free
+			* and may be called from any thread.
+			*
+			* The registry also keeps the epoch of the callback path. Code that
+			* follows a key to its owner, the trampolines and the deliveries,
+			* runs in a read section (`CallbackEpochGuard`): two counters, one
+			* per parity of the epoch, that a reader increments on entry.
+			* `Synchronize` advances the epoch and waits for the counter of
+			* the previous one to drain, so once it returns, every section
+			* that could have seen a key released before the call has ended
+			* and the state behind the key may be freed. Entering and leaving
+			* a section are one atomic increment and decrement each; the
+			* driver thread never waits.
+			*/
+			class CallbackRegistry {
+
+			public:
+				static CallbackRegistry& Instance();
+
+				CallbackRegistry(const CallbackRegistry&) = delete;
+				CallbackRegistry& operator=(const CallbackRegistry&) = delete;
+
+				/**
+				* @brief Takes a free slot for `owner`.
+				*
+				* @return `false` when all `CallbackMaxRegistrations` slots are
+				*         live, or the memory of a new chunk could not be
+				*         allocated.
+				*/
+				bool Allocate(void* owner, CallbackKey& key);
+
+				/**
+				* @brief Frees the slot of `key`; its key stops matching at
+				*        once.
+				*
+				* @return `false` if `key` is not live or belongs to another
+				*         owner.
+				*/
+				bool Release(CallbackKey key, const void* owner);
+
+				/**
+				* @brief Releases every live slot of `owner`; O(slots).
+				*
+				* @return The number of slots released.
+				*/
+				size_t ReleaseAll(const void* owner);
+
+				/**
+				* @brief The owner of a live key, `nullptr` for a released or
+				*        malformed one.
+				*/
+				void* Owner(CallbackKey key) const;
+
+				/**
+				* @brief Attaches per-registration state of the owner to a live
+				*        key; `nullptr` until set, cleared on release.
+				*
+				* @return `false` if `key` is not live or belongs to another
+				*         owner.
+				*/
+				bool SetContext(CallbackKey key, const void* owner, void* context);
+
+				/**
+				* @brief Owner and context of a live key in one wait-free look.
+				*
+				* @return `false` for a released or malformed key.
+				*/
+				bool Resolve(CallbackKey key, void*& owner, void*& context) const;
+
+				/** Slots live at the moment. */
+				size_t LiveCount() const;
+
+				/** Slots allocated so far, live or free. */
+				size_t SlotCount() const;
+
+				/**
+				* @brief Enters a read section; sections nest.
+				*
+				* @return The counter to pass to `ExitEpoch`.
+				*/
+				uInt32 EnterEpoch();
+
+				void ExitEpoch(uInt32 counter);
+
+				/**
+				* @brief Waits until every read section entered before the call
+				*        has ended. Blocks as long as the slowest section, e.g.
+				*        a consumer still running.
+				*
+				* @return `false`, without waiting, when called from a read
+				*         section, e.g. a batch function: two deliveries that
+				*         wait for each other would never end.
+				*/
+				bool Synchronize();
+
+			private:
+				CallbackRegistry();
+				~CallbackRegistry();
+
+				static constexpr uInt32 ChunkBits = 10;
+				static constexpr uInt32 ChunkSize = 1u << ChunkBits;
+				static constexpr uInt32 ChunkCount = CallbackMaxRegistrations / ChunkSize;
+
+				struct Slot {
+					/** The live key, `0` while the slot is free. */
+					std::atomic<CallbackKey> key;
+					std::atomic<void*> owner;
+					std::atomic<void*> context;
+					/** Generation of the next key; guarded by `_mutex`. */
+					CallbackKey generation;
+				};
+
+				Slot* SlotOf(uInt32 index) const;
+
+				void Free(Slot& slot, uInt32 index);
+
+				std::atomic<Slot*> _chunks[ChunkCount];
+
+				mutable std::mutex _mutex;
+				std::vector<uInt32> _free;
+				uInt32 _slotCount;
+				size_t _live;
+
+				// One `Synchronize` at a time advances the epoch.
+				std::mutex _epochMutex;
+				alignas(CacheLineSize) std::atomic<uInt64> _epoch;
+				alignas(CacheLineSize) std::atomic<uInt64> _readers[2];
+			};
+
+			/**
+			* @brief Read section of the callback path for the lifetime of the
+			*        guard.
+			*/
+			class CallbackEpochGuard {
+
+			public:
+				CallbackEpochGuard() :
+					_counter(CallbackRegistry::Instance().EnterEpoch()) {}
+
+				~CallbackEpochGuard() {
+					CallbackRegistry::Instance().ExitEpoch(_counter);
+				}
+
+				CallbackEpochGuard(const CallbackEpochGuard&) = delete;
+				CallbackEpochGuard& operator=(const CallbackEpochGuard&) = delete;
+
+			private:
+				uInt32 _counter;
+			};
+		}
+	}
+}
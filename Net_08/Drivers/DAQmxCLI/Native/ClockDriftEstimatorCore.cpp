@@ -0,0 +1,383 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ClockDriftEstimatorCore.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const size_t WordsPerFit = sizeof(ClockFit) / sizeof(uInt64);
+				static_assert(sizeof(ClockFit) == WordsPerFit * sizeof(uInt64),
+					"ClockFit is published as 64-bit words");
+
+				ClockFit EmptyFit() {
+
+					const float64 nan = std::numeric_limits<float64>::quiet_NaN();
+
+					ClockFit fit;
+					fit.observations = 0;
+					fit.rejected = 0;
+					fit.reseeds = 0;
+					fit.baseTimeNs = 0;
+					fit.baseIndex = 0;
+					fit.meanIndex = fit.meanTimeNs = nan;
+					fit.periodNs = fit.rate = fit.driftPpm = nan;
+					fit.residualRmsNs = nan;
+					return fit;
+				}
+
+				bool HasFit(const ClockFit& fit) {
+					return fit.observations > 0 && std::isfinite(fit.periodNs)
+						&& fit.periodNs > 0.0;
+				}
+
+				// Host time, relative to the base, at which `samples` samples
+				// had been acquired.
+				float64 Evaluate(const ClockFit& fit, uInt64 samples) {
+					const float64 x = (float64)(int64)(samples - fit.baseIndex);
+					return fit.meanTimeNs + fit.periodNs * (x - fit.meanIndex);
+				}
+			}
+
+			struct ClockDriftEstimatorCore::Impl {
+
+				ClockDriftEstimatorConfig config;
+				float64 forgetting;
+
+				// Fit state, owned by the thread adding observations. Positions
+				// and times are relative to the base; the moments are centred on
+				// the weighted means.
+				bool seeded;
+				uInt64 baseIndex;
+				int64 baseTimeNs;
+				uInt64 lastIndex;
+				float64 weight;
+				float64 meanX;
+				float64 meanY;
+				float64 sxx;
+				float64 sxy;
+				float64 syy;
+				uInt64 fitted;
+				uInt64 accepted;
+				uInt64 rejected;
+				uInt64 reseeds;
+				uInt32 consecutiveOutliers;
+
+				// Published `ClockFit`, guarded by `sequence` (odd while the
+				// writer is updating).
+				std::atomic<uInt64> published[WordsPerFit];
+				std::atomic<uInt64> sequence;
+
+				Impl() : config(DefaultClockDriftEstimatorConfig()), sequence(0) {
+					for (size_t i = 0; i < WordsPerFit; i++) {
+						published[i].store(0, std::memory_order_relaxed);
+					}
+					ApplyForgetting();
+					Clear();
+				}
+
+				void ApplyForgetting() {
+					forgetting = (config.window > 1) ? 1.0 - 1.0 / (float64)config.window : 0.0;
+				}
+
+				void Clear() {
+					seeded = false;
+					accepted = rejected = reseeds = 0;
+					Publish();
+				}
+
+				void Seed(uInt64 samplesAcquired, int64 hostTimeNs) {
+					seeded = true;
+					baseIndex = samplesAcquired;
+					baseTimeNs = hostTimeNs;
+					lastIndex = samplesAcquired;
+					weight = 1.0;
+					meanX = meanY = 0.0;
+					sxx = sxy = syy = 0.0;
+					consecutiveOutliers = 0;
+					fitted = 1;
+					accepted++;
+				}
+
+				float64 Slope() const {
+					return (sxx > 0.0) ? sxy / sxx : 0.0;
+				}
+
+				float64 ResidualRms() const {
+					const float64 ss = syy - Slope() * sxy;
+					return (ss > 0.0) ? std::sqrt(ss / weight) : 0.0;
+				}
+
+				ClockFit Current() const {
+
+					ClockFit fit = EmptyFit();
+					fit.observations = accepted;
+					fit.rejected = rejected;
+					fit.reseeds = reseeds;
+
+					if (!seeded) {
+						return fit;
+					}
+
+					fit.baseTimeNs = baseTimeNs;
+					fit.baseIndex = baseIndex;
+					fit.meanIndex = meanX;
+					fit.meanTimeNs = meanY;
+
+					if (sxx > 0.0) {
+						fit.periodNs = Slope();
+						fit.residualRmsNs = ResidualRms();
+					}
+					else if (config.nominalRate > 0.0) {
+						fit.periodNs = 1.0e9 / config.nominalRate;
+					}
+
+					if (fit.periodNs > 0.0) {
+						fit.rate = 1.0e9 / fit.periodNs;
+
+						if (config.nominalRate > 0.0) {
+							fit.driftPpm = (fit.rate / config.nominalRate - 1.0) * 1.0e6;
+						}
+					}
+					return fit;
+				}
+
+				void Publish() {
+
+					const ClockFit fit = Current();
+					uInt64 words[WordsPerFit];
+					std::memcpy(words, &fit, sizeof(fit));
+
+					const uInt64 s = sequence.load(std::memory_order_relaxed);
+					sequence.store(s + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_release);
+
+					for (size_t i = 0; i < WordsPerFit; i++) {
+						published[i].store(words[i], std::memory_order_relaxed);
+					}
+
+					sequence.store(s + 2, std::memory_order_release);
+				}
+
+				ClockFit Snapshot() const {
+
+					for (;;) {
+						const uInt64 before = sequence.load(std::memory_order_acquire);
+
+						if ((before & 1) != 0) {
+							std::this_thread::yield();
+							continue;
+						}
+
+						uInt64 words[WordsPerFit];
+
+						for (size_t i = 0; i < WordsPerFit; i++) {
+							words[i] = published[i].load(std::memory_order_relaxed);
+						}
+
+						std::atomic_thread_fence(std::memory_order_acquire);
+
+						if (sequence.load(std::memory_order_relaxed) == before) {
+							ClockFit fit;
+							std::memcpy(&fit, words, sizeof(fit));
+							return fit;
+						}
+					}
+				}
+			};
+
+			ClockDriftEstimatorCore::ClockDriftEstimatorCore() {
+				_impl = new (std::nothrow) Impl();
+			}
+
+			ClockDriftEstimatorCore::~ClockDriftEstimatorCore() {
+				delete _impl;
+			}
+
+			int32 ClockDriftEstimatorCore::Configure(const ClockDriftEstimatorConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (!(config.nominalRate >= 0.0) || !std::isfinite(config.nominalRate)
+					|| config.window == 0 || !(config.outlierSigma > 0.0)
+					|| !(config.minOutlierNs >= 0.0) || config.maxConsecutiveOutliers == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				_impl->config = config;
+				_impl->ApplyForgetting();
+				_impl->Clear();
+				return NativeSuccess;
+			}
+
+			void ClockDriftEstimatorCore::Reset() {
+
+				if (_impl != nullptr) {
+					_impl->Clear();
+				}
+			}
+
+			bool ClockDriftEstimatorCore::AddObservation(uInt64 samplesAcquired,
+				int64 hostTimeNs) {
+
+				if (_impl == nullptr) {
+					return false;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.seeded || samplesAcquired < impl.lastIndex) {
+					if (impl.seeded) {
+						impl.reseeds++;
+					}
+					impl.Seed(samplesAcquired, hostTimeNs);
+					impl.Publish();
+					return true;
+				}
+
+				if (samplesAcquired == impl.lastIndex) {
+					return false;
+				}
+
+				const float64 x = (float64)(int64)(samplesAcquired - impl.baseIndex);
+				const float64 y = (float64)(hostTimeNs - impl.baseTimeNs);
+
+				if (impl.fitted >= impl.config.warmup && impl.sxx > 0.0) {
+
+					const float64 residual = y - (impl.meanY + impl.Slope() * (x - impl.meanX));
+					const float64 threshold = std::fmax(
+						impl.config.outlierSigma * impl.ResidualRms(), impl.config.minOutlierNs);
+
+					if (std::fabs(residual) > threshold) {
+						impl.rejected++;
+
+						if (++impl.consecutiveOutliers >= impl.config.maxConsecutiveOutliers) {
+							impl.reseeds++;
+							impl.Seed(samplesAcquired, hostTimeNs);
+						}
+						impl.Publish();
+						return false;
+					}
+				}
+
+				// Exponentially weighted Welford update: the old observations
+				// are scaled by the forgetting factor, then the new one is added
+				// with weight 1.
+				impl.weight = impl.forgetting * impl.weight + 1.0;
+
+				const float64 dx = x - impl.meanX;
+				const float64 dy = y - impl.meanY;
+
+				impl.meanX += dx / impl.weight;
+				impl.meanY += dy / impl.weight;
+
+				impl.sxx = impl.forgetting * impl.sxx + dx * (x - impl.meanX);
+				impl.sxy = impl.forgetting * impl.sxy + dx * (y - impl.meanY);
+				impl.syy = impl.forgetting * impl.syy + dy * (y - impl.meanY);
+
+				impl.lastIndex = samplesAcquired;
+				impl.consecutiveOutliers = 0;
+				impl.fitted++;
+				impl.accepted++;
+				impl.Publish();
+				return true;
+			}
+
+			ClockFit ClockDriftEstimatorCore::GetFit() const {
+				return (_impl != nullptr) ? _impl->Snapshot() : EmptyFit();
+			}
+
+			bool ClockDriftEstimatorCore::SampleHostTime(uInt64 sampleIndex,
+				int64& hostTimeNs) const {
+
+				const ClockFit fit = GetFit();
+
+				if (!HasFit(fit)) {
+					return false;
+				}
+
+				hostTimeNs = fit.baseTimeNs + std::llround(Evaluate(fit, sampleIndex + 1));
+				return true;
+			}
+
+			int32 ClockDriftEstimatorCore::InterpolateHostTimes(uInt64 firstSample,
+				uInt32 count, int64* hostTimesNs) const {
+
+				if (count > 0 && hostTimesNs == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const ClockFit fit = GetFit();
+
+				if (!HasFit(fit)) {
+					return NativeErrorInvalidState;
+				}
+
+				// Offsets stay small relative to the base, so adding the period
+				// as a multiple keeps full precision; rounding per sample avoids
+				// accumulating it.
+				const float64 first = Evaluate(fit, firstSample + 1);
+
+				for (uInt32 i = 0; i < count; i++) {
+					hostTimesNs[i] = fit.baseTimeNs
+						+ std::llround(first + fit.periodNs * (float64)i);
+				}
+				return NativeSuccess;
+			}
+
+			bool ClockDriftEstimatorCore::SampleAtHostTime(int64 hostTimeNs,
+				float64& sampleIndex) const {
+
+				const ClockFit fit = GetFit();
+
+				if (!HasFit(fit)) {
+					return false;
+				}
+
+				const float64 y = (float64)(hostTimeNs - fit.baseTimeNs);
+				const float64 x = fit.meanIndex + (y - fit.meanTimeNs) / fit.periodNs;
+
+				// Samples acquired at that time, minus one for the index.
+				sampleIndex = (float64)fit.baseIndex + x - 1.0;
+				return true;
+			}
+
+			const ClockDriftEstimatorConfig& ClockDriftEstimatorCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
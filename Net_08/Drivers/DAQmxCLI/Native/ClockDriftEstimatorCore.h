@@ -0,0 +1,218 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the sample clock / host clock estimator. Safe to include from code
+* compiled with /clr; the fit and the published snapshot live in
+* ClockDriftEstimatorCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Settings of a `ClockDriftEstimatorCore`.
+			*/
+			struct ClockDriftEstimatorConfig {
+
+				/** Configured sample rate, in samples per second per channel. Used
+				*   for the period until two observations are in and as reference
+				*   of `ClockFit::driftPpm`; `0` if unknown. */
+				float64 nominalRate;
+
+				/** Effective number of observations the fit remembers. Older
+				*   observations fade out with the factor `1 - 1 / window` per
+				*   observation, so the fit follows slow drift (temperature) of
+				*   either clock. */
+				uInt32 window;
+
+				/** Observations accepted before outliers are rejected. */
+				uInt32 warmup;
+
+				/** Observations whose host time is further than
+				*   `outlierSigma` residual RMS from the fit are rejected
+				*   (late callbacks). */
+				float64 outlierSigma;
+
+				/** Lower bound of the rejection threshold, in nanoseconds, so that
+				*   a nearly perfect fit does not reject ordinary jitter. */
+				float64 minOutlierNs;
+
+				/** Consecutive rejections after which the fit is restarted from
+				*   the current observation (the clocks stepped). */
+				uInt32 maxConsecutiveOutliers;
+			};
+
+			inline ClockDriftEstimatorConfig DefaultClockDriftEstimatorConfig() {
+
+				ClockDriftEstimatorConfig config;
+				config.nominalRate = 0.0;
+				config.window = 256;
+				config.warmup = 16;
+				config.outlierSigma = 4.0;
+				config.minOutlierNs = 20000.0;
+				config.maxConsecutiveOutliers = 16;
+				return config;
+			}
+
+			/**
+			* @brief Published state of the fit.
+			*
+			* The fit maps the count of samples acquired, relative to
+			* `baseIndex`, to host time relative to `baseTimeNs`:
+			* `t(n) = baseTimeNs + meanTimeNs + periodNs * (n - baseIndex - meanIndex)`.
+			* Fields derived from the fit are NaN until the first observation;
+			* with only one, the period is the nominal one.
+			*/
+			struct ClockFit {
+				/** Observations accepted since the last reset. */
+				uInt64 observations;
+				/** Observations rejected as outliers since the last reset. */
+				uInt64 rejected;
+				/** Times the fit restarted since the last reset. */
+				uInt64 reseeds;
+
+				/** Host time (`HostMonotonicNs`) of the observation the fit started at. */
+				int64 baseTimeNs;
+				/** Samples acquired at the observation the fit started at. */
+				uInt64 baseIndex;
+
+				/** Weighted mean of the observations, relative to the base. */
+				float64 meanIndex;
+				float64 meanTimeNs;
+
+				/** Estimated sample period, in host nanoseconds. */
+				float64 periodNs;
+				/** Estimated sample rate, in samples per host second. */
+				float64 rate;
+				/** `rate` relative to the nominal rate, in parts per million;
+				*   NaN without a nominal rate. */
+				float64 driftPpm;
+				/** Weighted RMS of the host times around the fit, in nanoseconds. */
+				float64 residualRmsNs;
+			};
+
+			/**
+			* @brief Fits the host monotonic clock against the sample clock of a
+			*        task, so that every sample gets a host timestamp.
+			*
+			* Each observation pairs the number of samples acquired per channel
+			* (`DAQmxGetReadTotalSampPerChanAcquired`) with the host time it was
+			* taken at, e.g. at the entry of the EveryNSamples callback (see
+			* `AcquisitionEngineCore::SetClockEstimator`). The observations are
+			* fitted by least squares as they arrive: the means and co-moments
+			* are updated around the running mean (weighted Welford), which stays
+			* exact over days of samples where raw sums of x, x² and xy lose all
+			* digits, and an exponential forgetting factor keeps the fit local in
+			* time. Callbacks delivered late by the scheduler are recognised by
+			* their residual and left out.
+			*
+			* Sample `i` (0-based) is complete when `i + 1` samples have been
+			* acquired, so its host time is the fit at `i + 1`. The host time
+			* therefore includes the delay between the sample clock edge and the
+			* sample showing up in the count (FIFO and transfer latency, and the
+			* callback delay common to all observations), which is constant for a
+			* given device and acquisition.
+			*
+			* After every observation the fit is published to a snapshot that
+			* any thread reads without locks (sequence lock). `AddObservation`,
+			* `Configure` and `Reset` must be called from one thread at a time.
+			*/
+			class ClockDriftEstimatorCore {
+
+			public:
+				ClockDriftEstimatorCore();
+				~ClockDriftEstimatorCore();
+
+				ClockDriftEstimatorCore(const ClockDriftEstimatorCore&) = delete;
+				ClockDriftEstimatorCore& operator=(const ClockDriftEstimatorCore&) = delete;
+
+				/**
+				* @brief Applies the settings and clears the fit.
+				*
+				* @return `0` or `NativeErrorInvalidArgument`.
+				*/
+				int32 Configure(const ClockDriftEstimatorConfig& config);
+
+				/**
+				* @brief Clears the fit, e.g. when the task restarts.
+				*/
+				void Reset();
+
+				/**
+				* @brief Adds one observation and publishes the fit.
+				*
+				* A count lower than the previous one (task restarted) restarts the
+				* fit; an unchanged count is ignored.
+				*
+				* @param[in] samplesAcquired Samples acquired per channel.
+				* @param[in] hostTimeNs `HostMonotonicNs` when the count was taken.
+				*
+				* @return `false` if the observation was ignored or rejected.
+				*/
+				bool AddObservation(uInt64 samplesAcquired, int64 hostTimeNs);
+
+				/**
+				* @brief Copies the published fit. Safe from any thread.
+				*/
+				ClockFit GetFit() const;
+
+				/**
+				* @brief Host time of sample `sampleIndex`. Safe from any thread.
+				*
+				* @return `false` before the first observation, or before the
+				*         second one without a nominal rate.
+				*/
+				bool SampleHostTime(uInt64 sampleIndex, int64& hostTimeNs) const;
+
+				/**
+				* @brief Host times of `count` consecutive samples from
+				*        `firstSample`, all from the same fit. Safe from any thread.
+				*
+				* @return `0` or `NativeErrorInvalidState` when no fit is available.
+				*/
+				int32 InterpolateHostTimes(uInt64 firstSample, uInt32 count,
+					int64* hostTimesNs) const;
+
+				/**
+				* @brief Fractional sample index taken at host time `hostTimeNs`,
+				*        e.g. to find the samples around a PLC event. Safe from any
+				*        thread.
+				*
+				* @return `false` when no fit is available.
+				*/
+				bool SampleAtHostTime(int64 hostTimeNs, float64& sampleIndex) const;
+
+				const ClockDriftEstimatorConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,135 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Layout of the blocks produced by SampleCodecCore. Plain structures and
+* inline functions only; safe to include from code compiled with /clr.
+*
+* An encoded stream is a sequence of self-contained blocks, each holding
+* up to `blockSamplesPerChannel` consecutive samples of every channel:
+*
+*   [CodecBlockHeader][CodecChannelEntry x channels][payload 0] ... [payload n-1]
+*
+* `blockBytes` in the header gives the start of the next block, so a
+* stream can be searched by sample index by hopping from header to header,
+* and the channel entries give the payload of each channel, so a single
+* channel can be decoded without touching the others.
+*
+* A payload stores the zigzag-coded residuals of a fixed predictor,
+* `CodecMiniBlockValues` at a time:
+*
+*   [width of each mini-block, one byte, padded to 4][packed mini-blocks]
+*
+* A mini-block of width `w` is `w * 32` bytes: eight lanes of `w` 32-bit
+* words, interleaved word by word, where lane `k` holds the values
+* `k, k + 8, k + 16, ...` back to back from the least significant bit.
+* This lets one vector instruction shift eight values at a time. The
+* prediction history before the first sample of a block is `seed`, the
+* first sample itself, so the first residual of the delta and linear
+* predictors is 0. All fields are little endian.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			const uInt32 CodecBlockMagic = 0x4B4C4243; // "CBLK"
+			const uInt8 CodecVersion = 1;
+
+			/** Values sharing one bit width. */
+			const uInt32 CodecMiniBlockValues = 256;
+
+			/**
+			* @brief Predictor a channel payload was coded with.
+			*/
+			enum class CodecPredictor : uInt8 {
+				/** Residual is the sample itself. */
+				None = 0,
+				/** Residual is `x[i] - x[i-1]`. */
+				Delta = 1,
+				/** Residual is `x[i] - (2 x[i-1] - x[i-2])`. */
+				Linear = 2,
+				/** Encoder setting only: the cheapest of the three per
+				*   channel and block. */
+				Auto = 255
+			};
+
+			#pragma pack(push, 8)
+
+			struct CodecBlockHeader {
+				uInt32 magic;
+				/** Bytes of the block, header included. */
+				uInt32 blockBytes;
+
+				/** Index, per channel, of the first sample of the block
+				*   since the encoder was reset. */
+				uInt64 firstSample;
+
+				uInt32 samplesPerChannel;
+				uInt16 channels;
+				/** 2 for `DAQmxReadBinaryI16` codes, 4 for `I32`. */
+				uInt8 sampleBytes;
+				uInt8 version;
+
+				uInt64 reserved;
+			};
+
+			struct CodecChannelEntry {
+				/** Offset of the payload from the start of the block. */
+				uInt32 offset;
+				uInt32 bytes;
+				/** First sample, sign extended. */
+				int32 seed;
+				/** `CodecPredictor`. */
+				uInt8 predictor;
+				uInt8 reserved[3];
+			};
+
+			#pragma pack(pop)
+
+			static_assert(sizeof(CodecBlockHeader) == 32, "Codec block header layout changed.");
+			static_assert(sizeof(CodecChannelEntry) == 16, "Codec channel entry layout changed.");
+
+			inline size_t CodecMiniBlocks(size_t samplesPerChannel) {
+				return (samplesPerChannel + CodecMiniBlockValues - 1) / CodecMiniBlockValues;
+			}
+
+			/**
+			* @brief Largest block the encoder can produce: every mini-block
+			*        at 32 bits.
+			*/
+			inline size_t MaxCodecBlockBytes(size_t channels, size_t samplesPerChannel) {
+
+				const size_t miniBlocks = CodecMiniBlocks(samplesPerChannel);
+				const size_t payload = ((miniBlocks + 3) & ~(size_t)3)
+					+ miniBlocks * CodecMiniBlockValues * sizeof(uInt32);
+
+				return sizeof(CodecBlockHeader)
+					+ channels * (sizeof(CodecChannelEntry) + payload);
+			}
+		}
+	}
+}
@@ -0,0 +1,630 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CodecKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "CodecFormat.h"
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const uInt32 Lanes = 8;
+				const uInt32 Rows = CodecMiniBlockValues / Lanes;
+
+				inline uInt32 ZigZag(uInt32 d) {
+					return (d << 1) ^ (uInt32)((int32)d >> 31);
+				}
+
+				inline uInt32 UnZigZag(uInt32 z) {
+					return (z >> 1) ^ (0u - (z & 1u));
+				}
+
+				inline uInt32 HighestBitWidth(uInt32 value) {
+					if (value == 0) {
+						return 0;
+					}
+#if defined(_MSC_VER)
+					unsigned long index;
+					_BitScanReverse(&index, value);
+					return (uInt32)index + 1;
+#else
+					return 32u - (uInt32)__builtin_clz(value);
+#endif
+				}
+
+				// Residual of sample `i >= 2`.
+				template <typename T, uInt32 Order>
+				inline uInt32 ResidualAt(const T* x, size_t i) {
+
+					const uInt32 a = (uInt32)(int32)x[i];
+					if (Order == 0) {
+						return ZigZag(a);
+					}
+
+					const uInt32 b = (uInt32)(int32)x[i - 1];
+					if (Order == 1) {
+						return ZigZag(a - b);
+					}
+
+					const uInt32 c = (uInt32)(int32)x[i - 2];
+					return ZigZag(a - 2u * b + c);
+				}
+
+				// ORs the residuals of the three orders at any sample `i`.
+				template <typename T>
+				inline void OrResiduals(const T* x, size_t i, uInt32* acc) {
+
+					const uInt32 a = (uInt32)(int32)x[i];
+					const uInt32 b = (uInt32)(int32)x[(i >= 1) ? i - 1 : 0];
+					const uInt32 c = (uInt32)(int32)x[(i >= 2) ? i - 2 : 0];
+
+					acc[0] |= ZigZag(a);
+					acc[1] |= ZigZag(a - b);
+					acc[2] |= ZigZag(a - 2u * b + c);
+				}
+
+#if NATIVE_X86
+				NATIVE_TARGET_SSE41 inline __m128i Load4(const int16* x) {
+					return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x)));
+				}
+
+				NATIVE_TARGET_SSE41 inline __m128i Load4(const int32* x) {
+					return _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+				}
+
+				NATIVE_TARGET_AVX2 inline __m256i Load8(const int16* x) {
+					return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+				}
+
+				NATIVE_TARGET_AVX2 inline __m256i Load8(const int32* x) {
+					return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+				}
+
+				// Vector loops start at sample 2, so `x + i - 2` is always
+				// inside the run; they return the first sample not done.
+
+				template <typename T, uInt32 Order>
+				NATIVE_TARGET_SSE41 size_t ResidualsSse41(const T* x, size_t count, uInt32* r) {
+
+					size_t i = 2;
+
+					for (; i + 4 <= count; i += 4) {
+
+						__m128i d = Load4(x + i);
+
+						if (Order >= 1) {
+							const __m128i b = Load4(x + i - 1);
+							if (Order == 1) {
+								d = _mm_sub_epi32(d, b);
+							}
+							else {
+								d = _mm_add_epi32(_mm_sub_epi32(d, _mm_add_epi32(b, b)), Load4(x + i - 2));
+							}
+						}
+
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(r + i),
+							_mm_xor_si128(_mm_slli_epi32(d, 1), _mm_srai_epi32(d, 31)));
+					}
+					return i;
+				}
+
+				template <typename T, uInt32 Order>
+				NATIVE_TARGET_AVX2 size_t ResidualsAvx2(const T* x, size_t count, uInt32* r) {
+
+					size_t i = 2;
+
+					for (; i + 8 <= count; i += 8) {
+
+						__m256i d = Load8(x + i);
+
+						if (Order >= 1) {
+							const __m256i b = Load8(x + i - 1);
+							if (Order == 1) {
+								d = _mm256_sub_epi32(d, b);
+							}
+							else {
+								d = _mm256_add_epi32(_mm256_sub_epi32(d, _mm256_add_epi32(b, b)),
+									Load8(x + i - 2));
+							}
+						}
+
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i),
+							_mm256_xor_si256(_mm256_slli_epi32(d, 1), _mm256_srai_epi32(d, 31)));
+					}
+					return i;
+				}
+
+				NATIVE_TARGET_SSE41 inline uInt32 OrLanes(__m128i v) {
+					v = _mm_or_si128(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+					v = _mm_or_si128(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+					return (uInt32)_mm_cvtsi128_si32(v);
+				}
+
+				NATIVE_TARGET_AVX2 inline uInt32 OrLanes(__m256i v) {
+					return OrLanes(_mm_or_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+				}
+
+				template <typename T>
+				NATIVE_TARGET_SSE41 size_t OrResidualsSse41(const T* x, size_t i, size_t end, uInt32* acc) {
+
+					__m128i o0 = _mm_setzero_si128();
+					__m128i o1 = _mm_setzero_si128();
+					__m128i o2 = _mm_setzero_si128();
+
+					for (; i + 4 <= end; i += 4) {
+
+						const __m128i a = Load4(x + i);
+						const __m128i b = Load4(x + i - 1);
+						const __m128i d1 = _mm_sub_epi32(a, b);
+						const __m128i d2 = _mm_add_epi32(_mm_sub_epi32(d1, b), Load4(x + i - 2));
+
+						o0 = _mm_or_si128(o0, _mm_xor_si128(_mm_slli_epi32(a, 1), _mm_srai_epi32(a, 31)));
+						o1 = _mm_or_si128(o1, _mm_xor_si128(_mm_slli_epi32(d1, 1), _mm_srai_epi32(d1, 31)));
+						o2 = _mm_or_si128(o2, _mm_xor_si128(_mm_slli_epi32(d2, 1), _mm_srai_epi32(d2, 31)));
+					}
+
+					acc[0] |= OrLanes(o0);
+					acc[1] |= OrLanes(o1);
+					acc[2] |= OrLanes(o2);
+					return i;
+				}
+
+				template <typename T>
+				NATIVE_TARGET_AVX2 size_t OrResidualsAvx2(const T* x, size_t i, size_t end, uInt32* acc) {
+
+					__m256i o0 = _mm256_setzero_si256();
+					__m256i o1 = _mm256_setzero_si256();
+					__m256i o2 = _mm256_setzero_si256();
+
+					for (; i + 8 <= end; i += 8) {
+
+						const __m256i a = Load8(x + i);
+						const __m256i b = Load8(x + i - 1);
+						const __m256i d1 = _mm256_sub_epi32(a, b);
+						const __m256i d2 = _mm256_add_epi32(_mm256_sub_epi32(d1, b), Load8(x + i - 2));
+
+						o0 = _mm256_or_si256(o0, _mm256_xor_si256(_mm256_slli_epi32(a, 1), _mm256_srai_epi32(a, 31)));
+						o1 = _mm256_or_si256(o1, _mm256_xor_si256(_mm256_slli_epi32(d1, 1), _mm256_srai_epi32(d1, 31)));
+						o2 = _mm256_or_si256(o2, _mm256_xor_si256(_mm256_slli_epi32(d2, 1), _mm256_srai_epi32(d2, 31)));
+					}
+
+					acc[0] |= OrLanes(o0);
+					acc[1] |= OrLanes(o1);
+					acc[2] |= OrLanes(o2);
+					return i;
+				}
+
+				NATIVE_TARGET_SSE41 uInt32 OrSse41(const uInt32* v, size_t count, size_t* done) {
+
+					__m128i acc = _mm_setzero_si128();
+					size_t i = 0;
+
+					for (; i + 4 <= count; i += 4) {
+						acc = _mm_or_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)));
+					}
+
+					*done = i;
+					return OrLanes(acc);
+				}
+
+				NATIVE_TARGET_AVX2 uInt32 OrAvx2(const uInt32* v, size_t count, size_t* done) {
+
+					__m256i acc = _mm256_setzero_si256();
+					size_t i = 0;
+
+					for (; i + 8 <= count; i += 8) {
+						acc = _mm256_or_si256(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)));
+					}
+
+					*done = i;
+					return OrLanes(acc);
+				}
+
+				// Shifts by 32 give 0 with the count-in-register forms, as
+				// the layout needs.
+
+				NATIVE_TARGET_SSE41 void PackSse41(const uInt32* values, uInt32 width, uInt32* packed) {
+
+					__m128i lo = _mm_setzero_si128();
+					__m128i hi = _mm_setzero_si128();
+					uInt32 bit = 0;
+
+					for (uInt32 row = 0; row < Rows; row++) {
+
+						const __m128i vlo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + row * Lanes));
+						const __m128i vhi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + row * Lanes + 4));
+						const __m128i shift = _mm_cvtsi32_si128((int)bit);
+
+						lo = _mm_or_si128(lo, _mm_sll_epi32(vlo, shift));
+						hi = _mm_or_si128(hi, _mm_sll_epi32(vhi, shift));
+						bit += width;
+
+						if (bit >= 32) {
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(packed), lo);
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 4), hi);
+							packed += Lanes;
+							bit -= 32;
+
+							const __m128i carry = _mm_cvtsi32_si128((int)(width - bit));
+							lo = _mm_srl_epi32(vlo, carry);
+							hi = _mm_srl_epi32(vhi, carry);
+						}
+					}
+				}
+
+				NATIVE_TARGET_AVX2 void PackAvx2(const uInt32* values, uInt32 width, uInt32* packed) {
+
+					__m256i acc = _mm256_setzero_si256();
+					uInt32 bit = 0;
+
+					for (uInt32 row = 0; row < Rows; row++) {
+
+						const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + row * Lanes));
+
+						acc = _mm256_or_si256(acc, _mm256_sll_epi32(v, _mm_cvtsi32_si128((int)bit)));
+						bit += width;
+
+						if (bit >= 32) {
+							_mm256_storeu_si256(reinterpret_cast<__m256i*>(packed), acc);
+							packed += Lanes;
+							bit -= 32;
+							acc = _mm256_srl_epi32(v, _mm_cvtsi32_si128((int)(width - bit)));
+						}
+					}
+				}
+
+				NATIVE_TARGET_SSE41 void UnpackSse41(const uInt32* packed, uInt32 width, uInt32* values) {
+
+					const __m128i mask = _mm_set1_epi32((width == 32) ? -1 : (int)((1u << width) - 1));
+					const __m128i* p = reinterpret_cast<const __m128i*>(packed);
+					__m128i lo = _mm_loadu_si128(p);
+					__m128i hi = _mm_loadu_si128(p + 1);
+					uInt32 bit = 0;
+
+					for (uInt32 row = 0; row < Rows; row++) {
+
+						const __m128i shift = _mm_cvtsi32_si128((int)bit);
+						__m128i vlo = _mm_srl_epi32(lo, shift);
+						__m128i vhi = _mm_srl_epi32(hi, shift);
+
+						if (bit + width >= 32) {
+
+							p += 2;
+							bit = bit + width - 32;
+
+							if (row + 1 < Rows) {
+								lo = _mm_loadu_si128(p);
+								hi = _mm_loadu_si128(p + 1);
+
+								if (bit != 0) {
+									const __m128i back = _mm_cvtsi32_si128((int)(width - bit));
+									vlo = _mm_or_si128(vlo, _mm_sll_epi32(lo, back));
+									vhi = _mm_or_si128(vhi, _mm_sll_epi32(hi, back));
+								}
+							}
+						}
+						else {
+							bit += width;
+						}
+
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(values + row * Lanes), _mm_and_si128(vlo, mask));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(values + row * Lanes + 4), _mm_and_si128(vhi, mask));
+					}
+				}
+
+				NATIVE_TARGET_AVX2 void UnpackAvx2(const uInt32* packed, uInt32 width, uInt32* values) {
+
+					const __m256i mask = _mm256_set1_epi32((width == 32) ? -1 : (int)((1u << width) - 1));
+					const __m256i* p = reinterpret_cast<const __m256i*>(packed);
+					__m256i cur = _mm256_loadu_si256(p);
+					uInt32 bit = 0;
+
+					for (uInt32 row = 0; row < Rows; row++) {
+
+						__m256i v = _mm256_srl_epi32(cur, _mm_cvtsi32_si128((int)bit));
+
+						if (bit + width >= 32) {
+
+							p++;
+							bit = bit + width - 32;
+
+							if (row + 1 < Rows) {
+								cur = _mm256_loadu_si256(p);
+
+								if (bit != 0) {
+									v = _mm256_or_si256(v, _mm256_sll_epi32(cur,
+										_mm_cvtsi32_si128((int)(width - bit))));
+								}
+							}
+						}
+						else {
+							bit += width;
+						}
+
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(values + row * Lanes), _mm256_and_si256(v, mask));
+					}
+				}
+#endif
+
+				template <typename T, uInt32 Order>
+				void ResidualsOf(const T* x, size_t count, uInt32* r) {
+
+					// History before the run is the first sample.
+					const uInt32 seed = (uInt32)(int32)x[0];
+					size_t i = 0;
+
+					for (; i < count && i < 2; i++) {
+						const uInt32 a = (uInt32)(int32)x[i];
+						const uInt32 b = (i >= 1) ? (uInt32)(int32)x[i - 1] : seed;
+						r[i] = (Order == 0) ? ZigZag(a)
+							: (Order == 1) ? ZigZag(a - b)
+							: ZigZag(a - 2u * b + seed);
+					}
+
+#if NATIVE_X86
+					if (count > 2) {
+						const SimdLevel level = ActiveSimdLevel();
+						if (level == SimdLevel::Avx2) {
+							i = ResidualsAvx2<T, Order>(x, count, r);
+						}
+						else if (level == SimdLevel::Sse41) {
+							i = ResidualsSse41<T, Order>(x, count, r);
+						}
+					}
+#endif
+					for (; i < count; i++) {
+						r[i] = ResidualAt<T, Order>(x, i);
+					}
+				}
+
+				template <typename T>
+				void ResidualsOf(const T* x, size_t count, uInt32 order, uInt32* r) {
+					switch (order) {
+					case 0: ResidualsOf<T, 0>(x, count, r); break;
+					case 1: ResidualsOf<T, 1>(x, count, r); break;
+					default: ResidualsOf<T, 2>(x, count, r); break;
+					}
+				}
+
+				template <typename T>
+				void PredictorWidthsOf(const T* x, size_t count, uInt8* widths) {
+
+					const size_t miniBlocks = CodecMiniBlocks(count);
+#if NATIVE_X86
+					const SimdLevel level = ActiveSimdLevel();
+#endif
+
+					for (size_t m = 0; m < miniBlocks; m++) {
+
+						const size_t end = std::min<size_t>((m + 1) * CodecMiniBlockValues, count);
+						uInt32 acc[3] = { 0, 0, 0 };
+						size_t i = m * CodecMiniBlockValues;
+
+						for (; i < end && i < 2; i++) {
+							OrResiduals(x, i, acc);
+						}
+#if NATIVE_X86
+						if (level == SimdLevel::Avx2) {
+							i = OrResidualsAvx2(x, i, end, acc);
+						}
+						else if (level == SimdLevel::Sse41) {
+							i = OrResidualsSse41(x, i, end, acc);
+						}
+#endif
+						for (; i < end; i++) {
+							OrResiduals(x, i, acc);
+						}
+
+						for (uInt32 order = 0; order < 3; order++) {
+							widths[order * miniBlocks + m] = (uInt8)HighestBitWidth(acc[order]);
+						}
+					}
+				}
+
+				template <typename T, uInt32 Order>
+				void RestoreOf(const uInt32* r, size_t count, int32* history, T* out, size_t stride) {
+
+					uInt32 h1 = (uInt32)history[0];
+					uInt32 h2 = (uInt32)history[1];
+
+					for (size_t i = 0; i < count; i++) {
+
+						const uInt32 d = UnZigZag(r[i]);
+						const uInt32 v = (Order == 0) ? d
+							: (Order == 1) ? h1 + d
+							: 2u * h1 - h2 + d;
+
+						h2 = h1;
+						h1 = v;
+						out[i * stride] = (T)(int32)v;
+					}
+
+					history[0] = (int32)h1;
+					history[1] = (int32)h2;
+				}
+
+				template <typename T>
+				void RestoreOf(const uInt32* r, size_t count, uInt32 order, int32* history,
+					T* out, size_t stride) {
+					switch (order) {
+					case 0: RestoreOf<T, 0>(r, count, history, out, stride); break;
+					case 1: RestoreOf<T, 1>(r, count, history, out, stride); break;
+					default: RestoreOf<T, 2>(r, count, history, out, stride); break;
+					}
+				}
+
+				void PackScalar(const uInt32* values, uInt32 width, uInt32* packed) {
+
+					for (uInt32 lane = 0; lane < Lanes; lane++) {
+
+						uInt64 acc = 0;
+						uInt32 bit = 0;
+						uInt32 word = 0;
+
+						for (uInt32 row = 0; row < Rows; row++) {
+							acc |= (uInt64)values[row * Lanes + lane] << bit;
+							bit += width;
+							if (bit >= 32) {
+								packed[word++ * Lanes + lane] = (uInt32)acc;
+								acc >>= 32;
+								bit -= 32;
+							}
+						}
+					}
+				}
+
+				void UnpackScalar(const uInt32* packed, uInt32 width, uInt32* values) {
+
+					const uInt64 mask = (width == 32) ? 0xFFFFFFFFull : ((1ull << width) - 1);
+
+					for (uInt32 lane = 0; lane < Lanes; lane++) {
+						for (uInt32 row = 0; row < Rows; row++) {
+
+							const uInt32 bit = row * width;
+							const uInt32 word = bit >> 5;
+							const uInt32 offset = bit & 31;
+
+							uInt64 pair = packed[word * Lanes + lane];
+							if (offset + width > 32) {
+								pair |= (uInt64)packed[(word + 1) * Lanes + lane] << 32;
+							}
+							values[row * Lanes + lane] = (uInt32)((pair >> offset) & mask);
+						}
+					}
+				}
+			}
+
+			void ComputeResiduals(const void* samples, size_t count, uInt32 sampleBytes,
+				uInt32 order, uInt32* residuals) {
+
+				if (count == 0) {
+					return;
+				}
+
+				if (sampleBytes == 2) {
+					ResidualsOf(static_cast<const int16*>(samples), count, order, residuals);
+				}
+				else {
+					ResidualsOf(static_cast<const int32*>(samples), count, order, residuals);
+				}
+			}
+
+			void PredictorWidths(const void* samples, size_t count, uInt32 sampleBytes,
+				uInt8* widths) {
+
+				if (sampleBytes == 2) {
+					PredictorWidthsOf(static_cast<const int16*>(samples), count, widths);
+				}
+				else {
+					PredictorWidthsOf(static_cast<const int32*>(samples), count, widths);
+				}
+			}
+
+			void RestoreSamples(const uInt32* residuals, size_t count, uInt32 order,
+				int32* history, uInt32 sampleBytes, void* samples, size_t stride) {
+
+				if (sampleBytes == 2) {
+					RestoreOf(residuals, count, order, history, static_cast<int16*>(samples), stride);
+				}
+				else {
+					RestoreOf(residuals, count, order, history, static_cast<int32*>(samples), stride);
+				}
+			}
+
+			uInt32 BitWidth(const uInt32* values, size_t count) {
+
+				uInt32 acc = 0;
+				size_t i = 0;
+
+#if NATIVE_X86
+				const SimdLevel level = ActiveSimdLevel();
+				if (level == SimdLevel::Avx2) {
+					acc = OrAvx2(values, count, &i);
+				}
+				else if (level == SimdLevel::Sse41) {
+					acc = OrSse41(values, count, &i);
+				}
+#endif
+				for (; i < count; i++) {
+					acc |= values[i];
+				}
+				return HighestBitWidth(acc);
+			}
+
+			void PackMiniBlock(const uInt32* values, uInt32 width, uInt32* packed) {
+
+				if (width == 0) {
+					return;
+				}
+
+#if NATIVE_X86
+				const SimdLevel level = ActiveSimdLevel();
+				if (level == SimdLevel::Avx2) {
+					PackAvx2(values, width, packed);
+					return;
+				}
+				if (level == SimdLevel::Sse41) {
+					PackSse41(values, width, packed);
+					return;
+				}
+#endif
+				PackScalar(values, width, packed);
+			}
+
+			void UnpackMiniBlock(const uInt32* packed, uInt32 width, uInt32* values) {
+
+				if (width == 0) {
+					std::memset(values, 0, CodecMiniBlockValues * sizeof(uInt32));
+					return;
+				}
+
+#if NATIVE_X86
+				const SimdLevel level = ActiveSimdLevel();
+				if (level == SimdLevel::Avx2) {
+					UnpackAvx2(packed, width, values);
+					return;
+				}
+				if (level == SimdLevel::Sse41) {
+					UnpackSse41(packed, width, values);
+					return;
+				}
+#endif
+				UnpackScalar(packed, width, values);
+			}
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized stages of the sample codec (see CodecFormat.h): prediction
+* residuals with zigzag coding, and bit packing of mini-blocks in the
+* eight-lane layout. Residuals are computed with wrapping 32-bit
+* arithmetic, so the codec is lossless for every input, including `I32`
+* codes whose differences overflow.
+*
+* Every SIMD level produces the same bytes; the level only changes the
+* speed.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Zigzag-coded residuals of `count` samples.
+			*
+			* @param[in] samples `int16` (`sampleBytes` 2) or `int32` (4)
+			*            codes of one channel, consecutive.
+			* @param[in] order 0, 1 or 2; see `CodecPredictor`. The history
+			*            before the first sample is the first sample.
+			* @param[out] residuals `count` values.
+			*/
+			void ComputeResiduals(const void* samples, size_t count, uInt32 sampleBytes,
+				uInt32 order, uInt32* residuals);
+
+			/**
+			* @brief Bit widths of the residuals of the three predictors for
+			*        every mini-block, in one pass and without storing them.
+			*
+			* @param[out] widths `3 * CodecMiniBlocks(count)` bytes: the
+			*             widths of order 0, then 1, then 2.
+			*/
+			void PredictorWidths(const void* samples, size_t count, uInt32 sampleBytes,
+				uInt8* widths);
+
+			/**
+			* @brief Inverse of `ComputeResiduals`, in pieces.
+			*
+			* @param[in,out] history Last two samples before `residuals[0]`,
+			*                most recent first; both the seed on the first
+			*                call. Updated for the next piece.
+			* @param[out] samples Receives sample `i` at `samples[i * stride]`.
+			*/
+			void RestoreSamples(const uInt32* residuals, size_t count, uInt32 order,
+				int32* history, uInt32 sampleBytes, void* samples, size_t stride);
+
+			/**
+			* @brief Bits needed by the largest of `count` values, 0 to 32.
+			*/
+			uInt32 BitWidth(const uInt32* values, size_t count);
+
+			/**
+			* @brief Packs `CodecMiniBlockValues` values below `2^width` into
+			*        `width * 8` words.
+			*/
+			void PackMiniBlock(const uInt32* values, uInt32 width, uInt32* packed);
+
+			/**
+			* @brief Inverse of `PackMiniBlock`.
+			*/
+			void UnpackMiniBlock(const uInt32* packed, uInt32 width, uInt32* values);
+		}
+	}
+}
@@ -0,0 +1,391 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Native only: uses <atomic> and must not be included from code compiled
+* with /clr. Managed wrappers reach the controllers through ControllerCore.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "AlignedMemory.h"
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Hands the latest value of `T` from one writer thread to one
+			*        reader thread, wait-free on both sides.
+			*
+			* Three slots rotate between the writer, the reader and a middle
+			* slot. The writer fills its slot and swaps it with the middle one;
+			* the reader swaps the middle slot with its own when it was
+			* refreshed. Neither side ever waits or sees a half-written value,
+			* and intermediate values the reader did not pick up are dropped.
+			*/
+			template <typename T>
+			class TripleBuffer {
+
+			public:
+				explicit TripleBuffer(const T& initial) :
+					_middle(1), _back(2), _front(0) {
+
+					for (Slot& slot : _slots) {
+						slot.value = initial;
+					}
+				}
+
+				/**
+				* @brief The slot of the writer, to be filled completely before
+				*        `Publish`: it holds an older value.
+				*/
+				T& WriteSlot() {
+					return _slots[_back].value;
+				}
+
+				void Publish() {
+					_back = _middle.exchange(_back | Fresh, std::memory_order_acq_rel) & IndexMask;
+				}
+
+				/**
+				* @brief Takes the last published value, if any.
+				*
+				* @return `true` if `Current` changed.
+				*/
+				bool Update() {
+
+					if ((_middle.load(std::memory_order_relaxed) & Fresh) == 0) {
+						return false;
+					}
+					_front = _middle.exchange(_front, std::memory_order_acq_rel) & IndexMask;
+					return true;
+				}
+
+				/**
+				* @brief The value of the reader.
+				*/
+				const T& Current() const {
+					return _slots[_front].value;
+				}
+
+			private:
+				static constexpr uint32_t Fresh = 4;
+				static constexpr uint32_t IndexMask = 3;
+
+				struct alignas(CacheLineSize) Slot {
+					T value;
+				};
+
+				Slot _slots[3];
+				alignas(CacheLineSize) std::atomic<uint32_t> _middle;
+				alignas(CacheLineSize) uint32_t _back;
+				alignas(CacheLineSize) uint32_t _front;
+			};
+
+			/**
+			* @brief Parameters of `PidController`, one entry per channel.
+			*/
+			template <size_t N>
+			struct PidParameters {
+				float64 kp[N];
+				float64 ki[N];
+				float64 kd[N];
+				/** Time constant of the derivative filter, in seconds; `0`
+				*   leaves the derivative unfiltered. */
+				float64 derivativeTime[N];
+				/** Anti-windup back-calculation gain, in 1/s: the integrator
+				*   is pulled back by `trackingGain * (saturated - unsaturated)`.
+				*   `0` leaves the integrator unbounded. */
+				float64 trackingGain[N];
+				float64 outputMin[N];
+				float64 outputMax[N];
+				float64 setpoint[N];
+			};
+
+			/**
+			* @brief `N` independent PID loops with a filtered derivative on the
+			*        measurement and back-calculation anti-windup.
+			*
+			* For channel k, with `e = setpoint - y`:
+			*
+			*     v = kp e + I + D
+			*     u = clamp(v, outputMin, outputMax)
+			*     I += ki e dt + trackingGain (u - v) dt
+			*     D = (Tf D - kd (y - y[n-1])) / (Tf + dt)
+			*
+			* The derivative acts on the measurement, so setpoint steps do not
+			* kick the output. Every step is a fixed-length loop over the
+			* channels, without branches, that the compiler vectorizes.
+			*/
+			template <size_t N>
+			class PidController {
+
+			public:
+				typedef PidParameters<N> Parameters;
+
+				PidController() {
+					Reset();
+				}
+
+				void Reset() {
+					for (size_t k = 0; k < N; k++) {
+						_integral[k] = 0.0;
+						_derivative[k] = 0.0;
+						_previous[k] = 0.0;
+					}
+					_primed = false;
+				}
+
+				/**
+				* @brief Derives the per-step coefficients; called when the
+				*        parameters or the period change.
+				*/
+				void Prepare(const Parameters& p, float64 dt) {
+					for (size_t k = 0; k < N; k++) {
+						const float64 tf = p.derivativeTime[k];
+						_derivativeDecay[k] = tf / (tf + dt);
+						_derivativeGain[k] = p.kd[k] / (tf + dt);
+						_integralGain[k] = p.ki[k] * dt;
+						_trackingGain[k] = p.trackingGain[k] * dt;
+					}
+				}
+
+				void Step(const Parameters& p, const float64* y, float64* u) {
+
+					// No derivative from the state before the first sample.
+					if (!_primed) {
+						for (size_t k = 0; k < N; k++) {
+							_previous[k] = y[k];
+						}
+						_primed = true;
+					}
+
+					for (size_t k = 0; k < N; k++) {
+
+						const float64 e = p.setpoint[k] - y[k];
+						const float64 d = _derivativeDecay[k] * _derivative[k]
+							- _derivativeGain[k] * (y[k] - _previous[k]);
+						const float64 v = p.kp[k] * e + _integral[k] + d;
+						const float64 low = (v < p.outputMin[k]) ? p.outputMin[k] : v;
+						const float64 out = (low > p.outputMax[k]) ? p.outputMax[k] : low;
+
+						_integral[k] += _integralGain[k] * e + _trackingGain[k] * (out - v);
+						_derivative[k] = d;
+						_previous[k] = y[k];
+						u[k] = out;
+					}
+				}
+
+			private:
+				alignas(CacheLineSize) float64 _integral[N];
+				float64 _derivative[N];
+				float64 _previous[N];
+				float64 _derivativeDecay[N];
+				float64 _derivativeGain[N];
+				float64 _integralGain[N];
+				float64 _trackingGain[N];
+				bool _primed;
+			};
+
+			/**
+			* @brief Parameters of `LeadLagController`, one entry per channel.
+			*/
+			template <size_t N>
+			struct LeadLagParameters {
+				float64 gain[N];
+				/** Time constant of the zero, in seconds. */
+				float64 leadTime[N];
+				/** Time constant of the pole, in seconds. */
+				float64 lagTime[N];
+				float64 outputMin[N];
+				float64 outputMax[N];
+				float64 setpoint[N];
+			};
+
+			/**
+			* @brief `N` lead-lag compensators
+			*        `gain (leadTime s + 1) / (lagTime s + 1)` acting on
+			*        `setpoint - y`, discretized with the bilinear transform.
+			*
+			* The output is clamped, and the clamped value is what the next
+			* step remembers, so the filter does not wind up.
+			*/
+			template <size_t N>
+			class LeadLagController {
+
+			public:
+				typedef LeadLagParameters<N> Parameters;
+
+				LeadLagController() {
+					Reset();
+				}
+
+				void Reset() {
+					for (size_t k = 0; k < N; k++) {
+						_error[k] = 0.0;
+						_output[k] = 0.0;
+					}
+				}
+
+				void Prepare(const Parameters& p, float64 dt) {
+					for (size_t k = 0; k < N; k++) {
+						const float64 a0 = 2.0 * p.lagTime[k] + dt;
+						_b0[k] = p.gain[k] * (2.0 * p.leadTime[k] + dt) / a0;
+						_b1[k] = p.gain[k] * (dt - 2.0 * p.leadTime[k]) / a0;
+						_a1[k] = (dt - 2.0 * p.lagTime[k]) / a0;
+					}
+				}
+
+				void Step(const Parameters& p, const float64* y, float64* u) {
+
+					for (size_t k = 0; k < N; k++) {
+
+						const float64 e = p.setpoint[k] - y[k];
+						const float64 v = _b0[k] * e + _b1[k] * _error[k] - _a1[k] * _output[k];
+						const float64 low = (v < p.outputMin[k]) ? p.outputMin[k] : v;
+						const float64 out = (low > p.outputMax[k]) ? p.outputMax[k] : low;
+
+						_error[k] = e;
+						_output[k] = out;
+						u[k] = out;
+					}
+				}
+
+			private:
+				alignas(CacheLineSize) float64 _error[N];
+				float64 _output[N];
+				float64 _b0[N];
+				float64 _b1[N];
+				float64 _a1[N];
+			};
+
+			/**
+			* @brief Parameters of `StateSpaceController`. The matrices are
+			*        stored column by column, so that the products run down
+			*        contiguous columns.
+			*/
+			template <size_t NX, size_t NI, size_t NO>
+			struct StateSpaceParameters {
+				/** `a[c][r]` is A(r, c); NX x NX. */
+				float64 a[NX][NX];
+				/** NX x NI. */
+				float64 b[NI][NX];
+				/** NO x NX. */
+				float64 c[NX][NO];
+				/** NO x NI. */
+				float64 d[NI][NO];
+				float64 setpoint[NI];
+				float64 outputMin[NO];
+				float64 outputMax[NO];
+			};
+
+			/**
+			* @brief Discrete state-space controller with `NX` states, `NI`
+			*        measured inputs and `NO` outputs:
+			*
+			*     e = setpoint - y
+			*     u = clamp(C x + D e, outputMin, outputMax)
+			*     x = A x + B e
+			*/
+			template <size_t NX, size_t NI, size_t NO>
+			class StateSpaceController {
+
+			public:
+				typedef StateSpaceParameters<NX, NI, NO> Parameters;
+
+				StateSpaceController() {
+					Reset();
+				}
+
+				void Reset() {
+					for (size_t r = 0; r < NX; r++) {
+						_state[r] = 0.0;
+					}
+				}
+
+				// A, B, C and D are given for the loop period already.
+				void Prepare(const Parameters& /*p*/, float64 /*dt*/) {}
+
+				void Step(const Parameters& p, const float64* y, float64* u) {
+
+					float64 e[NI];
+					float64 out[NO];
+					float64 next[NX];
+
+					for (size_t i = 0; i < NI; i++) {
+						e[i] = p.setpoint[i] - y[i];
+					}
+
+					for (size_t o = 0; o < NO; o++) {
+						out[o] = 0.0;
+					}
+					for (size_t c = 0; c < NX; c++) {
+						for (size_t o = 0; o < NO; o++) {
+							out[o] += p.c[c][o] * _state[c];
+						}
+					}
+					for (size_t i = 0; i < NI; i++) {
+						for (size_t o = 0; o < NO; o++) {
+							out[o] += p.d[i][o] * e[i];
+						}
+					}
+
+					for (size_t r = 0; r < NX; r++) {
+						next[r] = 0.0;
+					}
+					for (size_t c = 0; c < NX; c++) {
+						for (size_t r = 0; r < NX; r++) {
+							next[r] += p.a[c][r] * _state[c];
+						}
+					}
+					for (size_t i = 0; i < NI; i++) {
+						for (size_t r = 0; r < NX; r++) {
+							next[r] += p.b[i][r] * e[i];
+						}
+					}
+
+					for (size_t r = 0; r < NX; r++) {
+						_state[r] = next[r];
+					}
+
+					for (size_t o = 0; o < NO; o++) {
+						const float64 low = (out[o] < p.outputMin[o]) ? p.outputMin[o] : out[o];
+						u[o] = (low > p.outputMax[o]) ? p.outputMax[o] : low;
+					}
+				}
+
+				const float64* State() const {
+					return _state;
+				}
+
+			private:
+				alignas(CacheLineSize) float64 _state[NX];
+			};
+		}
+	}
+}
@@ -0,0 +1,549 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ControlLoopCore.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "HostClock.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// The wait reports a missed sample clock as a warning, or as
+				// an error unless the task converts late errors to warnings.
+				bool IsLateStatus(int32 status) {
+					return status == DAQmxWarningWaitForNextSampClkDetectedMissedSampClk
+						|| status == DAQmxErrorWaitForNextSampClkDetectedMissedSampClk
+						|| status == DAQmxErrorWaitForNextSampClkDetected3OrMoreSampClks
+						|| status == DAQmxErrorWaitForNextSampleClockOrReadDetected3OrMoreMissedSampClks;
+				}
+
+				void UpdateMax(std::atomic<uInt64>& max, uInt64 value) {
+					if (value > max.load(std::memory_order_relaxed)) {
+						max.store(value, std::memory_order_relaxed);
+					}
+				}
+			}
+
+			struct ControlLoopCore::Impl {
+
+				ControlLoopConfig config;
+				TaskHandle input;
+				TaskHandle output;
+				TaskHandle digitalOutput;
+				std::atomic<bool> attached;
+
+				ControlLawFunction law;
+				void* lawContext;
+
+				// One scan each; written by the loop thread only while it runs.
+				float64* inputs;
+				float64* outputs;
+				uInt8* lines;
+				std::vector<float64> initialOutputs;
+
+				std::thread loop;
+				std::atomic<bool> running;
+				std::atomic<bool> active;
+
+				alignas(CacheLineSize) std::atomic<uInt64> iterations;
+				std::atomic<uInt64> counted;
+				std::atomic<uInt64> lateIterations;
+				std::atomic<uInt64> overruns;
+				std::atomic<uInt64> maxLoopNs;
+				std::atomic<uInt64> totalLoopNs;
+				std::atomic<uInt64> maxPeriodNs;
+				std::atomic<int32> lastError;
+				std::unique_ptr<std::atomic<uInt64>[]> histogram;
+
+				Impl() :
+					config(DefaultControlLoopConfig()), input(NULL), output(NULL), digitalOutput(NULL),
+					attached(false), law(nullptr), lawContext(nullptr), inputs(nullptr),
+					outputs(nullptr), lines(nullptr),
+					running(false), active(false), iterations(0), counted(0), lateIterations(0),
+					overruns(0), maxLoopNs(0), totalLoopNs(0), maxPeriodNs(0), lastError(0) {}
+
+				~Impl() {
+					Free();
+				}
+
+				void Free() {
+					AlignedFree(inputs);
+					AlignedFree(outputs);
+					AlignedFree(lines);
+					inputs = nullptr;
+					outputs = nullptr;
+					lines = nullptr;
+					histogram.reset();
+				}
+
+				void ClearStatistics() {
+					iterations.store(0);
+					counted.store(0);
+					lateIterations.store(0);
+					overruns.store(0);
+					maxLoopNs.store(0);
+					totalLoopNs.store(0);
+					maxPeriodNs.store(0);
+					for (uInt32 k = 0; k < config.histogramBins; k++) {
+						histogram[k].store(0, std::memory_order_relaxed);
+					}
+				}
+
+				int32 StopOutputs() {
+
+					int32 r = (output != NULL) ? DAQmxStopTask(output) : 0;
+
+					if (digitalOutput != NULL) {
+						int32 d = DAQmxStopTask(digitalOutput);
+						r = (r < 0) ? r : d;
+					}
+					return r;
+				}
+
+				void Fail(int32 status) {
+					lastError.store(status, std::memory_order_relaxed);
+				}
+
+				void Run() {
+
+					const uInt32 inputChannels = config.inputChannels;
+					const uInt32 outputChannels = config.outputChannels;
+					const uInt32 digitalLines = config.digitalLines;
+					const float64 dt = 1.0 / config.sampleRate;
+					const uInt64 periodNs = (uInt64)(1e9 * dt);
+					const uInt64 binNs = config.histogramBinNs;
+					const uInt64 lastBin = config.histogramBins - 1;
+					const float64 timeout = config.timeout;
+
+					uInt32 lateInRow = 0;
+					int64 previousWake = 0;
+
+					while (running.load(std::memory_order_acquire)) {
+
+						bool32 isLate = 0;
+						int32 status = DAQmxWaitForNextSampleClock(input, timeout, &isLate);
+						const int64 wake = HostMonotonicNs();
+
+						const bool late = isLate != 0 || IsLateStatus(status);
+
+						if (status < 0 && !IsLateStatus(status)) {
+							Fail(status);
+							break;
+						}
+
+						int32 read = 0;
+						status = DAQmxReadAnalogF64(input, 1, timeout, DAQmx_Val_GroupByScanNumber,
+							inputs, inputChannels, &read, NULL);
+
+						if (status < 0) {
+							Fail(status);
+							break;
+						}
+
+						if (law != nullptr) {
+							status = law(lawContext, inputs, inputChannels, outputs,
+								outputChannels + digitalLines, dt);
+							if (status < 0) {
+								Fail(status);
+								break;
+							}
+						}
+
+						if (output != NULL) {
+							int32 written = 0;
+							status = DAQmxWriteAnalogF64(output, 1, 0, timeout,
+								DAQmx_Val_GroupByScanNumber, outputs, &written, NULL);
+
+							if (status < 0) {
+								Fail(status);
+								break;
+							}
+						}
+
+						if (digitalOutput != NULL) {
+
+							for (uInt32 line = 0; line < digitalLines; line++) {
+								lines[line] = (outputs[outputChannels + line] > 0.5) ? 1 : 0;
+							}
+
+							int32 written = 0;
+							status = DAQmxWriteDigitalLines(digitalOutput, 1, 0, timeout,
+								DAQmx_Val_GroupByChannel, lines, &written, NULL);
+
+							if (status < 0) {
+								Fail(status);
+								break;
+							}
+						}
+
+						const int64 done = HostMonotonicNs();
+						const uInt64 n = iterations.fetch_add(1, std::memory_order_relaxed) + 1;
+
+						lateInRow = late ? lateInRow + 1 : 0;
+
+						if (n > config.warmupIterations) {
+
+							const uInt64 loopNs = (uInt64)(done - wake);
+							const uInt64 bin = loopNs / binNs;
+
+							histogram[(bin < lastBin) ? bin : lastBin].fetch_add(1, std::memory_order_relaxed);
+							counted.fetch_add(1, std::memory_order_relaxed);
+							totalLoopNs.fetch_add(loopNs, std::memory_order_relaxed);
+							UpdateMax(maxLoopNs, loopNs);
+
+							if (previousWake != 0) {
+								UpdateMax(maxPeriodNs, (uInt64)(wake - previousWake));
+							}
+							if (late) {
+								lateIterations.fetch_add(1, std::memory_order_relaxed);
+							}
+							if (loopNs > periodNs) {
+								overruns.fetch_add(1, std::memory_order_relaxed);
+							}
+							if (config.maxConsecutiveLate != 0 && lateInRow >= config.maxConsecutiveLate) {
+								Fail(DAQmxErrorWaitForNextSampClkDetectedMissedSampClk);
+								break;
+							}
+						}
+						previousWake = wake;
+					}
+
+					// Stopped by an error: nothing is left generating behind it.
+					if (lastError.load(std::memory_order_relaxed) != 0) {
+						DAQmxStopTask(input);
+						StopOutputs();
+					}
+
+					active.store(false, std::memory_order_release);
+				}
+			};
+
+			ControlLoopCore::ControlLoopCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			ControlLoopCore::~ControlLoopCore() {
+				Detach();
+				delete _impl;
+				_impl = nullptr;
+			}
+
+			int32 ControlLoopCore::Attach(TaskHandle input, TaskHandle output,
+				const ControlLoopConfig& config) {
+
+				return Attach(input, output, NULL, config);
+			}
+
+			int32 ControlLoopCore::Attach(TaskHandle input, TaskHandle output,
+				TaskHandle digitalOutput, const ControlLoopConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.attached.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				if (input == NULL || config.inputChannels == 0
+					|| (output == NULL) != (config.outputChannels == 0)
+					|| (digitalOutput == NULL) != (config.digitalLines == 0)
+					|| !(config.sampleRate > 0.0) || config.histogramBins == 0
+					|| config.histogramBinNs == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				impl.Free();
+				impl.config = config;
+				impl.inputs = static_cast<float64*>(AlignedAlloc(config.inputChannels * sizeof(float64)));
+				impl.outputs = static_cast<float64*>(AlignedAlloc(
+					(config.outputChannels + config.digitalLines + 1) * sizeof(float64)));
+				impl.lines = static_cast<uInt8*>(AlignedAlloc(config.digitalLines + 1));
+				impl.histogram.reset(new (std::nothrow) std::atomic<uInt64>[config.histogramBins]);
+
+				if (impl.inputs == nullptr || impl.outputs == nullptr || impl.lines == nullptr
+					|| !impl.histogram) {
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				try {
+					impl.initialOutputs.assign(config.outputChannels + config.digitalLines, 0.0);
+				}
+				catch (const std::bad_alloc&) {
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.ClearStatistics();
+				impl.lastError.store(0);
+				impl.input = input;
+				impl.output = output;
+				impl.digitalOutput = digitalOutput;
+				impl.attached.store(true);
+				return NativeSuccess;
+			}
+
+			int32 ControlLoopCore::Detach() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return 0;
+				}
+
+				Impl& impl = *_impl;
+				int32 r = Stop();
+
+				if (impl.config.ownsTasks) {
+					int32 c = DAQmxClearTask(impl.input);
+					r = (r < 0) ? r : c;
+
+					if (impl.output != NULL) {
+						c = DAQmxClearTask(impl.output);
+						r = (r < 0) ? r : c;
+					}
+
+					if (impl.digitalOutput != NULL) {
+						c = DAQmxClearTask(impl.digitalOutput);
+						r = (r < 0) ? r : c;
+					}
+				}
+
+				impl.attached.store(false);
+				impl.input = NULL;
+				impl.output = NULL;
+				impl.digitalOutput = NULL;
+				return r;
+			}
+
+			int32 ControlLoopCore::SetControlLaw(ControlLawFunction law, void* context) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (_impl->active.load(std::memory_order_acquire)) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				_impl->law = law;
+				_impl->lawContext = context;
+				return NativeSuccess;
+			}
+
+			int32 ControlLoopCore::SetInitialOutputs(const float64* outputs, uInt32 count) {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.active.load(std::memory_order_acquire)) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (outputs == nullptr || count != impl.config.outputChannels + impl.config.digitalLines) {
+					return NativeErrorInvalidArgument;
+				}
+
+				impl.initialOutputs.assign(outputs, outputs + count);
+				return NativeSuccess;
+			}
+
+			int32 ControlLoopCore::Start() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.active.load(std::memory_order_acquire)) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				// The thread of a loop stopped by an error, which stopped the
+				// tasks on its way out.
+				impl.running.store(false);
+				if (impl.loop.joinable()) {
+					impl.loop.join();
+				}
+
+				for (size_t ch = 0; ch < impl.initialOutputs.size(); ch++) {
+					impl.outputs[ch] = impl.initialOutputs[ch];
+				}
+
+				impl.ClearStatistics();
+				impl.lastError.store(0);
+
+				int32 r = (impl.output != NULL) ? DAQmxStartTask(impl.output) : 0;
+
+				if (r >= 0 && impl.digitalOutput != NULL) {
+					int32 d = DAQmxStartTask(impl.digitalOutput);
+					r = (d != 0) ? d : r;
+				}
+
+				if (r < 0) {
+					impl.StopOutputs();
+					return r;
+				}
+
+				int32 s = DAQmxStartTask(impl.input);
+
+				if (s < 0) {
+					impl.StopOutputs();
+					return s;
+				}
+
+				impl.running.store(true, std::memory_order_release);
+				impl.active.store(true, std::memory_order_release);
+
+				try {
+					impl.loop = std::thread(&Impl::Run, &impl);
+				}
+				catch (const std::system_error&) {
+					impl.running.store(false);
+					impl.active.store(false);
+					DAQmxStopTask(impl.input);
+					impl.StopOutputs();
+					return NativeErrorOutOfMemory;
+				}
+
+				return (r != 0) ? r : s;
+			}
+
+			int32 ControlLoopCore::Stop() {
+
+				if (_impl == nullptr || !_impl->attached.load()) {
+					return NativeErrorNotAttached;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.running.exchange(false)) {
+					return 0;
+				}
+
+				// The loop sees the flag after its current wait, at most one
+				// sample clock period or `timeout` later.
+				if (impl.loop.joinable()) {
+					impl.loop.join();
+				}
+
+				int32 r = DAQmxStopTask(impl.input);
+				int32 o = impl.StopOutputs();
+				return (r < 0) ? r : o;
+			}
+
+			bool ControlLoopCore::IsRunning() const {
+				return _impl != nullptr && _impl->active.load(std::memory_order_acquire);
+			}
+
+			ControlLoopCounters ControlLoopCore::Counters() const {
+
+				ControlLoopCounters counters = {};
+
+				if (_impl != nullptr) {
+					const uInt64 counted = _impl->counted.load(std::memory_order_relaxed);
+					counters.iterations = _impl->iterations.load(std::memory_order_relaxed);
+					counters.lateIterations = _impl->lateIterations.load(std::memory_order_relaxed);
+					counters.overruns = _impl->overruns.load(std::memory_order_relaxed);
+					counters.maxLoopNs = _impl->maxLoopNs.load(std::memory_order_relaxed);
+					counters.meanLoopNs = (counted != 0)
+						? _impl->totalLoopNs.load(std::memory_order_relaxed) / counted : 0;
+					counters.maxPeriodNs = _impl->maxPeriodNs.load(std::memory_order_relaxed);
+					counters.lastError = _impl->lastError.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			size_t ControlLoopCore::ReadHistogram(uInt64* bins, size_t capacity) const {
+
+				if (_impl == nullptr || !_impl->histogram || bins == nullptr) {
+					return 0;
+				}
+
+				const size_t n = (capacity < _impl->config.histogramBins)
+					? capacity : _impl->config.histogramBins;
+
+				for (size_t k = 0; k < n; k++) {
+					bins[k] = _impl->histogram[k].load(std::memory_order_relaxed);
+				}
+				return n;
+			}
+
+			uInt64 ControlLoopCore::LoopTimePercentile(float64 fraction) const {
+
+				if (_impl == nullptr || !_impl->histogram) {
+					return 0;
+				}
+
+				const Impl& impl = *_impl;
+				uInt64 total = 0;
+
+				for (uInt32 k = 0; k < impl.config.histogramBins; k++) {
+					total += impl.histogram[k].load(std::memory_order_relaxed);
+				}
+
+				if (total == 0) {
+					return 0;
+				}
+
+				const float64 clamped = (fraction < 0.0) ? 0.0 : (fraction > 1.0) ? 1.0 : fraction;
+				const uInt64 rank = (uInt64)(clamped * (float64)(total - 1)) + 1;
+				uInt64 seen = 0;
+
+				for (uInt32 k = 0; k < impl.config.histogramBins; k++) {
+					seen += impl.histogram[k].load(std::memory_order_relaxed);
+					if (seen >= rank) {
+						return (uInt64)(k + 1) * impl.config.histogramBinNs;
+					}
+				}
+				return (uInt64)impl.config.histogramBins * impl.config.histogramBinNs;
+			}
+
+			void ControlLoopCore::ResetStatistics() {
+
+				if (_impl != nullptr && _impl->histogram) {
+					_impl->ClearStatistics();
+				}
+			}
+
+			const ControlLoopConfig& ControlLoopCore::Config() const {
+				return _impl->config;
+			}
+		}
+	}
+}
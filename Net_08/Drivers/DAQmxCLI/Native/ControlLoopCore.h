@@ -0,0 +1,248 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the hardware-timed single-point control loop. Safe to include
+* from code compiled with /clr; the loop thread and the statistics live in
+* ControlLoopCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief A control law, called once per sample clock on the loop
+			*        thread.
+			*
+			* @param[in] context The pointer passed to `SetControlLaw`.
+			* @param[in] inputs One sample of every input channel.
+			* @param[out] outputs One sample of every analog output channel,
+			*             in volts, then one value of every digital line,
+			*             driven high above 0.5; holds the previous outputs
+			*             on entry.
+			* @param[in] dt Sample clock period, in seconds.
+			*
+			* @return `0`, or a negative status that stops the loop.
+			*/
+			typedef int32 (*ControlLawFunction)(void* context,
+				const float64* inputs, uInt32 inputCount,
+				float64* outputs, uInt32 outputCount, float64 dt);
+
+			/**
+			* @brief Settings of a `ControlLoopCore`.
+			*/
+			struct ControlLoopConfig {
+
+				/** Channels of the input task. */
+				uInt32 inputChannels;
+
+				/** Channels of the output task; 0 without one. */
+				uInt32 outputChannels;
+
+				/** Lines of the digital output task; 0 without one. */
+				uInt32 digitalLines;
+
+				/** Sample clock rate of the tasks, in Hz. */
+				float64 sampleRate;
+
+				/** Timeout, in seconds, of the wait, the read and the write. */
+				float64 timeout;
+
+				/** Bins of the loop-time histogram; the last one also counts
+				*   every longer iteration. */
+				uInt32 histogramBins;
+
+				/** Width of a histogram bin, in nanoseconds. */
+				uInt32 histogramBinNs;
+
+				/** First iterations kept out of the statistics, while caches
+				*   and the scheduler settle. */
+				uInt32 warmupIterations;
+
+				/** Late iterations in a row that stop the loop; `0` never
+				*   stops it. */
+				uInt32 maxConsecutiveLate;
+
+				/** If `true`, the loop clears the tasks when it is detached. */
+				bool ownsTasks;
+			};
+
+			inline ControlLoopConfig DefaultControlLoopConfig() {
+
+				ControlLoopConfig config;
+				config.inputChannels = 1;
+				config.outputChannels = 1;
+				config.digitalLines = 0;
+				config.sampleRate = 10000.0;
+				config.timeout = 1.0;
+				config.histogramBins = 1000;
+				config.histogramBinNs = 1000;
+				config.warmupIterations = 100;
+				config.maxConsecutiveLate = 0;
+				config.ownsTasks = false;
+				return config;
+			}
+
+			/**
+			* @brief Counters of the loop. Read without locking.
+			*/
+			struct ControlLoopCounters {
+				uInt64 iterations;
+				/** Iterations after which the driver reported a missed
+				*   sample clock. */
+				uInt64 lateIterations;
+				/** Iterations whose loop time exceeded the clock period. */
+				uInt64 overruns;
+				/** Longest and mean time from the sample clock to the end of
+				*   the write, in nanoseconds. */
+				uInt64 maxLoopNs;
+				uInt64 meanLoopNs;
+				/** Longest time between two wake-ups, in nanoseconds. */
+				uInt64 maxPeriodNs;
+				/** Status that stopped the loop, `0` while it runs. */
+				int32 lastError;
+			};
+
+			/**
+			* @brief Runs a closed control loop on a hardware-timed single-point
+			*        input task and, optionally, an analog and a digital
+			*        output task.
+			*
+			* Every iteration of the loop thread waits for the next sample
+			* clock with `DAQmxWaitForNextSampleClock` on the input task, reads
+			* one sample per input channel, calls the control law, and writes
+			* one sample per output channel and digital line. No allocation, lock or managed
+			* code is on that path, so the loop keeps up at 5-10 kHz where
+			* polling from managed code cannot.
+			*
+			* Late iterations are taken from the driver: a late warning or
+			* error of the wait counts one and the loop goes on, unless
+			* `maxConsecutiveLate` are late in a row. Each iteration also
+			* records its loop time, from the return of the wait to the end
+			* of the write, in a histogram.
+			*
+			* The tasks must be configured with `DAQmx_Val_HWTimedSinglePoint`
+			* timing, the output ones on the clock of the input one. `Start`
+			* starts the output tasks, then the input task.
+			*
+			* `Attach`, `SetControlLaw`, `Start`, `Stop` and `Detach` belong to
+			* one controlling thread. The counters and the histogram may be
+			* read from any thread.
+			*/
+			class ControlLoopCore {
+
+			public:
+				ControlLoopCore();
+				~ControlLoopCore();
+
+				ControlLoopCore(const ControlLoopCore&) = delete;
+				ControlLoopCore& operator=(const ControlLoopCore&) = delete;
+
+				/**
+				* @brief Attaches to configured, not yet started tasks.
+				*
+				* @param[in] output `NULL` for a loop without outputs.
+				*
+				* @return `0`, `NativeErrorInvalidState`,
+				*         `NativeErrorInvalidArgument` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Attach(TaskHandle input, TaskHandle output, const ControlLoopConfig& config);
+
+				/**
+				* @brief Attaches to an input task, an analog output task and a
+				*        digital output task; either output may be `NULL`.
+				*/
+				int32 Attach(TaskHandle input, TaskHandle output, TaskHandle digitalOutput,
+					const ControlLoopConfig& config);
+
+				/**
+				* @brief Stops, and clears the tasks if the loop owns them.
+				*/
+				int32 Detach();
+
+				/**
+				* @brief Sets the law called every iteration; without one the
+				*        outputs keep their initial values.
+				*
+				* @return `0` or `NativeErrorAlreadyRunning`.
+				*/
+				int32 SetControlLaw(ControlLawFunction law, void* context);
+
+				/**
+				* @brief Sets the outputs held until the law changes them; `0`
+				*        by default.
+				*/
+				int32 SetInitialOutputs(const float64* outputs, uInt32 count);
+
+				/**
+				* @brief Resets the statistics, starts the tasks and the loop.
+				*/
+				int32 Start();
+
+				/**
+				* @brief Stops the loop after its current iteration, then the
+				*        tasks.
+				*/
+				int32 Stop();
+
+				/**
+				* @brief `false` once stopped, also by an error. A loop stopped
+				*        by an error has stopped its tasks and can be started
+				*        again without `Stop`.
+				*/
+				bool IsRunning() const;
+
+				ControlLoopCounters Counters() const;
+
+				/**
+				* @brief Copies up to `capacity` bins of the loop-time histogram.
+				*
+				* @return The number of bins copied.
+				*/
+				size_t ReadHistogram(uInt64* bins, size_t capacity) const;
+
+				/**
+				* @brief Loop time under which `fraction` (0 to 1) of the
+				*        iterations fall, in nanoseconds, at bin resolution.
+				*/
+				uInt64 LoopTimePercentile(float64 fraction) const;
+
+				/**
+				* @brief Clears the counters and the histogram; may be called
+				*        while the loop runs.
+				*/
+				void ResetStatistics();
+
+				const ControlLoopConfig& Config() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
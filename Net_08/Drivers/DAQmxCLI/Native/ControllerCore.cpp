@@ -0,0 +1,577 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ControllerCore.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "ControlLaws.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Compile-time channel count for `count` channels.
+				uInt32 Padded(uInt32 count) {
+
+					uInt32 n = 1;
+					while (n < count) {
+						n <<= 1;
+					}
+					return n;
+				}
+
+				template <size_t N>
+				bool Apply(PidParameters<N>& p, uInt32 k, const PidChannelSettings& s) {
+					p.kp[k] = s.kp;
+					p.ki[k] = s.ki;
+					p.kd[k] = s.kd;
+					p.derivativeTime[k] = s.derivativeTime;
+					p.trackingGain[k] = s.trackingGain;
+					p.outputMin[k] = s.outputMin;
+					p.outputMax[k] = s.outputMax;
+					p.setpoint[k] = s.setpoint;
+					return true;
+				}
+
+				template <size_t N>
+				bool Apply(LeadLagParameters<N>& p, uInt32 k, const LeadLagChannelSettings& s) {
+					p.gain[k] = s.gain;
+					p.leadTime[k] = s.leadTime;
+					p.lagTime[k] = s.lagTime;
+					p.outputMin[k] = s.outputMin;
+					p.outputMax[k] = s.outputMax;
+					p.setpoint[k] = s.setpoint;
+					return true;
+				}
+
+				// Settings of another kind of controller.
+				template <typename TParameters, typename TSettings>
+				bool Apply(TParameters&, uInt32, const TSettings&) {
+					return false;
+				}
+
+				template <size_t NX, size_t NI, size_t NO>
+				bool ApplyStateSpace(StateSpaceParameters<NX, NI, NO>& p, const StateSpaceSettings& s,
+					uInt32 states, uInt32 inputs, uInt32 outputs) {
+
+					for (uInt32 r = 0; r < states; r++) {
+						for (uInt32 c = 0; c < states; c++) {
+							p.a[c][r] = s.a[r * states + c];
+						}
+						for (uInt32 i = 0; i < inputs; i++) {
+							p.b[i][r] = s.b[r * inputs + i];
+						}
+					}
+
+					for (uInt32 o = 0; o < outputs; o++) {
+						for (uInt32 c = 0; c < states; c++) {
+							p.c[c][o] = s.c[o * states + c];
+						}
+						for (uInt32 i = 0; i < inputs; i++) {
+							p.d[i][o] = s.d[o * inputs + i];
+						}
+						if (s.outputMin != nullptr) {
+							p.outputMin[o] = s.outputMin[o];
+						}
+						if (s.outputMax != nullptr) {
+							p.outputMax[o] = s.outputMax[o];
+						}
+					}
+
+					if (s.setpoints != nullptr) {
+						for (uInt32 i = 0; i < inputs; i++) {
+							p.setpoint[i] = s.setpoints[i];
+						}
+					}
+					return true;
+				}
+
+				template <typename TParameters>
+				bool ApplyStateSpace(TParameters&, const StateSpaceSettings&, uInt32, uInt32, uInt32) {
+					return false;
+				}
+
+				// A controller behind the facade. The setters edit `pending`,
+				// owned by the writers, and publish a copy of it.
+				struct Model {
+
+					virtual ~Model() {}
+
+					virtual void Step(const float64* y, float64* u, float64 dt) = 0;
+					virtual void Reset() = 0;
+
+					virtual bool SetPid(uInt32 k, const PidChannelSettings& s) = 0;
+					virtual bool SetLeadLag(uInt32 k, const LeadLagChannelSettings& s) = 0;
+					virtual bool SetStateSpace(const StateSpaceSettings& s,
+						uInt32 states, uInt32 inputs, uInt32 outputs) = 0;
+					virtual void SetSetpoint(uInt32 k, float64 value) = 0;
+				};
+
+				template <typename TController>
+				struct ControllerModel : Model {
+
+					typedef typename TController::Parameters Parameters;
+
+					TController controller;
+					TripleBuffer<Parameters> parameters;
+					Parameters pending;
+					float64 preparedDt;
+
+					explicit ControllerModel(const Parameters& initial) :
+						parameters(initial), pending(initial), preparedDt(0.0) {}
+
+					void Step(const float64* y, float64* u, float64 dt) override {
+
+						if (parameters.Update() || dt != preparedDt) {
+							controller.Prepare(parameters.Current(), dt);
+							preparedDt = dt;
+						}
+						controller.Step(parameters.Current(), y, u);
+					}
+
+					void Reset() override {
+						controller.Reset();
+					}
+
+					void Publish() {
+						parameters.WriteSlot() = pending;
+						parameters.Publish();
+					}
+
+					bool SetPid(uInt32 k, const PidChannelSettings& s) override {
+						if (!Apply(pending, k, s)) {
+							return false;
+						}
+						Publish();
+						return true;
+					}
+
+					bool SetLeadLag(uInt32 k, const LeadLagChannelSettings& s) override {
+						if (!Apply(pending, k, s)) {
+							return false;
+						}
+						Publish();
+						return true;
+					}
+
+					bool SetStateSpace(const StateSpaceSettings& s,
+						uInt32 states, uInt32 inputs, uInt32 outputs) override {
+						if (!ApplyStateSpace(pending, s, states, inputs, outputs)) {
+							return false;
+						}
+						Publish();
+						return true;
+					}
+
+					void SetSetpoint(uInt32 k, float64 value) override {
+						pending.setpoint[k] = value;
+						Publish();
+					}
+				};
+
+				// Parameters start at zero, so the padding channels stay inert.
+				template <typename TParameters>
+				TParameters ZeroParameters() {
+					TParameters p;
+					std::memset(&p, 0, sizeof(p));
+					return p;
+				}
+
+				template <size_t N>
+				Model* CreatePid(uInt32 channels) {
+
+					PidParameters<N> p = ZeroParameters<PidParameters<N>>();
+					for (uInt32 k = 0; k < channels; k++) {
+						Apply(p, k, DefaultPidChannelSettings());
+					}
+					return new (std::nothrow) ControllerModel<PidController<N>>(p);
+				}
+
+				template <size_t N>
+				Model* CreateLeadLag(uInt32 channels) {
+
+					LeadLagParameters<N> p = ZeroParameters<LeadLagParameters<N>>();
+					for (uInt32 k = 0; k < channels; k++) {
+						Apply(p, k, DefaultLeadLagChannelSettings());
+					}
+					return new (std::nothrow) ControllerModel<LeadLagController<N>>(p);
+				}
+
+				template <size_t NX, size_t M>
+				Model* CreateStateSpace(uInt32 outputs) {
+
+					typedef StateSpaceController<NX, M, M> Controller;
+					typename Controller::Parameters p = ZeroParameters<typename Controller::Parameters>();
+					for (uInt32 o = 0; o < outputs; o++) {
+						p.outputMin[o] = -10.0;
+						p.outputMax[o] = 10.0;
+					}
+					return new (std::nothrow) ControllerModel<Controller>(p);
+				}
+
+				template <size_t NX>
+				Model* CreateStateSpace(uInt32 channels, uInt32 outputs) {
+
+					switch (channels) {
+					case 1: return CreateStateSpace<NX, 1>(outputs);
+					case 2: return CreateStateSpace<NX, 2>(outputs);
+					case 4: return CreateStateSpace<NX, 4>(outputs);
+					case 8: return CreateStateSpace<NX, 8>(outputs);
+					default: return nullptr;
+					}
+				}
+			}
+
+			struct ControllerCore::Impl {
+
+				ControllerKind kind;
+				std::unique_ptr<Model> model;
+				uInt32 states;
+				uInt32 inputCount;
+				uInt32 outputCount;
+				uInt32 width;
+
+				std::vector<uInt32> inputMap;
+				std::vector<uInt32> outputMap;
+				uInt32 inputsNeeded;
+				uInt32 outputsNeeded;
+
+				// Serializes the writers; the stepping thread never takes it.
+				std::mutex writeMutex;
+				std::atomic<bool> resetRequested;
+
+				std::atomic<uInt64> steps;
+				std::atomic<uInt64> parameterUpdates;
+				std::atomic<uInt64> resets;
+
+				Impl() :
+					kind(ControllerKind::None), states(0), inputCount(0), outputCount(0), width(0),
+					inputsNeeded(0), outputsNeeded(0), resetRequested(false), steps(0),
+					parameterUpdates(0), resets(0) {}
+
+				int32 Install(Model* created, ControllerKind newKind, uInt32 newStates,
+					uInt32 inputs, uInt32 outputs, uInt32 newWidth) {
+
+					if (created == nullptr) {
+						return NativeErrorOutOfMemory;
+					}
+
+					try {
+						inputMap.resize(inputs);
+						outputMap.resize(outputs);
+					}
+					catch (const std::bad_alloc&) {
+						delete created;
+						return NativeErrorOutOfMemory;
+					}
+
+					for (uInt32 k = 0; k < inputs; k++) {
+						inputMap[k] = k;
+					}
+					for (uInt32 k = 0; k < outputs; k++) {
+						outputMap[k] = k;
+					}
+
+					model.reset(created);
+					kind = newKind;
+					states = newStates;
+					inputCount = inputs;
+					outputCount = outputs;
+					width = newWidth;
+					inputsNeeded = inputs;
+					outputsNeeded = outputs;
+					resetRequested.store(false);
+					steps.store(0);
+					parameterUpdates.store(0);
+					resets.store(0);
+					return NativeSuccess;
+				}
+
+				int32 Published(bool applied) {
+
+					if (!applied) {
+						return NativeErrorInvalidState;
+					}
+					parameterUpdates.fetch_add(1, std::memory_order_relaxed);
+					return NativeSuccess;
+				}
+			};
+
+			ControllerCore::ControllerCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			ControllerCore::~ControllerCore() {
+				delete _impl;
+				_impl = nullptr;
+			}
+
+			int32 ControllerCore::ConfigurePid(uInt32 channels) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (channels == 0 || channels > ControllerMaxChannels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const uInt32 n = Padded(channels);
+				Model* model = (n == 1) ? CreatePid<1>(channels)
+					: (n == 2) ? CreatePid<2>(channels)
+					: (n == 4) ? CreatePid<4>(channels)
+					: (n == 8) ? CreatePid<8>(channels)
+					: CreatePid<16>(channels);
+
+				return _impl->Install(model, ControllerKind::Pid, 0, channels, channels, n);
+			}
+
+			int32 ControllerCore::ConfigureLeadLag(uInt32 channels) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (channels == 0 || channels > ControllerMaxChannels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const uInt32 n = Padded(channels);
+				Model* model = (n == 1) ? CreateLeadLag<1>(channels)
+					: (n == 2) ? CreateLeadLag<2>(channels)
+					: (n == 4) ? CreateLeadLag<4>(channels)
+					: (n == 8) ? CreateLeadLag<8>(channels)
+					: CreateLeadLag<16>(channels);
+
+				return _impl->Install(model, ControllerKind::LeadLag, 0, channels, channels, n);
+			}
+
+			int32 ControllerCore::ConfigureStateSpace(uInt32 states, uInt32 inputs, uInt32 outputs) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (states == 0 || states > ControllerMaxStates
+					|| inputs == 0 || inputs > ControllerMaxStateSpaceChannels
+					|| outputs == 0 || outputs > ControllerMaxStateSpaceChannels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const uInt32 m = Padded((inputs > outputs) ? inputs : outputs);
+				Model* model;
+
+				switch (Padded(states)) {
+				case 1: model = CreateStateSpace<1>(m, outputs); break;
+				case 2: model = CreateStateSpace<2>(m, outputs); break;
+				case 4: model = CreateStateSpace<4>(m, outputs); break;
+				case 8: model = CreateStateSpace<8>(m, outputs); break;
+				default: model = CreateStateSpace<16>(m, outputs); break;
+				}
+
+				return _impl->Install(model, ControllerKind::StateSpace, states, inputs, outputs, m);
+			}
+
+			ControllerKind ControllerCore::Kind() const {
+				return (_impl != nullptr) ? _impl->kind : ControllerKind::None;
+			}
+
+			uInt32 ControllerCore::StateCount() const {
+				return (_impl != nullptr) ? _impl->states : 0;
+			}
+
+			uInt32 ControllerCore::InputCount() const {
+				return (_impl != nullptr) ? _impl->inputCount : 0;
+			}
+
+			uInt32 ControllerCore::OutputCount() const {
+				return (_impl != nullptr) ? _impl->outputCount : 0;
+			}
+
+			int32 ControllerCore::Bind(const uInt32* inputs, uInt32 inputCount,
+				const uInt32* outputs, uInt32 outputCount) {
+
+				if (_impl == nullptr || !_impl->model) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+
+				if (inputs == nullptr || outputs == nullptr
+					|| inputCount != impl.inputCount || outputCount != impl.outputCount) {
+					return NativeErrorInvalidArgument;
+				}
+
+				uInt32 inputsNeeded = 0;
+				uInt32 outputsNeeded = 0;
+
+				for (uInt32 k = 0; k < inputCount; k++) {
+					impl.inputMap[k] = inputs[k];
+					inputsNeeded = (inputs[k] + 1 > inputsNeeded) ? inputs[k] + 1 : inputsNeeded;
+				}
+
+				for (uInt32 k = 0; k < outputCount; k++) {
+					impl.outputMap[k] = outputs[k];
+					outputsNeeded = (outputs[k] + 1 > outputsNeeded) ? outputs[k] + 1 : outputsNeeded;
+				}
+
+				impl.inputsNeeded = inputsNeeded;
+				impl.outputsNeeded = outputsNeeded;
+				return NativeSuccess;
+			}
+
+			int32 ControllerCore::SetPidChannel(uInt32 channel, const PidChannelSettings& settings) {
+
+				if (_impl == nullptr || !_impl->model) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->inputCount) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::lock_guard<std::mutex> lock(_impl->writeMutex);
+				return _impl->Published(_impl->model->SetPid(channel, settings));
+			}
+
+			int32 ControllerCore::SetLeadLagChannel(uInt32 channel, const LeadLagChannelSettings& settings) {
+
+				if (_impl == nullptr || !_impl->model) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->inputCount) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::lock_guard<std::mutex> lock(_impl->writeMutex);
+				return _impl->Published(_impl->model->SetLeadLag(channel, settings));
+			}
+
+			int32 ControllerCore::SetStateSpace(const StateSpaceSettings& settings) {
+
+				if (_impl == nullptr || !_impl->model) {
+					return NativeErrorInvalidState;
+				}
+
+				if (settings.a == nullptr || settings.b == nullptr
+					|| settings.c == nullptr || settings.d == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.writeMutex);
+				return impl.Published(impl.model->SetStateSpace(settings,
+					impl.states, impl.inputCount, impl.outputCount));
+			}
+
+			int32 ControllerCore::SetSetpoint(uInt32 input, float64 value) {
+
+				if (_impl == nullptr || !_impl->model) {
+					return NativeErrorInvalidState;
+				}
+
+				if (input >= _impl->inputCount) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::lock_guard<std::mutex> lock(_impl->writeMutex);
+				_impl->model->SetSetpoint(input, value);
+				return _impl->Published(true);
+			}
+
+			void ControllerCore::Reset() {
+				if (_impl != nullptr) {
+					_impl->resetRequested.store(true, std::memory_order_release);
+				}
+			}
+
+			int32 ControllerCore::Step(const float64* inputs, uInt32 inputCount,
+				float64* outputs, uInt32 outputCount, float64 dt) {
+
+				if (_impl == nullptr || !_impl->model) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+
+				if (inputs == nullptr || outputs == nullptr
+					|| inputCount < impl.inputsNeeded || outputCount < impl.outputsNeeded) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (impl.resetRequested.load(std::memory_order_relaxed)
+					&& impl.resetRequested.exchange(false, std::memory_order_acquire)) {
+					impl.model->Reset();
+					impl.resets.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				alignas(CacheLineSize) float64 y[ControllerMaxChannels];
+				alignas(CacheLineSize) float64 u[ControllerMaxChannels];
+
+				for (uInt32 k = 0; k < impl.width; k++) {
+					y[k] = (k < impl.inputCount) ? inputs[impl.inputMap[k]] : 0.0;
+				}
+
+				impl.model->Step(y, u, dt);
+
+				for (uInt32 k = 0; k < impl.outputCount; k++) {
+					outputs[impl.outputMap[k]] = u[k];
+				}
+
+				impl.steps.fetch_add(1, std::memory_order_relaxed);
+				return NativeSuccess;
+			}
+
+			int32 ControllerCore::Law(void* context, const float64* inputs, uInt32 inputCount,
+				float64* outputs, uInt32 outputCount, float64 dt) {
+
+				return static_cast<ControllerCore*>(context)->Step(inputs, inputCount,
+					outputs, outputCount, dt);
+			}
+
+			void* ControllerCore::LawContext() {
+				return this;
+			}
+
+			ControllerCounters ControllerCore::Counters() const {
+
+				ControllerCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.steps = _impl->steps.load(std::memory_order_relaxed);
+					counters.parameterUpdates = _impl->parameterUpdates.load(std::memory_order_relaxed);
+					counters.resets = _impl->resets.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+		}
+	}
+}
@@ -0,0 +1,268 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the controller library. Safe to include from code compiled with
+* /clr; the controller templates (ControlLaws.h) and their parameter
+* buffers live in ControllerCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Controller run by a `ControllerCore`.
+			*/
+			enum class ControllerKind : int32 {
+				None = 0,
+				Pid = 1,
+				LeadLag = 2,
+				StateSpace = 3
+			};
+
+			/** Most channels of a PID or lead-lag controller. */
+			constexpr uInt32 ControllerMaxChannels = 16;
+
+			/** Most states, and most inputs or outputs, of a state-space
+			*   controller. */
+			constexpr uInt32 ControllerMaxStates = 16;
+			constexpr uInt32 ControllerMaxStateSpaceChannels = 8;
+
+			/**
+			* @brief Settings of one channel of a PID controller.
+			*/
+			struct PidChannelSettings {
+				float64 kp;
+				float64 ki;
+				float64 kd;
+				/** Time constant of the derivative filter, in seconds. */
+				float64 derivativeTime;
+				/** Anti-windup back-calculation gain, in 1/s; `0` disables it. */
+				float64 trackingGain;
+				float64 outputMin;
+				float64 outputMax;
+				float64 setpoint;
+			};
+
+			inline PidChannelSettings DefaultPidChannelSettings() {
+
+				PidChannelSettings settings;
+				settings.kp = 1.0;
+				settings.ki = 0.0;
+				settings.kd = 0.0;
+				settings.derivativeTime = 0.0;
+				settings.trackingGain = 0.0;
+				settings.outputMin = -10.0;
+				settings.outputMax = 10.0;
+				settings.setpoint = 0.0;
+				return settings;
+			}
+
+			/**
+			* @brief Settings of one channel of a lead-lag controller,
+			*        `gain (leadTime s + 1) / (lagTime s + 1)`.
+			*/
+			struct LeadLagChannelSettings {
+				float64 gain;
+				float64 leadTime;
+				float64 lagTime;
+				float64 outputMin;
+				float64 outputMax;
+				float64 setpoint;
+			};
+
+			inline LeadLagChannelSettings DefaultLeadLagChannelSettings() {
+
+				LeadLagChannelSettings settings;
+				settings.gain = 1.0;
+				settings.leadTime = 0.0;
+				settings.lagTime = 0.0;
+				settings.outputMin = -10.0;
+				settings.outputMax = 10.0;
+				settings.setpoint = 0.0;
+				return settings;
+			}
+
+			/**
+			* @brief Matrices of a discrete state-space controller, row-major,
+			*        with the sizes of `ConfigureStateSpace`.
+			*/
+			struct StateSpaceSettings {
+				/** states x states. */
+				const float64* a;
+				/** states x inputs. */
+				const float64* b;
+				/** outputs x states. */
+				const float64* c;
+				/** outputs x inputs. */
+				const float64* d;
+				/** One per input; `nullptr` keeps the current ones. */
+				const float64* setpoints;
+				/** One per output; `nullptr` keeps the current limits. */
+				const float64* outputMin;
+				const float64* outputMax;
+			};
+
+			/**
+			* @brief Counters of the controller. Read without locking.
+			*/
+			struct ControllerCounters {
+				uInt64 steps;
+				/** Parameter sets published by the setters. */
+				uInt64 parameterUpdates;
+				uInt64 resets;
+			};
+
+			/**
+			* @brief Runs one of the controllers of `ControlLaws.h` (PID,
+			*        lead-lag, state-space) on the inputs and outputs of a
+			*        control loop.
+			*
+			* The controller is instantiated for a compile-time channel count,
+			* the configured count rounded up to a power of two, so its step
+			* is a fixed-length loop the compiler unrolls and vectorizes; the
+			* extra channels are inert.
+			*
+			* `Bind` maps controller channels to the inputs read by the loop,
+			* e.g. analog input channels, and to its outputs, analog output
+			* channels then digital lines. By default channel k uses input and
+			* output k.
+			*
+			* Parameter setters may be called from any thread while the
+			* controller runs: each publishes a complete parameter set through
+			* a triple buffer that the stepping thread picks up at its next
+			* step, without locks or waits on that side. `Reset` is deferred
+			* to the next step the same way.
+			*
+			* `Law` and `LawContext` plug the controller into
+			* `ControlLoopCore::SetControlLaw`; `Step` runs it from a software
+			* loop. `Configure...` and `Bind` must not be called while a loop
+			* runs the controller.
+			*/
+			class ControllerCore {
+
+			public:
+				ControllerCore();
+				~ControllerCore();
+
+				ControllerCore(const ControllerCore&) = delete;
+				ControllerCore& operator=(const ControllerCore&) = delete;
+
+				/**
+				* @brief Replaces the controller with `channels` PID loops, each
+				*        with `DefaultPidChannelSettings`.
+				*
+				* @return `0`, `NativeErrorInvalidArgument` or
+				*         `NativeErrorOutOfMemory`.
+				*/
+				int32 ConfigurePid(uInt32 channels);
+
+				/**
+				* @brief Replaces the controller with `channels` lead-lag
+				*        compensators, each with `DefaultLeadLagChannelSettings`.
+				*/
+				int32 ConfigureLeadLag(uInt32 channels);
+
+				/**
+				* @brief Replaces the controller with a state-space controller;
+				*        its matrices are zero until `SetStateSpace`.
+				*/
+				int32 ConfigureStateSpace(uInt32 states, uInt32 inputs, uInt32 outputs);
+
+				ControllerKind Kind() const;
+
+				/** States of a state-space controller, `0` for other kinds. */
+				uInt32 StateCount() const;
+
+				/** Measured inputs of the controller. */
+				uInt32 InputCount() const;
+
+				/** Outputs of the controller. */
+				uInt32 OutputCount() const;
+
+				/**
+				* @brief Maps controller input k to loop input `inputs[k]` and
+				*        controller output k to loop output `outputs[k]`.
+				*
+				* @return `0`, `NativeErrorInvalidState` without a controller,
+				*         or `NativeErrorInvalidArgument`.
+				*/
+				int32 Bind(const uInt32* inputs, uInt32 inputCount,
+					const uInt32* outputs, uInt32 outputCount);
+
+				/**
+				* @return `0`, `NativeErrorInvalidState` if the controller is not
+				*         a PID controller, or `NativeErrorInvalidArgument`.
+				*/
+				int32 SetPidChannel(uInt32 channel, const PidChannelSettings& settings);
+
+				int32 SetLeadLagChannel(uInt32 channel, const LeadLagChannelSettings& settings);
+
+				int32 SetStateSpace(const StateSpaceSettings& settings);
+
+				/**
+				* @brief Sets the setpoint of one input, whatever the kind.
+				*/
+				int32 SetSetpoint(uInt32 input, float64 value);
+
+				/**
+				* @brief Clears the integrators, filters and states at the next
+				*        step.
+				*/
+				void Reset();
+
+				/**
+				* @brief Runs one step on loop-sized `inputs` and `outputs`,
+				*        through the bindings.
+				*
+				* @param[in] dt Period, in seconds.
+				*
+				* @return `0`, `NativeErrorInvalidState` without a controller,
+				*         or `NativeErrorInvalidArgument` if a binding is out
+				*         of range.
+				*/
+				int32 Step(const float64* inputs, uInt32 inputCount,
+					float64* outputs, uInt32 outputCount, float64 dt);
+
+				/**
+				* @brief A `ControlLawFunction` that calls `Step` on the
+				*        controller passed as `LawContext`.
+				*/
+				static int32 Law(void* context, const float64* inputs, uInt32 inputCount,
+					float64* outputs, uInt32 outputCount, float64 dt);
+
+				void* LawContext();
+
+				ControllerCounters Counters() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CpuFeatures.h"
+
+#include <atomic>
+
+#if NATIVE_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				struct DetectedFeatures {
+					SimdLevel level;
+					bool bmi2;
+				};
+
+				DetectedFeatures Detect() {
+
+					DetectedFeatures features = { SimdLevel::Scalar, false };
+
+#if NATIVE_X86 && defined(_MSC_VER)
+					int regs[4];
+					__cpuid(regs, 0);
+					const int maxLeaf = regs[0];
+
+					__cpuid(regs, 1);
+					const bool sse41 = (regs[2] & (1 << 19)) != 0;
+					const bool osxsave = (regs[2] & (1 << 27)) != 0;
+					const bool avx = (regs[2] & (1 << 28)) != 0;
+
+					// The OS must save the YMM state for AVX to be usable.
+					const bool ymm = osxsave && ((_xgetbv(0) & 0x6) == 0x6);
+
+					bool avx2 = false;
+					if (maxLeaf >= 7) {
+						__cpuidex(regs, 7, 0);
+						avx2 = (regs[1] & (1 << 5)) != 0;
+						features.bmi2 = (regs[1] & (1 << 8)) != 0;
+					}
+
+					if (sse41) {
+						features.level = SimdLevel::Sse41;
+					}
+					if (sse41 && avx && ymm && avx2) {
+						features.level = SimdLevel::Avx2;
+					}
+#elif NATIVE_X86
+					__builtin_cpu_init();
+
+					if (__builtin_cpu_supports("sse4.1")) {
+						features.level = SimdLevel::Sse41;
+					}
+					if (__builtin_cpu_supports("avx2")) {
+						features.level = SimdLevel::Avx2;
+					}
+					features.bmi2 = __builtin_cpu_supports("bmi2") != 0;
+#endif
+					return features;
+				}
+
+				const DetectedFeatures& Features() {
+					static const DetectedFeatures features = Detect();
+					return features;
+				}
+
+				std::atomic<int32> g_limit((int32)SimdLevel::Avx2);
+			}
+
+			SimdLevel DetectedSimdLevel() {
+				return Features().level;
+			}
+
+			SimdLevel ActiveSimdLevel() {
+
+				const int32 detected = (int32)Features().level;
+				const int32 limit = g_limit.load(std::memory_order_relaxed);
+				return (SimdLevel)((detected < limit) ? detected : limit);
+			}
+
+			void SetSimdLevelLimit(SimdLevel limit) {
+				g_limit.store((int32)limit, std::memory_order_relaxed);
+			}
+
+			bool CpuHasBmi2() {
+				return Features().bmi2;
+			}
+
+			const char* SimdLevelName(SimdLevel level) {
+				switch (level) {
+				case SimdLevel::Avx2:
+					return "avx2";
+				case SimdLevel::Sse41:
+					return "sse4.1";
+				default:
+					return "scalar";
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Runtime CPU feature detection for the native SIMD kernels.
+*
+* Kernels are compiled for several instruction sets in the same binary and
+* the best one is picked at run time, so the driver still loads on machines
+* without AVX2. With GCC/Clang the wide variants are compiled with
+* `NATIVE_TARGET_AVX2` / `NATIVE_TARGET_SSE41`; MSVC accepts the intrinsics
+* without a per-function target and the macros expand to nothing.
+*/
+
+#include "NativeDAQmx.h"
+
+#if defined(_MSC_VER)
+#define NATIVE_TARGET_SSE41
+#define NATIVE_TARGET_AVX2
+#define NATIVE_TARGET_AVX2_BMI2
+#define NATIVE_TARGET_BMI2
+#else
+#define NATIVE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define NATIVE_TARGET_AVX2 __attribute__((target("avx2")))
+#define NATIVE_TARGET_AVX2_BMI2 __attribute__((target("avx2,bmi2")))
+#define NATIVE_TARGET_BMI2 __attribute__((target("bmi2")))
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NATIVE_X86 1
+#else
+#define NATIVE_X86 0
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Instruction set levels the kernels are specialized for,
+			*        in increasing order.
+			*/
+			enum class SimdLevel : int32 {
+				Scalar = 0,
+				Sse41 = 1,
+				Avx2 = 2
+			};
+
+			/**
+			* @brief Highest level supported by the CPU and the OS.
+			*/
+			SimdLevel DetectedSimdLevel();
+
+			/**
+			* @brief Level the kernels use: the detected level, capped by
+			*        `SetSimdLevelLimit`.
+			*/
+			SimdLevel ActiveSimdLevel();
+
+			/**
+			* @brief Caps the level used by the kernels. Meant for tests and
+			*        benchmarks that compare the variants; not thread safe with
+			*        respect to kernels running concurrently.
+			*/
+			void SetSimdLevelLimit(SimdLevel limit);
+
+			/**
+			* @brief `true` if the CPU supports BMI2 (`pdep`/`pext`).
+			*/
+			bool CpuHasBmi2();
+
+			/**
+			* @brief Short name of a level, e.g. "avx2".
+			*/
+			const char* SimdLevelName(SimdLevel level);
+		}
+	}
+}
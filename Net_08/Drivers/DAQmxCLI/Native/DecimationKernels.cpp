@@ -0,0 +1,266 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DecimationKernels.h"
+
+#include <cmath>
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const float64 Pi = 3.14159265358979323846;
+
+				void FirScalar(const float64* x, const float64* taps, uInt32 tapCount,
+					uInt32 factor, size_t outputs, float64* out) {
+
+					for (size_t j = 0; j < outputs; j++, x += factor) {
+
+						float64 a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+						uInt32 k = 0;
+
+						for (; k + 4 <= tapCount; k += 4) {
+							a0 += x[k] * taps[k];
+							a1 += x[k + 1] * taps[k + 1];
+							a2 += x[k + 2] * taps[k + 2];
+							a3 += x[k + 3] * taps[k + 3];
+						}
+						for (; k < tapCount; k++) {
+							a0 += x[k] * taps[k];
+						}
+						out[j] = (a0 + a1) + (a2 + a3);
+					}
+				}
+
+				inline int16 SaturateI16(float64 v) {
+
+					if (v >= 32767.0) {
+						return 32767;
+					}
+					if (v <= -32768.0) {
+						return -32768;
+					}
+					return (int16)std::lrint(v);
+				}
+
+#if NATIVE_X86
+				NATIVE_TARGET_AVX2
+				void FirAvx2(const float64* x, const float64* taps, uInt32 tapCount,
+					uInt32 factor, size_t outputs, float64* out) {
+
+					for (size_t j = 0; j < outputs; j++, x += factor) {
+
+						__m256d a0 = _mm256_setzero_pd();
+						__m256d a1 = _mm256_setzero_pd();
+						__m256d a2 = _mm256_setzero_pd();
+						__m256d a3 = _mm256_setzero_pd();
+						uInt32 k = 0;
+
+						for (; k + 16 <= tapCount; k += 16) {
+							a0 = _mm256_add_pd(a0, _mm256_mul_pd(_mm256_loadu_pd(x + k),
+								_mm256_loadu_pd(taps + k)));
+							a1 = _mm256_add_pd(a1, _mm256_mul_pd(_mm256_loadu_pd(x + k + 4),
+								_mm256_loadu_pd(taps + k + 4)));
+							a2 = _mm256_add_pd(a2, _mm256_mul_pd(_mm256_loadu_pd(x + k + 8),
+								_mm256_loadu_pd(taps + k + 8)));
+							a3 = _mm256_add_pd(a3, _mm256_mul_pd(_mm256_loadu_pd(x + k + 12),
+								_mm256_loadu_pd(taps + k + 12)));
+						}
+						for (; k + 4 <= tapCount; k += 4) {
+							a0 = _mm256_add_pd(a0, _mm256_mul_pd(_mm256_loadu_pd(x + k),
+								_mm256_loadu_pd(taps + k)));
+						}
+
+						const __m256d s = _mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3));
+						__m128d h = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+						h = _mm_add_sd(h, _mm_unpackhi_pd(h, h));
+
+						float64 y = _mm_cvtsd_f64(h);
+						for (; k < tapCount; k++) {
+							y += x[k] * taps[k];
+						}
+						out[j] = y;
+					}
+				}
+
+				NATIVE_TARGET_SSE41
+				void FirSse41(const float64* x, const float64* taps, uInt32 tapCount,
+					uInt32 factor, size_t outputs, float64* out) {
+
+					for (size_t j = 0; j < outputs; j++, x += factor) {
+
+						__m128d a0 = _mm_setzero_pd();
+						__m128d a1 = _mm_setzero_pd();
+						__m128d a2 = _mm_setzero_pd();
+						__m128d a3 = _mm_setzero_pd();
+						uInt32 k = 0;
+
+						for (; k + 8 <= tapCount; k += 8) {
+							a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(x + k), _mm_loadu_pd(taps + k)));
+							a1 = _mm_add_pd(a1, _mm_mul_pd(_mm_loadu_pd(x + k + 2), _mm_loadu_pd(taps + k + 2)));
+							a2 = _mm_add_pd(a2, _mm_mul_pd(_mm_loadu_pd(x + k + 4), _mm_loadu_pd(taps + k + 4)));
+							a3 = _mm_add_pd(a3, _mm_mul_pd(_mm_loadu_pd(x + k + 6), _mm_loadu_pd(taps + k + 6)));
+						}
+						for (; k + 2 <= tapCount; k += 2) {
+							a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(x + k), _mm_loadu_pd(taps + k)));
+						}
+
+						__m128d h = _mm_add_pd(_mm_add_pd(a0, a1), _mm_add_pd(a2, a3));
+						h = _mm_add_sd(h, _mm_unpackhi_pd(h, h));
+
+						float64 y = _mm_cvtsd_f64(h);
+						for (; k < tapCount; k++) {
+							y += x[k] * taps[k];
+						}
+						out[j] = y;
+					}
+				}
+
+				NATIVE_TARGET_AVX2
+				void ConvertI16Avx2(const float64* src, int16* dst, size_t count) {
+
+					const __m256d lo = _mm256_set1_pd(-32768.0);
+					const __m256d hi = _mm256_set1_pd(32767.0);
+					size_t i = 0;
+
+					// Clamped first: out-of-range conversions yield INT_MIN.
+					for (; i + 8 <= count; i += 8) {
+						const __m128i v0 = _mm256_cvtpd_epi32(
+							_mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(src + i), lo), hi));
+						const __m128i v1 = _mm256_cvtpd_epi32(
+							_mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(src + i + 4), lo), hi));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(v0, v1));
+					}
+					for (; i < count; i++) {
+						dst[i] = SaturateI16(src[i]);
+					}
+				}
+#endif
+			}
+
+			void FirDecimateF64(const float64* x, const float64* reversedTaps,
+				uInt32 tapCount, uInt32 factor, size_t outputs, float64* out) {
+
+				if (outputs == 0 || tapCount == 0) {
+					return;
+				}
+
+#if NATIVE_X86
+				switch (ActiveSimdLevel()) {
+				case SimdLevel::Avx2:
+					FirAvx2(x, reversedTaps, tapCount, factor, outputs, out);
+					return;
+				case SimdLevel::Sse41:
+					FirSse41(x, reversedTaps, tapCount, factor, outputs, out);
+					return;
+				default:
+					break;
+				}
+#endif
+				FirScalar(x, reversedTaps, tapCount, factor, outputs, out);
+			}
+
+			void ConvertF64ToI16(const float64* src, int16* dst, size_t count) {
+
+#if NATIVE_X86
+				if (ActiveSimdLevel() == SimdLevel::Avx2) {
+					ConvertI16Avx2(src, dst, count);
+					return;
+				}
+#endif
+				for (size_t i = 0; i < count; i++) {
+					dst[i] = SaturateI16(src[i]);
+				}
+			}
+
+			void DesignLowpassFir(float64* taps, uInt32 count, float64 cutoff) {
+
+				if (count == 0) {
+					return;
+				}
+
+				const float64 center = 0.5 * (float64)(count - 1);
+				float64 sum = 0.0;
+
+				for (uInt32 i = 0; i < count; i++) {
+
+					const float64 t = (float64)i - center;
+					const float64 sinc = (t == 0.0)
+						? 2.0 * cutoff : std::sin(2.0 * Pi * cutoff * t) / (Pi * t);
+
+					const float64 w = (count == 1) ? 1.0
+						: 0.42 - 0.5 * std::cos(2.0 * Pi * i / (count - 1))
+							+ 0.08 * std::cos(4.0 * Pi * i / (count - 1));
+
+					taps[i] = sinc * w;
+					sum += taps[i];
+				}
+
+				for (uInt32 i = 0; i < count; i++) {
+					taps[i] /= sum;
+				}
+			}
+
+			void DesignCicFir(float64* taps, uInt32 factor, uInt32 stages) {
+
+				const uInt32 length = CicFirLength(factor, stages);
+
+				for (uInt32 i = 0; i < length; i++) {
+					taps[i] = 0.0;
+				}
+				taps[0] = 1.0;
+
+				// Convolves with one boxcar per stage, in place from the end.
+				uInt32 current = 1;
+				for (uInt32 s = 0; s < stages; s++) {
+
+					const uInt32 next = current + factor - 1;
+
+					for (uInt32 i = next; i-- > 0;) {
+
+						float64 acc = 0.0;
+						for (uInt32 k = 0; k < factor; k++) {
+							if (i >= k && i - k < current) {
+								acc += taps[i - k];
+							}
+						}
+						taps[i] = acc;
+					}
+					current = next;
+				}
+
+				const float64 gain = std::pow((float64)factor, (float64)stages);
+				for (uInt32 i = 0; i < length; i++) {
+					taps[i] /= gain;
+				}
+			}
+		}
+	}
+}
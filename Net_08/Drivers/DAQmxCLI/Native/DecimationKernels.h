@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized kernels and filter design helpers of the decimation stage.
+*
+* A decimating FIR only needs every `factor`-th output of the full-rate
+* convolution, so the kernel evaluates exactly those: output `j` is the dot
+* product of the taps with the window of input that starts at `j * factor`.
+* This is the polyphase decomposition written as strided windows; each
+* input sample costs `tapCount / factor` multiply-adds. The dot products
+* run in SSE2/AVX2 registers with several independent accumulators.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Computes `outputs` decimated FIR outputs:
+			*        `out[j] = sum(k < tapCount) reversedTaps[k] * x[j * factor + k]`.
+			*
+			* @param[in] x Input; `(outputs - 1) * factor + tapCount` samples are read.
+			* @param[in] reversedTaps Filter taps, last tap first.
+			* @param[in] tapCount Number of taps.
+			* @param[in] factor Distance between the windows of two outputs.
+			* @param[in] outputs Number of outputs.
+			* @param[out] out Contiguous outputs; may not overlap `x`.
+			*/
+			void FirDecimateF64(const float64* x, const float64* reversedTaps,
+				uInt32 tapCount, uInt32 factor, size_t outputs, float64* out);
+
+			/**
+			* @brief Rounds `count` values to the nearest integer and saturates
+			*        them to the I16 range.
+			*/
+			void ConvertF64ToI16(const float64* src, int16* dst, size_t count);
+
+			/**
+			* @brief Designs a linear-phase low-pass FIR: a Blackman-windowed
+			*        sinc normalized to unity gain at DC.
+			*
+			* @param[out] taps Receives `count` taps.
+			* @param[in] count Number of taps.
+			* @param[in] cutoff Cutoff frequency as a fraction of the input
+			*            sample rate, in (0, 0.5).
+			*/
+			void DesignLowpassFir(float64* taps, uInt32 count, float64 cutoff);
+
+			/**
+			* @brief Length of the FIR equivalent to a CIC decimator with
+			*        differential delay 1.
+			*/
+			inline uInt32 CicFirLength(uInt32 factor, uInt32 stages) {
+				return stages * (factor - 1) + 1;
+			}
+
+			/**
+			* @brief Taps of a `stages`-stage CIC decimator by `factor`
+			*        (`stages` boxcars of length `factor` convolved together),
+			*        normalized to unity gain at DC.
+			*
+			* @param[out] taps Receives `CicFirLength(factor, stages)` taps.
+			*/
+			void DesignCicFir(float64* taps, uInt32 factor, uInt32 stages);
+		}
+	}
+}
@@ -0,0 +1,526 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DecimatorCore.h"
+
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "DecimationKernels.h"
+#include "NativeStatus.h"
+#include "RawScalingCore.h"
+#include "ScalingKernels.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Samples of history kept in front of every channel's input: enough
+				// for the longest filter, so changing a filter never moves buffers.
+				const size_t HistorySamples = MaxDecimatorTaps - 1;
+
+				// y = x, in the table layout of ScalingKernels.h.
+				const float64 IdentityTable[2 * ScalingTablePeriodAlignment] = {
+					0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+					1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0
+				};
+
+				bool IsFillMode(int32 fillMode) {
+					return fillMode == DAQmx_Val_GroupByChannel
+						|| fillMode == DAQmx_Val_GroupByScanNumber;
+				}
+			}
+
+			struct DecimatorCore::Impl {
+
+				DecimatorConfig config;
+				bool configured;
+
+				// Taps of every channel, last tap first (see FirDecimateF64).
+				std::vector<std::vector<float64>> reversedTaps;
+
+				// One region per channel: `HistorySamples` of history followed by
+				// the current block, converted to F64.
+				float64* work;
+				size_t regionStride;
+
+				// Decimated outputs grouped by channel, before the final layout.
+				float64* decimated;
+				// I16 staging: raw input to deinterleave, or output to interleave.
+				int16* staging;
+
+				const RawScalingCore* scaling;
+
+				// Index within the next block of the input sample the next output
+				// is aligned to; always below `factor`.
+				uInt32 phase;
+				uInt64 outputPosition;
+
+				Impl() :
+					config(DefaultDecimatorConfig()), configured(false),
+					work(nullptr), regionStride(0), decimated(nullptr), staging(nullptr),
+					scaling(nullptr), phase(0), outputPosition(0) {}
+
+				~Impl() {
+					FreeBuffers();
+				}
+
+				void FreeBuffers() {
+					AlignedFree(work);
+					AlignedFree(decimated);
+					AlignedFree(staging);
+					work = nullptr;
+					decimated = nullptr;
+					staging = nullptr;
+					configured = false;
+				}
+
+				float64* Region(uInt32 channel) const {
+					return work + (size_t)channel * regionStride;
+				}
+
+				void ClearHistory(uInt32 channel) {
+					std::memset(Region(channel), 0, HistorySamples * sizeof(float64));
+				}
+
+				uInt32 OutputCount(uInt32 samplesPerChannel) const {
+					return (samplesPerChannel > phase)
+						? (samplesPerChannel - phase + config.factor - 1) / config.factor : 0;
+				}
+
+				int32 SetTaps(uInt32 channel, const float64* taps, uInt32 count) {
+
+					try {
+						std::vector<float64>& reversed = reversedTaps[channel];
+						reversed.resize(count);
+
+						for (uInt32 k = 0; k < count; k++) {
+							reversed[k] = taps[count - 1 - k];
+						}
+					}
+					catch (const std::bad_alloc&) {
+						return NativeErrorOutOfMemory;
+					}
+
+					ClearHistory(channel);
+					return NativeSuccess;
+				}
+
+				int32 Check(uInt32 samplesPerChannel, int32 inFillMode, int32 outFillMode,
+					size_t outSize) const {
+
+					if (!configured) {
+						return NativeErrorInvalidState;
+					}
+					if (!IsFillMode(inFillMode) || !IsFillMode(outFillMode)) {
+						return NativeErrorInvalidArgument;
+					}
+					if (samplesPerChannel > config.maxSamplesPerChannel) {
+						return NativeErrorBufferTooSmall;
+					}
+					if (outSize < (size_t)OutputCount(samplesPerChannel) * config.channels) {
+						return NativeErrorBufferTooSmall;
+					}
+					return NativeSuccess;
+				}
+
+				void LoadF64(const float64* in, uInt32 samplesPerChannel, int32 fillMode) {
+
+					const uInt32 channels = config.channels;
+
+					if (fillMode == DAQmx_Val_GroupByScanNumber && channels > 1) {
+						TransposeStrided(in, channels, work + HistorySamples, regionStride,
+							samplesPerChannel, channels, sizeof(float64));
+						return;
+					}
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						std::memcpy(Region(ch) + HistorySamples,
+							in + (size_t)ch * samplesPerChannel,
+							(size_t)samplesPerChannel * sizeof(float64));
+					}
+				}
+
+				int32 LoadI16(const int16* in, uInt32 samplesPerChannel, int32 fillMode,
+					bool scaled) {
+
+					const uInt32 channels = config.channels;
+
+					if (scaled) {
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+
+							int32 r = scaling->ScaleChannelToF64(in, samplesPerChannel, fillMode,
+								ch, Region(ch) + HistorySamples, samplesPerChannel);
+
+							if (r < 0) {
+								return r;
+							}
+						}
+						return NativeSuccess;
+					}
+
+					const int16* channelMajor = in;
+
+					if (fillMode == DAQmx_Val_GroupByScanNumber && channels > 1) {
+						Deinterleave(in, staging, channels, samplesPerChannel, sizeof(int16));
+						channelMajor = staging;
+					}
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						ScaleI16ToF64(channelMajor + (size_t)ch * samplesPerChannel,
+							Region(ch) + HistorySamples, samplesPerChannel,
+							IdentityTable, ScalingTablePeriodAlignment, 2);
+					}
+					return NativeSuccess;
+				}
+
+				// Filters the loaded block into `decimated` and slides the history.
+				uInt32 Filter(uInt32 samplesPerChannel) {
+
+					const uInt32 outputs = OutputCount(samplesPerChannel);
+
+					for (uInt32 ch = 0; ch < config.channels; ch++) {
+
+						const std::vector<float64>& taps = reversedTaps[ch];
+						const uInt32 tapCount = (uInt32)taps.size();
+						float64* region = Region(ch);
+
+						FirDecimateF64(region + HistorySamples + phase - (tapCount - 1),
+							taps.data(), tapCount, config.factor, outputs,
+							decimated + (size_t)ch * outputs);
+
+						// The last `tapCount - 1` inputs become the history. The
+						// ranges overlap when the block is shorter than the filter.
+						std::memmove(region + HistorySamples - (tapCount - 1),
+							region + HistorySamples + samplesPerChannel - (tapCount - 1),
+							(size_t)(tapCount - 1) * sizeof(float64));
+					}
+
+					phase = phase + outputs * config.factor - samplesPerChannel;
+					outputPosition += outputs;
+					return outputs;
+				}
+
+				void StoreF64(uInt32 outputs, float64* out, int32 fillMode) const {
+
+					const size_t total = (size_t)outputs * config.channels;
+
+					if (fillMode == DAQmx_Val_GroupByScanNumber && config.channels > 1) {
+						Interleave(decimated, out, config.channels, outputs, sizeof(float64));
+					}
+					else {
+						std::memcpy(out, decimated, total * sizeof(float64));
+					}
+				}
+
+				void StoreI16(uInt32 outputs, int16* out, int32 fillMode) const {
+
+					const size_t total = (size_t)outputs * config.channels;
+
+					if (fillMode == DAQmx_Val_GroupByScanNumber && config.channels > 1) {
+						ConvertF64ToI16(decimated, staging, total);
+						Interleave(staging, out, config.channels, outputs, sizeof(int16));
+					}
+					else {
+						ConvertF64ToI16(decimated, out, total);
+					}
+				}
+			};
+
+			DecimatorCore::DecimatorCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			DecimatorCore::~DecimatorCore() {
+
+				if (_impl != nullptr) {
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 DecimatorCore::Configure(const DecimatorConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (config.channels == 0 || config.factor == 0
+					|| config.maxSamplesPerChannel == 0 || config.tapsPerPhase == 0
+					|| (uInt64)config.factor * config.tapsPerPhase > MaxDecimatorTaps
+					|| !(config.passband > 0.0 && config.passband < 1.0)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				impl.FreeBuffers();
+
+				// Keeps every region on a cache line boundary.
+				const size_t lineSamples = CacheLineSize / sizeof(float64);
+				impl.regionStride = (HistorySamples + config.maxSamplesPerChannel
+					+ lineSamples - 1) / lineSamples * lineSamples;
+
+				const size_t blockSamples = (size_t)config.channels * config.maxSamplesPerChannel;
+
+				impl.work = static_cast<float64*>(AlignedAlloc(
+					impl.regionStride * config.channels * sizeof(float64)));
+				impl.decimated = static_cast<float64*>(AlignedAlloc(
+					blockSamples * sizeof(float64)));
+				impl.staging = static_cast<int16*>(AlignedAlloc(
+					blockSamples * sizeof(int16)));
+
+				if (impl.work == nullptr || impl.decimated == nullptr || impl.staging == nullptr) {
+					impl.FreeBuffers();
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.config = config;
+
+				try {
+					impl.reversedTaps.assign(config.channels, std::vector<float64>());
+				}
+				catch (const std::bad_alloc&) {
+					impl.FreeBuffers();
+					return NativeErrorOutOfMemory;
+				}
+
+				std::vector<float64> taps;
+				const uInt32 count = config.factor * config.tapsPerPhase;
+
+				try {
+					taps.resize(count);
+				}
+				catch (const std::bad_alloc&) {
+					impl.FreeBuffers();
+					return NativeErrorOutOfMemory;
+				}
+
+				DesignLowpassFir(taps.data(), count, config.passband * 0.5 / config.factor);
+
+				for (uInt32 ch = 0; ch < config.channels; ch++) {
+
+					int32 r = impl.SetTaps(ch, taps.data(), count);
+					if (r != NativeSuccess) {
+						impl.FreeBuffers();
+						return r;
+					}
+				}
+
+				impl.configured = true;
+				Reset();
+				return NativeSuccess;
+			}
+
+			int32 DecimatorCore::SetChannelFir(uInt32 channel, const float64* taps,
+				uInt32 count) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+				if (channel >= _impl->config.channels || taps == nullptr
+					|| count == 0 || count > MaxDecimatorTaps) {
+					return NativeErrorInvalidArgument;
+				}
+				return _impl->SetTaps(channel, taps, count);
+			}
+
+			int32 DecimatorCore::SetChannelCic(uInt32 channel, uInt32 stages) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				const uInt32 factor = _impl->config.factor;
+
+				if (channel >= _impl->config.channels || stages == 0 || stages > MaxCicStages
+					|| (uInt64)stages * (factor - 1) + 1 > MaxDecimatorTaps) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::vector<float64> taps;
+				try {
+					taps.resize(CicFirLength(factor, stages));
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				DesignCicFir(taps.data(), factor, stages);
+				return _impl->SetTaps(channel, taps.data(), (uInt32)taps.size());
+			}
+
+			int32 DecimatorCore::GetChannelTaps(uInt32 channel, float64* taps,
+				uInt32 capacity) const {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+				if (channel >= _impl->config.channels || (taps == nullptr && capacity > 0)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const std::vector<float64>& reversed = _impl->reversedTaps[channel];
+				const uInt32 count = (uInt32)reversed.size();
+
+				for (uInt32 k = 0; k < count && k < capacity; k++) {
+					taps[k] = reversed[count - 1 - k];
+				}
+				return (int32)count;
+			}
+
+			int32 DecimatorCore::SetScaling(const RawScalingCore* scaling) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+				if (scaling != nullptr && _impl->configured
+					&& scaling->Channels() != _impl->config.channels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				_impl->scaling = scaling;
+				return NativeSuccess;
+			}
+
+			void DecimatorCore::Reset() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return;
+				}
+
+				for (uInt32 ch = 0; ch < _impl->config.channels; ch++) {
+					_impl->ClearHistory(ch);
+				}
+				_impl->phase = 0;
+				_impl->outputPosition = 0;
+			}
+
+			bool DecimatorCore::IsConfigured() const {
+				return _impl != nullptr && _impl->configured;
+			}
+
+			const DecimatorConfig& DecimatorCore::Config() const {
+				return _impl->config;
+			}
+
+			uInt32 DecimatorCore::MaxOutputSamples(uInt32 samplesPerChannel) const {
+				return (_impl == nullptr) ? 0
+					: (samplesPerChannel + _impl->config.factor - 1) / _impl->config.factor;
+			}
+
+			uInt64 DecimatorCore::OutputPosition() const {
+				return (_impl != nullptr) ? _impl->outputPosition : 0;
+			}
+
+			int32 DecimatorCore::Process(const float64* in, uInt32 samplesPerChannel,
+				int32 inFillMode, float64* out, size_t outSize, int32 outFillMode,
+				uInt32& outSamplesPerChannel) {
+
+				outSamplesPerChannel = 0;
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				int32 r = _impl->Check(samplesPerChannel, inFillMode, outFillMode, outSize);
+				if (r != NativeSuccess) {
+					return r;
+				}
+
+				_impl->LoadF64(in, samplesPerChannel, inFillMode);
+				outSamplesPerChannel = _impl->Filter(samplesPerChannel);
+				_impl->StoreF64(outSamplesPerChannel, out, outFillMode);
+				return NativeSuccess;
+			}
+
+			int32 DecimatorCore::Process(const int16* in, uInt32 samplesPerChannel,
+				int32 inFillMode, float64* out, size_t outSize, int32 outFillMode,
+				uInt32& outSamplesPerChannel) {
+
+				outSamplesPerChannel = 0;
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				int32 r = _impl->Check(samplesPerChannel, inFillMode, outFillMode, outSize);
+				if (r != NativeSuccess) {
+					return r;
+				}
+
+				r = _impl->LoadI16(in, samplesPerChannel, inFillMode, _impl->scaling != nullptr);
+				if (r < 0) {
+					return r;
+				}
+
+				outSamplesPerChannel = _impl->Filter(samplesPerChannel);
+				_impl->StoreF64(outSamplesPerChannel, out, outFillMode);
+				return NativeSuccess;
+			}
+
+			int32 DecimatorCore::Process(const int16* in, uInt32 samplesPerChannel,
+				int32 inFillMode, int16* out, size_t outSize, int32 outFillMode,
+				uInt32& outSamplesPerChannel) {
+
+				outSamplesPerChannel = 0;
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				int32 r = _impl->Check(samplesPerChannel, inFillMode, outFillMode, outSize);
+				if (r != NativeSuccess) {
+					return r;
+				}
+
+				_impl->LoadI16(in, samplesPerChannel, inFillMode, false);
+				outSamplesPerChannel = _impl->Filter(samplesPerChannel);
+				_impl->StoreI16(outSamplesPerChannel, out, outFillMode);
+				return NativeSuccess;
+			}
+
+			int32 DecimatorCore::Process(const void* in, SampleFormat format,
+				uInt32 samplesPerChannel, int32 inFillMode, void* out, size_t outSize,
+				int32 outFillMode, uInt32& outSamplesPerChannel) {
+
+				switch (format) {
+				case SampleFormat::Float64:
+					return Process(static_cast<const float64*>(in), samplesPerChannel,
+						inFillMode, static_cast<float64*>(out), outSize, outFillMode,
+						outSamplesPerChannel);
+				case SampleFormat::Int16:
+					return Process(static_cast<const int16*>(in), samplesPerChannel,
+						inFillMode, static_cast<int16*>(out), outSize, outFillMode,
+						outSamplesPerChannel);
+				default:
+					outSamplesPerChannel = 0;
+					return NativeErrorUnsupportedFormat;
+				}
+			}
+		}
+	}
+}
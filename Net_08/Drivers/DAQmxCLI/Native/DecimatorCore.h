@@ -0,0 +1,217 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the streaming decimation stage. Safe to include from code
+* compiled with /clr; the filter state lives in DecimatorCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			class RawScalingCore;
+
+			/**
+			* @brief Longest filter a channel can use, in taps.
+			*/
+			constexpr uInt32 MaxDecimatorTaps = 4096;
+
+			/**
+			* @brief Highest number of CIC stages.
+			*/
+			constexpr uInt32 MaxCicStages = 8;
+
+			/**
+			* @brief Configuration of a `DecimatorCore`.
+			*/
+			struct DecimatorConfig {
+
+				/** Number of channels in each block. */
+				uInt32 channels;
+
+				/** Decimation factor, shared by all channels. */
+				uInt32 factor;
+
+				/** Largest block accepted by `Process`, in samples per channel.
+				*   The working buffers are sized for it up front. */
+				uInt32 maxSamplesPerChannel;
+
+				/** Length of the default low-pass filter, in taps per phase; the
+				*   filter has `factor * tapsPerPhase` taps. */
+				uInt32 tapsPerPhase;
+
+				/** Cutoff of the default low-pass filter as a fraction of the
+				*   output Nyquist frequency, in (0, 1). */
+				float64 passband;
+			};
+
+			/**
+			* @brief Returns a configuration with the decimator defaults filled in.
+			*/
+			inline DecimatorConfig DefaultDecimatorConfig() {
+				DecimatorConfig config;
+				config.channels = 1;
+				config.factor = 10;
+				config.maxSamplesPerChannel = 10000;
+				config.tapsPerPhase = 16;
+				config.passband = 0.8;
+				return config;
+			}
+
+			/**
+			* @brief Polyphase FIR / CIC decimator for blocks of analog samples.
+			*
+			* Each channel has its own filter: the default windowed-sinc low-pass,
+			* taps set with `SetChannelFir`, or a CIC (`SetChannelCic`). CIC
+			* filters are evaluated in their non-recursive form so that no
+			* floating point integrator can drift over a long acquisition.
+			* Filter history and the decimation phase are carried from one block
+			* to the next, so a stream cut into blocks of any size gives the same
+			* output as one long block; output sample `m` is centered
+			* `(tapCount - 1) / 2` input samples before input sample `m * factor`.
+			*
+			* Blocks go in and out in either DAQmx fill mode; the stage
+			* deinterleaves on input and interleaves on output, so it can replace
+			* a separate layout conversion. `Process` allocates nothing and is
+			* meant to run on the thread that reads the task, e.g. inside the
+			* callback of `AcquisitionEngineCore`.
+			*
+			* Methods return `NativeStatus` codes. Not thread safe.
+			*/
+			class DecimatorCore {
+
+			public:
+				DecimatorCore();
+				~DecimatorCore();
+
+				DecimatorCore(const DecimatorCore&) = delete;
+				DecimatorCore& operator=(const DecimatorCore&) = delete;
+
+				/**
+				* @brief Allocates the working buffers, gives every channel the
+				*        default low-pass filter and clears the state.
+				*/
+				int32 Configure(const DecimatorConfig& config);
+
+				/**
+				* @brief Replaces the filter of one channel and clears its history.
+				*
+				* @param[in] taps Filter taps, in convolution order.
+				* @param[in] count Number of taps, 1 .. `MaxDecimatorTaps`.
+				*/
+				int32 SetChannelFir(uInt32 channel, const float64* taps, uInt32 count);
+
+				/**
+				* @brief Gives one channel a CIC filter with `stages` stages and
+				*        unity DC gain, and clears its history.
+				*/
+				int32 SetChannelCic(uInt32 channel, uInt32 stages);
+
+				/**
+				* @brief Copies the taps of one channel.
+				*
+				* @return The number of taps of the channel, or a negative status.
+				*/
+				int32 GetChannelTaps(uInt32 channel, float64* taps, uInt32 capacity) const;
+
+				/**
+				* @brief Scales I16 input with the polynomials of `scaling` before
+				*        filtering when the output is F64. `nullptr` filters the raw
+				*        codes. The object must outlive its use by the decimator.
+				*/
+				int32 SetScaling(const RawScalingCore* scaling);
+
+				/**
+				* @brief Clears the history of all channels and the phase, as at
+				*        the start of an acquisition.
+				*/
+				void Reset();
+
+				bool IsConfigured() const;
+
+				const DecimatorConfig& Config() const;
+
+				/**
+				* @brief Most samples per channel `Process` can return for an input
+				*        block of `samplesPerChannel` samples.
+				*/
+				uInt32 MaxOutputSamples(uInt32 samplesPerChannel) const;
+
+				/**
+				* @brief Number of output samples per channel produced since the
+				*        last `Reset`; the index of the next output sample.
+				*/
+				uInt64 OutputPosition() const;
+
+				/**
+				* @brief Filters and decimates one block.
+				*
+				* @param[in] in `channels * samplesPerChannel` samples.
+				* @param[in] samplesPerChannel Up to `maxSamplesPerChannel`.
+				* @param[in] inFillMode Layout of `in`.
+				* @param[out] out Decimated block.
+				* @param[in] outSize Size of `out`, in samples.
+				* @param[in] outFillMode Layout of `out`.
+				* @param[out] outSamplesPerChannel Samples per channel written.
+				*/
+				int32 Process(const float64* in, uInt32 samplesPerChannel, int32 inFillMode,
+					float64* out, size_t outSize, int32 outFillMode,
+					uInt32& outSamplesPerChannel);
+
+				/**
+				* @brief Filters raw codes into F64, scaled if `SetScaling` was given
+				*        a scaler.
+				*/
+				int32 Process(const int16* in, uInt32 samplesPerChannel, int32 inFillMode,
+					float64* out, size_t outSize, int32 outFillMode,
+					uInt32& outSamplesPerChannel);
+
+				/**
+				* @brief Filters raw codes into raw codes, rounded and saturated;
+				*        a linear device scaling still applies to the output. Ignores
+				*        `SetScaling`.
+				*/
+				int32 Process(const int16* in, uInt32 samplesPerChannel, int32 inFillMode,
+					int16* out, size_t outSize, int32 outFillMode,
+					uInt32& outSamplesPerChannel);
+
+				/**
+				* @brief Dispatches on `format`: F64 to F64 or I16 to I16, the
+				*        formats the acquisition engine reads.
+				*/
+				int32 Process(const void* in, SampleFormat format, uInt32 samplesPerChannel,
+					int32 inFillMode, void* out, size_t outSize, int32 outFillMode,
+					uInt32& outSamplesPerChannel);
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
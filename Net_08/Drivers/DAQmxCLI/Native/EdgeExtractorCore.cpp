@@ -0,0 +1,316 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "EdgeExtractorCore.h"
+
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "EdgeKernels.h"
+#include "NativeStatus.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				inline uInt32 LoadSample(const uint8_t* run, size_t i, uInt32 sampleBytes) {
+					switch (sampleBytes) {
+					case 1: return run[i];
+					case 2: return reinterpret_cast<const uInt16*>(run)[i];
+					default: return reinterpret_cast<const uInt32*>(run)[i];
+					}
+				}
+			}
+
+			struct EdgeExtractorCore::Impl {
+
+				EdgeExtractorConfig config;
+				bool configured;
+				uInt32 mask;
+
+				// Channel runs of blocks grouped by scan.
+				void* runScratch;
+				// Change positions, `maxSamplesPerChannel` per channel.
+				uInt32* positions;
+				std::vector<size_t> found;
+				std::vector<size_t> cursor;
+				std::vector<uInt32> values;
+				uInt64 position;
+
+				// Transition ring: the producer owns `head`, the consumer `tail`.
+				DigitalTransition* ring;
+				size_t ringMask;
+				alignas(CacheLineSize) std::atomic<uInt64> head;
+				alignas(CacheLineSize) std::atomic<uInt64> tail;
+
+				alignas(CacheLineSize) std::atomic<uInt64> samplesScanned;
+				std::atomic<uInt64> transitions;
+				std::atomic<uInt64> transitionsDropped;
+
+				Impl() :
+					config(DefaultEdgeExtractorConfig()), configured(false), mask(0),
+					runScratch(nullptr), positions(nullptr), position(0),
+					ring(nullptr), ringMask(0), head(0), tail(0),
+					samplesScanned(0), transitions(0), transitionsDropped(0) {}
+
+				~Impl() {
+					Free();
+				}
+
+				void Free() {
+					AlignedFree(runScratch);
+					AlignedFree(positions);
+					AlignedFree(ring);
+					runScratch = nullptr;
+					positions = nullptr;
+					ring = nullptr;
+				}
+
+				void Push(const DigitalTransition& transition) {
+
+					const uInt64 h = head.load(std::memory_order_relaxed);
+
+					if (h - tail.load(std::memory_order_acquire) > ringMask) {
+						transitionsDropped.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+
+					ring[h & ringMask] = transition;
+					head.store(h + 1, std::memory_order_release);
+				}
+
+				void Emit(uInt32 channel, uInt32 index, uInt32 sample) {
+
+					DigitalTransition t;
+					t.sampleIndex = position + index;
+					t.channel = channel;
+					t.value = sample & mask;
+					t.changed = t.value ^ values[channel];
+					t.reserved = 0;
+
+					values[channel] = t.value;
+					Push(t);
+				}
+			};
+
+			EdgeExtractorCore::EdgeExtractorCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			EdgeExtractorCore::~EdgeExtractorCore() {
+				delete _impl;
+				_impl = nullptr;
+			}
+
+			int32 EdgeExtractorCore::Configure(const EdgeExtractorConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (config.sampleBytes != 1 && config.sampleBytes != 2
+					&& config.sampleBytes != 4) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				if (config.channels == 0 || config.maxSamplesPerChannel == 0
+					|| config.capacity == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				impl.configured = false;
+				impl.config = config;
+				impl.mask = (config.sampleBytes == 4) ? config.mask
+					: config.mask & ((1u << (8 * config.sampleBytes)) - 1);
+
+				const size_t ringSize = RoundUpToPowerOfTwo((config.capacity < 2) ? 2 : config.capacity);
+
+				impl.Free();
+				impl.runScratch = AlignedAlloc((size_t)config.channels
+					* config.maxSamplesPerChannel * config.sampleBytes);
+				impl.positions = static_cast<uInt32*>(AlignedAlloc((size_t)config.channels
+					* config.maxSamplesPerChannel * sizeof(uInt32)));
+				impl.ring = static_cast<DigitalTransition*>(
+					AlignedAlloc(ringSize * sizeof(DigitalTransition)));
+				impl.ringMask = ringSize - 1;
+
+				if (impl.runScratch == nullptr || impl.positions == nullptr || impl.ring == nullptr) {
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				try {
+					impl.found.assign(config.channels, 0);
+					impl.cursor.assign(config.channels, 0);
+					impl.values.assign(config.channels, 0);
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.configured = true;
+				Reset();
+				return NativeSuccess;
+			}
+
+			void EdgeExtractorCore::Reset() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+				impl.position = 0;
+				impl.values.assign(impl.config.channels, 0);
+				impl.head.store(0);
+				impl.tail.store(0);
+				impl.samplesScanned.store(0);
+				impl.transitions.store(0);
+				impl.transitionsDropped.store(0);
+			}
+
+			bool EdgeExtractorCore::IsConfigured() const {
+				return _impl != nullptr && _impl->configured;
+			}
+
+			const EdgeExtractorConfig& EdgeExtractorCore::Config() const {
+				return _impl->config;
+			}
+
+			int32 EdgeExtractorCore::Process(const void* data, uInt32 samplesPerChannel,
+				int32 fillMode) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+				const uInt32 channels = impl.config.channels;
+				const uInt32 sampleBytes = impl.config.sampleBytes;
+
+				if (data == nullptr || samplesPerChannel > impl.config.maxSamplesPerChannel
+					|| (fillMode != DAQmx_Val_GroupByChannel
+						&& fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (samplesPerChannel == 0) {
+					return 0;
+				}
+
+				const uint8_t* runs = static_cast<const uint8_t*>(data);
+
+				if (fillMode == DAQmx_Val_GroupByScanNumber && channels > 1) {
+					Deinterleave(data, impl.runScratch, channels, samplesPerChannel, sampleBytes);
+					runs = static_cast<const uint8_t*>(impl.runScratch);
+				}
+
+				const size_t runBytes = (size_t)samplesPerChannel * sampleBytes;
+				const size_t stride = impl.config.maxSamplesPerChannel;
+				size_t total = 0;
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					impl.found[ch] = FindChanges(runs + ch * runBytes, samplesPerChannel,
+						sampleBytes, impl.values[ch], impl.mask, impl.positions + ch * stride);
+					impl.cursor[ch] = 0;
+					total += impl.found[ch];
+				}
+
+				// Merge the per-channel positions by sample index; ties go to
+				// the lower channel.
+				for (size_t emitted = 0; emitted < total; emitted++) {
+
+					uInt32 next = 0;
+					uInt32 best = 0xFFFFFFFFu;
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						if (impl.cursor[ch] < impl.found[ch]) {
+							const uInt32 p = impl.positions[ch * stride + impl.cursor[ch]];
+							if (p < best) {
+								best = p;
+								next = ch;
+							}
+						}
+					}
+
+					impl.cursor[next]++;
+					impl.Emit(next, best, LoadSample(runs + next * runBytes, best, sampleBytes));
+				}
+
+				impl.position += samplesPerChannel;
+				impl.transitions.fetch_add(total, std::memory_order_relaxed);
+				impl.samplesScanned.store(impl.position, std::memory_order_relaxed);
+				return (int32)total;
+			}
+
+			size_t EdgeExtractorCore::ReadTransitions(DigitalTransition* transitions,
+				size_t capacity) {
+
+				if (_impl == nullptr || !_impl->configured || transitions == nullptr) {
+					return 0;
+				}
+
+				Impl& impl = *_impl;
+				const uInt64 t = impl.tail.load(std::memory_order_relaxed);
+				const uInt64 h = impl.head.load(std::memory_order_acquire);
+				const size_t n = (size_t)((h - t < capacity) ? h - t : capacity);
+
+				for (size_t k = 0; k < n; k++) {
+					transitions[k] = impl.ring[(t + k) & impl.ringMask];
+				}
+
+				impl.tail.store(t + n, std::memory_order_release);
+				return n;
+			}
+
+			size_t EdgeExtractorCore::PendingTransitions() const {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return 0;
+				}
+				return (size_t)(_impl->head.load(std::memory_order_acquire)
+					- _impl->tail.load(std::memory_order_acquire));
+			}
+
+			EdgeExtractorCounters EdgeExtractorCore::Counters() const {
+
+				EdgeExtractorCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.samplesScanned = _impl->samplesScanned.load(std::memory_order_relaxed);
+					counters.transitions = _impl->transitions.load(std::memory_order_relaxed);
+					counters.transitionsDropped = _impl->transitionsDropped.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			uInt64 EdgeExtractorCore::Position() const {
+				return (_impl != nullptr) ? _impl->samplesScanned.load(std::memory_order_relaxed) : 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the edge extractor. Safe to include from code compiled with
+* /clr; the change scan, the merge and the transition ring live in
+* EdgeExtractorCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "TransitionFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Settings of an `EdgeExtractorCore`.
+			*/
+			struct EdgeExtractorConfig {
+
+				/** Number of channels in each block. */
+				uInt32 channels;
+
+				/** Bytes per sample: 1, 2 or 4, as read by `DAQmxReadDigitalU8`,
+				*   `U16` or `U32`. */
+				uInt32 sampleBytes;
+
+				/** Lines watched; changes of the other lines are ignored and
+				*   masked out of `DigitalTransition::value`. */
+				uInt32 mask;
+
+				/** Largest block accepted, in samples per channel. */
+				uInt32 maxSamplesPerChannel;
+
+				/** Transitions the ring holds until they are read. */
+				uInt32 capacity;
+			};
+
+			inline EdgeExtractorConfig DefaultEdgeExtractorConfig() {
+
+				EdgeExtractorConfig config;
+				config.channels = 1;
+				config.sampleBytes = 4;
+				config.mask = 0xFFFFFFFFu;
+				config.maxSamplesPerChannel = 10000;
+				config.capacity = 65536;
+				return config;
+			}
+
+			/**
+			* @brief Counters of the extractor. Read without locking.
+			*/
+			struct EdgeExtractorCounters {
+				uInt64 samplesScanned;
+				uInt64 transitions;
+				/** Transitions lost because the ring was full. */
+				uInt64 transitionsDropped;
+			};
+
+			/**
+			* @brief Turns a continuous stream of digital words into transition
+			*        records.
+			*
+			* Every block is scanned channel by channel with the kernels of
+			* EdgeKernels.h (blocks interleaved by scan are first split with
+			* the transpose kernels), and the positions found are merged into
+			* records ordered by sample index, then channel. The records go
+			* into a preallocated lock-free ring; only they leave native code.
+			* Every channel starts with all lines low, so the first sample with
+			* a line high is a transition too.
+			*
+			* Records carry the new value next to the changed lines, so a
+			* consumer that lost records because the ring was full still sees
+			* the right state after the next one.
+			*
+			* `Process` runs on one producer thread, e.g. the loop reading the
+			* task, and one consumer thread reads the records. `Configure` and
+			* `Reset` must not run concurrently with either.
+			*/
+			class EdgeExtractorCore {
+
+			public:
+				EdgeExtractorCore();
+				~EdgeExtractorCore();
+
+				EdgeExtractorCore(const EdgeExtractorCore&) = delete;
+				EdgeExtractorCore& operator=(const EdgeExtractorCore&) = delete;
+
+				/**
+				* @brief Allocates the scratch buffers and the ring and resets.
+				*
+				* @return `0`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorUnsupportedFormat` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Configure(const EdgeExtractorConfig& config);
+
+				/**
+				* @brief Clears the channel states, the counters and the ring.
+				*/
+				void Reset();
+
+				bool IsConfigured() const;
+
+				const EdgeExtractorConfig& Config() const;
+
+				/**
+				* @brief Scans one block.
+				*
+				* @param[in] data `channels * samplesPerChannel` samples of
+				*            `sampleBytes` bytes.
+				* @param[in] samplesPerChannel At most `maxSamplesPerChannel`.
+				* @param[in] fillMode Layout of `data`.
+				*
+				* @return The number of transitions in the block, including
+				*         dropped ones, or a negative status.
+				*/
+				int32 Process(const void* data, uInt32 samplesPerChannel, int32 fillMode);
+
+				/**
+				* @brief Moves up to `capacity` of the oldest transitions to
+				*        `transitions` without waiting.
+				*
+				* @return The number of transitions moved.
+				*/
+				size_t ReadTransitions(DigitalTransition* transitions, size_t capacity);
+
+				size_t PendingTransitions() const;
+
+				EdgeExtractorCounters Counters() const;
+
+				/**
+				* @brief Samples per channel processed since the last reset.
+				*/
+				uInt64 Position() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
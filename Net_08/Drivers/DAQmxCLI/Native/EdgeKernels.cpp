@@ -0,0 +1,269 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "EdgeKernels.h"
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Index of the lowest set bit of a non-zero mask.
+				inline uInt32 LowestSetBit(uInt32 mask) {
+#if defined(_MSC_VER)
+					unsigned long index;
+					_BitScanForward(&index, mask);
+					return (uInt32)index;
+#else
+					return (uInt32)__builtin_ctz(mask);
+#endif
+				}
+
+				// Appends `base + k / shift` for every set bit `k` of `bits`.
+				inline size_t EmitBits(uInt32 bits, size_t base, uInt32 shift,
+					uInt32* positions, size_t n) {
+
+					while (bits != 0) {
+						positions[n++] = (uInt32)(base + (LowestSetBit(bits) >> shift));
+						bits &= bits - 1;
+					}
+					return n;
+				}
+
+				template <typename T>
+				size_t FindChangesScalar(const T* x, size_t begin, size_t count, T mask,
+					uInt32* positions, size_t n) {
+
+					for (size_t i = begin; i < count; i++) {
+						if (((x[i] ^ x[i - 1]) & mask) != 0) {
+							positions[n++] = (uInt32)i;
+						}
+					}
+					return n;
+				}
+
+#if NATIVE_X86
+				// Vector loops start at sample 1, so `x + i - 1` is always
+				// inside the block; sample 0 is compared with `previous` by
+				// the caller.
+
+				size_t FindChangesU8Sse2(const uInt8* x, size_t count, uInt8 mask,
+					uInt32* positions) {
+
+					const __m128i m = _mm_set1_epi8((char)mask);
+					const __m128i zero = _mm_setzero_si128();
+					size_t n = 0;
+					size_t i = 1;
+
+					for (; i + 16 <= count; i += 16) {
+						const __m128i d = _mm_and_si128(m, _mm_xor_si128(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)),
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i - 1))));
+						const uInt32 bits = ~(uInt32)_mm_movemask_epi8(_mm_cmpeq_epi8(d, zero)) & 0xFFFFu;
+						n = EmitBits(bits, i, 0, positions, n);
+					}
+					return FindChangesScalar(x, i, count, mask, positions, n);
+				}
+
+				size_t FindChangesU16Sse2(const uInt16* x, size_t count, uInt16 mask,
+					uInt32* positions) {
+
+					const __m128i m = _mm_set1_epi16((short)mask);
+					const __m128i zero = _mm_setzero_si128();
+					size_t n = 0;
+					size_t i = 1;
+
+					for (; i + 8 <= count; i += 8) {
+						const __m128i d = _mm_and_si128(m, _mm_xor_si128(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)),
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i - 1))));
+						// Two mask bits per sample; keep the even one.
+						const uInt32 bits = ~(uInt32)_mm_movemask_epi8(_mm_cmpeq_epi16(d, zero)) & 0x5555u;
+						n = EmitBits(bits, i, 1, positions, n);
+					}
+					return FindChangesScalar(x, i, count, mask, positions, n);
+				}
+
+				size_t FindChangesU32Sse2(const uInt32* x, size_t count, uInt32 mask,
+					uInt32* positions) {
+
+					const __m128i m = _mm_set1_epi32((int)mask);
+					const __m128i zero = _mm_setzero_si128();
+					size_t n = 0;
+					size_t i = 1;
+
+					for (; i + 4 <= count; i += 4) {
+						const __m128i d = _mm_and_si128(m, _mm_xor_si128(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)),
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i - 1))));
+						const uInt32 bits = ~(uInt32)_mm_movemask_ps(
+							_mm_castsi128_ps(_mm_cmpeq_epi32(d, zero))) & 0xFu;
+						n = EmitBits(bits, i, 0, positions, n);
+					}
+					return FindChangesScalar(x, i, count, mask, positions, n);
+				}
+
+				NATIVE_TARGET_AVX2
+				size_t FindChangesU8Avx2(const uInt8* x, size_t count, uInt8 mask,
+					uInt32* positions) {
+
+					const __m256i m = _mm256_set1_epi8((char)mask);
+					const __m256i zero = _mm256_setzero_si256();
+					size_t n = 0;
+					size_t i = 1;
+
+					for (; i + 32 <= count; i += 32) {
+						const __m256i d = _mm256_and_si256(m, _mm256_xor_si256(
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)),
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 1))));
+						const uInt32 bits = ~(uInt32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, zero));
+						n = EmitBits(bits, i, 0, positions, n);
+					}
+					return FindChangesScalar(x, i, count, mask, positions, n);
+				}
+
+				NATIVE_TARGET_AVX2
+				size_t FindChangesU16Avx2(const uInt16* x, size_t count, uInt16 mask,
+					uInt32* positions) {
+
+					const __m256i m = _mm256_set1_epi16((short)mask);
+					const __m256i zero = _mm256_setzero_si256();
+					size_t n = 0;
+					size_t i = 1;
+
+					for (; i + 16 <= count; i += 16) {
+						const __m256i d = _mm256_and_si256(m, _mm256_xor_si256(
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)),
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 1))));
+						const uInt32 bits = ~(uInt32)_mm256_movemask_epi8(
+							_mm256_cmpeq_epi16(d, zero)) & 0x55555555u;
+						n = EmitBits(bits, i, 1, positions, n);
+					}
+					return FindChangesScalar(x, i, count, mask, positions, n);
+				}
+
+				NATIVE_TARGET_AVX2
+				size_t FindChangesU32Avx2(const uInt32* x, size_t count, uInt32 mask,
+					uInt32* positions) {
+
+					const __m256i m = _mm256_set1_epi32((int)mask);
+					const __m256i zero = _mm256_setzero_si256();
+					size_t n = 0;
+					size_t i = 1;
+
+					for (; i + 8 <= count; i += 8) {
+						const __m256i d = _mm256_and_si256(m, _mm256_xor_si256(
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)),
+							_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 1))));
+						const uInt32 bits = ~(uInt32)_mm256_movemask_ps(
+							_mm256_castsi256_ps(_mm256_cmpeq_epi32(d, zero))) & 0xFFu;
+						n = EmitBits(bits, i, 0, positions, n);
+					}
+					return FindChangesScalar(x, i, count, mask, positions, n);
+				}
+#endif
+
+				template <typename T>
+				size_t FindChangesFrom1(const T* x, size_t count, T mask, uInt32* positions) {
+
+#if NATIVE_X86
+					const SimdLevel level = ActiveSimdLevel();
+
+					if (sizeof(T) == 1) {
+						const uInt8* x8 = reinterpret_cast<const uInt8*>(x);
+						if (level == SimdLevel::Avx2) {
+							return FindChangesU8Avx2(x8, count, (uInt8)mask, positions);
+						}
+						if (level != SimdLevel::Scalar) {
+							return FindChangesU8Sse2(x8, count, (uInt8)mask, positions);
+						}
+					}
+					else if (sizeof(T) == 2) {
+						const uInt16* x16 = reinterpret_cast<const uInt16*>(x);
+						if (level == SimdLevel::Avx2) {
+							return FindChangesU16Avx2(x16, count, (uInt16)mask, positions);
+						}
+						if (level != SimdLevel::Scalar) {
+							return FindChangesU16Sse2(x16, count, (uInt16)mask, positions);
+						}
+					}
+					else {
+						const uInt32* x32 = reinterpret_cast<const uInt32*>(x);
+						if (level == SimdLevel::Avx2) {
+							return FindChangesU32Avx2(x32, count, (uInt32)mask, positions);
+						}
+						if (level != SimdLevel::Scalar) {
+							return FindChangesU32Sse2(x32, count, (uInt32)mask, positions);
+						}
+					}
+#endif
+					return FindChangesScalar(x, 1, count, mask, positions, 0);
+				}
+
+				template <typename T>
+				size_t FindChangesOf(const T* x, size_t count, uInt32 previous, uInt32 mask,
+					uInt32* positions) {
+
+					if (count == 0) {
+						return 0;
+					}
+
+					size_t n = 0;
+
+					if (((x[0] ^ (T)previous) & (T)mask) != 0) {
+						positions[n++] = 0;
+					}
+					return n + FindChangesFrom1(x, count, (T)mask, positions + n);
+				}
+			}
+
+			size_t FindChanges(const void* data, size_t count, uInt32 sampleBytes,
+				uInt32 previous, uInt32 mask, uInt32* positions) {
+
+				switch (sampleBytes) {
+				case 1:
+					return FindChangesOf(static_cast<const uInt8*>(data), count, previous,
+						mask, positions);
+				case 2:
+					return FindChangesOf(static_cast<const uInt16*>(data), count, previous,
+						mask, positions);
+				case 4:
+					return FindChangesOf(static_cast<const uInt32*>(data), count, previous,
+						mask, positions);
+				default:
+					return 0;
+				}
+			}
+		}
+	}
+}
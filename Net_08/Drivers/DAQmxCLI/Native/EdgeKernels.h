@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized change detection of the edge extractor.
+*
+* A digital stream that changes rarely is mostly runs of equal words. The
+* kernels compare every word with its predecessor (the same vector loaded
+* one element earlier), reduce the comparison to a bit mask with movemask
+* and only leave the vector loop for the set bits, which they turn into
+* sample positions with a count of trailing zeros: 32 (U8), 16 (U16) or 8
+* (U32) samples per AVX2 step, half as many with SSE2.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Positions `i` of the `count` samples at which
+			*        `(x[i] ^ x[i - 1]) & mask` is non-zero, with `x[-1] =
+			*        previous`, in increasing order.
+			*
+			* @param[in] data `count` samples of `sampleBytes` (1, 2 or 4) bytes.
+			* @param[out] positions Room for `count` positions.
+			*
+			* @return The number of positions written; `0` for an unsupported
+			*         sample size.
+			*/
+			size_t FindChanges(const void* data, size_t count, uInt32 sampleBytes,
+				uInt32 previous, uInt32 mask, uInt32* positions);
+		}
+	}
+}
@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "LatencyHistogram.h"
+
+#include <atomic>
+#include <limits>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const uInt32 SubBuckets = 1u << LatencySubBucketBits;
+
+				inline uInt32 HighestBit(uInt64 value) {
+#if defined(_MSC_VER)
+					unsigned long index;
+					_BitScanReverse64(&index, value);
+					return (uInt32)index;
+#else
+					return 63u - (uInt32)__builtin_clzll(value);
+#endif
+				}
+
+				void UpdateMin(std::atomic<int64>& target, int64 value) {
+
+					int64 current = target.load(std::memory_order_relaxed);
+
+					while (value < current
+						&& !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+					}
+				}
+
+				void UpdateMax(std::atomic<int64>& target, int64 value) {
+
+					int64 current = target.load(std::memory_order_relaxed);
+
+					while (value > current
+						&& !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+					}
+				}
+			}
+
+			struct LatencyHistogram::Impl {
+
+				std::atomic<uInt64> buckets[LatencyBucketCount];
+				std::atomic<uInt64> count;
+				std::atomic<uInt64> sumNs;
+				std::atomic<int64> minNs;
+				std::atomic<int64> maxNs;
+
+				Impl() {
+					Clear();
+				}
+
+				void Clear() {
+
+					for (uInt32 k = 0; k < LatencyBucketCount; k++) {
+						buckets[k].store(0, std::memory_order_relaxed);
+					}
+					count.store(0, std::memory_order_relaxed);
+					sumNs.store(0, std::memory_order_relaxed);
+					minNs.store(std::numeric_limits<int64>::max(), std::memory_order_relaxed);
+					maxNs.store(0, std::memory_order_relaxed);
+				}
+			};
+
+
+			LatencyHistogram::LatencyHistogram() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			LatencyHistogram::~LatencyHistogram() {
+				delete _impl;
+			}
+
+			bool LatencyHistogram::IsValid() const {
+				return _impl != nullptr;
+			}
+
+			uInt32 LatencyHistogram::BucketOf(int64 ns) {
+
+				if (ns < (int64)SubBuckets) {
+					return (ns < 0) ? 0 : (uInt32)ns;
+				}
+
+				const uInt32 bit = HighestBit((uInt64)ns);
+
+				if (bit >= LatencyMaxBits) {
+					return LatencyBucketCount - 1;
+				}
+
+				// `2^bit` to `2^(bit + 1)` in `SubBuckets` equal steps.
+				const uInt32 shift = bit - LatencySubBucketBits;
+				const uInt32 sub = (uInt32)((uInt64)ns >> shift) - SubBuckets;
+				return SubBuckets + shift * SubBuckets + sub;
+			}
+
+			int64 LatencyHistogram::BucketLowestNs(uInt32 index) {
+
+				if (index < SubBuckets) {
+					return (int64)index;
+				}
+
+				const uInt32 shift = (index - SubBuckets) / SubBuckets;
+				const uInt32 sub = (index - SubBuckets) % SubBuckets;
+				return (int64)((uInt64)(SubBuckets + sub) << shift);
+			}
+
+			int64 LatencyHistogram::BucketHighestNs(uInt32 index) {
+
+				if (index < SubBuckets) {
+					return (int64)index;
+				}
+
+				const uInt32 shift = (index - SubBuckets) / SubBuckets;
+				return BucketLowestNs(index) + ((int64)1 << shift) - 1;
+			}
+
+			void LatencyHistogram::Record(int64 ns) {
+
+				if (_impl == nullptr) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+				const int64 value = (ns < 0) ? 0 : ns;
+
+				impl.buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+				impl.sumNs.fetch_add((uInt64)value, std::memory_order_relaxed);
+				UpdateMin(impl.minNs, value);
+				UpdateMax(impl.maxNs, value);
+				impl.count.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			uInt64 LatencyHistogram::Count() const {
+				return (_impl != nullptr) ? _impl->count.load(std::memory_order_relaxed) : 0;
+			}
+
+			int64 LatencyHistogram::ValueAtPercentile(float64 percentile) const {
+
+				if (_impl == nullptr) {
+					return 0;
+				}
+
+				const Impl& impl = *_impl;
+				uInt64 total = 0;
+
+				for (uInt32 k = 0; k < LatencyBucketCount; k++) {
+					total += impl.buckets[k].load(std::memory_order_relaxed);
+				}
+
+				if (total == 0) {
+					return 0;
+				}
+
+				const float64 clamped = (percentile < 0.0) ? 0.0
+					: (percentile > 100.0) ? 100.0 : percentile;
+				const uInt64 rank = (uInt64)(clamped / 100.0 * (float64)(total - 1)) + 1;
+				const int64 maxNs = impl.maxNs.load(std::memory_order_relaxed);
+				uInt64 seen = 0;
+
+				for (uInt32 k = 0; k < LatencyBucketCount; k++) {
+					seen += impl.buckets[k].load(std::memory_order_relaxed);
+					if (seen >= rank) {
+						const int64 highest = BucketHighestNs(k);
+						return (highest < maxNs) ? highest : maxNs;
+					}
+				}
+				return maxNs;
+			}
+
+			LatencySummary LatencyHistogram::Summary() const {
+
+				LatencySummary summary = {};
+
+				if (_impl == nullptr) {
+					return summary;
+				}
+
+				const Impl& impl = *_impl;
+				summary.count = impl.count.load(std::memory_order_relaxed);
+
+				if (summary.count == 0) {
+					return summary;
+				}
+
+				summary.minNs = impl.minNs.load(std::memory_order_relaxed);
+				summary.maxNs = impl.maxNs.load(std::memory_order_relaxed);
+				summary.meanNs = (int64)(impl.sumNs.load(std::memory_order_relaxed) / summary.count);
+				summary.p50Ns = ValueAtPercentile(50.0);
+				summary.p90Ns = ValueAtPercentile(90.0);
+				summary.p99Ns = ValueAtPercentile(99.0);
+				summary.p999Ns = ValueAtPercentile(99.9);
+				return summary;
+			}
+
+			size_t LatencyHistogram::ReadBuckets(uInt64* counts, size_t capacity) const {
+
+				if (_impl == nullptr || counts == nullptr) {
+					return 0;
+				}
+
+				const size_t n = (capacity < LatencyBucketCount) ? capacity : LatencyBucketCount;
+
+				for (size_t k = 0; k < n; k++) {
+					counts[k] = _impl->buckets[k].load(std::memory_order_relaxed);
+				}
+				return n;
+			}
+
+			void LatencyHistogram::Reset() {
+
+				if (_impl != nullptr) {
+					_impl->Clear();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the latency histogram of the callback path. Safe to include
+* from code compiled with /clr; the atomic buckets live in
+* LatencyHistogram.cpp.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/** Buckets per power of two: values are kept to 1/64 of their
+			*   size. */
+			constexpr uInt32 LatencySubBucketBits = 6;
+
+			/** Latencies from `2^LatencyMaxBits` ns (about 69 s) on all go to
+			*   the last bucket. */
+			constexpr uInt32 LatencyMaxBits = 36;
+
+			constexpr uInt32 LatencyBucketCount =
+				(1u << LatencySubBucketBits) * (LatencyMaxBits - LatencySubBucketBits + 1);
+
+			/**
+			* @brief Count, extremes and percentiles of a `LatencyHistogram`,
+			*        in nanoseconds. All `0` when `count` is 0.
+			*/
+			struct LatencySummary {
+				uInt64 count;
+				int64 minNs;
+				int64 maxNs;
+				int64 meanNs;
+				int64 p50Ns;
+				int64 p90Ns;
+				int64 p99Ns;
+				int64 p999Ns;
+			};
+
+			/**
+			* @brief HDR-style histogram of latencies in nanoseconds.
+			*
+			* Below `2^LatencySubBucketBits` ns every value has a bucket of its
+			* own; above, each power of two is split into
+			* `2^LatencySubBucketBits` equal buckets, so a percentile is off by
+			* at most 1/64 of its value from 64 ns to a minute with a fixed
+			* `LatencyBucketCount` buckets (about 16 KB).
+			*
+			* `Record` is wait-free and may be called from any number of
+			* threads; the readers see each bucket exactly but not the buckets
+			* as of one instant, which is fine for percentiles of a running
+			* system.
+			*/
+			class LatencyHistogram {
+
+			public:
+				LatencyHistogram();
+				~LatencyHistogram();
+
+				LatencyHistogram(const LatencyHistogram&) = delete;
+				LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+				/** `false` if the buckets could not be allocated; nothing
+				*   is recorded then. */
+				bool IsValid() const;
+
+				/** Adds one latency; negative ones count as 0. */
+				void Record(int64 ns);
+
+				uInt64 Count() const;
+
+				/**
+				* @brief The latency `percentile` percent of the recorded ones
+				*        do not exceed: the highest value of its bucket, at
+				*        most the largest recorded.
+				*
+				* @param[in] percentile 0 to 100.
+				*/
+				int64 ValueAtPercentile(float64 percentile) const;
+
+				LatencySummary Summary() const;
+
+				/**
+				* @brief Copies up to `capacity` bucket counts.
+				*
+				* @return The number of buckets copied.
+				*/
+				size_t ReadBuckets(uInt64* counts, size_t capacity) const;
+
+				/** Clears the histogram; may be called while it records. */
+				void Reset();
+
+				/** Lowest value of bucket `index`. */
+				static int64 BucketLowestNs(uInt32 index);
+
+				/** Highest value of bucket `index`. */
+				static int64 BucketHighestNs(uInt32 index);
+
+				/** Bucket of `ns`. */
+				static uInt32 BucketOf(int64 ns);
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
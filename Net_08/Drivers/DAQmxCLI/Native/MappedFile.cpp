@@ -0,0 +1,339 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+#if defined(_WIN32)
+			namespace {
+
+				HANDLE ToHandle(intptr_t handle) {
+					return reinterpret_cast<HANDLE>(handle);
+				}
+
+				const intptr_t NoHandle = reinterpret_cast<intptr_t>(INVALID_HANDLE_VALUE);
+
+				bool Utf8ToWide(const char* path, std::vector<wchar_t>& wide) {
+
+					int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+					if (length <= 0) {
+						return false;
+					}
+					wide.resize((size_t)length);
+					return MultiByteToWideChar(CP_UTF8, 0, path, -1, wide.data(), length) > 0;
+				}
+			}
+
+			MappedFile::MappedFile() : _handle(NoHandle), _size(0), _writable(false) {}
+
+			bool MappedFile::Create(const char* path) {
+
+				Close();
+
+				std::vector<wchar_t> wide;
+				if (path == nullptr || !Utf8ToWide(path, wide)) {
+					return false;
+				}
+
+				HANDLE file = CreateFileW(wide.data(), GENERIC_READ | GENERIC_WRITE,
+					FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+				if (file == INVALID_HANDLE_VALUE) {
+					return false;
+				}
+
+				_handle = reinterpret_cast<intptr_t>(file);
+				_size = 0;
+				_writable = true;
+				return true;
+			}
+
+			bool MappedFile::OpenReadOnly(const char* path) {
+
+				Close();
+
+				std::vector<wchar_t> wide;
+				if (path == nullptr || !Utf8ToWide(path, wide)) {
+					return false;
+				}
+
+				HANDLE file = CreateFileW(wide.data(), GENERIC_READ,
+					FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL, NULL);
+
+				if (file == INVALID_HANDLE_VALUE) {
+					return false;
+				}
+
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(file, &size)) {
+					CloseHandle(file);
+					return false;
+				}
+
+				_handle = reinterpret_cast<intptr_t>(file);
+				_size = (uint64_t)size.QuadPart;
+				_writable = false;
+				return true;
+			}
+
+			void MappedFile::Close() {
+
+				if (_handle != NoHandle) {
+					CloseHandle(ToHandle(_handle));
+					_handle = NoHandle;
+				}
+				_size = 0;
+			}
+
+			bool MappedFile::IsOpen() const {
+				return _handle != NoHandle;
+			}
+
+			bool MappedFile::Reserve(uint64_t size) {
+
+				if (!_writable || size <= _size) {
+					return _writable;
+				}
+
+				// Setting the end of file allocates the clusters on NTFS.
+				return Truncate(size);
+			}
+
+			bool MappedFile::Truncate(uint64_t size) {
+
+				if (!_writable) {
+					return false;
+				}
+
+				LARGE_INTEGER position;
+				position.QuadPart = (LONGLONG)size;
+
+				if (!SetFilePointerEx(ToHandle(_handle), position, NULL, FILE_BEGIN)
+					|| !SetEndOfFile(ToHandle(_handle))) {
+					return false;
+				}
+
+				_size = size;
+				return true;
+			}
+
+			void* MappedFile::Map(uint64_t offset, size_t length, bool writable) {
+
+				if (_handle == NoHandle || length == 0 || offset + length > _size
+					|| (writable && !_writable)) {
+					return nullptr;
+				}
+
+				const uint64_t end = offset + length;
+
+				HANDLE mapping = CreateFileMappingW(ToHandle(_handle), NULL,
+					writable ? PAGE_READWRITE : PAGE_READONLY,
+					(DWORD)(end >> 32), (DWORD)(end & 0xFFFFFFFFu), NULL);
+
+				if (mapping == NULL) {
+					return nullptr;
+				}
+
+				void* view = MapViewOfFile(mapping,
+					writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+					(DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFFu), length);
+
+				// The view keeps the mapping object alive.
+				CloseHandle(mapping);
+				return view;
+			}
+
+			void MappedFile::Unmap(void* view, size_t length, bool flush) {
+
+				if (view == nullptr) {
+					return;
+				}
+				if (flush) {
+					FlushViewOfFile(view, length);
+				}
+				UnmapViewOfFile(view);
+			}
+
+			bool MappedFile::Sync() {
+				return _writable && FlushFileBuffers(ToHandle(_handle)) != 0;
+			}
+
+			size_t MappedFile::Granularity() {
+
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return (size_t)info.dwAllocationGranularity;
+			}
+
+#else
+			MappedFile::MappedFile() : _handle(-1), _size(0), _writable(false) {}
+
+			bool MappedFile::Create(const char* path) {
+
+				Close();
+
+				if (path == nullptr) {
+					return false;
+				}
+
+				int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+				if (fd < 0) {
+					return false;
+				}
+
+				_handle = fd;
+				_size = 0;
+				_writable = true;
+				return true;
+			}
+
+			bool MappedFile::OpenReadOnly(const char* path) {
+
+				Close();
+
+				if (path == nullptr) {
+					return false;
+				}
+
+				int fd = ::open(path, O_RDONLY);
+				if (fd < 0) {
+					return false;
+				}
+
+				struct stat info;
+				if (::fstat(fd, &info) != 0) {
+					::close(fd);
+					return false;
+				}
+
+				_handle = fd;
+				_size = (uint64_t)info.st_size;
+				_writable = false;
+				return true;
+			}
+
+			void MappedFile::Close() {
+
+				if (_handle >= 0) {
+					::close((int)_handle);
+					_handle = -1;
+				}
+				_size = 0;
+			}
+
+			bool MappedFile::IsOpen() const {
+				return _handle >= 0;
+			}
+
+			bool MappedFile::Reserve(uint64_t size) {
+
+				if (!_writable || size <= _size) {
+					return _writable;
+				}
+
+				// posix_fallocate fails on file systems without support for it
+				// (e.g. tmpfs on old kernels); a sparse extension still works.
+				if (::posix_fallocate((int)_handle, (off_t)_size, (off_t)(size - _size)) != 0
+					&& ::ftruncate((int)_handle, (off_t)size) != 0) {
+					return false;
+				}
+
+				_size = size;
+				return true;
+			}
+
+			bool MappedFile::Truncate(uint64_t size) {
+
+				if (!_writable || ::ftruncate((int)_handle, (off_t)size) != 0) {
+					return false;
+				}
+
+				_size = size;
+				return true;
+			}
+
+			void* MappedFile::Map(uint64_t offset, size_t length, bool writable) {
+
+				if (_handle < 0 || length == 0 || offset + length > _size
+					|| (writable && !_writable)) {
+					return nullptr;
+				}
+
+				void* view = ::mmap(nullptr, length,
+					writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+					MAP_SHARED, (int)_handle, (off_t)offset);
+
+				if (view == MAP_FAILED) {
+					return nullptr;
+				}
+
+				::madvise(view, length, MADV_SEQUENTIAL);
+				return view;
+			}
+
+			void MappedFile::Unmap(void* view, size_t length, bool flush) {
+
+				if (view == nullptr) {
+					return;
+				}
+				if (flush) {
+					::msync(view, length, MS_ASYNC);
+				}
+				::munmap(view, length);
+			}
+
+			bool MappedFile::Sync() {
+				return _writable && ::fsync((int)_handle) == 0;
+			}
+
+			size_t MappedFile::Granularity() {
+				return (size_t)::sysconf(_SC_PAGESIZE);
+			}
+#endif
+
+			MappedFile::~MappedFile() {
+				Close();
+			}
+
+			uint64_t MappedFile::Size() const {
+				return _size;
+			}
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Thin portable wrapper over memory-mapped files: CreateFileMapping /
+* MapViewOfFile on Windows, mmap on POSIX. Native only; the recorder and
+* reader facades use it from their translation units.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief A file that is grown in large steps and accessed through
+			*        mapped views.
+			*
+			* View offsets must be multiples of `MappedFile::Granularity()`
+			* (64 KiB on Windows, the page size elsewhere). Views stay valid until
+			* they are unmapped, even if the file is extended meanwhile.
+			*/
+			class MappedFile {
+
+			public:
+				MappedFile();
+				~MappedFile();
+
+				MappedFile(const MappedFile&) = delete;
+				MappedFile& operator=(const MappedFile&) = delete;
+
+				/**
+				* @brief Creates (or truncates) a file for reading and writing.
+				*
+				* @param[in] path UTF-8 path.
+				*/
+				bool Create(const char* path);
+
+				/**
+				* @brief Opens an existing file read-only.
+				*/
+				bool OpenReadOnly(const char* path);
+
+				void Close();
+
+				bool IsOpen() const;
+
+				/**
+				* @brief Current size of the file, in bytes.
+				*/
+				uint64_t Size() const;
+
+				/**
+				* @brief Grows the file to `size` bytes and reserves the disk space,
+				*        so that writes through a view cannot fail for lack of space.
+				*/
+				bool Reserve(uint64_t size);
+
+				/**
+				* @brief Sets the file size, dropping anything beyond it.
+				*/
+				bool Truncate(uint64_t size);
+
+				/**
+				* @brief Maps `length` bytes at `offset`.
+				*
+				* @return The address of the view, or `nullptr` on failure.
+				*/
+				void* Map(uint64_t offset, size_t length, bool writable);
+
+				/**
+				* @brief Unmaps a view returned by `Map`.
+				*
+				* @param[in] flush If `true`, schedules the dirty pages for writing
+				*                  before the view is released.
+				*/
+				static void Unmap(void* view, size_t length, bool flush);
+
+				/**
+				* @brief Flushes file data and metadata to the disk.
+				*/
+				bool Sync();
+
+				/**
+				* @brief Required alignment of view offsets.
+				*/
+				static size_t Granularity();
+
+			private:
+				intptr_t _handle;
+				uint64_t _size;
+				bool _writable;
+			};
+		}
+	}
+}
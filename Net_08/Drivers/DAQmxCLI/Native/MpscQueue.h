@@ -0,0 +1,242 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Native only: uses <atomic> and must not be included from code compiled
+* with /clr. Managed wrappers reach the queue through CallbackDispatcherCore.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "AlignedMemory.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Bounded lock-free multi-producer/single-consumer queue of
+			*        trivially copyable values.
+			*
+			* Every cell carries a sequence number that tells producers whether
+			* the cell is free for their position and the consumer whether it
+			* was published. A producer claims a position with one
+			* compare-exchange on the shared head, copies its value and
+			* publishes the cell; it never waits for another producer or the
+			* consumer, and `TryPush` fails instead of waiting when the queue is
+			* full. So the producers can be driver callback threads.
+			*
+			* All memory is allocated once by `Allocate`.
+			*
+			* @tparam T Trivially copyable value.
+			*/
+			template <typename T>
+			class MpscQueue {
+
+			public:
+				MpscQueue() :
+					_cells(nullptr), _capacity(0), _mask(0),
+					_head(0), _tail(0) {}
+
+				~MpscQueue() {
+					Free();
+				}
+
+				MpscQueue(const MpscQueue&) = delete;
+				MpscQueue& operator=(const MpscQueue&) = delete;
+
+				/**
+				* @brief Allocates the cells.
+				*
+				* @param[in] capacity Values the queue holds; rounded up to a
+				*                     power of two.
+				*
+				* @return `true` on success, `false` if the memory could not be
+				*         allocated.
+				*/
+				bool Allocate(size_t capacity) {
+
+					Free();
+
+					if (capacity < 2) {
+						return false;
+					}
+
+					_capacity = RoundUpToPowerOfTwo(capacity);
+					_mask = _capacity - 1;
+					_cells = static_cast<Cell*>(AlignedAlloc(_capacity * sizeof(Cell)));
+
+					if (_cells == nullptr) {
+						_capacity = 0;
+						_mask = 0;
+						return false;
+					}
+
+					for (size_t i = 0; i < _capacity; i++) {
+						new (&_cells[i]) Cell();
+					}
+
+					Reset();
+					return true;
+				}
+
+				/**
+				* @brief Releases the cells.
+				*/
+				void Free() {
+
+					if (_cells != nullptr) {
+						for (size_t i = 0; i < _capacity; i++) {
+							_cells[i].~Cell();
+						}
+						AlignedFree(_cells);
+					}
+					_cells = nullptr;
+					_capacity = 0;
+					_mask = 0;
+				}
+
+				/**
+				* @brief Empties the queue. Must not race with either side.
+				*/
+				void Reset() {
+
+					for (size_t i = 0; i < _capacity; i++) {
+						_cells[i].sequence.store(i, std::memory_order_relaxed);
+					}
+					_head.store(0, std::memory_order_relaxed);
+					_tail.store(0, std::memory_order_relaxed);
+				}
+
+				/**
+				* @brief Producer, any thread: appends `value`.
+				*
+				* @return `false`, without waiting, if the queue is full.
+				*/
+				bool TryPush(const T& value) {
+
+					uint64_t position = _head.load(std::memory_order_relaxed);
+					Cell* cell;
+
+					for (;;) {
+						cell = &_cells[position & _mask];
+
+						const uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+						const int64_t difference = (int64_t)(sequence - position);
+
+						if (difference == 0) {
+							if (_head.compare_exchange_weak(position, position + 1,
+								std::memory_order_relaxed)) {
+								break;
+							}
+						}
+						else if (difference < 0) {
+							// The consumer has not freed the cell of the
+							// previous lap yet.
+							return false;
+						}
+						else {
+							// Another producer took the position.
+							position = _head.load(std::memory_order_relaxed);
+						}
+					}
+
+					cell->value = value;
+					cell->sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+
+				/**
+				* @brief Consumer: takes the oldest published value.
+				*
+				* @return `false` if the queue is empty, or if the oldest
+				*         position is claimed but not yet published.
+				*/
+				bool TryPop(T& value) {
+
+					const uint64_t position = _tail.load(std::memory_order_relaxed);
+					Cell* cell = &_cells[position & _mask];
+
+					if (cell->sequence.load(std::memory_order_acquire) != position + 1) {
+						return false;
+					}
+
+					value = cell->value;
+					cell->sequence.store(position + _capacity, std::memory_order_release);
+					_tail.store(position + 1, std::memory_order_relaxed);
+					return true;
+				}
+
+				/**
+				* @brief Consumer: takes up to `capacity` values.
+				*
+				* @return The number of values taken.
+				*/
+				size_t TryPopMany(T* values, size_t capacity) {
+
+					size_t count = 0;
+
+					while (count < capacity && TryPop(values[count])) {
+						count++;
+					}
+					return count;
+				}
+
+				/**
+				* @brief Values claimed and not yet consumed. Approximate when
+				*        called concurrently with either side.
+				*/
+				size_t Count() const {
+					const uint64_t tail = _tail.load(std::memory_order_acquire);
+					const uint64_t head = _head.load(std::memory_order_acquire);
+					return (head > tail) ? (size_t)(head - tail) : 0;
+				}
+
+				size_t Capacity() const { return _capacity; }
+
+			private:
+				struct alignas(CacheLineSize) Cell {
+					std::atomic<uint64_t> sequence;
+					T value;
+				};
+
+				Cell* _cells;
+				size_t _capacity;
+				uint64_t _mask;
+
+				// Shared by the producers.
+				alignas(CacheLineSize) std::atomic<uint64_t> _head;
+
+				// Consumer side; atomic only for `Count`.
+				alignas(CacheLineSize) std::atomic<uint64_t> _tail;
+
+				// Keeps the consumer line from sharing with whatever follows.
+				char _padding[CacheLineSize - sizeof(std::atomic<uint64_t>)];
+			};
+		}
+	}
+}
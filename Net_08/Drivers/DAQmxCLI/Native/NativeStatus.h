@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Status codes reported by the native engines.
+			*
+			* The native layer returns `int32` status codes the same way the
+			* DAQmx API does: negative values are errors, positive values are
+			* warnings and `0` is success. DAQmx status codes are passed
+			* through unchanged; the codes below are used for conditions that
+			* originate in the native layer itself. They are kept outside of
+			* the range used by NI-DAQmx (-200000 .. -209999, 200000 .. 209999)
+			* and are translated to text by `NativeStatusDescription`.
+			*/
+			enum NativeStatus : int32 {
+				NativeSuccess = 0,
+				NativeErrorInvalidArgument = -250001,
+				NativeErrorOutOfMemory = -250002,
+				NativeErrorInvalidState = -250003,
+				NativeErrorNotAttached = -250004,
+				NativeErrorAlreadyRunning = -250005,
+				NativeErrorUnsupportedFormat = -250006,
+				NativeErrorTimeout = -250007,
+				NativeErrorBufferTooSmall = -250008,
+				NativeErrorFileIo = -250009,
+				NativeErrorInvalidFile = -250010,
+				NativeErrorCancelled = -250011,
+				NativeErrorQueueFull = -250012,
+				NativeErrorPermissionDenied = -250013,
+				NativeWarningBlocksDropped = 250001
+			};
+
+			/**
+			* @brief Returns `true` if the status code belongs to the native layer.
+			*/
+			inline bool IsNativeStatus(int32 status) {
+				return (status <= -250001 && status >= -250999)
+					|| (status >= 250001 && status <= 250999);
+			}
+
+			/**
+			* @brief Returns a static description for a native status code.
+			*
+			* @return A null-terminated string, or `NULL` if the code is not
+			*         a native status code.
+			*/
+			inline const char* NativeStatusDescription(int32 status) {
+				switch (status) {
+				case NativeErrorInvalidArgument:
+					return "Native engine: invalid argument.";
+				case NativeErrorOutOfMemory:
+					return "Native engine: failed to allocate buffer memory.";
+				case NativeErrorInvalidState:
+					return "Native engine: operation is not valid in the current state.";
+				case NativeErrorNotAttached:
+					return "Native engine: no DAQmx task is attached.";
+				case NativeErrorAlreadyRunning:
+					return "Native engine: the engine is already running.";
+				case NativeErrorUnsupportedFormat:
+					return "Native engine: unsupported sample format.";
+				case NativeErrorTimeout:
+					return "Native engine: timed out waiting for data.";
+				case NativeErrorBufferTooSmall:
+					return "Native engine: destination buffer is too small.";
+				case NativeErrorFileIo:
+					return "Native engine: file could not be created, extended or mapped.";
+				case NativeErrorInvalidFile:
+					return "Native engine: file is not a recording or is damaged.";
+				case NativeErrorCancelled:
+					return "Native engine: the operation was cancelled.";
+				case NativeErrorQueueFull:
+					return "Native engine: too many operations are pending.";
+				case NativeErrorPermissionDenied:
+					return "Native engine: the OS refused the thread priority or affinity.";
+				case NativeWarningBlocksDropped:
+					return "Native engine: consumer fell behind, blocks were dropped.";
+				default:
+					return NULL;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "PackedDigitalLines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "BitPackKernels.h"
+#include "NativeStatus.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Line bytes per read chunk: small enough to stay in L1/L2
+				// between the driver writing and the kernel packing them.
+				const size_t ChunkBytes = 32 * 1024;
+
+				// Write scratch above this size is released after the write.
+				const size_t KeptWriteBytes = 4 * 1024 * 1024;
+
+				struct Scratch {
+					std::vector<uInt8> scans;
+					std::vector<uInt8> channels;
+				};
+
+				Scratch& ThreadScratch() {
+					thread_local Scratch scratch;
+					return scratch;
+				}
+
+				bool Resize(std::vector<uInt8>& buffer, size_t size) {
+					try {
+						buffer.resize(size);
+						return true;
+					}
+					catch (const std::bad_alloc&) {
+						return false;
+					}
+				}
+
+				// Packs `read` scans of `scans` (grouped by scan) into the
+				// channel-grouped stream of `total` samples per channel, at sample
+				// `first`.
+				void PackByChannel(const uInt8* scans, uInt8* gather, uInt32 channels,
+					uInt32 lines, size_t read, size_t first, size_t total, uInt8* packed) {
+
+					if (lines == 1 || lines == 2 || lines == 4 || lines == 8) {
+						TransposeStrided(scans, channels, gather, read, read, channels, lines);
+					}
+					else {
+						for (uInt32 c = 0; c < channels; c++) {
+							for (size_t s = 0; s < read; s++) {
+								std::memcpy(gather + (c * read + s) * lines,
+									scans + (s * channels + c) * lines, lines);
+							}
+						}
+					}
+
+					for (uInt32 c = 0; c < channels; c++) {
+						PackLines(gather + c * read * lines, read * lines, packed,
+							(c * total + first) * lines);
+					}
+				}
+			}
+
+			int32 ReadDigitalLinesPacked(TaskHandle task, int32 numSampsPerChan,
+				float64 timeout, int32 fillMode, uInt8* packed, uInt32 packedSizeInBytes,
+				int32* sampsPerChanRead, int32* linesPerChannel) {
+
+				if (sampsPerChanRead != nullptr) {
+					*sampsPerChanRead = 0;
+				}
+
+				if (numSampsPerChan <= 0 || packed == nullptr || (fillMode != DAQmx_Val_GroupByChannel
+					&& fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				uInt32 channels = 0;
+				uInt32 lines = 0;
+
+				int32 status = DAQmxGetTaskNumChans(task, &channels);
+				if (status < 0) {
+					return status;
+				}
+				status = DAQmxGetReadDigitalLinesBytesPerChan(task, &lines);
+				if (status < 0) {
+					return status;
+				}
+
+				if (linesPerChannel != nullptr) {
+					*linesPerChannel = (int32)lines;
+				}
+
+				if (channels == 0 || lines == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const size_t total = (size_t)numSampsPerChan;
+
+				if (PackedDigitalLinesSize(channels, lines, (uInt32)total) > packedSizeInBytes) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				// Whole bytes per channel and chunk, so the chunks of a channel
+				// meet on byte boundaries in most layouts.
+				const size_t scanBytes = (size_t)channels * lines;
+				const size_t chunk = std::max<size_t>(8, (ChunkBytes / scanBytes) & ~(size_t)7);
+				const bool byChannel = (fillMode == DAQmx_Val_GroupByChannel && channels > 1);
+
+				Scratch& scratch = ThreadScratch();
+
+				if (!Resize(scratch.scans, chunk * scanBytes)
+					|| (byChannel && !Resize(scratch.channels, chunk * scanBytes))) {
+					return NativeErrorOutOfMemory;
+				}
+
+				const bool infinite = (timeout < 0.0);
+				const auto deadline = std::chrono::steady_clock::now()
+					+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double>(infinite ? 0.0 : timeout));
+
+				size_t done = 0;
+				int32 result = 0;
+
+				while (done < total) {
+
+					const int32 wanted = (int32)std::min(chunk, total - done);
+					const float64 remaining = infinite ? timeout : std::max(0.0,
+						std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count());
+
+					int32 read = 0;
+					int32 bytesPerSample = 0;
+
+					status = DAQmxReadDigitalLines(task, wanted, remaining,
+						DAQmx_Val_GroupByScanNumber, scratch.scans.data(),
+						(uInt32)scratch.scans.size(), &read, &bytesPerSample, NULL);
+
+					if (read > 0) {
+						if (byChannel) {
+							PackByChannel(scratch.scans.data(), scratch.channels.data(), channels,
+								lines, (size_t)read, done, total, packed);
+						}
+						else {
+							PackLines(scratch.scans.data(), (size_t)read * scanBytes, packed,
+								done * scanBytes);
+						}
+						done += (size_t)read;
+					}
+
+					if (status != 0 && result >= 0) {
+						result = status;
+					}
+					if (status < 0 || read < wanted) {
+						break;
+					}
+				}
+
+				if (sampsPerChanRead != nullptr) {
+					*sampsPerChanRead = (int32)done;
+				}
+				return result;
+			}
+
+			int32 WriteDigitalLinesPacked(TaskHandle task, int32 numSampsPerChan,
+				bool32 autoStart, float64 timeout, int32 fillMode, const uInt8* packed,
+				uInt32 packedSizeInBytes, int32* sampsPerChanWritten) {
+
+				if (sampsPerChanWritten != nullptr) {
+					*sampsPerChanWritten = 0;
+				}
+
+				if (numSampsPerChan <= 0 || packed == nullptr || (fillMode != DAQmx_Val_GroupByChannel
+					&& fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				uInt32 channels = 0;
+				uInt32 lines = 0;
+
+				int32 status = DAQmxGetTaskNumChans(task, &channels);
+				if (status < 0) {
+					return status;
+				}
+				status = DAQmxGetWriteDigitalLinesBytesPerChan(task, &lines);
+				if (status < 0) {
+					return status;
+				}
+
+				if (channels == 0 || lines == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (PackedDigitalLinesSize(channels, lines, (uInt32)numSampsPerChan) > packedSizeInBytes) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				const size_t bytes = (size_t)channels * lines * (size_t)numSampsPerChan;
+				std::vector<uInt8>& buffer = ThreadScratch().scans;
+
+				if (!Resize(buffer, std::max(buffer.size(), bytes))) {
+					return NativeErrorOutOfMemory;
+				}
+
+				UnpackLines(packed, 0, bytes, buffer.data());
+
+				status = DAQmxWriteDigitalLines(task, numSampsPerChan, autoStart, timeout,
+					(bool32)fillMode, buffer.data(), sampsPerChanWritten, NULL);
+
+				if (buffer.size() > KeptWriteBytes) {
+					std::vector<uInt8>().swap(buffer);
+				}
+				return status;
+			}
+		}
+	}
+}
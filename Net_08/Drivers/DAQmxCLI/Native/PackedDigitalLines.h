@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Line reads and writes with the line states packed into bits. Safe to
+* include from code compiled with /clr; the chunked reads and the scratch
+* buffers live in PackedDigitalLines.cpp.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Bytes of the packed form of `samplesPerChannel` samples of
+			*        `channels` channels with `linesPerChannel` lines each.
+			*
+			* The packed form is the byte array of `DAQmxReadDigitalLines` /
+			* `DAQmxWriteDigitalLines` in the same fill mode with every byte
+			* replaced by one bit (see `PackLines`): a 32-line port grouped by
+			* scan becomes one 32-bit word per sample, line 0 in bit 0.
+			*/
+			inline size_t PackedDigitalLinesSize(uInt32 channels, uInt32 linesPerChannel,
+				uInt32 samplesPerChannel) {
+				return ((size_t)channels * linesPerChannel * samplesPerChannel + 7) / 8;
+			}
+
+			/**
+			* @brief `DAQmxReadDigitalLines` into packed bits.
+			*
+			* Reads in chunks of about 32 KB of line bytes into a per-thread
+			* scratch buffer that stays in cache and packs each chunk straight
+			* into `packed`, so the full byte array never exists. Grouped by
+			* channel, channel `c` starts at bit `c * numSampsPerChan *
+			* linesPerChannel` also when fewer samples were read.
+			*
+			* @param[in] numSampsPerChan Samples per channel to read; must be
+			*            positive (`DAQmx_Val_Auto` is not supported).
+			* @param[in] timeout Timeout of the whole read, in seconds, or
+			*            `DAQmx_Val_WaitInfinitely`.
+			* @param[in] packedSizeInBytes At least `PackedDigitalLinesSize`.
+			* @param[out] sampsPerChanRead Samples per channel read, also on error.
+			* @param[out] linesPerChannel Lines of each channel
+			*             (`DAQmxGetReadDigitalLinesBytesPerChan`).
+			*
+			* @return DAQmx status of the reads, `NativeErrorInvalidArgument`
+			*         or `NativeErrorBufferTooSmall`.
+			*/
+			int32 ReadDigitalLinesPacked(TaskHandle task, int32 numSampsPerChan,
+				float64 timeout, int32 fillMode, uInt8* packed, uInt32 packedSizeInBytes,
+				int32* sampsPerChanRead, int32* linesPerChannel);
+
+			/**
+			* @brief `DAQmxWriteDigitalLines` from packed bits.
+			*
+			* The samples go to DAQmx in one write, as DAQmx sizes the output
+			* buffer and starts the task on the first write; they are unpacked
+			* into a per-thread scratch buffer that is reused across writes.
+			*
+			* @param[in] packedSizeInBytes At least `PackedDigitalLinesSize` with
+			*            the lines of `DAQmxGetWriteDigitalLinesBytesPerChan`.
+			*
+			* @return DAQmx status of the write, `NativeErrorInvalidArgument`,
+			*         `NativeErrorBufferTooSmall` or `NativeErrorOutOfMemory`.
+			*/
+			int32 WriteDigitalLinesPacked(TaskHandle task, int32 numSampsPerChan,
+				bool32 autoStart, float64 timeout, int32 fillMode, const uInt8* packed,
+				uInt32 packedSizeInBytes, int32* sampsPerChanWritten);
+		}
+	}
+}
@@ -0,0 +1,377 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RawScalingCore.h"
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				uInt32 Gcd(uInt32 a, uInt32 b) {
+					while (b != 0) {
+						uInt32 t = a % b;
+						a = b;
+						b = t;
+					}
+					return a;
+				}
+
+				// Samples gathered per pass when scaling one channel of an
+				// interleaved block.
+				const size_t GatherChunk = 512;
+			}
+
+			struct RawScalingCore::Impl {
+
+				uInt32 channels;
+				uInt32 order;
+
+				// channels * MaxScalingCoeffs, constant term first.
+				std::vector<float64> coeffs;
+				std::vector<uInt32> counts;
+
+				// Kernel tables (see ScalingKernels.h). One period-8 table per
+				// channel for contiguous runs, and one table whose columns cycle
+				// through the channels for interleaved blocks.
+				uInt32 scanPeriod;
+				std::vector<float64> channelTables64;
+				std::vector<float32> channelTables32;
+				std::vector<float64> scanTable64;
+				std::vector<float32> scanTable32;
+
+				Impl() : channels(0), order(0), scanPeriod(0) {}
+
+				int32 Resize(uInt32 channelCount) {
+
+					try {
+						coeffs.assign((size_t)channelCount * MaxScalingCoeffs, 0.0);
+						counts.assign(channelCount, 2);
+					}
+					catch (const std::bad_alloc&) {
+						channels = 0;
+						return NativeErrorOutOfMemory;
+					}
+
+					for (uInt32 ch = 0; ch < channelCount; ch++) {
+						coeffs[(size_t)ch * MaxScalingCoeffs + 1] = 1.0;
+					}
+
+					channels = channelCount;
+					return NativeSuccess;
+				}
+
+				int32 Rebuild() {
+
+					order = 1;
+					for (uInt32 count : counts) {
+						order = std::max(order, count);
+					}
+
+					const uInt32 p = ScalingTablePeriodAlignment;
+
+					if (channels == 0) {
+						scanPeriod = p;
+						channelTables64.clear();
+						channelTables32.clear();
+						scanTable64.clear();
+						scanTable32.clear();
+						return NativeSuccess;
+					}
+
+					scanPeriod = channels / Gcd(channels, p) * p;
+
+					try {
+						channelTables64.assign((size_t)channels * order * p, 0.0);
+						channelTables32.assign((size_t)channels * order * p, 0.0f);
+						scanTable64.assign((size_t)order * scanPeriod, 0.0);
+						scanTable32.assign((size_t)order * scanPeriod, 0.0f);
+					}
+					catch (const std::bad_alloc&) {
+						return NativeErrorOutOfMemory;
+					}
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt32 k = 0; k < order; k++) {
+
+							const float64 c = coeffs[(size_t)ch * MaxScalingCoeffs + k];
+
+							for (uInt32 col = 0; col < p; col++) {
+								channelTables64[((size_t)ch * order + k) * p + col] = c;
+								channelTables32[((size_t)ch * order + k) * p + col] = (float32)c;
+							}
+						}
+					}
+
+					for (uInt32 k = 0; k < order; k++) {
+						for (uInt32 col = 0; col < scanPeriod; col++) {
+
+							const float64 c = coeffs[(size_t)(col % channels) * MaxScalingCoeffs + k];
+							scanTable64[(size_t)k * scanPeriod + col] = c;
+							scanTable32[(size_t)k * scanPeriod + col] = (float32)c;
+						}
+					}
+
+					return NativeSuccess;
+				}
+
+				const float64* ChannelTable(uInt32 ch, const float64*) const {
+					return channelTables64.data() + (size_t)ch * order * ScalingTablePeriodAlignment;
+				}
+
+				const float32* ChannelTable(uInt32 ch, const float32*) const {
+					return channelTables32.data() + (size_t)ch * order * ScalingTablePeriodAlignment;
+				}
+
+				const float64* ScanTable(const float64*) const {
+					return scanTable64.data();
+				}
+
+				const float32* ScanTable(const float32*) const {
+					return scanTable32.data();
+				}
+
+				static void Kernel(const int16* src, float64* dst, size_t count,
+					const float64* table, uInt32 period, uInt32 order, uInt32 phase) {
+					ScaleI16ToF64(src, dst, count, table, period, order, phase);
+				}
+
+				static void Kernel(const int16* src, float32* dst, size_t count,
+					const float32* table, uInt32 period, uInt32 order, uInt32 phase) {
+					ScaleI16ToF32(src, dst, count, table, period, order, phase);
+				}
+
+				template <typename TOut>
+				int32 ScaleBlock(const int16* raw, uInt32 samplesPerChannel,
+					int32 fillMode, TOut* scaled, size_t scaledSize) const {
+
+					const size_t total = (size_t)channels * samplesPerChannel;
+
+					if (channels == 0) {
+						return NativeErrorInvalidState;
+					}
+					if (raw == nullptr || scaled == nullptr) {
+						return NativeErrorInvalidArgument;
+					}
+					if (scaledSize < total) {
+						return NativeErrorBufferTooSmall;
+					}
+
+					if (fillMode == DAQmx_Val_GroupByScanNumber) {
+						Kernel(raw, scaled, total, ScanTable(scaled), scanPeriod, order, 0);
+						return NativeSuccess;
+					}
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						const size_t offset = (size_t)ch * samplesPerChannel;
+						Kernel(raw + offset, scaled + offset, samplesPerChannel,
+							ChannelTable(ch, scaled), ScalingTablePeriodAlignment, order, 0);
+					}
+					return NativeSuccess;
+				}
+
+				template <typename TOut>
+				int32 ScaleChannel(const int16* raw, uInt32 samplesPerChannel,
+					int32 fillMode, uInt32 channel, TOut* scaled, size_t scaledSize) const {
+
+					if (channels == 0) {
+						return NativeErrorInvalidState;
+					}
+					if (raw == nullptr || scaled == nullptr || channel >= channels) {
+						return NativeErrorInvalidArgument;
+					}
+					if (scaledSize < samplesPerChannel) {
+						return NativeErrorBufferTooSmall;
+					}
+
+					const TOut* table = ChannelTable(channel, scaled);
+
+					if (fillMode != DAQmx_Val_GroupByScanNumber || channels == 1) {
+						Kernel(raw + (size_t)channel * samplesPerChannel, scaled,
+							samplesPerChannel, table, ScalingTablePeriodAlignment, order, 0);
+						return NativeSuccess;
+					}
+
+					int16 gathered[GatherChunk];
+					const int16* src = raw + channel;
+
+					for (size_t done = 0; done < samplesPerChannel; done += GatherChunk) {
+
+						const size_t n = std::min(GatherChunk, (size_t)samplesPerChannel - done);
+
+						for (size_t i = 0; i < n; i++) {
+							gathered[i] = src[(done + i) * channels];
+						}
+
+						Kernel(gathered, scaled + done, n, table,
+							ScalingTablePeriodAlignment, order, 0);
+					}
+					return NativeSuccess;
+				}
+			};
+
+
+			RawScalingCore::RawScalingCore() : _impl(new Impl()) {}
+
+			RawScalingCore::~RawScalingCore() {
+				delete _impl;
+			}
+
+			int32 RawScalingCore::Capture(TaskHandle task) {
+
+				if (task == NULL) {
+					return NativeErrorInvalidArgument;
+				}
+
+				int32 result = DAQmxTaskControl(task, DAQmx_Val_Task_Commit);
+				if (result < 0) {
+					return result;
+				}
+
+				uInt32 channelCount = 0;
+				result = DAQmxGetTaskNumChans(task, &channelCount);
+				if (result < 0) {
+					return result;
+				}
+				if (channelCount == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				result = _impl->Resize(channelCount);
+				if (result < 0) {
+					return result;
+				}
+
+				char name[256];
+
+				for (uInt32 ch = 0; ch < channelCount; ch++) {
+
+					// DAQmx channel indices are 1-based.
+					result = DAQmxGetNthTaskChannel(task, ch + 1, name, (int32)sizeof(name));
+					if (result < 0) {
+						break;
+					}
+
+					// With a NULL array the call returns the number of coefficients.
+					const int32 count = DAQmxGetAIDevScalingCoeff(task, name, NULL, 0);
+					if (count < 0) {
+						result = count;
+						break;
+					}
+					if (count == 0 || (uInt32)count > MaxScalingCoeffs) {
+						result = NativeErrorUnsupportedFormat;
+						break;
+					}
+
+					float64* target = &_impl->coeffs[(size_t)ch * MaxScalingCoeffs];
+					result = DAQmxGetAIDevScalingCoeff(task, name, target, (uInt32)count);
+					if (result < 0) {
+						break;
+					}
+					_impl->counts[ch] = (uInt32)count;
+				}
+
+				if (result < 0) {
+					_impl->Resize(0);
+					_impl->Rebuild();
+					return result;
+				}
+
+				return _impl->Rebuild();
+			}
+
+			int32 RawScalingCore::Reset(uInt32 channels) {
+
+				if (channels == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				int32 result = _impl->Resize(channels);
+				return (result < 0) ? result : _impl->Rebuild();
+			}
+
+			int32 RawScalingCore::SetChannelCoefficients(uInt32 channel,
+				const float64* coeffs, uInt32 count) {
+
+				if (channel >= _impl->channels || coeffs == nullptr
+					|| count == 0 || count > MaxScalingCoeffs) {
+					return NativeErrorInvalidArgument;
+				}
+
+				float64* target = &_impl->coeffs[(size_t)channel * MaxScalingCoeffs];
+				std::fill(target, target + MaxScalingCoeffs, 0.0);
+				std::copy(coeffs, coeffs + count, target);
+				_impl->counts[channel] = count;
+				return _impl->Rebuild();
+			}
+
+			int32 RawScalingCore::GetChannelCoefficients(uInt32 channel,
+				float64* coeffs, uInt32 capacity) const {
+
+				if (channel >= _impl->channels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const uInt32 count = _impl->counts[channel];
+				const float64* source = &_impl->coeffs[(size_t)channel * MaxScalingCoeffs];
+
+				if (coeffs != nullptr) {
+					std::copy(source, source + std::min(count, capacity), coeffs);
+				}
+				return (int32)count;
+			}
+
+			uInt32 RawScalingCore::Channels() const {
+				return _impl->channels;
+			}
+
+			int32 RawScalingCore::ScaleToF64(const int16* raw, uInt32 samplesPerChannel,
+				int32 fillMode, float64* scaled, size_t scaledSize) const {
+				return _impl->ScaleBlock(raw, samplesPerChannel, fillMode, scaled, scaledSize);
+			}
+
+			int32 RawScalingCore::ScaleToF32(const int16* raw, uInt32 samplesPerChannel,
+				int32 fillMode, float32* scaled, size_t scaledSize) const {
+				return _impl->ScaleBlock(raw, samplesPerChannel, fillMode, scaled, scaledSize);
+			}
+
+			int32 RawScalingCore::ScaleChannelToF64(const int16* raw, uInt32 samplesPerChannel,
+				int32 fillMode, uInt32 channel, float64* scaled, size_t scaledSize) const {
+				return _impl->ScaleChannel(raw, samplesPerChannel, fillMode, channel,
+					scaled, scaledSize);
+			}
+
+			int32 RawScalingCore::ScaleChannelToF32(const int16* raw, uInt32 samplesPerChannel,
+				int32 fillMode, uInt32 channel, float32* scaled, size_t scaledSize) const {
+				return _impl->ScaleChannel(raw, samplesPerChannel, fillMode, channel,
+					scaled, scaledSize);
+			}
+		}
+	}
+}
@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the deferred scaling helper. Safe to include from code compiled
+* with /clr; the coefficient tables live in RawScalingCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "ScalingKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Per-channel raw-to-volts scaling captured from a DAQmx task.
+			*
+			* Reading with `DAQmxReadBinaryI16` (or `DAQmxReadRaw`) moves a quarter
+			* of the bytes of `DAQmxReadAnalogF64` and leaves the data in the form
+			* recorders store. `Capture` commits the task and asks the driver for
+			* the device scaling polynomial of every channel once; afterwards the
+			* raw blocks are converted to F64 or F32 with the SIMD kernels of
+			* ScalingKernels.h only when, and only for the channels, a consumer
+			* needs them.
+			*
+			* The layout of the raw input is described by a DAQmx fill mode:
+			* `DAQmx_Val_GroupByChannel` or `DAQmx_Val_GroupByScanNumber`. Data
+			* returned by `DAQmxReadRaw` for AI tasks is interleaved by scan.
+			*/
+			class RawScalingCore {
+
+			public:
+				RawScalingCore();
+				~RawScalingCore();
+
+				RawScalingCore(const RawScalingCore&) = delete;
+				RawScalingCore& operator=(const RawScalingCore&) = delete;
+
+				/**
+				* @brief Commits the task and reads the scaling polynomial of each
+				*        of its channels with `DAQmxGetAIDevScalingCoeff`.
+				*
+				* @param[in] task A task with AI channels configured.
+				*
+				* @return `0` on success, a DAQmx or `NativeStatus` error otherwise.
+				*/
+				int32 Capture(TaskHandle task);
+
+				/**
+				* @brief Sets up `channels` channels with the identity polynomial
+				*        (y = x). Used when coefficients come from elsewhere, e.g.
+				*        from the metadata of a recording.
+				*/
+				int32 Reset(uInt32 channels);
+
+				/**
+				* @brief Replaces the polynomial of one channel.
+				*
+				* @param[in] channel Zero-based channel index.
+				* @param[in] coeffs Coefficients, constant term first.
+				* @param[in] count Number of coefficients, 1 .. `MaxScalingCoeffs`.
+				*/
+				int32 SetChannelCoefficients(uInt32 channel, const float64* coeffs,
+					uInt32 count);
+
+				/**
+				* @brief Copies the polynomial of one channel.
+				*
+				* @param[out] coeffs Receives up to `capacity` coefficients.
+				*
+				* @return The number of coefficients of the channel, or a negative
+				*         status code.
+				*/
+				int32 GetChannelCoefficients(uInt32 channel, float64* coeffs,
+					uInt32 capacity) const;
+
+				/**
+				* @brief Number of channels with scaling information.
+				*/
+				uInt32 Channels() const;
+
+				/**
+				* @brief Scales a whole block. The output has the layout of the input.
+				*
+				* @param[in] raw `Channels() * samplesPerChannel` raw codes.
+				* @param[in] samplesPerChannel Samples per channel in the block.
+				* @param[in] fillMode Layout of `raw`.
+				* @param[out] scaled Destination buffer.
+				* @param[in] scaledSize Size of `scaled`, in samples.
+				*/
+				int32 ScaleToF64(const int16* raw, uInt32 samplesPerChannel,
+					int32 fillMode, float64* scaled, size_t scaledSize) const;
+
+				/**
+				* @brief Single precision variant of `ScaleToF64`.
+				*/
+				int32 ScaleToF32(const int16* raw, uInt32 samplesPerChannel,
+					int32 fillMode, float32* scaled, size_t scaledSize) const;
+
+				/**
+				* @brief Scales one channel of a block into a contiguous buffer of
+				*        `samplesPerChannel` values.
+				*/
+				int32 ScaleChannelToF64(const int16* raw, uInt32 samplesPerChannel,
+					int32 fillMode, uInt32 channel, float64* scaled, size_t scaledSize) const;
+
+				/**
+				* @brief Single precision variant of `ScaleChannelToF64`.
+				*/
+				int32 ScaleChannelToF32(const int16* raw, uInt32 samplesPerChannel,
+					int32 fillMode, uInt32 channel, float32* scaled, size_t scaledSize) const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* On-disk layout of the chunked recordings written by StreamRecorderCore.
+* Plain structures only; safe to include from code compiled with /clr.
+*
+* A recording is a file header followed by fixed-size chunks:
+*
+*   [FileHeader, padded to RecordingAlignment]
+*   [chunk 0][chunk 1] ... [chunk ChunkCount - 1]
+*
+* Each chunk is `ChunkBytes` long, so chunk `k` starts at
+* `HeaderBytes + k * ChunkBytes` and can be found without scanning:
+*
+*   [ChunkHeader][scaling coefficients][samples]
+*
+* The coefficients are `Channels * CoeffCount` float64, channel after channel,
+* constant term first. The samples are raw codes interleaved by scan
+* (`DAQmx_Val_GroupByScanNumber`). A chunk only ever holds consecutive
+* samples: a gap in the sample index or a change of scaling starts a new
+* chunk. All fields are little endian.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			const char RecordingMagic[8] = { 'G', 'D', 'A', 'Q', 'R', 'E', 'C', '1' };
+			const uInt32 RecordingVersion = 1;
+			const uInt32 RecordingChunkMagic = 0x4B4E4843; // "CHNK"
+
+			/** File header size and chunk alignment. A multiple of the mapping
+			*   granularity of every supported platform. */
+			const uInt32 RecordingAlignment = 65536;
+
+			/** Set in `RecordingFileHeader::flags` when the recorder was closed
+			*   normally. A file without it was cut short; its header counts are
+			*   those of the last completed chunk. */
+			const uInt32 RecordingFlagClosed = 0x1;
+
+			#pragma pack(push, 8)
+
+			struct RecordingFileHeader {
+				char magic[8];
+				uInt32 version;
+				uInt32 headerBytes;
+
+				uInt32 channels;
+				/** `SampleFormat` of the samples. */
+				uInt32 format;
+				uInt32 sampleBytes;
+				/** Coefficients stored per channel in each chunk. */
+				uInt32 coeffCount;
+
+				uInt64 chunkBytes;
+				/** Samples per channel a chunk can hold. */
+				uInt64 chunkCapacity;
+				uInt64 chunkCount;
+				uInt64 totalSamples;
+
+				/** Sample clock rate, for information only; `0` if unknown. */
+				float64 sampleRate;
+				/** Creation time, nanoseconds since the Unix epoch (UTC). */
+				int64 createdNs;
+
+				uInt32 flags;
+				uInt32 reserved0;
+				uInt64 reserved[8];
+			};
+
+			struct RecordingChunkHeader {
+				uInt32 magic;
+				uInt32 channels;
+
+				/** Index of the chunk in the file. */
+				uInt64 sequence;
+
+				/** Index, per channel, of the first sample since the task was
+				*   started. */
+				uInt64 firstSample;
+				uInt64 samplesPerChannel;
+
+				/** Host time of the first block of the chunk, nanoseconds since
+				*   the Unix epoch (UTC, `std::chrono::system_clock`). Engine
+				*   blocks carry the monotonic time of their read, mapped to
+				*   UTC once per file. */
+				int64 timestampNs;
+
+				uInt32 coeffCount;
+				/** Offsets from the start of the chunk. */
+				uInt32 coeffOffset;
+				uInt32 dataOffset;
+				uInt32 reserved0;
+				uInt64 reserved1;
+			};
+
+			#pragma pack(pop)
+
+			static_assert(sizeof(RecordingFileHeader) <= RecordingAlignment,
+				"File header must fit in its reserved area.");
+			static_assert(sizeof(RecordingChunkHeader) == 64,
+				"Chunk header must stay one cache line.");
+		}
+	}
+}
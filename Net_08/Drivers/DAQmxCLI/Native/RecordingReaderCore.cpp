@@ -0,0 +1,198 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RecordingReaderCore.h"
+
+#include <cstring>
+#include <new>
+
+#include "MappedFile.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			struct RecordingReaderCore::Impl {
+
+				MappedFile file;
+				const uint8_t* view;
+				size_t viewBytes;
+				const RecordingFileHeader* header;
+				uInt64 chunkCount;
+
+				Impl() : view(nullptr), viewBytes(0), header(nullptr), chunkCount(0) {}
+
+				void Release() {
+					MappedFile::Unmap(const_cast<uint8_t*>(view), viewBytes, false);
+					view = nullptr;
+					viewBytes = 0;
+					header = nullptr;
+					chunkCount = 0;
+					file.Close();
+				}
+			};
+
+			RecordingReaderCore::RecordingReaderCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			RecordingReaderCore::~RecordingReaderCore() {
+
+				if (_impl != nullptr) {
+					Close();
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 RecordingReaderCore::Open(const char* path) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Close();
+
+				if (path == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.file.OpenReadOnly(path)) {
+					return NativeErrorFileIo;
+				}
+
+				const uInt64 size = impl.file.Size();
+				if (size < RecordingAlignment) {
+					impl.Release();
+					return NativeErrorInvalidFile;
+				}
+
+				impl.view = static_cast<const uint8_t*>(impl.file.Map(0, (size_t)size, false));
+				if (impl.view == nullptr) {
+					impl.Release();
+					return NativeErrorFileIo;
+				}
+				impl.viewBytes = (size_t)size;
+
+				const RecordingFileHeader* header =
+					reinterpret_cast<const RecordingFileHeader*>(impl.view);
+
+				const bool valid = std::memcmp(header->magic, RecordingMagic,
+						sizeof(RecordingMagic)) == 0
+					&& header->version == RecordingVersion
+					&& header->headerBytes == RecordingAlignment
+					&& header->channels != 0
+					&& header->sampleBytes == SampleSize((SampleFormat)header->format)
+					&& header->sampleBytes != 0
+					&& header->chunkBytes >= sizeof(RecordingChunkHeader)
+					&& header->chunkBytes % RecordingAlignment == 0
+					&& header->chunkCapacity != 0;
+
+				if (!valid) {
+					impl.Release();
+					return NativeErrorInvalidFile;
+				}
+
+				// A file cut short may count a chunk whose space was never written.
+				const uInt64 fit = (size - RecordingAlignment) / header->chunkBytes;
+
+				impl.header = header;
+				impl.chunkCount = (header->chunkCount < fit) ? header->chunkCount : fit;
+				return NativeSuccess;
+			}
+
+			void RecordingReaderCore::Close() {
+				if (_impl != nullptr) {
+					_impl->Release();
+				}
+			}
+
+			const RecordingFileHeader* RecordingReaderCore::Header() const {
+				return (_impl == nullptr) ? nullptr : _impl->header;
+			}
+
+			uInt32 RecordingReaderCore::Channels() const {
+				return (Header() == nullptr) ? 0 : Header()->channels;
+			}
+
+			SampleFormat RecordingReaderCore::Format() const {
+				return (Header() == nullptr) ? SampleFormat::Int16 : (SampleFormat)Header()->format;
+			}
+
+			uInt64 RecordingReaderCore::ChunkCount() const {
+				return (_impl == nullptr) ? 0 : _impl->chunkCount;
+			}
+
+			uInt64 RecordingReaderCore::TotalSamples() const {
+
+				uInt64 total = 0;
+				RecordedChunk chunk;
+
+				for (uInt64 i = 0; i < ChunkCount(); i++) {
+					if (GetChunk(i, chunk) == NativeSuccess) {
+						total += chunk.samplesPerChannel;
+					}
+				}
+				return total;
+			}
+
+			bool RecordingReaderCore::IsComplete() const {
+				return Header() != nullptr && (Header()->flags & RecordingFlagClosed) != 0;
+			}
+
+			int32 RecordingReaderCore::GetChunk(uInt64 index, RecordedChunk& chunk) const {
+
+				if (_impl == nullptr || _impl->header == nullptr || index >= _impl->chunkCount) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const RecordingFileHeader* header = _impl->header;
+				const uint8_t* base = _impl->view + RecordingAlignment + index * header->chunkBytes;
+				const RecordingChunkHeader* chunkHeader =
+					reinterpret_cast<const RecordingChunkHeader*>(base);
+
+				const uInt64 frameBytes = (uInt64)header->channels * header->sampleBytes;
+
+				if (chunkHeader->magic != RecordingChunkMagic
+					|| chunkHeader->channels != header->channels
+					|| chunkHeader->sequence != index
+					|| chunkHeader->samplesPerChannel > header->chunkCapacity
+					|| chunkHeader->dataOffset + chunkHeader->samplesPerChannel * frameBytes
+						> header->chunkBytes
+					|| chunkHeader->coeffOffset + (uInt64)header->channels
+						* chunkHeader->coeffCount * sizeof(float64) > chunkHeader->dataOffset) {
+					return NativeErrorInvalidFile;
+				}
+
+				chunk.data = base + chunkHeader->dataOffset;
+				chunk.firstSample = chunkHeader->firstSample;
+				chunk.samplesPerChannel = chunkHeader->samplesPerChannel;
+				chunk.timestampNs = chunkHeader->timestampNs;
+				chunk.coeffs = reinterpret_cast<const float64*>(base + chunkHeader->coeffOffset);
+				chunk.coeffCount = chunkHeader->coeffCount;
+				return NativeSuccess;
+			}
+		}
+	}
+}
@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the recording reader. Safe to include from code compiled with
+* /clr; the mapping lives in RecordingReaderCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+#include "RecordingFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief One chunk of a recording, pointing into the mapped file.
+			*/
+			struct RecordedChunk {
+				/** Raw samples, interleaved by scan. */
+				const void* data;
+				uInt64 firstSample;
+				uInt64 samplesPerChannel;
+				int64 timestampNs;
+				/** `channels * coeffCount` coefficients, channel after channel. */
+				const float64* coeffs;
+				uInt32 coeffCount;
+			};
+
+			/**
+			* @brief Read-only, zero-copy access to a file written by
+			*        `StreamRecorderCore`.
+			*
+			* The whole file is mapped; `GetChunk` finds a chunk by index without
+			* reading the ones before it. A file that is still being written, or
+			* was cut short, can be opened too: it shows the chunks its header
+			* counted at the time.
+			*/
+			class RecordingReaderCore {
+
+			public:
+				RecordingReaderCore();
+				~RecordingReaderCore();
+
+				RecordingReaderCore(const RecordingReaderCore&) = delete;
+				RecordingReaderCore& operator=(const RecordingReaderCore&) = delete;
+
+				/**
+				* @brief Maps a recording and checks its header.
+				*
+				* @return `0`, `NativeErrorFileIo` or `NativeErrorInvalidFile`.
+				*/
+				int32 Open(const char* path);
+
+				void Close();
+
+				/**
+				* @brief The file header, or `nullptr` if nothing is open.
+				*/
+				const RecordingFileHeader* Header() const;
+
+				uInt32 Channels() const;
+				SampleFormat Format() const;
+				uInt64 ChunkCount() const;
+				uInt64 TotalSamples() const;
+
+				/**
+				* @brief `true` if the recorder closed the file normally.
+				*/
+				bool IsComplete() const;
+
+				/**
+				* @brief Describes chunk `index`.
+				*
+				* @return `0`, `NativeErrorInvalidArgument` for an index out of
+				*         range, or `NativeErrorInvalidFile` if the chunk is damaged.
+				*/
+				int32 GetChunk(uInt64 index, RecordedChunk& chunk) const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,669 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SampleCodecCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "CodecKernels.h"
+#include "NativeStatus.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				const uInt32 PredictorCount = 3;
+
+				inline size_t PadTo4(size_t bytes) {
+					return (bytes + 3) & ~(size_t)3;
+				}
+
+				inline size_t PayloadOffset(uInt32 channels) {
+					return sizeof(CodecBlockHeader) + channels * sizeof(CodecChannelEntry);
+				}
+
+				// Scratch of one encoding thread.
+				struct WorkerScratch {
+					// Channel runs of a block grouped by scan.
+					void* runs;
+					uInt32* residuals;
+					// Mini-block widths of each predictor.
+					uInt8* widths;
+
+					WorkerScratch() : runs(nullptr), residuals(nullptr), widths(nullptr) {}
+
+					void Free() {
+						AlignedFree(runs);
+						AlignedFree(residuals);
+						AlignedFree(widths);
+						runs = nullptr;
+						residuals = nullptr;
+						widths = nullptr;
+					}
+				};
+
+				// Checks one channel entry and decodes its payload into
+				// `out[i * stride]`.
+				int32 DecodePayload(const uInt8* block, const CodecBlockHeader& header,
+					uInt32 channel, void* out, size_t stride) {
+
+					CodecChannelEntry entry;
+					std::memcpy(&entry, block + sizeof(CodecBlockHeader)
+						+ channel * sizeof(CodecChannelEntry), sizeof(entry));
+
+					const size_t spc = header.samplesPerChannel;
+					const size_t miniBlocks = CodecMiniBlocks(spc);
+					const size_t widthBytes = PadTo4(miniBlocks);
+
+					if (entry.offset < PayloadOffset(header.channels)
+						|| (uInt64)entry.offset + entry.bytes > header.blockBytes
+						|| entry.predictor > (uInt8)CodecPredictor::Linear
+						|| entry.bytes < widthBytes) {
+						return NativeErrorInvalidFile;
+					}
+
+					const uInt8* widths = block + entry.offset;
+					size_t packedBytes = 0;
+
+					for (size_t m = 0; m < miniBlocks; m++) {
+						if (widths[m] > 32) {
+							return NativeErrorInvalidFile;
+						}
+						packedBytes += (size_t)widths[m] * 32;
+					}
+
+					if (widthBytes + packedBytes != entry.bytes) {
+						return NativeErrorInvalidFile;
+					}
+
+					const uInt32* packed = reinterpret_cast<const uInt32*>(widths + widthBytes);
+					alignas(CacheLineSize) uInt32 values[CodecMiniBlockValues];
+					int32 history[2] = { entry.seed, entry.seed };
+					uInt8* dst = static_cast<uInt8*>(out);
+
+					for (size_t m = 0; m < miniBlocks; m++) {
+
+						const size_t first = m * CodecMiniBlockValues;
+						const size_t n = std::min<size_t>(CodecMiniBlockValues, spc - first);
+
+						UnpackMiniBlock(packed, widths[m], values);
+						packed += (size_t)widths[m] * 8;
+
+						RestoreSamples(values, n, entry.predictor, history, header.sampleBytes,
+							dst + first * stride * header.sampleBytes, stride);
+					}
+					return NativeSuccess;
+				}
+			}
+
+			struct SampleCodecCore::Impl {
+
+				SampleCodecConfig config;
+				bool configured;
+				uInt32 sampleBytes;
+
+				// One output slot per block of the largest `Encode`.
+				uInt8* slots;
+				size_t slotStride;
+				uInt32 maxBlocks;
+				std::vector<size_t> slotBytes;
+				std::vector<WorkerScratch> scratch;
+
+				// Current job, set before the workers are woken.
+				const uInt8* jobData;
+				uInt32 jobSamplesPerChannel;
+				int32 jobFillMode;
+				uInt32 jobBlocks;
+				uInt64 jobFirstSample;
+				std::atomic<uInt32> nextBlock;
+
+				// Worker pool; index 0 of `scratch` belongs to the caller.
+				std::vector<std::thread> workers;
+				std::mutex poolMutex;
+				std::condition_variable wakeCondition;
+				std::condition_variable doneCondition;
+				uInt64 generation;
+				size_t active;
+				bool stopping;
+
+				uInt64 position;
+				alignas(CacheLineSize) std::atomic<uInt64> blocksEncoded;
+				std::atomic<uInt64> samplesEncoded;
+				std::atomic<uInt64> bytesIn;
+				std::atomic<uInt64> bytesOut;
+
+				Impl() :
+					config(DefaultSampleCodecConfig()), configured(false), sampleBytes(0),
+					slots(nullptr), slotStride(0), maxBlocks(0),
+					jobData(nullptr), jobSamplesPerChannel(0), jobFillMode(0), jobBlocks(0),
+					jobFirstSample(0), nextBlock(0), generation(0), active(0), stopping(false),
+					position(0), blocksEncoded(0), samplesEncoded(0), bytesIn(0), bytesOut(0) {}
+
+				~Impl() {
+					StopWorkers();
+					Free();
+				}
+
+				void Free() {
+					AlignedFree(slots);
+					slots = nullptr;
+					for (WorkerScratch& s : scratch) {
+						s.Free();
+					}
+					scratch.clear();
+				}
+
+				void StopWorkers() {
+					{
+						std::lock_guard<std::mutex> lock(poolMutex);
+						stopping = true;
+					}
+					wakeCondition.notify_all();
+
+					for (std::thread& worker : workers) {
+						worker.join();
+					}
+					workers.clear();
+					stopping = false;
+				}
+
+				void WorkerLoop(size_t index) {
+
+					uInt64 seen = 0;
+
+					for (;;) {
+						{
+							std::unique_lock<std::mutex> lock(poolMutex);
+							wakeCondition.wait(lock, [&] { return stopping || generation != seen; });
+							if (stopping) {
+								return;
+							}
+							seen = generation;
+						}
+
+						RunBlocks(index);
+
+						std::lock_guard<std::mutex> lock(poolMutex);
+						if (--active == 0) {
+							doneCondition.notify_one();
+						}
+					}
+				}
+
+				void RunBlocks(size_t worker) {
+
+					uInt32 block;
+					while ((block = nextBlock.fetch_add(1, std::memory_order_relaxed)) < jobBlocks) {
+						EncodeBlock(scratch[worker], block);
+					}
+				}
+
+				void EncodeBlock(WorkerScratch& s, uInt32 block) {
+
+					const uInt32 channels = config.channels;
+					const size_t first = (size_t)block * config.blockSamplesPerChannel;
+					const uInt32 spc = (uInt32)std::min<size_t>(config.blockSamplesPerChannel,
+						jobSamplesPerChannel - first);
+
+					uInt8* out = slots + block * slotStride;
+					const uInt8* runs = jobData + first * sampleBytes;
+					size_t runStride = jobSamplesPerChannel;
+
+					if (jobFillMode == DAQmx_Val_GroupByScanNumber && channels > 1) {
+						TransposeStrided(jobData + first * channels * sampleBytes, channels,
+							s.runs, spc, spc, channels, sampleBytes);
+						runs = static_cast<const uInt8*>(s.runs);
+						runStride = spc;
+					}
+
+					size_t offset = PayloadOffset(channels);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+
+						CodecChannelEntry entry;
+						const size_t bytes = EncodeChannel(s, runs + ch * runStride * sampleBytes,
+							spc, out + offset, &entry);
+
+						entry.offset = (uInt32)offset;
+						entry.bytes = (uInt32)bytes;
+						std::memcpy(out + sizeof(CodecBlockHeader) + ch * sizeof(CodecChannelEntry),
+							&entry, sizeof(entry));
+						offset += bytes;
+					}
+
+					CodecBlockHeader header = {};
+					header.magic = CodecBlockMagic;
+					header.blockBytes = (uInt32)offset;
+					header.firstSample = jobFirstSample + first;
+					header.samplesPerChannel = spc;
+					header.channels = (uInt16)channels;
+					header.sampleBytes = (uInt8)sampleBytes;
+					header.version = CodecVersion;
+					std::memcpy(out, &header, sizeof(header));
+
+					slotBytes[block] = offset;
+				}
+
+				size_t EncodeChannel(WorkerScratch& s, const uInt8* run, uInt32 spc,
+					uInt8* out, CodecChannelEntry* entry) {
+
+					const size_t miniBlocks = CodecMiniBlocks(spc);
+					uInt32 order = (uInt32)config.predictor;
+					const uInt8* widths = s.widths;
+
+					if (config.predictor == CodecPredictor::Auto) {
+
+						// Widths of all three in one pass; the residuals of
+						// the cheapest give the same widths when packed.
+						PredictorWidths(run, spc, sampleBytes, s.widths);
+
+						size_t bestCost = ~(size_t)0;
+
+						for (uInt32 k = 0; k < PredictorCount; k++) {
+
+							size_t cost = 0;
+							for (size_t m = 0; m < miniBlocks; m++) {
+								cost += s.widths[k * miniBlocks + m];
+							}
+
+							if (cost < bestCost) {
+								bestCost = cost;
+								order = k;
+							}
+						}
+						widths = s.widths + order * miniBlocks;
+					}
+
+					uInt32* r = s.residuals;
+					ComputeResiduals(run, spc, sampleBytes, order, r);
+					std::memset(r + spc, 0, (miniBlocks * CodecMiniBlockValues - spc) * sizeof(uInt32));
+
+					if (config.predictor != CodecPredictor::Auto) {
+						for (size_t m = 0; m < miniBlocks; m++) {
+							s.widths[m] = (uInt8)BitWidth(r + m * CodecMiniBlockValues,
+								CodecMiniBlockValues);
+						}
+					}
+
+					const size_t widthBytes = PadTo4(miniBlocks);
+					std::memcpy(out, widths, miniBlocks);
+					std::memset(out + miniBlocks, 0, widthBytes - miniBlocks);
+
+					uInt32* packed = reinterpret_cast<uInt32*>(out + widthBytes);
+
+					for (size_t m = 0; m < miniBlocks; m++) {
+						const uInt32 width = widths[m];
+						PackMiniBlock(r + m * CodecMiniBlockValues, width, packed);
+						packed += width * 8;
+					}
+
+					entry->seed = (sampleBytes == 2)
+						? (int32)*reinterpret_cast<const int16*>(run)
+						: *reinterpret_cast<const int32*>(run);
+					entry->predictor = (uInt8)order;
+					std::memset(entry->reserved, 0, sizeof(entry->reserved));
+
+					return reinterpret_cast<uInt8*>(packed) - out;
+				}
+			};
+
+			SampleCodecCore::SampleCodecCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			SampleCodecCore::~SampleCodecCore() {
+				delete _impl;
+				_impl = nullptr;
+			}
+
+			int32 SampleCodecCore::Configure(const SampleCodecConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (config.format != SampleFormat::Int16 && config.format != SampleFormat::Int32) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				if (config.channels == 0 || config.channels > 0xFFFF
+					|| config.blockSamplesPerChannel == 0 || config.maxSamplesPerChannel == 0
+					|| (config.predictor > CodecPredictor::Linear
+						&& config.predictor != CodecPredictor::Auto)
+					|| MaxCodecBlockBytes(config.channels, config.blockSamplesPerChannel) > 0xFFFFFFFFull) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				impl.StopWorkers();
+				impl.Free();
+				impl.configured = false;
+				impl.config = config;
+				impl.sampleBytes = (uInt32)SampleSize(config.format);
+
+				const uInt32 block = config.blockSamplesPerChannel;
+				impl.maxBlocks = (uInt32)((config.maxSamplesPerChannel + (uInt64)block - 1) / block);
+				impl.slotStride = RoundUpToCacheLine(MaxCodecBlockBytes(config.channels, block));
+
+				uInt32 threads = config.threads;
+				if (threads == 0) {
+					threads = std::max(1u, std::thread::hardware_concurrency());
+				}
+				threads = std::min(threads, impl.maxBlocks);
+
+				const size_t padded = CodecMiniBlocks(block) * CodecMiniBlockValues;
+				bool allocated = true;
+
+				try {
+					impl.slotBytes.assign(impl.maxBlocks, 0);
+					impl.scratch.resize(threads);
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.slots = static_cast<uInt8*>(AlignedAlloc(impl.maxBlocks * impl.slotStride));
+				allocated = impl.slots != nullptr;
+
+				for (WorkerScratch& s : impl.scratch) {
+					s.runs = AlignedAlloc((size_t)config.channels * block * impl.sampleBytes);
+					allocated = allocated && s.runs != nullptr;
+
+					s.residuals = static_cast<uInt32*>(AlignedAlloc(padded * sizeof(uInt32)));
+					s.widths = static_cast<uInt8*>(AlignedAlloc(PredictorCount * CodecMiniBlocks(block)));
+					allocated = allocated && s.residuals != nullptr && s.widths != nullptr;
+				}
+
+				if (!allocated) {
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				try {
+					for (size_t k = 1; k < threads; k++) {
+						impl.workers.emplace_back(&Impl::WorkerLoop, _impl, k);
+					}
+				}
+				catch (...) {
+					impl.StopWorkers();
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.configured = true;
+				Reset();
+				return NativeSuccess;
+			}
+
+			void SampleCodecCore::Reset() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+				impl.position = 0;
+				impl.blocksEncoded.store(0);
+				impl.samplesEncoded.store(0);
+				impl.bytesIn.store(0);
+				impl.bytesOut.store(0);
+			}
+
+			bool SampleCodecCore::IsConfigured() const {
+				return _impl != nullptr && _impl->configured;
+			}
+
+			const SampleCodecConfig& SampleCodecCore::Config() const {
+				return _impl->config;
+			}
+
+			size_t SampleCodecCore::MaxEncodedBytes(uInt32 samplesPerChannel) const {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return 0;
+				}
+
+				const uInt32 block = _impl->config.blockSamplesPerChannel;
+				const size_t full = samplesPerChannel / block;
+				const uInt32 rest = samplesPerChannel % block;
+
+				return full * MaxCodecBlockBytes(_impl->config.channels, block)
+					+ ((rest != 0) ? MaxCodecBlockBytes(_impl->config.channels, rest) : 0);
+			}
+
+			int32 SampleCodecCore::Encode(const void* data, uInt32 samplesPerChannel,
+				int32 fillMode, void* out, size_t capacity, size_t* written) {
+
+				if (written != nullptr) {
+					*written = 0;
+				}
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+
+				if (data == nullptr || out == nullptr || written == nullptr
+					|| samplesPerChannel > impl.config.maxSamplesPerChannel
+					|| (fillMode != DAQmx_Val_GroupByChannel
+						&& fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (samplesPerChannel == 0) {
+					return NativeSuccess;
+				}
+
+				const uInt32 block = impl.config.blockSamplesPerChannel;
+
+				impl.jobData = static_cast<const uInt8*>(data);
+				impl.jobSamplesPerChannel = samplesPerChannel;
+				impl.jobFillMode = fillMode;
+				impl.jobBlocks = (samplesPerChannel + block - 1) / block;
+				impl.jobFirstSample = impl.position;
+				impl.nextBlock.store(0, std::memory_order_relaxed);
+
+				if (impl.workers.empty() || impl.jobBlocks == 1) {
+					impl.RunBlocks(0);
+				}
+				else {
+					{
+						std::lock_guard<std::mutex> lock(impl.poolMutex);
+						impl.active = impl.workers.size();
+						impl.generation++;
+					}
+					impl.wakeCondition.notify_all();
+
+					impl.RunBlocks(0);
+
+					std::unique_lock<std::mutex> lock(impl.poolMutex);
+					impl.doneCondition.wait(lock, [&] { return impl.active == 0; });
+				}
+
+				size_t total = 0;
+				for (uInt32 b = 0; b < impl.jobBlocks; b++) {
+					total += impl.slotBytes[b];
+				}
+
+				if (total > capacity) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				uInt8* dst = static_cast<uInt8*>(out);
+				for (uInt32 b = 0; b < impl.jobBlocks; b++) {
+					std::memcpy(dst, impl.slots + b * impl.slotStride, impl.slotBytes[b]);
+					dst += impl.slotBytes[b];
+				}
+
+				impl.position += samplesPerChannel;
+				impl.blocksEncoded.fetch_add(impl.jobBlocks, std::memory_order_relaxed);
+				impl.samplesEncoded.store(impl.position, std::memory_order_relaxed);
+				impl.bytesIn.fetch_add((uInt64)samplesPerChannel * impl.config.channels
+					* impl.sampleBytes, std::memory_order_relaxed);
+				impl.bytesOut.fetch_add(total, std::memory_order_relaxed);
+
+				*written = total;
+				return NativeSuccess;
+			}
+
+			SampleCodecCounters SampleCodecCore::Counters() const {
+
+				SampleCodecCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.blocksEncoded = _impl->blocksEncoded.load(std::memory_order_relaxed);
+					counters.samplesEncoded = _impl->samplesEncoded.load(std::memory_order_relaxed);
+					counters.bytesIn = _impl->bytesIn.load(std::memory_order_relaxed);
+					counters.bytesOut = _impl->bytesOut.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			int32 ReadCodecBlockHeader(const void* data, size_t bytes, CodecBlockHeader* header) {
+
+				if (data == nullptr || header == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (bytes < sizeof(CodecBlockHeader)) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				CodecBlockHeader h;
+				std::memcpy(&h, data, sizeof(h));
+
+				if (h.magic != CodecBlockMagic || h.version != CodecVersion
+					|| (h.sampleBytes != 2 && h.sampleBytes != 4) || h.channels == 0
+					|| h.samplesPerChannel == 0 || h.blockBytes < PayloadOffset(h.channels)) {
+					return NativeErrorInvalidFile;
+				}
+
+				if (h.blockBytes > bytes) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				*header = h;
+				return NativeSuccess;
+			}
+
+			int32 DecodeCodecBlock(const void* block, size_t bytes, int32 fillMode,
+				void* samples, size_t capacity) {
+
+				if (fillMode != DAQmx_Val_GroupByChannel && fillMode != DAQmx_Val_GroupByScanNumber) {
+					return NativeErrorInvalidArgument;
+				}
+
+				CodecBlockHeader header;
+				int32 result = ReadCodecBlockHeader(block, bytes, &header);
+				if (result != NativeSuccess) {
+					return result;
+				}
+
+				if (samples == nullptr || capacity < (size_t)header.channels * header.samplesPerChannel) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				const uInt8* src = static_cast<const uInt8*>(block);
+				uInt8* dst = static_cast<uInt8*>(samples);
+				const bool byChannel = fillMode == DAQmx_Val_GroupByChannel;
+
+				for (uInt32 ch = 0; ch < header.channels; ch++) {
+
+					void* out = dst + (byChannel ? (size_t)ch * header.samplesPerChannel : ch)
+						* header.sampleBytes;
+
+					result = DecodePayload(src, header, ch, out, byChannel ? 1 : header.channels);
+					if (result != NativeSuccess) {
+						return result;
+					}
+				}
+				return NativeSuccess;
+			}
+
+			int32 DecodeCodecChannel(const void* block, size_t bytes, uInt32 channel,
+				void* samples, size_t capacity) {
+
+				CodecBlockHeader header;
+				int32 result = ReadCodecBlockHeader(block, bytes, &header);
+				if (result != NativeSuccess) {
+					return result;
+				}
+
+				if (channel >= header.channels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (samples == nullptr || capacity < header.samplesPerChannel) {
+					return NativeErrorBufferTooSmall;
+				}
+
+				return DecodePayload(static_cast<const uInt8*>(block), header, channel, samples, 1);
+			}
+
+			int32 FindCodecBlock(const void* stream, size_t bytes, uInt64 sampleIndex,
+				size_t* offset) {
+
+				if (stream == nullptr || offset == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				const uInt8* p = static_cast<const uInt8*>(stream);
+				size_t at = 0;
+
+				while (at < bytes) {
+
+					CodecBlockHeader header;
+					const int32 result = ReadCodecBlockHeader(p + at, bytes - at, &header);
+
+					if (result == NativeErrorBufferTooSmall) {
+						// A block cut short ends the stream.
+						break;
+					}
+					if (result != NativeSuccess) {
+						return result;
+					}
+
+					if (sampleIndex < header.firstSample) {
+						break;
+					}
+					if (sampleIndex < header.firstSample + header.samplesPerChannel) {
+						*offset = at;
+						return NativeSuccess;
+					}
+					at += header.blockBytes;
+				}
+				return NativeErrorInvalidArgument;
+			}
+		}
+	}
+}
@@ -0,0 +1,203 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the lossless sample codec. Safe to include from code compiled
+* with /clr; the block encoder, its worker threads and the decoder live in
+* SampleCodecCore.cpp. The encoded layout is described in CodecFormat.h.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+#include "CodecFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Settings of a `SampleCodecCore`.
+			*/
+			struct SampleCodecConfig {
+
+				/** Number of channels in each block of samples. */
+				uInt32 channels;
+
+				/** `Int16` or `Int32`: codes of `DAQmxReadBinaryI16` / `I32`. */
+				SampleFormat format;
+
+				/** Samples per channel in one encoded block, the unit of random
+				*   access and of work for the threads. A multiple of
+				*   `CodecMiniBlockValues` packs best. */
+				uInt32 blockSamplesPerChannel;
+
+				/** Largest input accepted by one `Encode` call, in samples per
+				*   channel. Sizes the per-block output slots. */
+				uInt32 maxSamplesPerChannel;
+
+				/** Predictor, or `CodecPredictor::Auto` to pick the cheapest
+				*   for each channel and block. */
+				CodecPredictor predictor;
+
+				/** Threads encoding blocks, the calling one included; `0` for
+				*   one per logical processor. */
+				uInt32 threads;
+			};
+
+			inline SampleCodecConfig DefaultSampleCodecConfig() {
+
+				SampleCodecConfig config;
+				config.channels = 1;
+				config.format = SampleFormat::Int16;
+				config.blockSamplesPerChannel = 4096;
+				config.maxSamplesPerChannel = 65536;
+				config.predictor = CodecPredictor::Auto;
+				config.threads = 1;
+				return config;
+			}
+
+			/**
+			* @brief Counters of the encoder. Read without locking.
+			*/
+			struct SampleCodecCounters {
+				uInt64 blocksEncoded;
+				/** Samples per channel encoded since the last reset. */
+				uInt64 samplesEncoded;
+				uInt64 bytesIn;
+				uInt64 bytesOut;
+			};
+
+			/**
+			* @brief Lossless block encoder for raw `I16` / `I32` codes.
+			*
+			* Each channel of a block is predicted (none, delta or linear), the
+			* residuals are zigzag coded and bit-packed with one width per
+			* `CodecMiniBlockValues` values, using the kernels of CodecKernels.h.
+			* Quiet channels of a 16-bit device typically need 3 to 6 bits per
+			* sample.
+			*
+			* An `Encode` call is split into blocks of `blockSamplesPerChannel`;
+			* with more than one thread the blocks are encoded in parallel by
+			* a pool started in `Configure`, each into its own preallocated
+			* slot, and then copied to the output in order. `Encode`,
+			* `Configure` and `Reset` must be called from one thread at a time.
+			*/
+			class SampleCodecCore {
+
+			public:
+				SampleCodecCore();
+				~SampleCodecCore();
+
+				SampleCodecCore(const SampleCodecCore&) = delete;
+				SampleCodecCore& operator=(const SampleCodecCore&) = delete;
+
+				/**
+				* @brief Allocates the slots and the scratch buffers, starts the
+				*        worker threads and resets.
+				*
+				* @return `0`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorUnsupportedFormat` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Configure(const SampleCodecConfig& config);
+
+				/**
+				* @brief Sets the sample index of the next block back to 0 and
+				*        clears the counters.
+				*/
+				void Reset();
+
+				bool IsConfigured() const;
+
+				const SampleCodecConfig& Config() const;
+
+				/**
+				* @brief Room `Encode` may need for `samplesPerChannel` samples.
+				*/
+				size_t MaxEncodedBytes(uInt32 samplesPerChannel) const;
+
+				/**
+				* @brief Encodes a block of samples as one or more codec blocks.
+				*
+				* @param[in] data `channels * samplesPerChannel` codes.
+				* @param[in] samplesPerChannel At most `maxSamplesPerChannel`.
+				* @param[in] fillMode Layout of `data`.
+				* @param[out] out Receives the blocks.
+				* @param[in] capacity Bytes available at `out`.
+				* @param[out] written Bytes written.
+				*
+				* @return `0`, `NativeErrorBufferTooSmall` (nothing is consumed),
+				*         `NativeErrorInvalidArgument` or `NativeErrorInvalidState`.
+				*/
+				int32 Encode(const void* data, uInt32 samplesPerChannel, int32 fillMode,
+					void* out, size_t capacity, size_t* written);
+
+				SampleCodecCounters Counters() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+
+			/**
+			* @brief Checks the block at the start of `data` and copies its
+			*        header.
+			*
+			* @return `0`, `NativeErrorBufferTooSmall` if the block is cut
+			*         short, or `NativeErrorInvalidFile`.
+			*/
+			int32 ReadCodecBlockHeader(const void* data, size_t bytes, CodecBlockHeader* header);
+
+			/**
+			* @brief Decodes every channel of one block.
+			*
+			* @param[out] samples Receives `channels * samplesPerChannel` codes
+			*             laid out as `fillMode` says.
+			* @param[in] capacity Samples available at `samples`.
+			*
+			* @return `0`, `NativeErrorBufferTooSmall` or `NativeErrorInvalidFile`.
+			*/
+			int32 DecodeCodecBlock(const void* block, size_t bytes, int32 fillMode,
+				void* samples, size_t capacity);
+
+			/**
+			* @brief Decodes one channel of one block into `samplesPerChannel`
+			*        consecutive codes.
+			*/
+			int32 DecodeCodecChannel(const void* block, size_t bytes, uInt32 channel,
+				void* samples, size_t capacity);
+
+			/**
+			* @brief Finds, by hopping over block headers, the block of a stream
+			*        that holds `sampleIndex`.
+			*
+			* @param[out] offset Offset of that block in `stream`.
+			*
+			* @return `0`, `NativeErrorInvalidArgument` if the index is not in
+			*         the stream, or `NativeErrorInvalidFile`.
+			*/
+			int32 FindCodecBlock(const void* stream, size_t bytes, uInt64 sampleIndex,
+				size_t* offset);
+		}
+	}
+}
@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "NativeDAQmx.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Sample representation delivered by a read.
+			*
+			* `Float64` is scaled by the driver (`DAQmxReadAnalogF64`); the integer
+			* formats are unscaled device codes (`DAQmxReadBinary*`).
+			*/
+			enum class SampleFormat : int32 {
+				Float64 = 0,
+				Int16 = 1,
+				Int32 = 2,
+				UInt16 = 3,
+				UInt32 = 4
+			};
+
+			/**
+			* @brief Size in bytes of one sample of the given format, `0` if unknown.
+			*/
+			inline size_t SampleSize(SampleFormat format) {
+				switch (format) {
+				case SampleFormat::Float64: return sizeof(float64);
+				case SampleFormat::Int16: return sizeof(int16);
+				case SampleFormat::Int32: return sizeof(int32);
+				case SampleFormat::UInt16: return sizeof(uInt16);
+				case SampleFormat::UInt32: return sizeof(uInt32);
+				default: return 0;
+				}
+			}
+
+			/**
+			* @brief Reads a block of samples from a task into native memory.
+			*
+			* Dispatches to the DAQmx read function matching `format`.
+			*
+			* @param[in] task The task to read from.
+			* @param[in] format Sample format of the destination buffer.
+			* @param[in] sampsPerChan Number of samples per channel to read.
+			* @param[in] timeout Read timeout, in seconds.
+			* @param[in] fillMode `DAQmx_Val_GroupByChannel` or `DAQmx_Val_GroupByScanNumber`.
+			* @param[out] data Destination buffer.
+			* @param[in] bufferSizeInSamples Capacity of `data`, in samples.
+			* @param[out] sampsPerChanRead Number of samples per channel actually read.
+			*
+			* @return DAQmx status code.
+			*/
+			inline int32 ReadSamples(TaskHandle task, SampleFormat format,
+				int32 sampsPerChan, float64 timeout, int32 fillMode,
+				void* data, uInt32 bufferSizeInSamples, int32* sampsPerChanRead) {
+
+				switch (format) {
+				case SampleFormat::Float64:
+					return DAQmxReadAnalogF64(task, sampsPerChan, timeout,
+						(bool32)fillMode, static_cast<float64*>(data),
+						bufferSizeInSamples, sampsPerChanRead, NULL);
+				case SampleFormat::Int16:
+					return DAQmxReadBinaryI16(task, sampsPerChan, timeout,
+						(bool32)fillMode, static_cast<int16*>(data),
+						bufferSizeInSamples, sampsPerChanRead, NULL);
+				case SampleFormat::Int32:
+					return DAQmxReadBinaryI32(task, sampsPerChan, timeout,
+						(bool32)fillMode, static_cast<int32*>(data),
+						bufferSizeInSamples, sampsPerChanRead, NULL);
+				case SampleFormat::UInt16:
+					return DAQmxReadBinaryU16(task, sampsPerChan, timeout,
+						(bool32)fillMode, static_cast<uInt16*>(data),
+						bufferSizeInSamples, sampsPerChanRead, NULL);
+				case SampleFormat::UInt32:
+					return DAQmxReadBinaryU32(task, sampsPerChan, timeout,
+						(bool32)fillMode, static_cast<uInt32*>(data),
+						bufferSizeInSamples, sampsPerChanRead, NULL);
+				default:
+					*sampsPerChanRead = 0;
+					return NativeErrorUnsupportedFormat;
+				}
+			}
+
+			/**
+			* @brief Writes a block of samples from native memory to an output task.
+			*
+			* Dispatches to `DAQmxWriteAnalogF64` or `DAQmxWriteBinaryI16`; the
+			* other formats have no analog write and return
+			* `NativeErrorUnsupportedFormat`.
+			*
+			* @param[in] task The task to write to.
+			* @param[in] format Sample format of `data`.
+			* @param[in] sampsPerChan Number of samples per channel to write.
+			* @param[in] timeout Write timeout, in seconds.
+			* @param[in] fillMode Layout of `data`.
+			* @param[in] data Source buffer.
+			* @param[out] sampsPerChanWritten Number of samples per channel actually written.
+			*
+			* @return DAQmx status code.
+			*/
+			inline int32 WriteSamples(TaskHandle task, SampleFormat format,
+				int32 sampsPerChan, float64 timeout, int32 fillMode,
+				const void* data, int32* sampsPerChanWritten) {
+
+				switch (format) {
+				case SampleFormat::Float64:
+					return DAQmxWriteAnalogF64(task, sampsPerChan, FALSE, timeout,
+						(bool32)fillMode, static_cast<const float64*>(data),
+						sampsPerChanWritten, NULL);
+				case SampleFormat::Int16:
+					return DAQmxWriteBinaryI16(task, sampsPerChan, FALSE, timeout,
+						(bool32)fillMode, static_cast<const int16*>(data),
+						sampsPerChanWritten, NULL);
+				default:
+					*sampsPerChanWritten = 0;
+					return NativeErrorUnsupportedFormat;
+				}
+			}
+		}
+	}
+}
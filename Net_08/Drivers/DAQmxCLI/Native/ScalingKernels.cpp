@@ -0,0 +1,267 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ScalingKernels.h"
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				template <typename TOut>
+				inline TOut Horner(int16 code, const TOut* table, uInt32 period,
+					uInt32 order, uInt32 column) {
+
+					const TOut x = (TOut)code;
+					TOut y = table[(order - 1) * period + column];
+
+					for (uInt32 k = order - 1; k-- > 0;) {
+						y = y * x + table[k * period + column];
+					}
+					return y;
+				}
+
+				// Scalar loop over [begin, end); returns the column after the last sample.
+				template <typename TOut>
+				uInt32 ScaleScalar(const int16* src, TOut* dst, size_t begin, size_t end,
+					const TOut* table, uInt32 period, uInt32 order, uInt32 column) {
+
+					for (size_t i = begin; i < end; i++) {
+						dst[i] = Horner(src[i], table, period, order, column);
+						if (++column == period) {
+							column = 0;
+						}
+					}
+					return column;
+				}
+
+				// Runs samples one by one until the column is vector aligned.
+				template <typename TOut>
+				size_t AlignColumn(const int16* src, TOut* dst, size_t count,
+					const TOut* table, uInt32 period, uInt32 order, uInt32& column) {
+
+					size_t i = 0;
+					while (i < count && (column % ScalingTablePeriodAlignment) != 0) {
+						column = ScaleScalar(src, dst, i, i + 1, table, period, order, column);
+						i++;
+					}
+					return i;
+				}
+
+#if NATIVE_X86
+				NATIVE_TARGET_AVX2
+				void ScaleF64Avx2(const int16* src, float64* dst, size_t count,
+					const float64* table, uInt32 period, uInt32 order, uInt32 column) {
+
+					size_t i = AlignColumn(src, dst, count, table, period, order, column);
+
+					for (; i + 8 <= count; i += 8) {
+
+						const __m256i codes = _mm256_cvtepi16_epi32(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+						const __m256d x0 = _mm256_cvtepi32_pd(_mm256_castsi256_si128(codes));
+						const __m256d x1 = _mm256_cvtepi32_pd(_mm256_extracti128_si256(codes, 1));
+
+						const float64* c = table + (order - 1) * period + column;
+						__m256d y0 = _mm256_loadu_pd(c);
+						__m256d y1 = _mm256_loadu_pd(c + 4);
+
+						for (uInt32 k = order - 1; k-- > 0;) {
+							c = table + k * period + column;
+							y0 = _mm256_add_pd(_mm256_mul_pd(y0, x0), _mm256_loadu_pd(c));
+							y1 = _mm256_add_pd(_mm256_mul_pd(y1, x1), _mm256_loadu_pd(c + 4));
+						}
+
+						_mm256_storeu_pd(dst + i, y0);
+						_mm256_storeu_pd(dst + i + 4, y1);
+
+						column += 8;
+						if (column == period) {
+							column = 0;
+						}
+					}
+
+					ScaleScalar(src, dst, i, count, table, period, order, column);
+				}
+
+				NATIVE_TARGET_AVX2
+				void ScaleF32Avx2(const int16* src, float32* dst, size_t count,
+					const float32* table, uInt32 period, uInt32 order, uInt32 column) {
+
+					size_t i = AlignColumn(src, dst, count, table, period, order, column);
+
+					for (; i + 8 <= count; i += 8) {
+
+						const __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+
+						__m256 y = _mm256_loadu_ps(table + (order - 1) * period + column);
+
+						for (uInt32 k = order - 1; k-- > 0;) {
+							y = _mm256_add_ps(_mm256_mul_ps(y, x),
+								_mm256_loadu_ps(table + k * period + column));
+						}
+
+						_mm256_storeu_ps(dst + i, y);
+
+						column += 8;
+						if (column == period) {
+							column = 0;
+						}
+					}
+
+					ScaleScalar(src, dst, i, count, table, period, order, column);
+				}
+
+				NATIVE_TARGET_SSE41
+				void ScaleF64Sse41(const int16* src, float64* dst, size_t count,
+					const float64* table, uInt32 period, uInt32 order, uInt32 column) {
+
+					size_t i = AlignColumn(src, dst, count, table, period, order, column);
+
+					for (; i + 8 <= count; i += 8) {
+
+						const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+						const __m128i lo = _mm_cvtepi16_epi32(raw);
+						const __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(raw, 8));
+
+						__m128d x[4];
+						x[0] = _mm_cvtepi32_pd(lo);
+						x[1] = _mm_cvtepi32_pd(_mm_srli_si128(lo, 8));
+						x[2] = _mm_cvtepi32_pd(hi);
+						x[3] = _mm_cvtepi32_pd(_mm_srli_si128(hi, 8));
+
+						const float64* c = table + (order - 1) * period + column;
+						__m128d y[4];
+						for (int v = 0; v < 4; v++) {
+							y[v] = _mm_loadu_pd(c + 2 * v);
+						}
+
+						for (uInt32 k = order - 1; k-- > 0;) {
+							c = table + k * period + column;
+							for (int v = 0; v < 4; v++) {
+								y[v] = _mm_add_pd(_mm_mul_pd(y[v], x[v]), _mm_loadu_pd(c + 2 * v));
+							}
+						}
+
+						for (int v = 0; v < 4; v++) {
+							_mm_storeu_pd(dst + i + 2 * v, y[v]);
+						}
+
+						column += 8;
+						if (column == period) {
+							column = 0;
+						}
+					}
+
+					ScaleScalar(src, dst, i, count, table, period, order, column);
+				}
+
+				NATIVE_TARGET_SSE41
+				void ScaleF32Sse41(const int16* src, float32* dst, size_t count,
+					const float32* table, uInt32 period, uInt32 order, uInt32 column) {
+
+					size_t i = AlignColumn(src, dst, count, table, period, order, column);
+
+					for (; i + 8 <= count; i += 8) {
+
+						const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+						const __m128 x0 = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(raw));
+						const __m128 x1 = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(raw, 8)));
+
+						const float32* c = table + (order - 1) * period + column;
+						__m128 y0 = _mm_loadu_ps(c);
+						__m128 y1 = _mm_loadu_ps(c + 4);
+
+						for (uInt32 k = order - 1; k-- > 0;) {
+							c = table + k * period + column;
+							y0 = _mm_add_ps(_mm_mul_ps(y0, x0), _mm_loadu_ps(c));
+							y1 = _mm_add_ps(_mm_mul_ps(y1, x1), _mm_loadu_ps(c + 4));
+						}
+
+						_mm_storeu_ps(dst + i, y0);
+						_mm_storeu_ps(dst + i + 4, y1);
+
+						column += 8;
+						if (column == period) {
+							column = 0;
+						}
+					}
+
+					ScaleScalar(src, dst, i, count, table, period, order, column);
+				}
+#endif
+			}
+
+			void ScaleI16ToF64(const int16* src, float64* dst, size_t count,
+				const float64* table, uInt32 period, uInt32 order, uInt32 phase) {
+
+				if (count == 0 || order == 0 || period == 0) {
+					return;
+				}
+
+#if NATIVE_X86
+				switch (ActiveSimdLevel()) {
+				case SimdLevel::Avx2:
+					ScaleF64Avx2(src, dst, count, table, period, order, phase);
+					return;
+				case SimdLevel::Sse41:
+					ScaleF64Sse41(src, dst, count, table, period, order, phase);
+					return;
+				default:
+					break;
+				}
+#endif
+				ScaleScalar(src, dst, 0, count, table, period, order, phase);
+			}
+
+			void ScaleI16ToF32(const int16* src, float32* dst, size_t count,
+				const float32* table, uInt32 period, uInt32 order, uInt32 phase) {
+
+				if (count == 0 || order == 0 || period == 0) {
+					return;
+				}
+
+#if NATIVE_X86
+				switch (ActiveSimdLevel()) {
+				case SimdLevel::Avx2:
+					ScaleF32Avx2(src, dst, count, table, period, order, phase);
+					return;
+				case SimdLevel::Sse41:
+					ScaleF32Sse41(src, dst, count, table, period, order, phase);
+					return;
+				default:
+					break;
+				}
+#endif
+				ScaleScalar(src, dst, 0, count, table, period, order, phase);
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized raw-to-engineering-unit conversion.
+*
+* DAQmx describes the scaling of an AI channel as a polynomial in the raw
+* ADC code: y = c[0] + c[1]*x + c[2]*x^2 + ... The kernels below evaluate
+* that polynomial (Horner form) over a run of I16 codes.
+*
+* Coefficients are passed as a table laid out `table[k * period + p]`: the
+* sample at position `i` of the run uses the coefficients of column
+* `i % period`. A contiguous single-channel run uses a table whose columns
+* are all equal; an interleaved (GroupByScanNumber) run uses columns that
+* cycle through the channels. `period` must be a multiple of
+* `ScalingTablePeriodAlignment` so that a vector never straddles a wrap.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Highest number of polynomial coefficients supported per channel.
+			*/
+			constexpr uInt32 MaxScalingCoeffs = 8;
+
+			/**
+			* @brief Required granularity of the coefficient table period, in samples.
+			*/
+			constexpr uInt32 ScalingTablePeriodAlignment = 8;
+
+			/**
+			* @brief Converts `count` I16 codes to F64.
+			*
+			* @param[in] src Raw codes.
+			* @param[out] dst Scaled values; may not overlap `src`.
+			* @param[in] count Number of samples.
+			* @param[in] table Coefficient table, `order * period` elements.
+			* @param[in] period Columns of the table; a multiple of `ScalingTablePeriodAlignment`.
+			* @param[in] order Number of coefficients, 1 .. `MaxScalingCoeffs`.
+			* @param[in] phase Column used by the first sample, below `period`.
+			*/
+			void ScaleI16ToF64(const int16* src, float64* dst, size_t count,
+				const float64* table, uInt32 period, uInt32 order, uInt32 phase = 0);
+
+			/**
+			* @brief Converts `count` I16 codes to F32. The polynomial is evaluated
+			*        in single precision.
+			*
+			* @see ScaleI16ToF64
+			*/
+			void ScaleI16ToF32(const int16* src, float32* dst, size_t count,
+				const float32* table, uInt32 period, uInt32 order, uInt32 phase = 0);
+		}
+	}
+}
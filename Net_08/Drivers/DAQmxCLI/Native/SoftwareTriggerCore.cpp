@@ -0,0 +1,642 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SoftwareTriggerCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "NativeStatus.h"
+#include "RawScalingCore.h"
+#include "SpscRing.h"
+#include "TransposeKernels.h"
+#include "TriggerKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				struct CaptureHeader {
+					uInt64 triggerSample;
+					uInt64 sequence;
+					TriggerSlope slope;
+				};
+
+				struct PendingTrigger {
+					uInt64 triggerSample;
+					TriggerSlope slope;
+				};
+
+				// One comparison of the detector, with its threshold in the
+				// units of the data and, for I16, in codes.
+				struct Condition {
+					CrossingTest test;
+					float64 threshold;
+					int32 code;
+				};
+
+				const size_t RisingSlope = 0;
+				const size_t FallingSlope = 1;
+
+				CrossingTest Mirror(CrossingTest test) {
+					switch (test) {
+					case CrossingTest::Below: return CrossingTest::Above;
+					case CrossingTest::AtOrAbove: return CrossingTest::AtOrBelow;
+					case CrossingTest::Above: return CrossingTest::Below;
+					default: return CrossingTest::AtOrAbove;
+					}
+				}
+
+				// Converts `value op threshold` on scaled values into the
+				// equivalent test on integer codes `x` with `value = offset +
+				// gain * x`.
+				Condition MakeCondition(CrossingTest test, float64 threshold,
+					bool codes, float64 offset, float64 gain) {
+
+					Condition c;
+					c.test = test;
+					c.threshold = threshold;
+					c.code = 0;
+
+					if (!codes) {
+						return c;
+					}
+
+					float64 t = (threshold - offset) / gain;
+
+					if (gain < 0.0) {
+						c.test = Mirror(test);
+					}
+
+					// x < t is x < ceil(t) and x >= t is x >= ceil(t) for integers;
+					// x > t and x <= t compare with floor(t).
+					t = (c.test == CrossingTest::Below || c.test == CrossingTest::AtOrAbove)
+						? std::ceil(t) : std::floor(t);
+					t = (t < -65536.0) ? -65536.0 : (t > 65536.0) ? 65536.0 : t;
+					c.code = (int32)t;
+					return c;
+				}
+
+				template <typename T>
+				void GatherChannel(const T* src, uInt32 channels, uInt32 channel,
+					uInt32 samples, T* dst) {
+
+					for (uInt32 i = 0; i < samples; i++) {
+						dst[i] = src[(size_t)i * channels + channel];
+					}
+				}
+			}
+
+			struct SoftwareTriggerCore::Impl {
+
+				SoftwareTriggerConfig config;
+				bool configured;
+				size_t sampleSize;
+				uInt32 window;
+
+				// Scan-major history of the last `historySamples` samples.
+				uint8_t* history;
+				uInt64 historySamples;
+				uInt64 position;
+
+				// Source channel of blocks grouped by scan.
+				void* sourceScratch;
+
+				// Detector: per slope, the arming and the firing condition.
+				float64 offset;
+				float64 gain;
+				Condition arm[2];
+				Condition fire[2];
+				bool armed[2];
+				uInt64 idleUntil;
+
+				std::vector<PendingTrigger> pending;
+				size_t pendingHead;
+				size_t pendingCount;
+
+				SpscBlockRing<CaptureHeader> ring;
+				uInt64 sequence;
+
+				std::atomic<uInt64> samplesScanned;
+				std::atomic<uInt64> triggers;
+				std::atomic<uInt64> capturesDropped;
+
+				std::atomic<int32> waiters;
+				std::mutex waitMutex;
+				std::condition_variable waitCondition;
+
+				Impl() :
+					config(DefaultSoftwareTriggerConfig()), configured(false),
+					sampleSize(0), window(0), history(nullptr), historySamples(0),
+					position(0), sourceScratch(nullptr), offset(0.0), gain(1.0),
+					idleUntil(0), pendingHead(0), pendingCount(0), sequence(0),
+					samplesScanned(0), triggers(0), capturesDropped(0), waiters(0) {
+
+					armed[RisingSlope] = armed[FallingSlope] = false;
+				}
+
+				~Impl() {
+					AlignedFree(history);
+					AlignedFree(sourceScratch);
+				}
+
+				void UpdateConditions() {
+
+					const bool codes = (config.format == SampleFormat::Int16);
+					const float64 level = config.level;
+					const float64 h = config.hysteresis;
+
+					arm[RisingSlope] = MakeCondition(CrossingTest::Below, level - h, codes, offset, gain);
+					fire[RisingSlope] = MakeCondition(CrossingTest::AtOrAbove, level, codes, offset, gain);
+					arm[FallingSlope] = MakeCondition(CrossingTest::Above, level + h, codes, offset, gain);
+					fire[FallingSlope] = MakeCondition(CrossingTest::AtOrBelow, level, codes, offset, gain);
+				}
+
+				size_t Find(const void* source, size_t begin, size_t end,
+					const Condition& c) const {
+
+					if (config.format == SampleFormat::Float64) {
+						return begin + FindFirstF64(static_cast<const float64*>(source) + begin,
+							end - begin, c.test, c.threshold);
+					}
+					return begin + FindFirstI16(static_cast<const int16*>(source) + begin,
+						end - begin, c.test, c.code);
+				}
+
+				bool Passes(const void* source, size_t i, const Condition& c) const {
+					return Find(source, i, i + 1, c) == i;
+				}
+
+				void AppendHistory(const uint8_t* data, uInt32 n, int32 fillMode) {
+
+					const uInt32 channels = config.channels;
+					const size_t scanBytes = (size_t)channels * sampleSize;
+
+					for (uInt32 done = 0; done < n;) {
+
+						const uInt64 slot = (position + done) % historySamples;
+						const uInt32 run = (uInt32)(((historySamples - slot) < (uInt64)(n - done))
+							? historySamples - slot : n - done);
+						uint8_t* dst = history + slot * scanBytes;
+
+						if (fillMode == DAQmx_Val_GroupByScanNumber || channels == 1) {
+							std::memcpy(dst, data + (size_t)done * scanBytes, (size_t)run * scanBytes);
+						}
+						else {
+							TransposeStrided(data + (size_t)done * sampleSize, n, dst, channels,
+								channels, run, sampleSize);
+						}
+						done += run;
+					}
+					position += n;
+				}
+
+				void CopyWindow(uInt64 first, uint8_t* dst) const {
+
+					const uInt32 channels = config.channels;
+					const size_t scanBytes = (size_t)channels * sampleSize;
+
+					for (uInt32 done = 0; done < window;) {
+
+						const uInt64 slot = (first + done) % historySamples;
+						const uInt32 run = (uInt32)(((historySamples - slot) < (uInt64)(window - done))
+							? historySamples - slot : window - done);
+						const uint8_t* src = history + slot * scanBytes;
+
+						if (config.captureFillMode == DAQmx_Val_GroupByScanNumber || channels == 1) {
+							std::memcpy(dst + (size_t)done * scanBytes, src, (size_t)run * scanBytes);
+						}
+						else {
+							TransposeStrided(src, channels, dst + (size_t)done * sampleSize, window,
+								run, channels, sampleSize);
+						}
+						done += run;
+					}
+				}
+
+				void AddPending(uInt64 triggerSample, TriggerSlope slope) {
+
+					triggers.fetch_add(1, std::memory_order_relaxed);
+
+					if (pendingCount == pending.size()) {
+						capturesDropped.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+
+					PendingTrigger& p = pending[(pendingHead + pendingCount) % pending.size()];
+					p.triggerSample = triggerSample;
+					p.slope = slope;
+					pendingCount++;
+				}
+
+				// Runs the detector over `n` samples of the source channel that
+				// start at absolute index `base`; returns the number of triggers.
+				int32 Scan(const void* source, uInt64 base, uInt32 n) {
+
+					const bool useSlope[2] = {
+						config.slope != TriggerSlope::Falling,
+						config.slope != TriggerSlope::Rising
+					};
+
+					// Idle until the pre-trigger window is in the history and the
+					// holdoff has passed.
+					uInt64 start = (idleUntil > config.preTriggerSamples)
+						? idleUntil : config.preTriggerSamples;
+					size_t i = (start > base) ? (size_t)((start - base < n) ? start - base : n) : 0;
+					int32 fired = 0;
+
+					while (i < n) {
+
+						// Next sample on which a condition of either slope holds.
+						size_t next = n;
+
+						for (size_t s = 0; s < 2; s++) {
+							if (useSlope[s]) {
+								next = Find(source, i, next, armed[s] ? fire[s] : arm[s]);
+							}
+						}
+
+						if (next == n) {
+							break;
+						}
+
+						bool triggered = false;
+
+						for (size_t s = 0; s < 2 && !triggered; s++) {
+
+							if (!useSlope[s]) {
+								continue;
+							}
+
+							if (!armed[s]) {
+								armed[s] = Passes(source, next, arm[s]);
+							}
+							else if (Passes(source, next, fire[s])) {
+
+								armed[s] = false;
+								triggered = true;
+								AddPending(base + next,
+									(s == RisingSlope) ? TriggerSlope::Rising : TriggerSlope::Falling);
+							}
+						}
+
+						if (triggered) {
+
+							fired++;
+							const uInt64 holdoff = (config.holdoffSamples > 0) ? config.holdoffSamples : 1;
+							idleUntil = base + next + holdoff;
+							i = (idleUntil - base < n) ? (size_t)(idleUntil - base) : n;
+						}
+						else {
+							i = next + 1;
+						}
+					}
+					return fired;
+				}
+
+				// Publishes the captures whose post-trigger part has arrived.
+				void CompletePending() {
+
+					bool published = false;
+
+					while (pendingCount > 0) {
+
+						const PendingTrigger& p = pending[pendingHead];
+
+						if (p.triggerSample + config.postTriggerSamples > position) {
+							break;
+						}
+
+						CaptureHeader* header = nullptr;
+						uint8_t* slot = ring.BeginWrite(header);
+
+						if (slot == nullptr) {
+							capturesDropped.fetch_add(1, std::memory_order_relaxed);
+						}
+						else {
+							CopyWindow(p.triggerSample - config.preTriggerSamples, slot);
+							header->triggerSample = p.triggerSample;
+							header->sequence = sequence;
+							header->slope = p.slope;
+							ring.CommitWrite();
+							published = true;
+						}
+
+						sequence++;
+						pendingHead = (pendingHead + 1) % pending.size();
+						pendingCount--;
+					}
+
+					if (!published) {
+						return;
+					}
+
+					// Orders the commits before the waiter check; pairs with the
+					// increment in WaitAcquireCapture.
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if (waiters.load(std::memory_order_relaxed) > 0) {
+						std::lock_guard<std::mutex> lock(waitMutex);
+						waitCondition.notify_all();
+					}
+				}
+
+				void FillCapture(const uint8_t* slot, const CaptureHeader* header,
+					TriggerCapture& capture) const {
+
+					capture.data = slot;
+					capture.samplesPerChannel = window;
+					capture.channels = config.channels;
+					capture.format = config.format;
+					capture.fillMode = config.captureFillMode;
+					capture.triggerSample = header->triggerSample;
+					capture.firstSample = header->triggerSample - config.preTriggerSamples;
+					capture.slope = header->slope;
+					capture.sequence = header->sequence;
+				}
+			};
+
+			SoftwareTriggerCore::SoftwareTriggerCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			SoftwareTriggerCore::~SoftwareTriggerCore() {
+
+				if (_impl != nullptr) {
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 SoftwareTriggerCore::Configure(const SoftwareTriggerConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (config.format != SampleFormat::Float64 && config.format != SampleFormat::Int16) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				if (config.channels == 0 || config.sourceChannel >= config.channels
+					|| config.maxSamplesPerChannel == 0 || config.captureSlots == 0
+					|| (uInt64)config.preTriggerSamples + config.postTriggerSamples == 0
+					|| (uInt64)config.preTriggerSamples + config.postTriggerSamples > 0x7FFFFFFF
+					|| !std::isfinite(config.level) || !std::isfinite(config.hysteresis)
+					|| config.hysteresis < 0.0
+					|| (config.slope != TriggerSlope::Rising && config.slope != TriggerSlope::Falling
+						&& config.slope != TriggerSlope::Either)
+					|| (config.captureFillMode != DAQmx_Val_GroupByChannel
+						&& config.captureFillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				impl.configured = false;
+				impl.config = config;
+				impl.sampleSize = SampleSize(config.format);
+				impl.window = config.preTriggerSamples + config.postTriggerSamples;
+				impl.historySamples = (uInt64)impl.window + config.maxSamplesPerChannel;
+
+				const size_t scanBytes = (size_t)config.channels * impl.sampleSize;
+
+				AlignedFree(impl.history);
+				AlignedFree(impl.sourceScratch);
+				impl.history = static_cast<uint8_t*>(AlignedAlloc((size_t)impl.historySamples * scanBytes));
+				impl.sourceScratch = AlignedAlloc((size_t)config.maxSamplesPerChannel * impl.sampleSize);
+
+				if (impl.history == nullptr || impl.sourceScratch == nullptr
+					|| !impl.ring.Allocate((config.captureSlots < 2) ? 2 : config.captureSlots,
+						(size_t)impl.window * scanBytes)) {
+					return NativeErrorOutOfMemory;
+				}
+
+				try {
+					impl.pending.assign(config.captureSlots, PendingTrigger());
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.offset = 0.0;
+				impl.gain = 1.0;
+				impl.UpdateConditions();
+				impl.configured = true;
+				Reset();
+				return NativeSuccess;
+			}
+
+			int32 SoftwareTriggerCore::SetScaling(const RawScalingCore* scaling) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+				float64 coeffs[MaxScalingCoeffs] = { 0.0, 1.0 };
+
+				if (scaling != nullptr) {
+
+					if (scaling->Channels() != impl.config.channels) {
+						return NativeErrorInvalidArgument;
+					}
+
+					scaling->GetChannelCoefficients(impl.config.sourceChannel, coeffs,
+						MaxScalingCoeffs);
+
+					if (coeffs[1] == 0.0 || !std::isfinite(coeffs[1])) {
+						return NativeErrorInvalidArgument;
+					}
+				}
+
+				impl.offset = coeffs[0];
+				impl.gain = coeffs[1];
+				impl.UpdateConditions();
+				return NativeSuccess;
+			}
+
+			void SoftwareTriggerCore::Reset() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+				impl.position = 0;
+				impl.armed[RisingSlope] = impl.armed[FallingSlope] = false;
+				impl.idleUntil = 0;
+				impl.pendingHead = 0;
+				impl.pendingCount = 0;
+				impl.sequence = 0;
+				impl.ring.Reset();
+				impl.samplesScanned.store(0);
+				impl.triggers.store(0);
+				impl.capturesDropped.store(0);
+			}
+
+			bool SoftwareTriggerCore::IsConfigured() const {
+				return _impl != nullptr && _impl->configured;
+			}
+
+			const SoftwareTriggerConfig& SoftwareTriggerCore::Config() const {
+				return _impl->config;
+			}
+
+			int32 SoftwareTriggerCore::Process(const void* data, uInt32 samplesPerChannel,
+				int32 fillMode) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+				const SoftwareTriggerConfig& config = impl.config;
+
+				if ((data == nullptr && samplesPerChannel > 0)
+					|| samplesPerChannel > config.maxSamplesPerChannel
+					|| (fillMode != DAQmx_Val_GroupByChannel
+						&& fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (samplesPerChannel == 0) {
+					return 0;
+				}
+
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				const void* source = bytes;
+
+				if (fillMode == DAQmx_Val_GroupByChannel) {
+					source = bytes + (size_t)config.sourceChannel * samplesPerChannel * impl.sampleSize;
+				}
+				else if (config.channels > 1) {
+
+					if (config.format == SampleFormat::Float64) {
+						GatherChannel(static_cast<const float64*>(data), config.channels,
+							config.sourceChannel, samplesPerChannel,
+							static_cast<float64*>(impl.sourceScratch));
+					}
+					else {
+						GatherChannel(static_cast<const int16*>(data), config.channels,
+							config.sourceChannel, samplesPerChannel,
+							static_cast<int16*>(impl.sourceScratch));
+					}
+					source = impl.sourceScratch;
+				}
+
+				const uInt64 base = impl.position;
+				impl.AppendHistory(bytes, samplesPerChannel, fillMode);
+
+				const int32 fired = impl.Scan(source, base, samplesPerChannel);
+				impl.CompletePending();
+
+				impl.samplesScanned.fetch_add(samplesPerChannel, std::memory_order_relaxed);
+				return fired;
+			}
+
+			bool SoftwareTriggerCore::TryAcquireCapture(TriggerCapture& capture) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return false;
+				}
+
+				const CaptureHeader* header = nullptr;
+				const uint8_t* slot = _impl->ring.BeginRead(header);
+
+				if (slot == nullptr) {
+					return false;
+				}
+
+				_impl->FillCapture(slot, header, capture);
+				return true;
+			}
+
+			bool SoftwareTriggerCore::WaitAcquireCapture(TriggerCapture& capture,
+				uInt32 timeoutMs) {
+
+				if (TryAcquireCapture(capture)) {
+					return true;
+				}
+
+				if (_impl == nullptr || !_impl->configured) {
+					return false;
+				}
+
+				const auto deadline = std::chrono::steady_clock::now()
+					+ std::chrono::milliseconds(timeoutMs);
+
+				_impl->waiters.fetch_add(1, std::memory_order_seq_cst);
+
+				bool acquired = false;
+				{
+					std::unique_lock<std::mutex> lock(_impl->waitMutex);
+
+					while (!(acquired = TryAcquireCapture(capture))) {
+
+						if (_impl->waitCondition.wait_until(lock, deadline)
+							== std::cv_status::timeout) {
+							acquired = TryAcquireCapture(capture);
+							break;
+						}
+					}
+				}
+
+				_impl->waiters.fetch_sub(1, std::memory_order_seq_cst);
+				return acquired;
+			}
+
+			void SoftwareTriggerCore::ReleaseCapture() {
+				if (_impl != nullptr) {
+					_impl->ring.EndRead();
+				}
+			}
+
+			size_t SoftwareTriggerCore::PendingCaptures() const {
+				return (_impl != nullptr) ? _impl->ring.Count() : 0;
+			}
+
+			TriggerCounters SoftwareTriggerCore::Counters() const {
+
+				TriggerCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.samplesScanned = _impl->samplesScanned.load(std::memory_order_relaxed);
+					counters.triggers = _impl->triggers.load(std::memory_order_relaxed);
+					counters.capturesDropped = _impl->capturesDropped.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			uInt64 SoftwareTriggerCore::Position() const {
+				return (_impl != nullptr) ? _impl->samplesScanned.load(std::memory_order_relaxed) : 0;
+			}
+		}
+	}
+}
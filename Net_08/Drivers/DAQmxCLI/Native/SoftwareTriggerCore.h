@@ -0,0 +1,247 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the software trigger. Safe to include from code compiled with
+* /clr; the detector, the history and the capture ring live in
+* SoftwareTriggerCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			class RawScalingCore;
+
+			/**
+			* @brief Direction of the level crossing that fires the trigger.
+			*/
+			enum class TriggerSlope : int32 {
+				Rising = 0,
+				Falling = 1,
+				Either = 2
+			};
+
+			/**
+			* @brief Settings of a `SoftwareTriggerCore`.
+			*/
+			struct SoftwareTriggerConfig {
+
+				/** Number of channels in each block. */
+				uInt32 channels;
+
+				/** Channel the condition is evaluated on. */
+				uInt32 sourceChannel;
+
+				/** Format of the blocks, `Float64` or `Int16`. */
+				SampleFormat format;
+
+				TriggerSlope slope;
+
+				/** Trigger level, in the units of the data (see `SetScaling`). */
+				float64 level;
+
+				/**
+				* Hysteresis, >= 0. A rising trigger re-arms only after the signal
+				* went below `level - hysteresis`, a falling one after it went
+				* above `level + hysteresis`.
+				*/
+				float64 hysteresis;
+
+				/** Samples per channel captured before the trigger sample. */
+				uInt32 preTriggerSamples;
+
+				/** Samples per channel captured from the trigger sample on. */
+				uInt32 postTriggerSamples;
+
+				/** Samples after a trigger during which the detector is idle. */
+				uInt32 holdoffSamples;
+
+				/** Largest block accepted, in samples per channel. */
+				uInt32 maxSamplesPerChannel;
+
+				/** Completed captures the ring holds until they are consumed. */
+				uInt32 captureSlots;
+
+				/** Layout of the captured windows. */
+				int32 captureFillMode;
+			};
+
+			inline SoftwareTriggerConfig DefaultSoftwareTriggerConfig() {
+
+				SoftwareTriggerConfig config;
+				config.channels = 1;
+				config.sourceChannel = 0;
+				config.format = SampleFormat::Float64;
+				config.slope = TriggerSlope::Rising;
+				config.level = 0.0;
+				config.hysteresis = 0.0;
+				config.preTriggerSamples = 1000;
+				config.postTriggerSamples = 1000;
+				config.holdoffSamples = 0;
+				config.maxSamplesPerChannel = 10000;
+				config.captureSlots = 8;
+				config.captureFillMode = DAQmx_Val_GroupByChannel;
+				return config;
+			}
+
+			/**
+			* @brief A captured window, valid until `ReleaseCapture`.
+			*/
+			struct TriggerCapture {
+				const void* data;
+				uInt32 samplesPerChannel;
+				uInt32 channels;
+				SampleFormat format;
+				int32 fillMode;
+
+				/** Index, per channel, of the sample that fired the trigger. */
+				uInt64 triggerSample;
+
+				/** Index of the first sample of the window:
+				*   `triggerSample - preTriggerSamples`. */
+				uInt64 firstSample;
+
+				/** `Rising` or `Falling`. */
+				TriggerSlope slope;
+
+				/** Running trigger number since the last reset. */
+				uInt64 sequence;
+			};
+
+			/**
+			* @brief Counters of the trigger. Read without locking.
+			*/
+			struct TriggerCounters {
+				uInt64 samplesScanned;
+				uInt64 triggers;
+				/** Triggers whose window was lost because the ring was full. */
+				uInt64 capturesDropped;
+			};
+
+			/**
+			* @brief Native level trigger with hysteresis and slope, evaluated on
+			*        one channel of a continuous stream of blocks.
+			*
+			* Every block goes into a history ring that holds the pre-trigger
+			* window, the post-trigger window and one block. The source channel
+			* is scanned with the kernels of TriggerKernels.h. When the trigger
+			* fires, the window around it is copied out of the history into the
+			* next slot of a preallocated lock-free capture ring as soon as
+			* its post-trigger part has arrived. Only the windows leave native
+			* code; a consumer takes them as zero-copy views, like the blocks of
+			* `AcquisitionEngineCore`.
+			*
+			* The detector is armed once the history holds a full pre-trigger
+			* window, so every capture has `preTriggerSamples +
+			* postTriggerSamples` samples per channel. Triggers whose window is
+			* still incomplete when the ring is full are counted as dropped.
+			*
+			* `Process` runs on one producer thread, e.g. inside the callback of
+			* `AcquisitionEngineCore` (see `AcquisitionEngineCore::SetTrigger`);
+			* one consumer thread takes the captures. `Configure`, `SetScaling`
+			* and `Reset` must not run concurrently with either.
+			*/
+			class SoftwareTriggerCore {
+
+			public:
+				SoftwareTriggerCore();
+				~SoftwareTriggerCore();
+
+				SoftwareTriggerCore(const SoftwareTriggerCore&) = delete;
+				SoftwareTriggerCore& operator=(const SoftwareTriggerCore&) = delete;
+
+				/**
+				* @brief Allocates the history and the capture ring and resets.
+				*
+				* @return `0`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorUnsupportedFormat` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Configure(const SoftwareTriggerConfig& config);
+
+				/**
+				* @brief For `Int16` blocks, takes `level` and `hysteresis` in
+				*        engineering units and converts them to codes with the
+				*        offset and gain of the source channel. `nullptr` compares
+				*        the raw codes.
+				*/
+				int32 SetScaling(const RawScalingCore* scaling);
+
+				/**
+				* @brief Clears the history, the detector state, the counters and
+				*        the capture ring. No capture may be held.
+				*/
+				void Reset();
+
+				bool IsConfigured() const;
+
+				const SoftwareTriggerConfig& Config() const;
+
+				/**
+				* @brief Appends one block and scans it.
+				*
+				* @param[in] data `channels * samplesPerChannel` samples in the
+				*            configured format.
+				* @param[in] samplesPerChannel At most `maxSamplesPerChannel`.
+				* @param[in] fillMode Layout of `data`.
+				*
+				* @return The number of triggers in the block, or a negative status.
+				*/
+				int32 Process(const void* data, uInt32 samplesPerChannel, int32 fillMode);
+
+				/**
+				* @brief Gets the oldest completed capture without waiting.
+				*/
+				bool TryAcquireCapture(TriggerCapture& capture);
+
+				/**
+				* @brief Waits up to `timeoutMs` for a completed capture.
+				*/
+				bool WaitAcquireCapture(TriggerCapture& capture, uInt32 timeoutMs);
+
+				/**
+				* @brief Returns the capture taken by the last successful acquire.
+				*        Does nothing if no capture is held.
+				*/
+				void ReleaseCapture();
+
+				size_t PendingCaptures() const;
+
+				TriggerCounters Counters() const;
+
+				/**
+				* @brief Samples per channel processed since the last reset.
+				*/
+				uInt64 Position() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Native only: uses <atomic> and must not be included from code compiled
+* with /clr. Managed wrappers reach the ring through the engine facades.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "AlignedMemory.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Lock-free single-producer/single-consumer ring of fixed-size blocks.
+			*
+			* All memory is allocated once by `Allocate`. The producer asks for the
+			* next free slot with `BeginWrite`, fills it in place and publishes it
+			* with `CommitWrite`. The consumer gets a pointer to the oldest published
+			* slot with `BeginRead` and returns it with `EndRead`. Neither side ever
+			* copies or allocates, so the producer can run on the driver callback
+			* thread.
+			*
+			* Every slot carries a header of type `THeader` next to the data. Head and
+			* tail live on separate cache lines, and each side keeps a private copy of
+			* the other side's index so that it only touches the shared line when the
+			* ring looks full (or empty).
+			*
+			* @tparam THeader Trivially copyable per-block metadata.
+			*/
+			template <typename THeader>
+			class SpscBlockRing {
+
+			public:
+				SpscBlockRing() :
+					_data(nullptr), _headers(nullptr), _slotCount(0),
+					_slotBytes(0), _mask(0),
+					_head(0), _cachedTail(0), _tail(0), _cachedHead(0), _reading(false) {}
+
+				~SpscBlockRing() {
+					Free();
+				}
+
+				SpscBlockRing(const SpscBlockRing&) = delete;
+				SpscBlockRing& operator=(const SpscBlockRing&) = delete;
+
+				/**
+				* @brief Allocates the ring storage.
+				*
+				* @param[in] slotCount Number of slots; rounded up to a power of two.
+				* @param[in] slotBytes Size of the data area of each slot, in bytes.
+				*                      Rounded up to a whole number of cache lines.
+				*
+				* @return `true` on success, `false` if the memory could not be allocated.
+				*/
+				bool Allocate(size_t slotCount, size_t slotBytes) {
+
+					Free();
+
+					if (slotCount < 2 || slotBytes == 0) {
+						return false;
+					}
+
+					_slotCount = RoundUpToPowerOfTwo(slotCount);
+					_slotBytes = RoundUpToCacheLine(slotBytes);
+					_mask = _slotCount - 1;
+
+					_data = static_cast<uint8_t*>(
+						AlignedAlloc(_slotCount * _slotBytes));
+					_headers = static_cast<THeader*>(
+						AlignedAlloc(_slotCount * sizeof(THeader)));
+
+					if (_data == nullptr || _headers == nullptr) {
+						Free();
+						return false;
+					}
+
+					Reset();
+					return true;
+				}
+
+				/**
+				* @brief Releases the ring storage.
+				*/
+				void Free() {
+					AlignedFree(_data);
+					AlignedFree(_headers);
+					_data = nullptr;
+					_headers = nullptr;
+					_slotCount = 0;
+					_slotBytes = 0;
+					_mask = 0;
+				}
+
+				/**
+				* @brief Empties the ring. Must not race with either side.
+				*/
+				void Reset() {
+					_head.store(0, std::memory_order_relaxed);
+					_tail.store(0, std::memory_order_relaxed);
+					_cachedTail = 0;
+					_cachedHead = 0;
+					_reading = false;
+				}
+
+				/**
+				* @brief Producer: returns the next free slot, or `nullptr` if the ring is full.
+				*
+				* @param[out] header Receives a pointer to the header of the slot.
+				*/
+				uint8_t* BeginWrite(THeader*& header) {
+
+					const uint64_t head = _head.load(std::memory_order_relaxed);
+
+					if (head - _cachedTail >= _slotCount) {
+						_cachedTail = _tail.load(std::memory_order_acquire);
+						if (head - _cachedTail >= _slotCount) {
+							return nullptr;
+						}
+					}
+
+					const size_t index = static_cast<size_t>(head & _mask);
+					header = &_headers[index];
+					return _data + index * _slotBytes;
+				}
+
+				/**
+				* @brief Producer: publishes the slot returned by the last `BeginWrite`.
+				*/
+				void CommitWrite() {
+					_head.store(_head.load(std::memory_order_relaxed) + 1,
+						std::memory_order_release);
+				}
+
+				/**
+				* @brief Consumer: returns the oldest published slot, or `nullptr` if
+				*        the ring is empty.
+				*
+				* @param[out] header Receives a pointer to the header of the slot.
+				*/
+				const uint8_t* BeginRead(const THeader*& header) {
+
+					const uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+					if (tail == _cachedHead) {
+						_cachedHead = _head.load(std::memory_order_acquire);
+						if (tail == _cachedHead) {
+							return nullptr;
+						}
+					}
+
+					const size_t index = static_cast<size_t>(tail & _mask);
+					header = &_headers[index];
+					_reading = true;
+					return _data + index * _slotBytes;
+				}
+
+				/**
+				* @brief Consumer: returns the slot obtained by the last `BeginRead`
+				*        to the producer.
+				*
+				* @return `false`, and nothing happens, if no slot is held: the
+				*         tail never passes the head.
+				*/
+				bool EndRead() {
+
+					if (!_reading) {
+						return false;
+					}
+
+					_reading = false;
+					_tail.store(_tail.load(std::memory_order_relaxed) + 1,
+						std::memory_order_release);
+					return true;
+				}
+
+				/**
+				* @brief Number of published slots not yet consumed. Approximate
+				*        when called concurrently with either side.
+				*/
+				size_t Count() const {
+					return static_cast<size_t>(
+						_head.load(std::memory_order_acquire) -
+						_tail.load(std::memory_order_acquire));
+				}
+
+				/**
+				* @brief Total number of slots.
+				*/
+				size_t Capacity() const { return _slotCount; }
+
+				/**
+				* @brief Size of the data area of one slot, in bytes.
+				*/
+				size_t SlotBytes() const { return _slotBytes; }
+
+			private:
+				uint8_t* _data;
+				THeader* _headers;
+				size_t _slotCount;
+				size_t _slotBytes;
+				uint64_t _mask;
+
+				// Producer side.
+				alignas(CacheLineSize) std::atomic<uint64_t> _head;
+				uint64_t _cachedTail;
+
+				// Consumer side.
+				alignas(CacheLineSize) std::atomic<uint64_t> _tail;
+				uint64_t _cachedHead;
+				bool _reading;
+
+				// Keeps the consumer line from sharing with whatever follows.
+				char _padding[CacheLineSize - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t) - sizeof(bool)];
+			};
+		}
+	}
+}
@@ -0,0 +1,413 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "StatisticsKernels.h"
+
+#include <cmath>
+#include <limits>
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Vector steps before the 32-bit lane sums of I16 samples, which
+				// grow by at most 2^16 per step, are widened to 64 bits.
+				const size_t MaxSteps = 16384;
+
+				// Neumaier's variant of Kahan summation: also correct when the
+				// added term is larger than the running sum.
+				inline void CompensatedAdd(float64& sum, float64& compensation, float64 x) {
+
+					const float64 t = sum + x;
+					compensation += (std::fabs(sum) >= std::fabs(x)) ? (sum - t) + x : (x - t) + sum;
+					sum = t;
+				}
+
+				// Sums, extremes and count are filled in; computes `m2` with a
+				// second pass around the mean.
+				void FinishF64(const float64* x, size_t count, size_t begin,
+					float64 sum, float64 compensation, float64 lo, float64 hi,
+					float64 m2Vector, ChannelMoments& m) {
+
+					for (size_t i = begin; i < count; i++) {
+						CompensatedAdd(sum, compensation, x[i]);
+						lo = (x[i] < lo) ? x[i] : lo;
+						hi = (x[i] > hi) ? x[i] : hi;
+					}
+
+					m.count = count;
+					m.sum = sum;
+					m.compensation = compensation;
+					m.min = lo;
+					m.max = hi;
+					m.m2 = m2Vector;
+				}
+
+				float64 DeviationsScalar(const float64* x, size_t begin, size_t count,
+					float64 mean) {
+
+					float64 m2 = 0.0;
+					for (size_t i = begin; i < count; i++) {
+						const float64 d = x[i] - mean;
+						m2 += d * d;
+					}
+					return m2;
+				}
+
+				ChannelMoments MomentsF64Scalar(const float64* x, size_t count) {
+
+					ChannelMoments m = EmptyMoments();
+					FinishF64(x, count, 0, 0.0, 0.0, m.min, m.max, 0.0, m);
+
+					const float64 mean = (m.sum + m.compensation) / (float64)count;
+					m.m2 = DeviationsScalar(x, 0, count, mean);
+					return m;
+				}
+
+				// Mean of `b` minus mean of `a`. The rounding residual of each
+				// division is recovered with an FMA and added back, so the
+				// difference stays accurate when the means are large compared
+				// to it.
+				float64 MeanDifference(const ChannelMoments& a, float64 na,
+					const ChannelMoments& b, float64 nb) {
+
+					const float64 qa = a.sum / na;
+					const float64 qb = b.sum / nb;
+					const float64 ra = std::fma(-qa, na, a.sum) + a.compensation;
+					const float64 rb = std::fma(-qb, nb, b.sum) + b.compensation;
+					return (qb - qa) + (rb / nb - ra / na);
+				}
+
+				ChannelMoments FinishI16(size_t count, int64 sum, uInt64 sumSquares,
+					int32 lo, int32 hi) {
+
+					ChannelMoments m;
+					m.count = count;
+					m.sum = (float64)sum;
+					// `sum` is exact; the rounding of the conversion is kept.
+					m.compensation = (float64)(sum - (int64)m.sum);
+					m.min = (float64)lo;
+					m.max = (float64)hi;
+
+					// m2 = sumSquares - sum^2 / count. With sum = q * count + r the
+					// integer part, sumSquares - q * sum - q * r, is exact, so only
+					// r^2 / count is rounded even when the mean is large.
+					const int64 n = (int64)count;
+					const int64 q = sum / n;
+					const int64 r = sum - q * n;
+					const float64 m2 = (float64)((int64)sumSquares - q * sum - q * r)
+						- (float64)r * (float64)r / (float64)n;
+					m.m2 = (m2 > 0.0) ? m2 : 0.0;
+					return m;
+				}
+
+				ChannelMoments MomentsI16Scalar(const int16* x, size_t count) {
+
+					int64 sum = 0;
+					uInt64 sumSquares = 0;
+					int32 lo = 32767, hi = -32768;
+
+					for (size_t i = 0; i < count; i++) {
+						const int32 v = x[i];
+						sum += v;
+						sumSquares += (uInt64)(v * v);
+						lo = (v < lo) ? v : lo;
+						hi = (v > hi) ? v : hi;
+					}
+					return FinishI16(count, sum, sumSquares, lo, hi);
+				}
+
+#if NATIVE_X86
+				NATIVE_TARGET_AVX2
+				inline void CompensatedAddAvx2(__m256d& sum, __m256d& compensation, __m256d x) {
+
+					const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+					const __m256d t = _mm256_add_pd(sum, x);
+					const __m256d sumLarger = _mm256_cmp_pd(_mm256_and_pd(sum, absMask),
+						_mm256_and_pd(x, absMask), _CMP_GE_OQ);
+					const __m256d a = _mm256_add_pd(_mm256_sub_pd(sum, t), x);
+					const __m256d b = _mm256_add_pd(_mm256_sub_pd(x, t), sum);
+					compensation = _mm256_add_pd(compensation, _mm256_blendv_pd(b, a, sumLarger));
+					sum = t;
+				}
+
+				NATIVE_TARGET_AVX2
+				ChannelMoments MomentsF64Avx2(const float64* x, size_t count) {
+
+					__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+					__m256d c0 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();
+					__m256d lo = _mm256_set1_pd(std::numeric_limits<float64>::infinity());
+					__m256d hi = _mm256_set1_pd(-std::numeric_limits<float64>::infinity());
+					size_t i = 0;
+
+					for (; i + 8 <= count; i += 8) {
+						const __m256d a = _mm256_loadu_pd(x + i);
+						const __m256d b = _mm256_loadu_pd(x + i + 4);
+						CompensatedAddAvx2(s0, c0, a);
+						CompensatedAddAvx2(s1, c1, b);
+						lo = _mm256_min_pd(lo, _mm256_min_pd(a, b));
+						hi = _mm256_max_pd(hi, _mm256_max_pd(a, b));
+					}
+
+					alignas(32) float64 lanes[4][4];
+					_mm256_store_pd(lanes[0], s0);
+					_mm256_store_pd(lanes[1], s1);
+					_mm256_store_pd(lanes[2], lo);
+					_mm256_store_pd(lanes[3], hi);
+
+					float64 sum = 0.0;
+					float64 compensation = 0.0;
+					float64 low = lanes[2][0], high = lanes[3][0];
+
+					for (int k = 0; k < 4; k++) {
+						CompensatedAdd(sum, compensation, lanes[0][k]);
+						CompensatedAdd(sum, compensation, lanes[1][k]);
+						low = (lanes[2][k] < low) ? lanes[2][k] : low;
+						high = (lanes[3][k] > high) ? lanes[3][k] : high;
+					}
+
+					_mm256_store_pd(lanes[0], _mm256_add_pd(c0, c1));
+					compensation += (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3]);
+
+					ChannelMoments m;
+					FinishF64(x, count, i, sum, compensation, low, high, 0.0, m);
+
+					const __m256d mean = _mm256_set1_pd((m.sum + m.compensation) / (float64)count);
+					__m256d d0 = _mm256_setzero_pd(), d1 = _mm256_setzero_pd();
+					size_t j = 0;
+
+					for (; j + 8 <= count; j += 8) {
+						const __m256d a = _mm256_sub_pd(_mm256_loadu_pd(x + j), mean);
+						const __m256d b = _mm256_sub_pd(_mm256_loadu_pd(x + j + 4), mean);
+						d0 = _mm256_add_pd(d0, _mm256_mul_pd(a, a));
+						d1 = _mm256_add_pd(d1, _mm256_mul_pd(b, b));
+					}
+
+					_mm256_store_pd(lanes[0], _mm256_add_pd(d0, d1));
+					m.m2 = (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3])
+						+ DeviationsScalar(x, j, count, (m.sum + m.compensation) / (float64)count);
+					return m;
+				}
+
+				NATIVE_TARGET_AVX2
+				ChannelMoments MomentsI16Avx2(const int16* x, size_t count) {
+
+					const __m256i ones = _mm256_set1_epi16(1);
+					const __m256i zero = _mm256_setzero_si256();
+					__m256i sum64 = _mm256_setzero_si256();
+					__m256i squares64 = _mm256_setzero_si256();
+					__m256i lo = _mm256_set1_epi16(32767);
+					__m256i hi = _mm256_set1_epi16(-32768);
+					size_t i = 0;
+
+					while (i + 16 <= count) {
+
+						__m256i sum32 = _mm256_setzero_si256();
+						const size_t steps = (count - i) / 16;
+						const size_t end = i + 16 * ((steps < MaxSteps) ? steps : MaxSteps);
+
+						for (; i < end; i += 16) {
+
+							const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+							sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(v, ones));
+
+							// A pair of squares is at most 2^31: unsigned 32 bits.
+							const __m256i squares = _mm256_madd_epi16(v, v);
+							squares64 = _mm256_add_epi64(squares64, _mm256_unpacklo_epi32(squares, zero));
+							squares64 = _mm256_add_epi64(squares64, _mm256_unpackhi_epi32(squares, zero));
+
+							lo = _mm256_min_epi16(lo, v);
+							hi = _mm256_max_epi16(hi, v);
+						}
+
+						sum64 = _mm256_add_epi64(sum64, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(sum32)));
+						sum64 = _mm256_add_epi64(sum64, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(sum32, 1)));
+					}
+
+					alignas(32) int64 sums[4];
+					alignas(32) uInt64 squares[4];
+					alignas(32) int16 lows[16], highs[16];
+					_mm256_store_si256(reinterpret_cast<__m256i*>(sums), sum64);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(squares), squares64);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(lows), lo);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(highs), hi);
+
+					int64 sum = sums[0] + sums[1] + sums[2] + sums[3];
+					uInt64 sumSquares = squares[0] + squares[1] + squares[2] + squares[3];
+					int32 low = 32767, high = -32768;
+
+					for (int k = 0; k < 16; k++) {
+						low = (lows[k] < low) ? lows[k] : low;
+						high = (highs[k] > high) ? highs[k] : high;
+					}
+
+					for (; i < count; i++) {
+						const int32 v = x[i];
+						sum += v;
+						sumSquares += (uInt64)(v * v);
+						low = (v < low) ? v : low;
+						high = (v > high) ? v : high;
+					}
+					return FinishI16(count, sum, sumSquares, low, high);
+				}
+
+				NATIVE_TARGET_SSE41
+				ChannelMoments MomentsI16Sse41(const int16* x, size_t count) {
+
+					const __m128i ones = _mm_set1_epi16(1);
+					const __m128i zero = _mm_setzero_si128();
+					__m128i sum64 = _mm_setzero_si128();
+					__m128i squares64 = _mm_setzero_si128();
+					__m128i lo = _mm_set1_epi16(32767);
+					__m128i hi = _mm_set1_epi16(-32768);
+					size_t i = 0;
+
+					while (i + 8 <= count) {
+
+						__m128i sum32 = _mm_setzero_si128();
+						const size_t steps = (count - i) / 8;
+						const size_t end = i + 8 * ((steps < MaxSteps) ? steps : MaxSteps);
+
+						for (; i < end; i += 8) {
+
+							const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+							sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(v, ones));
+
+							const __m128i squares = _mm_madd_epi16(v, v);
+							squares64 = _mm_add_epi64(squares64, _mm_unpacklo_epi32(squares, zero));
+							squares64 = _mm_add_epi64(squares64, _mm_unpackhi_epi32(squares, zero));
+
+							lo = _mm_min_epi16(lo, v);
+							hi = _mm_max_epi16(hi, v);
+						}
+
+						sum64 = _mm_add_epi64(sum64, _mm_cvtepi32_epi64(sum32));
+						sum64 = _mm_add_epi64(sum64, _mm_cvtepi32_epi64(_mm_srli_si128(sum32, 8)));
+					}
+
+					alignas(16) int64 sums[2];
+					alignas(16) uInt64 squares[2];
+					alignas(16) int16 lows[8], highs[8];
+					_mm_store_si128(reinterpret_cast<__m128i*>(sums), sum64);
+					_mm_store_si128(reinterpret_cast<__m128i*>(squares), squares64);
+					_mm_store_si128(reinterpret_cast<__m128i*>(lows), lo);
+					_mm_store_si128(reinterpret_cast<__m128i*>(highs), hi);
+
+					int64 sum = sums[0] + sums[1];
+					uInt64 sumSquares = squares[0] + squares[1];
+					int32 low = 32767, high = -32768;
+
+					for (int k = 0; k < 8; k++) {
+						low = (lows[k] < low) ? lows[k] : low;
+						high = (highs[k] > high) ? highs[k] : high;
+					}
+
+					for (; i < count; i++) {
+						const int32 v = x[i];
+						sum += v;
+						sumSquares += (uInt64)(v * v);
+						low = (v < low) ? v : low;
+						high = (v > high) ? v : high;
+					}
+					return FinishI16(count, sum, sumSquares, low, high);
+				}
+#endif
+			}
+
+			ChannelMoments EmptyMoments() {
+
+				ChannelMoments m;
+				m.count = 0;
+				m.sum = 0.0;
+				m.compensation = 0.0;
+				m.min = std::numeric_limits<float64>::infinity();
+				m.max = -std::numeric_limits<float64>::infinity();
+				m.m2 = 0.0;
+				return m;
+			}
+
+			ChannelMoments ComputeMomentsF64(const float64* x, size_t count) {
+
+				if (count == 0) {
+					return EmptyMoments();
+				}
+
+#if NATIVE_X86
+				if (ActiveSimdLevel() == SimdLevel::Avx2) {
+					return MomentsF64Avx2(x, count);
+				}
+#endif
+				return MomentsF64Scalar(x, count);
+			}
+
+			ChannelMoments ComputeMomentsI16(const int16* x, size_t count) {
+
+				if (count == 0) {
+					return EmptyMoments();
+				}
+
+#if NATIVE_X86
+				switch (ActiveSimdLevel()) {
+				case SimdLevel::Avx2:
+					return MomentsI16Avx2(x, count);
+				case SimdLevel::Sse41:
+					return MomentsI16Sse41(x, count);
+				default:
+					break;
+				}
+#endif
+				return MomentsI16Scalar(x, count);
+			}
+
+			void MergeMoments(ChannelMoments& into, const ChannelMoments& run) {
+
+				if (run.count == 0) {
+					return;
+				}
+				if (into.count == 0) {
+					into = run;
+					return;
+				}
+
+				const float64 na = (float64)into.count;
+				const float64 nb = (float64)run.count;
+				const float64 n = na + nb;
+				const float64 delta = MeanDifference(into, na, run, nb);
+
+				into.m2 += run.m2 + delta * delta * (na * nb / n);
+				into.count += run.count;
+				CompensatedAdd(into.sum, into.compensation, run.sum);
+				into.compensation += run.compensation;
+				into.min = (run.min < into.min) ? run.min : into.min;
+				into.max = (run.max > into.max) ? run.max : into.max;
+			}
+		}
+	}
+}
@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized per-channel moments of a run of samples.
+*
+* A run is reduced to count, compensated sum, minimum, maximum and the sum
+* of squared deviations from its own mean (`m2`); runs are combined with
+* the pairwise update of Chan et al., which keeps the variance accurate
+* when the mean is large compared to the spread. I16 runs are summed in
+* exact integer arithmetic; F64 runs use a compensated (Neumaier) sum per
+* vector lane and a second pass over the run, still in cache, for `m2`.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Moments of one channel over one or more runs.
+			*/
+			struct ChannelMoments {
+				uInt64 count;
+				/** Sum of the samples is `sum + compensation`. */
+				float64 sum;
+				float64 compensation;
+				float64 min;
+				float64 max;
+				/** Sum of squared deviations from the mean. */
+				float64 m2;
+			};
+
+			/**
+			* @brief Moments of an empty run.
+			*/
+			ChannelMoments EmptyMoments();
+
+			/**
+			* @brief Moments of `count` contiguous F64 samples.
+			*/
+			ChannelMoments ComputeMomentsF64(const float64* x, size_t count);
+
+			/**
+			* @brief Moments of `count` contiguous I16 samples, in codes.
+			*/
+			ChannelMoments ComputeMomentsI16(const int16* x, size_t count);
+
+			/**
+			* @brief Adds the moments of `run` to `into`.
+			*/
+			void MergeMoments(ChannelMoments& into, const ChannelMoments& run);
+		}
+	}
+}
@@ -0,0 +1,662 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "StreamRecorderCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "HostClock.h"
+#include "MappedFile.h"
+#include "NativeStatus.h"
+#include "SpscRing.h"
+#include "TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				struct QueuedBlock {
+					uInt64 firstSample;
+					uInt32 samplesPerChannel;
+					int64 timestampNs;
+				};
+
+				int64 NowNs() {
+					return (int64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::system_clock::now().time_since_epoch()).count();
+				}
+
+				uInt64 RoundUp(uInt64 value, uInt64 multiple) {
+					return (value + multiple - 1) / multiple * multiple;
+				}
+			}
+
+			struct StreamRecorderCore::Impl {
+
+				StreamRecorderConfig config;
+				size_t sampleBytes;
+				size_t frameBytes;
+
+				// Producer side.
+				SpscBlockRing<QueuedBlock> queue;
+				uInt64 nextSample;
+
+				// Maps `HostMonotonicNs` to the Unix epoch; taken once in Open so
+				// that engine blocks keep their spacing.
+				int64 monotonicToEpochNs;
+
+				// Scaling stored with each new chunk; replaced by the owner.
+				std::mutex scalingMutex;
+				std::vector<float64> coeffs;
+				std::atomic<bool> scalingChanged;
+
+				// Writer thread.
+				std::thread writer;
+				std::atomic<bool> open;
+				std::atomic<bool> stopping;
+				std::atomic<int32> writerWaiting;
+				std::mutex wakeMutex;
+				std::condition_variable wakeCondition;
+
+				// File, touched by the writer thread only while it runs.
+				MappedFile file;
+				RecordingFileHeader* header;
+				uint8_t* segment;
+				int64 mappedSegment;
+				uInt64 chunkBytes;
+				uInt64 chunkCapacity;
+				uInt32 coeffOffset;
+				uInt32 dataOffset;
+				uInt64 chunksPerSegment;
+				uInt64 segmentBytes;
+
+				RecordingChunkHeader* chunk;
+				uInt64 chunkCount;
+				bool failed;
+
+				std::atomic<uInt64> blocksQueued;
+				std::atomic<uInt64> blocksWritten;
+				std::atomic<uInt64> blocksDropped;
+				std::atomic<uInt64> samplesWritten;
+				std::atomic<uInt64> chunksWritten;
+				std::atomic<uInt64> fileBytes;
+				std::atomic<uInt64> writeErrors;
+				std::atomic<int32> lastError;
+
+				Impl() :
+					config(DefaultStreamRecorderConfig()), sampleBytes(0), frameBytes(0),
+					nextSample(0), monotonicToEpochNs(0), scalingChanged(false),
+					open(false), stopping(false), writerWaiting(0),
+					header(nullptr), segment(nullptr), mappedSegment(-1),
+					chunkBytes(0), chunkCapacity(0), coeffOffset(0), dataOffset(0),
+					chunksPerSegment(0), segmentBytes(0),
+					chunk(nullptr), chunkCount(0), failed(false),
+					blocksQueued(0), blocksWritten(0), blocksDropped(0),
+					samplesWritten(0), chunksWritten(0), fileBytes(0),
+					writeErrors(0), lastError(0) {}
+
+				void Fail(int32 status) {
+					failed = true;
+					writeErrors.fetch_add(1, std::memory_order_relaxed);
+					lastError.store(status, std::memory_order_relaxed);
+				}
+
+				uint8_t* ChunkData() const {
+					return reinterpret_cast<uint8_t*>(chunk) + dataOffset;
+				}
+
+				bool MapSegment(int64 index) {
+
+					if (index == mappedSegment) {
+						return true;
+					}
+
+					if (segment != nullptr) {
+						MappedFile::Unmap(segment, (size_t)segmentBytes, true);
+						segment = nullptr;
+						mappedSegment = -1;
+					}
+
+					const uInt64 offset = RecordingAlignment + (uInt64)index * segmentBytes;
+
+					if (!file.Reserve(offset + segmentBytes)) {
+						return false;
+					}
+					fileBytes.store(file.Size(), std::memory_order_relaxed);
+
+					segment = static_cast<uint8_t*>(file.Map(offset, (size_t)segmentBytes, true));
+					if (segment == nullptr) {
+						return false;
+					}
+
+					mappedSegment = index;
+					return true;
+				}
+
+				bool OpenChunk(uInt64 firstSample, int64 timestampNs) {
+
+					if (!MapSegment((int64)(chunkCount / chunksPerSegment))) {
+						Fail(NativeErrorFileIo);
+						return false;
+					}
+
+					chunk = reinterpret_cast<RecordingChunkHeader*>(
+						segment + (chunkCount % chunksPerSegment) * chunkBytes);
+
+					std::memset(chunk, 0, sizeof(RecordingChunkHeader));
+					chunk->magic = RecordingChunkMagic;
+					chunk->channels = config.channels;
+					chunk->sequence = chunkCount;
+					chunk->firstSample = firstSample;
+					chunk->samplesPerChannel = 0;
+					chunk->timestampNs = timestampNs;
+					chunk->coeffCount = MaxScalingCoeffs;
+					chunk->coeffOffset = coeffOffset;
+					chunk->dataOffset = dataOffset;
+
+					{
+						std::lock_guard<std::mutex> lock(scalingMutex);
+						std::memcpy(reinterpret_cast<uint8_t*>(chunk) + coeffOffset,
+							coeffs.data(), coeffs.size() * sizeof(float64));
+						scalingChanged.store(false, std::memory_order_relaxed);
+					}
+
+					chunkCount++;
+					header->chunkCount = chunkCount;
+					return true;
+				}
+
+				void CloseChunk() {
+
+					if (chunk == nullptr) {
+						return;
+					}
+
+					header->totalSamples += chunk->samplesPerChannel;
+					chunksWritten.fetch_add(1, std::memory_order_relaxed);
+					chunk = nullptr;
+				}
+
+				void WriteBlock(const uint8_t* data, const QueuedBlock& block) {
+
+					uInt64 offset = 0;
+
+					while (offset < block.samplesPerChannel && !failed) {
+
+						const uInt64 first = block.firstSample + offset;
+
+						if (chunk == nullptr || chunk->samplesPerChannel == chunkCapacity
+							|| first != chunk->firstSample + chunk->samplesPerChannel
+							|| scalingChanged.load(std::memory_order_relaxed)) {
+
+							CloseChunk();
+
+							int64 timestamp = block.timestampNs;
+							if (offset != 0 && config.sampleRate > 0.0) {
+								timestamp += (int64)(offset * 1e9 / config.sampleRate);
+							}
+
+							if (!OpenChunk(first, timestamp)) {
+								return;
+							}
+						}
+
+						const uInt64 take = std::min<uInt64>(block.samplesPerChannel - offset,
+							chunkCapacity - chunk->samplesPerChannel);
+
+						std::memcpy(ChunkData() + chunk->samplesPerChannel * frameBytes,
+							data + offset * frameBytes, (size_t)(take * frameBytes));
+
+						chunk->samplesPerChannel += take;
+						offset += take;
+						samplesWritten.fetch_add(take, std::memory_order_relaxed);
+					}
+				}
+
+				void WriterLoop() {
+
+					for (;;) {
+
+						const QueuedBlock* block = nullptr;
+						const uint8_t* data = queue.BeginRead(block);
+
+						if (data != nullptr) {
+							if (!failed) {
+								WriteBlock(data, *block);
+							}
+							queue.EndRead();
+							blocksWritten.fetch_add(1, std::memory_order_release);
+							continue;
+						}
+
+						if (stopping.load(std::memory_order_acquire)) {
+							// Appends that raced with the stop request are still
+							// in the queue; the loop exits once it is empty.
+							if (queue.Count() == 0) {
+								break;
+							}
+							continue;
+						}
+
+						std::unique_lock<std::mutex> lock(wakeMutex);
+						writerWaiting.store(1, std::memory_order_relaxed);
+
+						// Pairs with the fence in Append: either the producer sees
+						// the flag, or this check sees the new block.
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+
+						if (queue.Count() == 0 && !stopping.load(std::memory_order_relaxed)) {
+							wakeCondition.wait_for(lock, std::chrono::milliseconds(50));
+						}
+						writerWaiting.store(0, std::memory_order_relaxed);
+					}
+				}
+
+				void Wake() {
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (writerWaiting.load(std::memory_order_relaxed) != 0) {
+						std::lock_guard<std::mutex> lock(wakeMutex);
+						wakeCondition.notify_one();
+					}
+				}
+
+				void ReleaseFile() {
+
+					if (segment != nullptr) {
+						MappedFile::Unmap(segment, (size_t)segmentBytes, true);
+						segment = nullptr;
+					}
+					if (header != nullptr) {
+						MappedFile::Unmap(header, RecordingAlignment, true);
+						header = nullptr;
+					}
+					mappedSegment = -1;
+					file.Close();
+					queue.Free();
+				}
+			};
+
+			StreamRecorderCore::StreamRecorderCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			StreamRecorderCore::~StreamRecorderCore() {
+
+				if (_impl != nullptr) {
+					Close();
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 StreamRecorderCore::Open(const char* path, const StreamRecorderConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (_impl->open.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				if (path == nullptr || config.channels == 0
+					|| config.chunkSamplesPerChannel == 0 || config.queueBlocks < 2
+					|| config.queueSamplesPerChannel == 0 || config.reserveBytes == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (config.format == SampleFormat::Float64 || SampleSize(config.format) == 0) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				Impl& impl = *_impl;
+
+				impl.config = config;
+				impl.sampleBytes = SampleSize(config.format);
+				impl.frameBytes = impl.sampleBytes * config.channels;
+
+				// Chunk: header, coefficients, samples; padded to the alignment,
+				// with the padding used for more samples.
+				impl.coeffOffset = (uInt32)sizeof(RecordingChunkHeader);
+				impl.dataOffset = (uInt32)RoundUpToCacheLine(impl.coeffOffset
+					+ (size_t)config.channels * MaxScalingCoeffs * sizeof(float64));
+				impl.chunkBytes = RoundUp(impl.dataOffset
+					+ (uInt64)config.chunkSamplesPerChannel * impl.frameBytes, RecordingAlignment);
+				impl.chunkCapacity = (impl.chunkBytes - impl.dataOffset) / impl.frameBytes;
+				impl.chunksPerSegment = std::max<uInt64>(1, config.reserveBytes / impl.chunkBytes);
+				impl.segmentBytes = impl.chunksPerSegment * impl.chunkBytes;
+
+				impl.coeffs.assign((size_t)config.channels * MaxScalingCoeffs, 0.0);
+				for (uInt32 ch = 0; ch < config.channels; ch++) {
+					impl.coeffs[(size_t)ch * MaxScalingCoeffs + 1] = 1.0;
+				}
+
+				if (!impl.queue.Allocate(config.queueBlocks,
+					(size_t)config.queueSamplesPerChannel * impl.frameBytes)) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (!impl.file.Create(path) || !impl.file.Reserve(RecordingAlignment)) {
+					impl.ReleaseFile();
+					return NativeErrorFileIo;
+				}
+
+				impl.header = static_cast<RecordingFileHeader*>(
+					impl.file.Map(0, RecordingAlignment, true));
+
+				if (impl.header == nullptr) {
+					impl.ReleaseFile();
+					return NativeErrorFileIo;
+				}
+
+				RecordingFileHeader* header = impl.header;
+				std::memset(header, 0, sizeof(RecordingFileHeader));
+				std::memcpy(header->magic, RecordingMagic, sizeof(RecordingMagic));
+				header->version = RecordingVersion;
+				header->headerBytes = RecordingAlignment;
+				header->channels = config.channels;
+				header->format = (uInt32)config.format;
+				header->sampleBytes = (uInt32)impl.sampleBytes;
+				header->coeffCount = MaxScalingCoeffs;
+				header->chunkBytes = impl.chunkBytes;
+				header->chunkCapacity = impl.chunkCapacity;
+				header->sampleRate = config.sampleRate;
+				header->createdNs = NowNs();
+				impl.monotonicToEpochNs = header->createdNs - HostMonotonicNs();
+
+				// Reserve the first segment now so the first block does not
+				// wait for the file system.
+				if (!impl.MapSegment(0)) {
+					impl.ReleaseFile();
+					return NativeErrorFileIo;
+				}
+
+				impl.nextSample = 0;
+				impl.chunk = nullptr;
+				impl.chunkCount = 0;
+				impl.failed = false;
+				impl.blocksQueued.store(0);
+				impl.blocksWritten.store(0);
+				impl.blocksDropped.store(0);
+				impl.samplesWritten.store(0);
+				impl.chunksWritten.store(0);
+				impl.writeErrors.store(0);
+				impl.lastError.store(0);
+				impl.scalingChanged.store(false);
+				impl.stopping.store(false);
+
+				try {
+					impl.writer = std::thread(&Impl::WriterLoop, _impl);
+				}
+				catch (...) {
+					impl.ReleaseFile();
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.open.store(true);
+				return NativeSuccess;
+			}
+
+			int32 StreamRecorderCore::Close() {
+
+				if (_impl == nullptr || !_impl->open.load()) {
+					return NativeSuccess;
+				}
+
+				Impl& impl = *_impl;
+
+				impl.stopping.store(true, std::memory_order_release);
+				{
+					std::lock_guard<std::mutex> lock(impl.wakeMutex);
+					impl.wakeCondition.notify_one();
+				}
+				impl.writer.join();
+				impl.open.store(false);
+
+				impl.CloseChunk();
+				impl.header->flags |= RecordingFlagClosed;
+
+				const uInt64 used = RecordingAlignment + impl.chunkCount * impl.chunkBytes;
+
+				// Views must be gone before the reserved tail can be cut off.
+				if (impl.segment != nullptr) {
+					MappedFile::Unmap(impl.segment, (size_t)impl.segmentBytes, true);
+					impl.segment = nullptr;
+					impl.mappedSegment = -1;
+				}
+				MappedFile::Unmap(impl.header, RecordingAlignment, true);
+				impl.header = nullptr;
+
+				if (!impl.file.Truncate(used)) {
+					impl.Fail(NativeErrorFileIo);
+				}
+				impl.fileBytes.store(impl.file.Size(), std::memory_order_relaxed);
+
+				if (impl.config.syncOnClose && !impl.file.Sync()) {
+					impl.Fail(NativeErrorFileIo);
+				}
+
+				impl.ReleaseFile();
+				return impl.lastError.load();
+			}
+
+			bool StreamRecorderCore::IsOpen() const {
+				return _impl != nullptr && _impl->open.load();
+			}
+
+			int32 StreamRecorderCore::SetChannelCoefficients(uInt32 channel,
+				const float64* coeffs, uInt32 count) {
+
+				if (_impl == nullptr || !_impl->open.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->config.channels || coeffs == nullptr
+					|| count == 0 || count > MaxScalingCoeffs) {
+					return NativeErrorInvalidArgument;
+				}
+
+				std::lock_guard<std::mutex> lock(_impl->scalingMutex);
+				float64* target = &_impl->coeffs[(size_t)channel * MaxScalingCoeffs];
+				for (uInt32 k = 0; k < MaxScalingCoeffs; k++) {
+					target[k] = (k < count) ? coeffs[k] : 0.0;
+				}
+				_impl->scalingChanged.store(true, std::memory_order_relaxed);
+				return NativeSuccess;
+			}
+
+			int32 StreamRecorderCore::SetScaling(const RawScalingCore& scaler) {
+
+				if (_impl == nullptr || !_impl->open.load()) {
+					return NativeErrorInvalidState;
+				}
+
+				if (scaler.Channels() != _impl->config.channels) {
+					return NativeErrorInvalidArgument;
+				}
+
+				for (uInt32 ch = 0; ch < _impl->config.channels; ch++) {
+
+					float64 coeffs[MaxScalingCoeffs];
+					int32 count = scaler.GetChannelCoefficients(ch, coeffs, MaxScalingCoeffs);
+
+					if (count < 0) {
+						return count;
+					}
+
+					int32 r = SetChannelCoefficients(ch, coeffs,
+						std::min<uInt32>((uInt32)count, MaxScalingCoeffs));
+					if (r != NativeSuccess) {
+						return r;
+					}
+				}
+				return NativeSuccess;
+			}
+
+			int32 StreamRecorderCore::Append(const void* data, uInt32 samplesPerChannel,
+				int32 fillMode, uInt64 firstSample, int64 timestampNs) {
+
+				if (_impl == nullptr || !_impl->open.load(std::memory_order_relaxed)) {
+					return NativeErrorInvalidState;
+				}
+
+				if (data == nullptr && samplesPerChannel != 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				const uInt32 channels = impl.config.channels;
+				const uInt32 piece = impl.config.queueSamplesPerChannel;
+				const uint8_t* source = static_cast<const uint8_t*>(data);
+
+				if (firstSample == RecorderNextSample) {
+					firstSample = impl.nextSample;
+				}
+				if (timestampNs == 0) {
+					timestampNs = NowNs();
+				}
+				impl.nextSample = firstSample + samplesPerChannel;
+
+				int32 result = NativeSuccess;
+
+				for (uInt32 offset = 0; offset < samplesPerChannel; offset += piece) {
+
+					const uInt32 count = std::min(piece, samplesPerChannel - offset);
+
+					QueuedBlock* block = nullptr;
+					uint8_t* slot = impl.queue.BeginWrite(block);
+
+					if (slot == nullptr) {
+						impl.blocksDropped.fetch_add(1, std::memory_order_relaxed);
+						result = NativeWarningBlocksDropped;
+						continue;
+					}
+
+					if (fillMode == DAQmx_Val_GroupByChannel && channels > 1) {
+						// Samples [offset, offset + count) of every channel, interleaved.
+						TransposeStrided(source + (size_t)offset * impl.sampleBytes,
+							samplesPerChannel, slot, channels, channels, count,
+							impl.sampleBytes);
+					}
+					else {
+						std::memcpy(slot, source + (size_t)offset * impl.frameBytes,
+							(size_t)count * impl.frameBytes);
+					}
+
+					block->firstSample = firstSample + offset;
+					block->samplesPerChannel = count;
+					block->timestampNs = timestampNs;
+					if (offset != 0 && impl.config.sampleRate > 0.0) {
+						block->timestampNs += (int64)(offset * 1e9 / impl.config.sampleRate);
+					}
+
+					impl.queue.CommitWrite();
+					impl.blocksQueued.fetch_add(1, std::memory_order_relaxed);
+					impl.Wake();
+				}
+
+				return result;
+			}
+
+			int32 StreamRecorderCore::Append(const BlockView& view) {
+
+				if (_impl != nullptr && (view.channels != _impl->config.channels
+					|| view.format != _impl->config.format)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				// Stamped with the host time of the read, not of the append.
+				const int64 timestampNs = (_impl != nullptr && view.hostTimestampNs != 0)
+					? view.hostTimestampNs + _impl->monotonicToEpochNs : 0;
+
+				return Append(view.data, view.samplesPerChannel, view.fillMode,
+					view.firstSample, timestampNs);
+			}
+
+			int32 StreamRecorderCore::AppendRead(TaskHandle task, const void* data,
+				uInt32 samplesPerChannel, int32 fillMode) {
+
+				// After a read, the read position is the index of the sample that
+				// follows the block.
+				uInt64 position = 0;
+				int32 r = DAQmxGetReadCurrReadPos(task, &position);
+
+				if (r < 0) {
+					return r;
+				}
+				if (position < samplesPerChannel) {
+					return NativeErrorInvalidArgument;
+				}
+
+				return Append(data, samplesPerChannel, fillMode,
+					position - samplesPerChannel, 0);
+			}
+
+			bool StreamRecorderCore::WaitIdle(uInt32 timeoutMs) {
+
+				if (_impl == nullptr || !_impl->open.load()) {
+					return true;
+				}
+
+				const auto deadline = std::chrono::steady_clock::now()
+					+ std::chrono::milliseconds(timeoutMs);
+
+				while (_impl->blocksWritten.load(std::memory_order_acquire)
+					!= _impl->blocksQueued.load(std::memory_order_relaxed)) {
+
+					if (std::chrono::steady_clock::now() >= deadline) {
+						return false;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				return true;
+			}
+
+			StreamRecorderCounters StreamRecorderCore::Counters() const {
+
+				StreamRecorderCounters counters;
+				std::memset(&counters, 0, sizeof(counters));
+
+				if (_impl != nullptr) {
+					counters.blocksAppended = _impl->blocksQueued.load(std::memory_order_relaxed);
+					counters.blocksDropped = _impl->blocksDropped.load(std::memory_order_relaxed);
+					counters.samplesWritten = _impl->samplesWritten.load(std::memory_order_relaxed);
+					counters.chunksWritten = _impl->chunksWritten.load(std::memory_order_relaxed);
+					counters.fileBytes = _impl->fileBytes.load(std::memory_order_relaxed);
+					counters.writeErrors = _impl->writeErrors.load(std::memory_order_relaxed);
+					counters.lastError = _impl->lastError.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+		}
+	}
+}
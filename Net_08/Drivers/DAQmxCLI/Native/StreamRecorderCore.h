@@ -0,0 +1,229 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the streaming recorder. Safe to include from code compiled with
+* /clr; the queue, the writer thread and the mapped file live in
+* StreamRecorderCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+#include "AcquisitionEngineCore.h"
+#include "RawScalingCore.h"
+#include "RecordingFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief `firstSample` value that continues right after the previous
+			*        block.
+			*/
+			const uInt64 RecorderNextSample = ~(uInt64)0;
+
+			/**
+			* @brief Configuration of a `StreamRecorderCore`.
+			*/
+			struct StreamRecorderConfig {
+
+				/** Number of channels in each block. */
+				uInt32 channels;
+
+				/** Raw sample format: Int16, Int32, UInt16 or UInt32. */
+				SampleFormat format;
+
+				/** Samples per channel in one chunk of the file. Rounded up so
+				*   that a chunk fills a whole number of `RecordingAlignment`
+				*   units. */
+				uInt32 chunkSamplesPerChannel;
+
+				/** Blocks the queue between `Append` and the writer thread can
+				*   hold. Sized to ride out stalls of the disk. */
+				uInt32 queueBlocks;
+
+				/** Samples per channel in one queue slot. Larger blocks are
+				*   split over several slots. */
+				uInt32 queueSamplesPerChannel;
+
+				/** Sample clock rate, stored in the file header and used to
+				*   time-stamp chunks that start in the middle of a block. `0`
+				*   if unknown. */
+				float64 sampleRate;
+
+				/** The file is grown (and its space reserved) in steps of this
+				*   many bytes, and mapped one step at a time. */
+				uInt64 reserveBytes;
+
+				/** If `true`, `Close` waits until the data is on the disk. */
+				bool syncOnClose;
+			};
+
+			/**
+			* @brief Returns a configuration with the recorder defaults filled in.
+			*/
+			inline StreamRecorderConfig DefaultStreamRecorderConfig() {
+				StreamRecorderConfig config;
+				config.channels = 1;
+				config.format = SampleFormat::Int16;
+				config.chunkSamplesPerChannel = 65536;
+				config.queueBlocks = 64;
+				config.queueSamplesPerChannel = 10000;
+				config.sampleRate = 0.0;
+				config.reserveBytes = 256ull << 20;
+				config.syncOnClose = false;
+				return config;
+			}
+
+			/**
+			* @brief Counters maintained by the recorder. Read without locking.
+			*/
+			struct StreamRecorderCounters {
+				/** Queue slots filled by `Append` (a large block fills several). */
+				uInt64 blocksAppended;
+				/** Queue slots discarded because the writer fell behind. */
+				uInt64 blocksDropped;
+				/** Samples per channel written to the file. */
+				uInt64 samplesWritten;
+				/** Chunks completed. */
+				uInt64 chunksWritten;
+				/** Current file size, including the reserved tail. */
+				uInt64 fileBytes;
+				uInt64 writeErrors;
+				int32 lastError;
+			};
+
+			/**
+			* @brief Appends raw acquisition blocks to a chunked, memory-mapped
+			*        recording (see RecordingFormat.h).
+			*
+			* `Append` copies a block into a preallocated lock-free queue and
+			* returns; it never touches the file and never allocates, so it can
+			* be called from the acquisition thread or an EveryNSamples callback.
+			* A dedicated writer thread moves the queued blocks into the file
+			* through mapped views, converting blocks grouped by channel to the
+			* interleaved layout of the file on the way. The file is grown and
+			* its space reserved in large steps, so the writer does not issue a
+			* system call per block.
+			*
+			* Every chunk carries the index of its first sample, a host time
+			* stamp and the scaling polynomial of every channel, so a chunk can
+			* be converted to volts on its own. Changing the scaling starts a new
+			* chunk.
+			*
+			* One thread may call `Append`; the other methods are for the owner
+			* and are not meant to race with it.
+			*/
+			class StreamRecorderCore {
+
+			public:
+				StreamRecorderCore();
+				~StreamRecorderCore();
+
+				StreamRecorderCore(const StreamRecorderCore&) = delete;
+				StreamRecorderCore& operator=(const StreamRecorderCore&) = delete;
+
+				/**
+				* @brief Creates the file and starts the writer thread.
+				*
+				* @param[in] path UTF-8 path of the recording; an existing file is
+				*                 replaced.
+				*/
+				int32 Open(const char* path, const StreamRecorderConfig& config);
+
+				/**
+				* @brief Writes everything still queued, completes the file header
+				*        and releases the file.
+				*
+				* @return `0`, or the last error the writer ran into.
+				*/
+				int32 Close();
+
+				bool IsOpen() const;
+
+				/**
+				* @brief Sets the polynomial stored with the following chunks.
+				*
+				* @param[in] coeffs Coefficients, constant term first.
+				* @param[in] count Number of coefficients, 1 .. `MaxScalingCoeffs`.
+				*/
+				int32 SetChannelCoefficients(uInt32 channel, const float64* coeffs,
+					uInt32 count);
+
+				/**
+				* @brief Copies the polynomials of every channel from a scaler,
+				*        typically right after `RawScalingCore::Capture`.
+				*/
+				int32 SetScaling(const RawScalingCore& scaler);
+
+				/**
+				* @brief Queues a block of raw samples.
+				*
+				* @param[in] data `channels * samplesPerChannel` samples.
+				* @param[in] fillMode Layout of `data`.
+				* @param[in] firstSample Index, per channel, of the first sample,
+				*            or `RecorderNextSample`.
+				* @param[in] timestampNs Host time of the block in nanoseconds
+				*            since the Unix epoch; `0` takes the current time.
+				*
+				* @return `0`, `NativeWarningBlocksDropped` if the queue was full
+				*         and the block was discarded, or a negative error.
+				*/
+				int32 Append(const void* data, uInt32 samplesPerChannel, int32 fillMode,
+					uInt64 firstSample = RecorderNextSample, int64 timestampNs = 0);
+
+				/**
+				* @brief Queues a block taken from an `AcquisitionEngineCore`.
+				*
+				* The block is stamped with its `hostTimestampNs`, the host
+				* monotonic time of the read, brought to the Unix epoch with
+				* the offset between the two clocks taken by `Open`.
+				*/
+				int32 Append(const BlockView& view);
+
+				/**
+				* @brief Queues a block that was just read from `task`, and takes
+				*        the index of its first sample from the read position of
+				*        the task.
+				*/
+				int32 AppendRead(TaskHandle task, const void* data,
+					uInt32 samplesPerChannel, int32 fillMode);
+
+				/**
+				* @brief Blocks until the writer has emptied the queue.
+				*
+				* @return `true` if the queue was emptied before the timeout.
+				*/
+				bool WaitIdle(uInt32 timeoutMs);
+
+				StreamRecorderCounters Counters() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
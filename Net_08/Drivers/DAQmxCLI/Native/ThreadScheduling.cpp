@@ -0,0 +1,271 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ThreadScheduling.h"
+
+#include <thread>
+
+#include "NativeStatus.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Bits of `affinityMask` that name CPUs of the machine.
+				uInt64 MachineMask() {
+
+					const uInt32 cpus = LogicalCpuCount();
+					return (cpus >= 64) ? ~(uInt64)0 : (((uInt64)1 << cpus) - 1);
+				}
+			}
+
+			uInt32 LogicalCpuCount() {
+
+				const unsigned int cpus = std::thread::hardware_concurrency();
+				return (cpus > 0) ? (uInt32)cpus : 1;
+			}
+
+#if defined(_WIN32)
+			int32 ApplyThreadSchedule(const ThreadSchedule& schedule) {
+
+				HANDLE thread = GetCurrentThread();
+
+				if (schedule.affinityMask != 0) {
+
+					if ((schedule.affinityMask & MachineMask()) == 0) {
+						return NativeErrorInvalidArgument;
+					}
+					if (SetThreadAffinityMask(thread, (DWORD_PTR)schedule.affinityMask) == 0) {
+						return (GetLastError() == ERROR_INVALID_PARAMETER)
+							? NativeErrorInvalidArgument : NativeErrorPermissionDenied;
+					}
+				}
+
+				int priority;
+
+				switch (schedule.priority) {
+				case ThreadPriority::Normal:
+					priority = THREAD_PRIORITY_NORMAL;
+					break;
+				case ThreadPriority::AboveNormal:
+					priority = THREAD_PRIORITY_ABOVE_NORMAL;
+					break;
+				case ThreadPriority::Highest:
+					priority = THREAD_PRIORITY_HIGHEST;
+					break;
+				case ThreadPriority::RealTime:
+					priority = THREAD_PRIORITY_TIME_CRITICAL;
+					break;
+				default:
+					return NativeErrorInvalidArgument;
+				}
+
+				return SetThreadPriority(thread, priority) ? NativeSuccess : NativeErrorPermissionDenied;
+			}
+
+			int32 CurrentThreadSchedule(ThreadSchedule* schedule) {
+
+				if (schedule == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				*schedule = DefaultThreadSchedule();
+				HANDLE thread = GetCurrentThread();
+
+				// Windows only tells the previous mask when it sets a new one.
+				DWORD_PTR processMask = 0;
+				DWORD_PTR systemMask = 0;
+
+				if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+					const DWORD_PTR previous = SetThreadAffinityMask(thread, processMask);
+					if (previous != 0) {
+						SetThreadAffinityMask(thread, previous);
+						schedule->affinityMask = (uInt64)previous;
+					}
+				}
+
+				const int priority = GetThreadPriority(thread);
+
+				schedule->priority = (priority >= THREAD_PRIORITY_TIME_CRITICAL) ? ThreadPriority::RealTime
+					: (priority >= THREAD_PRIORITY_HIGHEST) ? ThreadPriority::Highest
+					: (priority >= THREAD_PRIORITY_ABOVE_NORMAL) ? ThreadPriority::AboveNormal
+					: ThreadPriority::Normal;
+				return NativeSuccess;
+			}
+#elif defined(__linux__)
+			namespace {
+
+				int32 FromErrno(int error) {
+					return (error == EPERM || error == EACCES)
+						? NativeErrorPermissionDenied : NativeErrorInvalidArgument;
+				}
+
+				pid_t CurrentThreadId() {
+					return (pid_t)syscall(SYS_gettid);
+				}
+			}
+
+			int32 ApplyThreadSchedule(const ThreadSchedule& schedule) {
+
+				const pthread_t self = pthread_self();
+
+				if (schedule.affinityMask != 0) {
+
+					if ((schedule.affinityMask & MachineMask()) == 0) {
+						return NativeErrorInvalidArgument;
+					}
+
+					cpu_set_t cpus;
+					CPU_ZERO(&cpus);
+
+					for (uInt32 k = 0; k < 64; k++) {
+						if ((schedule.affinityMask >> k) & 1) {
+							CPU_SET(k, &cpus);
+						}
+					}
+
+					const int error = pthread_setaffinity_np(self, sizeof(cpus), &cpus);
+					if (error != 0) {
+						return FromErrno(error);
+					}
+				}
+
+				sched_param param = {};
+
+				if (schedule.priority == ThreadPriority::RealTime) {
+
+					if (schedule.realTimePriority < sched_get_priority_min(SCHED_FIFO)
+						|| schedule.realTimePriority > sched_get_priority_max(SCHED_FIFO)) {
+						return NativeErrorInvalidArgument;
+					}
+
+					param.sched_priority = schedule.realTimePriority;
+					const int error = pthread_setschedparam(self, SCHED_FIFO, &param);
+					return (error == 0) ? NativeSuccess : FromErrno(error);
+				}
+
+				int nice;
+
+				switch (schedule.priority) {
+				case ThreadPriority::Normal:
+					nice = 0;
+					break;
+				case ThreadPriority::AboveNormal:
+					nice = -5;
+					break;
+				case ThreadPriority::Highest:
+					nice = -10;
+					break;
+				default:
+					return NativeErrorInvalidArgument;
+				}
+
+				// Back from a real-time policy, if the thread had one.
+				int policy = SCHED_OTHER;
+				if (pthread_getschedparam(self, &policy, &param) == 0 && policy != SCHED_OTHER) {
+
+					param.sched_priority = 0;
+					const int error = pthread_setschedparam(self, SCHED_OTHER, &param);
+					if (error != 0) {
+						return FromErrno(error);
+					}
+				}
+
+				// Linux keeps a nice value per thread.
+				if (nice != 0 && setpriority(PRIO_PROCESS, (id_t)CurrentThreadId(), nice) != 0) {
+					return FromErrno(errno);
+				}
+				return NativeSuccess;
+			}
+
+			int32 CurrentThreadSchedule(ThreadSchedule* schedule) {
+
+				if (schedule == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				*schedule = DefaultThreadSchedule();
+				const pthread_t self = pthread_self();
+
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+
+				if (pthread_getaffinity_np(self, sizeof(cpus), &cpus) == 0) {
+					for (uInt32 k = 0; k < 64; k++) {
+						if (CPU_ISSET(k, &cpus)) {
+							schedule->affinityMask |= (uInt64)1 << k;
+						}
+					}
+				}
+
+				int policy = SCHED_OTHER;
+				sched_param param = {};
+
+				if (pthread_getschedparam(self, &policy, &param) == 0
+					&& (policy == SCHED_FIFO || policy == SCHED_RR)) {
+					schedule->priority = ThreadPriority::RealTime;
+					schedule->realTimePriority = param.sched_priority;
+					return NativeSuccess;
+				}
+
+				errno = 0;
+				const int nice = getpriority(PRIO_PROCESS, (id_t)CurrentThreadId());
+
+				schedule->priority = (errno != 0 || nice >= 0) ? ThreadPriority::Normal
+					: (nice <= -10) ? ThreadPriority::Highest : ThreadPriority::AboveNormal;
+				return NativeSuccess;
+			}
+#else
+			int32 ApplyThreadSchedule(const ThreadSchedule& schedule) {
+
+				return (schedule.affinityMask == 0 && schedule.priority == ThreadPriority::Normal)
+					? NativeSuccess : NativeErrorInvalidState;
+			}
+
+			int32 CurrentThreadSchedule(ThreadSchedule* schedule) {
+
+				if (schedule == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+				*schedule = DefaultThreadSchedule();
+				return NativeSuccess;
+			}
+#endif
+		}
+	}
+}
@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* CPU affinity and OS priority of the calling thread, for the threads the
+* native engines start. Safe to include from code compiled with /clr.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief OS priority of a thread.
+			*
+			* On Windows: `THREAD_PRIORITY_NORMAL`, `_ABOVE_NORMAL`, `_HIGHEST`
+			* and `_TIME_CRITICAL`; the priority class of the process is left
+			* alone. On Linux: the nice value unchanged, -5, -10, and
+			* `SCHED_FIFO` at `realTimePriority`.
+			*/
+			enum class ThreadPriority : int32 {
+				Normal = 0,
+				AboveNormal = 1,
+				Highest = 2,
+				RealTime = 3
+			};
+
+			/**
+			* @brief Where and how urgently a thread runs.
+			*/
+			struct ThreadSchedule {
+
+				/** CPUs the thread may run on, bit `k` for CPU `k`; `0`
+				*   leaves it to the OS. */
+				uInt64 affinityMask;
+
+				ThreadPriority priority;
+
+				/** `SCHED_FIFO` priority of `RealTime`, 1 to 99; unused on
+				*   Windows. */
+				int32 realTimePriority;
+			};
+
+			inline ThreadSchedule DefaultThreadSchedule() {
+
+				ThreadSchedule schedule;
+				schedule.affinityMask = 0;
+				schedule.priority = ThreadPriority::Normal;
+				schedule.realTimePriority = 10;
+				return schedule;
+			}
+
+			/**
+			* @brief Applies `schedule` to the calling thread.
+			*
+			* @return `0`, `NativeErrorInvalidArgument` for a mask with no
+			*         CPU of the machine or a real-time priority out of range,
+			*         or `NativeErrorPermissionDenied` when the OS refuses,
+			*         e.g. `SCHED_FIFO` or a negative nice value without
+			*         `CAP_SYS_NICE`.
+			*/
+			int32 ApplyThreadSchedule(const ThreadSchedule& schedule);
+
+			/**
+			* @brief Reads back the affinity and the priority of the calling
+			*        thread; a priority set by other means is reported as the
+			*        nearest `ThreadPriority`.
+			*/
+			int32 CurrentThreadSchedule(ThreadSchedule* schedule);
+
+			/** Logical CPUs of the machine. */
+			uInt32 LogicalCpuCount();
+		}
+	}
+}
@@ -0,0 +1,233 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Transition records of the edge extractor and the on-disk layout of the
+* transition files written by TransitionWriterCore. Plain structures and
+* inline functions only; safe to include from code compiled with /clr.
+*
+* A transition file is a header followed by a byte stream of records:
+*
+*   [TransitionFileHeader][record 0][record 1] ... ([dataBytes] bytes)
+*
+* Records are ordered by sample index, then channel. Each one holds only
+* what changed since the previous record, as LEB128 varints:
+*
+*   token    = (sampleIndex - previous sampleIndex) << 1 | singleLine
+*   channel  = channel number, present only if `channels > 1`
+*   lines    = singleLine ? one byte with the number of the line that
+*                           toggled
+*                         : varint of the changed mask
+*
+* The previous sample index of the first record is 0, and every channel
+* starts with all lines low, so the value of a channel is the XOR of its
+* changed masks. A line toggling on its own takes 2 bytes when the gap
+* fits 6 bits and 3 bytes up to 13 bits, against 1 to 4 bytes per sample
+* of the raw stream. All fields are little endian.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief A change of the lines of one digital channel.
+			*/
+			struct DigitalTransition {
+
+				/** Index, per channel, of the first sample with the new value. */
+				uInt64 sampleIndex;
+
+				uInt32 channel;
+
+				/** Value of the watched lines from `sampleIndex` on. */
+				uInt32 value;
+
+				/** Lines that changed: `value ^ previous value`. */
+				uInt32 changed;
+
+				uInt32 reserved;
+			};
+
+			const char TransitionMagic[8] = { 'G', 'D', 'A', 'Q', 'E', 'D', 'G', '1' };
+			const uInt32 TransitionVersion = 1;
+
+			/** Set in `TransitionFileHeader::flags` when the writer was closed
+			*   normally. A file without it was cut short; its header counts are
+			*   those of the last completed append. */
+			const uInt32 TransitionFlagClosed = 0x1;
+
+			/** Most bytes one encoded record can take. */
+			const size_t MaxEncodedTransitionBytes = 20;
+
+			#pragma pack(push, 8)
+
+			struct TransitionFileHeader {
+				char magic[8];
+				uInt32 version;
+				uInt32 headerBytes;
+
+				uInt32 channels;
+				/** Bytes of the sampled words: 1, 2 or 4. */
+				uInt32 sampleBytes;
+				/** Lines that were watched. */
+				uInt32 mask;
+				uInt32 flags;
+
+				uInt64 transitionCount;
+				/** Bytes of records after the header. */
+				uInt64 dataBytes;
+				/** Samples per channel covered by the file; after the last
+				*   transition the lines kept their value up to this index. */
+				uInt64 samplesPerChannel;
+
+				/** Sample clock rate, for information only; `0` if unknown. */
+				float64 sampleRate;
+				/** Creation time, nanoseconds since the Unix epoch (UTC). */
+				int64 createdNs;
+
+				uInt64 reserved[7];
+			};
+
+			#pragma pack(pop)
+
+			static_assert(sizeof(TransitionFileHeader) == 128,
+				"Transition file header must stay two cache lines.");
+
+			/**
+			* @brief Encodes one record into `out`, which must have room for
+			*        `MaxEncodedTransitionBytes`.
+			*
+			* @param[in] gap Sample index minus that of the previous record.
+			* @param[in] changed Non-zero changed mask.
+			*
+			* @return The number of bytes written.
+			*/
+			inline size_t EncodeTransition(uInt64 gap, uInt32 channel, uInt32 changed,
+				bool multiChannel, uInt8* out) {
+
+				const bool single = (changed & (changed - 1)) == 0;
+				size_t n = 0;
+
+				uInt64 token = (gap << 1) | (single ? 1u : 0u);
+				while (token >= 0x80) {
+					out[n++] = (uInt8)(token | 0x80);
+					token >>= 7;
+				}
+				out[n++] = (uInt8)token;
+
+				if (multiChannel) {
+					uInt32 c = channel;
+					while (c >= 0x80) {
+						out[n++] = (uInt8)(c | 0x80);
+						c >>= 7;
+					}
+					out[n++] = (uInt8)c;
+				}
+
+				if (single) {
+					uInt8 line = 0;
+					while ((changed >> line) != 1) {
+						line++;
+					}
+					out[n++] = line;
+				}
+				else {
+					uInt32 m = changed;
+					while (m >= 0x80) {
+						out[n++] = (uInt8)(m | 0x80);
+						m >>= 7;
+					}
+					out[n++] = (uInt8)m;
+				}
+				return n;
+			}
+
+			/**
+			* @brief Decodes the varint at `in[*pos]`, at most `maxBytes` long
+			*        and ending before `size`.
+			*
+			* @return `false` if it is cut short or too long.
+			*/
+			inline bool DecodeTransitionVarint(const uInt8* in, size_t size, size_t* pos,
+				uInt32 maxBytes, uInt64* value) {
+
+				uInt64 v = 0;
+
+				for (uInt32 k = 0; k < maxBytes && *pos < size; k++) {
+
+					const uInt8 b = in[(*pos)++];
+					v |= (uInt64)(b & 0x7F) << (7 * k);
+
+					if ((b & 0x80) == 0) {
+						*value = v;
+						return true;
+					}
+				}
+				return false;
+			}
+
+			/**
+			* @brief Decodes the record at `in[*pos]` and advances `*pos` past it.
+			*
+			* @param[in,out] sampleIndex Index of the previous record on entry,
+			*                of this one on return.
+			*
+			* @return `false` if the record is cut short or malformed; `*pos`
+			*         is then undefined.
+			*/
+			inline bool DecodeTransition(const uInt8* in, size_t size, size_t* pos,
+				bool multiChannel, uInt64* sampleIndex, uInt32* channel, uInt32* changed) {
+
+				uInt64 token;
+				uInt64 c = 0;
+				uInt64 m;
+
+				if (!DecodeTransitionVarint(in, size, pos, 10, &token)) {
+					return false;
+				}
+				if (multiChannel && !DecodeTransitionVarint(in, size, pos, 5, &c)) {
+					return false;
+				}
+
+				if ((token & 1) != 0) {
+					if (*pos >= size || in[*pos] > 31) {
+						return false;
+					}
+					m = 1ull << in[(*pos)++];
+				}
+				else if (!DecodeTransitionVarint(in, size, pos, 5, &m) || m == 0) {
+					return false;
+				}
+
+				*sampleIndex += token >> 1;
+				*channel = (uInt32)c;
+				*changed = (uInt32)m;
+				return true;
+			}
+		}
+	}
+}
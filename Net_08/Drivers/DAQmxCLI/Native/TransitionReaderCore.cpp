@@ -0,0 +1,217 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TransitionReaderCore.h"
+
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "MappedFile.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			struct TransitionReaderCore::Impl {
+
+				MappedFile file;
+				const uint8_t* view;
+				size_t viewBytes;
+				const TransitionFileHeader* header;
+
+				// Records of the file and the decoder state.
+				const uint8_t* data;
+				size_t dataBytes;
+				size_t offset;
+				uInt64 sampleIndex;
+				uInt64 position;
+				std::vector<uInt32> values;
+
+				Impl() :
+					view(nullptr), viewBytes(0), header(nullptr), data(nullptr),
+					dataBytes(0), offset(0), sampleIndex(0), position(0) {}
+
+				void Release() {
+					MappedFile::Unmap(const_cast<uint8_t*>(view), viewBytes, false);
+					view = nullptr;
+					viewBytes = 0;
+					header = nullptr;
+					data = nullptr;
+					dataBytes = 0;
+					file.Close();
+				}
+
+				void Rewind() {
+					offset = 0;
+					sampleIndex = 0;
+					position = 0;
+					values.assign(values.size(), 0);
+				}
+			};
+
+			TransitionReaderCore::TransitionReaderCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			TransitionReaderCore::~TransitionReaderCore() {
+
+				if (_impl != nullptr) {
+					Close();
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 TransitionReaderCore::Open(const char* path) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Close();
+
+				if (path == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+
+				if (!impl.file.OpenReadOnly(path)) {
+					return NativeErrorFileIo;
+				}
+
+				const uInt64 size = impl.file.Size();
+				if (size < sizeof(TransitionFileHeader)) {
+					impl.Release();
+					return NativeErrorInvalidFile;
+				}
+
+				impl.view = static_cast<const uint8_t*>(impl.file.Map(0, (size_t)size, false));
+				if (impl.view == nullptr) {
+					impl.Release();
+					return NativeErrorFileIo;
+				}
+				impl.viewBytes = (size_t)size;
+
+				const TransitionFileHeader* header =
+					reinterpret_cast<const TransitionFileHeader*>(impl.view);
+
+				const bool valid = std::memcmp(header->magic, TransitionMagic,
+						sizeof(TransitionMagic)) == 0
+					&& header->version == TransitionVersion
+					&& header->headerBytes == sizeof(TransitionFileHeader)
+					&& header->channels != 0
+					&& (header->sampleBytes == 1 || header->sampleBytes == 2
+						|| header->sampleBytes == 4);
+
+				if (!valid) {
+					impl.Release();
+					return NativeErrorInvalidFile;
+				}
+
+				try {
+					impl.values.assign(header->channels, 0);
+				}
+				catch (const std::bad_alloc&) {
+					impl.Release();
+					return NativeErrorOutOfMemory;
+				}
+
+				// A file cut short may count bytes that never reached it.
+				const uInt64 fit = size - sizeof(TransitionFileHeader);
+
+				impl.header = header;
+				impl.data = impl.view + sizeof(TransitionFileHeader);
+				impl.dataBytes = (size_t)((header->dataBytes < fit) ? header->dataBytes : fit);
+				impl.Rewind();
+				return NativeSuccess;
+			}
+
+			void TransitionReaderCore::Close() {
+				if (_impl != nullptr) {
+					_impl->Release();
+				}
+			}
+
+			const TransitionFileHeader* TransitionReaderCore::Header() const {
+				return (_impl == nullptr) ? nullptr : _impl->header;
+			}
+
+			bool TransitionReaderCore::IsComplete() const {
+				return Header() != nullptr && (Header()->flags & TransitionFlagClosed) != 0;
+			}
+
+			int32 TransitionReaderCore::Read(DigitalTransition* transitions, uInt32 capacity) {
+
+				if (_impl == nullptr || _impl->header == nullptr) {
+					return NativeErrorInvalidState;
+				}
+				if (transitions == nullptr && capacity > 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				const bool multiChannel = impl.header->channels > 1;
+				const uInt32 mask = impl.header->mask;
+				uInt32 n = 0;
+
+				while (n < capacity && impl.offset < impl.dataBytes) {
+
+					size_t pos = impl.offset;
+					uInt64 index = impl.sampleIndex;
+					uInt32 channel;
+					uInt32 changed;
+
+					if (!DecodeTransition(impl.data, impl.dataBytes, &pos, multiChannel,
+							&index, &channel, &changed)
+						|| channel >= impl.header->channels || (changed & ~mask) != 0) {
+						return (n > 0) ? (int32)n : NativeErrorInvalidFile;
+					}
+
+					DigitalTransition& t = transitions[n++];
+					t.sampleIndex = index;
+					t.channel = channel;
+					t.value = impl.values[channel] ^ changed;
+					t.changed = changed;
+					t.reserved = 0;
+
+					impl.values[channel] = t.value;
+					impl.sampleIndex = index;
+					impl.offset = pos;
+					impl.position++;
+				}
+				return (int32)n;
+			}
+
+			void TransitionReaderCore::Rewind() {
+				if (_impl != nullptr) {
+					_impl->Rewind();
+				}
+			}
+
+			uInt64 TransitionReaderCore::Position() const {
+				return (_impl != nullptr) ? _impl->position : 0;
+			}
+		}
+	}
+}
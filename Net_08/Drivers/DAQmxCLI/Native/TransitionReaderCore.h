@@ -0,0 +1,99 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the transition file reader. Safe to include from code compiled
+* with /clr; the mapping and the decoder live in TransitionReaderCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "TransitionFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Sequential reader of files written by `TransitionWriterCore`.
+			*
+			* The whole file is mapped and decoded on demand into
+			* `DigitalTransition` records with their values restored. A file
+			* that is still being written, or was cut short, can be opened
+			* too: it shows the records its header counted at the time.
+			*/
+			class TransitionReaderCore {
+
+			public:
+				TransitionReaderCore();
+				~TransitionReaderCore();
+
+				TransitionReaderCore(const TransitionReaderCore&) = delete;
+				TransitionReaderCore& operator=(const TransitionReaderCore&) = delete;
+
+				/**
+				* @brief Maps a transition file and checks its header.
+				*
+				* @return `0`, `NativeErrorFileIo` or `NativeErrorInvalidFile`.
+				*/
+				int32 Open(const char* path);
+
+				void Close();
+
+				/**
+				* @brief The file header, or `nullptr` if nothing is open.
+				*/
+				const TransitionFileHeader* Header() const;
+
+				/**
+				* @brief `true` if the writer closed the file normally.
+				*/
+				bool IsComplete() const;
+
+				/**
+				* @brief Decodes up to `capacity` of the next transitions.
+				*
+				* @return The number decoded, `0` at the end of the file, or
+				*         `NativeErrorInvalidFile` for a corrupt record (the
+				*         records before it are still returned by the previous
+				*         calls), `NativeErrorInvalidState` if nothing is open.
+				*/
+				int32 Read(DigitalTransition* transitions, uInt32 capacity);
+
+				/**
+				* @brief Starts reading again from the first transition.
+				*/
+				void Rewind();
+
+				/**
+				* @brief Transitions decoded since the open or the last rewind.
+				*/
+				uInt64 Position() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,374 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TransitionWriterCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "EdgeExtractorCore.h"
+#include "MappedFile.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				int64 NowNs() {
+					return (int64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::system_clock::now().time_since_epoch()).count();
+				}
+
+				uInt64 RoundUp(uInt64 value, uInt64 multiple) {
+					return (value + multiple - 1) / multiple * multiple;
+				}
+
+				const size_t DrainBatch = 256;
+			}
+
+			struct TransitionWriterCore::Impl {
+
+				TransitionWriterConfig config;
+				bool open;
+				uInt32 mask;
+
+				MappedFile file;
+				// The header is mapped on its own, next to the segment that
+				// holds the write position.
+				TransitionFileHeader* header;
+				size_t headerView;
+				uint8_t* segment;
+				uInt64 segmentBytes;
+				int64 mappedSegment;
+
+				std::vector<uInt32> values;
+				uInt64 lastIndex;
+				uInt64 dataBytes;
+				uInt64 transitionCount;
+				uInt64 samplesPerChannel;
+
+				Impl() :
+					config(DefaultTransitionWriterConfig()), open(false), mask(0),
+					header(nullptr), headerView(0), segment(nullptr), segmentBytes(0),
+					mappedSegment(-1), lastIndex(0), dataBytes(0), transitionCount(0),
+					samplesPerChannel(0) {}
+
+				void ReleaseFile() {
+
+					if (segment != nullptr) {
+						MappedFile::Unmap(segment, (size_t)segmentBytes, true);
+						segment = nullptr;
+					}
+					if (header != nullptr) {
+						MappedFile::Unmap(header, headerView, true);
+						header = nullptr;
+					}
+					mappedSegment = -1;
+					file.Close();
+					open = false;
+				}
+
+				bool MapSegment(int64 index) {
+
+					if (index == mappedSegment) {
+						return true;
+					}
+
+					if (segment != nullptr) {
+						MappedFile::Unmap(segment, (size_t)segmentBytes, true);
+						segment = nullptr;
+						mappedSegment = -1;
+					}
+
+					const uInt64 offset = (uInt64)index * segmentBytes;
+
+					if (!file.Reserve(offset + segmentBytes)) {
+						return false;
+					}
+
+					segment = static_cast<uint8_t*>(file.Map(offset, (size_t)segmentBytes, true));
+					if (segment == nullptr) {
+						return false;
+					}
+
+					mappedSegment = index;
+					return true;
+				}
+
+				// Copies `n` bytes to the end of the data, across segments.
+				bool Write(const uint8_t* bytes, size_t n) {
+
+					uInt64 at = sizeof(TransitionFileHeader) + dataBytes;
+
+					while (n > 0) {
+
+						if (!MapSegment((int64)(at / segmentBytes))) {
+							return false;
+						}
+
+						const size_t offset = (size_t)(at % segmentBytes);
+						const size_t part = std::min<size_t>(n, (size_t)segmentBytes - offset);
+
+						std::memcpy(segment + offset, bytes, part);
+						bytes += part;
+						n -= part;
+						at += part;
+						dataBytes += part;
+					}
+					return true;
+				}
+
+				void UpdateHeader() {
+					header->transitionCount = transitionCount;
+					header->dataBytes = dataBytes;
+					header->samplesPerChannel = samplesPerChannel;
+				}
+			};
+
+			TransitionWriterCore::TransitionWriterCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			TransitionWriterCore::~TransitionWriterCore() {
+
+				if (_impl != nullptr) {
+					Close();
+					delete _impl;
+					_impl = nullptr;
+				}
+			}
+
+			int32 TransitionWriterCore::Create(const char* path,
+				const TransitionWriterConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.open) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				if (path == nullptr || config.channels == 0
+					|| (config.sampleBytes != 1 && config.sampleBytes != 2
+						&& config.sampleBytes != 4)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				impl.config = config;
+				impl.mask = (config.sampleBytes == 4) ? config.mask
+					: config.mask & ((1u << (8 * config.sampleBytes)) - 1);
+
+				const uInt64 granularity = MappedFile::Granularity();
+				impl.segmentBytes = RoundUp(std::max<uInt64>(config.reserveBytes, granularity),
+					granularity);
+				impl.headerView = (size_t)granularity;
+
+				try {
+					impl.values.assign(config.channels, 0);
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (!impl.file.Create(path) || !impl.MapSegment(0)) {
+					impl.ReleaseFile();
+					return NativeErrorFileIo;
+				}
+
+				impl.header = static_cast<TransitionFileHeader*>(
+					impl.file.Map(0, impl.headerView, true));
+
+				if (impl.header == nullptr) {
+					impl.ReleaseFile();
+					return NativeErrorFileIo;
+				}
+
+				TransitionFileHeader* header = impl.header;
+				std::memset(header, 0, sizeof(TransitionFileHeader));
+				std::memcpy(header->magic, TransitionMagic, sizeof(TransitionMagic));
+				header->version = TransitionVersion;
+				header->headerBytes = sizeof(TransitionFileHeader);
+				header->channels = config.channels;
+				header->sampleBytes = config.sampleBytes;
+				header->mask = impl.mask;
+				header->sampleRate = config.sampleRate;
+				header->createdNs = NowNs();
+
+				impl.lastIndex = 0;
+				impl.dataBytes = 0;
+				impl.transitionCount = 0;
+				impl.samplesPerChannel = 0;
+				impl.open = true;
+				return NativeSuccess;
+			}
+
+			int32 TransitionWriterCore::Append(const DigitalTransition* transitions,
+				size_t count) {
+
+				if (_impl == nullptr || !_impl->open) {
+					return NativeErrorNotAttached;
+				}
+
+				Impl& impl = *_impl;
+
+				if (count == 0) {
+					return NativeSuccess;
+				}
+				if (transitions == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				// Checked up front so that a bad call leaves the file as it was.
+				uInt64 last = impl.lastIndex;
+				for (size_t k = 0; k < count; k++) {
+					if (transitions[k].channel >= impl.config.channels
+						|| transitions[k].sampleIndex < last) {
+						return NativeErrorInvalidArgument;
+					}
+					last = transitions[k].sampleIndex;
+				}
+
+				const bool multiChannel = impl.config.channels > 1;
+				uint8_t buffer[64 * MaxEncodedTransitionBytes];
+				size_t used = 0;
+
+				for (size_t k = 0; k < count; k++) {
+
+					const DigitalTransition& t = transitions[k];
+					const uInt32 value = t.value & impl.mask;
+					const uInt32 changed = value ^ impl.values[t.channel];
+
+					if (changed == 0) {
+						continue;
+					}
+
+					used += EncodeTransition(t.sampleIndex - impl.lastIndex, t.channel, changed,
+						multiChannel, buffer + used);
+
+					impl.values[t.channel] = value;
+					impl.lastIndex = t.sampleIndex;
+					impl.transitionCount++;
+
+					if (used > sizeof(buffer) - MaxEncodedTransitionBytes) {
+						if (!impl.Write(buffer, used)) {
+							return NativeErrorFileIo;
+						}
+						used = 0;
+					}
+				}
+
+				if (used > 0 && !impl.Write(buffer, used)) {
+					return NativeErrorFileIo;
+				}
+
+				impl.samplesPerChannel = std::max(impl.samplesPerChannel, last + 1);
+				impl.UpdateHeader();
+				return NativeSuccess;
+			}
+
+			int32 TransitionWriterCore::AppendFrom(EdgeExtractorCore& extractor) {
+
+				if (_impl == nullptr || !_impl->open) {
+					return NativeErrorNotAttached;
+				}
+
+				DigitalTransition batch[DrainBatch];
+				// Read before draining: transitions found after this point
+				// lie beyond it and are left for the next call.
+				const uInt64 position = extractor.Position();
+				size_t n;
+
+				while ((n = extractor.ReadTransitions(batch, DrainBatch)) > 0) {
+
+					const int32 status = Append(batch, n);
+					if (status != NativeSuccess) {
+						return status;
+					}
+				}
+
+				SetSamplesPerChannel(position);
+				return NativeSuccess;
+			}
+
+			void TransitionWriterCore::SetSamplesPerChannel(uInt64 samplesPerChannel) {
+
+				if (_impl == nullptr || !_impl->open) {
+					return;
+				}
+
+				_impl->samplesPerChannel = std::max(_impl->samplesPerChannel, samplesPerChannel);
+				_impl->UpdateHeader();
+			}
+
+			int32 TransitionWriterCore::Close() {
+
+				if (_impl == nullptr || !_impl->open) {
+					return NativeSuccess;
+				}
+
+				Impl& impl = *_impl;
+				int32 status = NativeSuccess;
+
+				impl.UpdateHeader();
+				impl.header->flags |= TransitionFlagClosed;
+
+				// Views must be gone before the reserved tail can be cut off.
+				if (impl.segment != nullptr) {
+					MappedFile::Unmap(impl.segment, (size_t)impl.segmentBytes, true);
+					impl.segment = nullptr;
+					impl.mappedSegment = -1;
+				}
+				MappedFile::Unmap(impl.header, impl.headerView, true);
+				impl.header = nullptr;
+
+				if (!impl.file.Truncate(sizeof(TransitionFileHeader) + impl.dataBytes)) {
+					status = NativeErrorFileIo;
+				}
+				if (impl.config.syncOnClose && !impl.file.Sync()) {
+					status = NativeErrorFileIo;
+				}
+
+				impl.ReleaseFile();
+				return status;
+			}
+
+			bool TransitionWriterCore::IsOpen() const {
+				return _impl != nullptr && _impl->open;
+			}
+
+			uInt64 TransitionWriterCore::TransitionCount() const {
+				return (_impl != nullptr) ? _impl->transitionCount : 0;
+			}
+
+			uInt64 TransitionWriterCore::DataBytes() const {
+				return (_impl != nullptr) ? _impl->dataBytes : 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,155 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the transition file writer. Safe to include from code compiled
+* with /clr; the encoder and the mapping live in TransitionWriterCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "TransitionFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			class EdgeExtractorCore;
+
+			/**
+			* @brief Settings of a `TransitionWriterCore`.
+			*/
+			struct TransitionWriterConfig {
+
+				/** Number of channels of the transitions. */
+				uInt32 channels;
+
+				/** Bytes of the sampled words (1, 2 or 4); stored in the header. */
+				uInt32 sampleBytes;
+
+				/** Lines that were watched; stored in the header and applied to
+				*   the values appended. */
+				uInt32 mask;
+
+				/** Sample clock rate, stored in the header. `0` if unknown. */
+				float64 sampleRate;
+
+				/** The file is grown (and its space reserved) in steps of this
+				*   many bytes, and mapped one step at a time. */
+				uInt64 reserveBytes;
+
+				/** If `true`, `Close` waits until the data is on the disk. */
+				bool syncOnClose;
+			};
+
+			inline TransitionWriterConfig DefaultTransitionWriterConfig() {
+
+				TransitionWriterConfig config;
+				config.channels = 1;
+				config.sampleBytes = 4;
+				config.mask = 0xFFFFFFFFu;
+				config.sampleRate = 0.0;
+				config.reserveBytes = 1 << 20;
+				config.syncOnClose = false;
+				return config;
+			}
+
+			/**
+			* @brief Writes transitions to a file in the compact encoding of
+			*        TransitionFormat.h.
+			*
+			* The writer derives the changed lines from the values itself, so
+			* a stream with records missing (e.g. dropped by a full extractor
+			* ring) is still decoded to the right values; records that change
+			* nothing are skipped. The header counts are updated after every
+			* append, so a file cut short reads up to the last one.
+			*
+			* All calls come from one thread.
+			*/
+			class TransitionWriterCore {
+
+			public:
+				TransitionWriterCore();
+				~TransitionWriterCore();
+
+				TransitionWriterCore(const TransitionWriterCore&) = delete;
+				TransitionWriterCore& operator=(const TransitionWriterCore&) = delete;
+
+				/**
+				* @brief Creates (or truncates) the file and writes its header.
+				*
+				* @param[in] path UTF-8 path.
+				*
+				* @return `0`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorAlreadyRunning` (already open),
+				*         `NativeErrorOutOfMemory` or `NativeErrorFileIo`.
+				*/
+				int32 Create(const char* path, const TransitionWriterConfig& config);
+
+				/**
+				* @brief Appends transitions ordered by sample index, then channel.
+				*
+				* `changed` is ignored; see the class description. Also extends
+				* `SamplesPerChannel` past the last transition.
+				*
+				* @return `0`, `NativeErrorNotAttached` (not open),
+				*         `NativeErrorInvalidArgument` (channel out of range or
+				*         out of order; nothing of the call is written) or
+				*         `NativeErrorFileIo`.
+				*/
+				int32 Append(const DigitalTransition* transitions, size_t count);
+
+				/**
+				* @brief Appends the pending transitions of `extractor` and
+				*        extends the file to its position.
+				*/
+				int32 AppendFrom(EdgeExtractorCore& extractor);
+
+				/**
+				* @brief Records that the stream covers `samplesPerChannel`
+				*        samples per channel. Never moves backwards.
+				*/
+				void SetSamplesPerChannel(uInt64 samplesPerChannel);
+
+				/**
+				* @brief Marks the file complete, cuts off the reserved tail and
+				*        closes it.
+				*/
+				int32 Close();
+
+				bool IsOpen() const;
+
+				uInt64 TransitionCount() const;
+
+				/**
+				* @brief Bytes of encoded records written so far.
+				*/
+				uInt64 DataBytes() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
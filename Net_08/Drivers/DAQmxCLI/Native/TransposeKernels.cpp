@@ -0,0 +1,337 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TransposeKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Edge, in elements, of the square tile walked at a time. 64 x 64
+				// elements of up to 4 bytes and 32 x 32 of 8 bytes keep the source
+				// and destination tiles in L1.
+				size_t TileEdge(size_t elementSize) {
+					return (elementSize >= 8) ? 32 : 64;
+				}
+
+				template <typename T>
+				inline void TransposeScalar(const T* src, size_t srcStride,
+					T* dst, size_t dstStride, size_t rows, size_t cols) {
+
+					for (size_t r = 0; r < rows; r++) {
+						for (size_t c = 0; c < cols; c++) {
+							dst[c * dstStride + r] = src[r * srcStride + c];
+						}
+					}
+				}
+
+				// Signature of a register kernel: transposes one K x K block.
+				template <typename T>
+				using MicroKernel = void (*)(const T* src, size_t srcStride,
+					T* dst, size_t dstStride);
+
+				// Tiles the matrix; inside a tile runs the K x K kernel on whole
+				// blocks and scalar code on the remainder.
+				template <typename T>
+				void TransposeBlocked(const T* src, size_t ss, T* dst, size_t ds,
+					size_t rows, size_t cols, size_t k, MicroKernel<T> micro) {
+
+					const size_t tile = TileEdge(sizeof(T));
+
+					for (size_t r0 = 0; r0 < rows; r0 += tile) {
+
+						const size_t r1 = std::min(rows, r0 + tile);
+
+						for (size_t c0 = 0; c0 < cols; c0 += tile) {
+
+							const size_t c1 = std::min(cols, c0 + tile);
+							size_t r = r0;
+
+							if (micro != nullptr) {
+								for (; r + k <= r1; r += k) {
+
+									size_t c = c0;
+									for (; c + k <= c1; c += k) {
+										micro(src + r * ss + c, ss, dst + c * ds + r, ds);
+									}
+									TransposeScalar(src + r * ss + c, ss,
+										dst + c * ds + r, ds, k, c1 - c);
+								}
+							}
+
+							TransposeScalar(src + r * ss + c0, ss,
+								dst + c0 * ds + r, ds, r1 - r, c1 - c0);
+						}
+					}
+				}
+
+#if NATIVE_X86
+				// 16 x 16 bytes: four rounds of unpacks (8, 16, 32, 64 bit).
+				NATIVE_TARGET_SSE41
+				void Micro8x16(const uInt8* src, size_t ss, uInt8* dst, size_t ds) {
+
+					__m128i a[16], b[16], c[16], d[16];
+
+					for (int i = 0; i < 16; i++) {
+						a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * ss));
+					}
+					for (int i = 0; i < 8; i++) {
+						b[2 * i] = _mm_unpacklo_epi8(a[2 * i], a[2 * i + 1]);
+						b[2 * i + 1] = _mm_unpackhi_epi8(a[2 * i], a[2 * i + 1]);
+					}
+					for (int g = 0; g < 4; g++) {
+						const int o = 4 * g;
+						c[o + 0] = _mm_unpacklo_epi16(b[o + 0], b[o + 2]);
+						c[o + 1] = _mm_unpackhi_epi16(b[o + 0], b[o + 2]);
+						c[o + 2] = _mm_unpacklo_epi16(b[o + 1], b[o + 3]);
+						c[o + 3] = _mm_unpackhi_epi16(b[o + 1], b[o + 3]);
+					}
+					for (int g = 0; g < 2; g++) {
+						const int ci = 8 * g;
+						const int di = 8 * g;
+						for (int j = 0; j < 4; j++) {
+							d[di + 2 * j] = _mm_unpacklo_epi32(c[ci + j], c[ci + 4 + j]);
+							d[di + 2 * j + 1] = _mm_unpackhi_epi32(c[ci + j], c[ci + 4 + j]);
+						}
+					}
+					for (int j = 0; j < 8; j++) {
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (2 * j) * ds),
+							_mm_unpacklo_epi64(d[j], d[j + 8]));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (2 * j + 1) * ds),
+							_mm_unpackhi_epi64(d[j], d[j + 8]));
+					}
+				}
+
+				// 8 x 8 16-bit: unpack 16, 32, 64.
+				NATIVE_TARGET_SSE41
+				void Micro16x8(const uInt16* src, size_t ss, uInt16* dst, size_t ds) {
+
+					__m128i a[8], t[8], u[8];
+
+					for (int i = 0; i < 8; i++) {
+						a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * ss));
+					}
+					for (int i = 0; i < 4; i++) {
+						t[2 * i] = _mm_unpacklo_epi16(a[2 * i], a[2 * i + 1]);
+						t[2 * i + 1] = _mm_unpackhi_epi16(a[2 * i], a[2 * i + 1]);
+					}
+					for (int g = 0; g < 2; g++) {
+						const int o = 4 * g;
+						u[o + 0] = _mm_unpacklo_epi32(t[o + 0], t[o + 2]);
+						u[o + 1] = _mm_unpackhi_epi32(t[o + 0], t[o + 2]);
+						u[o + 2] = _mm_unpacklo_epi32(t[o + 1], t[o + 3]);
+						u[o + 3] = _mm_unpackhi_epi32(t[o + 1], t[o + 3]);
+					}
+					for (int j = 0; j < 4; j++) {
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (2 * j) * ds),
+							_mm_unpacklo_epi64(u[j], u[j + 4]));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (2 * j + 1) * ds),
+							_mm_unpackhi_epi64(u[j], u[j + 4]));
+					}
+				}
+
+				// 4 x 4 32-bit.
+				NATIVE_TARGET_SSE41
+				void Micro32x4(const uInt32* src, size_t ss, uInt32* dst, size_t ds) {
+
+					const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+					const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ss));
+					const __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * ss));
+					const __m128i a3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * ss));
+
+					const __m128i t0 = _mm_unpacklo_epi32(a0, a1);
+					const __m128i t1 = _mm_unpackhi_epi32(a0, a1);
+					const __m128i t2 = _mm_unpacklo_epi32(a2, a3);
+					const __m128i t3 = _mm_unpackhi_epi32(a2, a3);
+
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi64(t0, t2));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ds), _mm_unpackhi_epi64(t0, t2));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * ds), _mm_unpacklo_epi64(t1, t3));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * ds), _mm_unpackhi_epi64(t1, t3));
+				}
+
+				// 8 x 8 32-bit: unpack, shuffle, then swap 128-bit halves.
+				NATIVE_TARGET_AVX2
+				void Micro32x8(const uInt32* src, size_t ss, uInt32* dst, size_t ds) {
+
+					__m256 a[8], t[8], u[8];
+
+					for (int i = 0; i < 8; i++) {
+						a[i] = _mm256_loadu_ps(reinterpret_cast<const float*>(src + i * ss));
+					}
+					for (int i = 0; i < 4; i++) {
+						t[2 * i] = _mm256_unpacklo_ps(a[2 * i], a[2 * i + 1]);
+						t[2 * i + 1] = _mm256_unpackhi_ps(a[2 * i], a[2 * i + 1]);
+					}
+					for (int g = 0; g < 2; g++) {
+						const int o = 4 * g;
+						u[o + 0] = _mm256_shuffle_ps(t[o + 0], t[o + 2], 0x44);
+						u[o + 1] = _mm256_shuffle_ps(t[o + 0], t[o + 2], 0xEE);
+						u[o + 2] = _mm256_shuffle_ps(t[o + 1], t[o + 3], 0x44);
+						u[o + 3] = _mm256_shuffle_ps(t[o + 1], t[o + 3], 0xEE);
+					}
+					for (int j = 0; j < 4; j++) {
+						_mm256_storeu_ps(reinterpret_cast<float*>(dst + j * ds),
+							_mm256_permute2f128_ps(u[j], u[j + 4], 0x20));
+						_mm256_storeu_ps(reinterpret_cast<float*>(dst + (j + 4) * ds),
+							_mm256_permute2f128_ps(u[j], u[j + 4], 0x31));
+					}
+				}
+
+				// 4 x 4 64-bit.
+				NATIVE_TARGET_AVX2
+				void Micro64x4(const uInt64* src, size_t ss, uInt64* dst, size_t ds) {
+
+					const __m256d a0 = _mm256_loadu_pd(reinterpret_cast<const double*>(src));
+					const __m256d a1 = _mm256_loadu_pd(reinterpret_cast<const double*>(src + ss));
+					const __m256d a2 = _mm256_loadu_pd(reinterpret_cast<const double*>(src + 2 * ss));
+					const __m256d a3 = _mm256_loadu_pd(reinterpret_cast<const double*>(src + 3 * ss));
+
+					const __m256d t0 = _mm256_unpacklo_pd(a0, a1);
+					const __m256d t1 = _mm256_unpackhi_pd(a0, a1);
+					const __m256d t2 = _mm256_unpacklo_pd(a2, a3);
+					const __m256d t3 = _mm256_unpackhi_pd(a2, a3);
+
+					_mm256_storeu_pd(reinterpret_cast<double*>(dst), _mm256_permute2f128_pd(t0, t2, 0x20));
+					_mm256_storeu_pd(reinterpret_cast<double*>(dst + ds), _mm256_permute2f128_pd(t1, t3, 0x20));
+					_mm256_storeu_pd(reinterpret_cast<double*>(dst + 2 * ds), _mm256_permute2f128_pd(t0, t2, 0x31));
+					_mm256_storeu_pd(reinterpret_cast<double*>(dst + 3 * ds), _mm256_permute2f128_pd(t1, t3, 0x31));
+				}
+#endif
+			}
+
+			bool Transpose(const void* src, void* dst, size_t rows, size_t cols,
+				size_t elementSize) {
+
+				// A single row or column is already its own transpose.
+				if ((rows == 1 || cols == 1)
+					&& (elementSize == 1 || elementSize == 2 || elementSize == 4
+						|| elementSize == 8)) {
+					std::memcpy(dst, src, rows * cols * elementSize);
+					return true;
+				}
+
+				return TransposeStrided(src, cols, dst, rows, rows, cols, elementSize);
+			}
+
+			bool TransposeStrided(const void* src, size_t srcStride, void* dst,
+				size_t dstStride, size_t rows, size_t cols, size_t elementSize) {
+
+				if (rows == 0 || cols == 0) {
+					return elementSize == 1 || elementSize == 2 || elementSize == 4
+						|| elementSize == 8;
+				}
+
+				const SimdLevel level = ActiveSimdLevel();
+				(void)level;
+
+				switch (elementSize) {
+				case 1: {
+					MicroKernel<uInt8> micro = nullptr;
+#if NATIVE_X86
+					if (level >= SimdLevel::Sse41) {
+						micro = &Micro8x16;
+					}
+#endif
+					TransposeBlocked(static_cast<const uInt8*>(src), srcStride,
+						static_cast<uInt8*>(dst), dstStride, rows, cols, 16, micro);
+					return true;
+				}
+				case 2: {
+					MicroKernel<uInt16> micro = nullptr;
+#if NATIVE_X86
+					if (level >= SimdLevel::Sse41) {
+						micro = &Micro16x8;
+					}
+#endif
+					TransposeBlocked(static_cast<const uInt16*>(src), srcStride,
+						static_cast<uInt16*>(dst), dstStride, rows, cols, 8, micro);
+					return true;
+				}
+				case 4: {
+					MicroKernel<uInt32> micro = nullptr;
+					size_t k = 4;
+#if NATIVE_X86
+					if (level >= SimdLevel::Avx2) {
+						micro = &Micro32x8;
+						k = 8;
+					}
+					else if (level >= SimdLevel::Sse41) {
+						micro = &Micro32x4;
+					}
+#endif
+					TransposeBlocked(static_cast<const uInt32*>(src), srcStride,
+						static_cast<uInt32*>(dst), dstStride, rows, cols, k, micro);
+					return true;
+				}
+				case 8: {
+					MicroKernel<uInt64> micro = nullptr;
+					size_t k = 4;
+#if NATIVE_X86
+					// A 2 x 2 SSE block does not beat the scalar loop.
+					if (level >= SimdLevel::Avx2) {
+						micro = &Micro64x4;
+						k = 4;
+					}
+#endif
+					TransposeBlocked(static_cast<const uInt64*>(src), srcStride,
+						static_cast<uInt64*>(dst), dstStride, rows, cols, k, micro);
+					return true;
+				}
+				default:
+					return false;
+				}
+			}
+
+			bool ConvertFillMode(const void* src, int32 srcFillMode, void* dst,
+				int32 dstFillMode, uInt32 channels, uInt32 samplesPerChannel,
+				size_t elementSize) {
+
+				if (elementSize != 1 && elementSize != 2 && elementSize != 4
+					&& elementSize != 8) {
+					return false;
+				}
+
+				if (srcFillMode == dstFillMode) {
+					std::memcpy(dst, src, (size_t)channels * samplesPerChannel * elementSize);
+					return true;
+				}
+
+				if (srcFillMode == DAQmx_Val_GroupByScanNumber) {
+					return Deinterleave(src, dst, channels, samplesPerChannel, elementSize);
+				}
+				return Interleave(src, dst, channels, samplesPerChannel, elementSize);
+			}
+		}
+	}
+}
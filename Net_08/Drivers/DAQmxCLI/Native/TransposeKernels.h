@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Cache-blocked, vectorized conversions between the two DAQmx fill modes.
+*
+* A block read with `DAQmx_Val_GroupByScanNumber` is a matrix of
+* `samplesPerChannel` rows (scans) by `channels` columns; the same block in
+* `DAQmx_Val_GroupByChannel` is its transpose. Both conversions therefore
+* reduce to `Transpose`, which walks the matrix in cache-sized tiles and
+* transposes each tile with SSE2/AVX2 register kernels (8x8 for 16/32-bit
+* samples, 16x16 for bytes, 4x4 AVX2 for 64-bit), falling back to scalar
+* code for the ragged edges and on CPUs without SSE4.1.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Transposes a row-major `rows` x `cols` matrix:
+			*        `dst[c * rows + r] = src[r * cols + c]`.
+			*
+			* @param[in] src Source matrix.
+			* @param[out] dst Destination matrix; must not overlap `src`.
+			* @param[in] rows Rows of the source.
+			* @param[in] cols Columns of the source.
+			* @param[in] elementSize Element size in bytes: 1, 2, 4 or 8.
+			*
+			* @return `true` on success, `false` if `elementSize` is not supported.
+			*/
+			bool Transpose(const void* src, void* dst, size_t rows, size_t cols,
+				size_t elementSize);
+
+			/**
+			* @brief Transposes a sub-matrix: `dst[c * dstStride + r] =
+			*        src[r * srcStride + c]` for `r < rows`, `c < cols`.
+			*
+			* Used to convert a window of a larger block, e.g. a range of
+			* samples of a block grouped by channel.
+			*
+			* @param[in] srcStride Distance between source rows, in elements.
+			* @param[in] dstStride Distance between destination rows, in elements.
+			*/
+			bool TransposeStrided(const void* src, size_t srcStride, void* dst,
+				size_t dstStride, size_t rows, size_t cols, size_t elementSize);
+
+			/**
+			* @brief Converts a block from GroupByScanNumber to GroupByChannel.
+			*/
+			inline bool Deinterleave(const void* src, void* dst, uInt32 channels,
+				uInt32 samplesPerChannel, size_t elementSize) {
+				return Transpose(src, dst, samplesPerChannel, channels, elementSize);
+			}
+
+			/**
+			* @brief Converts a block from GroupByChannel to GroupByScanNumber.
+			*/
+			inline bool Interleave(const void* src, void* dst, uInt32 channels,
+				uInt32 samplesPerChannel, size_t elementSize) {
+				return Transpose(src, dst, channels, samplesPerChannel, elementSize);
+			}
+
+			/**
+			* @brief Converts a block between fill modes. A no-op copy when the
+			*        modes are equal.
+			*/
+			bool ConvertFillMode(const void* src, int32 srcFillMode, void* dst,
+				int32 dstFillMode, uInt32 channels, uInt32 samplesPerChannel,
+				size_t elementSize);
+		}
+	}
+}
@@ -0,0 +1,253 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TriggerKernels.h"
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Index of the lowest set bit of a non-zero mask.
+				inline uInt32 LowestSetBit(uInt32 mask) {
+#if defined(_MSC_VER)
+					unsigned long index;
+					_BitScanForward(&index, mask);
+					return (uInt32)index;
+#else
+					return (uInt32)__builtin_ctz(mask);
+#endif
+				}
+
+				template <typename T, typename U>
+				inline bool Passes(T x, CrossingTest test, U t) {
+					switch (test) {
+					case CrossingTest::Below: return x < t;
+					case CrossingTest::AtOrAbove: return x >= t;
+					case CrossingTest::Above: return x > t;
+					default: return x <= t;
+					}
+				}
+
+				template <typename T, typename U>
+				size_t FindFirstScalar(const T* x, size_t begin, size_t count,
+					CrossingTest test, U threshold) {
+
+					for (size_t i = begin; i < count; i++) {
+						if (Passes(x[i], test, threshold)) {
+							return i;
+						}
+					}
+					return count;
+				}
+
+#if NATIVE_X86
+				// Ordered comparisons: NaN passes nothing. `Test` is a constant,
+				// so the switches fold away.
+				template <CrossingTest Test>
+				NATIVE_TARGET_AVX2
+				inline __m256d CompareAvx2(__m256d x, __m256d t) {
+					switch (Test) {
+					case CrossingTest::Below: return _mm256_cmp_pd(x, t, _CMP_LT_OQ);
+					case CrossingTest::AtOrAbove: return _mm256_cmp_pd(x, t, _CMP_GE_OQ);
+					case CrossingTest::Above: return _mm256_cmp_pd(x, t, _CMP_GT_OQ);
+					default: return _mm256_cmp_pd(x, t, _CMP_LE_OQ);
+					}
+				}
+
+				template <CrossingTest Test>
+				inline __m128d CompareSse2(__m128d x, __m128d t) {
+					switch (Test) {
+					case CrossingTest::Below: return _mm_cmplt_pd(x, t);
+					case CrossingTest::AtOrAbove: return _mm_cmpge_pd(x, t);
+					case CrossingTest::Above: return _mm_cmpgt_pd(x, t);
+					default: return _mm_cmple_pd(x, t);
+					}
+				}
+
+				template <CrossingTest Test>
+				NATIVE_TARGET_AVX2
+				size_t FindFirstF64Avx2(const float64* x, size_t count, float64 threshold) {
+
+					const __m256d t = _mm256_set1_pd(threshold);
+					size_t i = 0;
+
+					for (; i + 8 <= count; i += 8) {
+
+						const uInt32 mask = (uInt32)_mm256_movemask_pd(
+								CompareAvx2<Test>(_mm256_loadu_pd(x + i), t))
+							| ((uInt32)_mm256_movemask_pd(
+								CompareAvx2<Test>(_mm256_loadu_pd(x + i + 4), t)) << 4);
+
+						if (mask != 0) {
+							return i + LowestSetBit(mask);
+						}
+					}
+					return FindFirstScalar(x, i, count, Test, threshold);
+				}
+
+				// Plain SSE2, selected from the SSE4.1 level on.
+				template <CrossingTest Test>
+				NATIVE_TARGET_SSE41
+				size_t FindFirstF64Sse2(const float64* x, size_t count, float64 threshold) {
+
+					const __m128d t = _mm_set1_pd(threshold);
+					size_t i = 0;
+
+					for (; i + 4 <= count; i += 4) {
+
+						const uInt32 mask = (uInt32)_mm_movemask_pd(
+								CompareSse2<Test>(_mm_loadu_pd(x + i), t))
+							| ((uInt32)_mm_movemask_pd(
+								CompareSse2<Test>(_mm_loadu_pd(x + i + 2), t)) << 2);
+
+						if (mask != 0) {
+							return i + LowestSetBit(mask);
+						}
+					}
+					return FindFirstScalar(x, i, count, Test, threshold);
+				}
+
+				template <CrossingTest Test>
+				size_t FindFirstF64Simd(const float64* x, size_t count, float64 threshold) {
+					return (ActiveSimdLevel() == SimdLevel::Avx2)
+						? FindFirstF64Avx2<Test>(x, count, threshold)
+						: FindFirstF64Sse2<Test>(x, count, threshold);
+				}
+
+				// `x < t` is `t > x`, `x > t` is `x > t`; the inclusive tests are
+				// their complements. `invert` flips the movemask.
+				NATIVE_TARGET_AVX2
+				size_t FindFirstI16Avx2(const int16* x, size_t count, bool swap, bool invert,
+					int16 threshold, CrossingTest test) {
+
+					const __m256i t = _mm256_set1_epi16(threshold);
+					const uInt32 flip = invert ? 0xFFFFFFFFu : 0u;
+					size_t i = 0;
+
+					for (; i + 32 <= count; i += 32) {
+
+						const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+						const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 16));
+						const __m256i ga = swap ? _mm256_cmpgt_epi16(t, a) : _mm256_cmpgt_epi16(a, t);
+						const __m256i gb = swap ? _mm256_cmpgt_epi16(t, b) : _mm256_cmpgt_epi16(b, t);
+
+						// One byte per lane after packing; packs works within
+						// 128-bit halves, so restore the order with a permute.
+						const __m256i packed = _mm256_permute4x64_epi64(
+							_mm256_packs_epi16(ga, gb), 0xD8);
+						const uInt32 mask = (uInt32)_mm256_movemask_epi8(packed) ^ flip;
+
+						if (mask != 0) {
+							return i + LowestSetBit(mask);
+						}
+					}
+					return FindFirstScalar(x, i, count, test, (int32)threshold);
+				}
+
+				NATIVE_TARGET_SSE41
+				size_t FindFirstI16Sse2(const int16* x, size_t count, bool swap, bool invert,
+					int16 threshold, CrossingTest test) {
+
+					const __m128i t = _mm_set1_epi16(threshold);
+					const uInt32 flip = invert ? 0xFFFFu : 0u;
+					size_t i = 0;
+
+					for (; i + 16 <= count; i += 16) {
+
+						const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+						const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i + 8));
+						const __m128i ga = swap ? _mm_cmpgt_epi16(t, a) : _mm_cmpgt_epi16(a, t);
+						const __m128i gb = swap ? _mm_cmpgt_epi16(t, b) : _mm_cmpgt_epi16(b, t);
+						const uInt32 mask = (uInt32)_mm_movemask_epi8(_mm_packs_epi16(ga, gb)) ^ flip;
+
+						if (mask != 0) {
+							return i + LowestSetBit(mask);
+						}
+					}
+					return FindFirstScalar(x, i, count, test, (int32)threshold);
+				}
+#endif
+			}
+
+			size_t FindFirstF64(const float64* x, size_t count, CrossingTest test,
+				float64 threshold) {
+
+#if NATIVE_X86
+				if (ActiveSimdLevel() != SimdLevel::Scalar) {
+					switch (test) {
+					case CrossingTest::Below:
+						return FindFirstF64Simd<CrossingTest::Below>(x, count, threshold);
+					case CrossingTest::AtOrAbove:
+						return FindFirstF64Simd<CrossingTest::AtOrAbove>(x, count, threshold);
+					case CrossingTest::Above:
+						return FindFirstF64Simd<CrossingTest::Above>(x, count, threshold);
+					default:
+						return FindFirstF64Simd<CrossingTest::AtOrBelow>(x, count, threshold);
+					}
+				}
+#endif
+				return FindFirstScalar(x, 0, count, test, threshold);
+			}
+
+			size_t FindFirstI16(const int16* x, size_t count, CrossingTest test,
+				int32 threshold) {
+
+				// Thresholds beyond the I16 range pass every sample or none.
+				const bool below = (test == CrossingTest::Below || test == CrossingTest::AtOrBelow);
+
+				if (threshold > 32767 || threshold < -32768) {
+					const bool all = below ? (threshold > 0) : (threshold < 0);
+					return all ? 0 : count;
+				}
+
+#if NATIVE_X86
+				// Below: t > x. AtOrAbove: not (t > x). Above: x > t.
+				// AtOrBelow: not (x > t).
+				const bool swap = (test == CrossingTest::Below || test == CrossingTest::AtOrAbove);
+				const bool invert = (test == CrossingTest::AtOrAbove || test == CrossingTest::AtOrBelow);
+
+				switch (ActiveSimdLevel()) {
+				case SimdLevel::Avx2:
+					return FindFirstI16Avx2(x, count, swap, invert, (int16)threshold, test);
+				case SimdLevel::Sse41:
+					return FindFirstI16Sse2(x, count, swap, invert, (int16)threshold, test);
+				default:
+					break;
+				}
+#endif
+				return FindFirstScalar(x, 0, count, test, threshold);
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized threshold searches of the software trigger.
+*
+* A level trigger with hysteresis is a small state machine whose
+* transitions are threshold crossings: wait for the signal to go beyond
+* the arming threshold, then for it to reach the level. Each wait is a
+* search for the first sample passing one comparison, which the kernels
+* below run over 8 (F64) or 32 (I16) samples per step in SSE2/AVX2
+* registers, reducing the comparison masks with movemask.
+*/
+
+#include "NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief Comparison of a sample `x` against a threshold `t`.
+			*/
+			enum class CrossingTest : int32 {
+				/** `x < t` */
+				Below = 0,
+				/** `x >= t` */
+				AtOrAbove = 1,
+				/** `x > t` */
+				Above = 2,
+				/** `x <= t` */
+				AtOrBelow = 3
+			};
+
+			/**
+			* @brief Index of the first of `count` samples passing `test`
+			*        against `threshold`, or `count` if none does. NaN
+			*        samples pass no test.
+			*/
+			size_t FindFirstF64(const float64* x, size_t count, CrossingTest test,
+				float64 threshold);
+
+			/**
+			* @brief Index of the first of `count` samples passing `test`
+			*        against `threshold`, or `count` if none does. Thresholds
+			*        outside the I16 range are allowed.
+			*/
+			size_t FindFirstI16(const int16* x, size_t count, CrossingTest test,
+				int32 threshold);
+		}
+	}
+}
@@ -0,0 +1,1007 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveformCacheCore.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "MappedFile.h"
+#include "NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Cache file: a header, then per entry its canonical form and
+				// its samples at a cache-line boundary, then the index.
+				//
+				//   [header][form 0][data 0] ... [form n-1][data n-1][index]
+				//
+				// All fields are little endian.
+				const char CacheMagic[8] = { 'G', 'D', 'A', 'Q', 'W', 'F', 'C', '1' };
+				const uInt32 CacheVersion = 1;
+				const uInt32 FormVersion = 1;
+
+				#pragma pack(push, 8)
+
+				struct CacheFileHeader {
+					char magic[8];
+					uInt32 version;
+					uInt32 headerBytes;
+					uInt64 entryCount;
+					uInt64 indexOffset;
+					uInt64 fileBytes;
+					/** Hash of the index. */
+					uInt64 indexHash;
+					uInt64 reserved[2];
+				};
+
+				struct CacheFileEntry {
+					uInt64 keyHigh;
+					uInt64 keyLow;
+					uInt64 formOffset;
+					uInt64 dataOffset;
+					uInt64 dataBytes;
+					/** Hash of the samples. */
+					uInt64 dataHash;
+					uInt32 formBytes;
+					uInt32 channels;
+					uInt32 samplesPerChannel;
+					int32 fillMode;
+				};
+
+				#pragma pack(pop)
+
+				static_assert(sizeof(CacheFileHeader) == 64, "Cache file header must stay one cache line.");
+				static_assert(sizeof(CacheFileEntry) == 64, "Cache file entries must stay one cache line.");
+
+				inline uInt64 RotateLeft(uInt64 v, int r) {
+					return (v << r) | (v >> (64 - r));
+				}
+
+				inline uInt64 FinalMix(uInt64 h) {
+					h ^= h >> 33;
+					h *= 0xFF51AFD7ED558CCDull;
+					h ^= h >> 33;
+					h *= 0xC4CEB9FE1A85EC53ull;
+					h ^= h >> 33;
+					return h;
+				}
+
+				// 128-bit hash with the structure of MurmurHash3 x64/128; a few
+				// GB/s, so that a table or a block is hashed in one pass.
+				WaveformCacheKey HashBytes(const void* data, size_t bytes) {
+
+					const uInt64 c1 = 0x87C37B91114253D5ull;
+					const uInt64 c2 = 0x4CF5AD432745937Full;
+					const uint8_t* p = static_cast<const uint8_t*>(data);
+					uInt64 h1 = 0x9E3779B97F4A7C15ull;
+					uInt64 h2 = 0x6A09E667F3BCC909ull;
+
+					size_t left = bytes;
+					uint8_t tail[16];
+
+					while (left > 0) {
+
+						uInt64 k1;
+						uInt64 k2;
+
+						if (left >= 16) {
+							std::memcpy(&k1, p, 8);
+							std::memcpy(&k2, p + 8, 8);
+							p += 16;
+							left -= 16;
+						}
+						else {
+							std::memset(tail, 0, sizeof(tail));
+							std::memcpy(tail, p, left);
+							std::memcpy(&k1, tail, 8);
+							std::memcpy(&k2, tail + 8, 8);
+							left = 0;
+						}
+
+						k1 *= c1; k1 = RotateLeft(k1, 31); k1 *= c2; h1 ^= k1;
+						h1 = RotateLeft(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+
+						k2 *= c2; k2 = RotateLeft(k2, 33); k2 *= c1; h2 ^= k2;
+						h2 = RotateLeft(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+					}
+
+					h1 ^= (uInt64)bytes;
+					h2 ^= (uInt64)bytes;
+					h1 += h2;
+					h2 += h1;
+					h1 = FinalMix(h1);
+					h2 = FinalMix(h2);
+					h1 += h2;
+					h2 += h1;
+
+					WaveformCacheKey key;
+					key.high = h1;
+					key.low = h2;
+					return key;
+				}
+
+				struct KeyHash {
+					size_t operator()(const WaveformCacheKey& key) const {
+						return (size_t)key.low;
+					}
+				};
+
+				struct KeyEqual {
+					bool operator()(const WaveformCacheKey& a, const WaveformCacheKey& b) const {
+						return a.high == b.high && a.low == b.low;
+					}
+				};
+
+				// Appends the fields of a stimulus that change its samples.
+				class FormWriter {
+
+				public:
+					explicit FormWriter(std::vector<uint8_t>& out) : _out(out) {}
+
+					void U32(uInt32 v) {
+						Append(&v, sizeof(v));
+					}
+
+					void U64(uInt64 v) {
+						Append(&v, sizeof(v));
+					}
+
+					void F64(float64 v) {
+						// -0 and +0 render alike.
+						const float64 canonical = v + 0.0;
+						Append(&canonical, sizeof(canonical));
+					}
+
+				private:
+					void Append(const void* p, size_t n) {
+						const uint8_t* b = static_cast<const uint8_t*>(p);
+						_out.insert(_out.end(), b, b + n);
+					}
+
+					std::vector<uint8_t>& _out;
+				};
+
+				bool IsFinite(float64 v) {
+					return std::isfinite(v);
+				}
+
+				// Builds the canonical form of `stimulus`; only the parameters
+				// its shapes use go in, so e.g. the duty cycle of a sine does
+				// not split entries. Tables go in as their hash.
+				int32 BuildForm(const WaveformStimulus& stimulus, std::vector<uint8_t>& form) {
+
+					if (stimulus.channels == 0 || stimulus.channelSettings == nullptr
+						|| stimulus.samplesPerChannel == 0
+						|| !(stimulus.sampleRate > 0.0 && IsFinite(stimulus.sampleRate))
+						|| (stimulus.fillMode != DAQmx_Val_GroupByChannel
+							&& stimulus.fillMode != DAQmx_Val_GroupByScanNumber)) {
+						return NativeErrorInvalidArgument;
+					}
+
+					form.clear();
+					FormWriter w(form);
+					w.U32(FormVersion);
+					w.U32(stimulus.channels);
+					w.U32((uInt32)stimulus.fillMode);
+					w.U32(stimulus.samplesPerChannel);
+					w.F64(stimulus.sampleRate);
+
+					for (uInt32 ch = 0; ch < stimulus.channels; ch++) {
+
+						const WaveformStimulusChannel& c = stimulus.channelSettings[ch];
+						const WaveformChannel& waveform = c.waveform;
+
+						w.U32((uInt32)waveform.shape);
+						w.F64(waveform.amplitude);
+						w.F64(waveform.offset);
+						w.F64(c.c0);
+						w.F64(c.c1);
+
+						switch (waveform.shape) {
+						case WaveformShape::Sine:
+						case WaveformShape::Triangle:
+							w.F64(waveform.frequency);
+							w.F64(waveform.phase);
+							break;
+						case WaveformShape::Square:
+							w.F64(waveform.frequency);
+							w.F64(waveform.phase);
+							w.F64(waveform.dutyCycle);
+							break;
+						case WaveformShape::Chirp:
+							w.F64(waveform.frequency);
+							w.F64(waveform.phase);
+							w.F64(waveform.stopFrequency);
+							w.F64(waveform.sweepSeconds);
+							break;
+						case WaveformShape::MultiTone:
+							if (c.toneCount > MaxWaveformTones || (c.tones == nullptr && c.toneCount > 0)) {
+								return NativeErrorInvalidArgument;
+							}
+							w.U32(c.toneCount);
+							for (uInt32 k = 0; k < c.toneCount; k++) {
+								w.F64(c.tones[k].frequency);
+								w.F64(c.tones[k].amplitude);
+								w.F64(c.tones[k].phase);
+							}
+							break;
+						case WaveformShape::Table: {
+							if (c.table == nullptr || c.tableSize == 0 || c.tableSize > MaxWaveformTableSize) {
+								return NativeErrorInvalidArgument;
+							}
+							const WaveformCacheKey table = HashBytes(c.table, (size_t)c.tableSize * sizeof(float64));
+							w.F64(waveform.frequency);
+							w.F64(waveform.phase);
+							w.U32(c.tableSize);
+							w.U64(table.high);
+							w.U64(table.low);
+							break;
+						}
+						default:
+							return NativeErrorInvalidArgument;
+						}
+					}
+
+					return NativeSuccess;
+				}
+
+				struct Entry {
+					WaveformCacheKey key;
+					std::vector<uint8_t> form;
+					// Owned block, or `nullptr` when `data` points into the
+					// mapping of the cache file.
+					int16* heap;
+					const int16* data;
+					size_t bytes;
+					uInt32 channels;
+					uInt32 samplesPerChannel;
+					int32 fillMode;
+					uInt32 refs;
+					// Not in the index; freed on release.
+					bool detached;
+
+					Entry() :
+						key(), heap(nullptr), data(nullptr), bytes(0), channels(0),
+						samplesPerChannel(0), fillMode(0), refs(0), detached(false) {}
+
+					~Entry() {
+						AlignedFree(heap);
+					}
+
+					Entry(const Entry&) = delete;
+					Entry& operator=(const Entry&) = delete;
+				};
+
+				inline uInt64 AlignOffset(uInt64 offset) {
+					return (offset + CacheLineSize - 1) & ~(uInt64)(CacheLineSize - 1);
+				}
+
+				std::filesystem::path NativePath(const std::string& path) {
+					return std::filesystem::u8path(path);
+				}
+			}
+
+			struct WaveformCacheCore::Impl {
+
+				WaveformCacheConfig config;
+				std::string path;
+				bool open;
+
+				// Guards the index, the list and the file.
+				std::mutex mutex;
+				// Most recently used first.
+				std::list<Entry> lru;
+				std::unordered_map<WaveformCacheKey, std::list<Entry>::iterator, KeyHash, KeyEqual> index;
+				uInt64 usedBytes;
+				// Entries handed out and not yet released.
+				uInt64 acquired;
+
+				MappedFile file;
+				void* view;
+				size_t viewBytes;
+
+				// Guards the generator, which renders the misses.
+				std::mutex renderMutex;
+				WaveformGeneratorCore generator;
+
+				std::atomic<uInt64> hits;
+				std::atomic<uInt64> misses;
+				std::atomic<uInt64> evictions;
+				std::atomic<uInt64> uncached;
+				std::atomic<uInt64> entriesLoaded;
+				std::atomic<uInt64> entriesRejected;
+				std::atomic<uInt64> entryCount;
+				std::atomic<uInt64> bytes;
+
+				Impl() :
+					config(DefaultWaveformCacheConfig()), open(false), usedBytes(0), acquired(0),
+					view(nullptr), viewBytes(0), hits(0), misses(0), evictions(0), uncached(0),
+					entriesLoaded(0), entriesRejected(0), entryCount(0), bytes(0) {}
+
+				~Impl() {
+					DropAll();
+					CloseFile();
+				}
+
+				void Publish() {
+					entryCount.store(lru.size(), std::memory_order_relaxed);
+					bytes.store(usedBytes, std::memory_order_relaxed);
+				}
+
+				void CloseFile() {
+					if (view != nullptr) {
+						MappedFile::Unmap(view, viewBytes, false);
+						view = nullptr;
+						viewBytes = 0;
+					}
+					file.Close();
+				}
+
+				void Erase(std::list<Entry>::iterator it) {
+					index.erase(it->key);
+					usedBytes -= it->bytes;
+					lru.erase(it);
+				}
+
+				void DropAll() {
+					index.clear();
+					lru.clear();
+					usedBytes = 0;
+					Publish();
+				}
+
+				// Drops the entries served from the mapping, e.g. when it is gone.
+				void DropMapped() {
+					for (auto it = lru.begin(); it != lru.end();) {
+						auto next = std::next(it);
+						if (it->heap == nullptr) {
+							Erase(it);
+						}
+						it = next;
+					}
+					Publish();
+				}
+
+				// Evicts released entries, least recently used first, until
+				// `needed` more bytes fit the cap.
+				bool MakeRoom(uInt64 needed) {
+
+					if (needed > config.memoryCapBytes) {
+						return false;
+					}
+
+					auto it = lru.end();
+					while (usedBytes + needed > config.memoryCapBytes && it != lru.begin()) {
+						--it;
+						if (it->refs == 0) {
+							auto victim = it++;
+							Erase(victim);
+							evictions.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+					return usedBytes + needed <= config.memoryCapBytes;
+				}
+
+				void Hand(Entry& e, WaveformCacheEntry* entry) {
+					e.refs++;
+					acquired++;
+					entry->data = e.data;
+					entry->channels = e.channels;
+					entry->samplesPerChannel = e.samplesPerChannel;
+					entry->fillMode = e.fillMode;
+					entry->key = e.key;
+					entry->token = &e;
+				}
+
+				int32 Render(const WaveformStimulus& stimulus, int16* block) {
+
+					std::lock_guard<std::mutex> lock(renderMutex);
+
+					WaveformGeneratorConfig gc = DefaultWaveformGeneratorConfig();
+					gc.channels = stimulus.channels;
+					gc.sampleRate = stimulus.sampleRate;
+					gc.format = SampleFormat::Int16;
+					gc.fillMode = stimulus.fillMode;
+
+					int32 status = generator.Configure(gc);
+
+					for (uInt32 ch = 0; ch < stimulus.channels && status == NativeSuccess; ch++) {
+
+						const WaveformStimulusChannel& c = stimulus.channelSettings[ch];
+						status = generator.SetChannel(ch, c.waveform);
+
+						if (status == NativeSuccess) {
+							status = generator.SetCodeScaling(ch, c.c0, c.c1);
+						}
+						if (status == NativeSuccess && c.waveform.shape == WaveformShape::MultiTone) {
+							status = generator.SetTones(ch, c.tones, c.toneCount);
+						}
+						if (status == NativeSuccess && c.waveform.shape == WaveformShape::Table) {
+							status = generator.SetTable(ch, c.table, c.tableSize);
+						}
+					}
+
+					if (status != NativeSuccess) {
+						return status;
+					}
+
+					// Takes the settings over and starts every channel at its phase.
+					generator.Reset();
+					return generator.Render(block, stimulus.samplesPerChannel);
+				}
+
+				bool Load() {
+
+					if (!file.OpenReadOnly(path.c_str())) {
+						return true;
+					}
+
+					const uInt64 size = file.Size();
+					if (size < sizeof(CacheFileHeader) || size > (uInt64)SIZE_MAX) {
+						CloseFile();
+						return false;
+					}
+
+					view = file.Map(0, (size_t)size, false);
+					if (view == nullptr) {
+						file.Close();
+						return false;
+					}
+					viewBytes = (size_t)size;
+
+					const uint8_t* base = static_cast<const uint8_t*>(view);
+					const CacheFileHeader* header = reinterpret_cast<const CacheFileHeader*>(base);
+
+					if (std::memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0
+						|| header->version != CacheVersion
+						|| header->headerBytes != sizeof(CacheFileHeader)
+						|| header->fileBytes != size
+						|| header->indexOffset < sizeof(CacheFileHeader)
+						|| header->indexOffset > size
+						|| header->entryCount > (size - header->indexOffset) / sizeof(CacheFileEntry)) {
+						CloseFile();
+						return false;
+					}
+
+					const CacheFileEntry* records = reinterpret_cast<const CacheFileEntry*>(
+						base + header->indexOffset);
+					const size_t indexBytes = (size_t)header->entryCount * sizeof(CacheFileEntry);
+					const WaveformCacheKey indexHash = HashBytes(records, indexBytes);
+
+					if (indexHash.low != header->indexHash) {
+						CloseFile();
+						return false;
+					}
+
+					for (uInt64 k = 0; k < header->entryCount; k++) {
+
+						const CacheFileEntry& r = records[k];
+						const uInt64 expected = (uInt64)r.channels * r.samplesPerChannel * sizeof(int16);
+
+						const bool valid = r.channels > 0 && r.samplesPerChannel > 0
+							&& r.dataBytes == expected
+							&& r.dataOffset % CacheLineSize == 0
+							&& r.formOffset <= size && r.formBytes <= size - r.formOffset
+							&& r.dataOffset <= size && r.dataBytes <= size - r.dataOffset
+							&& (r.fillMode == DAQmx_Val_GroupByChannel
+								|| r.fillMode == DAQmx_Val_GroupByScanNumber);
+
+						if (!valid) {
+							entriesRejected.fetch_add(1, std::memory_order_relaxed);
+							continue;
+						}
+
+						const WaveformCacheKey key = HashBytes(base + r.formOffset, r.formBytes);
+						const WaveformCacheKey dataHash = HashBytes(base + r.dataOffset, (size_t)r.dataBytes);
+
+						if (key.high != r.keyHigh || key.low != r.keyLow || dataHash.low != r.dataHash
+							|| index.count(key) != 0) {
+							entriesRejected.fetch_add(1, std::memory_order_relaxed);
+							continue;
+						}
+
+						// The file is ordered most recently used first; what does
+						// not fit is the least used.
+						if (usedBytes + r.dataBytes > config.memoryCapBytes) {
+							continue;
+						}
+
+						lru.emplace_back();
+						Entry& e = lru.back();
+						e.key = key;
+						e.form.assign(base + r.formOffset, base + r.formOffset + r.formBytes);
+						e.data = reinterpret_cast<const int16*>(base + r.dataOffset);
+						e.bytes = (size_t)r.dataBytes;
+						e.channels = r.channels;
+						e.samplesPerChannel = r.samplesPerChannel;
+						e.fillMode = r.fillMode;
+
+						index.emplace(key, std::prev(lru.end()));
+						usedBytes += e.bytes;
+						entriesLoaded.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					Publish();
+					return true;
+				}
+
+				int32 SaveLocked() {
+
+					// Layout: forms and blocks in LRU order, then the index.
+					std::vector<CacheFileEntry> records(lru.size());
+					uInt64 offset = sizeof(CacheFileHeader);
+					size_t k = 0;
+
+					for (const Entry& e : lru) {
+						CacheFileEntry& r = records[k++];
+						r.keyHigh = e.key.high;
+						r.keyLow = e.key.low;
+						r.formOffset = offset;
+						r.formBytes = (uInt32)e.form.size();
+						r.dataOffset = AlignOffset(offset + e.form.size());
+						r.dataBytes = e.bytes;
+						r.dataHash = HashBytes(e.data, e.bytes).low;
+						r.channels = e.channels;
+						r.samplesPerChannel = e.samplesPerChannel;
+						r.fillMode = e.fillMode;
+						offset = r.dataOffset + r.dataBytes;
+					}
+
+					const uInt64 indexOffset = AlignOffset(offset);
+					const size_t indexBytes = records.size() * sizeof(CacheFileEntry);
+					const uInt64 total = indexOffset + indexBytes;
+
+					if (total > (uInt64)SIZE_MAX) {
+						return NativeErrorFileIo;
+					}
+
+					// Write a new file beside the old one, so that a failure
+					// leaves the old one intact.
+					const std::string temporary = path + ".tmp";
+					{
+						MappedFile out;
+
+						if (!out.Create(temporary.c_str()) || !out.Reserve(total)) {
+							return NativeErrorFileIo;
+						}
+
+						uint8_t* target = static_cast<uint8_t*>(out.Map(0, (size_t)total, true));
+						if (target == nullptr) {
+							return NativeErrorFileIo;
+						}
+
+						std::memset(target, 0, (size_t)total);
+
+						k = 0;
+						for (const Entry& e : lru) {
+							const CacheFileEntry& r = records[k++];
+							std::memcpy(target + r.formOffset, e.form.data(), e.form.size());
+							std::memcpy(target + r.dataOffset, e.data, e.bytes);
+						}
+
+						if (indexBytes > 0) {
+							std::memcpy(target + indexOffset, records.data(), indexBytes);
+						}
+
+						CacheFileHeader* header = reinterpret_cast<CacheFileHeader*>(target);
+						std::memcpy(header->magic, CacheMagic, sizeof(CacheMagic));
+						header->version = CacheVersion;
+						header->headerBytes = sizeof(CacheFileHeader);
+						header->entryCount = records.size();
+						header->indexOffset = indexOffset;
+						header->fileBytes = total;
+						header->indexHash = HashBytes(records.data(), indexBytes).low;
+
+						MappedFile::Unmap(target, (size_t)total, true);
+
+						if (!out.Sync()) {
+							return NativeErrorFileIo;
+						}
+					}
+
+					// The old mapping must go before the file can be replaced.
+					CloseFile();
+
+					std::error_code error;
+					std::filesystem::rename(NativePath(temporary), NativePath(path), error);
+
+					if (!error && file.OpenReadOnly(path.c_str())) {
+						view = file.Map(0, (size_t)total, false);
+					}
+
+					if (view == nullptr) {
+						file.Close();
+						DropMapped();
+						return NativeErrorFileIo;
+					}
+					viewBytes = (size_t)total;
+
+					// Serve every entry from the new mapping.
+					const uint8_t* base = static_cast<const uint8_t*>(view);
+					k = 0;
+					for (Entry& e : lru) {
+						e.data = reinterpret_cast<const int16*>(base + records[k++].dataOffset);
+						AlignedFree(e.heap);
+						e.heap = nullptr;
+					}
+
+					return NativeSuccess;
+				}
+			};
+
+			WaveformCacheCore::WaveformCacheCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			WaveformCacheCore::~WaveformCacheCore() {
+				Close();
+				delete _impl;
+				_impl = nullptr;
+			}
+
+			int32 WaveformCacheCore::Open(const char* path, const WaveformCacheConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (config.memoryCapBytes == 0) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.mutex);
+
+				if (impl.open) {
+					return NativeErrorAlreadyRunning;
+				}
+
+				try {
+					impl.path = (path != nullptr) ? path : "";
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.config = config;
+				impl.hits.store(0);
+				impl.misses.store(0);
+				impl.evictions.store(0);
+				impl.uncached.store(0);
+				impl.entriesLoaded.store(0);
+				impl.entriesRejected.store(0);
+
+				if (!impl.path.empty()) {
+
+					bool loaded;
+
+					try {
+						loaded = impl.Load();
+					}
+					catch (const std::bad_alloc&) {
+						impl.DropAll();
+						impl.CloseFile();
+						return NativeErrorOutOfMemory;
+					}
+
+					if (!loaded) {
+						impl.entriesRejected.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+
+				impl.open = true;
+				return NativeSuccess;
+			}
+
+			int32 WaveformCacheCore::Close() {
+
+				if (_impl == nullptr) {
+					return NativeSuccess;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.mutex);
+
+				if (!impl.open) {
+					return NativeSuccess;
+				}
+
+				if (impl.acquired > 0) {
+					return NativeErrorInvalidState;
+				}
+
+				int32 status = NativeSuccess;
+
+				if (!impl.path.empty()) {
+					try {
+						status = impl.SaveLocked();
+					}
+					catch (const std::bad_alloc&) {
+						status = NativeErrorOutOfMemory;
+					}
+				}
+
+				impl.DropAll();
+				impl.CloseFile();
+				impl.open = false;
+				return status;
+			}
+
+			bool WaveformCacheCore::IsOpen() const {
+				if (_impl == nullptr) {
+					return false;
+				}
+				std::lock_guard<std::mutex> lock(_impl->mutex);
+				return _impl->open;
+			}
+
+			int32 WaveformCacheCore::Acquire(const WaveformStimulus& stimulus, WaveformCacheEntry* entry) {
+
+				if (_impl == nullptr) {
+					return NativeErrorInvalidState;
+				}
+
+				if (entry == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::vector<uint8_t> form;
+				int32 status;
+
+				try {
+					status = BuildForm(stimulus, form);
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				if (status != NativeSuccess) {
+					return status;
+				}
+
+				const WaveformCacheKey key = HashBytes(form.data(), form.size());
+
+				{
+					std::lock_guard<std::mutex> lock(impl.mutex);
+
+					if (!impl.open) {
+						return NativeErrorInvalidState;
+					}
+
+					auto found = impl.index.find(key);
+					if (found != impl.index.end() && found->second->form == form) {
+						impl.lru.splice(impl.lru.begin(), impl.lru, found->second);
+						impl.Hand(*found->second, entry);
+						impl.hits.fetch_add(1, std::memory_order_relaxed);
+						return NativeSuccess;
+					}
+				}
+
+				impl.misses.fetch_add(1, std::memory_order_relaxed);
+
+				// Render outside the index lock, so that hits are served meanwhile.
+				const size_t bytes = (size_t)stimulus.channels * stimulus.samplesPerChannel * sizeof(int16);
+				int16* block = static_cast<int16*>(AlignedAlloc(bytes));
+
+				if (block == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				status = impl.Render(stimulus, block);
+
+				if (status != NativeSuccess) {
+					AlignedFree(block);
+					return status;
+				}
+
+				std::lock_guard<std::mutex> lock(impl.mutex);
+
+				if (!impl.open) {
+					AlignedFree(block);
+					return NativeErrorInvalidState;
+				}
+
+				try {
+					auto found = impl.index.find(key);
+
+					// Rendered by another thread meanwhile.
+					if (found != impl.index.end() && found->second->form == form) {
+						AlignedFree(block);
+						impl.lru.splice(impl.lru.begin(), impl.lru, found->second);
+						impl.Hand(*found->second, entry);
+						return NativeSuccess;
+					}
+
+					Entry* e;
+
+					if (found == impl.index.end() && impl.MakeRoom(bytes)) {
+						impl.lru.emplace_front();
+						e = &impl.lru.front();
+						impl.index.emplace(key, impl.lru.begin());
+						impl.usedBytes += bytes;
+					}
+					else {
+						e = new Entry();
+						e->detached = true;
+						impl.uncached.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					e->key = key;
+					e->form.swap(form);
+					e->heap = block;
+					e->data = block;
+					e->bytes = bytes;
+					e->channels = stimulus.channels;
+					e->samplesPerChannel = stimulus.samplesPerChannel;
+					e->fillMode = stimulus.fillMode;
+
+					impl.Hand(*e, entry);
+					impl.Publish();
+				}
+				catch (const std::bad_alloc&) {
+					AlignedFree(block);
+					return NativeErrorOutOfMemory;
+				}
+
+				return NativeSuccess;
+			}
+
+			void WaveformCacheCore::Release(WaveformCacheEntry* entry) {
+
+				if (_impl == nullptr || entry == nullptr || entry->token == nullptr) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+				Entry* e = static_cast<Entry*>(entry->token);
+
+				{
+					std::lock_guard<std::mutex> lock(impl.mutex);
+					impl.acquired--;
+
+					if (!e->detached) {
+						e->refs--;
+						e = nullptr;
+					}
+				}
+
+				delete e;
+				entry->token = nullptr;
+				entry->data = nullptr;
+			}
+
+			int32 WaveformCacheCore::WriteToTask(TaskHandle task, const WaveformStimulus& stimulus,
+				bool32 autoStart, float64 timeout, int32* written) {
+
+				WaveformCacheEntry entry;
+				int32 status = Acquire(stimulus, &entry);
+
+				if (status != NativeSuccess) {
+					return status;
+				}
+
+				int32 samples = 0;
+				status = DAQmxWriteBinaryI16(task, (int32)entry.samplesPerChannel, autoStart, timeout,
+					entry.fillMode, entry.data, &samples, NULL);
+
+				Release(&entry);
+
+				if (written != nullptr) {
+					*written = samples;
+				}
+				return status;
+			}
+
+			int32 WaveformCacheCore::Save() {
+
+				if (_impl == nullptr) {
+					return NativeErrorInvalidState;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.mutex);
+
+				if (!impl.open || impl.path.empty() || impl.acquired > 0) {
+					return NativeErrorInvalidState;
+				}
+
+				try {
+					return impl.SaveLocked();
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+			}
+
+			void WaveformCacheCore::Clear() {
+
+				if (_impl == nullptr) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.mutex);
+
+				for (auto it = impl.lru.begin(); it != impl.lru.end();) {
+					auto next = std::next(it);
+					if (it->refs == 0) {
+						impl.Erase(it);
+					}
+					it = next;
+				}
+				impl.Publish();
+			}
+
+			WaveformCacheCounters WaveformCacheCore::Counters() const {
+
+				WaveformCacheCounters counters = {};
+
+				if (_impl != nullptr) {
+					counters.hits = _impl->hits.load(std::memory_order_relaxed);
+					counters.misses = _impl->misses.load(std::memory_order_relaxed);
+					counters.evictions = _impl->evictions.load(std::memory_order_relaxed);
+					counters.uncached = _impl->uncached.load(std::memory_order_relaxed);
+					counters.entriesLoaded = _impl->entriesLoaded.load(std::memory_order_relaxed);
+					counters.entriesRejected = _impl->entriesRejected.load(std::memory_order_relaxed);
+					counters.entries = _impl->entryCount.load(std::memory_order_relaxed);
+					counters.bytes = _impl->bytes.load(std::memory_order_relaxed);
+				}
+				return counters;
+			}
+
+			int32 WaveformCacheCore::ComputeKey(const WaveformStimulus& stimulus, WaveformCacheKey* key) {
+
+				if (key == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				try {
+					std::vector<uint8_t> form;
+					const int32 status = BuildForm(stimulus, form);
+
+					if (status == NativeSuccess) {
+						*key = HashBytes(form.data(), form.size());
+					}
+					return status;
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,261 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the waveform cache. Safe to include from code compiled with
+* /clr; the index, the LRU list and the cache file live in
+* WaveformCacheCore.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "WaveformGeneratorCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief One channel of a cached stimulus: its waveform and the
+			*        conversion of its volts to device codes.
+			*/
+			struct WaveformStimulusChannel {
+
+				WaveformChannel waveform;
+
+				/** Code scaling, `round(c0 + c1 * volts)`; e.g. the AO device
+				*   scaling coefficients of the channel. */
+				float64 c0;
+				float64 c1;
+
+				/** Tones of a `MultiTone` channel; ignored for other shapes. */
+				const WaveformTone* tones;
+				uInt32 toneCount;
+
+				/** Cycle of a `Table` channel; ignored for other shapes. */
+				const float64* table;
+				uInt32 tableSize;
+			};
+
+			/**
+			* @brief A finite stimulus: `samplesPerChannel` samples of every
+			*        channel, rendered from the start phase of each waveform.
+			*/
+			struct WaveformStimulus {
+
+				uInt32 channels;
+
+				/** Sample clock rate of the output task, in Hz. */
+				float64 sampleRate;
+
+				/** Layout of the block. */
+				int32 fillMode;
+
+				uInt32 samplesPerChannel;
+
+				/** `channels` entries. */
+				const WaveformStimulusChannel* channelSettings;
+			};
+
+			/**
+			* @brief 128-bit hash of the canonical form of a stimulus.
+			*/
+			struct WaveformCacheKey {
+				uInt64 high;
+				uInt64 low;
+			};
+
+			/**
+			* @brief A block handed out by `WaveformCacheCore::Acquire`. It stays
+			*        valid, and is never evicted, until it is released.
+			*/
+			struct WaveformCacheEntry {
+
+				/** `channels * samplesPerChannel` device codes in `fillMode`
+				*   layout, as taken by `DAQmxWriteBinaryI16`. */
+				const int16* data;
+
+				uInt32 channels;
+				uInt32 samplesPerChannel;
+				int32 fillMode;
+
+				WaveformCacheKey key;
+
+				/** Owned by the cache. */
+				void* token;
+			};
+
+			/**
+			* @brief Settings of a `WaveformCacheCore`.
+			*/
+			struct WaveformCacheConfig {
+
+				/** Most bytes of sample blocks held, in memory or mapped from
+				*   the cache file. */
+				uInt64 memoryCapBytes;
+			};
+
+			inline WaveformCacheConfig DefaultWaveformCacheConfig() {
+
+				WaveformCacheConfig config;
+				config.memoryCapBytes = 256ull << 20;
+				return config;
+			}
+
+			/**
+			* @brief Counters of the cache. Read without locking.
+			*/
+			struct WaveformCacheCounters {
+				uInt64 hits;
+				uInt64 misses;
+				/** Entries dropped to stay under the memory cap. */
+				uInt64 evictions;
+				/** Blocks rendered but not kept: larger than the cap, or no
+				*   room left beside the acquired entries. */
+				uInt64 uncached;
+				/** Entries taken from the cache file at `Open`. */
+				uInt64 entriesLoaded;
+				/** Entries of the cache file dropped as damaged; the whole file
+				*   counts as one if its header or index is. */
+				uInt64 entriesRejected;
+				uInt64 entries;
+				uInt64 bytes;
+			};
+
+			/**
+			* @brief Keeps pre-rendered, pre-scaled I16 blocks of repeated analog
+			*        output stimuli, so that a stimulus played again goes to
+			*        `DAQmxWriteBinaryI16` without being synthesized or scaled.
+			*
+			* Entries are keyed by the canonical form of the stimulus: the
+			* layout, the sample rate, and per channel the parameters that
+			* matter for its shape, the code scaling, and the tones or the
+			* table. The form is kept with the entry and compared on every hit,
+			* so the key only selects the slot. A miss renders the block with a
+			* `WaveformGeneratorCore` outside the index lock.
+			*
+			* The cache holds at most `memoryCapBytes` of blocks and evicts the
+			* least recently used entries that are not acquired. A block that
+			* cannot fit is still rendered and handed out, then freed on
+			* release.
+			*
+			* With a path, the cache persists across runs: `Save` (and `Close`)
+			* writes every entry, most recently used first, to a new file that
+			* replaces the old one, and maps it read-only; `Open` maps an
+			* existing file and serves its entries straight from the mapping.
+			* Every entry carries a hash of its samples, checked at `Open`.
+			*
+			* All methods may be called from any thread. `Save` and `Close`
+			* require every entry to be released.
+			*/
+			class WaveformCacheCore {
+
+			public:
+				WaveformCacheCore();
+				~WaveformCacheCore();
+
+				WaveformCacheCore(const WaveformCacheCore&) = delete;
+				WaveformCacheCore& operator=(const WaveformCacheCore&) = delete;
+
+				/**
+				* @brief Opens the cache, loading the entries of `path` that fit
+				*        the cap. A missing, foreign or damaged file is not an
+				*        error; it is replaced at the next `Save`.
+				*
+				* @param[in] path UTF-8 path of the cache file, or `nullptr`
+				*            (or empty) for a cache held in memory only.
+				*
+				* @return `0`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorAlreadyRunning` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Open(const char* path, const WaveformCacheConfig& config);
+
+				/**
+				* @brief Saves the cache if it has a path, then drops every entry.
+				*
+				* @return `0`, `NativeErrorInvalidState` if an entry is still
+				*         acquired (nothing is closed), or `NativeErrorFileIo`
+				*         (the cache is closed anyway).
+				*/
+				int32 Close();
+
+				bool IsOpen() const;
+
+				/**
+				* @brief Returns the block of `stimulus`, rendering it on a miss.
+				*
+				* @param[out] entry Valid until passed to `Release`.
+				*
+				* @return `0`, `NativeErrorInvalidState`,
+				*         `NativeErrorInvalidArgument` for a stimulus the
+				*         generator rejects, or `NativeErrorOutOfMemory`.
+				*/
+				int32 Acquire(const WaveformStimulus& stimulus, WaveformCacheEntry* entry);
+
+				/**
+				* @brief Returns an entry; its block may be evicted from now on.
+				*/
+				void Release(WaveformCacheEntry* entry);
+
+				/**
+				* @brief Writes the block of `stimulus` to an analog output task
+				*        with `DAQmxWriteBinaryI16`.
+				*
+				* @param[out] written Samples per channel written; may be `nullptr`.
+				*
+				* @return A DAQmx status or a status of `Acquire`.
+				*/
+				int32 WriteToTask(TaskHandle task, const WaveformStimulus& stimulus,
+					bool32 autoStart, float64 timeout, int32* written);
+
+				/**
+				* @brief Writes every entry to the cache file and serves them
+				*        from its mapping from now on.
+				*
+				* @return `0`, `NativeErrorInvalidState` if the cache is closed,
+				*         has no path or has acquired entries, or
+				*         `NativeErrorFileIo`.
+				*/
+				int32 Save();
+
+				/**
+				* @brief Drops every entry that is not acquired.
+				*/
+				void Clear();
+
+				WaveformCacheCounters Counters() const;
+
+				/**
+				* @brief Computes the key of a stimulus, as `Acquire` does.
+				*
+				* @return `0` or `NativeErrorInvalidArgument`.
+				*/
+				static int32 ComputeKey(const WaveformStimulus& stimulus, WaveformCacheKey* key);
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,510 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveformGeneratorCore.h"
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "AlignedMemory.h"
+#include "NativeStatus.h"
+#include "TransposeKernels.h"
+#include "WaveformKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Samples per channel synthesized at a time; the scratch rows
+				// of all channels stay in the L1 cache for a few channels.
+				const uInt32 RenderChunk = 256;
+
+				bool IsFinite(float64 v) {
+					return std::isfinite(v);
+				}
+
+				// What the setters change.
+				struct ChannelSettings {
+					WaveformChannel waveform;
+					std::vector<WaveformTone> tones;
+					// One cycle plus the first point again, for RenderTable.
+					std::vector<float64> table;
+					float64 c0;
+					float64 c1;
+					bool changed;
+					bool tonesChanged;
+					bool tableChanged;
+				};
+
+				struct ChannelState {
+					ChannelSettings settings;
+					float64 phase;
+					std::vector<float64> tonePhases;
+					// Samples into the current chirp sweep.
+					uInt64 sweepPosition;
+				};
+
+				void Restart(ChannelState& state) {
+
+					state.phase = WrapPhase(state.settings.waveform.phase);
+					state.sweepPosition = 0;
+					state.tonePhases.resize(state.settings.tones.size());
+
+					for (size_t k = 0; k < state.settings.tones.size(); k++) {
+						state.tonePhases[k] = WrapPhase(state.settings.tones[k].phase);
+					}
+				}
+			}
+
+			struct WaveformGeneratorCore::Impl {
+
+				WaveformGeneratorConfig config;
+				bool configured;
+				size_t sampleBytes;
+
+				std::vector<ChannelState> channels;
+				uInt64 position;
+
+				// Rows of `RenderChunk` samples per channel.
+				float64* synthesis;
+				void* converted;
+
+				std::mutex pendingMutex;
+				std::vector<ChannelSettings> pending;
+				std::atomic<bool> dirty;
+
+				Impl() :
+					config(DefaultWaveformGeneratorConfig()), configured(false), sampleBytes(0),
+					position(0), synthesis(nullptr), converted(nullptr), dirty(false) {}
+
+				~Impl() {
+					Free();
+				}
+
+				void Free() {
+					AlignedFree(synthesis);
+					AlignedFree(converted);
+					synthesis = nullptr;
+					converted = nullptr;
+				}
+
+				// Takes over the settings changed since the last block.
+				void ApplyPending() {
+
+					std::lock_guard<std::mutex> lock(pendingMutex);
+
+					for (size_t ch = 0; ch < channels.size(); ch++) {
+
+						ChannelSettings& next = pending[ch];
+
+						if (!next.changed) {
+							continue;
+						}
+
+						ChannelState& state = channels[ch];
+						const bool restart = next.waveform.shape != state.settings.waveform.shape;
+
+						state.settings.waveform = next.waveform;
+						state.settings.c0 = next.c0;
+						state.settings.c1 = next.c1;
+
+						if (next.tableChanged) {
+							state.settings.table = next.table;
+						}
+
+						if (next.tonesChanged) {
+							state.settings.tones = next.tones;
+							state.tonePhases.resize(next.tones.size());
+							for (size_t k = 0; k < next.tones.size(); k++) {
+								state.tonePhases[k] = WrapPhase(next.tones[k].phase);
+							}
+						}
+
+						if (restart) {
+							Restart(state);
+						}
+
+						next.changed = false;
+						next.tonesChanged = false;
+						next.tableChanged = false;
+					}
+
+					dirty.store(false, std::memory_order_relaxed);
+				}
+
+				void Synthesize(ChannelState& state, float64* row, uInt32 count) {
+
+					const WaveformChannel& w = state.settings.waveform;
+					const float64 rate = config.sampleRate;
+					const float64 step = w.frequency / rate;
+
+					switch (w.shape) {
+					case WaveformShape::Sine:
+						RenderSine(row, count, state.phase, step, w.amplitude, w.offset);
+						break;
+					case WaveformShape::Square:
+						RenderSquare(row, count, state.phase, step, w.amplitude, w.offset, w.dutyCycle);
+						break;
+					case WaveformShape::Triangle:
+						RenderTriangle(row, count, state.phase, step, w.amplitude, w.offset);
+						break;
+					case WaveformShape::Table:
+						if (state.settings.table.size() < 2) {
+							for (uInt32 i = 0; i < count; i++) {
+								row[i] = w.offset;
+							}
+						}
+						else {
+							RenderTable(row, count, state.phase, step, state.settings.table.data(),
+								(uInt32)state.settings.table.size() - 1, w.amplitude, w.offset);
+						}
+						break;
+					case WaveformShape::MultiTone:
+						for (uInt32 i = 0; i < count; i++) {
+							row[i] = w.offset;
+						}
+						for (size_t k = 0; k < state.settings.tones.size(); k++) {
+							const WaveformTone& tone = state.settings.tones[k];
+							const float64 toneStep = tone.frequency / rate;
+							AddSine(row, count, state.tonePhases[k], toneStep, w.amplitude * tone.amplitude);
+							state.tonePhases[k] = WrapPhase(state.tonePhases[k] + count * toneStep);
+						}
+						return;
+					case WaveformShape::Chirp:
+						SynthesizeChirp(state, row, count);
+						return;
+					}
+
+					state.phase = WrapPhase(state.phase + count * step);
+				}
+
+				void SynthesizeChirp(ChannelState& state, float64* row, uInt32 count) {
+
+					const WaveformChannel& w = state.settings.waveform;
+					const float64 rate = config.sampleRate;
+					const float64 sweep = std::floor(w.sweepSeconds * rate + 0.5);
+					const uInt64 sweepSamples = (sweep < 1.0) ? 1 : (uInt64)sweep;
+					const float64 increment = (w.stopFrequency - w.frequency) / rate / (float64)sweepSamples;
+
+					if (state.sweepPosition >= sweepSamples) {
+						state.sweepPosition = 0;
+					}
+
+					uInt32 done = 0;
+
+					while (done < count) {
+
+						const uInt64 left = sweepSamples - state.sweepPosition;
+						const uInt32 n = (uInt32)((left < count - done) ? left : count - done);
+						const float64 step = w.frequency / rate + (float64)state.sweepPosition * increment;
+
+						RenderChirp(row + done, n, state.phase, step, increment, w.amplitude, w.offset);
+
+						state.phase = WrapPhase(state.phase + n * (step + 0.5 * increment * (n - 1.0)));
+						state.sweepPosition += n;
+						if (state.sweepPosition == sweepSamples) {
+							state.sweepPosition = 0;
+						}
+						done += n;
+					}
+				}
+			};
+
+			WaveformGeneratorCore::WaveformGeneratorCore() :
+				_impl(new (std::nothrow) Impl()) {}
+
+			WaveformGeneratorCore::~WaveformGeneratorCore() {
+				delete _impl;
+				_impl = nullptr;
+			}
+
+			int32 WaveformGeneratorCore::Configure(const WaveformGeneratorConfig& config) {
+
+				if (_impl == nullptr) {
+					return NativeErrorOutOfMemory;
+				}
+
+				const size_t sampleBytes = SampleSize(config.format);
+
+				if (sampleBytes == 0) {
+					return NativeErrorUnsupportedFormat;
+				}
+
+				if (config.channels == 0 || !(config.sampleRate > 0.0) || !IsFinite(config.sampleRate)
+					|| (config.fillMode != DAQmx_Val_GroupByChannel
+						&& config.fillMode != DAQmx_Val_GroupByScanNumber)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				impl.configured = false;
+				impl.config = config;
+				impl.sampleBytes = sampleBytes;
+
+				impl.Free();
+				impl.synthesis = static_cast<float64*>(AlignedAlloc(
+					(size_t)config.channels * RenderChunk * sizeof(float64)));
+				impl.converted = AlignedAlloc((size_t)config.channels * RenderChunk * sampleBytes);
+
+				if (impl.synthesis == nullptr || impl.converted == nullptr) {
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				ChannelSettings defaults;
+				defaults.waveform = DefaultWaveformChannel();
+				defaults.c0 = 0.0;
+				defaults.c1 = 1.0;
+				defaults.changed = false;
+				defaults.tonesChanged = false;
+				defaults.tableChanged = false;
+
+				try {
+					std::lock_guard<std::mutex> lock(impl.pendingMutex);
+					impl.pending.assign(config.channels, defaults);
+					impl.channels.assign(config.channels, ChannelState());
+					for (ChannelState& state : impl.channels) {
+						state.settings = defaults;
+					}
+				}
+				catch (const std::bad_alloc&) {
+					impl.Free();
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.dirty.store(false);
+				impl.configured = true;
+				Reset();
+				return NativeSuccess;
+			}
+
+			bool WaveformGeneratorCore::IsConfigured() const {
+				return _impl != nullptr && _impl->configured;
+			}
+
+			const WaveformGeneratorConfig& WaveformGeneratorCore::Config() const {
+				return _impl->config;
+			}
+
+			int32 WaveformGeneratorCore::SetChannel(uInt32 channel, const WaveformChannel& waveform) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->config.channels
+					|| (int32)waveform.shape < (int32)WaveformShape::Sine
+					|| (int32)waveform.shape > (int32)WaveformShape::Table
+					|| !IsFinite(waveform.frequency) || !IsFinite(waveform.amplitude)
+					|| !IsFinite(waveform.offset) || !IsFinite(waveform.phase)
+					|| !(waveform.dutyCycle >= 0.0 && waveform.dutyCycle <= 1.0)
+					|| !IsFinite(waveform.stopFrequency)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				if (waveform.shape == WaveformShape::Chirp
+					&& !(waveform.sweepSeconds > 0.0 && IsFinite(waveform.sweepSeconds))) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.pendingMutex);
+				impl.pending[channel].waveform = waveform;
+				impl.pending[channel].changed = true;
+				impl.dirty.store(true, std::memory_order_release);
+				return NativeSuccess;
+			}
+
+			int32 WaveformGeneratorCore::SetTones(uInt32 channel, const WaveformTone* tones,
+				uInt32 count) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->config.channels || count > MaxWaveformTones
+					|| (tones == nullptr && count > 0)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				for (uInt32 k = 0; k < count; k++) {
+					if (!IsFinite(tones[k].frequency) || !IsFinite(tones[k].amplitude)
+						|| !IsFinite(tones[k].phase)) {
+						return NativeErrorInvalidArgument;
+					}
+				}
+
+				Impl& impl = *_impl;
+
+				try {
+					std::lock_guard<std::mutex> lock(impl.pendingMutex);
+					impl.pending[channel].tones.assign(tones, tones + count);
+					impl.pending[channel].changed = true;
+					impl.pending[channel].tonesChanged = true;
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.dirty.store(true, std::memory_order_release);
+				return NativeSuccess;
+			}
+
+			int32 WaveformGeneratorCore::SetTable(uInt32 channel, const float64* table, uInt32 size) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->config.channels || table == nullptr
+					|| size == 0 || size > MaxWaveformTableSize) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+
+				try {
+					std::vector<float64> points(table, table + size);
+					points.push_back(table[0]);
+
+					std::lock_guard<std::mutex> lock(impl.pendingMutex);
+					impl.pending[channel].table.swap(points);
+					impl.pending[channel].changed = true;
+					impl.pending[channel].tableChanged = true;
+				}
+				catch (const std::bad_alloc&) {
+					return NativeErrorOutOfMemory;
+				}
+
+				impl.dirty.store(true, std::memory_order_release);
+				return NativeSuccess;
+			}
+
+			int32 WaveformGeneratorCore::SetCodeScaling(uInt32 channel, float64 c0, float64 c1) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				if (channel >= _impl->config.channels || !IsFinite(c0) || !IsFinite(c1)) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+				std::lock_guard<std::mutex> lock(impl.pendingMutex);
+				impl.pending[channel].c0 = c0;
+				impl.pending[channel].c1 = c1;
+				impl.pending[channel].changed = true;
+				impl.dirty.store(true, std::memory_order_release);
+				return NativeSuccess;
+			}
+
+			int32 WaveformGeneratorCore::Render(void* block, uInt32 samplesPerChannel) {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return NativeErrorInvalidState;
+				}
+
+				if (block == nullptr) {
+					return NativeErrorInvalidArgument;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.dirty.load(std::memory_order_acquire)) {
+					impl.ApplyPending();
+				}
+
+				const uInt32 channels = impl.config.channels;
+				const size_t sampleBytes = impl.sampleBytes;
+				const SampleFormat format = impl.config.format;
+				const bool byChannel = impl.config.fillMode == DAQmx_Val_GroupByChannel;
+				uint8_t* out = static_cast<uint8_t*>(block);
+
+				for (uInt32 first = 0; first < samplesPerChannel; first += RenderChunk) {
+
+					const uInt32 n = (samplesPerChannel - first < RenderChunk)
+						? samplesPerChannel - first : RenderChunk;
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+
+						ChannelState& state = impl.channels[ch];
+						const size_t target = (size_t)ch * samplesPerChannel + first;
+
+						if (byChannel && format == SampleFormat::Float64) {
+							impl.Synthesize(state, reinterpret_cast<float64*>(out) + target, n);
+							continue;
+						}
+
+						float64* row = impl.synthesis + (size_t)ch * RenderChunk;
+						impl.Synthesize(state, row, n);
+
+						if (format == SampleFormat::Float64) {
+							continue;
+						}
+
+						QuantizeSamples(row, byChannel ? out + target * sampleBytes
+							: static_cast<uint8_t*>(impl.converted) + (size_t)ch * RenderChunk * sampleBytes,
+							n, format, state.settings.c0, state.settings.c1);
+					}
+
+					if (!byChannel) {
+						const void* rows = (format == SampleFormat::Float64)
+							? static_cast<const void*>(impl.synthesis) : impl.converted;
+						TransposeStrided(rows, RenderChunk, out + (size_t)first * channels * sampleBytes,
+							channels, channels, n, sampleBytes);
+					}
+				}
+
+				impl.position += samplesPerChannel;
+				return NativeSuccess;
+			}
+
+			void WaveformGeneratorCore::Reset() {
+
+				if (_impl == nullptr || !_impl->configured) {
+					return;
+				}
+
+				Impl& impl = *_impl;
+
+				if (impl.dirty.load(std::memory_order_acquire)) {
+					impl.ApplyPending();
+				}
+
+				for (ChannelState& state : impl.channels) {
+					Restart(state);
+				}
+				impl.position = 0;
+			}
+
+			uInt64 WaveformGeneratorCore::Position() const {
+				return (_impl != nullptr) ? _impl->position : 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,241 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Facade of the waveform generator. Safe to include from code compiled with
+* /clr; the channel states and the render loop live in
+* WaveformGeneratorCore.cpp, the kernels in WaveformKernels.cpp.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			enum class WaveformShape : int32 {
+				Sine = 0,
+				Square = 1,
+				Triangle = 2,
+				/** Linear sweep from `frequency` to `stopFrequency` over
+				*   `sweepSeconds`, then again from `frequency`. */
+				Chirp = 3,
+				/** Sum of the tones set with `SetTones`. */
+				MultiTone = 4,
+				/** The table set with `SetTable`, `frequency` cycles per second. */
+				Table = 5
+			};
+
+			/** Most tones of one multi-tone channel. */
+			const uInt32 MaxWaveformTones = 64;
+
+			/** Most points of one table. */
+			const uInt32 MaxWaveformTableSize = 1u << 24;
+
+			/**
+			* @brief Waveform of one channel.
+			*/
+			struct WaveformChannel {
+
+				WaveformShape shape;
+
+				/** In Hz; start frequency of a chirp. */
+				float64 frequency;
+
+				/** Peak amplitude, in volts; scales the tones and the table. */
+				float64 amplitude;
+
+				float64 offset;
+
+				/** Phase in cycles at `Reset` and when the shape changes. */
+				float64 phase;
+
+				/** Fraction of a square cycle spent high, 0 to 1. */
+				float64 dutyCycle;
+
+				/** End frequency of a chirp, in Hz. */
+				float64 stopFrequency;
+
+				/** Duration of one chirp sweep, in seconds. */
+				float64 sweepSeconds;
+			};
+
+			inline WaveformChannel DefaultWaveformChannel() {
+
+				WaveformChannel channel;
+				channel.shape = WaveformShape::Sine;
+				channel.frequency = 1000.0;
+				channel.amplitude = 1.0;
+				channel.offset = 0.0;
+				channel.phase = 0.0;
+				channel.dutyCycle = 0.5;
+				channel.stopFrequency = 10000.0;
+				channel.sweepSeconds = 1.0;
+				return channel;
+			}
+
+			/**
+			* @brief One tone of a multi-tone channel.
+			*/
+			struct WaveformTone {
+				float64 frequency;
+				/** Relative to the amplitude of the channel. */
+				float64 amplitude;
+				/** Phase in cycles when the tones are set. */
+				float64 phase;
+			};
+
+			/**
+			* @brief Settings of a `WaveformGeneratorCore`.
+			*/
+			struct WaveformGeneratorConfig {
+
+				uInt32 channels;
+
+				/** Sample clock rate of the output task, in Hz. */
+				float64 sampleRate;
+
+				/** Format of the rendered blocks; integer formats are device
+				*   codes, see `SetCodeScaling`. */
+				SampleFormat format;
+
+				/** Layout of the rendered blocks. */
+				int32 fillMode;
+			};
+
+			inline WaveformGeneratorConfig DefaultWaveformGeneratorConfig() {
+
+				WaveformGeneratorConfig config;
+				config.channels = 1;
+				config.sampleRate = 100000.0;
+				config.format = SampleFormat::Float64;
+				config.fillMode = DAQmx_Val_GroupByChannel;
+				return config;
+			}
+
+			/**
+			* @brief Renders periodic and swept waveforms straight into output
+			*        blocks in the device format.
+			*
+			* Every channel has its own shape, frequency, amplitude and offset.
+			* The phase of every channel carries over from one block to the
+			* next, whatever the block sizes, so a stream rendered block by
+			* block equals one rendered at once. A new frequency or amplitude
+			* takes effect at the next block without a phase jump; only a new
+			* shape restarts the channel at its `phase`.
+			*
+			* Blocks are rendered in chunks that stay in the L1 cache: each
+			* channel is synthesized by the SIMD kernels of WaveformKernels.h,
+			* then converted to the device format and, for blocks grouped by
+			* scan, interleaved by the transpose kernels. `Float64` blocks
+			* grouped by channel are synthesized in place.
+			*
+			* `Render` runs on one thread. The setters may be called from any
+			* thread, also while it renders; their changes are picked up at the
+			* start of the next `Render`. `Configure` and `Reset` must not run
+			* concurrently with `Render`.
+			*/
+			class WaveformGeneratorCore {
+
+			public:
+				WaveformGeneratorCore();
+				~WaveformGeneratorCore();
+
+				WaveformGeneratorCore(const WaveformGeneratorCore&) = delete;
+				WaveformGeneratorCore& operator=(const WaveformGeneratorCore&) = delete;
+
+				/**
+				* @brief Allocates the scratch buffers and sets every channel to
+				*        `DefaultWaveformChannel` with unit code scaling.
+				*
+				* @return `0`, `NativeErrorInvalidArgument`,
+				*         `NativeErrorUnsupportedFormat` or `NativeErrorOutOfMemory`.
+				*/
+				int32 Configure(const WaveformGeneratorConfig& config);
+
+				bool IsConfigured() const;
+
+				const WaveformGeneratorConfig& Config() const;
+
+				/**
+				* @brief Sets the waveform of one channel.
+				*
+				* @return `0` or `NativeErrorInvalidArgument` for a bad channel,
+				*         a non-finite value, a duty cycle outside 0 to 1 or a
+				*         chirp without a positive sweep time.
+				*/
+				int32 SetChannel(uInt32 channel, const WaveformChannel& waveform);
+
+				/**
+				* @brief Sets the tones of a multi-tone channel; their phases
+				*        restart.
+				*/
+				int32 SetTones(uInt32 channel, const WaveformTone* tones, uInt32 count);
+
+				/**
+				* @brief Copies one cycle of an arbitrary waveform, played with
+				*        linear interpolation.
+				*
+				* @param[in] size Points, 1 to `MaxWaveformTableSize`.
+				*/
+				int32 SetTable(uInt32 channel, const float64* table, uInt32 size);
+
+				/**
+				* @brief Sets the conversion to integer device codes,
+				*        `round(c0 + c1 * volts)`, saturated; e.g. the AO device
+				*        scaling coefficients. Ignored for `Float64`.
+				*/
+				int32 SetCodeScaling(uInt32 channel, float64 c0, float64 c1);
+
+				/**
+				* @brief Renders the next `samplesPerChannel` samples of every
+				*        channel.
+				*
+				* @param[out] block `channels * samplesPerChannel` samples of
+				*             `format`, in `fillMode` layout.
+				*
+				* @return `0`, `NativeErrorInvalidState` or
+				*         `NativeErrorInvalidArgument`.
+				*/
+				int32 Render(void* block, uInt32 samplesPerChannel);
+
+				/**
+				* @brief Restarts every channel at its phase and every chirp at
+				*        its start frequency.
+				*/
+				void Reset();
+
+				/**
+				* @brief Samples per channel rendered since the last reset.
+				*/
+				uInt64 Position() const;
+
+			private:
+				struct Impl;
+				Impl* _impl;
+			};
+		}
+	}
+}
@@ -0,0 +1,515 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveformKernels.h"
+
+#include <cmath>
+
+#include "CpuFeatures.h"
+
+#if NATIVE_X86
+#include <immintrin.h>
+#endif
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			namespace {
+
+				// Taylor coefficients of sin(2 pi r) in odd powers of r; with
+				// |r| <= 1/4 the first omitted term is below 2e-18.
+				const uInt32 SineOrder = 11;
+				const float64 SineCoeffs[SineOrder] = {
+					6.2831853071795862,
+					-41.341702240399755,
+					81.605249276075043,
+					-76.705859753061361,
+					42.058693944897634,
+					-15.094642576822984,
+					3.8199525848482803,
+					-0.71812230177850012,
+					0.10422916220813978,
+					-0.012031585942120619,
+					0.0011309237482517954
+				};
+
+				inline float64 SinCycles(float64 x) {
+
+					float64 r = x - std::nearbyint(x);
+					if (r > 0.25) {
+						r = 0.5 - r;
+					}
+					else if (r < -0.25) {
+						r = -0.5 - r;
+					}
+
+					const float64 z = r * r;
+					float64 y = SineCoeffs[SineOrder - 1];
+					for (uInt32 k = SineOrder - 1; k-- > 0;) {
+						y = y * z + SineCoeffs[k];
+					}
+					return y * r;
+				}
+
+				inline float64 Fraction(float64 x) {
+					return x - std::floor(x);
+				}
+
+				// Shapes evaluate one sample from its phase in cycles; the
+				// vector variants do the same for 2 or 4 phases.
+				struct SineShape {
+
+					float64 amplitude;
+					float64 offset;
+
+					float64 Scalar(float64 x) const {
+						return offset + amplitude * SinCycles(x);
+					}
+
+#if NATIVE_X86
+					NATIVE_TARGET_AVX2 __m256d Avx2(__m256d x) const;
+					NATIVE_TARGET_SSE41 __m128d Sse41(__m128d x) const;
+#endif
+				};
+
+				struct SquareShape {
+
+					float64 amplitude;
+					float64 offset;
+					float64 dutyCycle;
+
+					float64 Scalar(float64 x) const {
+						return (Fraction(x) < dutyCycle) ? offset + amplitude : offset - amplitude;
+					}
+
+#if NATIVE_X86
+					NATIVE_TARGET_AVX2 __m256d Avx2(__m256d x) const;
+					NATIVE_TARGET_SSE41 __m128d Sse41(__m128d x) const;
+#endif
+				};
+
+				struct TriangleShape {
+
+					float64 amplitude;
+					float64 offset;
+
+					float64 Scalar(float64 x) const {
+						const float64 r = Fraction(x + 0.25);
+						return offset + amplitude * (1.0 - 4.0 * std::fabs(r - 0.5));
+					}
+
+#if NATIVE_X86
+					NATIVE_TARGET_AVX2 __m256d Avx2(__m256d x) const;
+					NATIVE_TARGET_SSE41 __m128d Sse41(__m128d x) const;
+#endif
+				};
+
+				struct TableShape {
+
+					const float64* table;
+					uInt32 size;
+					float64 amplitude;
+					float64 offset;
+
+					float64 Scalar(float64 x) const {
+
+						const float64 position = Fraction(x) * size;
+						uInt32 k = (uInt32)position;
+						if (k >= size) {
+							k = size - 1;
+						}
+						const float64 t = position - k;
+						return offset + amplitude * (table[k] + t * (table[k + 1] - table[k]));
+					}
+
+#if NATIVE_X86
+					NATIVE_TARGET_AVX2 __m256d Avx2(__m256d x) const;
+					NATIVE_TARGET_SSE41 __m128d Sse41(__m128d x) const;
+#endif
+				};
+
+				// Phase of sample `i`: phase + i * step + i * (i - 1) / 2 * increment.
+				inline float64 PhaseAt(float64 phase, float64 step, float64 increment, float64 i) {
+					return phase + i * (step + 0.5 * increment * (i - 1.0));
+				}
+
+				template <bool Accumulate, typename TShape>
+				void RenderScalar(float64* dst, size_t begin, size_t end, float64 phase,
+					float64 step, float64 increment, const TShape& shape) {
+
+					for (size_t i = begin; i < end; i++) {
+						const float64 v = shape.Scalar(PhaseAt(phase, step, increment, (float64)i));
+						dst[i] = Accumulate ? dst[i] + v : v;
+					}
+				}
+
+#if NATIVE_X86
+				NATIVE_TARGET_AVX2
+				inline __m256d SinCyclesAvx2(__m256d x) {
+
+					__m256d r = _mm256_sub_pd(x,
+						_mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+
+					const __m256d quarter = _mm256_set1_pd(0.25);
+					const __m256d half = _mm256_set1_pd(0.5);
+					r = _mm256_blendv_pd(r, _mm256_sub_pd(half, r),
+						_mm256_cmp_pd(r, quarter, _CMP_GT_OQ));
+					r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_sub_pd(_mm256_setzero_pd(), half), r),
+						_mm256_cmp_pd(r, _mm256_sub_pd(_mm256_setzero_pd(), quarter), _CMP_LT_OQ));
+
+					const __m256d z = _mm256_mul_pd(r, r);
+					__m256d y = _mm256_set1_pd(SineCoeffs[SineOrder - 1]);
+					for (uInt32 k = SineOrder - 1; k-- > 0;) {
+						y = _mm256_add_pd(_mm256_mul_pd(y, z), _mm256_set1_pd(SineCoeffs[k]));
+					}
+					return _mm256_mul_pd(y, r);
+				}
+
+				NATIVE_TARGET_AVX2
+				inline __m256d FractionAvx2(__m256d x) {
+					return _mm256_sub_pd(x, _mm256_floor_pd(x));
+				}
+
+				NATIVE_TARGET_AVX2
+				__m256d SineShape::Avx2(__m256d x) const {
+					return _mm256_add_pd(_mm256_set1_pd(offset),
+						_mm256_mul_pd(_mm256_set1_pd(amplitude), SinCyclesAvx2(x)));
+				}
+
+				NATIVE_TARGET_AVX2
+				__m256d SquareShape::Avx2(__m256d x) const {
+					const __m256d high = _mm256_cmp_pd(FractionAvx2(x), _mm256_set1_pd(dutyCycle), _CMP_LT_OQ);
+					return _mm256_blendv_pd(_mm256_set1_pd(offset - amplitude),
+						_mm256_set1_pd(offset + amplitude), high);
+				}
+
+				NATIVE_TARGET_AVX2
+				__m256d TriangleShape::Avx2(__m256d x) const {
+
+					const __m256d r = _mm256_sub_pd(
+						FractionAvx2(_mm256_add_pd(x, _mm256_set1_pd(0.25))), _mm256_set1_pd(0.5));
+					const __m256d magnitude = _mm256_andnot_pd(_mm256_set1_pd(-0.0), r);
+					const __m256d unit = _mm256_sub_pd(_mm256_set1_pd(1.0),
+						_mm256_mul_pd(_mm256_set1_pd(4.0), magnitude));
+					return _mm256_add_pd(_mm256_set1_pd(offset),
+						_mm256_mul_pd(_mm256_set1_pd(amplitude), unit));
+				}
+
+				NATIVE_TARGET_AVX2
+				__m256d TableShape::Avx2(__m256d x) const {
+
+					const __m256d position = _mm256_mul_pd(FractionAvx2(x), _mm256_set1_pd((float64)size));
+					__m128i k = _mm256_cvttpd_epi32(position);
+					k = _mm_min_epi32(k, _mm_set1_epi32((int)size - 1));
+
+					const __m256d t = _mm256_sub_pd(position, _mm256_cvtepi32_pd(k));
+					const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+					const __m256d a = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, k, all, 8);
+					const __m256d b = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table + 1, k, all, 8);
+					const __m256d v = _mm256_add_pd(a, _mm256_mul_pd(t, _mm256_sub_pd(b, a)));
+					return _mm256_add_pd(_mm256_set1_pd(offset),
+						_mm256_mul_pd(_mm256_set1_pd(amplitude), v));
+				}
+
+				template <bool Accumulate, typename TShape>
+				NATIVE_TARGET_AVX2
+				void RenderAvx2(float64* dst, size_t count, float64 phase, float64 step,
+					float64 increment, const TShape& shape) {
+
+					const __m256d phase4 = _mm256_set1_pd(phase);
+					const __m256d step4 = _mm256_set1_pd(step);
+					const __m256d halfIncrement = _mm256_set1_pd(0.5 * increment);
+					const __m256d one = _mm256_set1_pd(1.0);
+					const __m256d four = _mm256_set1_pd(4.0);
+					__m256d index = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+
+					size_t i = 0;
+					for (; i + 4 <= count; i += 4) {
+
+						const __m256d rate = _mm256_add_pd(step4,
+							_mm256_mul_pd(halfIncrement, _mm256_sub_pd(index, one)));
+						__m256d v = shape.Avx2(_mm256_add_pd(phase4, _mm256_mul_pd(index, rate)));
+
+						if (Accumulate) {
+							v = _mm256_add_pd(v, _mm256_loadu_pd(dst + i));
+						}
+						_mm256_storeu_pd(dst + i, v);
+						index = _mm256_add_pd(index, four);
+					}
+
+					RenderScalar<Accumulate>(dst, i, count, phase, step, increment, shape);
+				}
+
+				NATIVE_TARGET_SSE41
+				inline __m128d SinCyclesSse41(__m128d x) {
+
+					__m128d r = _mm_sub_pd(x,
+						_mm_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+
+					const __m128d quarter = _mm_set1_pd(0.25);
+					const __m128d half = _mm_set1_pd(0.5);
+					r = _mm_blendv_pd(r, _mm_sub_pd(half, r), _mm_cmpgt_pd(r, quarter));
+					r = _mm_blendv_pd(r, _mm_sub_pd(_mm_sub_pd(_mm_setzero_pd(), half), r),
+						_mm_cmplt_pd(r, _mm_sub_pd(_mm_setzero_pd(), quarter)));
+
+					const __m128d z = _mm_mul_pd(r, r);
+					__m128d y = _mm_set1_pd(SineCoeffs[SineOrder - 1]);
+					for (uInt32 k = SineOrder - 1; k-- > 0;) {
+						y = _mm_add_pd(_mm_mul_pd(y, z), _mm_set1_pd(SineCoeffs[k]));
+					}
+					return _mm_mul_pd(y, r);
+				}
+
+				NATIVE_TARGET_SSE41
+				inline __m128d FractionSse41(__m128d x) {
+					return _mm_sub_pd(x, _mm_floor_pd(x));
+				}
+
+				NATIVE_TARGET_SSE41
+				__m128d SineShape::Sse41(__m128d x) const {
+					return _mm_add_pd(_mm_set1_pd(offset),
+						_mm_mul_pd(_mm_set1_pd(amplitude), SinCyclesSse41(x)));
+				}
+
+				NATIVE_TARGET_SSE41
+				__m128d SquareShape::Sse41(__m128d x) const {
+					const __m128d high = _mm_cmplt_pd(FractionSse41(x), _mm_set1_pd(dutyCycle));
+					return _mm_blendv_pd(_mm_set1_pd(offset - amplitude),
+						_mm_set1_pd(offset + amplitude), high);
+				}
+
+				NATIVE_TARGET_SSE41
+				__m128d TriangleShape::Sse41(__m128d x) const {
+
+					const __m128d r = _mm_sub_pd(
+						FractionSse41(_mm_add_pd(x, _mm_set1_pd(0.25))), _mm_set1_pd(0.5));
+					const __m128d magnitude = _mm_andnot_pd(_mm_set1_pd(-0.0), r);
+					const __m128d unit = _mm_sub_pd(_mm_set1_pd(1.0),
+						_mm_mul_pd(_mm_set1_pd(4.0), magnitude));
+					return _mm_add_pd(_mm_set1_pd(offset), _mm_mul_pd(_mm_set1_pd(amplitude), unit));
+				}
+
+				NATIVE_TARGET_SSE41
+				__m128d TableShape::Sse41(__m128d x) const {
+
+					// No gather before AVX2; the interpolation stays vectorized.
+					alignas(16) float64 phases[2];
+					_mm_store_pd(phases, x);
+
+					float64 a[2];
+					float64 b[2];
+					float64 t[2];
+
+					for (int v = 0; v < 2; v++) {
+						const float64 position = Fraction(phases[v]) * size;
+						uInt32 k = (uInt32)position;
+						if (k >= size) {
+							k = size - 1;
+						}
+						a[v] = table[k];
+						b[v] = table[k + 1];
+						t[v] = position - k;
+					}
+
+					const __m128d av = _mm_loadu_pd(a);
+					const __m128d v = _mm_add_pd(av,
+						_mm_mul_pd(_mm_loadu_pd(t), _mm_sub_pd(_mm_loadu_pd(b), av)));
+					return _mm_add_pd(_mm_set1_pd(offset), _mm_mul_pd(_mm_set1_pd(amplitude), v));
+				}
+
+				template <bool Accumulate, typename TShape>
+				NATIVE_TARGET_SSE41
+				void RenderSse41(float64* dst, size_t count, float64 phase, float64 step,
+					float64 increment, const TShape& shape) {
+
+					const __m128d phase2 = _mm_set1_pd(phase);
+					const __m128d step2 = _mm_set1_pd(step);
+					const __m128d halfIncrement = _mm_set1_pd(0.5 * increment);
+					const __m128d one = _mm_set1_pd(1.0);
+					const __m128d two = _mm_set1_pd(2.0);
+					__m128d index = _mm_setr_pd(0.0, 1.0);
+
+					size_t i = 0;
+					for (; i + 2 <= count; i += 2) {
+
+						const __m128d rate = _mm_add_pd(step2,
+							_mm_mul_pd(halfIncrement, _mm_sub_pd(index, one)));
+						__m128d v = shape.Sse41(_mm_add_pd(phase2, _mm_mul_pd(index, rate)));
+
+						if (Accumulate) {
+							v = _mm_add_pd(v, _mm_loadu_pd(dst + i));
+						}
+						_mm_storeu_pd(dst + i, v);
+						index = _mm_add_pd(index, two);
+					}
+
+					RenderScalar<Accumulate>(dst, i, count, phase, step, increment, shape);
+				}
+
+				NATIVE_TARGET_AVX2
+				size_t QuantizeI16Avx2(const float64* src, int16* dst, size_t count,
+					float64 c0, float64 c1) {
+
+					const __m256d offset = _mm256_set1_pd(c0);
+					const __m256d gain = _mm256_set1_pd(c1);
+					const __m256d low = _mm256_set1_pd(-32768.0);
+					const __m256d high = _mm256_set1_pd(32767.0);
+
+					size_t i = 0;
+					for (; i + 8 <= count; i += 8) {
+
+						__m256d v0 = _mm256_add_pd(offset, _mm256_mul_pd(gain, _mm256_loadu_pd(src + i)));
+						__m256d v1 = _mm256_add_pd(offset, _mm256_mul_pd(gain, _mm256_loadu_pd(src + i + 4)));
+						v0 = _mm256_min_pd(_mm256_max_pd(v0, low), high);
+						v1 = _mm256_min_pd(_mm256_max_pd(v1, low), high);
+
+						// Rounds to nearest even, like nearbyint in the default mode.
+						const __m128i codes = _mm_packs_epi32(_mm256_cvtpd_epi32(v0), _mm256_cvtpd_epi32(v1));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), codes);
+					}
+					return i;
+				}
+#endif
+
+				template <bool Accumulate, typename TShape>
+				void Render(float64* dst, size_t count, float64 phase, float64 step,
+					float64 increment, const TShape& shape) {
+
+					if (count == 0) {
+						return;
+					}
+
+#if NATIVE_X86
+					switch (ActiveSimdLevel()) {
+					case SimdLevel::Avx2:
+						RenderAvx2<Accumulate>(dst, count, phase, step, increment, shape);
+						return;
+					case SimdLevel::Sse41:
+						RenderSse41<Accumulate>(dst, count, phase, step, increment, shape);
+						return;
+					default:
+						break;
+					}
+#endif
+					RenderScalar<Accumulate>(dst, 0, count, phase, step, increment, shape);
+				}
+
+				template <typename T>
+				void QuantizeScalar(const float64* src, T* dst, size_t begin, size_t end,
+					float64 c0, float64 c1, float64 low, float64 high) {
+
+					for (size_t i = begin; i < end; i++) {
+
+						float64 v = c0 + c1 * src[i];
+						v = (v < low) ? low : (v > high) ? high : v;
+						// NaN ends up at the low end instead of being undefined.
+						dst[i] = (T)(int64)std::nearbyint((v == v) ? v : low);
+					}
+				}
+			}
+
+			void RenderSine(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude, float64 offset) {
+
+				const SineShape shape = { amplitude, offset };
+				Render<false>(dst, count, phase, step, 0.0, shape);
+			}
+
+			void AddSine(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude) {
+
+				const SineShape shape = { amplitude, 0.0 };
+				Render<true>(dst, count, phase, step, 0.0, shape);
+			}
+
+			void RenderChirp(float64* dst, size_t count, float64 phase, float64 step,
+				float64 stepIncrement, float64 amplitude, float64 offset) {
+
+				const SineShape shape = { amplitude, offset };
+				Render<false>(dst, count, phase, step, stepIncrement, shape);
+			}
+
+			void RenderSquare(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude, float64 offset, float64 dutyCycle) {
+
+				const SquareShape shape = { amplitude, offset, dutyCycle };
+				Render<false>(dst, count, phase, step, 0.0, shape);
+			}
+
+			void RenderTriangle(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude, float64 offset) {
+
+				const TriangleShape shape = { amplitude, offset };
+				Render<false>(dst, count, phase, step, 0.0, shape);
+			}
+
+			void RenderTable(float64* dst, size_t count, float64 phase, float64 step,
+				const float64* table, uInt32 tableSize, float64 amplitude, float64 offset) {
+
+				if (table == nullptr || tableSize == 0) {
+					return;
+				}
+
+				const TableShape shape = { table, tableSize, amplitude, offset };
+				Render<false>(dst, count, phase, step, 0.0, shape);
+			}
+
+			bool QuantizeSamples(const float64* src, void* dst, size_t count,
+				SampleFormat format, float64 c0, float64 c1) {
+
+				switch (format) {
+				case SampleFormat::Float64: {
+					float64* out = static_cast<float64*>(dst);
+					for (size_t i = 0; i < count; i++) {
+						out[i] = c0 + c1 * src[i];
+					}
+					return true;
+				}
+				case SampleFormat::Int16: {
+					int16* out = static_cast<int16*>(dst);
+					size_t i = 0;
+#if NATIVE_X86
+					if (ActiveSimdLevel() == SimdLevel::Avx2) {
+						i = QuantizeI16Avx2(src, out, count, c0, c1);
+					}
+#endif
+					QuantizeScalar(src, out, i, count, c0, c1, -32768.0, 32767.0);
+					return true;
+				}
+				case SampleFormat::Int32:
+					QuantizeScalar(src, static_cast<int32*>(dst), 0, count, c0, c1,
+						-2147483648.0, 2147483647.0);
+					return true;
+				case SampleFormat::UInt16:
+					QuantizeScalar(src, static_cast<uInt16*>(dst), 0, count, c0, c1, 0.0, 65535.0);
+					return true;
+				case SampleFormat::UInt32:
+					QuantizeScalar(src, static_cast<uInt32*>(dst), 0, count, c0, c1, 0.0, 4294967295.0);
+					return true;
+				default:
+					return false;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+/*
+* Vectorized waveform synthesis over a run of samples of one channel.
+*
+* Phases are in cycles: the sample at position `i` of a run has phase
+* `phase + i * step` (plus `i * (i - 1) / 2 * stepIncrement` for a chirp),
+* where `step` is the frequency divided by the sample rate. Every sample is
+* computed from its index rather than by accumulation, so long runs do not
+* drift and a run can be split anywhere. Sines use a polynomial accurate
+* to about 1e-15 instead of the C library, so the SIMD and scalar paths
+* agree.
+*/
+
+#include "NativeDAQmx.h"
+#include "SampleFormat.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Native {
+
+			/**
+			* @brief `dst[i] = offset + amplitude * sin(2 pi (phase + i * step))`.
+			*/
+			void RenderSine(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude, float64 offset);
+
+			/**
+			* @brief `dst[i] += amplitude * sin(2 pi (phase + i * step))`; sums
+			*        the tones of a multi-tone waveform.
+			*/
+			void AddSine(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude);
+
+			/**
+			* @brief Linear chirp: like `RenderSine`, with the step growing by
+			*        `stepIncrement` every sample.
+			*/
+			void RenderChirp(float64* dst, size_t count, float64 phase, float64 step,
+				float64 stepIncrement, float64 amplitude, float64 offset);
+
+			/**
+			* @brief `offset + amplitude` for the first `dutyCycle` of every
+			*        cycle, `offset - amplitude` for the rest.
+			*/
+			void RenderSquare(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude, float64 offset, float64 dutyCycle);
+
+			/**
+			* @brief Triangle in phase with `RenderSine`: `offset` at phase 0,
+			*        rising to `offset + amplitude` at a quarter cycle.
+			*/
+			void RenderTriangle(float64* dst, size_t count, float64 phase, float64 step,
+				float64 amplitude, float64 offset);
+
+			/**
+			* @brief Plays one cycle of a table of `tableSize` points, at least
+			*        1, interpolating linearly: `offset + amplitude * table(phase)`.
+			*
+			* @param[in] table `tableSize + 1` points; the last repeats the
+			*            first, so the cycle wraps without a branch.
+			*/
+			void RenderTable(float64* dst, size_t count, float64 phase, float64 step,
+				const float64* table, uInt32 tableSize, float64 amplitude, float64 offset);
+
+			/**
+			* @brief Converts values to device codes, `round(c0 + c1 * src[i])`,
+			*        saturated to the range of `format`. `Float64` copies
+			*        `c0 + c1 * src[i]`.
+			*
+			* @param[out] dst `count` samples of `format`; may not overlap `src`.
+			*
+			* @return `false` if `format` is unknown.
+			*/
+			bool QuantizeSamples(const float64* src, void* dst, size_t count,
+				SampleFormat format, float64 c0, float64 c1);
+
+			/**
+			* @brief Fractional part of a phase, in [0, 1).
+			*/
+			inline float64 WrapPhase(float64 phase) {
+				float64 wrapped = phase - (float64)(int64)phase;
+				if (wrapped < 0.0) {
+					wrapped += 1.0;
+				}
+				return (wrapped < 1.0) ? wrapped : 0.0;
+			}
+		}
+	}
+}
@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "PinnedBufferPool.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		PinnedBufferPool::PinnedBufferPool(int bufferBytes,
+			int initialBuffers, int maxBuffers) {
+
+			if (bufferBytes <= 0 || initialBuffers < 0 || maxBuffers <= 0
+				|| initialBuffers > maxBuffers) {
+				throw gcnew ArgumentException("Invalid buffer pool size.");
+			}
+
+			_core = new Native::BufferPoolCore();
+			_maxBuffers = maxBuffers;
+
+			int32 result = _core->Create((size_t)bufferBytes,
+				(uInt32)initialBuffers, (uInt32)maxBuffers);
+
+			if (result != Native::NativeSuccess) {
+				delete _core;
+				_core = nullptr;
+				throw gcnew OutOfMemoryException(
+					gcnew String(Native::NativeStatusDescription(result)));
+			}
+		}
+
+		PinnedBufferPool::~PinnedBufferPool() {
+			this->!PinnedBufferPool();
+		}
+
+		PinnedBufferPool::!PinnedBufferPool() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		IntPtr PinnedBufferPool::Rent() {
+
+			if (_core == nullptr) {
+				return IntPtr::Zero;
+			}
+
+			return IntPtr(_core->Rent());
+		}
+
+		int PinnedBufferPool::Return(IntPtr buffer) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			return _core->Return(buffer.ToPointer());
+		}
+
+		int PinnedBufferPool::ElementCount(int elementBytes) {
+
+			if (_core == nullptr || elementBytes <= 0) {
+				return 0;
+			}
+
+			return (int)(_core->BufferBytes() / (size_t)elementBytes);
+		}
+
+		int PinnedBufferPool::BufferBytes::get() {
+			return (_core == nullptr) ? 0 : (int)_core->BufferBytes();
+		}
+
+		int PinnedBufferPool::MaxBuffers::get() {
+			return _maxBuffers;
+		}
+
+		int PinnedBufferPool::Allocated::get() {
+			return (_core == nullptr) ? 0 : (int)_core->Counters().allocated;
+		}
+
+		int PinnedBufferPool::Available::get() {
+			return (_core == nullptr) ? 0 : (int)_core->Counters().available;
+		}
+
+		UInt64 PinnedBufferPool::Rents::get() {
+			return (_core == nullptr) ? 0 : _core->Counters().rents;
+		}
+
+		UInt64 PinnedBufferPool::Misses::get() {
+			return (_core == nullptr) ? 0 : _core->Counters().misses;
+		}
+	}
+}
@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "Native/BufferPoolCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Pool of reusable, cache-line aligned native buffers for DAQmx reads.
+		*
+		* The buffers are allocated outside of the managed heap, so they never
+		* move and never need to be pinned. `Rent` hands out the address of a
+		* free buffer without allocating; pass it to the pointer overloads of
+		* the `DAQmxCLIWrapper` read functions, or wrap it in C# without copying,
+		* e.g. `new Span<double>((void*)buffer, pool.ElementCount(sizeof(double)))`.
+		*
+		* `Rent` and `Return` are thread safe. Disposing the pool releases every
+		* buffer, including the ones that are still rented.
+		*/
+		public ref class PinnedBufferPool
+		{
+		private:
+			Native::BufferPoolCore* _core;
+
+		public:
+			/**
+			* @brief Creates a pool.
+			*
+			* @param[in] bufferBytes Size of each buffer, in bytes.
+			* @param[in] initialBuffers Number of buffers allocated up front.
+			* @param[in] maxBuffers Maximum number of buffers the pool grows to.
+			*
+			* @exception ArgumentException A size is not valid.
+			* @exception OutOfMemoryException The initial buffers could not be allocated.
+			*/
+			PinnedBufferPool(int bufferBytes, int initialBuffers, int maxBuffers);
+			~PinnedBufferPool();
+			!PinnedBufferPool();
+
+			/**
+			* @brief Takes a buffer from the pool.
+			*
+			* @return The address of a buffer of `BufferBytes` bytes, or
+			*         `IntPtr::Zero` if all `MaxBuffers` buffers are rented.
+			*/
+			IntPtr Rent();
+
+			/**
+			* @brief Returns a buffer obtained from `Rent`.
+			*
+			* @return `0` on success, a negative status code if the buffer does
+			*         not belong to the pool or was already returned.
+			*/
+			int Return(IntPtr buffer);
+
+			/**
+			* @brief Number of elements of `elementBytes` bytes that fit in one buffer.
+			*/
+			int ElementCount(int elementBytes);
+
+			property int BufferBytes {
+				int get();
+			}
+
+			property int MaxBuffers {
+				int get();
+			}
+
+			property int Allocated {
+				int get();
+			}
+
+			property int Available {
+				int get();
+			}
+
+			property UInt64 Rents {
+				UInt64 get();
+			}
+
+			property UInt64 Misses {
+				UInt64 get();
+			}
+
+		private:
+			int _maxBuffers;
+		};
+	}
+}
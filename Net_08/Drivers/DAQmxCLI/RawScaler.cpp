@@ -0,0 +1,247 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RawScaler.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		RawScaler::RawScaler() {
+			_core = new Native::RawScalingCore();
+		}
+
+		RawScaler::~RawScaler() {
+			this->!RawScaler();
+		}
+
+		RawScaler::!RawScaler() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int RawScaler::Capture(IntPtr taskHandle) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			return _core->Capture((TaskHandle)taskHandle.ToPointer());
+		}
+
+		int RawScaler::Reset(int channels) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channels <= 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->Reset((uInt32)channels);
+		}
+
+		int RawScaler::SetChannelCoefficients(int channel, array<double>^ coefficients) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0 || coefficients == nullptr || coefficients->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<float64> coefficientsPtr = &coefficients[0];
+			return _core->SetChannelCoefficients((uInt32)channel,
+				coefficientsPtr, (uInt32)coefficients->Length);
+		}
+
+		array<double>^ RawScaler::GetChannelCoefficients(int channel) {
+
+			if (_core == nullptr || channel < 0) {
+				return nullptr;
+			}
+
+			float64 coefficients[Native::MaxScalingCoeffs];
+			int32 count = _core->GetChannelCoefficients((uInt32)channel,
+				coefficients, Native::MaxScalingCoeffs);
+
+			if (count <= 0) {
+				return nullptr;
+			}
+
+			array<double>^ result = gcnew array<double>(count);
+			for (int i = 0; i < count; i++) {
+				result[i] = coefficients[i];
+			}
+			return result;
+		}
+
+		int RawScaler::Channels::get() {
+			return (_core == nullptr) ? 0 : (int)_core->Channels();
+		}
+
+		Native::RawScalingCore* RawScaler::_GetCore() {
+			return _core;
+		}
+
+		int RawScaler::_CheckRaw(array<Int16>^ raw, int samplesPerChannel, int count) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (raw == nullptr || raw->Length == 0 || samplesPerChannel <= 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if ((Int64)raw->Length < (Int64)count * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+			return Native::NativeSuccess;
+		}
+
+		int RawScaler::ScaleToF64(array<Int16>^ raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, array<double>^ scaled) {
+
+			int result = _CheckRaw(raw, samplesPerChannel, Channels);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+			if (scaled == nullptr || scaled->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<int16> rawPtr = &raw[0];
+			pin_ptr<float64> scaledPtr = &scaled[0];
+			return _core->ScaleToF64(rawPtr, (uInt32)samplesPerChannel,
+				(int32)fillMode, scaledPtr, (size_t)scaled->Length);
+		}
+
+		int RawScaler::ScaleToF64(Int16* raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, double* scaled, int scaledSize) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel <= 0 || scaledSize < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->ScaleToF64(raw, (uInt32)samplesPerChannel,
+				(int32)fillMode, scaled, (size_t)scaledSize);
+		}
+
+		int RawScaler::ScaleToF32(array<Int16>^ raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, array<float>^ scaled) {
+
+			int result = _CheckRaw(raw, samplesPerChannel, Channels);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+			if (scaled == nullptr || scaled->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<int16> rawPtr = &raw[0];
+			pin_ptr<float32> scaledPtr = &scaled[0];
+			return _core->ScaleToF32(rawPtr, (uInt32)samplesPerChannel,
+				(int32)fillMode, scaledPtr, (size_t)scaled->Length);
+		}
+
+		int RawScaler::ScaleToF32(Int16* raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, float* scaled, int scaledSize) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel <= 0 || scaledSize < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->ScaleToF32(raw, (uInt32)samplesPerChannel,
+				(int32)fillMode, scaled, (size_t)scaledSize);
+		}
+
+		int RawScaler::ScaleChannelToF64(array<Int16>^ raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, int channel, array<double>^ scaled) {
+
+			int result = _CheckRaw(raw, samplesPerChannel, Channels);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+			if (channel < 0 || scaled == nullptr || scaled->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<int16> rawPtr = &raw[0];
+			pin_ptr<float64> scaledPtr = &scaled[0];
+			return _core->ScaleChannelToF64(rawPtr, (uInt32)samplesPerChannel,
+				(int32)fillMode, (uInt32)channel, scaledPtr, (size_t)scaled->Length);
+		}
+
+		int RawScaler::ScaleChannelToF64(Int16* raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, int channel, double* scaled, int scaledSize) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel <= 0 || channel < 0 || scaledSize < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->ScaleChannelToF64(raw, (uInt32)samplesPerChannel,
+				(int32)fillMode, (uInt32)channel, scaled, (size_t)scaledSize);
+		}
+
+		int RawScaler::ScaleChannelToF32(array<Int16>^ raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, int channel, array<float>^ scaled) {
+
+			int result = _CheckRaw(raw, samplesPerChannel, Channels);
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+			if (channel < 0 || scaled == nullptr || scaled->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<int16> rawPtr = &raw[0];
+			pin_ptr<float32> scaledPtr = &scaled[0];
+			return _core->ScaleChannelToF32(rawPtr, (uInt32)samplesPerChannel,
+				(int32)fillMode, (uInt32)channel, scaledPtr, (size_t)scaled->Length);
+		}
+
+		int RawScaler::ScaleChannelToF32(Int16* raw, int samplesPerChannel,
+			ReadbacklFillMode fillMode, int channel, float* scaled, int scaledSize) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel <= 0 || channel < 0 || scaledSize < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->ScaleChannelToF32(raw, (uInt32)samplesPerChannel,
+				(int32)fillMode, (uInt32)channel, scaled, (size_t)scaledSize);
+		}
+	}
+}
@@ -0,0 +1,130 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "Native/RawScalingCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Deferred conversion of raw I16 AI data to volts.
+		*
+		* Read with `DAQmxCLIWrapper::ReadBinaryI16` or `ReadRaw` (a quarter of the
+		* bytes of `ReadAnalogF64`), keep the raw data, and convert only the
+		* blocks and channels that are actually looked at. `Capture` takes the
+		* device scaling polynomial of every channel once, after the task is
+		* configured; the conversion itself runs in native SIMD kernels.
+		*
+		* Methods return `0` on success or a negative status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class RawScaler
+		{
+		private:
+			Native::RawScalingCore* _core;
+
+		public:
+			RawScaler();
+			~RawScaler();
+			!RawScaler();
+
+			/**
+			* @brief Commits the task and captures the scaling polynomial of each channel.
+			*
+			* @param[in] taskHandle A task with its AI channels configured.
+			*/
+			int Capture(IntPtr taskHandle);
+
+			/**
+			* @brief Sets up `channels` channels with the identity polynomial, for
+			*        coefficients supplied with `SetChannelCoefficients`.
+			*/
+			int Reset(int channels);
+
+			/**
+			* @brief Replaces the polynomial of one channel; constant term first.
+			*/
+			int SetChannelCoefficients(int channel, array<double>^ coefficients);
+
+			/**
+			* @brief Returns the polynomial of one channel, or `nullptr` if the
+			*        channel does not exist.
+			*/
+			array<double>^ GetChannelCoefficients(int channel);
+
+			property int Channels {
+				int get();
+			}
+
+			/**
+			* @brief Scales a block of `Channels * samplesPerChannel` raw codes. The
+			*        output has the layout of the input.
+			*/
+			int ScaleToF64(array<Int16>^ raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, array<double>^ scaled);
+
+			/**
+			* @brief Pointer variant of `ScaleToF64`, e.g. for the `Data` of an
+			*        `AcquisitionBlock` or a `PinnedBufferPool` buffer.
+			*/
+			int ScaleToF64(Int16* raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, double* scaled, int scaledSize);
+
+			/**
+			* @brief Single precision variant of `ScaleToF64`.
+			*/
+			int ScaleToF32(array<Int16>^ raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, array<float>^ scaled);
+
+			int ScaleToF32(Int16* raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, float* scaled, int scaledSize);
+
+			/**
+			* @brief Scales one channel of a block into `samplesPerChannel`
+			*        contiguous values.
+			*/
+			int ScaleChannelToF64(array<Int16>^ raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, int channel, array<double>^ scaled);
+
+			int ScaleChannelToF64(Int16* raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, int channel, double* scaled, int scaledSize);
+
+			int ScaleChannelToF32(array<Int16>^ raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, int channel, array<float>^ scaled);
+
+			int ScaleChannelToF32(Int16* raw, int samplesPerChannel,
+				ReadbacklFillMode fillMode, int channel, float* scaled, int scaledSize);
+
+		internal:
+			/** The native scaler, for native stages that scale raw blocks. */
+			Native::RawScalingCore* _GetCore();
+
+		private:
+			int _CheckRaw(array<Int16>^ raw, int samplesPerChannel, int channels);
+		};
+	}
+}
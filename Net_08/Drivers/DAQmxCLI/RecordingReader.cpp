@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RecordingReader.h"
+#include "StreamRecorder.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		RecordingReader::RecordingReader() {
+			_core = new Native::RecordingReaderCore();
+		}
+
+		RecordingReader::~RecordingReader() {
+			this->!RecordingReader();
+		}
+
+		RecordingReader::!RecordingReader() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int RecordingReader::Open(String^ path) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (String::IsNullOrEmpty(path)) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			array<Byte>^ utf8 = StreamRecorder::_Utf8Path(path);
+			pin_ptr<Byte> utf8Ptr = &utf8[0];
+			return _core->Open(reinterpret_cast<const char*>(utf8Ptr));
+		}
+
+		void RecordingReader::Close() {
+			if (_core != nullptr) {
+				_core->Close();
+			}
+		}
+
+		int RecordingReader::Channels::get() {
+			return (_core != nullptr) ? (int)_core->Channels() : 0;
+		}
+
+		SampleFormat RecordingReader::Format::get() {
+			return (_core != nullptr) ? (SampleFormat)_core->Format() : SampleFormat::Int16;
+		}
+
+		Int64 RecordingReader::ChunkCount::get() {
+			return (_core != nullptr) ? (Int64)_core->ChunkCount() : 0;
+		}
+
+		Int64 RecordingReader::TotalSamples::get() {
+			return (_core != nullptr) ? (Int64)_core->TotalSamples() : 0;
+		}
+
+		double RecordingReader::SampleRate::get() {
+			return (_core != nullptr && _core->Header() != nullptr)
+				? _core->Header()->sampleRate : 0.0;
+		}
+
+		bool RecordingReader::IsComplete::get() {
+			return _core != nullptr && _core->IsComplete();
+		}
+
+		int RecordingReader::GetChunk(Int64 index, [Out] RecordedChunk% chunk) {
+
+			chunk = RecordedChunk();
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (index < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::RecordedChunk native;
+			int result = _core->GetChunk((uInt64)index, native);
+
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			chunk.Data = IntPtr(const_cast<void*>(native.data));
+			chunk.FirstSample = native.firstSample;
+			chunk.SamplesPerChannel = (int)native.samplesPerChannel;
+			chunk.Channels = (int)_core->Channels();
+			chunk.Format = (SampleFormat)_core->Format();
+			chunk.TimestampNs = native.timestampNs;
+			return Native::NativeSuccess;
+		}
+
+		array<double>^ RecordingReader::GetChunkCoefficients(Int64 index, int channel) {
+
+			if (_core == nullptr || index < 0 || channel < 0
+				|| channel >= (int)_core->Channels()) {
+				return nullptr;
+			}
+
+			Native::RecordedChunk native;
+			if (_core->GetChunk((uInt64)index, native) != Native::NativeSuccess) {
+				return nullptr;
+			}
+
+			array<double>^ coefficients = gcnew array<double>((int)native.coeffCount);
+			const float64* source = native.coeffs + (size_t)channel * native.coeffCount;
+
+			for (int i = 0; i < coefficients->Length; i++) {
+				coefficients[i] = source[i];
+			}
+			return coefficients;
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "AcquisitionEngine.h"
+#include "Native/RecordingReaderCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief One chunk of a recording. `Data` points into the mapped file
+		*        and stays valid until the reader is closed.
+		*/
+		public value struct RecordedChunk
+		{
+			/** Raw samples, interleaved by scan. */
+			IntPtr Data;
+			UInt64 FirstSample;
+			int SamplesPerChannel;
+			int Channels;
+			SampleFormat Format;
+			/** Host time of the first block of the chunk, nanoseconds since the
+			*   Unix epoch (UTC); for engine blocks, the time of their read. */
+			Int64 TimestampNs;
+		};
+
+		/**
+		* @brief Reads files written by `StreamRecorder`.
+		*
+		* The file is memory mapped; chunks are found by index without reading
+		* the ones before them and without copying the samples.
+		*/
+		public ref class RecordingReader
+		{
+		private:
+			Native::RecordingReaderCore* _core;
+
+		public:
+			RecordingReader();
+			~RecordingReader();
+			!RecordingReader();
+
+			int Open(String^ path);
+			void Close();
+
+			property int Channels {
+				int get();
+			}
+
+			property SampleFormat Format {
+				SampleFormat get();
+			}
+
+			property Int64 ChunkCount {
+				Int64 get();
+			}
+
+			property Int64 TotalSamples {
+				Int64 get();
+			}
+
+			/** Sample clock rate stored by the recorder; `0` if unknown. */
+			property double SampleRate {
+				double get();
+			}
+
+			/** `true` if the recorder closed the file normally. */
+			property bool IsComplete {
+				bool get();
+			}
+
+			int GetChunk(Int64 index, [Out] RecordedChunk% chunk);
+
+			/**
+			* @brief Scaling polynomial of one channel in chunk `index`;
+			*        constant term first. `nullptr` if the index is invalid.
+			*/
+			array<double>^ GetChunkCoefficients(Int64 index, int channel);
+		};
+	}
+}
@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SampleCodec.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		SampleCodecConfiguration::SampleCodecConfiguration() {
+
+			Native::SampleCodecConfig defaults = Native::DefaultSampleCodecConfig();
+
+			Channels = (int)defaults.channels;
+			Format = (SampleFormat)defaults.format;
+			BlockSamplesPerChannel = (int)defaults.blockSamplesPerChannel;
+			MaxSamplesPerChannel = (int)defaults.maxSamplesPerChannel;
+			Predictor = (CodecPredictor)defaults.predictor;
+			Threads = (int)defaults.threads;
+		}
+
+		Native::SampleCodecConfig SampleCodecConfiguration::ToNative() {
+
+			Native::SampleCodecConfig config = Native::DefaultSampleCodecConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.blockSamplesPerChannel = (uInt32)Math::Max(BlockSamplesPerChannel, 0);
+			config.maxSamplesPerChannel = (uInt32)Math::Max(MaxSamplesPerChannel, 0);
+			config.predictor = (Native::CodecPredictor)Predictor;
+			config.threads = (uInt32)Math::Max(Threads, 0);
+			return config;
+		}
+
+
+		SampleCodec::SampleCodec() {
+			_core = new Native::SampleCodecCore();
+		}
+
+		SampleCodec::~SampleCodec() {
+			this->!SampleCodec();
+		}
+
+		SampleCodec::!SampleCodec() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int SampleCodec::Configure(SampleCodecConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->Configure(configuration->ToNative());
+		}
+
+		void SampleCodec::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		Int64 SampleCodec::MaxEncodedBytes(int samplesPerChannel) {
+			return (_core != nullptr)
+				? (Int64)_core->MaxEncodedBytes((uInt32)Math::Max(samplesPerChannel, 0)) : 0;
+		}
+
+		Int64 SampleCodec::Encode(Memory<Int16> data, int samplesPerChannel,
+			ReadbacklFillMode fillMode, Memory<Byte> output) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			Int64 result = _Encode(handle.Pointer, data.Length, 2, samplesPerChannel, fillMode, output);
+			handle.Dispose();
+			return result;
+		}
+
+		Int64 SampleCodec::Encode(Memory<Int32> data, int samplesPerChannel,
+			ReadbacklFillMode fillMode, Memory<Byte> output) {
+
+			System::Buffers::MemoryHandle handle = data.Pin();
+			Int64 result = _Encode(handle.Pointer, data.Length, 4, samplesPerChannel, fillMode, output);
+			handle.Dispose();
+			return result;
+		}
+
+		Int64 SampleCodec::_Encode(const void* data, Int64 length, int sampleBytes,
+			int samplesPerChannel, ReadbacklFillMode fillMode, Memory<Byte> output) {
+
+			if (_core == nullptr || !_core->IsConfigured()) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if ((int)Native::SampleSize(_core->Config().format) != sampleBytes) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if (length < (Int64)_core->Config().channels * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			System::Buffers::MemoryHandle handle = output.Pin();
+			size_t written = 0;
+			int result = _core->Encode(data, (uInt32)samplesPerChannel, (int32)fillMode,
+				handle.Pointer, (size_t)output.Length, &written);
+			handle.Dispose();
+
+			return (result < 0) ? (Int64)result : (Int64)written;
+		}
+
+		UInt64 SampleCodec::BlocksEncoded::get() {
+			return (_core != nullptr) ? _core->Counters().blocksEncoded : 0;
+		}
+
+		UInt64 SampleCodec::SamplesEncoded::get() {
+			return (_core != nullptr) ? _core->Counters().samplesEncoded : 0;
+		}
+
+		UInt64 SampleCodec::BytesIn::get() {
+			return (_core != nullptr) ? _core->Counters().bytesIn : 0;
+		}
+
+		UInt64 SampleCodec::BytesOut::get() {
+			return (_core != nullptr) ? _core->Counters().bytesOut : 0;
+		}
+
+		int SampleCodec::GetBlockInfo(Memory<Byte> data, [Out] CodecBlockInfo% info) {
+
+			info = CodecBlockInfo();
+
+			Native::CodecBlockHeader header;
+			System::Buffers::MemoryHandle handle = data.Pin();
+			int result = Native::ReadCodecBlockHeader(handle.Pointer, (size_t)data.Length, &header);
+			handle.Dispose();
+
+			if (result == Native::NativeSuccess) {
+				info.BlockBytes = (int)header.blockBytes;
+				info.FirstSample = header.firstSample;
+				info.SamplesPerChannel = (int)header.samplesPerChannel;
+				info.Channels = (int)header.channels;
+				info.SampleBytes = (int)header.sampleBytes;
+			}
+			return result;
+		}
+
+		int SampleCodec::DecodeBlock(Memory<Byte> block, ReadbacklFillMode fillMode,
+			Memory<Int16> samples) {
+
+			System::Buffers::MemoryHandle handle = samples.Pin();
+			int result = _Decode(block, -1, fillMode, handle.Pointer, samples.Length, 2);
+			handle.Dispose();
+			return result;
+		}
+
+		int SampleCodec::DecodeBlock(Memory<Byte> block, ReadbacklFillMode fillMode,
+			Memory<Int32> samples) {
+
+			System::Buffers::MemoryHandle handle = samples.Pin();
+			int result = _Decode(block, -1, fillMode, handle.Pointer, samples.Length, 4);
+			handle.Dispose();
+			return result;
+		}
+
+		int SampleCodec::DecodeChannel(Memory<Byte> block, int channel, Memory<Int16> samples) {
+
+			if (channel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			System::Buffers::MemoryHandle handle = samples.Pin();
+			int result = _Decode(block, channel, ReadbacklFillMode::ByChannel,
+				handle.Pointer, samples.Length, 2);
+			handle.Dispose();
+			return result;
+		}
+
+		int SampleCodec::DecodeChannel(Memory<Byte> block, int channel, Memory<Int32> samples) {
+
+			if (channel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			System::Buffers::MemoryHandle handle = samples.Pin();
+			int result = _Decode(block, channel, ReadbacklFillMode::ByChannel,
+				handle.Pointer, samples.Length, 4);
+			handle.Dispose();
+			return result;
+		}
+
+		int SampleCodec::_Decode(Memory<Byte> block, int channel, ReadbacklFillMode fillMode,
+			void* samples, Int64 length, int sampleBytes) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			const size_t bytes = (size_t)block.Length;
+
+			Native::CodecBlockHeader header;
+			int result = Native::ReadCodecBlockHeader(handle.Pointer, bytes, &header);
+
+			if (result == Native::NativeSuccess && header.sampleBytes != (uInt8)sampleBytes) {
+				result = Native::NativeErrorUnsupportedFormat;
+			}
+
+			if (result == Native::NativeSuccess) {
+				result = (channel < 0)
+					? Native::DecodeCodecBlock(handle.Pointer, bytes, (int32)fillMode, samples, (size_t)length)
+					: Native::DecodeCodecChannel(handle.Pointer, bytes, (uInt32)channel, samples, (size_t)length);
+			}
+			handle.Dispose();
+
+			return (result < 0) ? result : (int)header.samplesPerChannel;
+		}
+
+		Int64 SampleCodec::FindBlock(Memory<Byte> stream, UInt64 sampleIndex) {
+
+			System::Buffers::MemoryHandle handle = stream.Pin();
+			size_t offset = 0;
+			int result = Native::FindCodecBlock(handle.Pointer, (size_t)stream.Length,
+				sampleIndex, &offset);
+			handle.Dispose();
+
+			return (result < 0) ? (Int64)result : (Int64)offset;
+		}
+	}
+}
@@ -0,0 +1,205 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "AcquisitionEngine.h"
+#include "DAQmxCLIWrapper.h"
+#include "Native/SampleCodecCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Predictor of the sample codec.
+		*/
+		public enum class CodecPredictor
+		{
+			None = (int)Native::CodecPredictor::None,		// Samples as they are
+			Delta = (int)Native::CodecPredictor::Delta,		// x[i] - x[i-1]
+			Linear = (int)Native::CodecPredictor::Linear,	// x[i] - (2 x[i-1] - x[i-2])
+			Auto = (int)Native::CodecPredictor::Auto		// Cheapest per channel and block
+		};
+
+		/**
+		* @brief Header of one encoded block.
+		*/
+		public value struct CodecBlockInfo
+		{
+			/** Bytes of the block; the next block starts there. */
+			int BlockBytes;
+
+			/** Index, per channel, of the first sample of the block. */
+			UInt64 FirstSample;
+
+			int SamplesPerChannel;
+
+			int Channels;
+
+			/** 2 for `Int16` codes, 4 for `Int32`. */
+			int SampleBytes;
+		};
+
+		/**
+		* @brief Settings of a `SampleCodec`.
+		*/
+		public ref class SampleCodecConfiguration
+		{
+		public:
+			SampleCodecConfiguration();
+
+			property int Channels;
+
+			/** `Int16` or `Int32`, the codes of `ReadBinaryI16` / `I32`. */
+			property SampleFormat Format;
+
+			/** Samples per channel in one encoded block: the unit of random
+			*   access and of work for the threads. */
+			property int BlockSamplesPerChannel;
+
+			/** Largest input of one `Encode` call, in samples per channel. */
+			property int MaxSamplesPerChannel;
+
+			property CodecPredictor Predictor;
+
+			/** Threads encoding blocks, the calling one included; `0` for
+			*   one per logical processor. */
+			property int Threads;
+
+		internal:
+			Native::SampleCodecConfig ToNative();
+		};
+
+		/**
+		* @brief Lossless codec for raw `I16` / `I32` recordings.
+		*
+		* Each channel is predicted, the residuals are zigzag coded and
+		* bit-packed with SIMD kernels, one width per 256 samples. Encoding
+		* runs in native code at acquisition rate, over several threads if
+		* configured. The output is a sequence of self-contained blocks with
+		* headers, so a stream written to disk can be searched by sample
+		* index and decoded from any block, one channel or all of them.
+		*
+		* Methods return a status code when negative;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class SampleCodec
+		{
+		private:
+			Native::SampleCodecCore* _core;
+
+		public:
+			SampleCodec();
+			~SampleCodec();
+			!SampleCodec();
+
+			/**
+			* @brief Allocates the buffers, starts the threads and resets.
+			*/
+			int Configure(SampleCodecConfiguration^ configuration);
+
+			/**
+			* @brief Sets the sample index of the next block back to 0 and
+			*        clears the counters.
+			*/
+			void Reset();
+
+			/**
+			* @brief Output room `Encode` may need for `samplesPerChannel`.
+			*/
+			Int64 MaxEncodedBytes(int samplesPerChannel);
+
+			/**
+			* @brief Encodes a block of `Int16` codes.
+			*
+			* @return The number of bytes written to `output`, or a negative
+			*         status code; if `output` is too small nothing is
+			*         consumed.
+			*/
+			Int64 Encode(Memory<Int16> data, int samplesPerChannel,
+				ReadbacklFillMode fillMode, Memory<Byte> output);
+
+			/** Same as the `Int16` overload for `Int32` codes. */
+			Int64 Encode(Memory<Int32> data, int samplesPerChannel,
+				ReadbacklFillMode fillMode, Memory<Byte> output);
+
+			property UInt64 BlocksEncoded {
+				UInt64 get();
+			}
+
+			/** Samples per channel encoded since the last reset. */
+			property UInt64 SamplesEncoded {
+				UInt64 get();
+			}
+
+			property UInt64 BytesIn {
+				UInt64 get();
+			}
+
+			property UInt64 BytesOut {
+				UInt64 get();
+			}
+
+			/**
+			* @brief Reads the header of the block at the start of `data`.
+			*/
+			static int GetBlockInfo(Memory<Byte> data, [Out] CodecBlockInfo% info);
+
+			/**
+			* @brief Decodes every channel of the block at the start of `block`.
+			*
+			* @return The number of samples per channel decoded, or a
+			*         negative status code.
+			*/
+			static int DecodeBlock(Memory<Byte> block, ReadbacklFillMode fillMode,
+				Memory<Int16> samples);
+
+			/** Same as the `Int16` overload for `Int32` codes. */
+			static int DecodeBlock(Memory<Byte> block, ReadbacklFillMode fillMode,
+				Memory<Int32> samples);
+
+			/**
+			* @brief Decodes one channel of the block at the start of `block`.
+			*/
+			static int DecodeChannel(Memory<Byte> block, int channel, Memory<Int16> samples);
+
+			/** Same as the `Int16` overload for `Int32` codes. */
+			static int DecodeChannel(Memory<Byte> block, int channel, Memory<Int32> samples);
+
+			/**
+			* @brief Finds the block of `stream` holding `sampleIndex`.
+			*
+			* @return Its offset in `stream`, or a negative status code.
+			*/
+			static Int64 FindBlock(Memory<Byte> stream, UInt64 sampleIndex);
+
+		private:
+			Int64 _Encode(const void* data, Int64 length, int sampleBytes, int samplesPerChannel,
+				ReadbacklFillMode fillMode, Memory<Byte> output);
+
+			static int _Decode(Memory<Byte> block, int channel, ReadbacklFillMode fillMode,
+				void* samples, Int64 length, int sampleBytes);
+		};
+	}
+}
@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SampleLayout.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace {
+
+			template <typename T>
+			int ConvertArray(array<T>^ source, array<T>^ destination,
+				int channels, int samplesPerChannel, bool interleave) {
+
+				if (source == nullptr || destination == nullptr
+					|| Object::ReferenceEquals(source, destination)
+					|| channels <= 0 || samplesPerChannel < 0) {
+					return Native::NativeErrorInvalidArgument;
+				}
+
+				const Int64 count = (Int64)channels * samplesPerChannel;
+				if (source->Length < count || destination->Length < count) {
+					return Native::NativeErrorBufferTooSmall;
+				}
+				if (count == 0) {
+					return Native::NativeSuccess;
+				}
+
+				pin_ptr<T> sourcePtr = &source[0];
+				pin_ptr<T> destinationPtr = &destination[0];
+
+				bool done = interleave
+					? Native::Interleave(sourcePtr, destinationPtr,
+						(uInt32)channels, (uInt32)samplesPerChannel, sizeof(T))
+					: Native::Deinterleave(sourcePtr, destinationPtr,
+						(uInt32)channels, (uInt32)samplesPerChannel, sizeof(T));
+
+				return done ? Native::NativeSuccess : Native::NativeErrorUnsupportedFormat;
+			}
+		}
+
+		int SampleLayout::Deinterleave(array<Int16>^ source, array<Int16>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, false);
+		}
+
+		int SampleLayout::Deinterleave(array<UInt16>^ source, array<UInt16>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, false);
+		}
+
+		int SampleLayout::Deinterleave(array<Int32>^ source, array<Int32>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, false);
+		}
+
+		int SampleLayout::Deinterleave(array<UInt32>^ source, array<UInt32>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, false);
+		}
+
+		int SampleLayout::Deinterleave(array<double>^ source, array<double>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, false);
+		}
+
+		int SampleLayout::Deinterleave(array<Byte>^ source, array<Byte>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, false);
+		}
+
+		int SampleLayout::Interleave(array<Int16>^ source, array<Int16>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, true);
+		}
+
+		int SampleLayout::Interleave(array<UInt16>^ source, array<UInt16>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, true);
+		}
+
+		int SampleLayout::Interleave(array<Int32>^ source, array<Int32>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, true);
+		}
+
+		int SampleLayout::Interleave(array<UInt32>^ source, array<UInt32>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, true);
+		}
+
+		int SampleLayout::Interleave(array<double>^ source, array<double>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, true);
+		}
+
+		int SampleLayout::Interleave(array<Byte>^ source, array<Byte>^ destination,
+			int channels, int samplesPerChannel) {
+			return ConvertArray(source, destination, channels, samplesPerChannel, true);
+		}
+
+		int SampleLayout::Convert(IntPtr source, ReadbacklFillMode sourceMode,
+			IntPtr destination, ReadbacklFillMode destinationMode,
+			int channels, int samplesPerChannel, int elementBytes) {
+
+			if (source == IntPtr::Zero || destination == IntPtr::Zero
+				|| source == destination || channels <= 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			bool done = Native::ConvertFillMode(source.ToPointer(), (int32)sourceMode,
+				destination.ToPointer(), (int32)destinationMode,
+				(uInt32)channels, (uInt32)samplesPerChannel, (size_t)elementBytes);
+
+			return done ? Native::NativeSuccess : Native::NativeErrorUnsupportedFormat;
+		}
+	}
+}
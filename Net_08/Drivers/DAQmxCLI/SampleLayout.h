@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "Native/TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Conversions between the `ReadbacklFillMode` layouts.
+		*
+		* `Deinterleave` turns a block read `ByScan` into `ByChannel` order (one
+		* contiguous run of `samplesPerChannel` values per channel); `Interleave`
+		* does the reverse. The work is done by cache-blocked SIMD transpose
+		* kernels in native code, so reading interleaved (the order the driver
+		* keeps the data in) and converting is cheaper than per-element loops in
+		* managed code.
+		*
+		* Methods return `0` on success or a negative status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class SampleLayout abstract sealed
+		{
+		public:
+			/**
+			* @brief Converts `channels * samplesPerChannel` samples from `ByScan`
+			*        to `ByChannel` order.
+			*
+			* @param[in] source Interleaved samples.
+			* @param[out] destination Receives the samples grouped by channel;
+			*             must not be `source`.
+			*/
+			static int Deinterleave(array<Int16>^ source, array<Int16>^ destination,
+				int channels, int samplesPerChannel);
+			static int Deinterleave(array<UInt16>^ source, array<UInt16>^ destination,
+				int channels, int samplesPerChannel);
+			static int Deinterleave(array<Int32>^ source, array<Int32>^ destination,
+				int channels, int samplesPerChannel);
+			static int Deinterleave(array<UInt32>^ source, array<UInt32>^ destination,
+				int channels, int samplesPerChannel);
+			static int Deinterleave(array<double>^ source, array<double>^ destination,
+				int channels, int samplesPerChannel);
+			static int Deinterleave(array<Byte>^ source, array<Byte>^ destination,
+				int channels, int samplesPerChannel);
+
+			/**
+			* @brief Converts `channels * samplesPerChannel` samples from
+			*        `ByChannel` to `ByScan` order.
+			*/
+			static int Interleave(array<Int16>^ source, array<Int16>^ destination,
+				int channels, int samplesPerChannel);
+			static int Interleave(array<UInt16>^ source, array<UInt16>^ destination,
+				int channels, int samplesPerChannel);
+			static int Interleave(array<Int32>^ source, array<Int32>^ destination,
+				int channels, int samplesPerChannel);
+			static int Interleave(array<UInt32>^ source, array<UInt32>^ destination,
+				int channels, int samplesPerChannel);
+			static int Interleave(array<double>^ source, array<double>^ destination,
+				int channels, int samplesPerChannel);
+			static int Interleave(array<Byte>^ source, array<Byte>^ destination,
+				int channels, int samplesPerChannel);
+
+			/**
+			* @brief Pointer variant for native buffers, e.g. the `Data` of an
+			*        `AcquisitionBlock` or a `PinnedBufferPool` buffer.
+			*
+			* @param[in] elementBytes Size of one sample: 1, 2, 4 or 8.
+			*/
+			static int Convert(IntPtr source, ReadbacklFillMode sourceMode,
+				IntPtr destination, ReadbacklFillMode destinationMode,
+				int channels, int samplesPerChannel, int elementBytes);
+		};
+	}
+}
@@ -0,0 +1,240 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SoftwareTrigger.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		SoftwareTriggerConfiguration::SoftwareTriggerConfiguration() {
+
+			Native::SoftwareTriggerConfig defaults = Native::DefaultSoftwareTriggerConfig();
+
+			Channels = (int)defaults.channels;
+			SourceChannel = (int)defaults.sourceChannel;
+			Format = (SampleFormat)defaults.format;
+			Slope = (TriggerSlope)defaults.slope;
+			Level = defaults.level;
+			Hysteresis = defaults.hysteresis;
+			PreTriggerSamples = (int)defaults.preTriggerSamples;
+			PostTriggerSamples = (int)defaults.postTriggerSamples;
+			HoldoffSamples = (int)defaults.holdoffSamples;
+			MaxSamplesPerChannel = (int)defaults.maxSamplesPerChannel;
+			CaptureSlots = (int)defaults.captureSlots;
+			CaptureFillMode = (ReadbacklFillMode)defaults.captureFillMode;
+		}
+
+		Native::SoftwareTriggerConfig SoftwareTriggerConfiguration::ToNative() {
+
+			Native::SoftwareTriggerConfig config = Native::DefaultSoftwareTriggerConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.sourceChannel = (uInt32)Math::Max(SourceChannel, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.slope = (Native::TriggerSlope)Slope;
+			config.level = Level;
+			config.hysteresis = Hysteresis;
+			config.preTriggerSamples = (uInt32)Math::Max(PreTriggerSamples, 0);
+			config.postTriggerSamples = (uInt32)Math::Max(PostTriggerSamples, 0);
+			config.holdoffSamples = (uInt32)Math::Max(HoldoffSamples, 0);
+			config.maxSamplesPerChannel = (uInt32)Math::Max(MaxSamplesPerChannel, 0);
+			config.captureSlots = (uInt32)Math::Max(CaptureSlots, 0);
+			config.captureFillMode = (int32)CaptureFillMode;
+			return config;
+		}
+
+
+		SoftwareTrigger::SoftwareTrigger() {
+			_core = new Native::SoftwareTriggerCore();
+		}
+
+		SoftwareTrigger::~SoftwareTrigger() {
+			this->!SoftwareTrigger();
+		}
+
+		SoftwareTrigger::!SoftwareTrigger() {
+
+			// The engine must stop calling the core before it goes.
+			if (_engine != nullptr) {
+				_engine->_ReleaseStage();
+			}
+
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int SoftwareTrigger::Configure(SoftwareTriggerConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			int result = _core->Configure(configuration->ToNative());
+
+			// The level of the new configuration is converted with the scaler
+			// again; a scaler for a different channel count no longer applies.
+			if (result == Native::NativeSuccess && _scaler != nullptr
+				&& _core->SetScaling(_scaler->_GetCore()) != Native::NativeSuccess) {
+				_scaler = nullptr;
+			}
+			return result;
+		}
+
+		int SoftwareTrigger::SetScaling(RawScaler^ scaler) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			int result = _core->SetScaling((scaler != nullptr) ? scaler->_GetCore() : nullptr);
+
+			if (result == Native::NativeSuccess) {
+				_scaler = scaler;
+			}
+			return result;
+		}
+
+		void SoftwareTrigger::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		int SoftwareTrigger::_Process(Array^ data, const void* samples, SampleFormat format,
+			int samplesPerChannel, ReadbacklFillMode fillMode) {
+
+			if (!_core->IsConfigured()) {
+				return Native::NativeErrorInvalidState;
+			}
+			if ((SampleFormat)_core->Config().format != format) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if ((Int64)data->Length < (Int64)_core->Config().channels * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			return _core->Process(samples, (uInt32)samplesPerChannel, (int32)fillMode);
+		}
+
+		int SoftwareTrigger::Process(array<double>^ data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (data == nullptr || data->Length == 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<double> dataPtr = &data[0];
+			return _Process(data, dataPtr, SampleFormat::Float64, samplesPerChannel, fillMode);
+		}
+
+		int SoftwareTrigger::Process(array<Int16>^ data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (data == nullptr || data->Length == 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<Int16> dataPtr = &data[0];
+			return _Process(data, dataPtr, SampleFormat::Int16, samplesPerChannel, fillMode);
+		}
+
+		bool SoftwareTrigger::TryAcquireCapture([Out] TriggerCapture% capture) {
+
+			Native::TriggerCapture native;
+
+			if (_core == nullptr || !_core->TryAcquireCapture(native)) {
+				capture = TriggerCapture();
+				return false;
+			}
+
+			_FillCapture(native, capture);
+			return true;
+		}
+
+		bool SoftwareTrigger::WaitForCapture(int timeoutMs, [Out] TriggerCapture% capture) {
+
+			Native::TriggerCapture native;
+
+			if (_core == nullptr
+				|| !_core->WaitAcquireCapture(native, (uInt32)Math::Max(timeoutMs, 0))) {
+				capture = TriggerCapture();
+				return false;
+			}
+
+			_FillCapture(native, capture);
+			return true;
+		}
+
+		void SoftwareTrigger::ReleaseCapture() {
+			if (_core != nullptr) {
+				_core->ReleaseCapture();
+			}
+		}
+
+		int SoftwareTrigger::PendingCaptures::get() {
+			return (_core != nullptr) ? (int)_core->PendingCaptures() : 0;
+		}
+
+		UInt64 SoftwareTrigger::SamplesScanned::get() {
+			return (_core != nullptr) ? _core->Counters().samplesScanned : 0;
+		}
+
+		UInt64 SoftwareTrigger::Triggers::get() {
+			return (_core != nullptr) ? _core->Counters().triggers : 0;
+		}
+
+		UInt64 SoftwareTrigger::CapturesDropped::get() {
+			return (_core != nullptr) ? _core->Counters().capturesDropped : 0;
+		}
+
+		Native::SoftwareTriggerCore* SoftwareTrigger::_GetCore() {
+			return _core;
+		}
+
+		void SoftwareTrigger::_FillCapture(const Native::TriggerCapture& native,
+			TriggerCapture% capture) {
+
+			capture.Data = IntPtr(const_cast<void*>(native.data));
+			capture.SamplesPerChannel = (int)native.samplesPerChannel;
+			capture.Channels = (int)native.channels;
+			capture.Format = (SampleFormat)native.format;
+			capture.FillMode = (ReadbacklFillMode)native.fillMode;
+			capture.TriggerSample = native.triggerSample;
+			capture.FirstSample = native.firstSample;
+			capture.Slope = (TriggerSlope)native.slope;
+			capture.Sequence = native.sequence;
+		}
+	}
+}
@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "AcquisitionEngine.h"
+#include "RawScaler.h"
+#include "Native/SoftwareTriggerCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		public enum class TriggerSlope
+		{
+			Rising = (int)Native::TriggerSlope::Rising,
+			Falling = (int)Native::TriggerSlope::Falling,
+			Either = (int)Native::TriggerSlope::Either
+		};
+
+		/**
+		* @brief Zero-copy view of one window captured by a `SoftwareTrigger`.
+		*
+		* `Data` points into the native capture ring and is valid until
+		* `SoftwareTrigger::ReleaseCapture` is called.
+		*/
+		public value struct TriggerCapture
+		{
+			IntPtr Data;
+			int SamplesPerChannel;
+			int Channels;
+			SampleFormat Format;
+			ReadbacklFillMode FillMode;
+
+			/** Index, per channel, of the sample that fired the trigger. */
+			UInt64 TriggerSample;
+
+			/** Index of the first sample of the window. */
+			UInt64 FirstSample;
+
+			/** `Rising` or `Falling`. */
+			TriggerSlope Slope;
+
+			UInt64 Sequence;
+
+			property int SampleCount {
+				int get() { return SamplesPerChannel * Channels; }
+			}
+		};
+
+		/**
+		* @brief Settings of a `SoftwareTrigger`.
+		*/
+		public ref class SoftwareTriggerConfiguration
+		{
+		public:
+			SoftwareTriggerConfiguration();
+
+			/** Number of channels in each block. */
+			property int Channels;
+
+			/** Channel the condition is evaluated on. */
+			property int SourceChannel;
+
+			/** `Float64` or `Int16`. */
+			property SampleFormat Format;
+
+			property TriggerSlope Slope;
+
+			/** Trigger level, in the units of the data; for `Int16` in volts
+			*   once `SetScaling` was given a scaler. */
+			property double Level;
+
+			/** Distance below (rising) or above (falling) the level the signal
+			*   must reach before the trigger re-arms. */
+			property double Hysteresis;
+
+			/** Samples per channel captured before the trigger sample. */
+			property int PreTriggerSamples;
+
+			/** Samples per channel captured from the trigger sample on. */
+			property int PostTriggerSamples;
+
+			/** Samples after a trigger during which no new trigger fires. */
+			property int HoldoffSamples;
+
+			/** Largest block accepted, in samples per channel. */
+			property int MaxSamplesPerChannel;
+
+			/** Completed windows kept until they are consumed. */
+			property int CaptureSlots;
+
+			/** Layout of the captured windows. */
+			property ReadbacklFillMode CaptureFillMode;
+
+		internal:
+			Native::SoftwareTriggerConfig ToNative();
+		};
+
+		/**
+		* @brief Native level trigger with hysteresis and slope on one channel
+		*        of a continuous stream, with pre/post-trigger windows.
+		*
+		* Blocks go through a native history ring and the source channel is
+		* scanned with SIMD kernels; only the captured windows are handed out,
+		* as zero-copy views. Feed it blocks with `Process`, or give it to
+		* `AcquisitionEngine::SetTrigger` to scan every block on the driver
+		* thread before it reaches managed code.
+		*
+		* Methods return `0` on success or a status code;
+		* `DAQmxCLIWrapper::GetErrorDescription` describes all of them.
+		*/
+		public ref class SoftwareTrigger
+		{
+		private:
+			Native::SoftwareTriggerCore* _core;
+			RawScaler^ _scaler;
+
+		public:
+			SoftwareTrigger();
+			~SoftwareTrigger();
+			!SoftwareTrigger();
+
+			/**
+			* @brief Allocates the history and the capture ring and resets.
+			*/
+			int Configure(SoftwareTriggerConfiguration^ configuration);
+
+			/**
+			* @brief For `Int16` data, takes the level and the hysteresis in
+			*        volts and converts them with the offset and gain of the
+			*        source channel; `nullptr` compares raw codes.
+			*/
+			int SetScaling(RawScaler^ scaler);
+
+			/**
+			* @brief Clears the history, the detector and the captures. No
+			*        capture may be held.
+			*/
+			void Reset();
+
+			/**
+			* @brief Appends one block and scans it.
+			*
+			* @return The number of triggers in the block, or a negative
+			*         status code.
+			*/
+			int Process(array<double>^ data, int samplesPerChannel,
+				ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Appends one block of raw codes and scans it.
+			*/
+			int Process(array<Int16>^ data, int samplesPerChannel,
+				ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Gets the oldest completed window without waiting.
+			*/
+			bool TryAcquireCapture([Out] TriggerCapture% capture);
+
+			/**
+			* @brief Waits up to `timeoutMs` for a completed window.
+			*/
+			bool WaitForCapture(int timeoutMs, [Out] TriggerCapture% capture);
+
+			/**
+			* @brief Returns the window taken by the last successful call to
+			*        `TryAcquireCapture` or `WaitForCapture`.
+			*/
+			void ReleaseCapture();
+
+			property int PendingCaptures {
+				int get();
+			}
+
+			property UInt64 SamplesScanned {
+				UInt64 get();
+			}
+
+			property UInt64 Triggers {
+				UInt64 get();
+			}
+
+			/** Triggers whose window was lost because no slot was free. */
+			property UInt64 CapturesDropped {
+				UInt64 get();
+			}
+
+		internal:
+			Native::SoftwareTriggerCore* _GetCore();
+
+			/** The engine running this stage, if any; see `AcquisitionEngine::_ReleaseStage`. */
+			AcquisitionEngine^ _engine;
+
+		private:
+			int _Process(Array^ data, const void* samples, SampleFormat format,
+				int samplesPerChannel, ReadbacklFillMode fillMode);
+			void _FillCapture(const Native::TriggerCapture& native, TriggerCapture% capture);
+		};
+	}
+}
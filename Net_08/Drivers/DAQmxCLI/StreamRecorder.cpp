@@ -0,0 +1,294 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "StreamRecorder.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		StreamRecorderConfiguration::StreamRecorderConfiguration() {
+
+			Native::StreamRecorderConfig defaults =
+				Native::DefaultStreamRecorderConfig();
+
+			Channels = (int)defaults.channels;
+			Format = (SampleFormat)defaults.format;
+			ChunkSamplesPerChannel = (int)defaults.chunkSamplesPerChannel;
+			QueueBlocks = (int)defaults.queueBlocks;
+			QueueSamplesPerChannel = (int)defaults.queueSamplesPerChannel;
+			SampleRate = defaults.sampleRate;
+			ReserveBytes = (Int64)defaults.reserveBytes;
+			SyncOnClose = defaults.syncOnClose;
+		}
+
+		Native::StreamRecorderConfig StreamRecorderConfiguration::ToNative() {
+
+			Native::StreamRecorderConfig config =
+				Native::DefaultStreamRecorderConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.format = (Native::SampleFormat)Format;
+			config.chunkSamplesPerChannel = (uInt32)Math::Max(ChunkSamplesPerChannel, 0);
+			config.queueBlocks = (uInt32)Math::Max(QueueBlocks, 0);
+			config.queueSamplesPerChannel = (uInt32)Math::Max(QueueSamplesPerChannel, 0);
+			config.sampleRate = SampleRate;
+			config.reserveBytes = (uInt64)Math::Max(ReserveBytes, (Int64)0);
+			config.syncOnClose = SyncOnClose;
+			return config;
+		}
+
+
+		StreamRecorder::StreamRecorder() : _channels(0), _sampleBytes(0) {
+			_core = new Native::StreamRecorderCore();
+		}
+
+		StreamRecorder::~StreamRecorder() {
+			this->!StreamRecorder();
+		}
+
+		StreamRecorder::!StreamRecorder() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		array<Byte>^ StreamRecorder::_Utf8Path(String^ path) {
+
+			array<Byte>^ encoded = Text::Encoding::UTF8->GetBytes(path);
+			array<Byte>^ terminated = gcnew array<Byte>(encoded->Length + 1);
+			Array::Copy(encoded, terminated, encoded->Length);
+			return terminated;
+		}
+
+		int StreamRecorder::Open(String^ path,
+			StreamRecorderConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (String::IsNullOrEmpty(path) || configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::StreamRecorderConfig config = configuration->ToNative();
+			array<Byte>^ utf8 = _Utf8Path(path);
+			pin_ptr<Byte> utf8Ptr = &utf8[0];
+
+			int result = _core->Open(reinterpret_cast<const char*>(utf8Ptr), config);
+
+			if (result == Native::NativeSuccess) {
+				_channels = (int)config.channels;
+				_sampleBytes = (int)Native::SampleSize(config.format);
+			}
+			return result;
+		}
+
+		int StreamRecorder::Close() {
+			return (_core != nullptr) ? _core->Close() : 0;
+		}
+
+		bool StreamRecorder::IsOpen::get() {
+			return _core != nullptr && _core->IsOpen();
+		}
+
+		int StreamRecorder::CaptureScaling(IntPtr taskHandle) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			Native::RawScalingCore scaler;
+			int result = scaler.Capture((TaskHandle)taskHandle.ToPointer());
+
+			if (result < 0) {
+				return result;
+			}
+			return _core->SetScaling(scaler);
+		}
+
+		int StreamRecorder::SetScaling(RawScaler^ scaler) {
+
+			if (scaler == nullptr || scaler->Channels != _channels) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			for (int ch = 0; ch < _channels; ch++) {
+
+				int result = SetChannelCoefficients(ch, scaler->GetChannelCoefficients(ch));
+				if (result != Native::NativeSuccess) {
+					return result;
+				}
+			}
+			return Native::NativeSuccess;
+		}
+
+		int StreamRecorder::SetChannelCoefficients(int channel,
+			array<double>^ coefficients) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0 || coefficients == nullptr || coefficients->Length == 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			pin_ptr<float64> coefficientsPtr = &coefficients[0];
+			return _core->SetChannelCoefficients((uInt32)channel,
+				coefficientsPtr, (uInt32)coefficients->Length);
+		}
+
+		int StreamRecorder::_CheckArray(Array^ data, int samplesPerChannel,
+			int elementBytes) {
+
+			if (_core == nullptr || !_core->IsOpen()) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (data == nullptr || data->Length == 0 || samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if (elementBytes != _sampleBytes) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if ((Int64)data->Length < (Int64)_channels * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+			return Native::NativeSuccess;
+		}
+
+		int StreamRecorder::Append(AcquisitionBlock block) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			Native::BlockView view;
+			view.data = block.Data.ToPointer();
+			view.samplesPerChannel = (uInt32)Math::Max(block.SamplesPerChannel, 0);
+			view.channels = (uInt32)Math::Max(block.Channels, 0);
+			view.format = (Native::SampleFormat)block.Format;
+			view.fillMode = (int32)block.FillMode;
+			view.firstSample = block.FirstSample;
+			view.sequence = block.Sequence;
+			view.status = block.Status;
+			view.hostTimestampNs = block.HostTimestampNs;
+			view.samplesAcquired = block.SamplesAcquired;
+			return _core->Append(view);
+		}
+
+		int StreamRecorder::Append(array<Int16>^ data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			int result = _CheckArray(data, samplesPerChannel, sizeof(int16));
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<Int16> dataPtr = &data[0];
+			return _core->Append(dataPtr, (uInt32)samplesPerChannel, (int32)fillMode);
+		}
+
+		int StreamRecorder::Append(array<Int32>^ data, int samplesPerChannel,
+			ReadbacklFillMode fillMode) {
+
+			int result = _CheckArray(data, samplesPerChannel, sizeof(int32));
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<Int32> dataPtr = &data[0];
+			return _core->Append(dataPtr, (uInt32)samplesPerChannel, (int32)fillMode);
+		}
+
+		int StreamRecorder::Append(IntPtr data, int samplesPerChannel,
+			ReadbacklFillMode fillMode, Int64 firstSample) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (data == IntPtr::Zero || samplesPerChannel < 0 || firstSample < -1) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->Append(data.ToPointer(), (uInt32)samplesPerChannel,
+				(int32)fillMode, (firstSample < 0)
+					? Native::RecorderNextSample : (uInt64)firstSample);
+		}
+
+		int StreamRecorder::AppendRead(IntPtr taskHandle, array<Int16>^ data,
+			int samplesPerChannel, ReadbacklFillMode fillMode) {
+
+			int result = _CheckArray(data, samplesPerChannel, sizeof(int16));
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<Int16> dataPtr = &data[0];
+			return _core->AppendRead((TaskHandle)taskHandle.ToPointer(), dataPtr,
+				(uInt32)samplesPerChannel, (int32)fillMode);
+		}
+
+		int StreamRecorder::AppendRead(IntPtr taskHandle, array<Int32>^ data,
+			int samplesPerChannel, ReadbacklFillMode fillMode) {
+
+			int result = _CheckArray(data, samplesPerChannel, sizeof(int32));
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			pin_ptr<Int32> dataPtr = &data[0];
+			return _core->AppendRead((TaskHandle)taskHandle.ToPointer(), dataPtr,
+				(uInt32)samplesPerChannel, (int32)fillMode);
+		}
+
+		bool StreamRecorder::WaitIdle(int timeoutMs) {
+			return _core == nullptr || _core->WaitIdle((uInt32)Math::Max(timeoutMs, 0));
+		}
+
+		UInt64 StreamRecorder::BlocksAppended::get() {
+			return (_core != nullptr) ? _core->Counters().blocksAppended : 0;
+		}
+
+		UInt64 StreamRecorder::BlocksDropped::get() {
+			return (_core != nullptr) ? _core->Counters().blocksDropped : 0;
+		}
+
+		UInt64 StreamRecorder::SamplesWritten::get() {
+			return (_core != nullptr) ? _core->Counters().samplesWritten : 0;
+		}
+
+		UInt64 StreamRecorder::ChunksWritten::get() {
+			return (_core != nullptr) ? _core->Counters().chunksWritten : 0;
+		}
+
+		UInt64 StreamRecorder::FileBytes::get() {
+			return (_core != nullptr) ? _core->Counters().fileBytes : 0;
+		}
+
+		int StreamRecorder::LastError::get() {
+			return (_core != nullptr) ? _core->Counters().lastError : 0;
+		}
+	}
+}
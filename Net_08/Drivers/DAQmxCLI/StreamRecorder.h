@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "AcquisitionEngine.h"
+#include "RawScaler.h"
+#include "Native/StreamRecorderCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Settings of a `StreamRecorder`.
+		*/
+		public ref class StreamRecorderConfiguration
+		{
+		public:
+			StreamRecorderConfiguration();
+
+			/** Number of channels in each block. */
+			property int Channels;
+
+			/** Raw sample format: `Int16`, `Int32`, `UInt16` or `UInt32`. */
+			property SampleFormat Format;
+
+			/** Samples per channel in one chunk of the file. */
+			property int ChunkSamplesPerChannel;
+
+			/** Blocks buffered between `Append` and the writer thread. */
+			property int QueueBlocks;
+
+			/** Samples per channel in one queue slot; larger blocks are split. */
+			property int QueueSamplesPerChannel;
+
+			/** Sample clock rate stored in the file; `0` if unknown. */
+			property double SampleRate;
+
+			/** Step, in bytes, in which the file is grown and mapped. */
+			property Int64 ReserveBytes;
+
+			/** If `true`, `Close` waits until the data is on the disk. */
+			property bool SyncOnClose;
+
+		internal:
+			Native::StreamRecorderConfig ToNative();
+		};
+
+		/**
+		* @brief Records raw acquisition blocks to a chunked, memory-mapped file.
+		*
+		* `Append` copies the block into a preallocated native queue and returns
+		* without touching the file or the managed heap; a dedicated native
+		* thread writes the queued blocks into the file. Each chunk of the file
+		* keeps the index of its first sample, a host time stamp and the scaling
+		* polynomial of every channel; `RecordingReader` reads the files back.
+		*
+		* `Append` may be called from one thread at a time. Methods return `0`
+		* on success or a status code; `DAQmxCLIWrapper::GetErrorDescription`
+		* describes all of them.
+		*/
+		public ref class StreamRecorder
+		{
+		private:
+			Native::StreamRecorderCore* _core;
+			int _channels;
+			int _sampleBytes;
+
+		public:
+			StreamRecorder();
+			~StreamRecorder();
+			!StreamRecorder();
+
+			/**
+			* @brief Creates the file and starts the writer thread.
+			*
+			* @param[in] path Path of the recording; an existing file is replaced.
+			* @param[in] configuration Recorder settings.
+			*/
+			int Open(String^ path, StreamRecorderConfiguration^ configuration);
+
+			/**
+			* @brief Writes everything still queued and completes the file.
+			*
+			* @return `0`, or the last error the writer ran into.
+			*/
+			int Close();
+
+			property bool IsOpen {
+				bool get();
+			}
+
+			/**
+			* @brief Stores the device scaling of every channel of the task with
+			*        the following chunks.
+			*/
+			int CaptureScaling(IntPtr taskHandle);
+
+			/**
+			* @brief Stores the scaling of a `RawScaler` with the following chunks.
+			*/
+			int SetScaling(RawScaler^ scaler);
+
+			/**
+			* @brief Sets the polynomial of one channel; constant term first.
+			*/
+			int SetChannelCoefficients(int channel, array<double>^ coefficients);
+
+			/**
+			* @brief Queues a block from an `AcquisitionEngine`, with its sample
+			*        index and the host time of its read.
+			*/
+			int Append(AcquisitionBlock block);
+
+			/**
+			* @brief Queues a block of raw samples.
+			*
+			* @param[in] data `Channels * samplesPerChannel` samples.
+			* @param[in] samplesPerChannel Samples per channel in the block.
+			* @param[in] fillMode Layout of `data`.
+			*
+			* @return `0`, `NativeWarningBlocksDropped` (positive) if the queue was
+			*         full, or a negative error.
+			*/
+			int Append(array<Int16>^ data, int samplesPerChannel, ReadbacklFillMode fillMode);
+			int Append(array<Int32>^ data, int samplesPerChannel, ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Pointer variant of `Append`.
+			*
+			* @param[in] firstSample Index, per channel, of the first sample, or
+			*            `-1` to continue after the previous block.
+			*/
+			int Append(IntPtr data, int samplesPerChannel, ReadbacklFillMode fillMode,
+				Int64 firstSample);
+
+			/**
+			* @brief Queues a block that was just read from `taskHandle`, indexed
+			*        by the read position of the task.
+			*/
+			int AppendRead(IntPtr taskHandle, array<Int16>^ data, int samplesPerChannel,
+				ReadbacklFillMode fillMode);
+			int AppendRead(IntPtr taskHandle, array<Int32>^ data, int samplesPerChannel,
+				ReadbacklFillMode fillMode);
+
+			/**
+			* @brief Waits until the writer has emptied the queue.
+			*/
+			bool WaitIdle(int timeoutMs);
+
+			property UInt64 BlocksAppended {
+				UInt64 get();
+			}
+
+			property UInt64 BlocksDropped {
+				UInt64 get();
+			}
+
+			property UInt64 SamplesWritten {
+				UInt64 get();
+			}
+
+			property UInt64 ChunksWritten {
+				UInt64 get();
+			}
+
+			property UInt64 FileBytes {
+				UInt64 get();
+			}
+
+			property int LastError {
+				int get();
+			}
+
+		internal:
+			/** Null-terminated UTF-8 copy of a path, for the native file API. */
+			static array<Byte>^ _Utf8Path(String^ path);
+
+		private:
+			int _CheckArray(Array^ data, int samplesPerChannel, int elementBytes);
+		};
+	}
+}
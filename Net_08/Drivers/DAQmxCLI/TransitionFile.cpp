@@ -0,0 +1,279 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TransitionFile.h"
+#include "StreamRecorder.h"
+#include "Native/NativeStatus.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		TransitionWriterConfiguration::TransitionWriterConfiguration() {
+
+			Native::TransitionWriterConfig defaults = Native::DefaultTransitionWriterConfig();
+
+			Channels = (int)defaults.channels;
+			SampleBytes = (int)defaults.sampleBytes;
+			Mask = defaults.mask;
+			SampleRate = defaults.sampleRate;
+			ReserveBytes = (Int64)defaults.reserveBytes;
+			SyncOnClose = defaults.syncOnClose;
+		}
+
+		Native::TransitionWriterConfig TransitionWriterConfiguration::ToNative() {
+
+			Native::TransitionWriterConfig config = Native::DefaultTransitionWriterConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.sampleBytes = (uInt32)Math::Max(SampleBytes, 0);
+			config.mask = Mask;
+			config.sampleRate = SampleRate;
+			config.reserveBytes = (uInt64)Math::Max(ReserveBytes, (Int64)0);
+			config.syncOnClose = SyncOnClose;
+			return config;
+		}
+
+
+		TransitionWriter::TransitionWriter() {
+			_core = new Native::TransitionWriterCore();
+		}
+
+		TransitionWriter::~TransitionWriter() {
+			this->!TransitionWriter();
+		}
+
+		TransitionWriter::!TransitionWriter() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int TransitionWriter::Create(String^ path,
+			TransitionWriterConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (String::IsNullOrEmpty(path) || configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::TransitionWriterConfig config = configuration->ToNative();
+			array<Byte>^ utf8 = StreamRecorder::_Utf8Path(path);
+			pin_ptr<Byte> utf8Ptr = &utf8[0];
+
+			return _core->Create(reinterpret_cast<const char*>(utf8Ptr), config);
+		}
+
+		int TransitionWriter::Append(array<DigitalTransition>^ transitions, int count) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (transitions == nullptr || count < 0 || count > transitions->Length) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			const int batchSize = 256;
+			Native::DigitalTransition batch[batchSize];
+
+			for (int offset = 0; offset < count; offset += batchSize) {
+
+				const int n = Math::Min(batchSize, count - offset);
+
+				for (int k = 0; k < n; k++) {
+					DigitalTransition% t = transitions[offset + k];
+					batch[k].sampleIndex = t.SampleIndex;
+					batch[k].channel = (uInt32)t.Channel;
+					batch[k].value = t.Value;
+					batch[k].changed = t.Changed;
+					batch[k].reserved = 0;
+				}
+
+				int result = _core->Append(batch, (size_t)n);
+				if (result < 0) {
+					return result;
+				}
+			}
+			return Native::NativeSuccess;
+		}
+
+		int TransitionWriter::AppendFrom(EdgeExtractor^ extractor) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (extractor == nullptr || extractor->_GetCore() == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->AppendFrom(*extractor->_GetCore());
+		}
+
+		void TransitionWriter::SetSamplesPerChannel(UInt64 samplesPerChannel) {
+			if (_core != nullptr) {
+				_core->SetSamplesPerChannel(samplesPerChannel);
+			}
+		}
+
+		int TransitionWriter::Close() {
+			return (_core != nullptr) ? _core->Close() : 0;
+		}
+
+		bool TransitionWriter::IsOpen::get() {
+			return (_core != nullptr) && _core->IsOpen();
+		}
+
+		UInt64 TransitionWriter::TransitionCount::get() {
+			return (_core != nullptr) ? _core->TransitionCount() : 0;
+		}
+
+		UInt64 TransitionWriter::DataBytes::get() {
+			return (_core != nullptr) ? _core->DataBytes() : 0;
+		}
+
+
+		TransitionReader::TransitionReader() {
+			_core = new Native::TransitionReaderCore();
+		}
+
+		TransitionReader::~TransitionReader() {
+			this->!TransitionReader();
+		}
+
+		TransitionReader::!TransitionReader() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int TransitionReader::Open(String^ path) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (String::IsNullOrEmpty(path)) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			array<Byte>^ utf8 = StreamRecorder::_Utf8Path(path);
+			pin_ptr<Byte> utf8Ptr = &utf8[0];
+
+			return _core->Open(reinterpret_cast<const char*>(utf8Ptr));
+		}
+
+		void TransitionReader::Close() {
+			if (_core != nullptr) {
+				_core->Close();
+			}
+		}
+
+		int TransitionReader::Read(array<DigitalTransition>^ transitions) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+
+			if (transitions == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			const int batchSize = 256;
+			Native::DigitalTransition batch[batchSize];
+			int total = 0;
+
+			while (total < transitions->Length) {
+
+				const int n = _core->Read(batch,
+					(uInt32)Math::Min(batchSize, transitions->Length - total));
+
+				if (n < 0) {
+					return (total > 0) ? total : n;
+				}
+
+				for (int k = 0; k < n; k++) {
+					DigitalTransition% t = transitions[total++];
+					t.SampleIndex = batch[k].sampleIndex;
+					t.Channel = (int)batch[k].channel;
+					t.Value = batch[k].value;
+					t.Changed = batch[k].changed;
+				}
+
+				if (n < batchSize) {
+					break;
+				}
+			}
+			return total;
+		}
+
+		void TransitionReader::Rewind() {
+			if (_core != nullptr) {
+				_core->Rewind();
+			}
+		}
+
+		int TransitionReader::Channels::get() {
+			const Native::TransitionFileHeader* header = (_core != nullptr) ? _core->Header() : nullptr;
+			return (header != nullptr) ? (int)header->channels : 0;
+		}
+
+		int TransitionReader::SampleBytes::get() {
+			const Native::TransitionFileHeader* header = (_core != nullptr) ? _core->Header() : nullptr;
+			return (header != nullptr) ? (int)header->sampleBytes : 0;
+		}
+
+		UInt32 TransitionReader::Mask::get() {
+			const Native::TransitionFileHeader* header = (_core != nullptr) ? _core->Header() : nullptr;
+			return (header != nullptr) ? header->mask : 0;
+		}
+
+		UInt64 TransitionReader::TransitionCount::get() {
+			const Native::TransitionFileHeader* header = (_core != nullptr) ? _core->Header() : nullptr;
+			return (header != nullptr) ? header->transitionCount : 0;
+		}
+
+		UInt64 TransitionReader::SamplesPerChannel::get() {
+			const Native::TransitionFileHeader* header = (_core != nullptr) ? _core->Header() : nullptr;
+			return (header != nullptr) ? header->samplesPerChannel : 0;
+		}
+
+		double TransitionReader::SampleRate::get() {
+			const Native::TransitionFileHeader* header = (_core != nullptr) ? _core->Header() : nullptr;
+			return (header != nullptr) ? header->sampleRate : 0.0;
+		}
+
+		bool TransitionReader::IsComplete::get() {
+			return (_core != nullptr) && _core->IsComplete();
+		}
+
+		UInt64 TransitionReader::Position::get() {
+			return (_core != nullptr) ? _core->Position() : 0;
+		}
+	}
+}
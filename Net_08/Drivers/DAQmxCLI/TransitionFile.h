@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+
+#include "EdgeExtractor.h"
+#include "Native/TransitionWriterCore.h"
+#include "Native/TransitionReaderCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Settings of a `TransitionWriter`.
+		*/
+		public ref class TransitionWriterConfiguration
+		{
+		public:
+			TransitionWriterConfiguration();
+
+			property int Channels;
+
+			/** Bytes of the sampled words: 1, 2 or 4. */
+			property int SampleBytes;
+
+			/** Lines that were watched, for information. */
+			property UInt32 Mask;
+
+			/** Sample clock rate stored in the header, or `0`. */
+			property double SampleRate;
+
+			/** Bytes the file grows by when it is full. */
+			property Int64 ReserveBytes;
+
+			/** Flush the file to disk when it is closed. */
+			property bool SyncOnClose;
+
+		internal:
+			Native::TransitionWriterConfig ToNative();
+		};
+
+		/**
+		* @brief Writes transition records to a compact memory-mapped file.
+		*
+		* Each record is stored as a varint-coded gap since the previous one,
+		* the channel and the changed lines, typically 2 or 3 bytes. The
+		* header is kept current after every append, so a file can be read
+		* while it is written and survives a crash up to the last append.
+		*
+		* Methods return `0` on success or a status code.
+		*/
+		public ref class TransitionWriter
+		{
+		private:
+			Native::TransitionWriterCore* _core;
+
+		public:
+			TransitionWriter();
+			~TransitionWriter();
+			!TransitionWriter();
+
+			/**
+			* @brief Creates or replaces the file at `path`.
+			*/
+			int Create(String^ path, TransitionWriterConfiguration^ configuration);
+
+			/**
+			* @brief Appends the first `count` transitions of `transitions`.
+			*
+			* They must be ordered by sample index and follow the ones
+			* already written.
+			*/
+			int Append(array<DigitalTransition>^ transitions, int count);
+
+			/**
+			* @brief Appends every transition pending in `extractor` and
+			*        records the samples it has processed.
+			*/
+			int AppendFrom(EdgeExtractor^ extractor);
+
+			/**
+			* @brief Records the samples per channel covered by the file.
+			*/
+			void SetSamplesPerChannel(UInt64 samplesPerChannel);
+
+			/**
+			* @brief Marks the file complete and trims it to its data.
+			*/
+			int Close();
+
+			property bool IsOpen {
+				bool get();
+			}
+
+			property UInt64 TransitionCount {
+				UInt64 get();
+			}
+
+			/** Bytes of records written after the header. */
+			property UInt64 DataBytes {
+				UInt64 get();
+			}
+		};
+
+		/**
+		* @brief Reads the files written by `TransitionWriter`.
+		*
+		* The file is mapped; records are decoded on demand, so files of any
+		* size can be read in chunks.
+		*/
+		public ref class TransitionReader
+		{
+		private:
+			Native::TransitionReaderCore* _core;
+
+		public:
+			TransitionReader();
+			~TransitionReader();
+			!TransitionReader();
+
+			/**
+			* @brief Opens the file at `path` and checks its header.
+			*/
+			int Open(String^ path);
+
+			void Close();
+
+			/**
+			* @brief Decodes the next transitions into `transitions`.
+			*
+			* @return The number decoded, `0` at the end of the file, or a
+			*         negative status code for a corrupt record.
+			*/
+			int Read(array<DigitalTransition>^ transitions);
+
+			/**
+			* @brief Starts reading again from the first transition.
+			*/
+			void Rewind();
+
+			property int Channels {
+				int get();
+			}
+
+			property int SampleBytes {
+				int get();
+			}
+
+			property UInt32 Mask {
+				UInt32 get();
+			}
+
+			property UInt64 TransitionCount {
+				UInt64 get();
+			}
+
+			property UInt64 SamplesPerChannel {
+				UInt64 get();
+			}
+
+			property double SampleRate {
+				double get();
+			}
+
+			/** `true` if the writer closed the file normally. */
+			property bool IsComplete {
+				bool get();
+			}
+
+			/** Transitions read since the open or the last rewind. */
+			property UInt64 Position {
+				UInt64 get();
+			}
+		};
+	}
+}
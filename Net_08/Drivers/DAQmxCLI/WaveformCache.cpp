@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveformCache.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		WaveformStimulusChannel::WaveformStimulusChannel() {
+			Waveform = gcnew WaveformChannelSettings();
+			C0 = 0.0;
+			C1 = 1.0;
+		}
+
+		WaveformStimulus::WaveformStimulus(int channels) {
+
+			_channels = gcnew array<WaveformStimulusChannel^>(Math::Max(channels, 0));
+
+			for (int ch = 0; ch < _channels->Length; ch++) {
+				_channels[ch] = gcnew WaveformStimulusChannel();
+			}
+
+			SampleRate = Native::DefaultWaveformGeneratorConfig().sampleRate;
+			FillMode = ReadbacklFillMode::ByChannel;
+			SamplesPerChannel = 1000;
+		}
+
+		WaveformCacheConfiguration::WaveformCacheConfiguration() {
+			MemoryCapBytes = (Int64)Native::DefaultWaveformCacheConfig().memoryCapBytes;
+		}
+
+		Native::WaveformCacheConfig WaveformCacheConfiguration::ToNative() {
+
+			Native::WaveformCacheConfig config = Native::DefaultWaveformCacheConfig();
+			config.memoryCapBytes = (uInt64)Math::Max(MemoryCapBytes, (Int64)0);
+			return config;
+		}
+
+		WaveformCache::WaveformCache() {
+			_core = new Native::WaveformCacheCore();
+		}
+
+		WaveformCache::~WaveformCache() {
+			this->!WaveformCache();
+		}
+
+		WaveformCache::!WaveformCache() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int WaveformCache::Open(String^ path, WaveformCacheConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::WaveformCacheConfig config = configuration->ToNative();
+
+			if (String::IsNullOrEmpty(path)) {
+				return _core->Open(nullptr, config);
+			}
+
+			array<Byte>^ encoded = Text::Encoding::UTF8->GetBytes(path);
+			array<Byte>^ utf8 = gcnew array<Byte>(encoded->Length + 1);
+			Array::Copy(encoded, utf8, encoded->Length);
+			pin_ptr<Byte> utf8Ptr = &utf8[0];
+
+			return _core->Open(reinterpret_cast<const char*>(utf8Ptr), config);
+		}
+
+		int WaveformCache::Close() {
+			return (_core != nullptr) ? _core->Close() : 0;
+		}
+
+		bool WaveformCache::IsOpen::get() {
+			return _core != nullptr && _core->IsOpen();
+		}
+
+		int WaveformCache::Save() {
+			return (_core != nullptr) ? _core->Save() : Native::NativeErrorInvalidState;
+		}
+
+		void WaveformCache::Clear() {
+			if (_core != nullptr) {
+				_core->Clear();
+			}
+		}
+
+		int WaveformCache::_Acquire(WaveformStimulus^ stimulus, Native::WaveformCacheEntry* entry) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (stimulus == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			array<WaveformStimulusChannel^>^ channels = stimulus->Channels;
+			const int count = channels->Length;
+
+			std::vector<Native::WaveformStimulusChannel> native(count);
+			std::vector<Native::WaveformTone> tones;
+			std::vector<size_t> firstTone(count, 0);
+			array<GCHandle>^ tables = gcnew array<GCHandle>(count);
+
+			// Tones are copied; tables are pinned for the duration of the call.
+			for (int ch = 0; ch < count; ch++) {
+
+				WaveformStimulusChannel^ c = channels[ch];
+
+				if (c == nullptr || c->Waveform == nullptr) {
+					return Native::NativeErrorInvalidArgument;
+				}
+
+				firstTone[ch] = tones.size();
+				if (c->Tones != nullptr) {
+					for (int k = 0; k < c->Tones->Length; k++) {
+						Native::WaveformTone tone;
+						tone.frequency = c->Tones[k].Frequency;
+						tone.amplitude = c->Tones[k].Amplitude;
+						tone.phase = c->Tones[k].Phase;
+						tones.push_back(tone);
+					}
+				}
+			}
+
+			int result;
+
+			try {
+				for (int ch = 0; ch < count; ch++) {
+
+					WaveformStimulusChannel^ c = channels[ch];
+					Native::WaveformStimulusChannel& n = native[ch];
+
+					n.waveform = c->Waveform->ToNative();
+					n.c0 = c->C0;
+					n.c1 = c->C1;
+					n.toneCount = (c->Tones != nullptr) ? (uInt32)c->Tones->Length : 0;
+					n.tones = (n.toneCount > 0) ? tones.data() + firstTone[ch] : nullptr;
+					n.table = nullptr;
+					n.tableSize = 0;
+
+					if (c->Table != nullptr && c->Table->Length > 0) {
+						tables[ch] = GCHandle::Alloc(c->Table, GCHandleType::Pinned);
+						n.table = static_cast<const float64*>(tables[ch].AddrOfPinnedObject().ToPointer());
+						n.tableSize = (uInt32)c->Table->Length;
+					}
+				}
+
+				Native::WaveformStimulus s;
+				s.channels = (uInt32)count;
+				s.sampleRate = stimulus->SampleRate;
+				s.fillMode = (int32)stimulus->FillMode;
+				s.samplesPerChannel = (uInt32)Math::Max(stimulus->SamplesPerChannel, 0);
+				s.channelSettings = native.data();
+
+				result = _core->Acquire(s, entry);
+			}
+			finally {
+				for (int ch = 0; ch < count; ch++) {
+					if (tables[ch].IsAllocated) {
+						tables[ch].Free();
+					}
+				}
+			}
+
+			return result;
+		}
+
+		int WaveformCache::Write(IntPtr taskHandle, WaveformStimulus^ stimulus, bool autoStart,
+			double timeout, [Out] int% samplesPerChannelWritten) {
+
+			samplesPerChannelWritten = 0;
+
+			Native::WaveformCacheEntry entry;
+			int result = _Acquire(stimulus, &entry);
+
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			int32 written = 0;
+			result = DAQmxWriteBinaryI16((TaskHandle)taskHandle.ToPointer(),
+				(int32)entry.samplesPerChannel, autoStart ? 1 : 0, timeout,
+				entry.fillMode, entry.data, &written, NULL);
+
+			_core->Release(&entry);
+			samplesPerChannelWritten = written;
+			return result;
+		}
+
+		int WaveformCache::CopyTo(WaveformStimulus^ stimulus, Memory<Int16> block) {
+
+			Native::WaveformCacheEntry entry;
+			int result = _Acquire(stimulus, &entry);
+
+			if (result != Native::NativeSuccess) {
+				return result;
+			}
+
+			const Int64 samples = (Int64)entry.channels * entry.samplesPerChannel;
+
+			if (block.Length < samples) {
+				_core->Release(&entry);
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			std::memcpy(handle.Pointer, entry.data, (size_t)samples * sizeof(int16));
+			handle.Dispose();
+
+			_core->Release(&entry);
+			return Native::NativeSuccess;
+		}
+
+		UInt64 WaveformCache::Hits::get() {
+			return (_core != nullptr) ? _core->Counters().hits : 0;
+		}
+
+		UInt64 WaveformCache::Misses::get() {
+			return (_core != nullptr) ? _core->Counters().misses : 0;
+		}
+
+		UInt64 WaveformCache::Evictions::get() {
+			return (_core != nullptr) ? _core->Counters().evictions : 0;
+		}
+
+		UInt64 WaveformCache::Uncached::get() {
+			return (_core != nullptr) ? _core->Counters().uncached : 0;
+		}
+
+		UInt64 WaveformCache::EntriesLoaded::get() {
+			return (_core != nullptr) ? _core->Counters().entriesLoaded : 0;
+		}
+
+		UInt64 WaveformCache::EntriesRejected::get() {
+			return (_core != nullptr) ? _core->Counters().entriesRejected : 0;
+		}
+
+		UInt64 WaveformCache::Entries::get() {
+			return (_core != nullptr) ? _core->Counters().entries : 0;
+		}
+
+		UInt64 WaveformCache::Bytes::get() {
+			return (_core != nullptr) ? _core->Counters().bytes : 0;
+		}
+	}
+}
@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "DAQmxCLIWrapper.h"
+#include "WaveformGenerator.h"
+#include "Native/WaveformCacheCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief One channel of a cached stimulus.
+		*/
+		public ref class WaveformStimulusChannel
+		{
+		public:
+			WaveformStimulusChannel();
+
+			property WaveformChannelSettings^ Waveform;
+
+			/** Code scaling, `round(C0 + C1 * volts)`; e.g. the AO device
+			*   scaling coefficients of the channel. */
+			property double C0;
+			property double C1;
+
+			/** Tones of a `MultiTone` channel. */
+			property array<WaveformTone>^ Tones;
+
+			/** Cycle of a `Table` channel. */
+			property array<double>^ Table;
+		};
+
+		/**
+		* @brief A finite analog output stimulus, rendered from the start
+		*        phase of every channel.
+		*/
+		public ref class WaveformStimulus
+		{
+		public:
+			WaveformStimulus(int channels);
+
+			property array<WaveformStimulusChannel^>^ Channels {
+				array<WaveformStimulusChannel^>^ get() { return _channels; }
+			}
+
+			/** Sample clock rate of the output task, in Hz. */
+			property double SampleRate;
+
+			property ReadbacklFillMode FillMode;
+
+			property int SamplesPerChannel;
+
+		private:
+			array<WaveformStimulusChannel^>^ _channels;
+		};
+
+		/**
+		* @brief Settings of a `WaveformCache`.
+		*/
+		public ref class WaveformCacheConfiguration
+		{
+		public:
+			WaveformCacheConfiguration();
+
+			/** Most bytes of sample blocks held, in memory or mapped from the
+			*   cache file. */
+			property Int64 MemoryCapBytes;
+
+		internal:
+			Native::WaveformCacheConfig ToNative();
+		};
+
+		/**
+		* @brief Keeps pre-rendered, pre-scaled I16 blocks of repeated analog
+		*        output stimuli in native memory, least recently used out
+		*        first, and optionally in a memory-mapped file across runs.
+		*
+		* `Write` hands a cached block straight to `DAQmxWriteBinaryI16`; a
+		* stimulus seen before is neither synthesized nor scaled again.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the cache.
+		*/
+		public ref class WaveformCache
+		{
+		private:
+			Native::WaveformCacheCore* _core;
+
+		public:
+			WaveformCache();
+			~WaveformCache();
+			!WaveformCache();
+
+			/**
+			* @brief Opens the cache and loads the entries of the cache file.
+			*
+			* @param path Cache file, or `nullptr` for a cache held in memory
+			*             only. A damaged file is replaced at the next save.
+			*/
+			int Open(String^ path, WaveformCacheConfiguration^ configuration);
+
+			/**
+			* @brief Saves the cache if it has a file, then drops every entry.
+			*/
+			int Close();
+
+			property bool IsOpen {
+				bool get();
+			}
+
+			/**
+			* @brief Writes every entry to the cache file.
+			*/
+			int Save();
+
+			/**
+			* @brief Drops every entry.
+			*/
+			void Clear();
+
+			/**
+			* @brief Writes the block of `stimulus` to an analog output task
+			*        with `DAQmxWriteBinaryI16`, rendering it on a miss.
+			*/
+			int Write(IntPtr taskHandle, WaveformStimulus^ stimulus, bool autoStart,
+				double timeout, [Out] int% samplesPerChannelWritten);
+
+			/**
+			* @brief Copies the block of `stimulus`, rendering it on a miss.
+			*/
+			int CopyTo(WaveformStimulus^ stimulus, Memory<Int16> block);
+
+			property UInt64 Hits {
+				UInt64 get();
+			}
+
+			property UInt64 Misses {
+				UInt64 get();
+			}
+
+			/** Entries dropped to stay under the memory cap. */
+			property UInt64 Evictions {
+				UInt64 get();
+			}
+
+			/** Blocks rendered but too large to keep. */
+			property UInt64 Uncached {
+				UInt64 get();
+			}
+
+			/** Entries taken from the cache file at `Open`. */
+			property UInt64 EntriesLoaded {
+				UInt64 get();
+			}
+
+			/** Damaged entries, or files, dropped at `Open`. */
+			property UInt64 EntriesRejected {
+				UInt64 get();
+			}
+
+			property UInt64 Entries {
+				UInt64 get();
+			}
+
+			property UInt64 Bytes {
+				UInt64 get();
+			}
+
+		private:
+			int _Acquire(WaveformStimulus^ stimulus, Native::WaveformCacheEntry* entry);
+		};
+	}
+}
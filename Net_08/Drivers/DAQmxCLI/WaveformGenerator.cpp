@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveformGenerator.h"
+
+using namespace System;
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		WaveformChannelSettings::WaveformChannelSettings() {
+
+			Native::WaveformChannel defaults = Native::DefaultWaveformChannel();
+
+			Shape = (WaveformShape)defaults.shape;
+			Frequency = defaults.frequency;
+			Amplitude = defaults.amplitude;
+			Offset = defaults.offset;
+			Phase = defaults.phase;
+			DutyCycle = defaults.dutyCycle;
+			StopFrequency = defaults.stopFrequency;
+			SweepSeconds = defaults.sweepSeconds;
+		}
+
+		Native::WaveformChannel WaveformChannelSettings::ToNative() {
+
+			Native::WaveformChannel channel;
+			channel.shape = (Native::WaveformShape)Shape;
+			channel.frequency = Frequency;
+			channel.amplitude = Amplitude;
+			channel.offset = Offset;
+			channel.phase = Phase;
+			channel.dutyCycle = DutyCycle;
+			channel.stopFrequency = StopFrequency;
+			channel.sweepSeconds = SweepSeconds;
+			return channel;
+		}
+
+		WaveformGeneratorConfiguration::WaveformGeneratorConfiguration() {
+
+			Native::WaveformGeneratorConfig defaults =
+				Native::DefaultWaveformGeneratorConfig();
+
+			Channels = (int)defaults.channels;
+			SampleRate = defaults.sampleRate;
+			Format = (SampleFormat)defaults.format;
+			FillMode = (ReadbacklFillMode)defaults.fillMode;
+		}
+
+		Native::WaveformGeneratorConfig WaveformGeneratorConfiguration::ToNative() {
+
+			Native::WaveformGeneratorConfig config =
+				Native::DefaultWaveformGeneratorConfig();
+
+			config.channels = (uInt32)Math::Max(Channels, 0);
+			config.sampleRate = SampleRate;
+			config.format = (Native::SampleFormat)Format;
+			config.fillMode = (int32)FillMode;
+			return config;
+		}
+
+		WaveformGenerator::WaveformGenerator() {
+			_core = new Native::WaveformGeneratorCore();
+		}
+
+		WaveformGenerator::~WaveformGenerator() {
+			this->!WaveformGenerator();
+		}
+
+		WaveformGenerator::!WaveformGenerator() {
+			if (_core != nullptr) {
+				delete _core;
+				_core = nullptr;
+			}
+		}
+
+		int WaveformGenerator::Configure(WaveformGeneratorConfiguration^ configuration) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (configuration == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->Configure(configuration->ToNative());
+		}
+
+		bool WaveformGenerator::IsConfigured::get() {
+			return _core != nullptr && _core->IsConfigured();
+		}
+
+		int WaveformGenerator::SetChannel(int channel, WaveformChannelSettings^ settings) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0 || settings == nullptr) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->SetChannel((uInt32)channel, settings->ToNative());
+		}
+
+		int WaveformGenerator::SetTones(int channel, array<WaveformTone>^ tones) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0 || tones == nullptr || tones->Length > (int)Native::MaxWaveformTones) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			Native::WaveformTone native[Native::MaxWaveformTones];
+
+			for (int k = 0; k < tones->Length; k++) {
+				native[k].frequency = tones[k].Frequency;
+				native[k].amplitude = tones[k].Amplitude;
+				native[k].phase = tones[k].Phase;
+			}
+
+			return _core->SetTones((uInt32)channel, native, (uInt32)tones->Length);
+		}
+
+		int WaveformGenerator::SetTable(int channel, Memory<double> table) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			System::Buffers::MemoryHandle handle = table.Pin();
+			int result = _core->SetTable((uInt32)channel,
+				static_cast<const float64*>(handle.Pointer), (uInt32)table.Length);
+			handle.Dispose();
+			return result;
+		}
+
+		int WaveformGenerator::SetCodeScaling(int channel, double c0, double c1) {
+
+			if (_core == nullptr) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (channel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+
+			return _core->SetCodeScaling((uInt32)channel, c0, c1);
+		}
+
+		int WaveformGenerator::Render(Memory<double> block, int samplesPerChannel) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _Render(handle.Pointer, block.Length, SampleFormat::Float64, samplesPerChannel);
+			handle.Dispose();
+			return result;
+		}
+
+		int WaveformGenerator::Render(Memory<Int16> block, int samplesPerChannel) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _Render(handle.Pointer, block.Length, SampleFormat::Int16, samplesPerChannel);
+			handle.Dispose();
+			return result;
+		}
+
+		int WaveformGenerator::Render(Memory<Int32> block, int samplesPerChannel) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _Render(handle.Pointer, block.Length, SampleFormat::Int32, samplesPerChannel);
+			handle.Dispose();
+			return result;
+		}
+
+		int WaveformGenerator::Render(Memory<UInt16> block, int samplesPerChannel) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _Render(handle.Pointer, block.Length, SampleFormat::UInt16, samplesPerChannel);
+			handle.Dispose();
+			return result;
+		}
+
+		int WaveformGenerator::Render(Memory<UInt32> block, int samplesPerChannel) {
+
+			System::Buffers::MemoryHandle handle = block.Pin();
+			int result = _Render(handle.Pointer, block.Length, SampleFormat::UInt32, samplesPerChannel);
+			handle.Dispose();
+			return result;
+		}
+
+		int WaveformGenerator::_Render(void* block, Int64 length, SampleFormat format,
+			int samplesPerChannel) {
+
+			if (_core == nullptr || !_core->IsConfigured()) {
+				return Native::NativeErrorInvalidState;
+			}
+			if (samplesPerChannel < 0) {
+				return Native::NativeErrorInvalidArgument;
+			}
+			if ((SampleFormat)_core->Config().format != format) {
+				return Native::NativeErrorUnsupportedFormat;
+			}
+			if (length < (Int64)_core->Config().channels * samplesPerChannel) {
+				return Native::NativeErrorBufferTooSmall;
+			}
+
+			return _core->Render(block, (uInt32)samplesPerChannel);
+		}
+
+		void WaveformGenerator::Reset() {
+			if (_core != nullptr) {
+				_core->Reset();
+			}
+		}
+
+		UInt64 WaveformGenerator::Position::get() {
+			return (_core != nullptr) ? _core->Position() : 0;
+		}
+
+		Native::WaveformGeneratorCore* WaveformGenerator::_GetCore() {
+			return _core;
+		}
+	}
+}
@@ -0,0 +1,199 @@
+/*
+Copyright (c) 2024 vasilyevl (Grumpy). Permission is hereby granted,
+free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"),to deal in the Software
+without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Runtime::InteropServices;
+
+#include "AcquisitionEngine.h"
+#include "DAQmxCLIWrapper.h"
+#include "Native/WaveformGeneratorCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		/**
+		* @brief Waveform of one channel of a `WaveformGenerator`.
+		*/
+		public enum class WaveformShape
+		{
+			Sine = (int)Native::WaveformShape::Sine,
+			Square = (int)Native::WaveformShape::Square,
+			Triangle = (int)Native::WaveformShape::Triangle,
+			Chirp = (int)Native::WaveformShape::Chirp,			// Linear sweep, repeated
+			MultiTone = (int)Native::WaveformShape::MultiTone,	// Sum of the tones set with SetTones
+			Table = (int)Native::WaveformShape::Table			// Cycle set with SetTable
+		};
+
+		/**
+		* @brief One tone of a multi-tone channel.
+		*/
+		public value struct WaveformTone
+		{
+			/** In Hz. */
+			double Frequency;
+
+			/** Relative to the amplitude of the channel. */
+			double Amplitude;
+
+			/** Phase in cycles when the tones are set. */
+			double Phase;
+		};
+
+		/**
+		* @brief Waveform settings of one channel.
+		*/
+		public ref class WaveformChannelSettings
+		{
+		public:
+			WaveformChannelSettings();
+
+			property WaveformShape Shape;
+
+			/** In Hz; start frequency of a chirp, cycles per second of a table. */
+			property double Frequency;
+
+			/** Peak amplitude, in volts. */
+			property double Amplitude;
+
+			property double Offset;
+
+			/** Phase in cycles at `Reset` and when the shape changes. */
+			property double Phase;
+
+			/** Fraction of a square cycle spent high, 0 to 1. */
+			property double DutyCycle;
+
+			/** End frequency of a chirp, in Hz. */
+			property double StopFrequency;
+
+			/** Duration of one chirp sweep, in seconds. */
+			property double SweepSeconds;
+
+		internal:
+			Native::WaveformChannel ToNative();
+		};
+
+		/**
+		* @brief Settings of a `WaveformGenerator`.
+		*/
+		public ref class WaveformGeneratorConfiguration
+		{
+		public:
+			WaveformGeneratorConfiguration();
+
+			property int Channels;
+
+			/** Sample clock rate of the output task, in Hz. */
+			property double SampleRate;
+
+			/** `Float64` for volts; integer formats render device codes. */
+			property SampleFormat Format;
+
+			property ReadbacklFillMode FillMode;
+
+		internal:
+			Native::WaveformGeneratorConfig ToNative();
+		};
+
+		/**
+		* @brief Renders sine, square, triangle, chirp, multi-tone and table
+		*        waveforms in native code, straight into blocks in the device
+		*        format.
+		*
+		* The phase of every channel carries over from block to block. Setters
+		* may be called while another thread renders; they apply from the next
+		* block. Use `AnalogOutputEngine::WriteWaveform` to render into the
+		* output ring without any managed array.
+		*
+		* Methods return DAQmx status codes; `DAQmxCLIWrapper::GetErrorDescription`
+		* also describes the codes specific to the generator.
+		*/
+		public ref class WaveformGenerator
+		{
+		private:
+			Native::WaveformGeneratorCore* _core;
+
+		public:
+			WaveformGenerator();
+			~WaveformGenerator();
+			!WaveformGenerator();
+
+			/**
+			* @brief Sets every channel to a 1 kHz sine of 1 V.
+			*/
+			int Configure(WaveformGeneratorConfiguration^ configuration);
+
+			property bool IsConfigured {
+				bool get();
+			}
+
+			int SetChannel(int channel, WaveformChannelSettings^ settings);
+
+			/**
+			* @brief Sets the tones of a multi-tone channel; their phases restart.
+			*/
+			int SetTones(int channel, array<WaveformTone>^ tones);
+
+			/**
+			* @brief Sets one cycle of an arbitrary waveform, played with linear
+			*        interpolation.
+			*/
+			int SetTable(int channel, Memory<double> table);
+
+			/**
+			* @brief Sets the conversion to integer device codes,
+			*        `round(c0 + c1 * volts)`.
+			*/
+			int SetCodeScaling(int channel, double c0, double c1);
+
+			/**
+			* @brief Renders the next `samplesPerChannel` samples of every channel.
+			*/
+			int Render(Memory<double> block, int samplesPerChannel);
+
+			int Render(Memory<Int16> block, int samplesPerChannel);
+
+			int Render(Memory<Int32> block, int samplesPerChannel);
+
+			int Render(Memory<UInt16> block, int samplesPerChannel);
+
+			int Render(Memory<UInt32> block, int samplesPerChannel);
+
+			/**
+			* @brief Restarts every channel at its phase.
+			*/
+			void Reset();
+
+			/** Samples per channel rendered since the last reset. */
+			property UInt64 Position {
+				UInt64 get();
+			}
+
+		internal:
+			Native::WaveformGeneratorCore* _GetCore();
+
+		private:
+			int _Render(void* block, Int64 length, SampleFormat format, int samplesPerChannel);
+		};
+	}
+}
@@ -0,0 +1,776 @@
+// Checks the asynchronous reader (AsyncReaderCore): chains of reads that
+// resubmit from their completion, in every format and layout, driven by the
+// EveryNSamples event and by the shared poller; cancellation, queue limits
+// and detach with reads pending. Then serves many real-time tasks with it
+// and compares the CPU time and context switches with one thread blocked in
+// DAQmxReadAnalogF64 per task.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "BenchCommon.h"
+#include "Native/AsyncReaderCore.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			TaskHandle CreateAITask(uInt32 channels, float64 rate) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("async", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ai0:%u", channels - 1);
+				DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+					DAQmx_Val_ContSamps, 0);
+				return task;
+			}
+
+			bool WaitFor(const std::atomic<bool>& flag, double seconds) {
+
+				const auto start = std::chrono::steady_clock::now();
+
+				while (!flag.load()) {
+					if (SecondsSince(start) > seconds) {
+						return false;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				return true;
+			}
+
+			template <typename T, typename TExpected>
+			uInt32 Verify(const void* buffer, uInt32 channels, uInt32 n, int32 fillMode,
+				uInt64 first, TExpected expected) {
+
+				const T* data = static_cast<const T*>(buffer);
+				uInt32 bad = 0;
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					for (uInt32 i = 0; i < n; i++) {
+
+						const size_t index = (fillMode == DAQmx_Val_GroupByChannel)
+							? (size_t)ch * n + i : (size_t)i * channels + ch;
+						bad += (data[index] != (T)expected(ch, first + i)) ? 1 : 0;
+					}
+				}
+				return bad;
+			}
+
+			// A few reads in flight per task; each completion checks its samples
+			// and the order, then submits the next read into the same buffer.
+			struct ReadChain {
+
+				static const uInt32 Slots = 4;
+
+				AsyncReaderCore reader;
+				uInt32 channels;
+				SampleFormat format;
+				bool digital;
+				int32 fillMode;
+				uInt32 target;
+
+				std::vector<uint8_t> buffers[Slots];
+				uInt64 slotFirst[Slots];
+				uInt32 slotSamples[Slots];
+
+				// Touched only by the completion chain (and the first submits).
+				uInt64 nextTag;
+				uInt64 nextFirst;
+				uInt64 expectedTag;
+
+				std::atomic<uInt32> completed;
+				std::atomic<uInt32> bad;
+				std::atomic<uInt32> errors;
+				std::atomic<bool> done;
+
+				ReadChain() : channels(0), format(SampleFormat::Float64), digital(false),
+					fillMode(DAQmx_Val_GroupByChannel), target(0), nextTag(0), nextFirst(0),
+					expectedTag(0), completed(0), bad(0), errors(0), done(false) {}
+
+				static uInt32 SizeOf(uInt64 tag) {
+					// Ragged, mostly not multiples of the event N.
+					static const uInt32 sizes[] = { 37, 250, 1000, 1, 613, 2048, 99 };
+					return sizes[tag % 7];
+				}
+
+				int32 SubmitNext() {
+
+					const uInt32 slot = (uInt32)(nextTag % Slots);
+					const uInt32 n = SizeOf(nextTag);
+
+					AsyncReadRequest request;
+					request.data = buffers[slot].data();
+					request.bufferSizeInSamples = (uInt32)(buffers[slot].size() / SampleSize(format));
+					request.samplesPerChannel = n;
+					request.tag = nextTag;
+
+					slotFirst[slot] = nextFirst;
+					slotSamples[slot] = n;
+					nextTag++;
+					nextFirst += n;
+					return reader.Submit(request);
+				}
+
+				uInt32 VerifySlot(uInt32 slot) const {
+
+					const void* data = buffers[slot].data();
+					const uInt32 n = slotSamples[slot];
+					const uInt64 first = slotFirst[slot];
+
+					switch (format) {
+					case SampleFormat::Float64:
+						return Verify<float64>(data, channels, n, fillMode, first, SimScaledSample);
+					case SampleFormat::Int16:
+						return Verify<int16>(data, channels, n, fillMode, first, SimRawSample);
+					case SampleFormat::UInt16:
+						return digital
+							? Verify<uInt16>(data, channels, n, fillMode, first, SimDigitalSample)
+							: Verify<uInt16>(data, channels, n, fillMode, first,
+								[](uInt32 ch, uInt64 i) { return SimRawSample(ch, i) + 32768; });
+					default:
+						return Verify<uInt32>(data, channels, n, fillMode, first, SimDigitalSample);
+					}
+				}
+
+				static void OnCompleted(void* context, uInt64 tag, int32 status,
+					int32 sampsPerChanRead) {
+
+					ReadChain* chain = static_cast<ReadChain*>(context);
+					const uInt32 slot = (uInt32)(tag % Slots);
+
+					if (status < 0 || tag != chain->expectedTag
+						|| (uInt32)sampsPerChanRead != chain->slotSamples[slot]) {
+						chain->errors.fetch_add(1);
+					}
+					else {
+						chain->bad.fetch_add(chain->VerifySlot(slot));
+					}
+
+					chain->expectedTag = tag + 1;
+
+					if (chain->nextTag < chain->target) {
+						if (chain->SubmitNext() != 0) {
+							chain->errors.fetch_add(1);
+						}
+					}
+
+					if (chain->completed.fetch_add(1) + 1 == chain->target) {
+						chain->done.store(true);
+					}
+				}
+
+				int32 Start(TaskHandle task, const AsyncReaderConfig& config, uInt32 reads) {
+
+					channels = config.channels;
+					format = config.format;
+					digital = config.digital;
+					fillMode = config.fillMode;
+					target = reads;
+
+					for (std::vector<uint8_t>& buffer : buffers) {
+						buffer.assign((size_t)2048 * channels * SampleSize(format), 0);
+					}
+
+					int32 r = reader.Attach(task, config, &ReadChain::OnCompleted, this);
+
+					// The task is not started yet, so nothing completes while
+					// the first reads are queued.
+					for (uInt32 i = 0; i < Slots && r == 0; i++) {
+						r = SubmitNext();
+					}
+					return r;
+				}
+			};
+
+			const char* FormatName(SampleFormat format, bool digital) {
+				switch (format) {
+				case SampleFormat::Float64: return "F64";
+				case SampleFormat::Int16: return "I16";
+				case SampleFormat::UInt16: return digital ? "DU16" : "U16";
+				default: return "DU32";
+				}
+			}
+
+			int CheckChain(SampleFormat format, bool digital, int32 fillMode,
+				uInt32 notifySamples, uInt32 reads) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				const uInt32 channels = 3;
+				TaskHandle task = CreateAITask(channels, 100000.0);
+				DAQmxCfgInputBuffer(task, 8192);
+
+				AsyncReaderConfig config = DefaultAsyncReaderConfig();
+				config.channels = channels;
+				config.format = format;
+				config.digital = digital;
+				config.fillMode = fillMode;
+				config.notifySamples = notifySamples;
+				config.pollIntervalUs = 200;
+
+				std::unique_ptr<ReadChain> chain(new ReadChain());
+				BENCH_CHECK(chain->Start(task, config, reads) == 0, failures);
+				BENCH_CHECK(DAQmxStartTask(task) == 0, failures);
+
+				const bool finished = WaitFor(chain->done, 10.0);
+				DAQmxStopTask(task);
+
+				AsyncReaderCounters counters = chain->reader.Counters();
+				chain->reader.Detach();
+				DAQmxClearTask(task);
+
+				std::printf("  chain %-4s %-9s %s: %u reads, %u bad samples, %u errors, "
+					"%llu wakeups\n", FormatName(format, digital),
+					(fillMode == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan",
+					(notifySamples != 0) ? "event" : "poll ",
+					chain->completed.load(), chain->bad.load(), chain->errors.load(),
+					(unsigned long long)counters.wakeups);
+
+				BENCH_CHECK(finished, failures);
+				BENCH_CHECK(chain->bad.load() == 0, failures);
+				BENCH_CHECK(chain->errors.load() == 0, failures);
+				BENCH_CHECK(counters.completed == reads, failures);
+				BENCH_CHECK(counters.submitted == reads, failures);
+				return failures;
+			}
+
+			struct Completion {
+				uInt64 tag;
+				int32 status;
+				int32 read;
+			};
+
+			struct CompletionLog {
+
+				std::mutex mutex;
+				std::vector<Completion> entries;
+
+				static void OnCompleted(void* context, uInt64 tag, int32 status,
+					int32 sampsPerChanRead) {
+
+					CompletionLog* log = static_cast<CompletionLog*>(context);
+					std::lock_guard<std::mutex> lock(log->mutex);
+					log->entries.push_back({ tag, status, sampsPerChanRead });
+				}
+
+				bool Find(uInt64 tag, Completion& completion) {
+
+					std::lock_guard<std::mutex> lock(mutex);
+
+					for (const Completion& entry : entries) {
+						if (entry.tag == tag) {
+							completion = entry;
+							return true;
+						}
+					}
+					return false;
+				}
+
+				bool WaitFor(uInt64 tag, Completion& completion, double seconds) {
+
+					const auto start = std::chrono::steady_clock::now();
+
+					while (!Find(tag, completion)) {
+						if (SecondsSince(start) > seconds) {
+							return false;
+						}
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+					return true;
+				}
+
+				size_t Count() {
+					std::lock_guard<std::mutex> lock(mutex);
+					return entries.size();
+				}
+			};
+
+			int CheckCancellation(uInt32 notifySamples) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				const uInt32 channels = 2;
+				TaskHandle task = CreateAITask(channels, 10000.0);
+
+				AsyncReaderConfig config = DefaultAsyncReaderConfig();
+				config.channels = channels;
+				config.notifySamples = notifySamples;
+				config.pollIntervalUs = 500;
+				config.maxPending = 4;
+
+				CompletionLog log;
+				AsyncReaderCore reader;
+
+				AsyncReadRequest request;
+				std::vector<float64> big((size_t)1000000 * channels);
+				std::vector<float64> small((size_t)100 * channels);
+
+				request.data = small.data();
+				request.bufferSizeInSamples = (uInt32)small.size();
+				request.samplesPerChannel = 100;
+				request.tag = 1;
+				BENCH_CHECK(reader.Submit(request) == NativeErrorNotAttached, failures);
+
+				config.digital = true;
+				BENCH_CHECK(reader.Attach(task, config, &CompletionLog::OnCompleted, &log)
+					== NativeErrorUnsupportedFormat, failures);
+				config.digital = false;
+
+				BENCH_CHECK(reader.Attach(task, config, &CompletionLog::OnCompleted, &log) == 0, failures);
+				BENCH_CHECK(reader.Attach(task, config, &CompletionLog::OnCompleted, &log)
+					== NativeErrorInvalidState, failures);
+				BENCH_CHECK(DAQmxStartTask(task) == 0, failures);
+
+				// Rejected reads get no completion.
+				request.samplesPerChannel = 101;
+				BENCH_CHECK(reader.Submit(request) == NativeErrorBufferTooSmall, failures);
+				request.samplesPerChannel = 0;
+				BENCH_CHECK(reader.Submit(request) == NativeErrorInvalidArgument, failures);
+
+				// A read that cannot complete for 100 s holds up the one behind it
+				// until it is cancelled.
+				request.data = big.data();
+				request.bufferSizeInSamples = (uInt32)big.size();
+				request.samplesPerChannel = 1000000;
+				request.tag = 10;
+				BENCH_CHECK(reader.Submit(request) == 0, failures);
+
+				request.data = small.data();
+				request.bufferSizeInSamples = (uInt32)small.size();
+				request.samplesPerChannel = 100;
+				request.tag = 11;
+				BENCH_CHECK(reader.Submit(request) == 0, failures);
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				BENCH_CHECK(log.Count() == 0, failures);
+				BENCH_CHECK(reader.PendingReads() == 2, failures);
+				BENCH_CHECK(!reader.Cancel(12345), failures);
+
+				Completion completion = {};
+				BENCH_CHECK(reader.Cancel(10), failures);
+				BENCH_CHECK(log.WaitFor(10, completion, 1.0)
+					&& completion.status == NativeErrorCancelled && completion.read == 0, failures);
+				BENCH_CHECK(!reader.Cancel(10), failures);
+
+				// The next read takes the stream from where it stands; nothing
+				// was consumed by the cancelled one.
+				BENCH_CHECK(log.WaitFor(11, completion, 2.0)
+					&& completion.status == 0 && completion.read == 100, failures);
+
+				// Cancelling a read in the middle of the queue.
+				request.data = big.data();
+				request.bufferSizeInSamples = (uInt32)big.size();
+				request.samplesPerChannel = 1000000;
+
+				for (uInt64 tag = 20; tag < 24; tag++) {
+					request.tag = tag;
+					BENCH_CHECK(reader.Submit(request) == 0, failures);
+				}
+
+				request.tag = 24;
+				BENCH_CHECK(reader.Submit(request) == NativeErrorQueueFull, failures);
+				BENCH_CHECK(reader.Cancel(22), failures);
+				BENCH_CHECK(log.WaitFor(22, completion, 1.0)
+					&& completion.status == NativeErrorCancelled, failures);
+				BENCH_CHECK(reader.PendingReads() == 3, failures);
+
+				// Detach completes the rest as cancelled.
+				BENCH_CHECK(reader.Detach() == 0, failures);
+
+				uInt32 cancelled = 0;
+				for (uInt64 tag = 20; tag < 24; tag++) {
+					cancelled += (log.Find(tag, completion)
+						&& completion.status == NativeErrorCancelled) ? 1 : 0;
+				}
+
+				AsyncReaderCounters counters = reader.Counters();
+				DAQmxClearTask(task);
+
+				std::printf("  cancel %s: %zu completions, %llu cancelled, %llu completed\n",
+					(notifySamples != 0) ? "event" : "poll ", log.Count(),
+					(unsigned long long)counters.cancelled,
+					(unsigned long long)counters.completed);
+
+				BENCH_CHECK(cancelled == 4, failures);
+				BENCH_CHECK(log.Count() == 6, failures);
+				BENCH_CHECK(counters.cancelled == 5 && counters.completed == 1, failures);
+				BENCH_CHECK(reader.PendingReads() == 0, failures);
+				BENCH_CHECK(reader.Submit(request) == NativeErrorNotAttached, failures);
+				return failures;
+			}
+
+			// Several polled readers share one poller thread.
+			int CheckSharedPoller(uInt32 tasks, uInt32 reads) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				std::vector<TaskHandle> handles;
+				std::vector<std::unique_ptr<ReadChain>> chains;
+
+				AsyncReaderConfig config = DefaultAsyncReaderConfig();
+				config.channels = 2;
+				config.format = SampleFormat::Int16;
+				config.fillMode = DAQmx_Val_GroupByScanNumber;
+				config.notifySamples = 0;
+				config.pollIntervalUs = 100;
+
+				for (uInt32 t = 0; t < tasks; t++) {
+
+					handles.push_back(CreateAITask(config.channels, 50000.0));
+					DAQmxCfgInputBuffer(handles.back(), 8192);
+					chains.emplace_back(new ReadChain());
+					BENCH_CHECK(chains.back()->Start(handles.back(), config, reads) == 0, failures);
+					BENCH_CHECK(DAQmxStartTask(handles.back()) == 0, failures);
+				}
+
+				uInt32 finished = 0;
+				uInt32 bad = 0;
+				uInt32 errors = 0;
+
+				for (uInt32 t = 0; t < tasks; t++) {
+
+					finished += WaitFor(chains[t]->done, 10.0) ? 1 : 0;
+					DAQmxStopTask(handles[t]);
+					chains[t]->reader.Detach();
+					DAQmxClearTask(handles[t]);
+					bad += chains[t]->bad.load();
+					errors += chains[t]->errors.load();
+				}
+
+				std::printf("  shared poller: %u tasks x %u reads, %u finished, "
+					"%u bad samples, %u errors\n", tasks, reads, finished, bad, errors);
+
+				BENCH_CHECK(finished == tasks, failures);
+				BENCH_CHECK(bad == 0 && errors == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			// Detaches another reader, and tries its own, from a completion
+			// on the shared poller thread.
+			struct DetachingReader {
+
+				AsyncReaderCore reader;
+				AsyncReaderCore* other = nullptr;
+				std::atomic<int32> ownDetach{ 1 };
+				std::atomic<int32> otherDetach{ 1 };
+				std::atomic<bool> done{ false };
+
+				static void OnCompleted(void* context, uInt64 /*tag*/, int32 status,
+					int32 /*sampsPerChanRead*/) {
+
+					DetachingReader* self = static_cast<DetachingReader*>(context);
+
+					if (status == 0 && !self->done.load()) {
+						self->otherDetach.store(self->other->Detach());
+						self->ownDetach.store(self->reader.Detach());
+						self->done.store(true);
+					}
+				}
+			};
+
+			int CheckDetachFromCompletion() {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				AsyncReaderConfig config = DefaultAsyncReaderConfig();
+				config.channels = 2;
+				config.notifySamples = 0;
+				config.pollIntervalUs = 100;
+
+				TaskHandle first = CreateAITask(config.channels, 10000.0);
+				TaskHandle second = CreateAITask(config.channels, 10000.0);
+
+				DetachingReader detaching;
+				CompletionLog log;
+				AsyncReaderCore other;
+				detaching.other = &other;
+
+				BENCH_CHECK(detaching.reader.Attach(first, config, &DetachingReader::OnCompleted,
+					&detaching) == 0, failures);
+				BENCH_CHECK(other.Attach(second, config, &CompletionLog::OnCompleted, &log) == 0, failures);
+
+				std::vector<float64> buffer((size_t)100 * config.channels);
+				AsyncReadRequest request;
+				request.data = buffer.data();
+				request.bufferSizeInSamples = (uInt32)buffer.size();
+				request.samplesPerChannel = 100;
+				request.tag = 1;
+
+				// The other reader waits on a task that never starts.
+				BENCH_CHECK(other.Submit(request) == 0, failures);
+				BENCH_CHECK(detaching.reader.Submit(request) == 0, failures);
+				BENCH_CHECK(DAQmxStartTask(first) == 0, failures);
+
+				BENCH_CHECK(WaitFor(detaching.done, 5.0), failures);
+				BENCH_CHECK(detaching.otherDetach.load() == 0, failures);
+				BENCH_CHECK(detaching.ownDetach.load() == NativeErrorInvalidState, failures);
+
+				Completion completion = {};
+				BENCH_CHECK(log.Find(1, completion) && completion.status == NativeErrorCancelled, failures);
+				BENCH_CHECK(other.Submit(request) == NativeErrorNotAttached, failures);
+
+				BENCH_CHECK(detaching.reader.Detach() == 0, failures);
+				DAQmxClearTask(first);
+				DAQmxClearTask(second);
+
+				std::printf("  detach from a completion: other reader %d, own reader %d\n",
+					(int)detaching.otherDetach.load(), (int)detaching.ownDetach.load());
+
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			// Readers destroyed while the driver still calls the callback it
+			// picked before the event was unregistered.
+			int CheckDetachInFlight(uInt32 rounds) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+				SimSetCallbackDelay(500);
+
+				AsyncReaderConfig config = DefaultAsyncReaderConfig();
+				config.channels = 1;
+				config.notifySamples = 10;
+
+				TaskHandle task = CreateAITask(config.channels, 100000.0);
+				BENCH_CHECK(DAQmxStartTask(task) == 0, failures);
+
+				CompletionLog log;
+				uInt32 attached = 0;
+
+				for (uInt32 i = 0; i < rounds; i++) {
+
+					AsyncReaderCore* reader = new AsyncReaderCore();
+					attached += (reader->Attach(task, config, &CompletionLog::OnCompleted, &log) == 0) ? 1 : 0;
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+					delete reader;
+				}
+
+				DAQmxStopTask(task);
+				DAQmxClearTask(task);
+				SimSetCallbackDelay(0);
+
+				std::printf("  detach in flight: %u of %u readers attached to a running task\n",
+					attached, rounds);
+
+				BENCH_CHECK(attached == rounds, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			struct Usage {
+				double cpuSeconds;
+				long contextSwitches;
+			};
+
+			Usage ProcessUsage() {
+
+				Usage usage = { 0.0, 0 };
+#if defined(__unix__) || defined(__APPLE__)
+				rusage r;
+				getrusage(RUSAGE_SELF, &r);
+				usage.cpuSeconds = r.ru_utime.tv_sec + r.ru_stime.tv_sec
+					+ 1e-6 * (r.ru_utime.tv_usec + r.ru_stime.tv_usec);
+				usage.contextSwitches = r.ru_nvcsw + r.ru_nivcsw;
+#endif
+				return usage;
+			}
+
+			enum class ServeMode { ThreadPerTask, Event, Poll };
+
+			// `tasks` real-time tasks, each read in blocks of `block` samples
+			// for `seconds`, by blocked threads or by async readers.
+			int RunServe(ServeMode mode, uInt32 tasks, double seconds) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				const uInt32 channels = 4;
+				const float64 rate = 20000.0;
+				const uInt32 block = 200;
+
+				std::vector<TaskHandle> handles;
+				for (uInt32 t = 0; t < tasks; t++) {
+					handles.push_back(CreateAITask(channels, rate));
+				}
+
+				std::atomic<bool> stop(false);
+				std::atomic<uInt64> reads(0);
+				std::atomic<uInt32> errors(0);
+				std::vector<std::thread> threads;
+
+				struct Served {
+					AsyncReaderCore reader;
+					std::vector<float64> buffer;
+					std::atomic<bool>* stop;
+					std::atomic<uInt64>* reads;
+					std::atomic<uInt32>* errors;
+					uInt64 tag;
+				};
+
+				std::vector<std::unique_ptr<Served>> served;
+
+				AsyncReadCompletion resubmit = [](void* context, uInt64 /*tag*/, int32 status, int32) {
+
+					Served* s = static_cast<Served*>(context);
+
+					if (status < 0) {
+						if (status != NativeErrorCancelled) {
+							s->errors->fetch_add(1);
+						}
+						return;
+					}
+
+					s->reads->fetch_add(1, std::memory_order_relaxed);
+
+					if (!s->stop->load(std::memory_order_relaxed)) {
+						AsyncReadRequest request = { s->buffer.data(),
+							(uInt32)s->buffer.size(), 200, ++s->tag };
+						s->reader.Submit(request);
+					}
+				};
+
+				const Usage before = ProcessUsage();
+				const auto start = std::chrono::steady_clock::now();
+
+				for (uInt32 t = 0; t < tasks; t++) {
+
+					if (mode == ServeMode::ThreadPerTask) {
+
+						DAQmxStartTask(handles[t]);
+						threads.emplace_back([&, t]() {
+
+							std::vector<float64> buffer((size_t)block * channels);
+
+							while (!stop.load(std::memory_order_relaxed)) {
+
+								int32 read = 0;
+								int32 r = DAQmxReadAnalogF64(handles[t], (int32)block, 1.0,
+									DAQmx_Val_GroupByChannel, buffer.data(),
+									(uInt32)buffer.size(), &read, NULL);
+
+								if (r < 0) {
+									if (!stop.load()) {
+										errors.fetch_add(1);
+									}
+									break;
+								}
+								reads.fetch_add(1, std::memory_order_relaxed);
+							}
+						});
+						continue;
+					}
+
+					served.emplace_back(new Served());
+					Served* s = served.back().get();
+					s->buffer.assign((size_t)block * channels, 0.0);
+					s->stop = &stop;
+					s->reads = &reads;
+					s->errors = &errors;
+					s->tag = 0;
+
+					AsyncReaderConfig config = DefaultAsyncReaderConfig();
+					config.channels = channels;
+					config.notifySamples = (mode == ServeMode::Event) ? block : 0;
+					config.pollIntervalUs = 1000;
+
+					BENCH_CHECK(s->reader.Attach(handles[t], config, resubmit, s) == 0, failures);
+					DAQmxStartTask(handles[t]);
+
+					AsyncReadRequest request = { s->buffer.data(),
+						(uInt32)s->buffer.size(), block, 0 };
+					BENCH_CHECK(s->reader.Submit(request) == 0, failures);
+				}
+
+				std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+				stop.store(true);
+
+				const double elapsed = SecondsSince(start);
+				const Usage after = ProcessUsage();
+
+				for (uInt32 t = 0; t < tasks; t++) {
+					DAQmxStopTask(handles[t]);
+				}
+				for (std::thread& thread : threads) {
+					thread.join();
+				}
+				for (std::unique_ptr<Served>& s : served) {
+					s->reader.Detach();
+				}
+				for (TaskHandle handle : handles) {
+					DAQmxClearTask(handle);
+				}
+
+				const double expected = tasks * (rate / block) * elapsed;
+				const char* name = (mode == ServeMode::ThreadPerTask) ? "thread per task"
+					: (mode == ServeMode::Event) ? "async, event" : "async, poller";
+
+				std::printf("  %-16s %2u tasks: %2u reader threads, %6llu reads (%.0f%%), "
+					"CPU %5.1f%%, %7.0f context switches/s\n", name, tasks,
+					(mode == ServeMode::ThreadPerTask) ? tasks : (mode == ServeMode::Poll) ? 1 : 0,
+					(unsigned long long)reads.load(), 100.0 * reads.load() / expected,
+					100.0 * (after.cpuSeconds - before.cpuSeconds) / elapsed,
+					(after.contextSwitches - before.contextSwitches) / elapsed);
+
+				BENCH_CHECK(errors.load() == 0, failures);
+				BENCH_CHECK(reads.load() > 0.8 * expected, failures);
+				return failures;
+			}
+		}
+
+		int RunAsyncBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const uInt32 reads = options.quick ? 200 : 2000;
+
+			for (uInt32 notify : { 500u, 0u }) {
+				for (int32 fillMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+					failures += CheckChain(SampleFormat::Float64, false, fillMode, notify, reads);
+					failures += CheckChain(SampleFormat::Int16, false, fillMode, notify, reads);
+				}
+				failures += CheckChain(SampleFormat::UInt16, false, DAQmx_Val_GroupByChannel, notify, reads);
+				failures += CheckChain(SampleFormat::UInt16, true, DAQmx_Val_GroupByScanNumber, notify, reads);
+				failures += CheckChain(SampleFormat::UInt32, true, DAQmx_Val_GroupByChannel, notify, reads);
+			}
+
+			failures += CheckCancellation(500);
+			failures += CheckCancellation(0);
+			failures += CheckSharedPoller(8, reads);
+			failures += CheckDetachFromCompletion();
+			failures += CheckDetachInFlight(options.quick ? 200 : 2000);
+
+			const double seconds = options.quick ? 0.5 : 3.0;
+			const uInt32 tasks = 24;
+
+			failures += RunServe(ServeMode::ThreadPerTask, tasks, seconds);
+			failures += RunServe(ServeMode::Event, tasks, seconds);
+			failures += RunServe(ServeMode::Poll, tasks, seconds);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "SimulatedDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi;
+
+		/**
+		* @brief Options shared by all benchmarks.
+		*/
+		struct BenchOptions {
+
+			/** Short run used by ctest; long run when `false`. */
+			bool quick;
+		};
+
+		/**
+		* @brief Signature of a benchmark entry point. Returns the number of
+		*        failed checks.
+		*/
+		typedef int (*BenchFunction)(const BenchOptions& options);
+
+		/**
+		* @brief Seconds elapsed since `start`.
+		*/
+		inline double SecondsSince(std::chrono::steady_clock::time_point start) {
+			return std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+		}
+
+		/**
+		* @brief Prevents the optimizer from discarding a computed value.
+		*/
+		template <typename T>
+		inline void KeepAlive(const T& value) {
+			volatile T sink = value;
+			(void)sink;
+		}
+	}
+}
+
+#define BENCH_CHECK(condition, failures)                                  \
+	do {                                                                  \
+		if (!(condition)) {                                               \
+			std::printf("  CHECK FAILED %s:%d: %s\n",                     \
+				__FILE__, __LINE__, #condition);                          \
+			(failures)++;                                                 \
+		}                                                                 \
+	} while (0)
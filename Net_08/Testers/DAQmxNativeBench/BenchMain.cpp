@@ -0,0 +1,143 @@
+// DAQmxNativeBench : checks and benchmarks for the native engines of the
+// DAQmxNETDriver, run against the simulated NI-DAQmx stand-in.
+//
+// Usage: DAQmxNativeBench [--quick] [bench ...]
+// Without bench names every benchmark runs. Exit code is the number of
+// failed checks.
+
+#include <cstdio>
+#include <cstring>
+
+#include "BenchCommon.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		int RunEngineBench(const BenchOptions& options);
+		int RunPoolBench(const BenchOptions& options);
+		int RunScalingBench(const BenchOptions& options);
+		int RunLayoutBench(const BenchOptions& options);
+		int RunRecorderBench(const BenchOptions& options);
+		int RunDecimatorBench(const BenchOptions& options);
+		int RunStatisticsBench(const BenchOptions& options);
+		int RunTriggerBench(const BenchOptions& options);
+		int RunAsyncBench(const BenchOptions& options);
+		int RunClockBench(const BenchOptions& options);
+		int RunBitPackBench(const BenchOptions& options);
+		int RunEdgeBench(const BenchOptions& options);
+		int RunCodecBench(const BenchOptions& options);
+		int RunGroupBench(const BenchOptions& options);
+		int RunOutputBench(const BenchOptions& options);
+		int RunWaveformBench(const BenchOptions& options);
+		int RunCacheBench(const BenchOptions& options);
+		int RunControlBench(const BenchOptions& options);
+		int RunControllerBench(const BenchOptions& options);
+		int RunCallbackBench(const BenchOptions& options);
+
+		struct BenchEntry {
+			const char* name;
+			BenchFunction function;
+			const char* description;
+		};
+
+		const BenchEntry Benches[] = {
+			{ "engine", RunEngineBench,
+				"Continuous acquisition engine: native callback read into SPSC ring." },
+			{ "pool", RunPoolBench,
+				"Pinned buffer pool: polling reads into pooled vs per-call buffers." },
+			{ "scaling", RunScalingBench,
+				"Deferred raw I16 scaling: per-channel polynomial, SIMD kernels." },
+			{ "layout", RunLayoutBench,
+				"Fill mode conversion: cache-blocked SIMD interleave/deinterleave." },
+			{ "recorder", RunRecorderBench,
+				"Streaming recorder: chunked memory-mapped file, writer thread." },
+			{ "decimator", RunDecimatorBench,
+				"Decimation stage: polyphase FIR / CIC, SIMD, state across blocks." },
+			{ "statistics", RunStatisticsBench,
+				"Block statistics: SIMD moments, Chan merge, lock-free snapshot." },
+			{ "trigger", RunTriggerBench,
+				"Software trigger: level/hysteresis/slope, SIMD scan, captured windows." },
+			{ "async", RunAsyncBench,
+				"Async reads: completion on EveryNSamples/shared poller, cancellation." },
+			{ "clock", RunClockBench,
+				"Host timestamps: sample clock drift fit, outliers, engine tagging." },
+			{ "bitpack", RunBitPackBench,
+				"Packed digital lines: movemask/pdep kernels, packed read/write." },
+			{ "edges", RunEdgeBench,
+				"Digital edges: SIMD change scan, transition records, compact files." },
+			{ "codec", RunCodecBench,
+				"Lossless I16/I32 codec: prediction, zigzag, SIMD bit packing, threads." },
+			{ "group", RunGroupBench,
+				"Acquisition group: shared clock/trigger, start order, aligned frames." },
+			{ "output", RunOutputBench,
+				"AO streaming: producer ring, transfer-driven feeder, underflow/regeneration." },
+			{ "waveform", RunWaveformBench,
+				"Waveform synthesis: SIMD kernels, phase continuity, device formats, in-place AO." },
+			{ "cache", RunCacheBench,
+				"Waveform cache: pre-scaled I16 blocks, LRU under a memory cap, mapped persistence." },
+			{ "control", RunControlBench,
+				"HW-timed single-point loop: native control law, late iterations, loop-time histogram." },
+			{ "controller", RunControllerBench,
+				"Controllers: fixed-width PID/lead-lag/state-space, lock-free parameter swap, AO+DO." },
+			{ "callbacks", RunCallbackBench,
+				"Callback dispatch: native trampolines, MPSC queue, batched delivery on dispatch threads." },
+		};
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	using namespace Grumpy::DAQmxNativeBench;
+
+	BenchOptions options;
+	options.quick = false;
+
+	const char* selected[64];
+	int selectedCount = 0;
+
+	for (int i = 1; i < argc; i++) {
+
+		if (std::strcmp(argv[i], "--quick") == 0) {
+			options.quick = true;
+		}
+		else if (std::strcmp(argv[i], "--list") == 0) {
+			for (const BenchEntry& entry : Benches) {
+				std::printf("%-12s %s\n", entry.name, entry.description);
+			}
+			return 0;
+		}
+		else if (selectedCount < 64) {
+			selected[selectedCount++] = argv[i];
+		}
+	}
+
+	int failures = 0;
+	int ran = 0;
+
+	for (const BenchEntry& entry : Benches) {
+
+		bool run = (selectedCount == 0);
+
+		for (int i = 0; i < selectedCount && !run; i++) {
+			run = (std::strcmp(selected[i], entry.name) == 0);
+		}
+
+		if (!run) {
+			continue;
+		}
+
+		std::printf("== %s: %s\n", entry.name, entry.description);
+		int f = entry.function(options);
+		std::printf("== %s: %s\n\n", entry.name, (f == 0) ? "passed" : "FAILED");
+		failures += f;
+		ran++;
+	}
+
+	if (ran == 0) {
+		std::printf("No benchmark matched. Use --list.\n");
+		return 1;
+	}
+
+	return failures;
+}
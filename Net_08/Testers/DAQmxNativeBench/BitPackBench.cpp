@@ -0,0 +1,411 @@
+// Checks the line packing kernels (BitPackKernels) against a plain bit loop
+// for every SIMD level, bit offset and tail length, reads and writes packed
+// digital lines through the simulated driver in both fill modes, and
+// measures packing against handling one byte per line.
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/BitPackKernels.h"
+#include "Native/CpuFeatures.h"
+#include "Native/NativeStatus.h"
+#include "Native/PackedDigitalLines.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			void ReferencePack(const uInt8* lines, size_t count, uInt8* bits,
+				size_t bitOffset) {
+
+				for (size_t i = 0; i < count; i++) {
+
+					const size_t n = bitOffset + i;
+					const uInt8 mask = (uInt8)(1u << (n % 8));
+					bits[n / 8] = (lines[i] != 0) ? (uInt8)(bits[n / 8] | mask)
+						: (uInt8)(bits[n / 8] & ~mask);
+				}
+			}
+
+			void ReferenceUnpack(const uInt8* bits, size_t bitOffset, size_t count,
+				uInt8* lines) {
+
+				for (size_t i = 0; i < count; i++) {
+					const size_t n = bitOffset + i;
+					lines[i] = (uInt8)((bits[n / 8] >> (n % 8)) & 1);
+				}
+			}
+
+			int CheckKernels(std::mt19937& random) {
+
+				int failures = 0;
+				std::uniform_int_distribution<int> byte(0, 255);
+				const size_t counts[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 32, 33,
+					63, 64, 65, 127, 128, 129, 1000, 4099 };
+
+				for (size_t count : counts) {
+					for (size_t offset = 0; offset < 10; offset++) {
+
+						// Line bytes as DAQmx never produces them too: any
+						// non-zero byte is a high line.
+						std::vector<uInt8> lines(count);
+						for (uInt8& line : lines) {
+							const int value = byte(random);
+							line = (value < 128) ? 0 : (value < 192) ? 1 : (uInt8)value;
+						}
+
+						const size_t size = PackedLinesSize(offset + count) + 2;
+						std::vector<uInt8> expected(size), packed(size);
+
+						for (size_t i = 0; i < size; i++) {
+							expected[i] = packed[i] = (uInt8)byte(random);
+						}
+
+						ReferencePack(lines.data(), count, expected.data(), offset);
+						PackLines(lines.data(), count, packed.data(), offset);
+
+						if (packed != expected) {
+							failures++;
+							continue;
+						}
+
+						std::vector<uInt8> back(count + 1, 0xCD), reference(count + 1, 0xCD);
+						UnpackLines(packed.data(), offset, count, back.data());
+						ReferenceUnpack(packed.data(), offset, count, reference.data());
+
+						if (back != reference) {
+							failures++;
+						}
+					}
+				}
+				return failures;
+			}
+
+			// One DAQmxCreateDIChan/DOChan call per port, lines 0 .. lines - 1.
+			TaskHandle CreateDigitalTask(bool output, uInt32 ports, uInt32 lines,
+				int32 lineGrouping) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("bitpack", &task);
+
+				for (uInt32 port = 0; port < ports; port++) {
+
+					char physical[64];
+					std::snprintf(physical, sizeof(physical), "SimDev1/port%u/line0:%u",
+						port, lines - 1);
+
+					if (output) {
+						DAQmxCreateDOChan(task, physical, "", lineGrouping);
+					}
+					else {
+						DAQmxCreateDIChan(task, physical, "", lineGrouping);
+					}
+				}
+
+				if (!output) {
+					DAQmxCfgSampClkTiming(task, "", 100000.0, DAQmx_Val_Rising,
+						DAQmx_Val_ContSamps, 0);
+					DAQmxCfgInputBuffer(task, 16384);
+				}
+				return task;
+			}
+
+			// Reads `reads` times `samples` samples per channel packed and
+			// checks every bit against the simulated lines.
+			int CheckPackedRead(uInt32 ports, uInt32 lines, int32 lineGrouping,
+				int32 fillMode, uInt32 samples, uInt32 reads) {
+
+				int failures = 0;
+				TaskHandle task = CreateDigitalTask(false, ports, lines, lineGrouping);
+
+				uInt32 channels = 0;
+				DAQmxGetTaskNumChans(task, &channels);
+				BENCH_CHECK(DAQmxStartTask(task) == 0, failures);
+
+				uInt32 lineCount = 0;
+				DAQmxGetReadDigitalLinesBytesPerChan(task, &lineCount);
+
+				std::vector<uInt8> packed(PackedDigitalLinesSize(channels, lineCount, samples));
+				uInt64 first = 0;
+				uInt32 bad = 0;
+
+				for (uInt32 r = 0; r < reads; r++) {
+
+					int32 read = 0;
+					int32 linesPerChannel = 0;
+
+					int32 status = ReadDigitalLinesPacked(task, (int32)samples, 10.0, fillMode,
+						packed.data(), (uInt32)packed.size(), &read, &linesPerChannel);
+
+					BENCH_CHECK(status == 0 && read == (int32)samples, failures);
+					BENCH_CHECK(linesPerChannel == (int32)lineCount, failures);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt32 i = 0; i < samples; i++) {
+							for (uInt32 line = 0; line < lineCount; line++) {
+
+								const size_t bit = (fillMode == DAQmx_Val_GroupByChannel)
+									? ((size_t)ch * samples + i) * lineCount + line
+									: ((size_t)i * channels + ch) * lineCount + line;
+
+								if (((packed[bit / 8] >> (bit % 8)) & 1)
+									!= SimDigitalLine(ch, line, first + i)) {
+									bad++;
+								}
+							}
+						}
+					}
+					first += samples;
+				}
+
+				DAQmxStopTask(task);
+				DAQmxClearTask(task);
+
+				std::printf("  read  %-7s %2u ch x %2u lines x %5u samples: %u bad bits\n",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "channel" : "scan",
+					channels, lineCount, samples, bad);
+				BENCH_CHECK(bad == 0, failures);
+				return failures;
+			}
+
+			int CheckPackedWrite(uInt32 ports, uInt32 lines, int32 lineGrouping,
+				int32 fillMode, uInt32 samples, std::mt19937& random) {
+
+				int failures = 0;
+				TaskHandle task = CreateDigitalTask(true, ports, lines, lineGrouping);
+
+				uInt32 channels = 0;
+				uInt32 lineCount = 0;
+				DAQmxGetTaskNumChans(task, &channels);
+				DAQmxGetWriteDigitalLinesBytesPerChan(task, &lineCount);
+
+				const size_t count = (size_t)channels * lineCount * samples;
+				std::vector<uInt8> packed(PackedLinesSize(count));
+
+				for (uInt8& b : packed) {
+					b = (uInt8)random();
+				}
+
+				int32 written = 0;
+				int32 status = WriteDigitalLinesPacked(task, (int32)samples, 0, 10.0, fillMode,
+					packed.data(), (uInt32)packed.size(), &written);
+				BENCH_CHECK(status == 0 && written == (int32)samples, failures);
+
+				std::vector<uInt8> expected(count);
+				ReferenceUnpack(packed.data(), 0, count, expected.data());
+				BENCH_CHECK(SimWrittenDigitalLines(task) == expected, failures);
+
+				// One byte short of the packed size.
+				status = WriteDigitalLinesPacked(task, (int32)samples, 0, 10.0, fillMode,
+					packed.data(), (uInt32)packed.size() - 1, &written);
+				BENCH_CHECK(status == NativeErrorBufferTooSmall && written == 0, failures);
+
+				DAQmxClearTask(task);
+				return failures;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				TaskHandle task = CreateDigitalTask(false, 1, 8, DAQmx_Val_ChanForAllLines);
+				uInt8 packed[16];
+				int32 read = 0;
+				int32 lines = 0;
+
+				BENCH_CHECK(ReadDigitalLinesPacked(task, 0, 1.0, DAQmx_Val_GroupByChannel,
+					packed, sizeof(packed), &read, &lines) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(ReadDigitalLinesPacked(task, 8, 1.0, 7,
+					packed, sizeof(packed), &read, &lines) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(ReadDigitalLinesPacked(task, 8, 1.0, DAQmx_Val_GroupByChannel,
+					NULL, sizeof(packed), &read, &lines) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(ReadDigitalLinesPacked(task, 17, 1.0, DAQmx_Val_GroupByChannel,
+					packed, sizeof(packed), &read, &lines) == NativeErrorBufferTooSmall, failures);
+				BENCH_CHECK(read == 0, failures);
+
+				DAQmxClearTask(task);
+
+				task = CreateDigitalTask(true, 1, 8, DAQmx_Val_ChanForAllLines);
+				int32 written = 0;
+
+				BENCH_CHECK(WriteDigitalLinesPacked(task, 8, 0, 1.0, 7,
+					packed, sizeof(packed), &written) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(WriteDigitalLinesPacked(task, 8, 0, 1.0, DAQmx_Val_GroupByChannel,
+					NULL, sizeof(packed), &written) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(written == 0 && SimWrittenDigitalLines(task).empty(), failures);
+
+				DAQmxClearTask(task);
+				return failures;
+			}
+
+			double MeasurePack(const std::vector<uInt8>& lines, std::vector<uInt8>& bits,
+				double seconds) {
+
+				uInt64 packed = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						PackLines(lines.data(), lines.size(), bits.data(), 0);
+						packed += lines.size();
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(bits[bits.size() / 2]);
+				return packed / SecondsSince(start);
+			}
+
+			double MeasureUnpack(const std::vector<uInt8>& bits, std::vector<uInt8>& lines,
+				double seconds) {
+
+				uInt64 unpacked = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						UnpackLines(bits.data(), 0, lines.size(), lines.data());
+						unpacked += lines.size();
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(lines[lines.size() / 2]);
+				return unpacked / SecondsSince(start);
+			}
+
+			// Samples per channel per second of 32-line reads, byte per line
+			// against packed.
+			void MeasureReads(double seconds) {
+
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				const uInt32 samples = 4096;
+				std::vector<uInt8> bytes((size_t)samples * 32);
+				std::vector<uInt8> packed(PackedDigitalLinesSize(1, 32, samples));
+
+				for (int packedRead = 0; packedRead < 2; packedRead++) {
+
+					TaskHandle task = CreateDigitalTask(false, 1, 32,
+						DAQmx_Val_ChanForAllLines);
+					DAQmxStartTask(task);
+
+					uInt64 total = 0;
+					const auto start = std::chrono::steady_clock::now();
+
+					do {
+						int32 read = 0;
+						int32 lines = 0;
+
+						if (packedRead != 0) {
+							ReadDigitalLinesPacked(task, (int32)samples, 10.0,
+								DAQmx_Val_GroupByScanNumber, packed.data(),
+								(uInt32)packed.size(), &read, &lines);
+						}
+						else {
+							DAQmxReadDigitalLines(task, (int32)samples, 10.0,
+								DAQmx_Val_GroupByScanNumber, bytes.data(),
+								(uInt32)bytes.size(), &read, &lines, NULL);
+						}
+						total += (uInt64)read;
+					} while (SecondsSince(start) < seconds);
+
+					const double rate = total / SecondsSince(start);
+					DAQmxStopTask(task);
+					DAQmxClearTask(task);
+
+					std::printf("  32-line reads %-6s: %7.2f MS/s, %7.1f KB per 4096 samples\n",
+						(packedRead != 0) ? "packed" : "bytes", rate / 1e6,
+						((packedRead != 0) ? packed.size() : bytes.size()) / 1024.0);
+				}
+			}
+		}
+
+		int RunBitPackBench(const BenchOptions& options) {
+
+			int failures = 0;
+			std::mt19937 random(11);
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			std::printf("  detected SIMD level: %s, BMI2: %s\n", SimdLevelName(detected),
+				CpuHasBmi2() ? "yes" : "no");
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				int f = CheckKernels(random);
+
+				std::printf("  correctness %-7s: %d failed checks\n", SimdLevelName(level), f);
+				failures += f;
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			SimSetClockMode(SimClockMode::FreeRun);
+
+			const int32 fillModes[] = { DAQmx_Val_GroupByScanNumber, DAQmx_Val_GroupByChannel };
+			const uInt32 reads = options.quick ? 4 : 40;
+
+			for (int32 fillMode : fillModes) {
+				failures += CheckPackedRead(1, 8, DAQmx_Val_ChanForAllLines, fillMode, 5000, reads);
+				failures += CheckPackedRead(1, 32, DAQmx_Val_ChanForAllLines, fillMode, 3001, reads);
+				failures += CheckPackedRead(1, 5, DAQmx_Val_ChanForAllLines, fillMode, 1001, reads);
+				failures += CheckPackedRead(1, 3, DAQmx_Val_ChanPerLine, fillMode, 9999, reads);
+				failures += CheckPackedRead(2, 4, DAQmx_Val_ChanForAllLines, fillMode, 777, reads);
+				failures += CheckPackedRead(3, 3, DAQmx_Val_ChanForAllLines, fillMode, 513, reads);
+				failures += CheckPackedRead(4, 8, DAQmx_Val_ChanForAllLines, fillMode, 2048, reads);
+
+				failures += CheckPackedWrite(1, 8, DAQmx_Val_ChanForAllLines, fillMode, 1000, random);
+				failures += CheckPackedWrite(2, 5, DAQmx_Val_ChanForAllLines, fillMode, 333, random);
+				failures += CheckPackedWrite(1, 5, DAQmx_Val_ChanPerLine, fillMode, 77, random);
+			}
+			failures += CheckArguments();
+
+			const double seconds = options.quick ? 0.05 : 0.5;
+			std::vector<uInt8> lines(1 << 16), bits(PackedLinesSize(lines.size()));
+
+			for (size_t i = 0; i < lines.size(); i++) {
+				lines[i] = (uInt8)((i * 2654435761u) >> 31 & 1);
+			}
+
+			std::vector<uInt8> copy(lines.size());
+			uInt64 copied = 0;
+			const auto start = std::chrono::steady_clock::now();
+
+			do {
+				std::memcpy(copy.data(), lines.data(), lines.size());
+				copied += lines.size();
+			} while (SecondsSince(start) < seconds);
+			KeepAlive(copy[copy.size() / 2]);
+
+			std::printf("  %zu lines, Glines/s (memcpy of the bytes %.2f):\n", lines.size(),
+				copied / SecondsSince(start) / 1e9);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				std::printf("    %-7s   pack %6.2f   unpack %6.2f\n", SimdLevelName(level),
+					MeasurePack(lines, bits, seconds) / 1e9,
+					MeasureUnpack(bits, lines, seconds) / 1e9);
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			MeasureReads(seconds * 4);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,508 @@
+// Checks the waveform cache: hits against blocks rendered directly, the
+// canonical keys, LRU eviction under the memory cap with acquired entries
+// pinned, persistence across instances through the cache file, damaged
+// files, and writing a cached block to an analog output task. Compares the
+// cost of a hit with rendering and scaling the block again.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/NativeStatus.h"
+#include "Native/WaveformCacheCore.h"
+#include "Native/WaveformGeneratorCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			std::string TempPath(const char* name) {
+				return (std::filesystem::temp_directory_path() / name).string();
+			}
+
+			// A stimulus of `channels` channels; `variant` moves the frequency
+			// so that every variant is a different entry.
+			struct Stimulus {
+
+				std::vector<WaveformStimulusChannel> channels;
+				std::vector<WaveformTone> tones;
+				WaveformStimulus stimulus;
+
+				Stimulus(uInt32 count, uInt32 samplesPerChannel, int32 fillMode, uInt32 variant) {
+
+					tones = { { 1000.0, 0.5, 0.0 }, { 3000.0, 0.25, 0.1 }, { 7000.0, 0.125, 0.2 } };
+					channels.resize(count);
+
+					for (uInt32 ch = 0; ch < count; ch++) {
+
+						WaveformStimulusChannel& c = channels[ch];
+						c.waveform = DefaultWaveformChannel();
+						c.waveform.shape = (WaveformShape)(ch % 5);
+						c.waveform.frequency = 100.0 * (ch + 1) + variant;
+						c.waveform.amplitude = 2.0 + 0.5 * ch;
+						c.waveform.phase = 0.125 * ch;
+						c.waveform.sweepSeconds = 0.01;
+						// AO device scaling of a +-10 V range.
+						c.c0 = 1.5;
+						c.c1 = 3276.7;
+						c.tones = tones.data();
+						c.toneCount = (uInt32)tones.size();
+						c.table = nullptr;
+						c.tableSize = 0;
+					}
+
+					stimulus.channels = count;
+					stimulus.sampleRate = 100000.0;
+					stimulus.fillMode = fillMode;
+					stimulus.samplesPerChannel = samplesPerChannel;
+					stimulus.channelSettings = channels.data();
+				}
+			};
+
+			std::vector<int16> RenderDirect(const WaveformStimulus& s) {
+
+				WaveformGeneratorConfig config = DefaultWaveformGeneratorConfig();
+				config.channels = s.channels;
+				config.sampleRate = s.sampleRate;
+				config.format = SampleFormat::Int16;
+				config.fillMode = s.fillMode;
+
+				WaveformGeneratorCore generator;
+				generator.Configure(config);
+
+				for (uInt32 ch = 0; ch < s.channels; ch++) {
+					const WaveformStimulusChannel& c = s.channelSettings[ch];
+					generator.SetChannel(ch, c.waveform);
+					generator.SetCodeScaling(ch, c.c0, c.c1);
+					generator.SetTones(ch, c.tones, c.toneCount);
+				}
+				generator.Reset();
+
+				std::vector<int16> block((size_t)s.channels * s.samplesPerChannel);
+				generator.Render(block.data(), s.samplesPerChannel);
+				return block;
+			}
+
+			bool SameBlock(const WaveformCacheEntry& entry, const std::vector<int16>& expected) {
+				return entry.data != nullptr
+					&& (size_t)entry.channels * entry.samplesPerChannel == expected.size()
+					&& std::memcmp(entry.data, expected.data(), expected.size() * sizeof(int16)) == 0;
+			}
+
+			uInt64 BlockBytes(const Stimulus& s) {
+				return (uInt64)s.stimulus.channels * s.stimulus.samplesPerChannel * sizeof(int16);
+			}
+
+			int CheckHits() {
+
+				int failures = 0;
+				WaveformCacheCore cache;
+				WaveformCacheEntry entry;
+				WaveformCacheEntry again;
+
+				BENCH_CHECK(cache.Acquire(Stimulus(1, 100, DAQmx_Val_GroupByChannel, 0).stimulus, &entry)
+					== NativeErrorInvalidState, failures);
+				BENCH_CHECK(cache.Open(nullptr, DefaultWaveformCacheConfig()) == 0, failures);
+				BENCH_CHECK(cache.Open(nullptr, DefaultWaveformCacheConfig()) == NativeErrorAlreadyRunning, failures);
+				BENCH_CHECK(cache.Save() == NativeErrorInvalidState, failures);
+
+				for (int32 fillMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+
+					Stimulus s(5, 4099, fillMode, 0);
+					const std::vector<int16> expected = RenderDirect(s.stimulus);
+
+					BENCH_CHECK(cache.Acquire(s.stimulus, &entry) == 0, failures);
+					BENCH_CHECK(SameBlock(entry, expected), failures);
+					BENCH_CHECK(entry.fillMode == fillMode && entry.channels == 5, failures);
+
+					WaveformCacheKey key;
+					BENCH_CHECK(WaveformCacheCore::ComputeKey(s.stimulus, &key) == 0, failures);
+					BENCH_CHECK(key.high == entry.key.high && key.low == entry.key.low, failures);
+
+					BENCH_CHECK(cache.Acquire(s.stimulus, &again) == 0, failures);
+					BENCH_CHECK(again.data == entry.data, failures);
+					cache.Release(&again);
+					BENCH_CHECK(again.data == nullptr && again.token == nullptr, failures);
+					cache.Release(&entry);
+				}
+
+				WaveformCacheCounters counters = cache.Counters();
+				BENCH_CHECK(counters.misses == 2 && counters.hits == 2 && counters.entries == 2, failures);
+
+				// Parameters the shape does not use, and -0 against +0, do not
+				// split entries; the code scaling does.
+				Stimulus base(1, 1000, DAQmx_Val_GroupByChannel, 0);
+				Stimulus unused(1, 1000, DAQmx_Val_GroupByChannel, 0);
+				unused.channels[0].waveform.dutyCycle = 0.1;
+				unused.channels[0].waveform.stopFrequency = 1.0;
+				unused.channels[0].waveform.phase = -0.0;
+				unused.channels[0].toneCount = 0;
+				Stimulus scaled(1, 1000, DAQmx_Val_GroupByChannel, 0);
+				scaled.channels[0].c1 = 3000.0;
+
+				BENCH_CHECK(cache.Acquire(base.stimulus, &entry) == 0, failures);
+				cache.Release(&entry);
+				BENCH_CHECK(cache.Acquire(unused.stimulus, &entry) == 0, failures);
+				cache.Release(&entry);
+				BENCH_CHECK(cache.Counters().hits == 3, failures);
+				BENCH_CHECK(cache.Acquire(scaled.stimulus, &entry) == 0, failures);
+				BENCH_CHECK(SameBlock(entry, RenderDirect(scaled.stimulus)), failures);
+				cache.Release(&entry);
+				BENCH_CHECK(cache.Counters().misses == 4, failures);
+
+				// Bad stimuli.
+				Stimulus bad(2, 100, DAQmx_Val_GroupByChannel, 0);
+				bad.channels[1].waveform.dutyCycle = 2.0;
+				bad.channels[1].waveform.shape = WaveformShape::Square;
+				BENCH_CHECK(cache.Acquire(bad.stimulus, &entry) == NativeErrorInvalidArgument, failures);
+				bad.channels[1].waveform.shape = WaveformShape::Table;
+				BENCH_CHECK(cache.Acquire(bad.stimulus, &entry) == NativeErrorInvalidArgument, failures);
+				bad.stimulus.fillMode = 12345;
+				BENCH_CHECK(cache.Acquire(bad.stimulus, &entry) == NativeErrorInvalidArgument, failures);
+
+				// A table is keyed by its contents.
+				std::vector<float64> table = { 0.0, 1.0, 0.0, -1.0 };
+				Stimulus tabled(1, 1000, DAQmx_Val_GroupByChannel, 0);
+				tabled.channels[0].waveform.shape = WaveformShape::Table;
+				tabled.channels[0].table = table.data();
+				tabled.channels[0].tableSize = (uInt32)table.size();
+
+				WaveformCacheKey first;
+				WaveformCacheKey second;
+				WaveformCacheCore::ComputeKey(tabled.stimulus, &first);
+				table[2] = 0.5;
+				WaveformCacheCore::ComputeKey(tabled.stimulus, &second);
+				BENCH_CHECK(first.high != second.high || first.low != second.low, failures);
+
+				BENCH_CHECK(cache.Close() == 0, failures);
+				BENCH_CHECK(!cache.IsOpen(), failures);
+				return failures;
+			}
+
+			int CheckEviction() {
+
+				int failures = 0;
+				const uInt32 spc = 10000;
+				std::vector<Stimulus> stimuli;
+
+				for (uInt32 v = 0; v < 6; v++) {
+					stimuli.emplace_back(2, spc, DAQmx_Val_GroupByScanNumber, v);
+				}
+
+				WaveformCacheConfig config = DefaultWaveformCacheConfig();
+				config.memoryCapBytes = 3 * BlockBytes(stimuli[0]);
+
+				WaveformCacheCore cache;
+				WaveformCacheEntry entry;
+				BENCH_CHECK(cache.Open("", config) == 0, failures);
+
+				auto touch = [&](uInt32 v) {
+					BENCH_CHECK(cache.Acquire(stimuli[v].stimulus, &entry) == 0, failures);
+					cache.Release(&entry);
+				};
+
+				touch(0);
+				touch(1);
+				touch(2);
+				touch(0);
+				touch(3);
+
+				// 1 was the least recently used.
+				WaveformCacheCounters counters = cache.Counters();
+				BENCH_CHECK(counters.evictions == 1 && counters.entries == 3, failures);
+				BENCH_CHECK(counters.bytes == config.memoryCapBytes, failures);
+
+				touch(0);
+				touch(2);
+				touch(3);
+				BENCH_CHECK(cache.Counters().hits == 4 && cache.Counters().misses == 4, failures);
+				touch(1);
+				BENCH_CHECK(cache.Counters().misses == 5 && cache.Counters().evictions == 2, failures);
+
+				// Acquired entries are never evicted; with all of them held a
+				// new block is handed out without being kept.
+				WaveformCacheEntry held[3];
+				BENCH_CHECK(cache.Acquire(stimuli[1].stimulus, &held[0]) == 0, failures);
+				BENCH_CHECK(cache.Acquire(stimuli[2].stimulus, &held[1]) == 0, failures);
+				BENCH_CHECK(cache.Acquire(stimuli[3].stimulus, &held[2]) == 0, failures);
+
+				const std::vector<int16> expected = RenderDirect(stimuli[4].stimulus);
+				BENCH_CHECK(cache.Acquire(stimuli[4].stimulus, &entry) == 0, failures);
+				BENCH_CHECK(SameBlock(entry, expected), failures);
+				counters = cache.Counters();
+				BENCH_CHECK(counters.uncached == 1 && counters.entries == 3 && counters.evictions == 2, failures);
+				BENCH_CHECK(cache.Close() == NativeErrorInvalidState, failures);
+				cache.Release(&entry);
+
+				BENCH_CHECK(SameBlock(held[0], RenderDirect(stimuli[1].stimulus)), failures);
+				for (WaveformCacheEntry& h : held) {
+					cache.Release(&h);
+				}
+
+				// A block larger than the cap is never kept.
+				Stimulus large(2, 4 * spc, DAQmx_Val_GroupByScanNumber, 9);
+				BENCH_CHECK(cache.Acquire(large.stimulus, &entry) == 0, failures);
+				BENCH_CHECK(SameBlock(entry, RenderDirect(large.stimulus)), failures);
+				cache.Release(&entry);
+				BENCH_CHECK(cache.Counters().uncached == 2 && cache.Counters().entries == 3, failures);
+
+				cache.Clear();
+				counters = cache.Counters();
+				BENCH_CHECK(counters.entries == 0 && counters.bytes == 0, failures);
+				BENCH_CHECK(cache.Close() == 0, failures);
+				return failures;
+			}
+
+			void Corrupt(const std::string& path, long offset) {
+
+				FILE* f = std::fopen(path.c_str(), "r+b");
+				if (f == nullptr) {
+					return;
+				}
+				std::fseek(f, offset, SEEK_SET);
+				const int c = std::fgetc(f);
+				std::fseek(f, offset, SEEK_SET);
+				std::fputc(c ^ 0x5A, f);
+				std::fclose(f);
+			}
+
+			int CheckPersistence() {
+
+				int failures = 0;
+				const std::string path = TempPath("DAQmxNativeBench_cache.wfc");
+				const uInt32 count = 5;
+				std::filesystem::remove(path);
+
+				std::vector<Stimulus> stimuli;
+				std::vector<std::vector<int16>> expected;
+
+				for (uInt32 v = 0; v < count; v++) {
+					stimuli.emplace_back(3, 3000 + 17 * v,
+						(v % 2 == 0) ? DAQmx_Val_GroupByChannel : DAQmx_Val_GroupByScanNumber, v);
+					expected.push_back(RenderDirect(stimuli[v].stimulus));
+				}
+
+				WaveformCacheEntry entry;
+				{
+					WaveformCacheCore cache;
+					BENCH_CHECK(cache.Open(path.c_str(), DefaultWaveformCacheConfig()) == 0, failures);
+					BENCH_CHECK(cache.Counters().entriesRejected == 0, failures);
+
+					for (uInt32 v = 0; v < count; v++) {
+						BENCH_CHECK(cache.Acquire(stimuli[v].stimulus, &entry) == 0, failures);
+						cache.Release(&entry);
+					}
+
+					// Saving moves the entries to the mapping; they stay usable.
+					BENCH_CHECK(cache.Acquire(stimuli[0].stimulus, &entry) == 0, failures);
+					BENCH_CHECK(cache.Save() == NativeErrorInvalidState, failures);
+					cache.Release(&entry);
+					BENCH_CHECK(cache.Save() == 0, failures);
+					BENCH_CHECK(cache.Acquire(stimuli[1].stimulus, &entry) == 0, failures);
+					BENCH_CHECK(SameBlock(entry, expected[1]), failures);
+					cache.Release(&entry);
+					BENCH_CHECK(cache.Close() == 0, failures);
+				}
+
+				// Most recently used first: 1, 0, 4, 3, 2.
+				{
+					WaveformCacheCore cache;
+					BENCH_CHECK(cache.Open(path.c_str(), DefaultWaveformCacheConfig()) == 0, failures);
+					WaveformCacheCounters counters = cache.Counters();
+					BENCH_CHECK(counters.entriesLoaded == count && counters.entries == count, failures);
+
+					for (uInt32 v = 0; v < count; v++) {
+						BENCH_CHECK(cache.Acquire(stimuli[v].stimulus, &entry) == 0, failures);
+						BENCH_CHECK(SameBlock(entry, expected[v]), failures);
+						cache.Release(&entry);
+					}
+					counters = cache.Counters();
+					BENCH_CHECK(counters.hits == count && counters.misses == 0, failures);
+
+					// An entry rendered now is saved beside the mapped ones.
+					Stimulus extra(1, 500, DAQmx_Val_GroupByChannel, 77);
+					BENCH_CHECK(cache.Acquire(extra.stimulus, &entry) == 0, failures);
+					cache.Release(&entry);
+					BENCH_CHECK(cache.Close() == 0, failures);
+				}
+
+				// A smaller cap keeps the most recently used entries.
+				{
+					WaveformCacheConfig config = DefaultWaveformCacheConfig();
+					config.memoryCapBytes = 1000 + BlockBytes(stimuli[4]) + BlockBytes(stimuli[3]);
+
+					WaveformCacheCore cache;
+					BENCH_CHECK(cache.Open(path.c_str(), config) == 0, failures);
+					BENCH_CHECK(cache.Counters().entriesLoaded == 3, failures);
+
+					// The extra block, 4 and 3 were used last in the previous run.
+					for (uInt32 v : { 4u, 3u }) {
+						BENCH_CHECK(cache.Acquire(stimuli[v].stimulus, &entry) == 0, failures);
+						BENCH_CHECK(SameBlock(entry, expected[v]), failures);
+						cache.Release(&entry);
+					}
+					BENCH_CHECK(cache.Counters().hits == 2, failures);
+					BENCH_CHECK(cache.Close() == 0, failures);
+				}
+
+				// A damaged block is dropped, the rest is kept.
+				{
+					// Inside the samples of the first entry, 3.
+					Corrupt(path, 4096);
+
+					WaveformCacheCore cache;
+					BENCH_CHECK(cache.Open(path.c_str(), DefaultWaveformCacheConfig()) == 0, failures);
+					WaveformCacheCounters counters = cache.Counters();
+					BENCH_CHECK(counters.entriesRejected == 1 && counters.entriesLoaded == 2, failures);
+
+					for (uInt32 v : { 4u, 3u }) {
+						BENCH_CHECK(cache.Acquire(stimuli[v].stimulus, &entry) == 0, failures);
+						BENCH_CHECK(SameBlock(entry, expected[v]), failures);
+						cache.Release(&entry);
+					}
+					counters = cache.Counters();
+					BENCH_CHECK(counters.hits == 1 && counters.misses == 1, failures);
+					BENCH_CHECK(cache.Close() == 0, failures);
+				}
+
+				// A damaged header loses the file, not the cache.
+				{
+					Corrupt(path, 2);
+
+					WaveformCacheCore cache;
+					BENCH_CHECK(cache.Open(path.c_str(), DefaultWaveformCacheConfig()) == 0, failures);
+					WaveformCacheCounters counters = cache.Counters();
+					BENCH_CHECK(counters.entriesRejected == 1 && counters.entriesLoaded == 0, failures);
+					BENCH_CHECK(cache.Acquire(stimuli[0].stimulus, &entry) == 0, failures);
+					BENCH_CHECK(SameBlock(entry, expected[0]), failures);
+					cache.Release(&entry);
+					BENCH_CHECK(cache.Close() == 0, failures);
+				}
+				{
+					WaveformCacheCore cache;
+					BENCH_CHECK(cache.Open(path.c_str(), DefaultWaveformCacheConfig()) == 0, failures);
+					BENCH_CHECK(cache.Counters().entriesLoaded == 1, failures);
+				}
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			int CheckTask() {
+
+				int failures = 0;
+				const uInt32 channels = 2;
+				const uInt32 spc = 2000;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				WaveformCacheCore cache;
+				BENCH_CHECK(cache.Open(nullptr, DefaultWaveformCacheConfig()) == 0, failures);
+
+				for (int32 fillMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+
+					Stimulus s(channels, spc, fillMode, 5);
+					std::vector<int16> expected = RenderDirect(s.stimulus);
+
+					TaskHandle task = NULL;
+					DAQmxCreateTask("cache", &task);
+					DAQmxCreateAOVoltageChan(task, "SimDev1/ao0:1", "", -10.0, 10.0, DAQmx_Val_Volts, NULL);
+					DAQmxCfgSampClkTiming(task, "", 100000.0, DAQmx_Val_Rising, DAQmx_Val_ContSamps, 0);
+
+					int32 written = 0;
+					BENCH_CHECK(cache.WriteToTask(task, s.stimulus, FALSE, 10.0, &written) == 0, failures);
+					BENCH_CHECK(written == (int32)spc, failures);
+					BENCH_CHECK(DAQmxStartTask(task) == 0, failures);
+
+					std::vector<float64> record;
+					const auto start = std::chrono::steady_clock::now();
+					while (record.size() < (size_t)channels * spc && SecondsSince(start) < 10.0) {
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+						record = SimGeneratedAnalog(task);
+					}
+					DAQmxClearTask(task);
+
+					// The record is interleaved by scan.
+					bool same = record.size() >= (size_t)channels * spc;
+					for (uInt32 i = 0; i < spc && same; i++) {
+						for (uInt32 ch = 0; ch < channels && same; ch++) {
+							const size_t at = (fillMode == DAQmx_Val_GroupByChannel)
+								? (size_t)ch * spc + i : (size_t)i * channels + ch;
+							same = record[(size_t)i * channels + ch] == (float64)expected[at];
+						}
+					}
+					BENCH_CHECK(same, failures);
+				}
+
+				BENCH_CHECK(cache.Counters().misses == 2, failures);
+				BENCH_CHECK(cache.Close() == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			void MeasureHits(double seconds) {
+
+				const uInt32 channels = 4;
+				const uInt32 spc = 10000;
+				Stimulus s(channels, spc, DAQmx_Val_GroupByScanNumber, 3);
+
+				WaveformCacheCore cache;
+				cache.Open(nullptr, DefaultWaveformCacheConfig());
+				WaveformCacheEntry entry;
+
+				auto measure = [&](auto&& body) {
+					uInt64 n = 0;
+					const auto start = std::chrono::steady_clock::now();
+					do {
+						body();
+						n++;
+					} while (SecondsSince(start) < seconds);
+					return SecondsSince(start) / (double)n * 1e6;
+				};
+
+				std::vector<int16> block((size_t)channels * spc);
+				const double render = measure([&]() {
+					block = RenderDirect(s.stimulus);
+				});
+
+				cache.Acquire(s.stimulus, &entry);
+				cache.Release(&entry);
+
+				int16 sink = 0;
+				const double hit = measure([&]() {
+					cache.Acquire(s.stimulus, &entry);
+					sink ^= entry.data[spc];
+					cache.Release(&entry);
+				});
+
+				KeepAlive(sink);
+				KeepAlive(block[spc]);
+				std::printf("  %u ch x %u samples I16: render %.1f us, cache hit %.2f us\n",
+					channels, spc, render, hit);
+				cache.Close();
+			}
+		}
+
+		int RunCacheBench(const BenchOptions& options) {
+
+			int failures = 0;
+
+			failures += CheckHits();
+			failures += CheckEviction();
+			failures += CheckPersistence();
+			failures += CheckTask();
+
+			MeasureHits(options.quick ? 0.1 : 1.0);
+			return failures;
+		}
+	}
+}
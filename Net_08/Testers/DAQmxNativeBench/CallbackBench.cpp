@@ -0,0 +1,1363 @@
+// Checks the callback dispatcher (CallbackDispatcherCore, CallbackRegistry,
+// MpscQueue): the queue under concurrent producers, generation-tagged keys,
+// delivery of the events of a running task in order and off the driver
+// thread, a stalled consumer that must not hold up the producers, released
+// keys, quiescence and the swap of a consumer on a running task, signal
+// events with their host times, coalesced behind a busy consumer, the
+// latency histograms and the stage stamps of the callback path, tasks
+// routed to dedicated dispatch threads with their affinity, real-time
+// priority and busy polling, the latency of registration and release with
+// 10k keys, and the throughput of the queue with one to four producers.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/CallbackDispatcherCore.h"
+#include "Native/CallbackLatencyCore.h"
+#include "Native/CallbackRegistry.h"
+#include "Native/HostClock.h"
+#include "Native/MpscQueue.h"
+#include "Native/NativeStatus.h"
+#include "Native/ThreadScheduling.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			// Records every delivered event and the threads that delivered them.
+			struct Recorder {
+
+				std::mutex mutex;
+				std::vector<CallbackEvent> events;
+				// From the trampoline to the batch function, per event.
+				std::vector<int64> latencyNs;
+				std::vector<std::thread::id> threads;
+				std::atomic<uInt64> batches{ 0 };
+
+				// Sleep in the first batch, as a consumer held up by a
+				// garbage collection would.
+				std::atomic<int> stallMs{ 0 };
+
+				static void OnBatch(void* context, const CallbackEvent* events, uInt32 count) {
+
+					Recorder* recorder = static_cast<Recorder*>(context);
+
+					const int stall = recorder->stallMs.exchange(0);
+					if (stall > 0) {
+						std::this_thread::sleep_for(std::chrono::milliseconds(stall));
+					}
+
+					const int64 now = HostMonotonicNs();
+
+					std::lock_guard<std::mutex> lock(recorder->mutex);
+					recorder->events.insert(recorder->events.end(), events, events + count);
+					for (uInt32 k = 0; k < count; k++) {
+						recorder->latencyNs.push_back(now - events[k].timeNs);
+					}
+
+					const std::thread::id self = std::this_thread::get_id();
+					if (std::find(recorder->threads.begin(), recorder->threads.end(), self)
+						== recorder->threads.end()) {
+						recorder->threads.push_back(self);
+					}
+					recorder->batches.fetch_add(1);
+				}
+
+				size_t Count() {
+					std::lock_guard<std::mutex> lock(mutex);
+					return events.size();
+				}
+
+				size_t Count(CallbackKey key) {
+					std::lock_guard<std::mutex> lock(mutex);
+					return (size_t)std::count_if(events.begin(), events.end(),
+						[key](const CallbackEvent& e) { return e.key == key; });
+				}
+			};
+
+			bool WaitDelivered(const CallbackDispatcherCore& dispatcher, uInt64 delivered,
+				double seconds) {
+
+				const auto start = std::chrono::steady_clock::now();
+
+				while (dispatcher.Counters().delivered < delivered && SecondsSince(start) < seconds) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				return dispatcher.Counters().delivered >= delivered;
+			}
+
+			CallbackEvent MakeEvent(CallbackKey key, uInt64 task, uInt32 sequence) {
+
+				CallbackEvent event;
+				event.key = key;
+				event.task = reinterpret_cast<TaskHandle>(task);
+				event.kind = CallbackEventKind::EveryNSamples;
+				event.status = 0;
+				event.eventType = DAQmx_Val_Acquired_Into_Buffer;
+				event.nSamples = sequence;
+				event.timeNs = HostMonotonicNs();
+				event.queuedNs = 0;
+				event.dispatchNs = 0;
+				return event;
+			}
+
+			int CheckQueue(uInt32 perProducer) {
+
+				std::printf("  MPSC queue, 4 producers x %u values\n", perProducer);
+
+				int failures = 0;
+				const uInt32 producers = 4;
+
+				MpscQueue<uInt64> small;
+				BENCH_CHECK(!small.Allocate(1), failures);
+				BENCH_CHECK(small.Allocate(3) && small.Capacity() == 4, failures);
+
+				for (uInt64 v = 0; v < 4; v++) {
+					BENCH_CHECK(small.TryPush(v), failures);
+				}
+				BENCH_CHECK(!small.TryPush(4), failures);
+
+				uInt64 value = 0;
+				BENCH_CHECK(small.TryPop(value) && value == 0, failures);
+				BENCH_CHECK(small.TryPush(4), failures);
+				BENCH_CHECK(small.Count() == 4, failures);
+
+				MpscQueue<uInt64> queue;
+				BENCH_CHECK(queue.Allocate(256), failures);
+
+				std::vector<std::thread> threads;
+				for (uInt32 p = 0; p < producers; p++) {
+					threads.emplace_back([&queue, p, perProducer]() {
+						for (uInt64 i = 0; i < perProducer; i++) {
+							while (!queue.TryPush(((uInt64)p << 32) | i)) {
+								std::this_thread::yield();
+							}
+						}
+					});
+				}
+
+				// Values of each producer arrive in the order it pushed them.
+				std::vector<uInt64> next(producers, 0);
+				uInt64 received = 0;
+				uInt64 outOfOrder = 0;
+
+				while (received < (uInt64)producers * perProducer) {
+
+					uInt64 values[64];
+					const size_t n = queue.TryPopMany(values, 64);
+
+					if (n == 0) {
+						std::this_thread::yield();
+						continue;
+					}
+
+					for (size_t k = 0; k < n; k++) {
+						const uInt32 p = (uInt32)(values[k] >> 32);
+						const uInt64 i = values[k] & 0xFFFFFFFFu;
+
+						if (p >= producers || i != next[p]) {
+							outOfOrder++;
+						}
+						else {
+							next[p]++;
+						}
+					}
+					received += n;
+				}
+
+				for (std::thread& t : threads) {
+					t.join();
+				}
+
+				BENCH_CHECK(outOfOrder == 0, failures);
+				BENCH_CHECK(queue.Count() == 0, failures);
+				return failures;
+			}
+
+			int CheckArguments() {
+
+				std::printf("  arguments and states\n");
+
+				int failures = 0;
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				CallbackDispatcherConfig bad = config;
+				bad.threads = 0;
+				BENCH_CHECK(dispatcher.Start(bad, &Recorder::OnBatch, &recorder)
+					== NativeErrorInvalidArgument, failures);
+				bad = config;
+				bad.maxBatch = 0;
+				BENCH_CHECK(dispatcher.Start(bad, &Recorder::OnBatch, &recorder)
+					== NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.Start(config, nullptr, &recorder)
+					== NativeErrorInvalidArgument, failures);
+
+				bad = config;
+				bad.maxRegistrations = 0;
+				BENCH_CHECK(dispatcher.Start(bad, &Recorder::OnBatch, &recorder)
+					== NativeErrorInvalidArgument, failures);
+
+				// Keys may be taken before the start.
+				CallbackKey key = 0;
+				BENCH_CHECK(dispatcher.Allocate(nullptr) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.Allocate(&key) == 0 && key != 0, failures);
+				BENCH_CHECK(dispatcher.Counters().registrations == 1, failures);
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("callbacks", &task);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(task, key) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(dispatcher.Post(MakeEvent(key, 1, 0)) == NativeErrorInvalidState, failures);
+
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder)
+					== NativeErrorAlreadyRunning, failures);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(NULL, key) == DAQmxErrorInvalidTask, failures);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(task, key + 1) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.Post(MakeEvent(0, 1, 0)) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(task, key) == 0, failures);
+
+				// A key of another dispatcher is refused.
+				CallbackDispatcherCore other;
+				CallbackKey foreign = 0;
+				BENCH_CHECK(other.Allocate(&foreign) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(task, foreign) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.Release(foreign) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.Stop() == 0 && !dispatcher.IsRunning(), failures);
+
+				BENCH_CHECK(dispatcher.Release(key) == 0, failures);
+				BENCH_CHECK(dispatcher.Release(key) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.Counters().registrations == 0, failures);
+
+				// The limit of keys held.
+				CallbackDispatcherCore limited;
+				config.maxRegistrations = 2;
+				BENCH_CHECK(limited.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+				CallbackKey keys[3] = { 0, 0, 0 };
+				BENCH_CHECK(limited.Allocate(&keys[0]) == 0 && limited.Allocate(&keys[1]) == 0, failures);
+				BENCH_CHECK(limited.Allocate(&keys[2]) == NativeErrorOutOfMemory, failures);
+				BENCH_CHECK(limited.Release(keys[0]) == 0 && limited.Allocate(&keys[2]) == 0, failures);
+				limited.Stop();
+
+				DAQmxClearTask(task);
+				BENCH_CHECK(dispatcher.Counters().received == 1, failures);
+				BENCH_CHECK(dispatcher.Counters().discarded == 1, failures);
+				return failures;
+			}
+
+			int CheckRegistry() {
+
+				std::printf("  registry keys and generations\n");
+
+				int failures = 0;
+				CallbackRegistry& registry = CallbackRegistry::Instance();
+				int owners[2] = { 0, 0 };
+
+				const size_t live = registry.LiveCount();
+
+				CallbackKey a = 0;
+				CallbackKey b = 0;
+				BENCH_CHECK(registry.Allocate(&owners[0], a) && a != 0, failures);
+				BENCH_CHECK(registry.Allocate(&owners[1], b) && b != 0 && b != a, failures);
+				BENCH_CHECK(registry.Owner(a) == &owners[0] && registry.Owner(b) == &owners[1], failures);
+				BENCH_CHECK(registry.LiveCount() == live + 2, failures);
+
+				BENCH_CHECK(!registry.Release(a, &owners[1]), failures);
+				BENCH_CHECK(registry.Release(a, &owners[0]), failures);
+				BENCH_CHECK(!registry.Release(a, &owners[0]), failures);
+				BENCH_CHECK(registry.Owner(a) == nullptr, failures);
+				BENCH_CHECK(registry.Owner(0) == nullptr, failures);
+
+				// The slot comes back with the next generation; the old key
+				// does not match it.
+				CallbackKey reused = 0;
+				BENCH_CHECK(registry.Allocate(&owners[1], reused), failures);
+				BENCH_CHECK(CallbackKeyIndex(reused) == CallbackKeyIndex(a) && reused != a, failures);
+				BENCH_CHECK(registry.Owner(a) == nullptr && registry.Owner(reused) == &owners[1], failures);
+
+				// A malformed key, past the slots allocated so far.
+				BENCH_CHECK(registry.Owner((CallbackKey)1 << CallbackKeyIndexBits
+					| (CallbackMaxRegistrations - 1)) == nullptr, failures);
+
+				BENCH_CHECK(registry.ReleaseAll(&owners[1]) == 2, failures);
+				BENCH_CHECK(registry.Owner(b) == nullptr && registry.Owner(reused) == nullptr, failures);
+				BENCH_CHECK(registry.LiveCount() == live, failures);
+				return failures;
+			}
+
+			TaskHandle CreateFiniteTask(const char* name, float64 rate, uInt64 samples) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask(name, &task);
+				DAQmxCreateAIVoltageChan(task, "SimDev1/ai0:1", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+					DAQmx_Val_FiniteSamps, samples);
+				return task;
+			}
+
+			int CheckDelivery(uInt32 blocks) {
+
+				std::printf("  driver events of two tasks, %u blocks each\n", blocks);
+
+				int failures = 0;
+				const uInt32 n = 100;
+				const float64 rate = 100000.0;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				BENCH_CHECK(dispatcher.Start(DefaultCallbackDispatcherConfig(),
+					&Recorder::OnBatch, &recorder) == 0, failures);
+
+				TaskHandle tasks[2] = {
+					CreateFiniteTask("callbacks a", rate, (uInt64)n * blocks),
+					CreateFiniteTask("callbacks b", rate, (uInt64)n * blocks)
+				};
+
+				CallbackKey blockKeys[2] = { 0, 0 };
+				CallbackKey doneKeys[2] = { 0, 0 };
+
+				for (uInt64 t = 0; t < 2; t++) {
+					BENCH_CHECK(dispatcher.Allocate(&blockKeys[t]) == 0, failures);
+					BENCH_CHECK(dispatcher.Allocate(&doneKeys[t]) == 0, failures);
+					BENCH_CHECK(dispatcher.RegisterEveryNSamplesEvent(tasks[t],
+						DAQmx_Val_Acquired_Into_Buffer, n, blockKeys[t]) == 0, failures);
+					BENCH_CHECK(dispatcher.RegisterDoneEvent(tasks[t], doneKeys[t]) == 0, failures);
+				}
+
+				SimSetClockMode(SimClockMode::RealTime);
+				DAQmxStartTask(tasks[0]);
+				DAQmxStartTask(tasks[1]);
+
+				const uInt64 expected = 2 * ((uInt64)blocks + 1);
+				BENCH_CHECK(WaitDelivered(dispatcher, expected, 10.0), failures);
+
+				DAQmxClearTask(tasks[0]);
+				DAQmxClearTask(tasks[1]);
+				dispatcher.Stop();
+
+				// Per task: every block in order, then Done, all delivered on
+				// dispatch threads.
+				for (uInt64 t = 0; t < 2; t++) {
+
+					uInt32 blocksSeen = 0;
+					bool doneLast = false;
+					bool wrongBlock = false;
+
+					for (const CallbackEvent& e : recorder.events) {
+
+						if (e.task != tasks[t]) {
+							continue;
+						}
+						if (e.kind == CallbackEventKind::EveryNSamples) {
+							wrongBlock = wrongBlock || doneLast || e.key != blockKeys[t]
+								|| e.nSamples != n || e.eventType != DAQmx_Val_Acquired_Into_Buffer;
+							blocksSeen++;
+						}
+						else {
+							doneLast = (e.key == doneKeys[t] && e.status == 0);
+						}
+					}
+
+					BENCH_CHECK(blocksSeen == blocks, failures);
+					BENCH_CHECK(doneLast, failures);
+					BENCH_CHECK(!wrongBlock, failures);
+				}
+
+				const CallbackDispatcherCounters counters = dispatcher.Counters();
+				BENCH_CHECK(counters.received == expected, failures);
+				BENCH_CHECK(counters.delivered == expected, failures);
+				BENCH_CHECK(counters.dropped == 0 && counters.discarded == 0, failures);
+				BENCH_CHECK(std::find(recorder.threads.begin(), recorder.threads.end(),
+					std::this_thread::get_id()) == recorder.threads.end(), failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			int CheckStalledConsumer() {
+
+				std::printf("  consumer stalled for 100 ms\n");
+
+				int failures = 0;
+				const int stallMs = 100;
+
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				config.threads = 1;
+				config.queueCapacity = 256;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				recorder.stallMs.store(stallMs);
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+
+				CallbackKey key = 0;
+				BENCH_CHECK(dispatcher.Allocate(&key) == 0, failures);
+
+				// The first event reaches the consumer, which then stalls;
+				// the producer goes on and overflows the queue.
+				BENCH_CHECK(dispatcher.Post(MakeEvent(key, 1, 0)) == 0, failures);
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				double slowestPostUs = 0.0;
+				uInt32 accepted = 0;
+				uInt32 refused = 0;
+
+				for (uInt32 i = 1; i <= 4 * config.queueCapacity; i++) {
+
+					const auto start = std::chrono::steady_clock::now();
+					const int32 r = dispatcher.Post(MakeEvent(key, 1, i));
+					slowestPostUs = std::max(slowestPostUs, 1e6 * SecondsSince(start));
+
+					if (r == 0) {
+						accepted++;
+					}
+					else {
+						refused += (r == NativeErrorQueueFull) ? 1 : 0;
+					}
+				}
+
+				std::printf("    slowest post %.1f us, %u accepted, %u refused\n",
+					slowestPostUs, accepted, refused);
+
+				BENCH_CHECK(slowestPostUs < 0.5 * 1000.0 * stallMs, failures);
+				BENCH_CHECK(accepted == config.queueCapacity, failures);
+				BENCH_CHECK(refused == 3 * config.queueCapacity, failures);
+
+				BENCH_CHECK(WaitDelivered(dispatcher, 1 + accepted, 5.0), failures);
+				dispatcher.Stop();
+
+				const CallbackDispatcherCounters counters = dispatcher.Counters();
+				BENCH_CHECK(counters.dropped == refused, failures);
+				BENCH_CHECK(counters.maxBatch > 1, failures);
+
+				// What was accepted arrives in order.
+				bool ordered = true;
+				for (size_t k = 1; k < recorder.events.size(); k++) {
+					ordered = ordered && recorder.events[k].nSamples == recorder.events[k - 1].nSamples + 1;
+				}
+				BENCH_CHECK(ordered, failures);
+				return failures;
+			}
+
+			int CheckRelease() {
+
+				std::printf("  released keys\n");
+
+				int failures = 0;
+				const uInt32 n = 100;
+				const uInt32 blocks = 50;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				BENCH_CHECK(dispatcher.Start(DefaultCallbackDispatcherConfig(),
+					&Recorder::OnBatch, &recorder) == 0, failures);
+
+				TaskHandle kept = CreateFiniteTask("callbacks kept", 100000.0, (uInt64)n * blocks);
+				TaskHandle released = CreateFiniteTask("callbacks released", 100000.0, (uInt64)n * blocks);
+
+				CallbackKey keptKey = 0;
+				CallbackKey releasedKey = 0;
+				BENCH_CHECK(dispatcher.Allocate(&keptKey) == 0, failures);
+				BENCH_CHECK(dispatcher.Allocate(&releasedKey) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(kept, keptKey) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterDoneEvent(released, releasedKey) == 0, failures);
+
+				// The driver keeps calling with the old key, whose slot now
+				// belongs to another registration.
+				CallbackKey reused = 0;
+				BENCH_CHECK(dispatcher.Release(releasedKey) == 0, failures);
+				BENCH_CHECK(dispatcher.Allocate(&reused) == 0, failures);
+				BENCH_CHECK(CallbackKeyIndex(reused) == CallbackKeyIndex(releasedKey), failures);
+
+				SimSetClockMode(SimClockMode::RealTime);
+				DAQmxStartTask(kept);
+				DAQmxStartTask(released);
+
+				BENCH_CHECK(WaitDelivered(dispatcher, 1, 5.0), failures);
+
+				bool32 done = FALSE;
+				const auto start = std::chrono::steady_clock::now();
+				while (!done && SecondsSince(start) < 5.0) {
+					DAQmxIsTaskDone(released, &done);
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				DAQmxClearTask(kept);
+				DAQmxClearTask(released);
+
+				// Events still queued when their key is released: the
+				// consumer stalls on the first one.
+				recorder.stallMs.store(100);
+				CallbackKey queuedKey = 0;
+				BENCH_CHECK(dispatcher.Allocate(&queuedKey) == 0, failures);
+				BENCH_CHECK(dispatcher.Post(MakeEvent(keptKey, 1, 0)) == 0, failures);
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				for (uInt32 i = 0; i < 10; i++) {
+					BENCH_CHECK(dispatcher.Post(MakeEvent(queuedKey, 1, i)) == 0, failures);
+				}
+				BENCH_CHECK(dispatcher.Release(queuedKey) == 0, failures);
+				dispatcher.Stop();
+
+				// Stale driver events stop in the trampoline, queued ones at
+				// delivery.
+				BENCH_CHECK(recorder.events.size() == 2, failures);
+				BENCH_CHECK(recorder.events[0].key == keptKey
+					&& recorder.events[0].kind == CallbackEventKind::Done, failures);
+				BENCH_CHECK(recorder.events[1].key == keptKey, failures);
+
+				const CallbackDispatcherCounters counters = dispatcher.Counters();
+				BENCH_CHECK(counters.received == 12, failures);
+				BENCH_CHECK(counters.discarded == 10, failures);
+				BENCH_CHECK(counters.registrations == 2, failures);
+				return failures;
+			}
+
+			struct TimingSummary {
+				double meanNs;
+				double p99Ns;
+				double maxNs;
+			};
+
+			TimingSummary Summarize(std::vector<double>& ns) {
+
+				TimingSummary summary = { 0.0, 0.0, 0.0 };
+
+				if (ns.empty()) {
+					return summary;
+				}
+
+				double sum = 0.0;
+				for (double v : ns) {
+					sum += v;
+				}
+				std::sort(ns.begin(), ns.end());
+				summary.meanNs = sum / ns.size();
+				summary.p99Ns = ns[(size_t)(0.99 * (ns.size() - 1))];
+				summary.maxNs = ns.back();
+				return summary;
+			}
+
+			void PrintLatency(const char* what, std::vector<double>& ns) {
+
+				const TimingSummary s = Summarize(ns);
+				std::printf("    %-22s mean %7.1f ns  p99 %8.1f ns  max %9.1f ns\n",
+					what, s.meanNs, s.p99Ns, s.maxNs);
+			}
+
+			// Calls `Quiesce` from the batch function.
+			struct QuiescingConsumer {
+
+				CallbackDispatcherCore* dispatcher = nullptr;
+				std::atomic<int> calls{ 0 };
+				std::atomic<int> waited{ 0 };
+
+				static void OnBatch(void* context, const CallbackEvent* /*events*/, uInt32 /*count*/) {
+
+					QuiescingConsumer* consumer = static_cast<QuiescingConsumer*>(context);
+					consumer->waited.fetch_add(consumer->dispatcher->Quiesce() ? 1 : 0);
+					consumer->calls.fetch_add(1);
+				}
+			};
+
+			int CheckQuiesce() {
+
+				std::printf("  quiescence of consumers in flight\n");
+
+				int failures = 0;
+				const int stallMs = 100;
+
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				config.threads = 1;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+
+				CallbackKey key = 0;
+				BENCH_CHECK(dispatcher.Allocate(&key) == 0, failures);
+
+				// Nothing in flight: returns at once.
+				auto start = std::chrono::steady_clock::now();
+				BENCH_CHECK(dispatcher.Quiesce(), failures);
+				const double idleUs = 1e6 * SecondsSince(start);
+
+				// The consumer is inside the batch function: the key is
+				// released at once, but `Quiesce` waits for the call.
+				recorder.stallMs.store(stallMs);
+				BENCH_CHECK(dispatcher.Post(MakeEvent(key, 1, 0)) == 0, failures);
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				start = std::chrono::steady_clock::now();
+				BENCH_CHECK(dispatcher.Release(key) == 0, failures);
+				BENCH_CHECK(dispatcher.Quiesce(), failures);
+				const double busyMs = 1e3 * SecondsSince(start);
+
+				BENCH_CHECK(recorder.Count() == 1, failures);
+				BENCH_CHECK(busyMs > 0.5 * stallMs, failures);
+				std::printf("    idle %.1f us, with a consumer in flight %.1f ms\n", idleUs, busyMs);
+				dispatcher.Stop();
+
+				// From a batch function it must not wait for itself, or for a
+				// delivery that waits for it.
+				config.threads = 2;
+				CallbackDispatcherCore quiescing;
+				QuiescingConsumer consumer;
+				consumer.dispatcher = &quiescing;
+				BENCH_CHECK(quiescing.Start(config, &QuiescingConsumer::OnBatch, &consumer) == 0, failures);
+
+				CallbackKey keys[2] = { 0, 0 };
+				BENCH_CHECK(quiescing.Allocate(&keys[0]) == 0 && quiescing.Allocate(&keys[1]) == 0, failures);
+
+				for (uInt32 i = 0; i < 100; i++) {
+					quiescing.Post(MakeEvent(keys[i & 1], 1 + (i & 1), i));
+				}
+				BENCH_CHECK(WaitDelivered(quiescing, 100, 5.0), failures);
+				quiescing.Stop();
+
+				BENCH_CHECK(consumer.calls.load() > 0 && consumer.waited.load() == 0, failures);
+				return failures;
+			}
+
+			TaskHandle CreateContinuousTask(const char* name, float64 rate) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask(name, &task);
+				DAQmxCreateAIVoltageChan(task, "SimDev1/ai0:1", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+					DAQmx_Val_ContSamps, 100000);
+				return task;
+			}
+
+			int CheckHotSwap() {
+
+				std::printf("  consumer swapped on a running task\n");
+
+				int failures = 0;
+				const uInt32 n = 100;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				BENCH_CHECK(dispatcher.Start(DefaultCallbackDispatcherConfig(),
+					&Recorder::OnBatch, &recorder) == 0, failures);
+
+				TaskHandle task = CreateContinuousTask("callbacks swap", 100000.0);
+
+				CallbackKey first = 0;
+				BENCH_CHECK(dispatcher.Allocate(&first) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterEveryNSamplesEvent(task,
+					DAQmx_Val_Acquired_Into_Buffer, n, first) == 0, failures);
+
+				SimSetClockMode(SimClockMode::RealTime);
+				DAQmxStartTask(task);
+				BENCH_CHECK(WaitDelivered(dispatcher, 10, 5.0), failures);
+
+				// Unregister, release, wait for what is in flight, register
+				// the next consumer; the task keeps running.
+				const auto start = std::chrono::steady_clock::now();
+
+				BENCH_CHECK(dispatcher.UnregisterEveryNSamplesEvent(task,
+					DAQmx_Val_Acquired_Into_Buffer, first) == 0, failures);
+				BENCH_CHECK(dispatcher.Release(first) == 0, failures);
+				BENCH_CHECK(dispatcher.Quiesce(), failures);
+				const size_t firstCount = recorder.Count(first);
+
+				CallbackKey second = 0;
+				BENCH_CHECK(dispatcher.Allocate(&second) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterEveryNSamplesEvent(task,
+					DAQmx_Val_Acquired_Into_Buffer, n, second) == 0, failures);
+
+				const double swapUs = 1e6 * SecondsSince(start);
+
+				const uInt64 delivered = dispatcher.Counters().delivered;
+				BENCH_CHECK(WaitDelivered(dispatcher, delivered + 10, 5.0), failures);
+
+				// Unregistered for good: no more events at all. The driver
+				// may still make a call it started before, which the
+				// released key turns away.
+				BENCH_CHECK(dispatcher.UnregisterEveryNSamplesEvent(task,
+					DAQmx_Val_Acquired_Into_Buffer, second) == 0, failures);
+				BENCH_CHECK(dispatcher.Release(second) == 0, failures);
+				BENCH_CHECK(dispatcher.Quiesce(), failures);
+				const uInt64 received = dispatcher.Counters().received;
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+				BENCH_CHECK(dispatcher.Counters().received == received, failures);
+				BENCH_CHECK(recorder.Count(first) == firstCount, failures);
+				BENCH_CHECK(recorder.Count(second) >= 10, failures);
+				BENCH_CHECK(dispatcher.UnregisterDoneEvent(task, first) == NativeErrorInvalidArgument, failures);
+
+				DAQmxClearTask(task);
+				dispatcher.Stop();
+
+				std::printf("    swap %.1f us; %zu events before, %zu after\n",
+					swapUs, firstCount, recorder.Count(second));
+				return failures;
+			}
+
+			int CheckSignals(uInt32 raises) {
+
+				std::printf("  signal events, %u change detections\n", raises);
+
+				int failures = 0;
+
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				config.threads = 1;
+				config.signalCapacity = 1024;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("callbacks signals", &task);
+
+				CallbackKey key = 0;
+				BENCH_CHECK(dispatcher.Allocate(&key) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterSignalEvent(task, DAQmx_Val_ChangeDetectionEvent, key) == 0,
+					failures);
+				BENCH_CHECK(dispatcher.RegisterSignalEvent(task, DAQmx_Val_ChangeDetectionEvent, key)
+					== NativeErrorInvalidArgument, failures);
+
+				// One edge at a time: the reaction time of an idle consumer.
+				for (uInt32 i = 0; i < raises; i++) {
+					SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+					BENCH_CHECK(WaitDelivered(dispatcher, i + 1, 5.0), failures);
+				}
+
+				std::vector<int64> latency;
+				{
+					std::lock_guard<std::mutex> lock(recorder.mutex);
+					latency = recorder.latencyNs;
+					recorder.latencyNs.clear();
+				}
+				std::sort(latency.begin(), latency.end());
+				const int64 p50 = latency.empty() ? 0 : latency[latency.size() / 2];
+				const int64 p99 = latency.empty() ? 0 : latency[(size_t)(0.99 * (latency.size() - 1))];
+
+				std::printf("    edge to consumer: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+					1e-3 * p50, 1e-3 * p99, latency.empty() ? 0.0 : 1e-3 * latency.back());
+				BENCH_CHECK(p50 < 1000000, failures);
+
+				std::vector<CallbackEvent> events;
+				{
+					std::lock_guard<std::mutex> lock(recorder.mutex);
+					events = recorder.events;
+				}
+
+				bool allSignals = true;
+				for (const CallbackEvent& e : events) {
+					allSignals = allSignals && e.kind == CallbackEventKind::Signal && e.key == key
+						&& e.eventType == DAQmx_Val_ChangeDetectionEvent && e.timeNs > 0;
+				}
+				BENCH_CHECK(allSignals, failures);
+
+				// A burst behind a stalled consumer: one queue entry, the rest
+				// waits in the ring and arrives with its own times.
+				recorder.stallMs.store(50);
+				SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				const uInt32 burst = 500;
+				const uInt64 coalescedBefore = dispatcher.Counters().coalesced;
+
+				for (uInt32 i = 0; i < burst; i++) {
+					SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+				}
+				BENCH_CHECK(WaitDelivered(dispatcher, raises + 1 + burst, 5.0), failures);
+				BENCH_CHECK(dispatcher.Counters().coalesced - coalescedBefore == burst - 1, failures);
+
+				{
+					std::lock_guard<std::mutex> lock(recorder.mutex);
+					events = recorder.events;
+				}
+
+				bool ordered = true;
+				for (size_t k = raises + 2; k < events.size(); k++) {
+					ordered = ordered && events[k].timeNs >= events[k - 1].timeNs;
+				}
+				BENCH_CHECK(ordered, failures);
+
+				// A burst past the ring: the rest is dropped, not waited for.
+				recorder.stallMs.store(50);
+				SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				const uInt64 droppedBefore = dispatcher.Counters().dropped;
+				for (uInt32 i = 0; i < 2 * config.signalCapacity; i++) {
+					SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+				}
+				BENCH_CHECK(dispatcher.Counters().dropped - droppedBefore == config.signalCapacity, failures);
+				BENCH_CHECK(WaitDelivered(dispatcher, raises + 2 + burst + config.signalCapacity, 5.0),
+					failures);
+
+				// Unregistered and released: the ring goes with the next
+				// quiescence, and late signals are turned away.
+				BENCH_CHECK(dispatcher.UnregisterSignalEvent(task, DAQmx_Val_ChangeDetectionEvent, key) == 0,
+					failures);
+				BENCH_CHECK(dispatcher.Release(key) == 0, failures);
+				BENCH_CHECK(dispatcher.Quiesce(), failures);
+
+				const uInt64 received = dispatcher.Counters().received;
+				SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+				BENCH_CHECK(dispatcher.Counters().received == received, failures);
+
+				// Sample clock signals of a running task, next to its Done
+				// event.
+				const uInt32 blocks = 20;
+				TaskHandle clocked = CreateFiniteTask("callbacks clock", 100000.0, 100 * blocks);
+				CallbackKey clockKey = 0;
+				CallbackKey doneKey = 0;
+				BENCH_CHECK(dispatcher.Allocate(&clockKey) == 0 && dispatcher.Allocate(&doneKey) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterEveryNSamplesEvent(clocked,
+					DAQmx_Val_Acquired_Into_Buffer, 100, doneKey) == 0, failures);
+				BENCH_CHECK(dispatcher.RegisterSignalEvent(clocked, DAQmx_Val_SampleClock, clockKey) == 0,
+					failures);
+
+				SimSetClockMode(SimClockMode::RealTime);
+				const uInt64 delivered = dispatcher.Counters().delivered;
+				DAQmxStartTask(clocked);
+				BENCH_CHECK(WaitDelivered(dispatcher, delivered + 2 * blocks, 5.0), failures);
+				DAQmxClearTask(clocked);
+				DAQmxClearTask(task);
+				dispatcher.Stop();
+
+				BENCH_CHECK(recorder.Count(clockKey) == blocks, failures);
+
+				const CallbackDispatcherCounters counters = dispatcher.Counters();
+				std::printf("    %llu signals, %llu coalesced, %llu dropped\n",
+					(unsigned long long)counters.signals, (unsigned long long)counters.coalesced,
+					(unsigned long long)counters.dropped);
+				return failures;
+			}
+
+			int CheckConcurrentQuiesce(uInt32 rounds) {
+
+				std::printf("  quiescence from two threads, %u signal rings each\n", rounds);
+
+				int failures = 0;
+
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				config.threads = 1;
+				config.signalCapacity = 64;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+
+				// Each thread retires its own rings and frees whatever both
+				// have retired, as two handles unregistering at once do.
+				std::atomic<int> errors{ 0 };
+				auto churn = [&](const char* name) {
+
+					TaskHandle task = NULL;
+					DAQmxCreateTask(name, &task);
+
+					for (uInt32 i = 0; i < rounds; i++) {
+
+						CallbackKey key = 0;
+						if (dispatcher.Allocate(&key) != 0
+							|| dispatcher.RegisterSignalEvent(task, DAQmx_Val_ChangeDetectionEvent, key) != 0) {
+							errors.fetch_add(1);
+							continue;
+						}
+
+						SimRaiseSignal(task, DAQmx_Val_ChangeDetectionEvent);
+
+						if (dispatcher.UnregisterSignalEvent(task, DAQmx_Val_ChangeDetectionEvent, key) != 0
+							|| dispatcher.Release(key) != 0 || !dispatcher.Quiesce()) {
+							errors.fetch_add(1);
+						}
+					}
+					DAQmxClearTask(task);
+				};
+
+				std::thread first(churn, "callbacks quiesce 1");
+				std::thread second(churn, "callbacks quiesce 2");
+				first.join();
+				second.join();
+
+				BENCH_CHECK(errors.load() == 0, failures);
+				BENCH_CHECK(dispatcher.Counters().registrations == 0, failures);
+				BENCH_CHECK(dispatcher.Quiesce(), failures);
+				dispatcher.Stop();
+
+				std::printf("    %llu signals, %llu discarded with their keys\n",
+					(unsigned long long)dispatcher.Counters().signals,
+					(unsigned long long)dispatcher.Counters().discarded);
+				return failures;
+			}
+
+			// Records the stages of every batch, as a managed handle does
+			// around its delegates.
+			struct LatencyRecorder {
+
+				CallbackLatencyCore latency;
+				std::atomic<uInt64> events{ 0 };
+				std::atomic<bool> ordered{ true };
+
+				// Busy time of the consumer per call.
+				int64 workNs = 20000;
+
+				static void OnBatch(void* context, const CallbackEvent* events, uInt32 count) {
+
+					LatencyRecorder* recorder = static_cast<LatencyRecorder*>(context);
+					const int64 calledNs = HostMonotonicNs();
+
+					for (uInt32 k = 0; k < count; k++) {
+						const CallbackEvent& e = events[k];
+						if (e.queuedNs != 0 && (e.queuedNs < e.timeNs || e.dispatchNs < e.queuedNs
+							|| calledNs < e.dispatchNs)) {
+							recorder->ordered.store(false);
+						}
+					}
+
+					while (HostMonotonicNs() - calledNs < recorder->workNs) {
+					}
+
+					recorder->latency.Record(events, count, calledNs, HostMonotonicNs());
+					recorder->events.fetch_add(count);
+				}
+			};
+
+			void PrintStage(const char* name, const LatencySummary& s) {
+
+				std::printf("    %-10s n %6llu  p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  max %8.1f us\n",
+					name, (unsigned long long)s.count, 1e-3 * s.p50Ns, 1e-3 * s.p99Ns,
+					1e-3 * s.p999Ns, 1e-3 * s.maxNs);
+			}
+
+			int CheckLatency(uInt32 blocks) {
+
+				std::printf("  latency histograms, %u blocks\n", blocks);
+
+				int failures = 0;
+
+				// Buckets hold their values and are at most 1/64 as wide.
+				bool bucketsHold = true;
+				for (int64 v = 0; v < ((int64)1 << 40); v = v + 1 + v / 7) {
+
+					const uInt32 b = LatencyHistogram::BucketOf(v);
+					const int64 low = LatencyHistogram::BucketLowestNs(b);
+					const int64 high = LatencyHistogram::BucketHighestNs(b);
+
+					if (v < ((int64)1 << LatencyMaxBits)) {
+						bucketsHold = bucketsHold && low <= v && v <= high
+							&& (high - low + 1) <= std::max<int64>(1, low >> LatencySubBucketBits);
+					}
+					else {
+						bucketsHold = bucketsHold && b == LatencyBucketCount - 1;
+					}
+				}
+				BENCH_CHECK(bucketsHold, failures);
+
+				LatencyHistogram histogram;
+				BENCH_CHECK(histogram.IsValid(), failures);
+
+				for (int64 v = 1; v <= 100000; v++) {
+					histogram.Record(v);
+				}
+
+				const LatencySummary summary = histogram.Summary();
+				BENCH_CHECK(summary.count == 100000 && summary.minNs == 1 && summary.maxNs == 100000,
+					failures);
+				BENCH_CHECK(summary.meanNs == 50000, failures);
+				BENCH_CHECK(summary.p50Ns >= 50000 && summary.p50Ns <= 50000 + 50000 / 64, failures);
+				BENCH_CHECK(summary.p99Ns >= 99000 && summary.p99Ns <= 99000 + 99000 / 64, failures);
+				BENCH_CHECK(histogram.ValueAtPercentile(100.0) == 100000, failures);
+
+				histogram.Reset();
+				BENCH_CHECK(histogram.Count() == 0 && histogram.Summary().p99Ns == 0, failures);
+
+				// Stamped events of a running task: every stage of every
+				// event, in order.
+				for (bool stamp : { true, false }) {
+
+					CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+					config.stampLatency = stamp;
+
+					CallbackDispatcherCore dispatcher;
+					LatencyRecorder recorder;
+					BENCH_CHECK(recorder.latency.IsValid(), failures);
+					BENCH_CHECK(dispatcher.Start(config, &LatencyRecorder::OnBatch, &recorder) == 0,
+						failures);
+
+					const uInt32 n = 100;
+					TaskHandle task = CreateFiniteTask("callbacks latency", 100000.0, (uInt64)n * blocks);
+					CallbackKey blockKey = 0;
+					CallbackKey clockKey = 0;
+					BENCH_CHECK(dispatcher.Allocate(&blockKey) == 0 && dispatcher.Allocate(&clockKey) == 0,
+						failures);
+					BENCH_CHECK(dispatcher.RegisterEveryNSamplesEvent(task,
+						DAQmx_Val_Acquired_Into_Buffer, n, blockKey) == 0, failures);
+					BENCH_CHECK(dispatcher.RegisterSignalEvent(task, DAQmx_Val_SampleClock, clockKey) == 0,
+						failures);
+
+					SimSetClockMode(SimClockMode::RealTime);
+					DAQmxStartTask(task);
+					BENCH_CHECK(WaitDelivered(dispatcher, 2 * (uInt64)blocks, 10.0), failures);
+					DAQmxClearTask(task);
+					dispatcher.Stop();
+
+					const uInt64 events = recorder.events.load();
+					const CallbackLatencyCore& latency = recorder.latency;
+					const uInt64 calls = dispatcher.Counters().batches;
+
+					BENCH_CHECK(recorder.ordered.load(), failures);
+					BENCH_CHECK(latency.Summary(CallbackLatencyStage::EndToEnd).count == events, failures);
+					BENCH_CHECK(latency.Summary(CallbackLatencyStage::Consumer).count == calls, failures);
+					BENCH_CHECK(latency.Summary(CallbackLatencyStage::Consumer).p50Ns >= recorder.workNs,
+						failures);
+
+					const uInt64 stamped = stamp ? events : 0;
+					BENCH_CHECK(latency.Summary(CallbackLatencyStage::Driver).count == stamped, failures);
+					BENCH_CHECK(latency.Summary(CallbackLatencyStage::Queue).count == stamped, failures);
+					BENCH_CHECK(latency.Summary(CallbackLatencyStage::Transition).count == stamped, failures);
+
+					if (stamp) {
+						PrintStage("driver", latency.Summary(CallbackLatencyStage::Driver));
+						PrintStage("queue", latency.Summary(CallbackLatencyStage::Queue));
+						PrintStage("transition", latency.Summary(CallbackLatencyStage::Transition));
+						PrintStage("consumer", latency.Summary(CallbackLatencyStage::Consumer));
+						PrintStage("end to end", latency.Summary(CallbackLatencyStage::EndToEnd));
+					}
+				}
+				return failures;
+			}
+
+			// Records the thread, its schedule and the latency of every
+			// event.
+			struct ScheduleRecorder {
+
+				struct Seen {
+					TaskHandle task;
+					std::thread::id thread;
+					ThreadSchedule schedule;
+					int64 latencyNs;
+				};
+
+				std::mutex mutex;
+				std::vector<Seen> seen;
+
+				static void OnBatch(void* context, const CallbackEvent* events, uInt32 count) {
+
+					ScheduleRecorder* recorder = static_cast<ScheduleRecorder*>(context);
+					const int64 now = HostMonotonicNs();
+
+					ThreadSchedule schedule;
+					CurrentThreadSchedule(&schedule);
+
+					std::lock_guard<std::mutex> lock(recorder->mutex);
+					for (uInt32 k = 0; k < count; k++) {
+						recorder->seen.push_back({ events[k].task, std::this_thread::get_id(),
+							schedule, now - events[k].timeNs });
+					}
+				}
+
+				// The thread of every event of `task`, or a default id if
+				// they ran on more than one.
+				std::thread::id ThreadOf(TaskHandle task, ThreadSchedule& schedule,
+					std::vector<int64>& latencyNs) {
+
+					std::lock_guard<std::mutex> lock(mutex);
+					std::thread::id thread;
+					bool first = true;
+
+					for (const Seen& s : seen) {
+						if (s.task != task) {
+							continue;
+						}
+						if (first) {
+							thread = s.thread;
+							schedule = s.schedule;
+							first = false;
+						}
+						else if (s.thread != thread) {
+							return std::thread::id();
+						}
+						latencyNs.push_back(s.latencyNs);
+					}
+					return thread;
+				}
+			};
+
+			int CheckDispatchThreads(uInt32 events) {
+
+				std::printf("  dedicated dispatch threads, %u events per task\n", events);
+
+				int failures = 0;
+
+				// Settings refused, by the dispatcher or by the OS.
+				{
+					CallbackDispatcherCore dispatcher;
+					ScheduleRecorder recorder;
+					CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+
+					config.threads = 10;
+					config.dedicatedThreads = CallbackMaxDispatchThreads - 9;
+					BENCH_CHECK(dispatcher.Start(config, &ScheduleRecorder::OnBatch, &recorder)
+						== NativeErrorInvalidArgument, failures);
+
+					config.threads = 1;
+					config.dedicatedThreads = 1;
+					config.thread[1].schedule.priority = ThreadPriority::RealTime;
+					config.thread[1].schedule.realTimePriority = 0;
+					BENCH_CHECK(dispatcher.Start(config, &ScheduleRecorder::OnBatch, &recorder)
+						== NativeErrorInvalidArgument, failures);
+					BENCH_CHECK(!dispatcher.IsRunning(), failures);
+
+					if (LogicalCpuCount() < 64) {
+						config.thread[1] = DefaultCallbackDispatcherConfig().thread[1];
+						config.thread[1].schedule.affinityMask = (uInt64)1 << 63;
+						BENCH_CHECK(dispatcher.Start(config, &ScheduleRecorder::OnBatch, &recorder)
+							== NativeErrorInvalidArgument, failures);
+					}
+				}
+
+				// One shared thread; a dedicated one pinned to CPU 0 at a
+				// real-time priority, and one that polls.
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				config.threads = 1;
+				config.dedicatedThreads = 2;
+				config.thread[1].schedule.affinityMask = 1;
+				config.thread[1].schedule.priority = ThreadPriority::RealTime;
+				config.thread[1].schedule.realTimePriority = 10;
+				config.thread[2].busyPoll = true;
+
+				CallbackDispatcherCore dispatcher;
+				ScheduleRecorder recorder;
+
+				int32 started = dispatcher.Start(config, &ScheduleRecorder::OnBatch, &recorder);
+				bool realTime = true;
+
+				if (started == NativeErrorPermissionDenied) {
+					std::printf("    real-time priority refused by the OS, checked without it\n");
+					config.thread[1].schedule.priority = ThreadPriority::Normal;
+					realTime = false;
+					started = dispatcher.Start(config, &ScheduleRecorder::OnBatch, &recorder);
+				}
+				BENCH_CHECK(started == 0, failures);
+
+				const TaskHandle pinned = reinterpret_cast<TaskHandle>((uintptr_t)0x1000);
+				const TaskHandle polled = reinterpret_cast<TaskHandle>((uintptr_t)0x2000);
+				const TaskHandle shared = reinterpret_cast<TaskHandle>((uintptr_t)0x3000);
+
+				BENCH_CHECK(dispatcher.RouteTask(pinned, 1) == 0, failures);
+				BENCH_CHECK(dispatcher.RouteTask(polled, 2) == 0, failures);
+				BENCH_CHECK(dispatcher.RouteTask(polled, 3) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.RouteTask(NULL, 1) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(dispatcher.ThreadOfTask(pinned) == 1, failures);
+				BENCH_CHECK(dispatcher.ThreadOfTask(polled) == 2, failures);
+				BENCH_CHECK(dispatcher.ThreadOfTask(shared) == 0, failures);
+
+				CallbackKey key = 0;
+				BENCH_CHECK(dispatcher.Allocate(&key) == 0, failures);
+
+				// One event at a time: the reaction time of each thread.
+				uInt64 posted = 0;
+				for (uInt32 i = 0; i < events; i++) {
+					for (TaskHandle task : { pinned, polled, shared }) {
+						BENCH_CHECK(dispatcher.Post(MakeEvent(key, (uInt64)(uintptr_t)task, i)) == 0,
+							failures);
+						BENCH_CHECK(WaitDelivered(dispatcher, ++posted, 5.0), failures);
+					}
+				}
+
+				BENCH_CHECK(dispatcher.UnrouteTask(pinned) == 0, failures);
+				BENCH_CHECK(dispatcher.ThreadOfTask(pinned) == 0, failures);
+				dispatcher.Stop();
+
+				ThreadSchedule pinnedSchedule = DefaultThreadSchedule();
+				ThreadSchedule polledSchedule = DefaultThreadSchedule();
+				ThreadSchedule sharedSchedule = DefaultThreadSchedule();
+				std::vector<int64> pinnedNs;
+				std::vector<int64> polledNs;
+				std::vector<int64> sharedNs;
+
+				const std::thread::id pinnedThread = recorder.ThreadOf(pinned, pinnedSchedule, pinnedNs);
+				const std::thread::id polledThread = recorder.ThreadOf(polled, polledSchedule, polledNs);
+				const std::thread::id sharedThread = recorder.ThreadOf(shared, sharedSchedule, sharedNs);
+
+				BENCH_CHECK(pinnedThread != std::thread::id() && polledThread != std::thread::id()
+					&& sharedThread != std::thread::id(), failures);
+				BENCH_CHECK(pinnedThread != polledThread && pinnedThread != sharedThread
+					&& polledThread != sharedThread, failures);
+
+				BENCH_CHECK(pinnedSchedule.affinityMask == 1, failures);
+				BENCH_CHECK(pinnedSchedule.priority
+					== (realTime ? ThreadPriority::RealTime : ThreadPriority::Normal), failures);
+				BENCH_CHECK(!realTime || pinnedSchedule.realTimePriority == 10, failures);
+				BENCH_CHECK(polledSchedule.priority == ThreadPriority::Normal, failures);
+				BENCH_CHECK(sharedSchedule.priority == ThreadPriority::Normal, failures);
+
+				for (std::vector<int64>* ns : { &pinnedNs, &polledNs, &sharedNs }) {
+					std::sort(ns->begin(), ns->end());
+				}
+
+				auto percentile = [](const std::vector<int64>& ns, double p) {
+					return ns.empty() ? 0.0 : 1e-3 * ns[(size_t)(p * (ns.size() - 1))];
+				};
+
+				std::printf("    post to consumer p50/p99: pinned%s %.1f/%.1f us, polling %.1f/%.1f us,"
+					" shared %.1f/%.1f us\n", realTime ? " real-time" : "",
+					percentile(pinnedNs, 0.5), percentile(pinnedNs, 0.99),
+					percentile(polledNs, 0.5), percentile(polledNs, 0.99),
+					percentile(sharedNs, 0.5), percentile(sharedNs, 0.99));
+				return failures;
+			}
+
+			int MeasureRegistration(uInt32 handles) {
+
+				std::printf("  registration of %u keys\n", handles);
+
+				int failures = 0;
+
+				CallbackDispatcherCore dispatcher;
+				Recorder recorder;
+				CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+				config.maxRegistrations = handles;
+				BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+
+				TaskHandle task = CreateFiniteTask("callbacks registration", 1000.0, 1000);
+
+				std::vector<CallbackKey> keys(handles, 0);
+				std::vector<double> allocateNs(handles);
+				std::vector<double> registerNs(handles);
+				std::vector<double> releaseNs(handles);
+
+				size_t slots = 0;
+
+				// The first round grows the registry; the second must reuse
+				// its slots without allocating.
+				for (int round = 0; round < 2; round++) {
+
+					int32 worst = 0;
+
+					for (uInt32 i = 0; i < handles; i++) {
+
+						auto start = std::chrono::steady_clock::now();
+						int32 r = dispatcher.Allocate(&keys[i]);
+						allocateNs[i] = 1e9 * SecondsSince(start);
+						worst = (r != 0) ? r : worst;
+
+						start = std::chrono::steady_clock::now();
+						r = dispatcher.RegisterEveryNSamplesEvent(task,
+							DAQmx_Val_Acquired_Into_Buffer, 100, keys[i]);
+						registerNs[i] = 1e9 * SecondsSince(start);
+						worst = (r != 0) ? r : worst;
+					}
+
+					BENCH_CHECK(dispatcher.Counters().registrations == handles, failures);
+
+					if (round == 0) {
+						slots = CallbackRegistry::Instance().SlotCount();
+					}
+					else {
+						BENCH_CHECK(CallbackRegistry::Instance().SlotCount() == slots, failures);
+					}
+
+					for (uInt32 i = 0; i < handles; i++) {
+
+						const auto start = std::chrono::steady_clock::now();
+						const int32 r = dispatcher.Release(keys[i]);
+						releaseNs[i] = 1e9 * SecondsSince(start);
+						worst = (r != 0) ? r : worst;
+					}
+
+					BENCH_CHECK(worst == 0, failures);
+					BENCH_CHECK(dispatcher.Counters().registrations == 0, failures);
+
+					std::printf("    %s round\n", (round == 0) ? "first" : "second");
+					PrintLatency("allocate", allocateNs);
+					PrintLatency("register with DAQmx", registerNs);
+					PrintLatency("release", releaseNs);
+				}
+
+				DAQmxClearTask(task);
+				dispatcher.Stop();
+				return failures;
+			}
+
+			int MeasureThroughput(uInt32 eventsPerProducer) {
+
+				int failures = 0;
+
+				for (uInt32 producers : { 1u, 2u, 4u }) {
+
+					CallbackDispatcherCore dispatcher;
+					Recorder recorder;
+					CallbackDispatcherConfig config = DefaultCallbackDispatcherConfig();
+					config.queueCapacity = 1 << 16;
+
+					BENCH_CHECK(dispatcher.Start(config, &Recorder::OnBatch, &recorder) == 0, failures);
+
+					std::vector<CallbackKey> keys(producers, 0);
+					for (CallbackKey& key : keys) {
+						BENCH_CHECK(dispatcher.Allocate(&key) == 0, failures);
+					}
+
+					const auto start = std::chrono::steady_clock::now();
+
+					std::vector<std::thread> threads;
+					for (uInt32 p = 0; p < producers; p++) {
+						threads.emplace_back([&dispatcher, &keys, p, eventsPerProducer]() {
+							for (uInt32 i = 0; i < eventsPerProducer; i++) {
+								while (dispatcher.Post(MakeEvent(keys[p], 16 + 16 * p, i)) == NativeErrorQueueFull) {
+									std::this_thread::yield();
+								}
+							}
+						});
+					}
+					for (std::thread& t : threads) {
+						t.join();
+					}
+
+					const uInt64 total = (uInt64)producers * eventsPerProducer;
+					BENCH_CHECK(WaitDelivered(dispatcher, total, 30.0), failures);
+					const double seconds = SecondsSince(start);
+					dispatcher.Stop();
+
+					const CallbackDispatcherCounters counters = dispatcher.Counters();
+					std::printf("  %u producer(s): %8.2f M events/s, %6.1f events/batch, largest %llu\n",
+						producers, 1e-6 * total / seconds,
+						(double)counters.delivered / std::max<uInt64>(counters.batches, 1),
+						(unsigned long long)counters.maxBatch);
+				}
+				return failures;
+			}
+		}
+
+		int RunCallbackBench(const BenchOptions& options) {
+
+			int failures = 0;
+
+			failures += CheckQueue(options.quick ? 100000 : 1000000);
+			failures += CheckArguments();
+			failures += CheckRegistry();
+			failures += CheckDelivery(options.quick ? 100 : 1000);
+			failures += CheckStalledConsumer();
+			failures += CheckRelease();
+			failures += CheckQuiesce();
+			failures += CheckHotSwap();
+			failures += CheckSignals(options.quick ? 200 : 2000);
+			failures += CheckConcurrentQuiesce(options.quick ? 200 : 2000);
+			failures += CheckLatency(options.quick ? 50 : 500);
+			failures += CheckDispatchThreads(options.quick ? 200 : 2000);
+			failures += MeasureRegistration(10000);
+			failures += MeasureThroughput(options.quick ? 200000 : 2000000);
+			return failures;
+		}
+	}
+}
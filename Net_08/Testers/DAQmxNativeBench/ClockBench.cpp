@@ -0,0 +1,555 @@
+// Checks the sample clock / host clock estimator (ClockDriftEstimatorCore)
+// on synthetic callbacks with a known drift, scheduling jitter and late
+// callbacks, compares its per-sample timestamps with timestamping each block
+// at its callback and its slope with raw-sum least squares (as in
+// Regression.LinearLSF), then runs it inside the acquisition engine.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AcquisitionEngineCore.h"
+#include "Native/ClockDriftEstimatorCore.h"
+#include "Native/HostClock.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			/**
+			* Device whose sample clock runs `ppm` off its nominal rate (slowly
+			* changing, as with temperature) and whose EveryNSamples callbacks
+			* reach the host after a constant latency plus scheduling jitter,
+			* and now and then much later.
+			*/
+			struct SyntheticDevice {
+
+				float64 nominalRate;
+				// Drift changes linearly by `rampPpm` every `rampBlocks` blocks.
+				float64 startPpm;
+				float64 rampPpm;
+				uInt64 rampBlocks;
+				uInt32 blockSamples;
+
+				// Host time of the first sample clock edge; large, like the
+				// uptime of a machine that has been running for days.
+				int64 startNs;
+				// Samples acquired before the observed stretch.
+				uInt64 startIndex;
+
+				float64 latencyNs;
+				float64 jitterMeanNs;
+				float64 lateProbability;
+				float64 lateMinNs;
+				float64 lateMaxNs;
+
+				std::mt19937_64 random;
+
+				float64 PpmAt(uInt64 block) const {
+					return startPpm + rampPpm * (float64)block / (float64)rampBlocks;
+				}
+
+				// True host time of the clock edge of sample `sample` relative
+				// to `startIndex`: the period integrated over the linear drift.
+				float64 EdgeNs(float64 sample) const {
+					const float64 blocks = sample / blockSamples;
+					const float64 ppm = startPpm + 0.5 * rampPpm * blocks / (float64)rampBlocks;
+					return (float64)startNs + sample * 1.0e9 / (nominalRate * (1.0 + ppm * 1e-6));
+				}
+
+				// Host time at which the callback of block `block` sees its
+				// samples acquired.
+				int64 CallbackNs(uInt64 block) {
+
+					std::exponential_distribution<float64> jitter(1.0 / jitterMeanNs);
+					std::uniform_real_distribution<float64> uniform(0.0, 1.0);
+
+					float64 delay = latencyNs + jitter(random);
+
+					if (uniform(random) < lateProbability) {
+						delay += lateMinNs + (lateMaxNs - lateMinNs) * uniform(random);
+					}
+					return (int64)std::llround(EdgeNs((float64)((block + 1) * blockSamples)) + delay);
+				}
+			};
+
+			SyntheticDevice MakeDevice() {
+
+				SyntheticDevice device;
+				device.nominalRate = 100000.0;
+				device.startPpm = 31.0;
+				device.rampPpm = 5.0;
+				device.rampBlocks = 100000;
+				device.blockSamples = 1000;
+				device.startNs = 9LL * 24 * 3600 * 1000000000LL;
+				device.startIndex = 3ULL * 24 * 3600 * 100000;
+				device.latencyNs = 40000.0;
+				device.jitterMeanNs = 20000.0;
+				device.lateProbability = 0.01;
+				device.lateMinNs = 1.0e6;
+				device.lateMaxNs = 5.0e6;
+				device.random.seed(20240517);
+				return device;
+			}
+
+			/**
+			* Least squares from raw sums, the way Regression.LinearLSF
+			* computes the slope.
+			*/
+			float64 RawSumSlope(const std::vector<float64>& x, const std::vector<float64>& y) {
+
+				float64 sumX = 0.0;
+				float64 sumY = 0.0;
+				float64 sumXSq = 0.0;
+				float64 sumCodeviates = 0.0;
+				const float64 n = (float64)x.size();
+
+				for (size_t i = 0; i < x.size(); i++) {
+					sumCodeviates += x[i] * y[i];
+					sumX += x[i];
+					sumY += y[i];
+					sumXSq += x[i] * x[i];
+				}
+
+				const float64 sCo = sumCodeviates - sumX * sumY / n;
+				const float64 ssX = sumXSq - sumX * sumX / n;
+				return sCo / ssX;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+
+				ClockDriftEstimatorCore estimator;
+				ClockDriftEstimatorConfig config = DefaultClockDriftEstimatorConfig();
+				int64 time = 0;
+				float64 index = 0.0;
+				int64 times[4];
+
+				config.window = 0;
+				BENCH_CHECK(estimator.Configure(config) == NativeErrorInvalidArgument, failures);
+				config = DefaultClockDriftEstimatorConfig();
+				config.nominalRate = -1.0;
+				BENCH_CHECK(estimator.Configure(config) == NativeErrorInvalidArgument, failures);
+
+				// No fit before the first observation; with one observation only
+				// with a nominal rate.
+				config = DefaultClockDriftEstimatorConfig();
+				BENCH_CHECK(estimator.Configure(config) == NativeSuccess, failures);
+				BENCH_CHECK(!estimator.SampleHostTime(0, time), failures);
+				BENCH_CHECK(estimator.InterpolateHostTimes(0, 4, times) == NativeErrorInvalidState,
+					failures);
+				BENCH_CHECK(estimator.AddObservation(1000, 5000000), failures);
+				BENCH_CHECK(!estimator.SampleAtHostTime(5000000, index), failures);
+
+				config.nominalRate = 1000.0;
+				BENCH_CHECK(estimator.Configure(config) == NativeSuccess, failures);
+				BENCH_CHECK(estimator.AddObservation(1000, 5000000), failures);
+				BENCH_CHECK(estimator.SampleHostTime(999, time) && time == 5000000, failures);
+				BENCH_CHECK(estimator.SampleHostTime(1999, time) && time == 1005000000, failures);
+				BENCH_CHECK(estimator.InterpolateHostTimes(0, 4, nullptr) == NativeErrorInvalidArgument,
+					failures);
+
+				// An unchanged count is ignored, a lower one restarts the fit.
+				BENCH_CHECK(!estimator.AddObservation(1000, 6000000), failures);
+				BENCH_CHECK(estimator.AddObservation(2000, 1005000000), failures);
+				BENCH_CHECK(estimator.AddObservation(500, 1100000000), failures);
+
+				ClockFit fit = estimator.GetFit();
+				BENCH_CHECK(fit.observations == 3 && fit.reseeds == 1, failures);
+				BENCH_CHECK(fit.baseIndex == 500 && fit.baseTimeNs == 1100000000, failures);
+
+				estimator.Reset();
+				fit = estimator.GetFit();
+				BENCH_CHECK(fit.observations == 0 && std::isnan(fit.periodNs), failures);
+				return failures;
+			}
+
+			/**
+			* Feeds the synthetic callbacks and compares the per-sample host
+			* times with the true clock edges.
+			*/
+			int CheckAccuracy(uInt64 blocks) {
+
+				int failures = 0;
+				SyntheticDevice device = MakeDevice();
+
+				ClockDriftEstimatorCore estimator;
+				ClockDriftEstimatorConfig config = DefaultClockDriftEstimatorConfig();
+				config.nominalRate = device.nominalRate;
+				config.window = 1024;
+				BENCH_CHECK(estimator.Configure(config) == NativeSuccess, failures);
+
+				// Samples of the last block, checked every `checkEvery` blocks
+				// once the window has filled.
+				const uInt64 settle = 2 * config.window;
+				const uInt64 checkEvery = 97;
+				std::vector<int64> times(device.blockSamples);
+
+				float64 fitSum = 0.0, fitSq = 0.0;
+				float64 naiveSum = 0.0, naiveSq = 0.0;
+				float64 fitMax = 0.0, naiveMax = 0.0;
+				float64 worstPpm = 0.0;
+				uInt64 checked = 0;
+				uInt64 mapped = 0;
+
+				std::vector<float64> fitErrors;
+				std::vector<float64> naiveErrors;
+
+				for (uInt64 b = 0; b < blocks; b++) {
+
+					const uInt64 acquired = device.startIndex + (b + 1) * device.blockSamples;
+					const int64 hostNs = device.CallbackNs(b);
+					estimator.AddObservation(acquired, hostNs);
+
+					if (b < settle || b % checkEvery != 0) {
+						continue;
+					}
+
+					const ClockFit fit = estimator.GetFit();
+					worstPpm = std::max(worstPpm, std::fabs(fit.driftPpm - device.PpmAt(b)));
+
+					const uInt64 first = acquired - device.blockSamples;
+					BENCH_CHECK(estimator.InterpolateHostTimes(first, device.blockSamples,
+						times.data()) == NativeSuccess, failures);
+
+					for (uInt32 i = 0; i < device.blockSamples; i++) {
+
+						// Sample `first + i` is the edge after `first + i - startIndex`
+						// samples.
+						const float64 edge = device.EdgeNs((float64)(first + i - device.startIndex));
+						const float64 fitError = (float64)times[i] - edge;
+						// Block timestamp, samples spaced at the nominal period back
+						// from it.
+						const float64 naive = (float64)hostNs
+							- (device.blockSamples - 1 - i) * 1.0e9 / device.nominalRate;
+						const float64 naiveError = naive - edge;
+
+						fitSum += fitError;
+						fitSq += fitError * fitError;
+						naiveSum += naiveError;
+						naiveSq += naiveError * naiveError;
+						fitErrors.push_back(fitError);
+						naiveErrors.push_back(naiveError);
+						checked++;
+					}
+
+					// Host time back to the sample.
+					float64 index = 0.0;
+					int64 time = 0;
+					estimator.SampleHostTime(first + 500, time);
+					estimator.SampleAtHostTime(time, index);
+					mapped += (std::fabs(index - (float64)(first + 500)) < 0.01);
+				}
+
+				// The constant part (latency, mean callback delay) is common to
+				// all samples; what matters is the scatter around it.
+				const float64 fitMean = fitSum / checked;
+				const float64 naiveMean = naiveSum / checked;
+				const float64 fitStd = std::sqrt(std::max(fitSq / checked - fitMean * fitMean, 0.0));
+				const float64 naiveStd = std::sqrt(std::max(naiveSq / checked - naiveMean * naiveMean, 0.0));
+
+				for (float64 e : fitErrors) {
+					fitMax = std::max(fitMax, std::fabs(e - fitMean));
+				}
+				for (float64 e : naiveErrors) {
+					naiveMax = std::max(naiveMax, std::fabs(e - naiveMean));
+				}
+
+				const ClockFit fit = estimator.GetFit();
+
+				std::printf("  synthetic: %llu blocks of %u at %.0f S/s, drift %.0f..%.1f ppm, "
+					"callback delay %.0f us + exp(%.0f us), %.0f%% late by %.0f..%.0f ms\n",
+					(unsigned long long)blocks, device.blockSamples, device.nominalRate,
+					device.startPpm, device.PpmAt(blocks), device.latencyNs / 1e3,
+					device.jitterMeanNs / 1e3, device.lateProbability * 100.0,
+					device.lateMinNs / 1e6, device.lateMaxNs / 1e6);
+				std::printf("    fit: drift %.3f ppm (true %.3f), worst drift error %.3f ppm, "
+					"%llu accepted, %llu rejected, %llu reseeds, residual RMS %.1f us\n",
+					fit.driftPpm, device.PpmAt(blocks), worstPpm,
+					(unsigned long long)fit.observations, (unsigned long long)fit.rejected,
+					(unsigned long long)fit.reseeds, fit.residualRmsNs / 1e3);
+				std::printf("    per-sample time error, fit:            offset %7.1f us, "
+					"std %6.2f us, max %7.2f us\n", fitMean / 1e3, fitStd / 1e3, fitMax / 1e3);
+				std::printf("    per-sample time error, block callback: offset %7.1f us, "
+					"std %6.2f us, max %7.2f us\n", naiveMean / 1e3, naiveStd / 1e3, naiveMax / 1e3);
+
+				BENCH_CHECK(worstPpm < 1.0, failures);
+				BENCH_CHECK(fit.reseeds == 0, failures);
+				// The late callbacks are rejected, the ordinary jitter is not.
+				BENCH_CHECK(fit.rejected >= blocks / 200 && fit.rejected < blocks / 10, failures);
+				BENCH_CHECK(fitStd < 5000.0 && fitMax < 20000.0, failures);
+				BENCH_CHECK(fitStd * 4.0 < naiveStd, failures);
+				BENCH_CHECK(mapped * checkEvery >= blocks - settle - checkEvery, failures);
+				return failures;
+			}
+
+			/**
+			* Slope of the last window of absolute observations (days into the
+			* acquisition, days of uptime) from raw sums and from the estimator.
+			*/
+			int CompareRawSums() {
+
+				int failures = 0;
+				const uInt64 blocks = 4096;
+				SyntheticDevice device = MakeDevice();
+				device.rampPpm = 0.0;
+				device.lateProbability = 0.0;
+
+				ClockDriftEstimatorCore estimator;
+				ClockDriftEstimatorConfig config = DefaultClockDriftEstimatorConfig();
+				config.nominalRate = device.nominalRate;
+				config.window = (uInt32)blocks;
+				config.outlierSigma = 1.0e6;
+				estimator.Configure(config);
+
+				std::vector<float64> x(blocks);
+				std::vector<float64> y(blocks);
+
+				for (uInt64 b = 0; b < blocks; b++) {
+					const uInt64 acquired = device.startIndex + (b + 1) * device.blockSamples;
+					const int64 hostNs = device.CallbackNs(b);
+					estimator.AddObservation(acquired, hostNs);
+					x[b] = (float64)acquired;
+					y[b] = (float64)hostNs;
+				}
+
+				const float64 truePeriod = 1.0e9 / (device.nominalRate * (1.0 + device.startPpm * 1e-6));
+				const float64 rawError = (RawSumSlope(x, y) / truePeriod - 1.0) * 1e6;
+				const float64 fitError = (estimator.GetFit().periodNs / truePeriod - 1.0) * 1e6;
+
+				std::printf("  period over %llu blocks at %.1e samples / %.1e ns: raw sums error "
+					"%.3g ppm, centred streaming fit error %.3g ppm\n",
+					(unsigned long long)blocks, (float64)device.startIndex,
+					(float64)device.startNs, rawError, fitError);
+
+				BENCH_CHECK(std::fabs(fitError) < 1.0, failures);
+				return failures;
+			}
+
+			/**
+			* A step of the host clock relative to the samples makes every
+			* following callback an outlier; the fit restarts on the new line.
+			*/
+			int CheckStep() {
+
+				int failures = 0;
+				SyntheticDevice device = MakeDevice();
+				const uInt64 blocks = 4000;
+				device.lateProbability = 0.0;
+
+				ClockDriftEstimatorCore estimator;
+				ClockDriftEstimatorConfig config = DefaultClockDriftEstimatorConfig();
+				config.nominalRate = device.nominalRate;
+				estimator.Configure(config);
+
+				const int64 step = 50000000;
+
+				for (uInt64 b = 0; b < blocks; b++) {
+					const uInt64 acquired = device.startIndex + (b + 1) * device.blockSamples;
+					estimator.AddObservation(acquired, device.CallbackNs(b) + ((b >= 2000) ? step : 0));
+				}
+
+				const ClockFit fit = estimator.GetFit();
+				const uInt64 last = device.startIndex + blocks * device.blockSamples - 1;
+				int64 time = 0;
+				estimator.SampleHostTime(last, time);
+				const float64 error = (float64)time - (device.EdgeNs((float64)(last + 1 - device.startIndex)) + step);
+
+				std::printf("  50 ms host clock step: %llu reseeds, %llu rejected, error after "
+					"%.1f us, drift %.3f ppm\n", (unsigned long long)fit.reseeds,
+					(unsigned long long)fit.rejected, error / 1e3, fit.driftPpm);
+
+				BENCH_CHECK(fit.reseeds == 1, failures);
+				BENCH_CHECK(fit.rejected >= config.maxConsecutiveOutliers, failures);
+				BENCH_CHECK(std::fabs(error) < 200000.0, failures);
+				BENCH_CHECK(std::fabs(fit.driftPpm - device.PpmAt(blocks)) < 5.0, failures);
+				return failures;
+			}
+
+			// `timed`: also hold the fit and the block times to the host
+			// clock, which only a machine with nothing else running can be
+			// asked to do.
+			int CheckEngine(uInt32 blocks) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				const uInt32 channels = 4;
+				const uInt32 blockSamples = 1000;
+				const float64 rate = 100000.0;
+
+				ClockDriftEstimatorCore estimator;
+				ClockDriftEstimatorConfig estimatorConfig = DefaultClockDriftEstimatorConfig();
+				estimatorConfig.nominalRate = rate;
+				BENCH_CHECK(estimator.Configure(estimatorConfig) == NativeSuccess, failures);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = channels;
+				config.samplesPerBlock = blockSamples;
+				config.ringBlocks = 16;
+				config.format = SampleFormat::Int16;
+				config.ownsTask = true;
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("clock", &task);
+				DAQmxCreateAIVoltageChan(task, "SimDev1/ai0:3", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, 0);
+
+				BENCH_CHECK(engine.SetClockEstimator(&estimator) == NativeErrorNotAttached, failures);
+				BENCH_CHECK(engine.Attach(task, config) == 0, failures);
+				BENCH_CHECK(engine.SetClockEstimator(&estimator) == NativeSuccess, failures);
+				BENCH_CHECK(engine.Start() == 0, failures);
+				BENCH_CHECK(engine.SetClockEstimator(nullptr) == NativeErrorAlreadyRunning, failures);
+
+				uInt32 consumed = 0;
+				uInt32 bad = 0;
+				int64 previous = 0;
+				float64 worstNs = 0.0;
+				std::vector<float64> differences;
+				differences.reserve(blocks);
+				BlockView view;
+
+				while (consumed < blocks && engine.WaitAcquireBlock(view, 2000)) {
+
+					bad += (view.hostTimestampNs <= previous);
+					bad += (view.samplesAcquired < view.firstSample + view.samplesPerChannel);
+					previous = view.hostTimestampNs;
+
+					// The last sample of the block was acquired shortly before the
+					// callback; the fit puts it there too, unless the callback
+					// itself was late.
+					int64 time = 0;
+					if (consumed >= 10 && estimator.SampleHostTime(
+						view.firstSample + view.samplesPerChannel - 1, time)) {
+						const float64 difference = std::fabs((float64)(time - view.hostTimestampNs));
+						worstNs = std::max(worstNs, difference);
+						differences.push_back(difference);
+					}
+
+					engine.ReleaseBlock();
+					consumed++;
+				}
+
+				engine.Stop();
+				engine.Detach();
+
+				const ClockFit fit = estimator.GetFit();
+
+				// Callbacks run late on a loaded host, so the bounds follow the
+				// noise the fit measured: the standard error of its slope over
+				// the span it covers, and the residual for single samples.
+				const float64 spanNs = 1e9 * (float64)fit.observations * blockSamples / rate;
+				const float64 slopeErrorPpm = (spanNs > 0.0)
+					? 1e6 * fit.residualRmsNs * std::sqrt(12.0 / (float64)fit.observations) / spanNs : 0.0;
+				const float64 driftBoundPpm = 2000.0 + 6.0 * slopeErrorPpm;
+				const float64 closeBoundNs = 1.0e6 + 4.0 * fit.residualRmsNs;
+
+				float64 medianNs = 0.0;
+				if (!differences.empty()) {
+					auto middle = differences.begin() + differences.size() / 2;
+					std::nth_element(differences.begin(), middle, differences.end());
+					medianNs = *middle;
+				}
+
+				std::printf("  engine %.0f kS/s: %u blocks, %llu observations, %llu rejected, "
+					"rate %.1f S/s (%.0f ppm vs. the simulated clock, bound %.0f), residual RMS %.1f us, "
+					"last sample vs. block time: median %.0f us (bound %.0f), worst %.0f us\n", rate / 1e3,
+					consumed, (unsigned long long)fit.observations, (unsigned long long)fit.rejected,
+					fit.rate, fit.driftPpm, driftBoundPpm, fit.residualRmsNs / 1e3,
+					medianNs / 1e3, closeBoundNs / 1e3, worstNs / 1e3);
+
+				BENCH_CHECK(consumed == blocks, failures);
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(fit.observations + fit.rejected >= blocks, failures);
+				BENCH_CHECK(std::fabs(fit.driftPpm) < driftBoundPpm, failures);
+				BENCH_CHECK(!differences.empty() && medianNs < closeBoundNs, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			void MeasureInterpolation(double seconds) {
+
+				ClockDriftEstimatorCore estimator;
+				ClockDriftEstimatorConfig config = DefaultClockDriftEstimatorConfig();
+				config.nominalRate = 100000.0;
+				estimator.Configure(config);
+
+				SyntheticDevice device = MakeDevice();
+				for (uInt64 b = 0; b < 1000; b++) {
+					estimator.AddObservation((b + 1) * device.blockSamples, device.CallbackNs(b));
+				}
+
+				const uInt32 count = 10000;
+				std::vector<int64> times(count);
+				uInt64 samples = 0;
+				uInt64 observations = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int i = 0; i < 100; i++) {
+						estimator.InterpolateHostTimes(samples, count, times.data());
+						samples += count;
+					}
+					KeepAlive(times[count - 1]);
+				} while (SecondsSince(start) < seconds);
+
+				const double interpolate = SecondsSince(start);
+
+				const auto addStart = std::chrono::steady_clock::now();
+				uInt64 acquired = 1000 * device.blockSamples;
+				do {
+					for (int i = 0; i < 1000; i++) {
+						acquired += device.blockSamples;
+						estimator.AddObservation(acquired, (int64)acquired * 10000);
+						observations++;
+					}
+				} while (SecondsSince(addStart) < seconds / 4);
+
+				const double add = SecondsSince(addStart);
+
+				int64 clock = 0;
+				const auto clockStart = std::chrono::steady_clock::now();
+				uInt64 clockReads = 0;
+				do {
+					for (int i = 0; i < 1000; i++) {
+						clock ^= HostMonotonicNs();
+					}
+					clockReads += 1000;
+				} while (SecondsSince(clockStart) < seconds / 4);
+				KeepAlive(clock);
+
+				const double clockSeconds = SecondsSince(clockStart);
+
+				std::printf("  InterpolateHostTimes %.2f ns/sample, AddObservation %.0f ns, "
+					"HostMonotonicNs %.0f ns\n", interpolate * 1e9 / (double)samples,
+					add * 1e9 / (double)observations, clockSeconds * 1e9 / (double)clockReads);
+			}
+		}
+
+		int RunClockBench(const BenchOptions& options) {
+
+			int failures = 0;
+
+			failures += CheckArguments();
+			failures += CheckAccuracy(options.quick ? 20000 : 200000);
+			failures += CompareRawSums();
+			failures += CheckStep();
+			failures += CheckEngine(options.quick ? 150 : 1000);
+			MeasureInterpolation(options.quick ? 0.1 : 1.0);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
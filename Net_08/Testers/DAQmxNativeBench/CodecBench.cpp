@@ -0,0 +1,528 @@
+// Checks the sample codec: residual and bit-packing kernels against plain
+// loops for every SIMD level, encode/decode round trips of I16 and I32
+// codes for every predictor, fill mode and thread count, block search
+// and the handling of corrupt streams; then measures the compression
+// ratio and the encode and decode rates of a noisy 16-bit signal.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/CodecFormat.h"
+#include "Native/CodecKernels.h"
+#include "Native/CpuFeatures.h"
+#include "Native/NativeStatus.h"
+#include "Native/SampleCodecCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+
+		namespace {
+
+			const SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			// Samples of a digitized sine with noise, as a quiet channel of a
+			// 16-bit board delivers them.
+			template <typename T>
+			void FillSignal(std::vector<T>& samples, uInt32 channels, uInt32 spc, int32 fillMode,
+				double amplitude, int noise, std::mt19937& random) {
+
+				std::uniform_int_distribution<int> lsb(-noise, noise);
+				samples.resize((size_t)channels * spc);
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					for (uInt32 i = 0; i < spc; i++) {
+
+						const double x = amplitude * std::sin(0.001 * (ch + 1) * i + ch);
+						const T value = (T)(std::lround(x) + lsb(random));
+						const size_t at = (fillMode == DAQmx_Val_GroupByChannel)
+							? (size_t)ch * spc + i : (size_t)i * channels + ch;
+						samples[at] = value;
+					}
+				}
+			}
+
+			template <typename T>
+			void FillRandom(std::vector<T>& samples, size_t count, std::mt19937& random) {
+				samples.resize(count);
+				for (T& s : samples) {
+					s = (T)random();
+				}
+			}
+
+			// Packs with the layout of CodecFormat.h, one bit at a time.
+			void ReferencePack(const uInt32* values, uInt32 width, uInt32* packed) {
+
+				std::memset(packed, 0, width * 8 * sizeof(uInt32));
+
+				for (uInt32 j = 0; j < CodecMiniBlockValues; j++) {
+					const uInt32 lane = j % 8;
+					for (uInt32 b = 0; b < width; b++) {
+						const uInt32 bit = (j / 8) * width + b;
+						if ((values[j] >> b) & 1) {
+							packed[(bit / 32) * 8 + lane] |= 1u << (bit % 32);
+						}
+					}
+				}
+			}
+
+			template <typename T>
+			int CheckResiduals(const std::vector<T>& x, uInt32 order) {
+
+				int failures = 0;
+				const size_t n = x.size();
+				std::vector<uInt32> r(n + 1, 0xDEADBEEF);
+				std::vector<T> back(n + 1, 0);
+
+				ComputeResiduals(x.data(), n, sizeof(T), order, r.data());
+				BENCH_CHECK(r[n] == 0xDEADBEEF, failures);
+
+				for (size_t i = 0; i < n; i++) {
+
+					const uInt32 a = (uInt32)(int32)x[i];
+					const uInt32 b = (uInt32)(int32)x[(i >= 1) ? i - 1 : 0];
+					const uInt32 c = (uInt32)(int32)x[(i >= 2) ? i - 2 : 0];
+					const uInt32 d = (order == 0) ? a : (order == 1) ? a - b : a - 2u * b + c;
+					const uInt32 z = (d << 1) ^ (uInt32)((int32)d >> 31);
+
+					if (r[i] != z) {
+						failures++;
+						break;
+					}
+				}
+
+				if (n > 0) {
+					// Restore in uneven pieces, carrying the history.
+					int32 history[2] = { (int32)x[0], (int32)x[0] };
+					for (size_t done = 0; done < n;) {
+						const size_t piece = std::min<size_t>(n - done, 1 + done % 37);
+						RestoreSamples(r.data() + done, piece, order, history, sizeof(T),
+							back.data() + done, 1);
+						done += piece;
+					}
+					BENCH_CHECK(std::equal(x.begin(), x.end(), back.begin()), failures);
+				}
+				return failures;
+			}
+
+			int CheckKernels(std::mt19937& random) {
+
+				int failures = 0;
+				const size_t counts[] = { 0, 1, 2, 3, 5, 9, 10, 17, 255, 256, 1000, 4099 };
+
+				for (size_t count : counts) {
+					for (uInt32 order = 0; order < 3; order++) {
+
+						std::vector<int16> x16;
+						std::vector<int32> x32;
+
+						FillRandom(x16, count, random);
+						FillRandom(x32, count, random);
+						failures += CheckResiduals(x16, order);
+						failures += CheckResiduals(x32, order);
+
+						// Extremes make every difference wrap.
+						for (size_t i = 0; i < count; i++) {
+							x16[i] = (i % 2) ? (int16)-32768 : (int16)32767;
+							x32[i] = (i % 3) ? INT32_MIN : INT32_MAX;
+						}
+						failures += CheckResiduals(x16, order);
+						failures += CheckResiduals(x32, order);
+					}
+				}
+
+				alignas(64) uInt32 values[CodecMiniBlockValues];
+				alignas(64) uInt32 back[CodecMiniBlockValues];
+				alignas(64) uInt32 packed[CodecMiniBlockValues + 8];
+				alignas(64) uInt32 expected[CodecMiniBlockValues + 8];
+
+				for (uInt32 width = 0; width <= 32; width++) {
+
+					const uInt32 mask = (width == 32) ? 0xFFFFFFFFu : (1u << width) - 1;
+
+					for (uInt32& v : values) {
+						v = (uInt32)random() & mask;
+					}
+					if (width > 0) {
+						values[CodecMiniBlockValues - 1] = mask;
+					}
+
+					ReferencePack(values, width, expected);
+					packed[width * 8] = 0xDEADBEEF;
+					PackMiniBlock(values, width, packed);
+
+					BENCH_CHECK(std::memcmp(packed, expected, width * 8 * sizeof(uInt32)) == 0, failures);
+					BENCH_CHECK(packed[width * 8] == 0xDEADBEEF, failures);
+					BENCH_CHECK(BitWidth(values, CodecMiniBlockValues) == width, failures);
+
+					UnpackMiniBlock(packed, width, back);
+					BENCH_CHECK(std::memcmp(values, back, sizeof(values)) == 0, failures);
+				}
+				return failures;
+			}
+
+			// Walks an encoded stream and compares every block with the
+			// input, decoded both ways and channel by channel.
+			template <typename T>
+			int CheckStream(const std::vector<uInt8>& stream, const std::vector<T>& input,
+				uInt32 channels, uInt32 spc, uInt32 blockSpc, int32 fillMode, uInt64 firstSample) {
+
+				int failures = 0;
+				size_t at = 0;
+				uInt64 next = firstSample;
+				std::vector<T> block((size_t)channels * blockSpc);
+				std::vector<T> one(blockSpc);
+
+				while (at < stream.size()) {
+
+					CodecBlockHeader header;
+					if (ReadCodecBlockHeader(stream.data() + at, stream.size() - at, &header) != NativeSuccess) {
+						failures++;
+						break;
+					}
+
+					const uInt32 n = header.samplesPerChannel;
+					const size_t base = (size_t)(header.firstSample - firstSample);
+					BENCH_CHECK(header.firstSample == next, failures);
+					BENCH_CHECK(header.channels == channels && header.sampleBytes == sizeof(T), failures);
+					BENCH_CHECK(n == std::min(blockSpc, spc - (uInt32)base), failures);
+
+					for (int32 outMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+
+						BENCH_CHECK(DecodeCodecBlock(stream.data() + at, header.blockBytes, outMode,
+							block.data(), block.size()) == NativeSuccess, failures);
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							for (uInt32 i = 0; i < n; i++) {
+								const T got = (outMode == DAQmx_Val_GroupByChannel)
+									? block[(size_t)ch * n + i] : block[(size_t)i * channels + ch];
+								const T want = (fillMode == DAQmx_Val_GroupByChannel)
+									? input[(size_t)ch * spc + base + i]
+									: input[(base + i) * channels + ch];
+								if (got != want) {
+									failures++;
+									return failures;
+								}
+							}
+						}
+					}
+
+					const uInt32 ch = (uInt32)(base / blockSpc) % channels;
+					BENCH_CHECK(DecodeCodecChannel(stream.data() + at, header.blockBytes, ch,
+						one.data(), one.size()) == NativeSuccess, failures);
+					for (uInt32 i = 0; i < n; i++) {
+						const T want = (fillMode == DAQmx_Val_GroupByChannel)
+							? input[(size_t)ch * spc + base + i] : input[(base + i) * channels + ch];
+						if (one[i] != want) {
+							failures++;
+							break;
+						}
+					}
+
+					size_t found = ~(size_t)0;
+					BENCH_CHECK(FindCodecBlock(stream.data(), stream.size(),
+						header.firstSample + n - 1, &found) == NativeSuccess && found == at, failures);
+
+					next += n;
+					at += header.blockBytes;
+				}
+
+				BENCH_CHECK(next == firstSample + spc, failures);
+				return failures;
+			}
+
+			template <typename T>
+			int CheckRoundTrip(uInt32 channels, uInt32 spc, uInt32 blockSpc, CodecPredictor predictor,
+				int32 fillMode, bool noisy, std::mt19937& random) {
+
+				int failures = 0;
+				std::vector<T> input;
+
+				if (noisy) {
+					FillRandom(input, (size_t)channels * spc, random);
+				}
+				else {
+					FillSignal(input, channels, spc, fillMode, 3000.0, 4, random);
+				}
+
+				std::vector<uInt8> reference;
+
+				for (uInt32 threads : { 1u, 4u }) {
+
+					SampleCodecConfig config = DefaultSampleCodecConfig();
+					config.channels = channels;
+					config.format = (sizeof(T) == 2) ? SampleFormat::Int16 : SampleFormat::Int32;
+					config.blockSamplesPerChannel = blockSpc;
+					config.maxSamplesPerChannel = spc;
+					config.predictor = predictor;
+					config.threads = threads;
+
+					SampleCodecCore codec;
+					BENCH_CHECK(codec.Configure(config) == NativeSuccess, failures);
+
+					// Two calls: the second continues the sample index.
+					std::vector<uInt8> stream(2 * codec.MaxEncodedBytes(spc));
+					size_t first = 0;
+					size_t second = 0;
+
+					BENCH_CHECK(codec.Encode(input.data(), spc, fillMode, stream.data(),
+						stream.size(), &first) == NativeSuccess, failures);
+					BENCH_CHECK(codec.Encode(input.data(), spc, fillMode, stream.data() + first,
+						stream.size() - first, &second) == NativeSuccess, failures);
+
+					BENCH_CHECK(second == first, failures);
+					BENCH_CHECK(codec.Counters().samplesEncoded == 2ull * spc, failures);
+					BENCH_CHECK(codec.Counters().bytesOut == first + second, failures);
+
+					std::vector<uInt8> head(stream.begin(), stream.begin() + first);
+					std::vector<uInt8> tail(stream.begin() + first, stream.begin() + first + second);
+
+					failures += CheckStream(head, input, channels, spc, blockSpc, fillMode, 0);
+					failures += CheckStream(tail, input, channels, spc, blockSpc, fillMode, spc);
+
+					// The output does not depend on the thread count.
+					if (reference.empty()) {
+						reference = head;
+					}
+					else {
+						BENCH_CHECK(head == reference, failures);
+					}
+				}
+				return failures;
+			}
+
+			int CheckErrors(std::mt19937& random) {
+
+				int failures = 0;
+				const uInt32 channels = 2;
+				const uInt32 spc = 3000;
+
+				SampleCodecConfig config = DefaultSampleCodecConfig();
+				SampleCodecCore codec;
+				std::vector<int16> input;
+				FillSignal(input, channels, spc, DAQmx_Val_GroupByScanNumber, 1000.0, 2, random);
+
+				size_t written = 1;
+				BENCH_CHECK(codec.Encode(input.data(), spc, DAQmx_Val_GroupByScanNumber,
+					input.data(), 1, &written) == NativeErrorInvalidState && written == 0, failures);
+
+				config.format = SampleFormat::Float64;
+				BENCH_CHECK(codec.Configure(config) == NativeErrorUnsupportedFormat, failures);
+				config.format = SampleFormat::Int16;
+				config.channels = 0;
+				BENCH_CHECK(codec.Configure(config) == NativeErrorInvalidArgument, failures);
+				config.channels = channels;
+				config.predictor = (CodecPredictor)7;
+				BENCH_CHECK(codec.Configure(config) == NativeErrorInvalidArgument, failures);
+				config.predictor = CodecPredictor::Auto;
+				config.blockSamplesPerChannel = 1024;
+				config.maxSamplesPerChannel = spc;
+				BENCH_CHECK(codec.Configure(config) == NativeSuccess, failures);
+
+				std::vector<uInt8> stream(codec.MaxEncodedBytes(spc));
+				BENCH_CHECK(codec.Encode(input.data(), spc + 1, DAQmx_Val_GroupByScanNumber,
+					stream.data(), stream.size(), &written) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(codec.Encode(input.data(), spc, 7,
+					stream.data(), stream.size(), &written) == NativeErrorInvalidArgument, failures);
+
+				// Too small: nothing is consumed, the retry starts at 0.
+				BENCH_CHECK(codec.Encode(input.data(), spc, DAQmx_Val_GroupByScanNumber,
+					stream.data(), 100, &written) == NativeErrorBufferTooSmall && written == 0, failures);
+				BENCH_CHECK(codec.Encode(input.data(), spc, DAQmx_Val_GroupByScanNumber,
+					stream.data(), stream.size(), &written) == NativeSuccess, failures);
+				stream.resize(written);
+				failures += CheckStream(stream, input, channels, spc, 1024, DAQmx_Val_GroupByScanNumber, 0);
+
+				size_t offset = 0;
+				std::vector<int16> out((size_t)channels * 1024);
+				BENCH_CHECK(FindCodecBlock(stream.data(), stream.size(), spc, &offset)
+					== NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(DecodeCodecBlock(stream.data(), stream.size(), DAQmx_Val_GroupByChannel,
+					out.data(), out.size() - 1) == NativeErrorBufferTooSmall, failures);
+				BENCH_CHECK(DecodeCodecBlock(stream.data(), 100, DAQmx_Val_GroupByChannel,
+					out.data(), out.size()) == NativeErrorBufferTooSmall, failures);
+				BENCH_CHECK(DecodeCodecChannel(stream.data(), stream.size(), channels,
+					out.data(), out.size()) == NativeErrorInvalidArgument, failures);
+
+				// A cut-off last block ends the search early.
+				BENCH_CHECK(FindCodecBlock(stream.data(), stream.size() - 1, 2500, &offset)
+					== NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(FindCodecBlock(stream.data(), stream.size() - 1, 1500, &offset)
+					== NativeSuccess, failures);
+
+				CodecBlockHeader header;
+				ReadCodecBlockHeader(stream.data(), stream.size(), &header);
+				CodecChannelEntry entry;
+				std::memcpy(&entry, stream.data() + sizeof(header), sizeof(entry));
+
+				std::vector<uInt8> bad = stream;
+				bad[0] ^= 1;
+				BENCH_CHECK(DecodeCodecBlock(bad.data(), bad.size(), DAQmx_Val_GroupByChannel,
+					out.data(), out.size()) == NativeErrorInvalidFile, failures);
+				BENCH_CHECK(FindCodecBlock(bad.data(), bad.size(), 0, &offset)
+					== NativeErrorInvalidFile, failures);
+
+				bad = stream;
+				bad[entry.offset] = 33;
+				BENCH_CHECK(DecodeCodecBlock(bad.data(), bad.size(), DAQmx_Val_GroupByChannel,
+					out.data(), out.size()) == NativeErrorInvalidFile, failures);
+
+				bad = stream;
+				bad[entry.offset] = (uInt8)(bad[entry.offset] + 1);
+				BENCH_CHECK(DecodeCodecChannel(bad.data(), bad.size(), 0,
+					out.data(), out.size()) == NativeErrorInvalidFile, failures);
+
+				bad = stream;
+				bad[sizeof(header) + offsetof(CodecChannelEntry, predictor)] = 3;
+				BENCH_CHECK(DecodeCodecChannel(bad.data(), bad.size(), 0,
+					out.data(), out.size()) == NativeErrorInvalidFile, failures);
+
+				return failures;
+			}
+
+			struct Rates {
+				double encode;
+				double decode;
+				double ratio;
+			};
+
+			Rates Measure(const std::vector<int16>& input, uInt32 channels, uInt32 spc,
+				CodecPredictor predictor, uInt32 threads, double seconds) {
+
+				SampleCodecConfig config = DefaultSampleCodecConfig();
+				config.channels = channels;
+				config.maxSamplesPerChannel = spc;
+				config.predictor = predictor;
+				config.threads = threads;
+
+				SampleCodecCore codec;
+				codec.Configure(config);
+
+				std::vector<uInt8> stream(codec.MaxEncodedBytes(spc));
+				size_t written = 0;
+				uInt64 bytes = 0;
+				auto start = std::chrono::steady_clock::now();
+
+				do {
+					codec.Encode(input.data(), spc, DAQmx_Val_GroupByScanNumber,
+						stream.data(), stream.size(), &written);
+					bytes += input.size() * sizeof(int16);
+				} while (SecondsSince(start) < seconds);
+
+				Rates rates;
+				rates.encode = bytes / SecondsSince(start);
+				rates.ratio = (double)(input.size() * sizeof(int16)) / written;
+
+				std::vector<int16> out((size_t)channels * config.blockSamplesPerChannel);
+				bytes = 0;
+				start = std::chrono::steady_clock::now();
+
+				do {
+					for (size_t at = 0; at < written;) {
+						CodecBlockHeader header;
+						ReadCodecBlockHeader(stream.data() + at, written - at, &header);
+						DecodeCodecBlock(stream.data() + at, header.blockBytes,
+							DAQmx_Val_GroupByScanNumber, out.data(), out.size());
+						at += header.blockBytes;
+					}
+					bytes += input.size() * sizeof(int16);
+				} while (SecondsSince(start) < seconds);
+				KeepAlive(out[0]);
+
+				rates.decode = bytes / SecondsSince(start);
+				return rates;
+			}
+		}
+
+		int RunCodecBench(const BenchOptions& options) {
+
+			int failures = 0;
+			std::mt19937 random(13);
+			const SimdLevel detected = DetectedSimdLevel();
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			for (SimdLevel level : Levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				int f = CheckKernels(random);
+
+				for (int32 fillMode : { DAQmx_Val_GroupByScanNumber, DAQmx_Val_GroupByChannel }) {
+					for (CodecPredictor predictor : { CodecPredictor::None, CodecPredictor::Delta,
+						CodecPredictor::Linear, CodecPredictor::Auto }) {
+
+						f += CheckRoundTrip<int16>(1, 5000, 1024, predictor, fillMode, false, random);
+						f += CheckRoundTrip<int16>(3, 4097, 4096, predictor, fillMode, false, random);
+						f += CheckRoundTrip<int32>(4, 3000, 700, predictor, fillMode, false, random);
+						f += CheckRoundTrip<int16>(2, 999, 256, predictor, fillMode, true, random);
+						f += CheckRoundTrip<int32>(5, 1500, 512, predictor, fillMode, true, random);
+						f += CheckRoundTrip<int16>(8, 1, 4096, predictor, fillMode, false, random);
+					}
+				}
+
+				std::printf("  correctness %-7s: %d failed checks\n", SimdLevelName(level), f);
+				failures += f;
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			failures += CheckErrors(random);
+
+			const uInt32 channels = 8;
+			const uInt32 spc = 65536;
+			const double seconds = options.quick ? 0.05 : 0.5;
+			std::vector<int16> input;
+			FillSignal(input, channels, spc, DAQmx_Val_GroupByScanNumber, 8000.0, 8, random);
+
+			std::vector<int16> copy(input.size());
+			uInt64 copied = 0;
+			const auto start = std::chrono::steady_clock::now();
+			do {
+				std::memcpy(copy.data(), input.data(), input.size() * sizeof(int16));
+				copied += input.size() * sizeof(int16);
+			} while (SecondsSince(start) < seconds);
+			KeepAlive(copy[copy.size() / 2]);
+
+			std::printf("  %u x %u I16 sine + noise, MB/s of raw samples (memcpy %.0f):\n",
+				channels, spc, copied / SecondsSince(start) / 1e6);
+
+			for (SimdLevel level : Levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				const Rates delta = Measure(input, channels, spc, CodecPredictor::Delta, 1, seconds);
+				const Rates automatic = Measure(input, channels, spc, CodecPredictor::Auto, 1, seconds);
+
+				std::printf("    %-7s delta: encode %6.0f decode %6.0f ratio %.2f   "
+					"auto: encode %6.0f decode %6.0f ratio %.2f\n", SimdLevelName(level),
+					delta.encode / 1e6, delta.decode / 1e6, delta.ratio,
+					automatic.encode / 1e6, automatic.decode / 1e6, automatic.ratio);
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			const uInt32 cores = std::max(1u, std::thread::hardware_concurrency());
+			for (uInt32 threads : { 2u, 4u, cores }) {
+				if (threads > cores) {
+					continue;
+				}
+				const Rates rates = Measure(input, channels, spc, CodecPredictor::Auto, threads, seconds);
+				std::printf("    %2u threads, auto: encode %6.0f\n", threads, rates.encode / 1e6);
+			}
+
+			return failures;
+		}
+	}
+}
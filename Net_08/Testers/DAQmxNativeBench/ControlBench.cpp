@@ -0,0 +1,382 @@
+// Checks the hardware-timed single-point control loop (ControlLoopCore):
+// the outputs of every iteration against the law applied to the inputs of
+// its tick, a law that stops the loop, late iterations and the stop after
+// too many of them, and the loop-time statistics of a loop at 5-10 kHz.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/ControlLoopCore.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			TaskHandle CreateTask(bool output, uInt32 channels, float64 rate) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask(output ? "control out" : "control in", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), output ? "SimDev1/ao0:%u"
+					: "SimDev1/ai0:%u", channels - 1);
+
+				if (output) {
+					DAQmxCreateAOVoltageChan(task, physical, "", -10.0, 10.0,
+						DAQmx_Val_Volts, NULL);
+				}
+				else {
+					DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+						-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				}
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+					DAQmx_Val_HWTimedSinglePoint, 1);
+				return task;
+			}
+
+			ControlLoopConfig MakeConfig(uInt32 inputs, uInt32 outputs, float64 rate) {
+
+				ControlLoopConfig config = DefaultControlLoopConfig();
+				config.inputChannels = inputs;
+				config.outputChannels = outputs;
+				config.sampleRate = rate;
+				config.ownsTasks = true;
+				return config;
+			}
+
+			bool WaitStopped(const ControlLoopCore& loop, double seconds) {
+
+				const auto start = std::chrono::steady_clock::now();
+
+				while (loop.IsRunning() && SecondsSince(start) < seconds) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				return !loop.IsRunning();
+			}
+
+			uInt64 HistogramTotal(const ControlLoopCore& loop) {
+
+				std::vector<uInt64> bins(loop.Config().histogramBins);
+				const size_t n = loop.ReadHistogram(bins.data(), bins.size());
+				uInt64 total = 0;
+
+				for (size_t k = 0; k < n; k++) {
+					total += bins[k];
+				}
+				return total;
+			}
+
+			// out0 = 2 * in0 + in1; out1 counts up from its previous value.
+			// Returns `NativeErrorCancelled` at call `stopAt`.
+			struct CountingLaw {
+				uInt64 calls;
+				uInt64 stopAt;
+			};
+
+			int32 CountingLawFunction(void* context, const float64* inputs, uInt32 /*inputCount*/,
+				float64* outputs, uInt32 /*outputCount*/, float64 /*dt*/) {
+
+				CountingLaw* law = static_cast<CountingLaw*>(context);
+
+				if (++law->calls == law->stopAt) {
+					return NativeErrorCancelled;
+				}
+
+				outputs[0] = 2.0 * inputs[0] + inputs[1];
+				outputs[1] += 1.0;
+				return 0;
+			}
+
+			// Proportional gain on channel 0; sleeps `sleepUs` every `every`
+			// calls to make the loop miss sample clocks.
+			struct SleepyLaw {
+				uInt64 calls;
+				uInt32 every;
+				uInt32 sleepUs;
+			};
+
+			int32 SleepyLawFunction(void* context, const float64* inputs, uInt32 /*inputCount*/,
+				float64* outputs, uInt32 outputCount, float64 /*dt*/) {
+
+				SleepyLaw* law = static_cast<SleepyLaw*>(context);
+
+				if (law->every != 0 && ++law->calls % law->every == 0) {
+					std::this_thread::sleep_for(std::chrono::microseconds(law->sleepUs));
+				}
+
+				if (outputCount > 0) {
+					outputs[0] = -0.5 * inputs[0];
+				}
+				return 0;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				ControlLoopCore loop;
+				const ControlLoopConfig config = MakeConfig(2, 2, 1000.0);
+
+				BENCH_CHECK(loop.Start() == NativeErrorNotAttached, failures);
+				BENCH_CHECK(loop.Stop() == NativeErrorNotAttached, failures);
+				BENCH_CHECK(loop.Attach(NULL, NULL, config) == NativeErrorInvalidArgument, failures);
+
+				TaskHandle input = CreateTask(false, 2, 1000.0);
+				TaskHandle output = CreateTask(true, 2, 1000.0);
+
+				// An output task and no output channels, and the reverse.
+				BENCH_CHECK(loop.Attach(input, NULL, config) == NativeErrorInvalidArgument, failures);
+				ControlLoopConfig noOutputs = config;
+				noOutputs.outputChannels = 0;
+				BENCH_CHECK(loop.Attach(input, output, noOutputs) == NativeErrorInvalidArgument, failures);
+
+				ControlLoopConfig bad = config;
+				bad.sampleRate = 0.0;
+				BENCH_CHECK(loop.Attach(input, output, bad) == NativeErrorInvalidArgument, failures);
+				bad = config;
+				bad.histogramBins = 0;
+				BENCH_CHECK(loop.Attach(input, output, bad) == NativeErrorInvalidArgument, failures);
+
+				BENCH_CHECK(loop.Attach(input, output, config) == NativeSuccess, failures);
+				BENCH_CHECK(loop.Attach(input, output, config) == NativeErrorInvalidState, failures);
+
+				const float64 initial[3] = { 1.0, 2.0, 3.0 };
+				BENCH_CHECK(loop.SetInitialOutputs(initial, 3) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(loop.SetInitialOutputs(initial, 2) == NativeSuccess, failures);
+
+				// The wait is specific to single-point timing.
+				TaskHandle continuous = NULL;
+				DAQmxCreateTask("continuous", &continuous);
+				DAQmxCreateAIVoltageChan(continuous, "SimDev1/ai0", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(continuous, "", 1000.0, DAQmx_Val_Rising,
+					DAQmx_Val_ContSamps, 0);
+				bool32 isLate = FALSE;
+				BENCH_CHECK(DAQmxWaitForNextSampleClock(continuous, 1.0, &isLate) < 0, failures);
+				DAQmxClearTask(continuous);
+
+				SimSetClockMode(SimClockMode::RealTime);
+				SleepyLaw law = { 0, 0, 0 };
+				BENCH_CHECK(loop.SetControlLaw(SleepyLawFunction, &law) == NativeSuccess, failures);
+				BENCH_CHECK(loop.Start() == NativeSuccess, failures);
+				BENCH_CHECK(loop.IsRunning(), failures);
+				BENCH_CHECK(loop.Start() == NativeErrorAlreadyRunning, failures);
+				BENCH_CHECK(loop.SetControlLaw(nullptr, nullptr) == NativeErrorAlreadyRunning, failures);
+				BENCH_CHECK(loop.SetInitialOutputs(initial, 2) == NativeErrorAlreadyRunning, failures);
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				BENCH_CHECK(loop.Stop() == NativeSuccess, failures);
+				BENCH_CHECK(!loop.IsRunning(), failures);
+				BENCH_CHECK(loop.Counters().iterations > 0, failures);
+				BENCH_CHECK(loop.Counters().lastError == 0, failures);
+
+				BENCH_CHECK(loop.Detach() == NativeSuccess, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			// In free run every wait is one tick, so the outputs of iteration
+			// k follow from the inputs of sample k. The law stops the loop.
+			int CheckIntegrity(uInt64 iterations) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				TaskHandle input = CreateTask(false, 2, 10000.0);
+				TaskHandle output = CreateTask(true, 2, 10000.0);
+
+				ControlLoopConfig config = MakeConfig(2, 2, 10000.0);
+				config.warmupIterations = 10;
+
+				ControlLoopCore loop;
+				CountingLaw law = { 0, iterations + 1 };
+				const float64 initial[2] = { 0.0, 10.0 };
+
+				BENCH_CHECK(loop.Attach(input, output, config) == NativeSuccess, failures);
+				BENCH_CHECK(loop.SetInitialOutputs(initial, 2) == NativeSuccess, failures);
+				BENCH_CHECK(loop.SetControlLaw(CountingLawFunction, &law) == NativeSuccess, failures);
+
+				const auto start = std::chrono::steady_clock::now();
+				BENCH_CHECK(loop.Start() == NativeSuccess, failures);
+				BENCH_CHECK(WaitStopped(loop, 30.0), failures);
+				const double seconds = SecondsSince(start);
+
+				const ControlLoopCounters counters = loop.Counters();
+				BENCH_CHECK(counters.lastError == NativeErrorCancelled, failures);
+				BENCH_CHECK(counters.iterations == iterations, failures);
+				BENCH_CHECK(counters.lateIterations == 0, failures);
+				BENCH_CHECK(HistogramTotal(loop) == iterations - config.warmupIterations, failures);
+
+				// The error stopped the tasks along with the loop.
+				bool32 inputDone = FALSE;
+				bool32 outputDone = FALSE;
+				DAQmxIsTaskDone(input, &inputDone);
+				DAQmxIsTaskDone(output, &outputDone);
+				BENCH_CHECK(inputDone && outputDone, failures);
+
+				BENCH_CHECK(loop.Stop() == NativeSuccess, failures);
+
+				const std::vector<float64> generated = SimGeneratedAnalog(output);
+				BENCH_CHECK(generated.size() == iterations * 2, failures);
+
+				uInt64 mismatches = 0;
+
+				for (uInt64 k = 0; k < generated.size() / 2; k++) {
+
+					const float64 out0 = 2.0 * SimScaledSample(0, k) + SimScaledSample(1, k);
+					const float64 out1 = 10.0 + (float64)(k + 1);
+
+					if (generated[2 * k] != out0 || generated[2 * k + 1] != out1) {
+						mismatches++;
+					}
+				}
+				BENCH_CHECK(mismatches == 0, failures);
+
+				std::printf("  free run  %8llu iterations  %7.2f us/iteration  mean loop %llu ns\n",
+					(unsigned long long)counters.iterations, 1e6 * seconds / (double)iterations,
+					(unsigned long long)counters.meanLoopNs);
+
+				BENCH_CHECK(loop.Detach() == NativeSuccess, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			// A loop paced by the sample clock, with a law that misses clocks
+			// now and then. `timed`: also expect the host to keep up with
+			// the clock, which a loaded machine does not.
+			int CheckRealTime(float64 rate, double seconds, uInt32 sleepEvery, bool timed) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				TaskHandle input = CreateTask(false, 1, rate);
+				TaskHandle output = CreateTask(true, 1, rate);
+
+				ControlLoopConfig config = MakeConfig(1, 1, rate);
+				config.histogramBinNs = 500;
+
+				ControlLoopCore loop;
+				const uInt32 sleepUs = (uInt32)(3e6 / rate);
+				SleepyLaw law = { 0, sleepEvery, sleepUs };
+
+				BENCH_CHECK(loop.Attach(input, output, config) == NativeSuccess, failures);
+				BENCH_CHECK(loop.SetControlLaw(SleepyLawFunction, &law) == NativeSuccess, failures);
+				BENCH_CHECK(loop.Start() == NativeSuccess, failures);
+
+				std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+				BENCH_CHECK(loop.IsRunning(), failures);
+				BENCH_CHECK(loop.Stop() == NativeSuccess, failures);
+
+				const ControlLoopCounters counters = loop.Counters();
+				const uInt64 expected = (uInt64)(rate * seconds);
+				const uInt64 sleeps = law.calls / std::max<uInt32>(sleepEvery, 1);
+
+				// A wait that missed clocks skips them, so a host busy with
+				// other work (parallel tests) costs iterations; the loop must
+				// still keep a fraction of the rate.
+				const uInt64 least = timed ? expected / 2 : expected / 20;
+
+				BENCH_CHECK(counters.lastError == 0, failures);
+				BENCH_CHECK(counters.iterations <= expected + 1, failures);
+				BENCH_CHECK(counters.iterations >= least, failures);
+				BENCH_CHECK(HistogramTotal(loop) == counters.iterations - config.warmupIterations, failures);
+				BENCH_CHECK(counters.maxLoopNs >= counters.meanLoopNs, failures);
+
+				// Every sleep spans three clocks, so the next wait is late and
+				// the iteration overran, unless it fell in the warm-up. A slow
+				// host adds late iterations of its own, and overruns with them.
+				if (sleepEvery != 0) {
+					BENCH_CHECK(counters.lateIterations + 2 >= sleeps, failures);
+					BENCH_CHECK(counters.overruns + config.warmupIterations / sleepEvery + 1 >= sleeps,
+						failures);
+					BENCH_CHECK(counters.maxPeriodNs >= (uInt64)(2.5e9 / rate), failures);
+				}
+
+				const uInt64 p50 = loop.LoopTimePercentile(0.5);
+				const uInt64 p99 = loop.LoopTimePercentile(0.99);
+				const uInt64 p100 = loop.LoopTimePercentile(1.0);
+				BENCH_CHECK(p50 <= p99 && p99 <= p100, failures);
+				BENCH_CHECK(p100 + config.histogramBinNs > std::min<uInt64>(counters.maxLoopNs,
+					(uInt64)config.histogramBins * config.histogramBinNs), failures);
+
+				std::printf("  %6.0f Hz  %8llu iterations  late %llu  overruns %llu"
+					"  loop p50 %llu ns  p99 %llu ns  max %llu ns  max period %llu ns\n",
+					rate, (unsigned long long)counters.iterations,
+					(unsigned long long)counters.lateIterations,
+					(unsigned long long)counters.overruns,
+					(unsigned long long)p50, (unsigned long long)p99,
+					(unsigned long long)counters.maxLoopNs,
+					(unsigned long long)counters.maxPeriodNs);
+
+				BENCH_CHECK(loop.Detach() == NativeSuccess, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			// A law slower than the clock makes every iteration late; the
+			// loop gives up after `maxConsecutiveLate` of them.
+			int CheckLateStop() {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				TaskHandle input = CreateTask(false, 1, 5000.0);
+
+				ControlLoopConfig config = MakeConfig(1, 0, 5000.0);
+				config.warmupIterations = 0;
+				config.maxConsecutiveLate = 5;
+
+				ControlLoopCore loop;
+				SleepyLaw law = { 0, 1, 1000 };
+
+				BENCH_CHECK(loop.Attach(input, NULL, config) == NativeSuccess, failures);
+				BENCH_CHECK(loop.SetControlLaw(SleepyLawFunction, &law) == NativeSuccess, failures);
+				BENCH_CHECK(loop.Start() == NativeSuccess, failures);
+				BENCH_CHECK(WaitStopped(loop, 5.0), failures);
+
+				const ControlLoopCounters counters = loop.Counters();
+				BENCH_CHECK(counters.lastError == DAQmxErrorWaitForNextSampClkDetectedMissedSampClk, failures);
+				BENCH_CHECK(counters.lateIterations >= 5, failures);
+				BENCH_CHECK(counters.iterations <= 6, failures);
+
+				bool32 done = FALSE;
+				DAQmxIsTaskDone(input, &done);
+				BENCH_CHECK(done, failures);
+
+				// The loop can be started again, without a `Stop` first.
+				law.every = 0;
+				BENCH_CHECK(loop.SetControlLaw(SleepyLawFunction, &law) == NativeSuccess, failures);
+				BENCH_CHECK(loop.Start() == NativeSuccess, failures);
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				BENCH_CHECK(loop.IsRunning(), failures);
+				BENCH_CHECK(loop.Counters().lastError == 0, failures);
+
+				BENCH_CHECK(loop.Detach() == NativeSuccess, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+		}
+
+		int RunControlBench(const BenchOptions& options) {
+
+			int failures = 0;
+
+			failures += CheckArguments();
+			failures += CheckIntegrity(options.quick ? 20000 : 200000);
+			failures += CheckLateStop();
+
+			failures += CheckRealTime(5000.0, options.quick ? 0.5 : 3.0, 0, !options.quick);
+			failures += CheckRealTime(10000.0, options.quick ? 0.5 : 3.0, 0, !options.quick);
+			failures += CheckRealTime(10000.0, options.quick ? 0.5 : 3.0, 500, !options.quick);
+			return failures;
+		}
+	}
+}
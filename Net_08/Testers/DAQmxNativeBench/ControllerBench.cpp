@@ -0,0 +1,513 @@
+// Checks the controller library (ControlLaws.h through ControllerCore):
+// the PID, lead-lag and state-space steps against scalar references,
+// anti-windup and the derivative filter, parameters swapped while a
+// control loop runs them, and analog plus digital outputs of one loop.
+// Measures the cost of a step per channel count.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/ControlLoopCore.h"
+#include "Native/ControllerCore.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const float64 Dt = 1e-4;
+
+			bool Near(float64 a, float64 b) {
+				return std::fabs(a - b) <= 1e-9 * (1.0 + std::fabs(b));
+			}
+
+			// One channel of the PID, written out plainly.
+			struct ReferencePid {
+
+				PidChannelSettings s;
+				float64 integral = 0.0;
+				float64 derivative = 0.0;
+				float64 previous = 0.0;
+				bool primed = false;
+
+				float64 Step(float64 y, float64 dt) {
+
+					if (!primed) {
+						previous = y;
+						primed = true;
+					}
+
+					const float64 e = s.setpoint - y;
+					derivative = (s.derivativeTime * derivative - s.kd * (y - previous))
+						/ (s.derivativeTime + dt);
+					const float64 v = s.kp * e + integral + derivative;
+					const float64 u = std::fmin(std::fmax(v, s.outputMin), s.outputMax);
+
+					integral += s.ki * e * dt + s.trackingGain * (u - v) * dt;
+					previous = y;
+					return u;
+				}
+			};
+
+			PidChannelSettings RandomPid(std::mt19937& random) {
+
+				std::uniform_real_distribution<float64> gain(0.0, 2.0);
+
+				PidChannelSettings s = DefaultPidChannelSettings();
+				s.kp = gain(random);
+				s.ki = 100.0 * gain(random);
+				s.kd = 1e-3 * gain(random);
+				s.derivativeTime = 1e-3 * gain(random);
+				s.trackingGain = 50.0 * gain(random);
+				s.outputMin = -2.0;
+				s.outputMax = 2.0;
+				s.setpoint = gain(random) - 1.0;
+				return s;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				ControllerCore controller;
+				float64 in[2] = { 0.0, 0.0 };
+				float64 out[2] = { 0.0, 0.0 };
+
+				BENCH_CHECK(controller.Step(in, 2, out, 2, Dt) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(controller.SetSetpoint(0, 1.0) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(controller.ConfigurePid(0) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(controller.ConfigurePid(ControllerMaxChannels + 1) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(controller.ConfigureStateSpace(ControllerMaxStates + 1, 1, 1) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(controller.ConfigureStateSpace(2, ControllerMaxStateSpaceChannels + 1, 1) == NativeErrorInvalidArgument, failures);
+
+				BENCH_CHECK(controller.ConfigurePid(2) == NativeSuccess, failures);
+				BENCH_CHECK(controller.Kind() == ControllerKind::Pid, failures);
+				BENCH_CHECK(controller.SetPidChannel(2, DefaultPidChannelSettings()) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(controller.SetLeadLagChannel(0, DefaultLeadLagChannelSettings()) == NativeErrorInvalidState, failures);
+
+				const uInt32 inputs[2] = { 1, 5 };
+				const uInt32 outputs[2] = { 0, 1 };
+				BENCH_CHECK(controller.Bind(inputs, 1, outputs, 2) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(controller.Bind(inputs, 2, outputs, 2) == NativeSuccess, failures);
+
+				// The binding reads input 5 of a loop with two.
+				BENCH_CHECK(controller.Step(in, 2, out, 2, Dt) == NativeErrorInvalidArgument, failures);
+				return failures;
+			}
+
+			// Three channels, padded to four, through swapped bindings, against
+			// three reference loops; the settings change half way.
+			int CheckPid(uInt32 steps) {
+
+				int failures = 0;
+				std::mt19937 random(7);
+				std::normal_distribution<float64> noise(0.0, 0.5);
+
+				ControllerCore controller;
+				ReferencePid reference[3];
+
+				BENCH_CHECK(controller.ConfigurePid(3) == NativeSuccess, failures);
+
+				const uInt32 inputs[3] = { 2, 0, 1 };
+				const uInt32 outputs[3] = { 1, 2, 0 };
+				BENCH_CHECK(controller.Bind(inputs, 3, outputs, 3) == NativeSuccess, failures);
+
+				uInt64 mismatches = 0;
+
+				for (uInt32 n = 0; n < steps; n++) {
+
+					if (n == 0 || n == steps / 2) {
+						for (uInt32 k = 0; k < 3; k++) {
+							reference[k].s = RandomPid(random);
+							BENCH_CHECK(controller.SetPidChannel(k, reference[k].s) == NativeSuccess, failures);
+						}
+					}
+
+					float64 in[3];
+					float64 out[3];
+
+					for (uInt32 k = 0; k < 3; k++) {
+						in[k] = std::sin(1e-3 * n * (k + 1)) + 0.1 * noise(random);
+					}
+
+					BENCH_CHECK(controller.Step(in, 3, out, 3, Dt) == NativeSuccess, failures);
+
+					for (uInt32 k = 0; k < 3; k++) {
+						if (!Near(out[outputs[k]], reference[k].Step(in[inputs[k]], Dt))) {
+							mismatches++;
+						}
+					}
+				}
+
+				BENCH_CHECK(mismatches == 0, failures);
+				BENCH_CHECK(controller.Counters().steps == steps, failures);
+				BENCH_CHECK(controller.Counters().parameterUpdates == 6, failures);
+				return failures;
+			}
+
+			// Steps a single PID channel on a constant measurement and returns
+			// the outputs.
+			std::vector<float64> RunPid(const PidChannelSettings& s, const std::vector<float64>& y) {
+
+				ControllerCore controller;
+				controller.ConfigurePid(1);
+				controller.SetPidChannel(0, s);
+
+				std::vector<float64> u(y.size());
+				for (size_t n = 0; n < y.size(); n++) {
+					controller.Step(&y[n], 1, &u[n], 1, Dt);
+				}
+				return u;
+			}
+
+			// A setpoint out of reach saturates the output for a while, then
+			// comes back: with back-calculation the integrator has not wound
+			// up and the output leaves saturation at once.
+			int CheckAntiWindup() {
+
+				int failures = 0;
+
+				PidChannelSettings s = DefaultPidChannelSettings();
+				s.kp = 0.5;
+				s.ki = 200.0;
+				s.outputMin = -1.0;
+				s.outputMax = 1.0;
+				s.setpoint = 5.0;
+
+				// Measurement stuck at 0 for 0.2 s, then at the setpoint.
+				std::vector<float64> y(4000, 0.0);
+				for (size_t n = 2000; n < y.size(); n++) {
+					y[n] = 5.0;
+				}
+
+				auto recovery = [&](const std::vector<float64>& u) {
+					size_t n = 2000;
+					while (n < u.size() && u[n] >= 1.0) {
+						n++;
+					}
+					return n - 2000;
+				};
+
+				const std::vector<float64> wound = RunPid(s, y);
+				s.trackingGain = 1.0 / (Dt * 4.0);
+				const std::vector<float64> tracked = RunPid(s, y);
+
+				BENCH_CHECK(wound[1999] == 1.0 && tracked[1999] == 1.0, failures);
+				BENCH_CHECK(recovery(tracked) <= 1, failures);
+				BENCH_CHECK(recovery(wound) > 1000, failures);
+
+				std::printf("  anti-windup: saturated %zu steps after the error cleared, %zu without\n",
+					recovery(tracked), recovery(wound));
+				return failures;
+			}
+
+			// A step of the measurement: the unfiltered derivative is one
+			// spike of kd / dt, the filtered one is spread over Tf.
+			int CheckDerivativeFilter() {
+
+				int failures = 0;
+
+				PidChannelSettings s = DefaultPidChannelSettings();
+				s.kp = 0.0;
+				s.kd = 1e-4;
+				s.outputMin = -1e6;
+				s.outputMax = 1e6;
+
+				std::vector<float64> y(100, 0.0);
+				for (size_t n = 10; n < y.size(); n++) {
+					y[n] = 1.0;
+				}
+
+				const std::vector<float64> raw = RunPid(s, y);
+				s.derivativeTime = 10 * Dt;
+				const std::vector<float64> filtered = RunPid(s, y);
+
+				BENCH_CHECK(raw[9] == 0.0 && filtered[9] == 0.0, failures);
+				BENCH_CHECK(Near(raw[10], -s.kd / Dt), failures);
+				BENCH_CHECK(raw[11] == 0.0, failures);
+				BENCH_CHECK(Near(filtered[10], -s.kd / (s.derivativeTime + Dt)), failures);
+				BENCH_CHECK(filtered[11] < 0.0 && filtered[11] > filtered[10], failures);
+
+				// Both integrate to -kd over the step.
+				float64 area = 0.0;
+				for (float64 u : filtered) {
+					area += u * Dt;
+				}
+				BENCH_CHECK(std::fabs(area + s.kd) < 1e-3 * s.kd, failures);
+				return failures;
+			}
+
+			// The lead-lag reduces to a gain without time constants, and
+			// settles to gain * error otherwise.
+			int CheckLeadLag() {
+
+				int failures = 0;
+				ControllerCore controller;
+
+				BENCH_CHECK(controller.ConfigureLeadLag(5) == NativeSuccess, failures);
+
+				LeadLagChannelSettings s = DefaultLeadLagChannelSettings();
+				s.gain = 2.5;
+				s.setpoint = 1.0;
+				BENCH_CHECK(controller.SetLeadLagChannel(0, s) == NativeSuccess, failures);
+
+				s.leadTime = 5e-3;
+				s.lagTime = 1e-3;
+				BENCH_CHECK(controller.SetLeadLagChannel(4, s) == NativeSuccess, failures);
+
+				float64 in[5] = { 0.2, 0.0, 0.0, 0.0, 0.2 };
+				float64 out[5];
+
+				BENCH_CHECK(controller.Step(in, 5, out, 5, Dt) == NativeSuccess, failures);
+				BENCH_CHECK(Near(out[0], 2.5 * 0.8), failures);
+				BENCH_CHECK(Near(out[1], 0.0), failures);
+				// Lead: the first output overshoots the final value.
+				BENCH_CHECK(out[4] > 2.5 * 0.8 * 2.0, failures);
+
+				for (int n = 0; n < 1000; n++) {
+					controller.Step(in, 5, out, 5, Dt);
+				}
+				BENCH_CHECK(std::fabs(out[4] - 2.5 * 0.8) < 1e-6, failures);
+				return failures;
+			}
+
+			// A one-state controller, A = 1, B = dt, C = ki, D = kp, is the PI
+			// controller without anti-windup.
+			int CheckStateSpace(uInt32 steps) {
+
+				int failures = 0;
+				std::mt19937 random(11);
+				std::uniform_real_distribution<float64> value(-1.0, 1.0);
+
+				ControllerCore controller;
+				BENCH_CHECK(controller.ConfigureStateSpace(1, 1, 1) == NativeSuccess, failures);
+
+				PidChannelSettings pi = DefaultPidChannelSettings();
+				pi.kp = 0.7;
+				pi.ki = 30.0;
+				pi.setpoint = 0.25;
+
+				const float64 a = 1.0;
+				const float64 b = Dt;
+				const float64 c = pi.ki;
+				const float64 d = pi.kp;
+				const float64 setpoint = pi.setpoint;
+
+				StateSpaceSettings settings = {};
+				settings.a = &a;
+				settings.b = &b;
+				settings.c = &c;
+				settings.d = &d;
+				settings.setpoints = &setpoint;
+				BENCH_CHECK(controller.SetStateSpace(settings) == NativeSuccess, failures);
+
+				ReferencePid reference;
+				reference.s = pi;
+				uInt64 mismatches = 0;
+
+				for (uInt32 n = 0; n < steps; n++) {
+
+					const float64 y = 0.1 * value(random);
+					float64 u = 0.0;
+					controller.Step(&y, 1, &u, 1, Dt);
+
+					if (!Near(u, reference.Step(y, Dt))) {
+						mismatches++;
+					}
+				}
+				BENCH_CHECK(mismatches == 0, failures);
+
+				// A reset clears the state at the next step.
+				controller.Reset();
+				const float64 y = pi.setpoint;
+				float64 u = 1.0;
+				controller.Step(&y, 1, &u, 1, Dt);
+				BENCH_CHECK(u == 0.0, failures);
+				BENCH_CHECK(controller.Counters().resets == 1, failures);
+				return failures;
+			}
+
+			// A writer thread keeps publishing settings with kp = setpoint = v
+			// while the loop runs the controller in free run: every output is
+			// v * (v - y) for one published v, never a mix of two sets.
+			int CheckParameterSwap(uInt64 iterations) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				TaskHandle input = NULL;
+				TaskHandle output = NULL;
+				TaskHandle digital = NULL;
+
+				DAQmxCreateTask("controller in", &input);
+				DAQmxCreateAIVoltageChan(input, "SimDev1/ai0:1", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(input, "", 10000.0, DAQmx_Val_Rising,
+					DAQmx_Val_HWTimedSinglePoint, 1);
+
+				DAQmxCreateTask("controller out", &output);
+				DAQmxCreateAOVoltageChan(output, "SimDev1/ao0", "", -10.0, 10.0,
+					DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(output, "", 10000.0, DAQmx_Val_Rising,
+					DAQmx_Val_HWTimedSinglePoint, 1);
+
+				DAQmxCreateTask("controller lines", &digital);
+				DAQmxCreateDOChan(digital, "SimDev1/port0/line0", "", DAQmx_Val_ChanPerLine);
+				DAQmxCfgSampClkTiming(digital, "", 10000.0, DAQmx_Val_Rising,
+					DAQmx_Val_HWTimedSinglePoint, 1);
+
+				// Channel 0: input 1 to the analog output. Channel 1: input 0
+				// to the digital line, on when the measurement is under 0.
+				ControllerCore controller;
+				BENCH_CHECK(controller.ConfigurePid(2) == NativeSuccess, failures);
+				const uInt32 inputs[2] = { 1, 0 };
+				const uInt32 outputs[2] = { 0, 1 };
+				BENCH_CHECK(controller.Bind(inputs, 2, outputs, 2) == NativeSuccess, failures);
+
+				PidChannelSettings line = DefaultPidChannelSettings();
+				line.kp = 1e6;
+				line.outputMin = 0.0;
+				line.outputMax = 1.0;
+				BENCH_CHECK(controller.SetPidChannel(1, line) == NativeSuccess, failures);
+
+				const uInt32 values = 64;
+				PidChannelSettings gain = DefaultPidChannelSettings();
+				gain.kp = 1.0;
+				gain.setpoint = 1.0;
+				gain.outputMin = -1e9;
+				gain.outputMax = 1e9;
+				BENCH_CHECK(controller.SetPidChannel(0, gain) == NativeSuccess, failures);
+
+				ControlLoopConfig config = DefaultControlLoopConfig();
+				config.inputChannels = 2;
+				config.outputChannels = 1;
+				config.digitalLines = 1;
+				config.ownsTasks = true;
+
+				ControlLoopCore loop;
+				BENCH_CHECK(loop.Attach(input, output, digital, config) == NativeSuccess, failures);
+				BENCH_CHECK(loop.SetControlLaw(ControllerCore::Law, controller.LawContext()) == NativeSuccess, failures);
+
+				std::atomic<bool> writing(true);
+				uInt64 published = 0;
+
+				std::thread writer([&]() {
+					while (writing.load()) {
+						gain.kp = (float64)(1 + published % values);
+						gain.setpoint = gain.kp;
+						controller.SetPidChannel(0, gain);
+						published++;
+					}
+				});
+
+				BENCH_CHECK(loop.Start() == NativeSuccess, failures);
+
+				while (loop.Counters().iterations < iterations && loop.IsRunning()) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				BENCH_CHECK(loop.Stop() == NativeSuccess, failures);
+				writing.store(false);
+				writer.join();
+
+				const ControlLoopCounters counters = loop.Counters();
+				const std::vector<float64> generated = SimGeneratedAnalog(output);
+				const std::vector<uInt8> lines = SimWrittenDigitalLines(digital);
+
+				BENCH_CHECK(counters.lastError == 0, failures);
+				BENCH_CHECK(generated.size() == counters.iterations, failures);
+				BENCH_CHECK(lines.size() == counters.iterations, failures);
+
+				uInt64 torn = 0;
+				uInt64 wrongLines = 0;
+
+				for (uInt64 k = 0; k < generated.size() && k < lines.size(); k++) {
+
+					const float64 y = SimScaledSample(1, k);
+					bool consistent = false;
+
+					for (uInt32 v = 1; v <= values && !consistent; v++) {
+						consistent = generated[k] == (float64)v * ((float64)v - y);
+					}
+					torn += consistent ? 0 : 1;
+
+					wrongLines += (lines[k] == ((SimScaledSample(0, k) < 0.0) ? 1 : 0)) ? 0 : 1;
+				}
+
+				BENCH_CHECK(torn == 0, failures);
+				BENCH_CHECK(wrongLines == 0, failures);
+				BENCH_CHECK(published > 0, failures);
+
+				std::printf("  parameter swap: %llu iterations, %llu sets published meanwhile\n",
+					(unsigned long long)counters.iterations, (unsigned long long)published);
+
+				BENCH_CHECK(loop.Detach() == NativeSuccess, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			double MeasureStep(ControllerCore& controller, uInt32 channels, uInt32 steps) {
+
+				std::vector<float64> in(channels, 0.0);
+				std::vector<float64> out(channels, 0.0);
+
+				const auto start = std::chrono::steady_clock::now();
+
+				for (uInt32 n = 0; n < steps; n++) {
+					in[n % channels] = 1e-3 * (float64)(n & 1023);
+					controller.Step(in.data(), channels, out.data(), channels, Dt);
+				}
+
+				const double seconds = SecondsSince(start);
+				KeepAlive(out[0]);
+				return 1e9 * seconds / steps;
+			}
+
+			void MeasureThroughput(uInt32 steps) {
+
+				for (uInt32 channels : { 1u, 4u, 8u, 16u }) {
+
+					ControllerCore pid;
+					pid.ConfigurePid(channels);
+					ControllerCore leadLag;
+					leadLag.ConfigureLeadLag(channels);
+
+					std::printf("  %2u channels: PID %6.1f ns/step   lead-lag %6.1f ns/step\n",
+						channels, MeasureStep(pid, channels, steps),
+						MeasureStep(leadLag, channels, steps));
+				}
+
+				ControllerCore stateSpace;
+				stateSpace.ConfigureStateSpace(8, 4, 4);
+				std::printf("  state-space 8 states, 4 x 4: %6.1f ns/step\n",
+					MeasureStep(stateSpace, 4, steps));
+			}
+		}
+
+		int RunControllerBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const uInt32 steps = options.quick ? 20000 : 200000;
+
+			failures += CheckArguments();
+			failures += CheckPid(steps);
+			failures += CheckAntiWindup();
+			failures += CheckDerivativeFilter();
+			failures += CheckLeadLag();
+			failures += CheckStateSpace(steps);
+			failures += CheckParameterSwap(steps);
+
+			MeasureThroughput(steps * 10);
+			return failures;
+		}
+	}
+}
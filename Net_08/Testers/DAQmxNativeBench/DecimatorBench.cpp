@@ -0,0 +1,566 @@
+// Checks the polyphase FIR / CIC decimator (DecimatorCore + DecimationKernels)
+// against a direct convolution for every SIMD level, block split and layout,
+// runs it inside the acquisition engine, then measures its throughput.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AcquisitionEngineCore.h"
+#include "Native/CpuFeatures.h"
+#include "Native/DecimationKernels.h"
+#include "Native/DecimatorCore.h"
+#include "Native/NativeStatus.h"
+#include "Native/RawScalingCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			enum class FilterKind { Default, Cic, Custom };
+
+			const char* FilterName(FilterKind kind) {
+				switch (kind) {
+				case FilterKind::Cic: return "cic";
+				case FilterKind::Custom: return "custom";
+				default: return "lowpass";
+				}
+			}
+
+			TaskHandle CreateAITask(uInt32 channels, float64 rate, bool continuous) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("decimation", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ai0:%u", channels - 1);
+				DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+
+				if (continuous) {
+					DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+						DAQmx_Val_ContSamps, 0);
+				}
+				return task;
+			}
+
+			size_t Index(int32 fillMode, uInt32 channels, uInt32 samples,
+				uInt32 ch, uInt32 i) {
+				return (fillMode == DAQmx_Val_GroupByChannel)
+					? (size_t)ch * samples + i : (size_t)i * channels + ch;
+			}
+
+			float64 RawAsF64(uInt32 ch, uInt64 i) {
+				return (float64)SimRawSample(ch, i);
+			}
+
+			// y[m] = sum h[k] x[m * factor - k], with x = 0 before the start.
+			template <typename TInput>
+			float64 Reference(const std::vector<float64>& taps, uInt32 factor,
+				uInt32 ch, uInt64 m, TInput input) {
+
+				const int64 n = (int64)(m * factor);
+				float64 y = 0.0;
+
+				for (size_t k = 0; k < taps.size() && (int64)k <= n; k++) {
+					y += taps[k] * input(ch, (uInt64)(n - (int64)k));
+				}
+				return y;
+			}
+
+			std::vector<float64> ChannelTaps(const DecimatorCore& decimator, uInt32 ch) {
+
+				std::vector<float64> taps(MaxDecimatorTaps);
+				const int32 count = decimator.GetChannelTaps(ch, taps.data(), MaxDecimatorTaps);
+				taps.resize((count > 0) ? (size_t)count : 0);
+				return taps;
+			}
+
+			int ApplyFilter(DecimatorCore& decimator, FilterKind kind) {
+
+				int failures = 0;
+				const uInt32 channels = decimator.Config().channels;
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+
+					if (kind == FilterKind::Cic) {
+						BENCH_CHECK(decimator.SetChannelCic(ch, 1 + ch % 4) == NativeSuccess, failures);
+					}
+					else if (kind == FilterKind::Custom) {
+						// Odd lengths, asymmetric, different per channel.
+						std::vector<float64> taps(5 + 2 * ch);
+						for (size_t k = 0; k < taps.size(); k++) {
+							taps[k] = 1.0 / (1.0 + k) - 0.01 * ch;
+						}
+						BENCH_CHECK(decimator.SetChannelFir(ch, taps.data(),
+							(uInt32)taps.size()) == NativeSuccess, failures);
+					}
+				}
+				return failures;
+			}
+
+			// Streams `total` samples per channel through the decimator in
+			// blocks of the sizes in `splits` (cycled), then compares every
+			// output with the direct convolution.
+			int CheckStream(uInt32 channels, uInt32 factor, FilterKind kind,
+				SampleFormat format, int32 inFill, int32 outFill,
+				const std::vector<uInt32>& splits, uInt32 total, const RawScalingCore* scaling) {
+
+				int failures = 0;
+
+				DecimatorCore decimator;
+				DecimatorConfig config = DefaultDecimatorConfig();
+				config.channels = channels;
+				config.factor = factor;
+				config.maxSamplesPerChannel = 1200;
+
+				BENCH_CHECK(decimator.Configure(config) == NativeSuccess, failures);
+				failures += ApplyFilter(decimator, kind);
+				BENCH_CHECK(decimator.SetScaling(scaling) == NativeSuccess, failures);
+
+				std::vector<std::vector<float64>> outputs(channels);
+				std::vector<float64> inF64((size_t)channels * config.maxSamplesPerChannel);
+				std::vector<int16> inI16(inF64.size());
+				std::vector<float64> outF64(inF64.size());
+				std::vector<int16> outI16(inF64.size());
+
+				uInt64 position = 0;
+				size_t split = 0;
+
+				while (position < total) {
+
+					const uInt32 n = (uInt32)std::min<uInt64>(splits[split++ % splits.size()],
+						total - position);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt32 i = 0; i < n; i++) {
+							const size_t k = Index(inFill, channels, n, ch, i);
+							inF64[k] = SimScaledSample(ch, position + i);
+							inI16[k] = SimRawSample(ch, position + i);
+						}
+					}
+
+					uInt32 produced = 0;
+					int32 r;
+
+					if (format == SampleFormat::Float64) {
+						r = decimator.Process(inF64.data(), n, inFill, outF64.data(),
+							outF64.size(), outFill, produced);
+					}
+					else if (scaling != nullptr) {
+						r = decimator.Process(inI16.data(), n, inFill, outF64.data(),
+							outF64.size(), outFill, produced);
+					}
+					else {
+						r = decimator.Process(inI16.data(), n, inFill, outI16.data(),
+							outI16.size(), outFill, produced);
+					}
+
+					BENCH_CHECK(r == NativeSuccess, failures);
+					BENCH_CHECK(produced <= decimator.MaxOutputSamples(n), failures);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt32 i = 0; i < produced; i++) {
+							const size_t k = Index(outFill, channels, produced, ch, i);
+							outputs[ch].push_back((format == SampleFormat::Int16 && scaling == nullptr)
+								? (float64)outI16[k] : outF64[k]);
+						}
+					}
+					position += n;
+				}
+
+				const uInt64 expectedCount = (total + factor - 1) / factor;
+				BENCH_CHECK(decimator.OutputPosition() == expectedCount, failures);
+
+				uInt32 bad = 0;
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+
+					BENCH_CHECK(outputs[ch].size() == expectedCount, failures);
+					const std::vector<float64> taps = ChannelTaps(decimator, ch);
+
+					for (uInt64 m = 0; m < outputs[ch].size(); m++) {
+
+						const float64 actual = outputs[ch][m];
+
+						if (format == SampleFormat::Float64 || scaling != nullptr) {
+							const float64 expected = Reference(taps, factor, ch, m, SimScaledSample);
+							bad += std::fabs(actual - expected) > 1e-9 * (1.0 + std::fabs(expected));
+						}
+						else {
+							// Rounding of an exact tie may go either way.
+							float64 expected = Reference(taps, factor, ch, m, RawAsF64);
+							expected = std::max(-32768.0, std::min(32767.0, expected));
+							bad += std::fabs(actual - expected) > 0.5 + 1e-6;
+						}
+					}
+				}
+
+				if (bad != 0) {
+					std::printf("  %u ch /%u %s %s %s->%s: %u bad outputs\n", channels, factor,
+						FilterName(kind), (format == SampleFormat::Int16) ? "I16" : "F64",
+						(inFill == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan",
+						(outFill == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan", bad);
+				}
+				BENCH_CHECK(bad == 0, failures);
+				return failures;
+			}
+
+			int CheckDcGain() {
+
+				int failures = 0;
+
+				for (FilterKind kind : { FilterKind::Default, FilterKind::Cic }) {
+
+					DecimatorCore decimator;
+					DecimatorConfig config = DefaultDecimatorConfig();
+					config.channels = 4;
+					config.factor = 8;
+					config.maxSamplesPerChannel = 4096;
+					BENCH_CHECK(decimator.Configure(config) == NativeSuccess, failures);
+					failures += ApplyFilter(decimator, kind);
+
+					std::vector<float64> in((size_t)config.channels * 4096, 2.5);
+					std::vector<float64> out(in.size());
+					uInt32 produced = 0;
+
+					BENCH_CHECK(decimator.Process(in.data(), 4096, DAQmx_Val_GroupByChannel,
+						out.data(), out.size(), DAQmx_Val_GroupByChannel, produced) == 0, failures);
+
+					// Past the filter length every output sees the constant only.
+					BENCH_CHECK(std::fabs(out[produced - 1] - 2.5) < 1e-12, failures);
+					BENCH_CHECK(std::fabs(out[(size_t)3 * produced + produced - 1] - 2.5) < 1e-12,
+						failures);
+				}
+
+				// Saturation of the I16 output.
+				std::vector<float64> big = { 1e9, -1e9, 32767.4, -32768.6, 0.5, 1.5, -2.5 };
+				std::vector<int16> small(big.size());
+				ConvertF64ToI16(big.data(), small.data(), big.size());
+				BENCH_CHECK(small[0] == 32767 && small[1] == -32768, failures);
+				BENCH_CHECK(small[2] == 32767 && small[3] == -32768, failures);
+				BENCH_CHECK(small[4] == 0 && small[5] == 2 && small[6] == -2, failures);
+				return failures;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				DecimatorCore decimator;
+				float64 in[16] = {};
+				float64 out[16] = {};
+				uInt32 produced = 0;
+
+				BENCH_CHECK(decimator.Process(in, 4, DAQmx_Val_GroupByChannel, out, 16,
+					DAQmx_Val_GroupByChannel, produced) == NativeErrorInvalidState, failures);
+
+				DecimatorConfig config = DefaultDecimatorConfig();
+				config.factor = 1000;
+				BENCH_CHECK(decimator.Configure(config) == NativeErrorInvalidArgument, failures);
+
+				config = DefaultDecimatorConfig();
+				config.maxSamplesPerChannel = 8;
+				BENCH_CHECK(decimator.Configure(config) == NativeSuccess, failures);
+				BENCH_CHECK(decimator.Process(in, 16, DAQmx_Val_GroupByChannel, out, 16,
+					DAQmx_Val_GroupByChannel, produced) == NativeErrorBufferTooSmall, failures);
+				BENCH_CHECK(decimator.Process(in, 8, 12345, out, 16,
+					DAQmx_Val_GroupByChannel, produced) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(decimator.SetChannelCic(0, MaxCicStages + 1) == NativeErrorInvalidArgument,
+					failures);
+				BENCH_CHECK(decimator.SetChannelFir(1, in, 4) == NativeErrorInvalidArgument, failures);
+				return failures;
+			}
+
+			// The engine reads full-rate F64 blocks by scan and delivers
+			// decimated blocks by channel.
+			int CheckEngine(uInt32 blocks) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				const uInt32 channels = 8;
+				const uInt32 blockSamples = 1000;
+				const uInt32 factor = 12;
+
+				DecimatorCore decimator;
+				DecimatorConfig decimation = DefaultDecimatorConfig();
+				decimation.channels = channels;
+				decimation.factor = factor;
+				decimation.maxSamplesPerChannel = blockSamples;
+				BENCH_CHECK(decimator.Configure(decimation) == NativeSuccess, failures);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = channels;
+				config.samplesPerBlock = blockSamples;
+				config.ringBlocks = 16;
+				config.format = SampleFormat::Float64;
+				config.fillMode = DAQmx_Val_GroupByScanNumber;
+				config.deliveredFillMode = DAQmx_Val_GroupByChannel;
+				config.ownsTask = true;
+
+				BENCH_CHECK(engine.SetDecimator(&decimator) == NativeErrorNotAttached, failures);
+				BENCH_CHECK(engine.Attach(CreateAITask(channels, 250000.0, true), config) == 0,
+					failures);
+				BENCH_CHECK(engine.SetDecimator(&decimator) == NativeSuccess, failures);
+				BENCH_CHECK(engine.Start() == 0, failures);
+				BENCH_CHECK(engine.SetDecimator(nullptr) == NativeErrorAlreadyRunning, failures);
+
+				const std::vector<float64> taps = ChannelTaps(decimator, 0);
+				uInt32 consumed = 0;
+				uInt32 bad = 0;
+				uInt32 gaps = 0;
+				uInt64 expectedFirst = 0;
+				BlockView view;
+
+				while (consumed < blocks && engine.WaitAcquireBlock(view, 2000)) {
+
+					const float64* data = static_cast<const float64*>(view.data);
+					const uInt32 n = view.samplesPerChannel;
+
+					BENCH_CHECK(view.fillMode == DAQmx_Val_GroupByChannel, failures);
+					BENCH_CHECK(n + 1 >= blockSamples / factor && n <= blockSamples / factor + 1,
+						failures);
+
+					gaps += (view.firstSample != expectedFirst);
+
+					// Spot checks: first and last output of a few channels.
+					for (uInt32 ch = 0; ch < channels; ch += 3) {
+						for (uInt32 i : { 0u, n - 1 }) {
+							const float64 expected = Reference(taps, factor, ch,
+								view.firstSample + i, SimScaledSample);
+							bad += std::fabs(data[(size_t)ch * n + i] - expected)
+								> 1e-9 * (1.0 + std::fabs(expected));
+						}
+					}
+
+					expectedFirst = view.firstSample + n;
+					engine.ReleaseBlock();
+					consumed++;
+				}
+
+				engine.Stop();
+				AcquisitionEngineCounters counters = engine.Counters();
+				engine.Detach();
+
+				std::printf("  engine F64/ByScan->ByChannel /%u: %u blocks, %u bad, "
+					"%llu dropped, %u gaps\n", factor, consumed, bad,
+					(unsigned long long)counters.blocksDropped, gaps);
+
+				BENCH_CHECK(consumed == blocks, failures);
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(counters.readErrors == 0, failures);
+				// Dropped blocks still advance the decimator, so a gap is a whole
+				// number of decimated blocks and the values above still match.
+				BENCH_CHECK(counters.blocksDropped != 0 || gaps == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			int CheckAll() {
+
+				int failures = 0;
+				const std::vector<uInt32> oneBlock = { 1200 };
+				const std::vector<uInt32> ragged = { 1, 7, 333, 1000, 64, 2, 1200 };
+
+				TaskHandle task = CreateAITask(8, 0.0, false);
+				RawScalingCore scaling;
+				BENCH_CHECK(scaling.Capture(task) == NativeSuccess, failures);
+				DAQmxClearTask(task);
+
+				for (FilterKind kind : { FilterKind::Default, FilterKind::Cic, FilterKind::Custom }) {
+					for (uInt32 channels : { 1u, 3u, 8u }) {
+						for (uInt32 factor : { 1u, 4u, 10u }) {
+							for (int32 inFill : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+
+								const int32 outFill = (factor == 4) ? inFill
+									: (inFill == DAQmx_Val_GroupByChannel)
+										? DAQmx_Val_GroupByScanNumber : DAQmx_Val_GroupByChannel;
+
+								failures += CheckStream(channels, factor, kind, SampleFormat::Float64,
+									inFill, outFill, ragged, 3000, nullptr);
+								failures += CheckStream(channels, factor, kind, SampleFormat::Int16,
+									inFill, outFill, ragged, 3000, nullptr);
+							}
+						}
+					}
+				}
+
+				failures += CheckStream(8, 10, FilterKind::Default, SampleFormat::Float64,
+					DAQmx_Val_GroupByScanNumber, DAQmx_Val_GroupByChannel, oneBlock, 3600, nullptr);
+				failures += CheckStream(8, 10, FilterKind::Default, SampleFormat::Int16,
+					DAQmx_Val_GroupByScanNumber, DAQmx_Val_GroupByChannel, ragged, 3000, &scaling);
+				failures += CheckStream(8, 7, FilterKind::Cic, SampleFormat::Int16,
+					DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber, ragged, 3000, &scaling);
+				return failures;
+			}
+
+			double MeasureDecimator(SampleFormat format, uInt32 channels, uInt32 samples,
+				uInt32 factor, double seconds) {
+
+				DecimatorCore decimator;
+				DecimatorConfig config = DefaultDecimatorConfig();
+				config.channels = channels;
+				config.factor = factor;
+				config.maxSamplesPerChannel = samples;
+				decimator.Configure(config);
+
+				const size_t total = (size_t)channels * samples;
+				std::vector<float64> inF64(total);
+				std::vector<int16> inI16(total);
+
+				for (uInt32 i = 0; i < samples; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						inF64[(size_t)i * channels + ch] = SimScaledSample(ch, i);
+						inI16[(size_t)i * channels + ch] = SimRawSample(ch, i);
+					}
+				}
+
+				std::vector<float64> outF64(total);
+				std::vector<int16> outI16(total);
+				uInt64 processed = 0;
+				uInt32 produced = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 4; rep++) {
+						if (format == SampleFormat::Float64) {
+							decimator.Process(inF64.data(), samples, DAQmx_Val_GroupByScanNumber,
+								outF64.data(), total, DAQmx_Val_GroupByChannel, produced);
+						}
+						else {
+							decimator.Process(inI16.data(), samples, DAQmx_Val_GroupByScanNumber,
+								outI16.data(), total, DAQmx_Val_GroupByScanNumber, produced);
+						}
+						processed += total;
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(outF64[0] + outI16[0]);
+				return processed / SecondsSince(start);
+			}
+
+			// What a straightforward managed port does per block: allocate the
+			// outputs, run the full-rate convolution over a copied history and
+			// keep every `factor`-th value.
+			double MeasureNaive(uInt32 channels, uInt32 samples, uInt32 factor, double seconds) {
+
+				const uInt32 tapCount = factor * DefaultDecimatorConfig().tapsPerPhase;
+				std::vector<float64> taps(tapCount);
+				DesignLowpassFir(taps.data(), tapCount, 0.4 / factor);
+
+				std::vector<float64> in((size_t)channels * samples);
+				for (size_t i = 0; i < in.size(); i++) {
+					in[i] = SimScaledSample((uInt32)(i % channels), i / channels);
+				}
+
+				std::vector<std::vector<float64>> history(channels,
+					std::vector<float64>(tapCount - 1, 0.0));
+				uInt64 processed = 0;
+				float64 checksum = 0.0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					std::vector<std::vector<float64>> out(channels);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+
+						std::vector<float64> x(history[ch]);
+						for (uInt32 i = 0; i < samples; i++) {
+							x.push_back(in[(size_t)i * channels + ch]);
+						}
+
+						std::vector<float64> full(samples);
+						for (uInt32 i = 0; i < samples; i++) {
+							float64 y = 0.0;
+							for (uInt32 k = 0; k < tapCount; k++) {
+								y += taps[k] * x[i + tapCount - 1 - k];
+							}
+							full[i] = y;
+						}
+						for (uInt32 i = 0; i < samples; i += factor) {
+							out[ch].push_back(full[i]);
+						}
+						history[ch].assign(x.end() - (tapCount - 1), x.end());
+					}
+
+					checksum += out[0][0];
+					processed += in.size();
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(checksum);
+				return processed / SecondsSince(start);
+			}
+		}
+
+		int RunDecimatorBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			failures += CheckArguments();
+			failures += CheckDcGain();
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				const int f = CheckAll();
+				std::printf("  correctness %-7s: %d failed checks\n", SimdLevelName(level), f);
+				failures += f;
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+			failures += CheckEngine(options.quick ? 100 : 2000);
+
+			const uInt32 channels = 8;
+			const uInt32 samples = 10000;
+			const uInt32 factor = 10;
+			const double seconds = options.quick ? 0.1 : 1.0;
+			const double acquired = channels * 250000.0;
+
+			std::printf("  %u ch, /%u, %u taps, blocks of %u:\n", channels, factor,
+				factor * DefaultDecimatorConfig().tapsPerPhase, samples);
+
+			const double naive = MeasureNaive(channels, samples, factor, seconds);
+			std::printf("  %-7s full-rate convolution + pick: %7.1f MS/s in (%.1f%% of a "
+				"core at %u ch x 250 kS/s)\n", "naive", naive / 1e6,
+				100.0 * acquired / naive, channels);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+
+				const double f64 = MeasureDecimator(SampleFormat::Float64, channels, samples,
+					factor, seconds);
+				const double i16 = MeasureDecimator(SampleFormat::Int16, channels, samples,
+					factor, seconds);
+
+				std::printf("  %-7s F64 by scan->by channel %7.1f MS/s (%.1f%%), "
+					"I16->I16 %7.1f MS/s (%.1f%%)\n", SimdLevelName(level),
+					f64 / 1e6, 100.0 * acquired / f64, i16 / 1e6, 100.0 * acquired / i16);
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
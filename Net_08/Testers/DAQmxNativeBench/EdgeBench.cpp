@@ -0,0 +1,544 @@
+// Checks the change detection kernels (EdgeKernels) against a plain loop
+// for every sample size and SIMD level, the edge extractor on sparse
+// multi-channel streams in both fill modes, and the transition files
+// against the records they were written from, then measures the scan and
+// the size of the encoding against the raw words.
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/CpuFeatures.h"
+#include "Native/EdgeExtractorCore.h"
+#include "Native/EdgeKernels.h"
+#include "Native/NativeStatus.h"
+#include "Native/TransitionReaderCore.h"
+#include "Native/TransitionWriterCore.h"
+#include "Native/TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+
+		namespace {
+
+			std::string TempPath(const char* name) {
+				return (std::filesystem::temp_directory_path() / name).string();
+			}
+
+			uInt32 Load(const uInt8* data, size_t i, uInt32 sampleBytes) {
+				uInt32 v = 0;
+				std::memcpy(&v, data + i * sampleBytes, sampleBytes);
+				return v;
+			}
+
+			void Store(uInt8* data, size_t i, uInt32 sampleBytes, uInt32 v) {
+				std::memcpy(data + i * sampleBytes, &v, sampleBytes);
+			}
+
+			// Channel-major words that toggle a random line every `meanGap`
+			// samples on average.
+			std::vector<uInt8> SparseStream(uInt32 channels, size_t samples,
+				uInt32 sampleBytes, double meanGap, std::mt19937& random) {
+
+				std::vector<uInt8> data((size_t)channels * samples * sampleBytes);
+				std::uniform_real_distribution<double> uniform(0.0, 1.0);
+				std::uniform_int_distribution<uInt32> line(0, 8 * sampleBytes - 1);
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+
+					uInt32 value = 0;
+					uInt8* run = data.data() + (size_t)ch * samples * sampleBytes;
+
+					for (size_t i = 0; i < samples; i++) {
+						if (uniform(random) * meanGap < 1.0) {
+							value ^= 1u << line(random);
+							// Now and then several lines at once.
+							if (uniform(random) < 0.1) {
+								value ^= 1u << line(random);
+							}
+						}
+						Store(run, i, sampleBytes, value);
+					}
+				}
+				return data;
+			}
+
+			std::vector<DigitalTransition> ReferenceTransitions(const std::vector<uInt8>& data,
+				uInt32 channels, size_t samples, uInt32 sampleBytes, uInt32 mask) {
+
+				std::vector<DigitalTransition> result;
+				std::vector<uInt32> values(channels, 0);
+
+				for (size_t i = 0; i < samples; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+
+						const uInt32 v = Load(data.data() + (size_t)ch * samples * sampleBytes,
+							i, sampleBytes) & mask;
+
+						if (v != values[ch]) {
+							DigitalTransition t = {};
+							t.sampleIndex = i;
+							t.channel = ch;
+							t.value = v;
+							t.changed = v ^ values[ch];
+							result.push_back(t);
+							values[ch] = v;
+						}
+					}
+				}
+				return result;
+			}
+
+			bool SameTransitions(const std::vector<DigitalTransition>& a,
+				const std::vector<DigitalTransition>& b) {
+
+				if (a.size() != b.size()) {
+					return false;
+				}
+				for (size_t k = 0; k < a.size(); k++) {
+					if (a[k].sampleIndex != b[k].sampleIndex || a[k].channel != b[k].channel
+						|| a[k].value != b[k].value || a[k].changed != b[k].changed) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			int CheckKernels(std::mt19937& random) {
+
+				int failures = 0;
+				const uInt32 sizes[] = { 1, 2, 4 };
+				const size_t counts[] = { 0, 1, 2, 7, 8, 9, 16, 17, 31, 32, 33, 64, 65, 1000 };
+				std::uniform_int_distribution<uInt32> word;
+
+				for (uInt32 size : sizes) {
+					for (size_t count : counts) {
+						for (double gap : { 1.5, 10.0, 300.0 }) {
+							for (size_t offset = 0; offset < 3; offset++) {
+
+								// `offset` leading words misalign the scanned run.
+								std::vector<uInt8> data = SparseStream(1, count + offset, size, gap, random);
+								const uInt8* x = data.data() + offset * size;
+								const uInt32 previous = word(random);
+								const uInt32 mask = (word(random) & 1) ? 0xFFFFFFFFu : word(random);
+								const uInt32 widthMask = (size == 4) ? 0xFFFFFFFFu : (1u << (8 * size)) - 1;
+
+								std::vector<uInt32> expected;
+								uInt32 last = previous;
+								for (size_t i = 0; i < count; i++) {
+									const uInt32 v = Load(x, i, size);
+									if (((v ^ last) & mask & widthMask) != 0) {
+										expected.push_back((uInt32)i);
+									}
+									last = v;
+								}
+
+								std::vector<uInt32> positions(count + 1, 0xFFFFFFFFu);
+								const size_t n = FindChanges(x, count, size, previous, mask,
+									positions.data());
+								positions.resize(n);
+
+								if (positions != expected) {
+									failures++;
+								}
+							}
+						}
+					}
+				}
+
+				uInt32 dummy;
+				BENCH_CHECK(FindChanges(&dummy, 1, 3, 0, 0xFFFFFFFFu, &dummy) == 0, failures);
+				return failures;
+			}
+
+			// Feeds the stream in blocks of random length and collects the
+			// records, reading them between blocks.
+			int CheckExtractor(uInt32 channels, uInt32 sampleBytes, int32 fillMode,
+				uInt32 mask, std::mt19937& random) {
+
+				int failures = 0;
+				const size_t samples = 50000;
+				const uInt32 maxBlock = 4096;
+
+				std::vector<uInt8> data = SparseStream(channels, samples, sampleBytes, 200.0, random);
+				std::vector<DigitalTransition> expected =
+					ReferenceTransitions(data, channels, samples, sampleBytes, mask);
+
+				EdgeExtractorConfig config = DefaultEdgeExtractorConfig();
+				config.channels = channels;
+				config.sampleBytes = sampleBytes;
+				config.mask = mask;
+				config.maxSamplesPerChannel = maxBlock;
+
+				EdgeExtractorCore extractor;
+				BENCH_CHECK(extractor.Configure(config) == NativeSuccess, failures);
+
+				std::vector<DigitalTransition> got;
+				std::vector<uInt8> block((size_t)channels * maxBlock * sampleBytes);
+				std::uniform_int_distribution<uInt32> length(1, maxBlock);
+				DigitalTransition batch[100];
+				size_t at = 0;
+
+				while (at < samples) {
+
+					const uInt32 n = (uInt32)std::min<size_t>(length(random), samples - at);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt32 i = 0; i < n; i++) {
+							const uInt32 v = Load(data.data() + (size_t)ch * samples * sampleBytes,
+								at + i, sampleBytes);
+							const size_t index = (fillMode == DAQmx_Val_GroupByChannel)
+								? (size_t)ch * n + i : (size_t)i * channels + ch;
+							Store(block.data(), index, sampleBytes, v);
+						}
+					}
+
+					BENCH_CHECK(extractor.Process(block.data(), n, fillMode) >= 0, failures);
+					at += n;
+
+					size_t read;
+					while ((read = extractor.ReadTransitions(batch, 100)) > 0) {
+						got.insert(got.end(), batch, batch + read);
+					}
+				}
+
+				EdgeExtractorCounters counters = extractor.Counters();
+				BENCH_CHECK(counters.samplesScanned == samples, failures);
+				BENCH_CHECK(counters.transitions == expected.size(), failures);
+				BENCH_CHECK(counters.transitionsDropped == 0, failures);
+
+				const bool same = SameTransitions(got, expected);
+				BENCH_CHECK(same, failures);
+
+				std::printf("  extract %u ch x U%-2u %-7s mask %08X: %6zu transitions%s\n",
+					channels, sampleBytes * 8,
+					(fillMode == DAQmx_Val_GroupByChannel) ? "channel" : "scan",
+					mask, expected.size(), same ? "" : "  MISMATCH");
+				return failures;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				EdgeExtractorConfig config = DefaultEdgeExtractorConfig();
+				EdgeExtractorCore extractor;
+				uInt32 words[4] = {};
+
+				BENCH_CHECK(extractor.Process(words, 4, DAQmx_Val_GroupByChannel)
+					== NativeErrorInvalidState, failures);
+
+				config.sampleBytes = 3;
+				BENCH_CHECK(extractor.Configure(config) == NativeErrorUnsupportedFormat, failures);
+				config.sampleBytes = 4;
+				config.channels = 0;
+				BENCH_CHECK(extractor.Configure(config) == NativeErrorInvalidArgument, failures);
+				config.channels = 1;
+				config.maxSamplesPerChannel = 4;
+				BENCH_CHECK(extractor.Configure(config) == NativeSuccess, failures);
+
+				BENCH_CHECK(extractor.Process(words, 5, DAQmx_Val_GroupByChannel)
+					== NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(extractor.Process(words, 4, 7) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(extractor.Process(nullptr, 4, DAQmx_Val_GroupByChannel)
+					== NativeErrorInvalidArgument, failures);
+				return failures;
+			}
+
+			// A ring too small for the records: drops are counted and the
+			// values of the records that made it are still right.
+			int CheckDrops(std::mt19937& random) {
+
+				int failures = 0;
+				const size_t samples = 4096;
+				std::vector<uInt8> data = SparseStream(1, samples, 2, 4.0, random);
+
+				EdgeExtractorConfig config = DefaultEdgeExtractorConfig();
+				config.sampleBytes = 2;
+				config.maxSamplesPerChannel = (uInt32)samples;
+				config.capacity = 64;
+
+				EdgeExtractorCore extractor;
+				extractor.Configure(config);
+
+				const int32 found = extractor.Process(data.data(), (uInt32)samples,
+					DAQmx_Val_GroupByChannel);
+
+				std::vector<DigitalTransition> got(64);
+				got.resize(extractor.ReadTransitions(got.data(), got.size()));
+				EdgeExtractorCounters counters = extractor.Counters();
+
+				BENCH_CHECK(got.size() == 64, failures);
+				BENCH_CHECK(counters.transitions == (uInt64)found, failures);
+				BENCH_CHECK(counters.transitionsDropped == (uInt64)found - 64, failures);
+
+				for (const DigitalTransition& t : got) {
+					BENCH_CHECK(t.value == Load(data.data(), (size_t)t.sampleIndex, 2), failures);
+				}
+				return failures;
+			}
+
+			int CheckFile(uInt32 channels, uInt32 sampleBytes, double meanGap,
+				std::mt19937& random) {
+
+				int failures = 0;
+				const size_t samples = 200000;
+				const uInt32 block = 5000;
+				const std::string path = TempPath("DAQmxNativeBench_edges.dtr");
+
+				std::vector<uInt8> data = SparseStream(channels, samples, sampleBytes, meanGap, random);
+				std::vector<DigitalTransition> expected =
+					ReferenceTransitions(data, channels, samples, sampleBytes, 0xFFFFFFFFu);
+
+				EdgeExtractorConfig config = DefaultEdgeExtractorConfig();
+				config.channels = channels;
+				config.sampleBytes = sampleBytes;
+				config.maxSamplesPerChannel = block;
+
+				EdgeExtractorCore extractor;
+				extractor.Configure(config);
+
+				TransitionWriterConfig fileConfig = DefaultTransitionWriterConfig();
+				fileConfig.channels = channels;
+				fileConfig.sampleBytes = sampleBytes;
+				fileConfig.sampleRate = 1.0e6;
+				// Small steps, so that records cross segment boundaries.
+				fileConfig.reserveBytes = 0;
+
+				TransitionWriterCore writer;
+				BENCH_CHECK(writer.Create(path.c_str(), fileConfig) == NativeSuccess, failures);
+
+				std::vector<uInt8> scan((size_t)channels * block * sampleBytes);
+
+				for (size_t at = 0; at < samples; at += block) {
+					TransposeStrided(data.data() + at * sampleBytes, samples, scan.data(), channels,
+						channels, block, sampleBytes);
+					extractor.Process(scan.data(), block, DAQmx_Val_GroupByScanNumber);
+					BENCH_CHECK(writer.AppendFrom(extractor) == NativeSuccess, failures);
+
+					// Readable while it is written, up to the last append.
+					if (at == samples / 2) {
+						TransitionReaderCore partial;
+						BENCH_CHECK(partial.Open(path.c_str()) == NativeSuccess, failures);
+						BENCH_CHECK(!partial.IsComplete(), failures);
+						BENCH_CHECK(partial.Header()->samplesPerChannel == at + block, failures);
+						std::vector<DigitalTransition> some(expected.size());
+						const int32 n = partial.Read(some.data(), (uInt32)some.size());
+						BENCH_CHECK(n >= 0 && (uInt64)n == writer.TransitionCount(), failures);
+					}
+				}
+
+				const uInt64 dataBytes = writer.DataBytes();
+				BENCH_CHECK(writer.Close() == NativeSuccess, failures);
+
+				TransitionReaderCore reader;
+				BENCH_CHECK(reader.Open(path.c_str()) == NativeSuccess, failures);
+				BENCH_CHECK(reader.IsComplete(), failures);
+				BENCH_CHECK(reader.Header()->transitionCount == expected.size(), failures);
+				BENCH_CHECK(reader.Header()->samplesPerChannel == samples, failures);
+				BENCH_CHECK(std::filesystem::file_size(path)
+					== sizeof(TransitionFileHeader) + dataBytes, failures);
+
+				std::vector<DigitalTransition> got;
+				DigitalTransition batch[97];
+				int32 n;
+
+				while ((n = reader.Read(batch, 97)) > 0) {
+					got.insert(got.end(), batch, batch + n);
+				}
+				BENCH_CHECK(n == 0, failures);
+
+				const bool same = SameTransitions(got, expected);
+				BENCH_CHECK(same, failures);
+
+				reader.Rewind();
+				BENCH_CHECK(reader.Read(batch, 1) == 1 && batch[0].sampleIndex
+					== expected[0].sampleIndex, failures);
+				reader.Close();
+
+				const double raw = (double)channels * samples * sampleBytes;
+				std::printf("  file %u ch x U%-2u gap %6.0f: %6zu transitions, %7.0f bytes, "
+					"%.2f bytes each, %7.1fx smaller than raw%s\n", channels, sampleBytes * 8,
+					meanGap, expected.size(), (double)dataBytes,
+					(double)dataBytes / std::max<size_t>(1, expected.size()),
+					raw / (sizeof(TransitionFileHeader) + dataBytes), same ? "" : "  MISMATCH");
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			int CheckFileErrors() {
+
+				int failures = 0;
+				const std::string path = TempPath("DAQmxNativeBench_edges_bad.dtr");
+
+				TransitionWriterConfig config = DefaultTransitionWriterConfig();
+				config.channels = 2;
+
+				TransitionWriterCore writer;
+				BENCH_CHECK(writer.Create(path.c_str(), config) == NativeSuccess, failures);
+
+				DigitalTransition t[2] = {};
+				t[0].sampleIndex = 10;
+				t[0].value = 1;
+				t[1].sampleIndex = 5;
+				t[1].value = 4;
+
+				BENCH_CHECK(writer.Append(t, 2) == NativeErrorInvalidArgument, failures);
+				t[1].sampleIndex = 12;
+				t[1].channel = 2;
+				BENCH_CHECK(writer.Append(t, 2) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(writer.TransitionCount() == 0, failures);
+				t[1].channel = 1;
+				BENCH_CHECK(writer.Append(t, 2) == NativeSuccess, failures);
+				// No change: skipped.
+				t[1].sampleIndex = 20;
+				BENCH_CHECK(writer.Append(&t[1], 1) == NativeSuccess, failures);
+				BENCH_CHECK(writer.TransitionCount() == 2, failures);
+				writer.Close();
+
+				// Corrupt the last record: a line number above 31.
+				{
+					std::FILE* file = std::fopen(path.c_str(), "r+b");
+					std::fseek(file, -1, SEEK_END);
+					std::fputc(40, file);
+					std::fclose(file);
+				}
+
+				TransitionReaderCore reader;
+				BENCH_CHECK(reader.Open(path.c_str()) == NativeSuccess, failures);
+				DigitalTransition got[4];
+				BENCH_CHECK(reader.Read(got, 4) == 1, failures);
+				BENCH_CHECK(reader.Read(got, 4) == NativeErrorInvalidFile, failures);
+				reader.Close();
+
+				{
+					std::FILE* file = std::fopen(path.c_str(), "r+b");
+					std::fputc('X', file);
+					std::fclose(file);
+				}
+				BENCH_CHECK(reader.Open(path.c_str()) == NativeErrorInvalidFile, failures);
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			double MeasureScan(const std::vector<uInt8>& data, uInt32 sampleBytes,
+				std::vector<uInt32>& positions, double seconds) {
+
+				const size_t count = data.size() / sampleBytes;
+				uInt64 scanned = 0;
+				size_t found = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						found += FindChanges(data.data(), count, sampleBytes, 0, 0xFFFFFFFFu,
+							positions.data());
+						scanned += count;
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(found);
+				return scanned / SecondsSince(start);
+			}
+
+			// Loop of the kind a consumer of ReadDigitU32 writes today.
+			double MeasureLoop(const std::vector<uInt8>& data, std::vector<uInt32>& positions,
+				double seconds) {
+
+				const uInt32* x = reinterpret_cast<const uInt32*>(data.data());
+				const size_t count = data.size() / sizeof(uInt32);
+				uInt64 scanned = 0;
+				size_t found = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						uInt32 last = 0;
+						for (size_t i = 0; i < count; i++) {
+							if (x[i] != last) {
+								positions[found++ % positions.size()] = (uInt32)i;
+								last = x[i];
+							}
+						}
+						scanned += count;
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(found);
+				return scanned / SecondsSince(start);
+			}
+		}
+
+		int RunEdgeBench(const BenchOptions& options) {
+
+			int failures = 0;
+			std::mt19937 random(12);
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				int f = CheckKernels(random);
+
+				std::printf("  correctness %-7s: %d failed checks\n", SimdLevelName(level), f);
+				failures += f;
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			const int32 fillModes[] = { DAQmx_Val_GroupByScanNumber, DAQmx_Val_GroupByChannel };
+
+			for (int32 fillMode : fillModes) {
+				failures += CheckExtractor(1, 4, fillMode, 0xFFFFFFFFu, random);
+				failures += CheckExtractor(3, 1, fillMode, 0xFFFFFFFFu, random);
+				failures += CheckExtractor(4, 2, fillMode, 0x00F0u, random);
+				failures += CheckExtractor(8, 4, fillMode, 0x0F0F0F0Fu, random);
+			}
+			failures += CheckArguments();
+			failures += CheckDrops(random);
+
+			failures += CheckFile(1, 4, 100.0, random);
+			failures += CheckFile(1, 4, 10000.0, random);
+			failures += CheckFile(8, 1, 1000.0, random);
+			failures += CheckFile(2, 2, 2.0, random);
+			failures += CheckFileErrors();
+
+			const double seconds = options.quick ? 0.05 : 0.5;
+			std::vector<uInt8> words = SparseStream(1, 1 << 16, 4, 1000.0, random);
+			std::vector<uInt32> positions(1 << 16);
+
+			std::printf("  scan of %u U32 words, one change per 1000, GS/s:\n", 1u << 16);
+			std::printf("    %-7s   %6.2f\n", "loop", MeasureLoop(words, positions, seconds) / 1e9);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				std::printf("    %-7s   U8 %6.2f   U16 %6.2f   U32 %6.2f\n", SimdLevelName(level),
+					MeasureScan(SparseStream(1, 1 << 16, 1, 1000.0, random), 1, positions, seconds) / 1e9,
+					MeasureScan(SparseStream(1, 1 << 16, 2, 1000.0, random), 2, positions, seconds) / 1e9,
+					MeasureScan(words, 4, positions, seconds) / 1e9);
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			return failures;
+		}
+	}
+}
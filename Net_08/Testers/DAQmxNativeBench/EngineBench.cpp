@@ -0,0 +1,374 @@
+// Benchmarks the native continuous-acquisition engine against a callback
+// path that mimics the managed delegate route (callback -> separate read
+// into a freshly allocated array -> hand-off under a lock).
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AcquisitionEngineCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const uInt32 Channels = 8;
+			const float64 Rate = 250000.0;
+			const uInt32 BlockSamples = 1000;
+
+			TaskHandle CreateAITask(uInt32 channels, float64 rate) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("bench", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ai0:%u", channels - 1);
+				DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+					DAQmx_Val_ContSamps, 0);
+				return task;
+			}
+
+			template <typename T, typename TExpected>
+			int VerifyBlock(const BlockView& view, TExpected expected) {
+
+				const T* data = static_cast<const T*>(view.data);
+				const uInt32 n = view.samplesPerChannel;
+
+				for (uInt32 ch = 0; ch < view.channels; ch++) {
+					for (uInt32 i = 0; i < n; i++) {
+
+						const size_t index = (view.fillMode == DAQmx_Val_GroupByChannel)
+							? (size_t)ch * n + i : (size_t)i * view.channels + ch;
+
+						if (data[index] != expected(ch, view.firstSample + i)) {
+							return 1;
+						}
+					}
+				}
+				return 0;
+			}
+
+			int CheckDataIntegrity(int32 fillMode, SampleFormat format, uInt32 blocks,
+				int32 deliveredFillMode = FillModeAsRead) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = Channels;
+				config.samplesPerBlock = BlockSamples;
+				config.ringBlocks = 16;
+				config.format = format;
+				config.fillMode = fillMode;
+				config.deliveredFillMode = deliveredFillMode;
+				config.ownsTask = true;
+
+				BENCH_CHECK(engine.Attach(CreateAITask(Channels, Rate), config) == 0, failures);
+
+				// A release without a block held leaves the ring alone.
+				engine.ReleaseBlock();
+				BENCH_CHECK(engine.PendingBlocks() == 0, failures);
+
+				BENCH_CHECK(engine.Start() == 0, failures);
+
+				uInt32 consumed = 0;
+				uInt32 bad = 0;
+				uInt64 expectedFirst = 0;
+				uInt32 gaps = 0;
+				BlockView view;
+
+				while (consumed < blocks && engine.WaitAcquireBlock(view, 2000)) {
+
+					if (format == SampleFormat::Int16) {
+						bad += VerifyBlock<int16>(view, SimRawSample);
+					}
+					else {
+						bad += VerifyBlock<float64>(view, SimScaledSample);
+					}
+
+					// A gap is legal (dropped blocks) but must be block aligned.
+					if (view.firstSample != expectedFirst) {
+						gaps++;
+						BENCH_CHECK((view.firstSample - expectedFirst) % BlockSamples == 0,
+							failures);
+					}
+
+					expectedFirst = view.firstSample + view.samplesPerChannel;
+					BENCH_CHECK(view.status == 0, failures);
+					engine.ReleaseBlock();
+					engine.ReleaseBlock();
+					BENCH_CHECK(engine.PendingBlocks() <= config.ringBlocks, failures);
+					consumed++;
+				}
+
+				engine.Stop();
+				AcquisitionEngineCounters counters = engine.Counters();
+				engine.Detach();
+
+				std::printf("  integrity %s/%s%s: %u blocks checked, %u bad, "
+					"%llu dropped, %u gaps\n",
+					(format == SampleFormat::Int16) ? "I16" : "F64",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan",
+					(deliveredFillMode == FillModeAsRead) ? ""
+						: (deliveredFillMode == DAQmx_Val_GroupByChannel) ? "->ByChannel" : "->ByScan",
+					consumed, bad, (unsigned long long)counters.blocksDropped, gaps);
+
+				BENCH_CHECK(consumed == blocks, failures);
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(counters.readErrors == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			int CheckRealTime(SampleFormat format, double seconds) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = Channels;
+				config.samplesPerBlock = BlockSamples;
+				config.ringBlocks = 64;
+				config.format = format;
+				config.ownsTask = true;
+
+				BENCH_CHECK(engine.Attach(CreateAITask(Channels, Rate), config) == 0, failures);
+
+				const auto start = std::chrono::steady_clock::now();
+				BENCH_CHECK(engine.Start() == 0, failures);
+
+				uInt64 samples = 0;
+				double checksum = 0.0;
+				BlockView view;
+
+				while (SecondsSince(start) < seconds) {
+
+					if (!engine.WaitAcquireBlock(view, 100)) {
+						continue;
+					}
+
+					if (format == SampleFormat::Float64) {
+						checksum += static_cast<const float64*>(view.data)[0];
+					}
+					samples += view.samplesPerChannel;
+					engine.ReleaseBlock();
+				}
+
+				const double elapsed = SecondsSince(start);
+				engine.Stop();
+				AcquisitionEngineCounters counters = engine.Counters();
+				engine.Detach();
+				KeepAlive(checksum);
+
+				std::printf("  real time %s: %u ch x %.0f S/s for %.2f s -> %.0f S/s/ch "
+					"delivered, %llu blocks, %llu dropped, %llu read errors\n",
+					(format == SampleFormat::Int16) ? "I16" : "F64",
+					Channels, Rate, elapsed, samples / elapsed,
+					(unsigned long long)counters.blocksRead,
+					(unsigned long long)counters.blocksDropped,
+					(unsigned long long)counters.readErrors);
+
+				BENCH_CHECK(counters.blocksDropped == 0, failures);
+				BENCH_CHECK(counters.readErrors == 0, failures);
+				BENCH_CHECK(samples / elapsed > 0.8 * Rate, failures);
+				return failures;
+			}
+
+			// Mimics the managed route: the driver calls a delegate, the
+			// delegate allocates an array, calls the read API and queues it.
+			struct DelegatePath {
+				std::function<void(TaskHandle)> handler;
+				std::mutex mutex;
+				std::deque<std::unique_ptr<std::vector<float64>>> queue;
+
+				static int32 CVICALLBACK OnEveryNSamples(TaskHandle task, int32,
+					uInt32, void* data) {
+					static_cast<DelegatePath*>(data)->handler(task);
+					return 0;
+				}
+			};
+
+			double MeasureDelegatePath(double seconds) {
+
+				SimSetClockMode(SimClockMode::FreeRun);
+				TaskHandle task = CreateAITask(Channels, Rate);
+
+				DelegatePath path;
+				path.handler = [&path](TaskHandle t) {
+					std::unique_ptr<std::vector<float64>> block(
+						new std::vector<float64>(Channels * BlockSamples));
+					int32 read = 0;
+					DAQmxReadAnalogF64(t, BlockSamples, 1.0, DAQmx_Val_GroupByChannel,
+						block->data(), (uInt32)block->size(), &read, NULL);
+					std::lock_guard<std::mutex> lock(path.mutex);
+					// Same depth as the engine ring; older blocks are dropped.
+					if (path.queue.size() >= 64) {
+						path.queue.pop_front();
+					}
+					path.queue.push_back(std::move(block));
+				};
+
+				DAQmxRegisterEveryNSamplesEvent(task, DAQmx_Val_Acquired_Into_Buffer,
+					BlockSamples, 0, &DelegatePath::OnEveryNSamples, &path);
+
+				const auto start = std::chrono::steady_clock::now();
+				DAQmxStartTask(task);
+
+				uInt64 samples = 0;
+				double checksum = 0.0;
+
+				while (SecondsSince(start) < seconds) {
+
+					std::unique_ptr<std::vector<float64>> block;
+					{
+						std::lock_guard<std::mutex> lock(path.mutex);
+						if (!path.queue.empty()) {
+							block = std::move(path.queue.front());
+							path.queue.pop_front();
+						}
+					}
+
+					if (!block) {
+						std::this_thread::yield();
+						continue;
+					}
+
+					checksum += (*block)[0];
+					samples += BlockSamples;
+				}
+
+				const double elapsed = SecondsSince(start);
+				DAQmxClearTask(task);
+				KeepAlive(checksum);
+				return samples / elapsed;
+			}
+
+			double MeasureEnginePath(double seconds, uInt64& dropped) {
+
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = Channels;
+				config.samplesPerBlock = BlockSamples;
+				config.ringBlocks = 64;
+				config.format = SampleFormat::Float64;
+				config.ownsTask = true;
+				engine.Attach(CreateAITask(Channels, Rate), config);
+
+				const auto start = std::chrono::steady_clock::now();
+				engine.Start();
+
+				uInt64 samples = 0;
+				double checksum = 0.0;
+				BlockView view;
+
+				while (SecondsSince(start) < seconds) {
+
+					if (!engine.TryAcquireBlock(view)) {
+						std::this_thread::yield();
+						continue;
+					}
+
+					checksum += static_cast<const float64*>(view.data)[0];
+					samples += view.samplesPerChannel;
+					engine.ReleaseBlock();
+				}
+
+				const double elapsed = SecondsSince(start);
+				engine.Stop();
+				dropped = engine.Counters().blocksDropped;
+				engine.Detach();
+				KeepAlive(checksum);
+				return samples / elapsed;
+			}
+
+			// Engines destroyed while the driver keeps calling the callback
+			// of a task that runs on: a call picked before the event was
+			// unregistered must not reach the freed engine.
+			int CheckDetachInFlight(uInt32 rounds) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = 1;
+				config.samplesPerBlock = 10;
+				config.ringBlocks = 4;
+				config.format = SampleFormat::Int16;
+				config.ownsTask = false;
+
+				// Every call lands after the engine it was picked for is gone.
+				SimSetCallbackDelay(500);
+				TaskHandle task = CreateAITask(config.channels, 100000.0);
+				BENCH_CHECK(DAQmxStartTask(task) == 0, failures);
+
+				uInt32 attached = 0;
+
+				for (uInt32 i = 0; i < rounds; i++) {
+
+					AcquisitionEngineCore* engine = new AcquisitionEngineCore();
+					attached += (engine->Attach(task, config) == 0) ? 1 : 0;
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+					delete engine;
+				}
+
+				DAQmxStopTask(task);
+				DAQmxClearTask(task);
+				SimSetCallbackDelay(0);
+
+				std::printf("  detach in flight: %u of %u engines attached to a running task\n",
+					attached, rounds);
+
+				BENCH_CHECK(attached == rounds, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+		}
+
+		int RunEngineBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const uInt32 blocks = options.quick ? 200 : 2000;
+			const double seconds = options.quick ? 0.5 : 3.0;
+
+			failures += CheckDataIntegrity(DAQmx_Val_GroupByChannel, SampleFormat::Int16, blocks);
+			failures += CheckDataIntegrity(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16, blocks);
+			failures += CheckDataIntegrity(DAQmx_Val_GroupByChannel, SampleFormat::Float64, blocks);
+			failures += CheckDataIntegrity(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16, blocks,
+				DAQmx_Val_GroupByChannel);
+			failures += CheckDataIntegrity(DAQmx_Val_GroupByChannel, SampleFormat::Float64, blocks,
+				DAQmx_Val_GroupByScanNumber);
+
+			failures += CheckRealTime(SampleFormat::Float64, seconds);
+			failures += CheckRealTime(SampleFormat::Int16, seconds);
+			failures += CheckDetachInFlight(options.quick ? 200 : 2000);
+
+			uInt64 dropped = 0;
+			const double delegateRate = MeasureDelegatePath(seconds);
+			const double engineRate = MeasureEnginePath(seconds, dropped);
+
+			std::printf("  free run F64 %u ch: delegate path %.1f MS/s/ch, "
+				"engine %.1f MS/s/ch delivered (%llu blocks dropped by a "
+				"saturated consumer)\n",
+				Channels, delegateRate / 1e6, engineRate / 1e6,
+				(unsigned long long)dropped);
+
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,480 @@
+// Checks the synchronized acquisition group (AcquisitionGroupCore): tasks on
+// several simulated devices sharing the sample clock and start trigger of
+// the first, merged into frames aligned by sample index. Verifies every
+// sample of every member against the index of the frame, shows what the
+// routing and the start order buy on raw tasks, and measures the merge.
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AcquisitionGroupCore.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const float64 Rate = 100000.0;
+			const uInt32 BlockSamples = 1000;
+
+			const char* const ClockTerminal = "/SimDev1/PFI5";
+			const char* const TriggerTerminal = "/SimDev1/PFI6";
+
+			// Devices of different widths, so that the frame channels of a
+			// member do not start at a multiple of the others.
+			const char* const MemberChannels[] = {
+				"SimDev1/ai0:3", "SimDev2/ai0:1", "SimDev3/ai0:2"
+			};
+			const uInt32 MemberCount = 3;
+
+			AcquisitionGroupConfig MakeConfig(int32 fillMode, SampleFormat format) {
+
+				AcquisitionGroupConfig config = DefaultAcquisitionGroupConfig();
+				config.sampleRate = Rate;
+				config.samplesPerBlock = BlockSamples;
+				config.ringBlocks = 16;
+				config.frameCapacity = 16;
+				config.format = format;
+				config.fillMode = fillMode;
+				std::strcpy(config.clockTerminal, ClockTerminal);
+				std::strcpy(config.triggerTerminal, TriggerTerminal);
+				return config;
+			}
+
+			int AddMembers(AcquisitionGroupCore& group) {
+
+				int failures = 0;
+
+				for (uInt32 m = 0; m < MemberCount; m++) {
+					BENCH_CHECK(group.AddMember(MemberChannels[m], DAQmx_Val_Cfg_Default,
+						-10.0, 10.0) == (int32)m, failures);
+				}
+				return failures;
+			}
+
+			// Every channel of every member must hold the samples of the
+			// frame index: that is what a shared clock and trigger give.
+			template <typename T, typename TExpected>
+			uInt32 VerifyFrame(const AcquisitionGroupCore& group, const FrameView& view,
+				TExpected expected) {
+
+				const T* data = static_cast<const T*>(view.data);
+				const uInt32 n = view.samplesPerChannel;
+				uInt32 g = 0;
+				uInt32 bad = 0;
+
+				for (uInt32 m = 0; m < group.MemberCount(); m++) {
+					for (uInt32 c = 0; c < group.MemberChannels(m); c++, g++) {
+						for (uInt32 i = 0; i < n; i++) {
+
+							const size_t index = (view.fillMode == DAQmx_Val_GroupByChannel)
+								? (size_t)g * n + i : (size_t)i * view.channels + g;
+
+							if (data[index] != expected(c, view.firstSample + i)) {
+								bad++;
+							}
+						}
+					}
+				}
+				return bad;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+
+				{
+					AcquisitionGroupCore group;
+					AcquisitionGroupConfig config = MakeConfig(DAQmx_Val_GroupByScanNumber,
+						SampleFormat::Int16);
+					FrameView view;
+
+					BENCH_CHECK(group.Configure(config) == NativeErrorInvalidArgument, failures);
+					BENCH_CHECK(group.Start() == NativeErrorInvalidState, failures);
+					BENCH_CHECK(group.AddMember(NULL, DAQmx_Val_Cfg_Default, -10.0, 10.0)
+						== NativeErrorInvalidArgument, failures);
+					BENCH_CHECK(group.AddMember("", DAQmx_Val_Cfg_Default, -10.0, 10.0)
+						== NativeErrorInvalidArgument, failures);
+					BENCH_CHECK(!group.TryAcquireFrame(view), failures);
+
+					failures += AddMembers(group);
+					BENCH_CHECK(group.MemberCount() == MemberCount, failures);
+					BENCH_CHECK(group.MemberChannels(0) == 4, failures);
+					BENCH_CHECK(group.MemberChannels(1) == 2, failures);
+					BENCH_CHECK(group.MemberTask(MemberCount) == NULL, failures);
+
+					// Several members cannot share anything without terminals.
+					config.clockTerminal[0] = '\0';
+					BENCH_CHECK(group.Configure(config) == NativeErrorInvalidArgument, failures);
+					config = MakeConfig(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16);
+					config.triggerTerminal[0] = '\0';
+					BENCH_CHECK(group.Configure(config) == NativeErrorInvalidArgument, failures);
+
+					config = MakeConfig(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16);
+					config.samplesPerBlock = 0;
+					BENCH_CHECK(group.Configure(config) == NativeErrorInvalidArgument, failures);
+					config = MakeConfig(12345, SampleFormat::Int16);
+					BENCH_CHECK(group.Configure(config) == NativeErrorInvalidArgument, failures);
+					config = MakeConfig(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16);
+					config.frameCapacity = 1;
+					BENCH_CHECK(group.Configure(config) == NativeErrorInvalidArgument, failures);
+					config = MakeConfig(DAQmx_Val_GroupByScanNumber, (SampleFormat)99);
+					BENCH_CHECK(group.Configure(config) == NativeErrorUnsupportedFormat, failures);
+
+					config = MakeConfig(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16);
+					BENCH_CHECK(group.Configure(config) == 0, failures);
+					BENCH_CHECK(group.AddMember("SimDev4/ai0", DAQmx_Val_Cfg_Default,
+						-10.0, 10.0) == NativeErrorInvalidState, failures);
+					BENCH_CHECK(group.Start() == 0, failures);
+					BENCH_CHECK(group.Start() == NativeErrorAlreadyRunning, failures);
+					BENCH_CHECK(group.Configure(config) == NativeErrorAlreadyRunning, failures);
+					BENCH_CHECK(group.Stop() == 0, failures);
+				}
+
+				{
+					// A single member needs no routing.
+					AcquisitionGroupCore group;
+					AcquisitionGroupConfig config = MakeConfig(DAQmx_Val_GroupByChannel,
+						SampleFormat::Int16);
+					config.clockTerminal[0] = '\0';
+					config.triggerTerminal[0] = '\0';
+
+					BENCH_CHECK(group.AddMember("SimDev1/ai0:1", DAQmx_Val_Cfg_Default,
+						-10.0, 10.0) == 0, failures);
+					BENCH_CHECK(group.Configure(config) == 0, failures);
+				}
+
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				std::printf("  arguments: %d failures\n", failures);
+				return failures;
+			}
+
+			int CheckIntegrity(int32 fillMode, SampleFormat format, uInt32 frames,
+				bool slowConsumer) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				AcquisitionGroupCore group;
+				AcquisitionGroupConfig config = MakeConfig(fillMode, format);
+
+				// A consumer that falls behind makes the member engines drop
+				// blocks independently of each other.
+				if (slowConsumer) {
+					config.ringBlocks = 4;
+					config.frameCapacity = 4;
+				}
+
+				failures += AddMembers(group);
+				BENCH_CHECK(group.Configure(config) == 0, failures);
+				BENCH_CHECK(group.Start() == 0, failures);
+
+				uInt32 consumed = 0;
+				uInt32 bad = 0;
+				uInt32 misaligned = 0;
+				uInt64 expectedSequence = 0;
+				uInt64 previousFirst = 0;
+				FrameView view;
+
+				while (consumed < frames && group.WaitAcquireFrame(view, 2000)) {
+
+					bad += (format == SampleFormat::Int16)
+						? VerifyFrame<int16>(group, view, SimRawSample)
+						: VerifyFrame<float64>(group, view, SimScaledSample);
+
+					if (view.firstSample % BlockSamples != 0
+						|| (consumed > 0 && view.firstSample <= previousFirst)) {
+						misaligned++;
+					}
+
+					BENCH_CHECK(view.channels == 9, failures);
+					BENCH_CHECK(view.status == 0, failures);
+					BENCH_CHECK(view.sequence == expectedSequence, failures);
+
+					previousFirst = view.firstSample;
+					expectedSequence = view.sequence + 1;
+					group.ReleaseFrame();
+					consumed++;
+
+					if (slowConsumer && consumed % 8 == 0) {
+						std::this_thread::sleep_for(std::chrono::milliseconds(5));
+					}
+				}
+
+				BENCH_CHECK(group.Stop() == 0, failures);
+				BENCH_CHECK(!group.IsRunning(), failures);
+				AcquisitionGroupCounters counters = group.Counters();
+
+				std::printf("  integrity %s/%s%s: %u frames checked, %u bad, "
+					"%llu member blocks dropped, %llu discarded, %llu frames dropped\n",
+					(format == SampleFormat::Int16) ? "I16" : "F64",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan",
+					slowConsumer ? " (slow consumer)" : "",
+					consumed, bad, (unsigned long long)counters.memberBlocksDropped,
+					(unsigned long long)counters.blocksDiscarded,
+					(unsigned long long)counters.framesDropped);
+
+				BENCH_CHECK(consumed == frames, failures);
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(misaligned == 0, failures);
+				BENCH_CHECK(counters.lastError == 0, failures);
+				return failures;
+			}
+
+			/**
+			* One member read comes back short: its frame must end where that
+			* block does and nothing past it may be written. Every frame is
+			* overwritten with a pattern before it is released, so the slot
+			* the short frame reuses shows what the merge touched.
+			*/
+			int CheckShortBlock(int32 fillMode) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				const uInt32 shortSamples = 600;
+				const uInt8 pattern = 0xA5;
+
+				AcquisitionGroupCore group;
+				AcquisitionGroupConfig config = MakeConfig(fillMode, SampleFormat::Int16);
+
+				failures += AddMembers(group);
+				BENCH_CHECK(group.Configure(config) == 0, failures);
+
+				// Late enough for the frame slot to have been used before.
+				const uInt64 shortFirst = 2ull * config.frameCapacity * BlockSamples;
+				BENCH_CHECK(SimShortenRead(group.MemberTask(1), shortFirst, shortSamples) == 0,
+					failures);
+				BENCH_CHECK(group.Start() == 0, failures);
+
+				bool found = false;
+				uInt32 bad = 0;
+				uInt32 overwritten = 0;
+				FrameView view;
+
+				while (!found && group.WaitAcquireFrame(view, 2000)) {
+
+					const size_t frameBytes = (size_t)view.channels * BlockSamples * sizeof(int16);
+					uInt8* data = static_cast<uInt8*>(const_cast<void*>(view.data));
+
+					if (view.firstSample == shortFirst) {
+
+						found = true;
+						BENCH_CHECK(view.samplesPerChannel == shortSamples, failures);
+						BENCH_CHECK(view.status == DAQmxErrorSamplesNotYetAvailable, failures);
+						BENCH_CHECK(view.sequence >= config.frameCapacity, failures);
+						bad = VerifyFrame<int16>(group, view, SimRawSample);
+
+						const size_t used = (size_t)view.channels * view.samplesPerChannel * sizeof(int16);
+						for (size_t b = used; b < frameBytes; b++) {
+							if (data[b] != pattern) {
+								overwritten++;
+							}
+						}
+					}
+					else {
+						BENCH_CHECK(view.samplesPerChannel == BlockSamples, failures);
+					}
+
+					std::memset(data, pattern, frameBytes);
+					group.ReleaseFrame();
+				}
+
+				BENCH_CHECK(group.Stop() == 0, failures);
+
+				std::printf("  short block %s: %s, %u bad, %u bytes written past the frame\n",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan",
+					found ? "merged" : "missing", bad, overwritten);
+
+				BENCH_CHECK(found, failures);
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(overwritten == 0, failures);
+				return failures;
+			}
+
+			TaskHandle CreateRoutedTask(const char* channels, const char* clockSource,
+				const char* triggerSource) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("", &task);
+				DAQmxCreateAIVoltageChan(task, channels, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, clockSource, Rate, DAQmx_Val_Rising,
+					DAQmx_Val_ContSamps, 10 * BlockSamples);
+
+				if (triggerSource != NULL) {
+					DAQmxCfgDigEdgeStartTrig(task, triggerSource, DAQmx_Val_Rising);
+				}
+				return task;
+			}
+
+			// Reads one block of the slave and returns the number of its
+			// samples that differ from those of the same index on the master.
+			uInt32 SlaveOffsetSamples(TaskHandle slave, int32* status) {
+
+				std::vector<int16> data(BlockSamples);
+				int32 read = 0;
+				*status = DAQmxReadBinaryI16(slave, BlockSamples, 0.2,
+					DAQmx_Val_GroupByChannel, data.data(), BlockSamples, &read, NULL);
+
+				uInt32 differ = 0;
+				for (int32 i = 0; i < read; i++) {
+					if (data[i] != SimRawSample(0, (uInt64)i)) {
+						differ++;
+					}
+				}
+				return differ;
+			}
+
+			/**
+			* What the group does for the caller, done by hand on raw tasks: a
+			* slave on the exported clock but without the trigger, or armed
+			* only after the master started, is not aligned with it.
+			*/
+			int CheckRouting() {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				enum Case { Group, NoTrigger, MasterFirst };
+				const char* const names[] = {
+					"trigger, slave started first", "no trigger, master started first",
+					"trigger, master started first" };
+
+				for (int k = Group; k <= MasterFirst; k++) {
+
+					TaskHandle master = CreateRoutedTask("SimDev1/ai0", "", NULL);
+					BENCH_CHECK(DAQmxExportSignal(master, DAQmx_Val_SampleClock, ClockTerminal) == 0,
+						failures);
+					BENCH_CHECK(DAQmxExportSignal(master, DAQmx_Val_StartTrigger, TriggerTerminal) == 0,
+						failures);
+
+					TaskHandle slave = CreateRoutedTask("SimDev2/ai0", ClockTerminal,
+						(k == NoTrigger) ? NULL : TriggerTerminal);
+
+					if (k == Group) {
+						DAQmxStartTask(slave);
+						DAQmxStartTask(master);
+					}
+					else {
+						// Let the shared clock tick before the slave joins.
+						DAQmxStartTask(master);
+						std::this_thread::sleep_for(std::chrono::milliseconds(20));
+						DAQmxStartTask(slave);
+					}
+
+					// The master only ticks while its buffer is drained.
+					std::atomic<bool> draining(true);
+					std::thread drain([&]() {
+						std::vector<int16> data(BlockSamples);
+						int32 read = 0;
+						while (draining.load()) {
+							DAQmxReadBinaryI16(master, BlockSamples, 0.01,
+								DAQmx_Val_GroupByChannel, data.data(), BlockSamples, &read, NULL);
+						}
+					});
+
+					int32 status = 0;
+					const uInt32 differ = SlaveOffsetSamples(slave, &status);
+					draining.store(false);
+					drain.join();
+
+					std::printf("  routing %-32s: status %d, %u/%u samples off the master\n",
+						names[k], (int)status, differ, BlockSamples);
+
+					if (k == Group) {
+						BENCH_CHECK(status == 0 && differ == 0, failures);
+					}
+					else if (k == NoTrigger) {
+						BENCH_CHECK(status == 0 && differ > 0, failures);
+					}
+					else {
+						// The trigger went by before the slave was armed.
+						BENCH_CHECK(status == DAQmxErrorSamplesNotYetAvailable, failures);
+					}
+
+					DAQmxClearTask(slave);
+					DAQmxClearTask(master);
+				}
+
+				BENCH_CHECK(DAQmxCfgDigEdgeStartTrig(NULL, TriggerTerminal, DAQmx_Val_Rising) < 0,
+					failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			int MeasureMerge(int32 fillMode, uInt32 frames) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				AcquisitionGroupCore group;
+				AcquisitionGroupConfig config = MakeConfig(fillMode, SampleFormat::Int16);
+				config.ringBlocks = 64;
+				config.frameCapacity = 64;
+
+				failures += AddMembers(group);
+				BENCH_CHECK(group.Configure(config) == 0, failures);
+
+				const auto start = std::chrono::steady_clock::now();
+				BENCH_CHECK(group.Start() == 0, failures);
+
+				uInt32 consumed = 0;
+				uInt64 checksum = 0;
+				FrameView view;
+
+				while (consumed < frames && group.WaitAcquireFrame(view, 2000)) {
+					checksum += static_cast<const uInt16*>(view.data)[0];
+					group.ReleaseFrame();
+					consumed++;
+				}
+
+				const double seconds = SecondsSince(start);
+				group.Stop();
+				KeepAlive(checksum);
+
+				const double samples = (double)consumed * BlockSamples * view.channels;
+				std::printf("  merge %s: %u frames of %u x %u, %.1f Mframe-samples/s\n",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan  ",
+					consumed, view.channels, BlockSamples, samples / seconds / 1e6);
+
+				BENCH_CHECK(consumed == frames, failures);
+				return failures;
+			}
+		}
+
+		int RunGroupBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const uInt32 frames = options.quick ? 200 : 5000;
+
+			std::printf("Acquisition group: %u devices, %u channels,"
+				" shared clock and start trigger\n", MemberCount, 9u);
+
+			failures += CheckArguments();
+			failures += CheckRouting();
+
+			failures += CheckIntegrity(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16, frames, false);
+			failures += CheckIntegrity(DAQmx_Val_GroupByChannel, SampleFormat::Int16, frames, false);
+			failures += CheckIntegrity(DAQmx_Val_GroupByScanNumber, SampleFormat::Float64, frames, false);
+			failures += CheckIntegrity(DAQmx_Val_GroupByScanNumber, SampleFormat::Int16, frames, true);
+			failures += CheckShortBlock(DAQmx_Val_GroupByScanNumber);
+			failures += CheckShortBlock(DAQmx_Val_GroupByChannel);
+
+			failures += MeasureMerge(DAQmx_Val_GroupByChannel, frames * 5);
+			failures += MeasureMerge(DAQmx_Val_GroupByScanNumber, frames * 5);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
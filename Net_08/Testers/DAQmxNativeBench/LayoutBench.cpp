@@ -0,0 +1,191 @@
+// Checks the fill mode conversions (TransposeKernels) against a plain loop
+// for every element size, SIMD level and a range of ragged shapes, then
+// measures them against the per-element loop they replace.
+
+#include <cstring>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/CpuFeatures.h"
+#include "Native/TransposeKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+
+		namespace {
+
+			void NaiveDeinterleave(const uInt8* src, uInt8* dst, uInt32 channels,
+				uInt32 samples, size_t size) {
+
+				for (uInt32 i = 0; i < samples; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						std::memcpy(dst + ((size_t)ch * samples + i) * size,
+							src + ((size_t)i * channels + ch) * size, size);
+					}
+				}
+			}
+
+			// Loop of the kind the managed code uses today, for one element type.
+			template <typename T>
+			void LoopDeinterleave(const T* src, T* dst, uInt32 channels, uInt32 samples) {
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					for (uInt32 i = 0; i < samples; i++) {
+						dst[(size_t)ch * samples + i] = src[(size_t)i * channels + ch];
+					}
+				}
+			}
+
+			int CheckShape(uInt32 channels, uInt32 samples, size_t size) {
+
+				const size_t bytes = (size_t)channels * samples * size;
+				std::vector<uInt8> scan(bytes), expected(bytes), channel(bytes), back(bytes);
+
+				for (size_t i = 0; i < bytes; i++) {
+					scan[i] = (uInt8)(i * 131u + (i >> 8) * 7u + 1u);
+				}
+
+				NaiveDeinterleave(scan.data(), expected.data(), channels, samples, size);
+				std::memset(channel.data(), 0xCD, bytes);
+
+				if (!Deinterleave(scan.data(), channel.data(), channels, samples, size)) {
+					return 1;
+				}
+				if (channel != expected) {
+					return 1;
+				}
+				if (!Interleave(channel.data(), back.data(), channels, samples, size)) {
+					return 1;
+				}
+				return (back == scan) ? 0 : 1;
+			}
+
+			int CheckConvertFillMode() {
+
+				int failures = 0;
+				const uInt32 channels = 3;
+				const uInt32 samples = 5;
+				std::vector<int32> src(channels * samples), dst(channels * samples);
+
+				for (size_t i = 0; i < src.size(); i++) {
+					src[i] = (int32)i;
+				}
+
+				BENCH_CHECK(ConvertFillMode(src.data(), DAQmx_Val_GroupByScanNumber, dst.data(),
+					DAQmx_Val_GroupByScanNumber, channels, samples, sizeof(int32)), failures);
+				BENCH_CHECK(dst == src, failures);
+
+				BENCH_CHECK(ConvertFillMode(src.data(), DAQmx_Val_GroupByScanNumber, dst.data(),
+					DAQmx_Val_GroupByChannel, channels, samples, sizeof(int32)), failures);
+				BENCH_CHECK(dst[1] == 3 && dst[samples] == 1, failures);
+
+				BENCH_CHECK(!ConvertFillMode(src.data(), DAQmx_Val_GroupByScanNumber, dst.data(),
+					DAQmx_Val_GroupByChannel, channels, samples, 3), failures);
+				return failures;
+			}
+
+			template <typename T>
+			double MeasureLoop(uInt32 channels, uInt32 samples, double seconds) {
+
+				std::vector<T> src((size_t)channels * samples, (T)1), dst(src.size());
+				uInt64 moved = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						LoopDeinterleave(src.data(), dst.data(), channels, samples);
+						moved += src.size();
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(dst[dst.size() / 2]);
+				return moved / SecondsSince(start);
+			}
+
+			template <typename T>
+			double MeasureKernel(uInt32 channels, uInt32 samples, double seconds) {
+
+				std::vector<T> src((size_t)channels * samples, (T)1), dst(src.size());
+				uInt64 moved = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						Deinterleave(src.data(), dst.data(), channels, samples, sizeof(T));
+						moved += src.size();
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(dst[dst.size() / 2]);
+				return moved / SecondsSince(start);
+			}
+		}
+
+		int RunLayoutBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+			const size_t sizes[] = { 1, 2, 4, 8 };
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				int f = 0;
+
+				for (size_t size : sizes) {
+					for (uInt32 channels = 1; channels <= 17; channels++) {
+						for (uInt32 samples : { 1u, 2u, 15u, 16u, 17u, 63u, 64u, 65u, 1000u }) {
+							f += CheckShape(channels, samples, size);
+						}
+					}
+					f += CheckShape(32, 4096, size);
+					f += CheckShape(4096, 33, size);
+				}
+				f += CheckConvertFillMode();
+
+				std::printf("  correctness %-7s: %d failed checks\n", SimdLevelName(level), f);
+				failures += f;
+			}
+
+			const uInt32 channels = 16;
+			const uInt32 samples = 10000;
+			const double seconds = options.quick ? 0.05 : 0.5;
+
+			std::printf("  deinterleave %u ch x %u samples, MS/s:\n", channels, samples);
+			std::printf("    %-7s   U8 %6.0f   I16 %6.0f   I32 %6.0f   F64 %6.0f\n", "loop",
+				MeasureLoop<uInt8>(channels, samples, seconds) / 1e6,
+				MeasureLoop<int16>(channels, samples, seconds) / 1e6,
+				MeasureLoop<int32>(channels, samples, seconds) / 1e6,
+				MeasureLoop<float64>(channels, samples, seconds) / 1e6);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+
+				std::printf("    %-7s   U8 %6.0f   I16 %6.0f   I32 %6.0f   F64 %6.0f\n",
+					SimdLevelName(level),
+					MeasureKernel<uInt8>(channels, samples, seconds) / 1e6,
+					MeasureKernel<int16>(channels, samples, seconds) / 1e6,
+					MeasureKernel<int32>(channels, samples, seconds) / 1e6,
+					MeasureKernel<float64>(channels, samples, seconds) / 1e6);
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,488 @@
+// Checks the analog output streaming engine (AnalogOutputEngineCore): every
+// generated sample of a non-repeating waveform, in both formats and
+// layouts, real-time streaming without underruns, and what happens when the
+// producer stalls without regeneration, with it, and with held values.
+// Compares its throughput with writing straight from the producer thread.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AnalogOutputEngineCore.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const uInt32 BlockSamples = 1000;
+
+			TaskHandle CreateAOTask(uInt32 channels, float64 rate) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("bench", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ao0:%u", channels - 1);
+				DAQmxCreateAOVoltageChan(task, physical, "", -10.0, 10.0,
+					DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+					DAQmx_Val_ContSamps, 0);
+				return task;
+			}
+
+			// Never repeats within a run, so any repeated, missing or
+			// misplaced sample shows.
+			float64 ExpectedValue(uInt32 channel, uInt64 index, SampleFormat format) {
+
+				if (format == SampleFormat::Int16) {
+					return (float64)(int16)(uInt16)(index * 3 + channel * 5000);
+				}
+				return (float64)channel * 1.0e9 + (float64)index;
+			}
+
+			template <typename T>
+			void FillBlock(T* block, uInt32 channels, int32 fillMode, uInt64 first,
+				SampleFormat format) {
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					for (uInt32 i = 0; i < BlockSamples; i++) {
+
+						const size_t index = (fillMode == DAQmx_Val_GroupByChannel)
+							? (size_t)ch * BlockSamples + i : (size_t)i * channels + ch;
+						block[index] = (T)ExpectedValue(ch, first + i, format);
+					}
+				}
+			}
+
+			void ProduceBlock(AnalogOutputEngineCore& engine, std::vector<uint8_t>& scratch,
+				uInt64 block, bool inPlace) {
+
+				const AnalogOutputEngineConfig& config = engine.Config();
+				void* target = scratch.data();
+
+				if (inPlace) {
+					while ((target = engine.BeginWriteBlock()) == nullptr) {
+						std::this_thread::sleep_for(std::chrono::microseconds(200));
+					}
+				}
+
+				if (config.format == SampleFormat::Int16) {
+					FillBlock(static_cast<int16*>(target), config.channels, config.fillMode,
+						block * BlockSamples, config.format);
+				}
+				else {
+					FillBlock(static_cast<float64*>(target), config.channels, config.fillMode,
+						block * BlockSamples, config.format);
+				}
+
+				if (inPlace) {
+					engine.CommitWriteBlock();
+				}
+				else {
+					while (engine.WriteBlock(scratch.data(), 1000) == NativeErrorTimeout) {}
+				}
+			}
+
+			bool WaitGenerated(const AnalogOutputEngineCore& engine, uInt64 samples,
+				double seconds) {
+
+				const auto start = std::chrono::steady_clock::now();
+
+				while (engine.SamplesGenerated() < samples) {
+					if (SecondsSince(start) > seconds) {
+						return false;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				return true;
+			}
+
+			// Scans of `record` from `first` on that differ from the
+			// waveform, which starts at sample `index`.
+			uInt64 CountBad(const std::vector<float64>& record, uInt32 channels,
+				uInt64 first, uInt64 scans, uInt64 index, SampleFormat format) {
+
+				uInt64 bad = 0;
+
+				for (uInt64 k = 0; k < scans; k++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+
+						const size_t at = (size_t)(first + k) * channels + ch;
+
+						if (at >= record.size()
+							|| record[at] != ExpectedValue(ch, index + k, format)) {
+							bad++;
+						}
+					}
+				}
+				return bad;
+			}
+
+			AnalogOutputEngineConfig MakeConfig(uInt32 channels, SampleFormat format,
+				int32 fillMode) {
+
+				AnalogOutputEngineConfig config = DefaultAnalogOutputEngineConfig();
+				config.channels = channels;
+				config.samplesPerBlock = BlockSamples;
+				config.ringBlocks = 16;
+				config.bufferBlocks = 8;
+				config.format = format;
+				config.fillMode = fillMode;
+				config.ownsTask = true;
+				return config;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				AnalogOutputEngineCore engine;
+				AnalogOutputEngineConfig config = MakeConfig(2, SampleFormat::Float64,
+					DAQmx_Val_GroupByChannel);
+				std::vector<float64> block(2 * BlockSamples);
+
+				BENCH_CHECK(engine.Start() == NativeErrorNotAttached, failures);
+				BENCH_CHECK(engine.WriteBlock(block.data(), 0) == NativeErrorNotAttached, failures);
+				BENCH_CHECK(engine.BeginWriteBlock() == nullptr, failures);
+				BENCH_CHECK(engine.Attach(NULL, config) == NativeErrorInvalidArgument, failures);
+
+				TaskHandle task = CreateAOTask(2, 10000.0);
+
+				config.bufferBlocks = 1;
+				BENCH_CHECK(engine.Attach(task, config) == NativeErrorInvalidArgument, failures);
+				config = MakeConfig(2, SampleFormat::Int32, DAQmx_Val_GroupByChannel);
+				BENCH_CHECK(engine.Attach(task, config) == NativeErrorUnsupportedFormat, failures);
+				config = MakeConfig(2, SampleFormat::Float64, 12345);
+				BENCH_CHECK(engine.Attach(task, config) == NativeErrorInvalidArgument, failures);
+
+				config = MakeConfig(2, SampleFormat::Float64, DAQmx_Val_GroupByChannel);
+				BENCH_CHECK(engine.Attach(task, config) == 0, failures);
+				BENCH_CHECK(engine.Attach(task, config) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(engine.WriteBlock(NULL, 0) == NativeErrorInvalidArgument, failures);
+
+				// A block begun but not committed is not published, and is
+				// handed out again.
+				void* begun = engine.BeginWriteBlock();
+				BENCH_CHECK(begun != nullptr && engine.PendingBlocks() == 0, failures);
+				BENCH_CHECK(engine.BeginWriteBlock() == begun, failures);
+
+				// Nothing to put in the device buffer yet.
+				BENCH_CHECK(engine.Start() == NativeErrorInvalidState, failures);
+
+				for (uInt32 k = 0; k < 16; k++) {
+					BENCH_CHECK(engine.WriteBlock(block.data(), 0) == 0, failures);
+				}
+				BENCH_CHECK(engine.FreeBlocks() == 0, failures);
+				BENCH_CHECK(engine.WriteBlock(block.data(), 10) == NativeErrorTimeout, failures);
+
+				BENCH_CHECK(engine.Detach() == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				std::printf("  arguments: %d failures\n", failures);
+				return failures;
+			}
+
+			int CheckIntegrity(SampleFormat format, int32 fillMode, bool inPlace, uInt32 blocks) {
+
+				int failures = 0;
+				const uInt32 channels = 4;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				AnalogOutputEngineCore engine;
+				AnalogOutputEngineConfig config = MakeConfig(channels, format, fillMode);
+				BENCH_CHECK(engine.Attach(CreateAOTask(channels, 100000.0), config) == 0, failures);
+
+				std::vector<uint8_t> scratch((size_t)channels * BlockSamples * sizeof(float64));
+
+				// Prefill, then produce while the device generates.
+				uInt64 produced = 0;
+				for (; produced < config.ringBlocks; produced++) {
+					ProduceBlock(engine, scratch, produced, inPlace);
+				}
+
+				BENCH_CHECK(engine.Start() == 0, failures);
+
+				for (; produced < blocks; produced++) {
+					ProduceBlock(engine, scratch, produced, inPlace);
+				}
+
+				const uInt64 samples = (uInt64)blocks * BlockSamples;
+				BENCH_CHECK(WaitGenerated(engine, samples, 10.0), failures);
+
+				BENCH_CHECK(engine.Stop() == 0, failures);
+				const std::vector<float64> record = SimGeneratedAnalog(engine.Task());
+				const uInt64 regenerated = SimRegeneratedSamples(engine.Task());
+				AnalogOutputEngineCounters counters = engine.Counters();
+				engine.Detach();
+
+				const uInt64 bad = CountBad(record, channels, 0, samples, 0, format);
+
+				std::printf("  integrity %s/%s%s: %llu scans generated, %llu bad, "
+					"%llu blocks written, %llu underruns\n",
+					(format == SampleFormat::Int16) ? "I16" : "F64",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "ByChannel" : "ByScan",
+					inPlace ? " in place" : "",
+					(unsigned long long)(record.size() / channels), (unsigned long long)bad,
+					(unsigned long long)counters.blocksWritten,
+					(unsigned long long)counters.underruns);
+
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(record.size() == samples * channels, failures);
+				BENCH_CHECK(counters.blocksWritten == blocks, failures);
+				BENCH_CHECK(counters.writeErrors == 0, failures);
+				BENCH_CHECK(regenerated == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			/**
+			* Streams at a real sample rate, the producer keeping ahead by
+			* the ring; nothing may underflow.
+			*/
+			int CheckRealTime(double seconds) {
+
+				int failures = 0;
+				const uInt32 channels = 2;
+				const float64 rate = 100000.0;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				AnalogOutputEngineCore engine;
+				AnalogOutputEngineConfig config = MakeConfig(channels, SampleFormat::Float64,
+					DAQmx_Val_GroupByScanNumber);
+				BENCH_CHECK(engine.Attach(CreateAOTask(channels, rate), config) == 0, failures);
+
+				std::vector<uint8_t> scratch((size_t)channels * BlockSamples * sizeof(float64));
+				const uInt64 blocks = (uInt64)(seconds * rate / BlockSamples);
+
+				uInt64 produced = 0;
+				for (; produced < config.ringBlocks; produced++) {
+					ProduceBlock(engine, scratch, produced, false);
+				}
+
+				BENCH_CHECK(engine.Start() == 0, failures);
+
+				for (; produced < blocks; produced++) {
+					ProduceBlock(engine, scratch, produced, false);
+				}
+
+				const uInt64 samples = blocks * BlockSamples;
+				BENCH_CHECK(WaitGenerated(engine, samples, seconds + 2.0), failures);
+				BENCH_CHECK(engine.Stop() == 0, failures);
+
+				const std::vector<float64> record = SimGeneratedAnalog(engine.Task());
+				AnalogOutputEngineCounters counters = engine.Counters();
+				engine.Detach();
+
+				const uInt64 bad = CountBad(record, channels, 0, samples, 0, SampleFormat::Float64);
+
+				std::printf("  real time: %u ch x %.0f S/s, %llu blocks, %llu bad scans, "
+					"%llu underruns, last error %d\n", channels, rate,
+					(unsigned long long)blocks, (unsigned long long)bad,
+					(unsigned long long)counters.underruns, (int)counters.lastError);
+
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(counters.lastError == 0, failures);
+				return failures;
+			}
+
+			enum class Stall { NoRegeneration, Regeneration, Hold };
+
+			/**
+			* The producer writes `first` blocks, stalls for longer than the
+			* device buffer lasts, then writes `first` more.
+			*/
+			int CheckStall(Stall mode) {
+
+				int failures = 0;
+				const uInt32 channels = 2;
+				const float64 rate = 100000.0;
+				const uInt32 first = 12;
+				SimSetClockMode(SimClockMode::RealTime);
+
+				AnalogOutputEngineCore engine;
+				AnalogOutputEngineConfig config = MakeConfig(channels, SampleFormat::Float64,
+					DAQmx_Val_GroupByChannel);
+				config.regeneration = (mode == Stall::Regeneration);
+				config.holdOnUnderrun = (mode == Stall::Hold);
+				BENCH_CHECK(engine.Attach(CreateAOTask(channels, rate), config) == 0, failures);
+
+				std::vector<uint8_t> scratch((size_t)channels * BlockSamples * sizeof(float64));
+
+				for (uInt64 k = 0; k < first; k++) {
+					ProduceBlock(engine, scratch, k, false);
+				}
+
+				BENCH_CHECK(engine.Start() == 0, failures);
+				BENCH_CHECK(WaitGenerated(engine, (uInt64)first * BlockSamples, 2.0), failures);
+
+				// 10 device buffers of 8 ms.
+				std::this_thread::sleep_for(std::chrono::milliseconds(80));
+
+				for (uInt64 k = first; k < 2 * first; k++) {
+					ProduceBlock(engine, scratch, k, false);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+				engine.Stop();
+				const std::vector<float64> record = SimGeneratedAnalog(engine.Task());
+				const uInt64 regenerated = SimRegeneratedSamples(engine.Task());
+				AnalogOutputEngineCounters counters = engine.Counters();
+				engine.Detach();
+
+				const uInt64 before = (uInt64)first * BlockSamples;
+				const uInt64 scans = record.size() / channels;
+				BENCH_CHECK(CountBad(record, channels, 0, before, 0, SampleFormat::Float64) == 0,
+					failures);
+				BENCH_CHECK(counters.underruns >= 1, failures);
+
+				const char* names[] = { "no regeneration", "regeneration", "hold" };
+				std::printf("  stall, %-15s: %llu scans generated, %llu underruns, "
+					"%llu regenerated (device %llu), %llu held blocks, last error %d\n",
+					names[(int)mode], (unsigned long long)scans,
+					(unsigned long long)counters.underruns,
+					(unsigned long long)counters.samplesRegenerated,
+					(unsigned long long)regenerated,
+					(unsigned long long)counters.blocksHeld, (int)counters.lastError);
+
+				if (mode == Stall::NoRegeneration) {
+					// The device stopped at the end of the data; the next
+					// write reports it.
+					BENCH_CHECK(scans == before, failures);
+					BENCH_CHECK(counters.lastError == DAQmxErrorGenStoppedToPreventRegenOfOldSamples,
+						failures);
+					BENCH_CHECK(regenerated == 0, failures);
+				}
+				else {
+					// The second half follows the repeated or held samples,
+					// intact.
+					uInt64 resumed = before;
+					while (resumed < scans && record[resumed * channels]
+						!= ExpectedValue(0, before, SampleFormat::Float64)) {
+						resumed++;
+					}
+					BENCH_CHECK(resumed > before && resumed < scans, failures);
+					BENCH_CHECK(CountBad(record, channels, resumed, before, before,
+						SampleFormat::Float64) == 0, failures);
+					BENCH_CHECK(counters.lastError == 0, failures);
+
+					if (mode == Stall::Hold) {
+						// Every sample in between repeats the last one written.
+						uInt64 wrong = 0;
+						for (uInt64 k = before; k < resumed; k++) {
+							for (uInt32 ch = 0; ch < channels; ch++) {
+								if (record[k * channels + ch]
+									!= ExpectedValue(ch, before - 1, SampleFormat::Float64)) {
+									wrong++;
+								}
+							}
+						}
+						BENCH_CHECK(wrong == 0, failures);
+					}
+				}
+
+				if (mode == Stall::Regeneration) {
+					BENCH_CHECK(regenerated > 0, failures);
+					BENCH_CHECK(counters.samplesRegenerated > 0
+						&& counters.samplesRegenerated <= regenerated, failures);
+				}
+
+				if (mode == Stall::Hold) {
+					BENCH_CHECK(counters.blocksHeld > 0, failures);
+					BENCH_CHECK(regenerated == 0, failures);
+				}
+
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			/**
+			* Free-run throughput: the engine against writing each block from
+			* the producer thread itself.
+			*/
+			int MeasureThroughput(uInt32 blocks) {
+
+				int failures = 0;
+				const uInt32 channels = 8;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				std::vector<float64> block((size_t)channels * BlockSamples);
+				FillBlock(block.data(), channels, DAQmx_Val_GroupByScanNumber, 0,
+					SampleFormat::Float64);
+
+				double direct;
+				{
+					TaskHandle task = CreateAOTask(channels, 1.0e6);
+					DAQmxCfgOutputBuffer(task, 8 * BlockSamples);
+					DAQmxSetWriteRegenMode(task, DAQmx_Val_DoNotAllowRegen);
+
+					const auto start = std::chrono::steady_clock::now();
+					int32 written = 0;
+
+					for (uInt32 k = 0; k < blocks; k++) {
+						if (k == 8) {
+							DAQmxStartTask(task);
+						}
+						BENCH_CHECK(DAQmxWriteAnalogF64(task, BlockSamples, FALSE, 10.0,
+							DAQmx_Val_GroupByScanNumber, block.data(), &written, NULL) == 0, failures);
+					}
+					direct = (double)blocks * BlockSamples / SecondsSince(start);
+					DAQmxClearTask(task);
+				}
+
+				double engineRate;
+				{
+					AnalogOutputEngineCore engine;
+					AnalogOutputEngineConfig config = MakeConfig(channels, SampleFormat::Float64,
+						DAQmx_Val_GroupByScanNumber);
+					config.ringBlocks = 64;
+					BENCH_CHECK(engine.Attach(CreateAOTask(channels, 1.0e6), config) == 0, failures);
+
+					const auto start = std::chrono::steady_clock::now();
+
+					for (uInt32 k = 0; k < blocks; k++) {
+						if (k == config.ringBlocks) {
+							BENCH_CHECK(engine.Start() == 0, failures);
+						}
+						while (engine.WriteBlock(block.data(), 1000) == NativeErrorTimeout) {}
+					}
+					BENCH_CHECK(WaitGenerated(engine, (uInt64)blocks * BlockSamples, 10.0), failures);
+					engineRate = (double)blocks * BlockSamples / SecondsSince(start);
+					engine.Detach();
+				}
+
+				std::printf("  free run F64 %u ch: producer-thread writes %.1f MS/s/ch, "
+					"engine %.1f MS/s/ch\n", channels, direct / 1e6, engineRate / 1e6);
+				return failures;
+			}
+		}
+
+		int RunOutputBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const uInt32 blocks = options.quick ? 200 : 1000;
+
+			failures += CheckArguments();
+
+			failures += CheckIntegrity(SampleFormat::Float64, DAQmx_Val_GroupByChannel, false, blocks);
+			failures += CheckIntegrity(SampleFormat::Float64, DAQmx_Val_GroupByScanNumber, true, blocks);
+			failures += CheckIntegrity(SampleFormat::Int16, DAQmx_Val_GroupByScanNumber, false, blocks);
+			failures += CheckIntegrity(SampleFormat::Int16, DAQmx_Val_GroupByChannel, true, blocks);
+
+			failures += CheckRealTime(options.quick ? 0.5 : 3.0);
+
+			failures += CheckStall(Stall::NoRegeneration);
+			failures += CheckStall(Stall::Regeneration);
+			failures += CheckStall(Stall::Hold);
+
+			failures += MeasureThroughput(blocks * 5);
+			return failures;
+		}
+	}
+}
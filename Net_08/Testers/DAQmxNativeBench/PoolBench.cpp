@@ -0,0 +1,253 @@
+// Checks the native buffer pool and compares a polling loop that reads into
+// a freshly allocated, zeroed buffer per call (what `gcnew array<>` + pin_ptr
+// costs the managed wrappers) with one that reads into rented pool buffers.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/BufferPoolCore.h"
+#include "Native/NativeStatus.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const uInt32 Channels = 8;
+			const uInt32 SamplesPerRead = 100;
+			const uInt32 ReadSamples = Channels * SamplesPerRead;
+
+			TaskHandle CreateOnDemandTask() {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("pool", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ai0:%u", Channels - 1);
+				DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				return task;
+			}
+
+			int CheckPoolSemantics() {
+
+				int failures = 0;
+				BufferPoolCore pool;
+
+				BENCH_CHECK(pool.Create(0, 1, 1) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(pool.Create(64, 2, 1) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(pool.Create(64, 1, 1, 24) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(pool.Create(1000, 1, 3, 4096) == NativeSuccess, failures);
+
+				void* a = pool.Rent();
+				void* b = pool.Rent();
+				void* c = pool.Rent();
+
+				BENCH_CHECK(a != nullptr && b != nullptr && c != nullptr, failures);
+				BENCH_CHECK(((uintptr_t)a % 4096) == 0 && ((uintptr_t)b % 4096) == 0, failures);
+				BENCH_CHECK(pool.Rent() == nullptr, failures);
+				BENCH_CHECK(pool.Counters().allocated == 3, failures);
+				BENCH_CHECK(pool.Counters().misses == 1, failures);
+
+				BENCH_CHECK(pool.Return(b) == NativeSuccess, failures);
+				BENCH_CHECK(pool.Return(b) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(pool.Return(&failures) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(pool.Rent() == b, failures);
+
+				pool.Return(a);
+				pool.Return(b);
+
+				// `c` is still rented: the pool must not be recreated under it.
+				BENCH_CHECK(pool.Create(64, 1, 1) == NativeErrorInvalidState, failures);
+				std::memset(c, 0x5A, 1000);
+				BENCH_CHECK(pool.BufferBytes() == 1000, failures);
+
+				pool.Return(c);
+
+				BufferPoolCounters counters = pool.Counters();
+				BENCH_CHECK(counters.available == 3 && counters.allocated == 3, failures);
+				BENCH_CHECK(counters.rents == 4, failures);
+
+				BENCH_CHECK(pool.Create(64, 1, 2) == NativeSuccess, failures);
+				BENCH_CHECK(pool.Counters().allocated == 1 && pool.BufferBytes() == 64, failures);
+
+				pool.Destroy();
+				BENCH_CHECK(pool.Rent() == nullptr, failures);
+
+				std::printf("  semantics: %d failed checks\n", failures);
+				return failures;
+			}
+
+			// Several threads rent, stamp, verify and return buffers; a buffer
+			// handed to two threads at once shows up as a foreign stamp.
+			int CheckPoolConcurrency(uInt32 iterations) {
+
+				int failures = 0;
+				const int threads = 4;
+
+				BufferPoolCore pool;
+				BENCH_CHECK(pool.Create(256, 2, 6) == NativeSuccess, failures);
+
+				std::atomic<uInt64> collisions(0);
+				std::vector<std::thread> workers;
+
+				for (int t = 0; t < threads; t++) {
+					workers.emplace_back([&pool, &collisions, iterations, t]() {
+						for (uInt32 i = 0; i < iterations; i++) {
+
+							uInt64* p = static_cast<uInt64*>(pool.Rent());
+							if (p == nullptr) {
+								std::this_thread::yield();
+								continue;
+							}
+
+							const uInt64 stamp = ((uInt64)t << 32) | i;
+							for (int k = 0; k < 32; k++) {
+								p[k] = stamp;
+							}
+							for (int k = 0; k < 32; k++) {
+								if (p[k] != stamp) {
+									collisions.fetch_add(1);
+									break;
+								}
+							}
+							pool.Return(p);
+						}
+					});
+				}
+
+				for (std::thread& worker : workers) {
+					worker.join();
+				}
+
+				BufferPoolCounters counters = pool.Counters();
+				std::printf("  concurrency: %d threads, %llu rents, %llu misses, "
+					"%u buffers, %llu collisions\n", threads,
+					(unsigned long long)counters.rents, (unsigned long long)counters.misses,
+					counters.allocated, (unsigned long long)collisions.load());
+
+				BENCH_CHECK(collisions.load() == 0, failures);
+				BENCH_CHECK(counters.available == counters.allocated, failures);
+				BENCH_CHECK(counters.allocated <= 6, failures);
+				return failures;
+			}
+
+			struct LoopResult {
+				double readsPerSecond;
+				uInt64 bytesAllocated;
+				uInt64 allocations;
+				uInt32 badSamples;
+			};
+
+			uInt32 VerifyRead(const int16* data, uInt64 first) {
+
+				uInt32 bad = 0;
+				for (uInt32 ch = 0; ch < Channels; ch++) {
+					if (data[ch * SamplesPerRead] != SimRawSample(ch, first)
+						|| data[ch * SamplesPerRead + SamplesPerRead - 1]
+							!= SimRawSample(ch, first + SamplesPerRead - 1)) {
+						bad++;
+					}
+				}
+				return bad;
+			}
+
+			// Old path: a new zeroed buffer for every read, as `gcnew array<int16>`.
+			LoopResult RunArrayLoop(uInt32 reads) {
+
+				LoopResult result = {};
+				TaskHandle task = CreateOnDemandTask();
+				uInt64 position = 0;
+
+				const auto start = std::chrono::steady_clock::now();
+
+				for (uInt32 i = 0; i < reads; i++) {
+
+					std::vector<int16> data(ReadSamples);
+					result.bytesAllocated += ReadSamples * sizeof(int16);
+					result.allocations++;
+
+					int32 read = 0;
+					DAQmxReadBinaryI16(task, SamplesPerRead, 1.0, DAQmx_Val_GroupByChannel,
+						data.data(), ReadSamples, &read, NULL);
+					result.badSamples += VerifyRead(data.data(), position);
+					position += (uInt64)read;
+				}
+
+				result.readsPerSecond = reads / SecondsSince(start);
+				DAQmxClearTask(task);
+				return result;
+			}
+
+			// New path: rent a pooled aligned buffer, read into it, return it.
+			LoopResult RunPoolLoop(uInt32 reads) {
+
+				LoopResult result = {};
+				TaskHandle task = CreateOnDemandTask();
+				uInt64 position = 0;
+
+				BufferPoolCore pool;
+				pool.Create(ReadSamples * sizeof(int16), 1, 4);
+
+				const auto start = std::chrono::steady_clock::now();
+
+				for (uInt32 i = 0; i < reads; i++) {
+
+					int16* data = static_cast<int16*>(pool.Rent());
+
+					int32 read = 0;
+					DAQmxReadBinaryI16(task, SamplesPerRead, 1.0, DAQmx_Val_GroupByChannel,
+						data, ReadSamples, &read, NULL);
+					result.badSamples += VerifyRead(data, position);
+					position += (uInt64)read;
+
+					pool.Return(data);
+				}
+
+				result.readsPerSecond = reads / SecondsSince(start);
+
+				BufferPoolCounters counters = pool.Counters();
+				result.allocations = counters.allocated;
+				result.bytesAllocated = counters.allocated * pool.BufferBytes();
+
+				DAQmxClearTask(task);
+				return result;
+			}
+		}
+
+		int RunPoolBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const uInt32 reads = options.quick ? 20000 : 500000;
+
+			failures += CheckPoolSemantics();
+			failures += CheckPoolConcurrency(options.quick ? 20000 : 500000);
+
+			LoopResult array = RunArrayLoop(reads);
+			LoopResult pooled = RunPoolLoop(reads);
+
+			std::printf("  polling %u x (%u ch x %u S, I16): array path %.0f reads/s, "
+				"%llu allocations, %.1f MB allocated\n",
+				reads, Channels, SamplesPerRead, array.readsPerSecond,
+				(unsigned long long)array.allocations, array.bytesAllocated / 1e6);
+			std::printf("  polling %u x (%u ch x %u S, I16): pool path  %.0f reads/s, "
+				"%llu allocations, %.1f MB allocated\n",
+				reads, Channels, SamplesPerRead, pooled.readsPerSecond,
+				(unsigned long long)pooled.allocations, pooled.bytesAllocated / 1e6);
+
+			BENCH_CHECK(array.badSamples == 0, failures);
+			BENCH_CHECK(pooled.badSamples == 0, failures);
+			BENCH_CHECK(pooled.allocations == 1, failures);
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,505 @@
+// Records simulated acquisitions with the streaming recorder, reads the
+// files back with the reader and checks every sample, the sample index and
+// the scaling of every chunk; then measures the sustained write rate against
+// a write-per-block loop that allocates a buffer per block.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/HostClock.h"
+#include "Native/NativeStatus.h"
+#include "Native/RawScalingCore.h"
+#include "Native/RecordingFormat.h"
+#include "Native/RecordingReaderCore.h"
+#include "Native/StreamRecorderCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			std::string TempPath(const char* name) {
+				return (std::filesystem::temp_directory_path() / name).string();
+			}
+
+			TaskHandle CreateTask(uInt32 channels, float64 rate) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("recorder", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ai0:%u", channels - 1);
+				DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+
+				if (rate > 0.0) {
+					DAQmxCfgSampClkTiming(task, "", rate, DAQmx_Val_Rising,
+						DAQmx_Val_ContSamps, 0);
+				}
+				return task;
+			}
+
+			template <typename T>
+			T Expected(uInt32 ch, uInt64 index) {
+				return (T)SimRawSample(ch, index);
+			}
+
+			// Checks the samples and the chunk chain of a recording. `gapAt` is
+			// the one sample index at which a discontinuity is expected.
+			template <typename T>
+			int VerifyRecording(const std::string& path, uInt32 channels,
+				uInt64 expectedSamples, uInt64 gapAt, uInt64& chunks) {
+
+				int failures = 0;
+				RecordingReaderCore reader;
+
+				BENCH_CHECK(reader.Open(path.c_str()) == NativeSuccess, failures);
+				if (failures != 0) {
+					return failures;
+				}
+
+				BENCH_CHECK(reader.IsComplete(), failures);
+				BENCH_CHECK(reader.Channels() == channels, failures);
+				BENCH_CHECK(SampleSize(reader.Format()) == sizeof(T), failures);
+				BENCH_CHECK(reader.TotalSamples() == expectedSamples, failures);
+				BENCH_CHECK(reader.Header()->totalSamples == expectedSamples, failures);
+
+				uInt64 bad = 0;
+				uInt64 next = 0;
+				uInt32 gaps = 0;
+				chunks = reader.ChunkCount();
+
+				for (uInt64 k = 0; k < chunks; k++) {
+
+					RecordedChunk chunk;
+					if (reader.GetChunk(k, chunk) != NativeSuccess) {
+						failures++;
+						continue;
+					}
+
+					if (chunk.firstSample != next) {
+						gaps++;
+						BENCH_CHECK(chunk.firstSample == gapAt, failures);
+					}
+					next = chunk.firstSample + chunk.samplesPerChannel;
+					BENCH_CHECK(chunk.timestampNs > 0, failures);
+
+					const T* data = static_cast<const T*>(chunk.data);
+					for (uInt64 i = 0; i < chunk.samplesPerChannel; i++) {
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							if (data[i * channels + ch] != Expected<T>(ch, chunk.firstSample + i)) {
+								bad++;
+							}
+						}
+					}
+				}
+
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(gaps == ((gapAt != 0) ? 1u : 0u), failures);
+				return failures;
+			}
+
+			// A copy of `path` whose header claims chunks of `chunkBytes` must
+			// be refused rather than read past the end of the mapping.
+			int CheckChunkBytesRejected(const std::string& path, uInt64 chunkBytes) {
+
+				int failures = 0;
+				const std::string copy = TempPath("DAQmxNativeBench_bad.rec");
+
+				std::ifstream in(path, std::ios::binary);
+				std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+					std::istreambuf_iterator<char>());
+				in.close();
+
+				BENCH_CHECK(bytes.size() > sizeof(RecordingFileHeader), failures);
+				if (failures != 0) {
+					return failures;
+				}
+
+				std::memcpy(bytes.data() + offsetof(RecordingFileHeader, chunkBytes),
+					&chunkBytes, sizeof(chunkBytes));
+				std::ofstream(copy, std::ios::binary).write(bytes.data(), (std::streamsize)bytes.size());
+
+				RecordingReaderCore reader;
+				BENCH_CHECK(reader.Open(copy.c_str()) == NativeErrorInvalidFile, failures);
+
+				std::filesystem::remove(copy);
+				return failures;
+			}
+
+			// On-demand reads of odd sizes, grouped by channel, appended with
+			// the read position of the task; a skipped stretch in the middle.
+			int CheckReadPath() {
+
+				int failures = 0;
+				const uInt32 channels = 6;
+				const std::string path = TempPath("DAQmxNativeBench_read.rec");
+
+				TaskHandle task = CreateTask(channels, 0.0);
+				RawScalingCore scaler;
+				BENCH_CHECK(scaler.Capture(task) == NativeSuccess, failures);
+
+				StreamRecorderConfig config = DefaultStreamRecorderConfig();
+				config.channels = channels;
+				config.format = SampleFormat::Int16;
+				config.chunkSamplesPerChannel = 3000;
+				config.queueSamplesPerChannel = 1000;
+				config.reserveBytes = 1 << 20;
+
+				StreamRecorderCore recorder;
+				BENCH_CHECK(recorder.Open(path.c_str(), config) == NativeSuccess, failures);
+				BENCH_CHECK(recorder.SetScaling(scaler) == NativeSuccess, failures);
+
+				std::vector<int16> block((size_t)channels * 2777);
+				uInt64 recorded = 0;
+				uInt64 gapAt = 0;
+				int32 read = 0;
+
+				for (int b = 0; b < 40; b++) {
+
+					if (b == 20) {
+						// Read and discard: leaves a hole in the recording.
+						DAQmxReadBinaryI16(task, 500, 1.0, DAQmx_Val_GroupByChannel,
+							block.data(), (uInt32)block.size(), &read, NULL);
+						gapAt = recorded + 500;
+					}
+
+					const uInt32 n = 100 + (uInt32)(b * 67) % 2677;
+					DAQmxReadBinaryI16(task, (int32)n, 1.0, DAQmx_Val_GroupByChannel,
+						block.data(), (uInt32)block.size(), &read, NULL);
+
+					BENCH_CHECK(recorder.AppendRead(task, block.data(), (uInt32)read,
+						DAQmx_Val_GroupByChannel) == NativeSuccess, failures);
+					BENCH_CHECK(recorder.WaitIdle(2000), failures);
+					recorded += (uInt64)read;
+				}
+
+				BENCH_CHECK(recorder.Close() == NativeSuccess, failures);
+				DAQmxClearTask(task);
+
+				uInt64 chunks = 0;
+				failures += VerifyRecording<int16>(path, channels, recorded, gapAt, chunks);
+
+				// Every chunk carries the polynomials of the device.
+				RecordingReaderCore reader;
+				reader.Open(path.c_str());
+				RecordedChunk chunk;
+				BENCH_CHECK(reader.GetChunk(chunks - 1, chunk) == NativeSuccess, failures);
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					float64 expected[SimAICoeffCount];
+					SimAICoefficients(ch, expected);
+					for (uInt32 k = 0; k < SimAICoeffCount; k++) {
+						BENCH_CHECK(chunk.coeffs[ch * chunk.coeffCount + k] == expected[k], failures);
+					}
+				}
+				reader.Close();
+
+				std::printf("  read path I16/ByChannel: %llu samples/ch in %llu chunks\n",
+					(unsigned long long)recorded, (unsigned long long)chunks);
+
+				failures += CheckChunkBytesRejected(path, sizeof(RecordingChunkHeader) - 8);
+				failures += CheckChunkBytesRejected(path, RecordingAlignment + 64);
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			// A scaling change must start a new chunk with the new polynomial.
+			int CheckScalingChange() {
+
+				int failures = 0;
+				const uInt32 channels = 2;
+				const std::string path = TempPath("DAQmxNativeBench_scaling.rec");
+
+				StreamRecorderConfig config = DefaultStreamRecorderConfig();
+				config.channels = channels;
+				config.format = SampleFormat::Int32;
+				config.reserveBytes = 1 << 20;
+
+				StreamRecorderCore recorder;
+				BENCH_CHECK(recorder.Open(path.c_str(), config) == NativeSuccess, failures);
+
+				std::vector<int32> block((size_t)channels * 100);
+				for (uInt32 i = 0; i < 100; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						block[i * channels + ch] = Expected<int32>(ch, i);
+					}
+				}
+				BENCH_CHECK(recorder.Append(block.data(), 100, DAQmx_Val_GroupByScanNumber)
+					== NativeSuccess, failures);
+				BENCH_CHECK(recorder.WaitIdle(2000), failures);
+
+				const float64 gain[2] = { 0.5, 2.0 };
+				BENCH_CHECK(recorder.SetChannelCoefficients(1, gain, 2) == NativeSuccess, failures);
+
+				for (uInt32 i = 0; i < 100; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						block[i * channels + ch] = Expected<int32>(ch, 100 + i);
+					}
+				}
+				BENCH_CHECK(recorder.Append(block.data(), 100, DAQmx_Val_GroupByScanNumber)
+					== NativeSuccess, failures);
+				BENCH_CHECK(recorder.Close() == NativeSuccess, failures);
+
+				uInt64 chunks = 0;
+				failures += VerifyRecording<int32>(path, channels, 200, 0, chunks);
+				BENCH_CHECK(chunks == 2, failures);
+
+				RecordingReaderCore reader;
+				reader.Open(path.c_str());
+				RecordedChunk first, second;
+				BENCH_CHECK(reader.GetChunk(0, first) == NativeSuccess, failures);
+				BENCH_CHECK(reader.GetChunk(1, second) == NativeSuccess, failures);
+				if (failures == 0) {
+					BENCH_CHECK(first.coeffs[first.coeffCount + 1] == 1.0, failures);
+					BENCH_CHECK(second.coeffs[second.coeffCount] == 0.5, failures);
+					BENCH_CHECK(second.coeffs[second.coeffCount + 1] == 2.0, failures);
+					BENCH_CHECK(second.firstSample == 100, failures);
+				}
+				reader.Close();
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			// An engine block appended late keeps the host time of its read.
+			int CheckBlockTimestamp() {
+
+				int failures = 0;
+				const uInt32 channels = 2;
+				const std::string path = TempPath("DAQmxNativeBench_stamp.rec");
+
+				StreamRecorderConfig config = DefaultStreamRecorderConfig();
+				config.channels = channels;
+				config.format = SampleFormat::Int16;
+				config.reserveBytes = 1 << 20;
+
+				StreamRecorderCore recorder;
+				BENCH_CHECK(recorder.Open(path.c_str(), config) == NativeSuccess, failures);
+
+				std::vector<int16> block((size_t)channels * 100);
+				for (uInt32 i = 0; i < 100; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						block[i * channels + ch] = Expected<int16>(ch, i);
+					}
+				}
+
+				const int64 lateNs = 5000000000LL;
+
+				BlockView view = {};
+				view.data = block.data();
+				view.samplesPerChannel = 100;
+				view.channels = channels;
+				view.format = SampleFormat::Int16;
+				view.fillMode = DAQmx_Val_GroupByScanNumber;
+				view.hostTimestampNs = HostMonotonicNs() - lateNs;
+
+				const int64 appendedNs = (int64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::system_clock::now().time_since_epoch()).count();
+
+				BENCH_CHECK(recorder.Append(view) == NativeSuccess, failures);
+				BENCH_CHECK(recorder.Close() == NativeSuccess, failures);
+
+				RecordingReaderCore reader;
+				RecordedChunk chunk;
+				BENCH_CHECK(reader.Open(path.c_str()) == NativeSuccess, failures);
+				BENCH_CHECK(reader.GetChunk(0, chunk) == NativeSuccess, failures);
+
+				const int64 error = chunk.timestampNs - (appendedNs - lateNs);
+				BENCH_CHECK(error > -500000000LL && error < 500000000LL, failures);
+				reader.Close();
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			// Engine at a real-time rate, every block handed to the recorder.
+			int CheckEngineRecording(double seconds) {
+
+				int failures = 0;
+				const uInt32 channels = 8;
+				const float64 rate = 250000.0;
+				const std::string path = TempPath("DAQmxNativeBench_engine.rec");
+
+				SimSetClockMode(SimClockMode::RealTime);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig engineConfig = DefaultAcquisitionEngineConfig();
+				engineConfig.channels = channels;
+				engineConfig.samplesPerBlock = 5000;
+				engineConfig.format = SampleFormat::Int16;
+				engineConfig.fillMode = DAQmx_Val_GroupByScanNumber;
+				engineConfig.ownsTask = true;
+
+				StreamRecorderConfig config = DefaultStreamRecorderConfig();
+				config.channels = channels;
+				config.format = SampleFormat::Int16;
+				config.sampleRate = rate;
+				config.reserveBytes = 16 << 20;
+
+				StreamRecorderCore recorder;
+				BENCH_CHECK(recorder.Open(path.c_str(), config) == NativeSuccess, failures);
+				BENCH_CHECK(engine.Attach(CreateTask(channels, rate), engineConfig) == 0, failures);
+				BENCH_CHECK(engine.Start() == 0, failures);
+
+				const auto start = std::chrono::steady_clock::now();
+				BlockView view;
+
+				while (SecondsSince(start) < seconds) {
+					if (engine.WaitAcquireBlock(view, 100)) {
+						BENCH_CHECK(recorder.Append(view) == NativeSuccess, failures);
+						engine.ReleaseBlock();
+					}
+				}
+
+				engine.Stop();
+				AcquisitionEngineCounters engineCounters = engine.Counters();
+				engine.Detach();
+
+				BENCH_CHECK(recorder.Close() == NativeSuccess, failures);
+				StreamRecorderCounters counters = recorder.Counters();
+
+				uInt64 chunks = 0;
+				failures += VerifyRecording<int16>(path, channels, counters.samplesWritten, 0, chunks);
+
+				std::printf("  engine -> recorder: 8 ch x 250000 S/s I16 for %.2f s, "
+					"%llu samples/ch in %llu chunks, %llu engine drops, %llu recorder drops\n",
+					seconds, (unsigned long long)counters.samplesWritten,
+					(unsigned long long)chunks,
+					(unsigned long long)engineCounters.blocksDropped,
+					(unsigned long long)counters.blocksDropped);
+
+				BENCH_CHECK(engineCounters.blocksDropped == 0, failures);
+				BENCH_CHECK(counters.blocksDropped == 0, failures);
+				BENCH_CHECK(counters.samplesWritten >= (uInt64)(rate * seconds * 0.5), failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+
+				std::filesystem::remove(path);
+				return failures;
+			}
+
+			// Sustained rate of the recorder with a producer that appends as fast
+			// as the queue accepts blocks.
+			double MeasureRecorder(uInt32 channels, uInt32 samples, double seconds,
+				uInt64& dropped, double& appendSeconds) {
+
+				const std::string path = TempPath("DAQmxNativeBench_rate.rec");
+
+				StreamRecorderConfig config = DefaultStreamRecorderConfig();
+				config.channels = channels;
+				config.format = SampleFormat::Int16;
+				config.queueSamplesPerChannel = samples;
+
+				std::vector<int16> block((size_t)channels * samples, 7);
+				StreamRecorderCore recorder;
+
+				if (recorder.Open(path.c_str(), config) != NativeSuccess) {
+					return 0.0;
+				}
+
+				const auto start = std::chrono::steady_clock::now();
+				double inAppend = 0.0;
+				uInt64 appended = 0;
+
+				while (SecondsSince(start) < seconds) {
+
+					const auto before = std::chrono::steady_clock::now();
+					if (recorder.Append(block.data(), samples, DAQmx_Val_GroupByScanNumber)
+						!= NativeSuccess) {
+						std::this_thread::yield();
+						continue;
+					}
+					inAppend += SecondsSince(before);
+					appended++;
+				}
+
+				appendSeconds = (appended != 0) ? inAppend / appended : 0.0;
+
+				recorder.Close();
+				const double elapsed = SecondsSince(start);
+				StreamRecorderCounters counters = recorder.Counters();
+				dropped = counters.blocksDropped;
+
+				std::filesystem::remove(path);
+				return counters.samplesWritten * channels * sizeof(int16) / elapsed;
+			}
+
+			// What the managed path does per block: a new buffer, a copy into
+			// it and a buffered write.
+			double MeasureWritePerBlock(uInt32 channels, uInt32 samples, double seconds,
+				double& blockSeconds) {
+
+				const std::string path = TempPath("DAQmxNativeBench_stream.rec");
+				std::FILE* file = std::fopen(path.c_str(), "wb");
+
+				if (file == nullptr) {
+					return 0.0;
+				}
+
+				std::vector<int16> block((size_t)channels * samples, 7);
+				uInt64 bytes = 0;
+				uInt64 blocks = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				while (SecondsSince(start) < seconds) {
+					std::vector<int16> copy(block);
+					bytes += std::fwrite(copy.data(), sizeof(int16), copy.size(), file)
+						* sizeof(int16);
+					blocks++;
+				}
+
+				std::fclose(file);
+				const double elapsed = SecondsSince(start);
+				blockSeconds = elapsed / (double)std::max<uInt64>(blocks, 1);
+
+				std::filesystem::remove(path);
+				return bytes / elapsed;
+			}
+		}
+
+		int RunRecorderBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const double seconds = options.quick ? 0.5 : 3.0;
+
+			failures += CheckReadPath();
+			failures += CheckScalingChange();
+			failures += CheckBlockTimestamp();
+			failures += CheckEngineRecording(seconds);
+
+			uInt64 dropped = 0;
+			double appendSeconds = 0.0;
+			double blockSeconds = 0.0;
+			const uInt32 channels = 16;
+			const uInt32 samples = 10000;
+			const double recorderRate = MeasureRecorder(channels, samples, seconds,
+				dropped, appendSeconds);
+			const double streamRate = MeasureWritePerBlock(channels, samples, seconds,
+				blockSeconds);
+
+			std::printf("  sustained write, %u ch x %u I16 blocks: recorder %.0f MB/s, "
+				"write per block %.0f MB/s (%llu full-queue retries)\n",
+				channels, samples, recorderRate / 1e6, streamRate / 1e6,
+				(unsigned long long)dropped);
+			std::printf("  time per block on the acquiring thread: Append %.1f us, "
+				"allocate + write %.1f us\n", appendSeconds * 1e6, blockSeconds * 1e6);
+
+			BENCH_CHECK(recorderRate > 0.0, failures);
+			return failures;
+		}
+	}
+}
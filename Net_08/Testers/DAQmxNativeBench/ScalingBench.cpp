@@ -0,0 +1,225 @@
+// Checks the deferred raw-to-volts scaling (RawScalingCore + ScalingKernels)
+// against the simulated device polynomial for every SIMD level and layout,
+// then measures the kernels.
+
+#include <cmath>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/CpuFeatures.h"
+#include "Native/NativeStatus.h"
+#include "Native/RawScalingCore.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			TaskHandle CreateOnDemandTask(uInt32 channels) {
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("scaling", &task);
+
+				char physical[64];
+				std::snprintf(physical, sizeof(physical), "SimDev1/ai0:%u", channels - 1);
+				DAQmxCreateAIVoltageChan(task, physical, "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				return task;
+			}
+
+			size_t Index(int32 fillMode, uInt32 channels, uInt32 samples,
+				uInt32 ch, uInt32 i) {
+				return (fillMode == DAQmx_Val_GroupByChannel)
+					? (size_t)ch * samples + i : (size_t)i * channels + ch;
+			}
+
+			bool Close(float64 actual, float64 expected, float64 relative) {
+				return std::fabs(actual - expected) <= relative * (1.0 + std::fabs(expected));
+			}
+
+			int CheckLayout(uInt32 channels, uInt32 samples, int32 fillMode) {
+
+				int failures = 0;
+				TaskHandle task = CreateOnDemandTask(channels);
+
+				RawScalingCore scaler;
+				BENCH_CHECK(scaler.Capture(task) == NativeSuccess, failures);
+				BENCH_CHECK(scaler.Channels() == channels, failures);
+
+				const size_t total = (size_t)channels * samples;
+				std::vector<int16> raw(total);
+				int32 read = 0;
+				DAQmxReadBinaryI16(task, (int32)samples, 1.0, fillMode,
+					raw.data(), (uInt32)total, &read, NULL);
+
+				std::vector<float64> f64(total);
+				std::vector<float32> f32(total);
+				std::vector<float64> one64(samples);
+				std::vector<float32> one32(samples);
+
+				BENCH_CHECK(scaler.ScaleToF64(raw.data(), samples, fillMode, f64.data(), total) == 0, failures);
+				BENCH_CHECK(scaler.ScaleToF32(raw.data(), samples, fillMode, f32.data(), total) == 0, failures);
+
+				uInt32 bad = 0;
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+
+					scaler.ScaleChannelToF64(raw.data(), samples, fillMode, ch, one64.data(), samples);
+					scaler.ScaleChannelToF32(raw.data(), samples, fillMode, ch, one32.data(), samples);
+
+					for (uInt32 i = 0; i < samples; i++) {
+
+						const float64 expected = SimScaledSample(ch, i);
+						const size_t k = Index(fillMode, channels, samples, ch, i);
+
+						bad += !Close(f64[k], expected, 1e-12);
+						bad += !Close(one64[i], expected, 1e-12);
+						bad += !Close(f32[k], expected, 1e-5);
+						bad += !Close(one32[i], expected, 1e-5);
+					}
+				}
+
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(scaler.ScaleToF64(raw.data(), samples, fillMode, f64.data(), total - 1)
+					== NativeErrorBufferTooSmall, failures);
+
+				DAQmxClearTask(task);
+				return failures;
+			}
+
+			int CheckReadRaw() {
+
+				int failures = 0;
+				const uInt32 channels = 5;
+				const uInt32 samples = 333;
+				TaskHandle task = CreateOnDemandTask(channels);
+
+				RawScalingCore scaler;
+				BENCH_CHECK(scaler.Capture(task) == NativeSuccess, failures);
+
+				std::vector<int16> raw((size_t)channels * samples);
+				int32 read = 0;
+				int32 bytesPerSample = 0;
+				BENCH_CHECK(DAQmxReadRaw(task, (int32)samples, 1.0, raw.data(),
+					(uInt32)(raw.size() * sizeof(int16)), &read, &bytesPerSample, NULL) == 0, failures);
+				BENCH_CHECK(bytesPerSample == 2, failures);
+
+				std::vector<float64> scaled(raw.size());
+				scaler.ScaleToF64(raw.data(), samples, DAQmx_Val_GroupByScanNumber,
+					scaled.data(), scaled.size());
+
+				uInt32 bad = 0;
+				for (uInt32 i = 0; i < samples; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						bad += !Close(scaled[(size_t)i * channels + ch], SimScaledSample(ch, i), 1e-12);
+					}
+				}
+				BENCH_CHECK(bad == 0, failures);
+
+				float64 c[MaxScalingCoeffs];
+				float64 expected[SimAICoeffCount];
+				SimAICoefficients(3, expected);
+				BENCH_CHECK(scaler.GetChannelCoefficients(3, c, MaxScalingCoeffs) == (int32)SimAICoeffCount, failures);
+				BENCH_CHECK(c[0] == expected[0] && c[1] == expected[1] && c[2] == expected[2], failures);
+
+				DAQmxClearTask(task);
+				return failures;
+			}
+
+			double MeasureKernel(RawScalingCore& scaler, const std::vector<int16>& raw,
+				uInt32 samples, int32 fillMode, bool single, double seconds) {
+
+				std::vector<float64> f64(raw.size());
+				std::vector<float32> f32(raw.size());
+				uInt64 converted = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 16; rep++) {
+						if (single) {
+							scaler.ScaleToF32(raw.data(), samples, fillMode, f32.data(), f32.size());
+						}
+						else {
+							scaler.ScaleToF64(raw.data(), samples, fillMode, f64.data(), f64.size());
+						}
+						converted += raw.size();
+					}
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(single ? (float64)f32[raw.size() / 2] : f64[raw.size() / 2]);
+				return converted / SecondsSince(start);
+			}
+		}
+
+		int RunScalingBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				int f = 0;
+
+				for (uInt32 channels : { 1u, 3u, 8u, 12u }) {
+					for (uInt32 samples : { 1u, 7u, 100u, 1001u }) {
+						f += CheckLayout(channels, samples, DAQmx_Val_GroupByChannel);
+						f += CheckLayout(channels, samples, DAQmx_Val_GroupByScanNumber);
+					}
+				}
+				f += CheckReadRaw();
+
+				std::printf("  correctness %-7s: %d failed checks\n", SimdLevelName(level), f);
+				failures += f;
+			}
+
+			const uInt32 channels = 8;
+			const uInt32 samples = 10000;
+			const double seconds = options.quick ? 0.1 : 1.0;
+
+			TaskHandle task = CreateOnDemandTask(channels);
+			RawScalingCore scaler;
+			scaler.Capture(task);
+
+			std::vector<int16> raw((size_t)channels * samples);
+			int32 read = 0;
+			DAQmxReadBinaryI16(task, (int32)samples, 1.0, DAQmx_Val_GroupByScanNumber,
+				raw.data(), (uInt32)raw.size(), &read, NULL);
+			DAQmxClearTask(task);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+
+				std::printf("  %-7s I16->F64 by channel %7.0f MS/s, by scan %7.0f MS/s; "
+					"I16->F32 by scan %7.0f MS/s\n", SimdLevelName(level),
+					MeasureKernel(scaler, raw, samples, DAQmx_Val_GroupByChannel, false, seconds) / 1e6,
+					MeasureKernel(scaler, raw, samples, DAQmx_Val_GroupByScanNumber, false, seconds) / 1e6,
+					MeasureKernel(scaler, raw, samples, DAQmx_Val_GroupByScanNumber, true, seconds) / 1e6);
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			std::printf("  bytes moved by the read: F64 %u B/sample, I16 %u B/sample\n",
+				(unsigned)sizeof(float64), (unsigned)sizeof(int16));
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
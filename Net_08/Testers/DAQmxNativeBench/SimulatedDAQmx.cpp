@@ -0,0 +1,1483 @@
+#include "SimulatedDAQmx.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Simulation {
+
+			namespace {
+
+				const uInt32 WaveTableSize = 4096;
+
+				struct WaveTable {
+					int16 values[WaveTableSize];
+
+					WaveTable() {
+						const double twoPi = 6.283185307179586;
+						for (uInt32 i = 0; i < WaveTableSize; i++) {
+							values[i] = (int16)std::lround(
+								20000.0 * std::sin(twoPi * i / WaveTableSize));
+						}
+					}
+				};
+
+				const WaveTable& Table() {
+					static WaveTable table;
+					return table;
+				}
+
+				std::atomic<SimClockMode> g_clockMode(SimClockMode::RealTime);
+				std::atomic<int> g_liveTasks(0);
+				std::atomic<uInt32> g_callbackDelayUs(0);
+
+				struct SimTask;
+
+				// Live tasks, to resolve the terminals of exported signals.
+				std::mutex g_routeMutex;
+				std::vector<SimTask*> g_tasks;
+
+				struct SimChannel {
+					std::string name;
+					// Lines of a digital channel; 0 for analog channels.
+					uInt32 lines;
+				};
+
+				struct SimTask {
+
+					std::string name;
+					std::vector<SimChannel> channels;
+
+					bool timed = false;
+					float64 rate = 0.0;
+					int32 sampleMode = DAQmx_Val_ContSamps;
+					uInt64 finiteSamples = 0;
+					uInt64 bufferSize = 0;
+					SimClockMode clockMode = SimClockMode::RealTime;
+
+					// Registration may change while the clock runs, as with
+					// DAQmx; the clock thread calls a copy, so a callback may
+					// still run after it was unregistered.
+					std::mutex callbackMutex;
+					DAQmxEveryNSamplesEventCallbackPtr everyNCallback = nullptr;
+					void* everyNData = nullptr;
+					uInt32 everyN = 0;
+
+					DAQmxDoneEventCallbackPtr doneCallback = nullptr;
+					void* doneData = nullptr;
+
+					// Signal events, at most one callback per signal.
+					struct SignalCallback {
+						int32 signalId;
+						DAQmxSignalEventCallbackPtr callback;
+						void* data;
+					};
+					std::vector<SignalCallback> signalCallbacks;
+
+					// Routing: the sample clock terminal (empty for the onboard
+					// clock), the start trigger terminal (empty for none) and
+					// the signals this task exports, as (signal, terminal).
+					std::string clockSource;
+					std::string triggerSource;
+					std::vector<std::pair<int32, std::string>> exports;
+
+					// Ticks of the sample clock before sample 0 of this task.
+					// Non-zero when the task joins a shared clock that was
+					// already running, i.e. without a start trigger.
+					std::atomic<uInt64> origin{ 0 };
+					// Started and waiting for its start trigger.
+					std::atomic<bool> armed{ false };
+
+					std::atomic<bool> running{ false };
+					std::atomic<uInt64> acquired{ 0 };
+					std::atomic<uInt64> readPosition{ 0 };
+
+					// Line bytes passed to DAQmxWriteDigitalLines, appended.
+					std::vector<uInt8> writtenLines;
+
+					// Analog output: the device buffer, interleaved by scan,
+					// and the samples per channel written into it. `acquired`
+					// counts the samples generated. Guarded by `mutex`.
+					bool output = false;
+					bool allowRegen = true;
+					std::vector<float64> outputBuffer;
+					std::atomic<uInt64> written{ 0 };
+					uInt64 regenerated = 0;
+					// Generation error, e.g. an underflow without regeneration.
+					int32 error = 0;
+					std::vector<float64> generatedRecord;
+
+					// Buffered read cut short by SimShortenRead. Guarded by `mutex`.
+					uInt64 shortReadAt = ~(uInt64)0;
+					uInt32 shortReadSamples = 0;
+
+					// Hardware-timed single point: no clock thread; the sample
+					// clock ticks at `rate` from `started`, and `acquired`
+					// counts the ticks waited for by DAQmxWaitForNextSampleClock.
+					std::chrono::steady_clock::time_point started;
+
+					std::mutex mutex;
+					std::condition_variable dataAvailable;
+					std::thread clock;
+
+					uInt32 ChannelCount() const {
+						return (uInt32)channels.size();
+					}
+
+					bool SinglePoint() const {
+						return timed && sampleMode == DAQmx_Val_HWTimedSinglePoint;
+					}
+
+					uInt64 BufferSize() const {
+						if (bufferSize != 0) {
+							return bufferSize;
+						}
+						// DAQmx default for continuous tasks is about one second of data.
+						return std::max<uInt64>((uInt64)rate, 10000);
+					}
+				};
+
+				SimTask* ToTask(TaskHandle handle) {
+					return static_cast<SimTask*>(handle);
+				}
+
+				bool Exports(const SimTask* task, int32 signal, const std::string& terminal) {
+
+					for (const auto& route : task->exports) {
+						if (route.first == signal && route.second == terminal) {
+							return true;
+						}
+					}
+					return false;
+				}
+
+				// The task exporting `signal` to `terminal`, or `nullptr`.
+				// Called with `g_routeMutex` held.
+				SimTask* FindExporter(int32 signal, const std::string& terminal) {
+
+					if (terminal.empty()) {
+						return nullptr;
+					}
+
+					for (SimTask* task : g_tasks) {
+						if (Exports(task, signal, terminal)) {
+							return task;
+						}
+					}
+					return nullptr;
+				}
+
+				// Splits "Dev1/ai0:7, Dev1/ai9" into individual channel names.
+				void AddChannels(SimTask* task, const char* physicalChannel) {
+
+					std::string list = (physicalChannel != NULL) ? physicalChannel : "";
+					size_t start = 0;
+
+					while (start <= list.size()) {
+
+						size_t comma = list.find(',', start);
+						std::string item = list.substr(start,
+							(comma == std::string::npos) ? std::string::npos : comma - start);
+						item.erase(0, item.find_first_not_of(' '));
+						item.erase(item.find_last_not_of(' ') + 1);
+
+						if (!item.empty()) {
+
+							size_t colon = item.rfind(':');
+							size_t digits = item.find_last_not_of("0123456789",
+								(colon == std::string::npos) ? std::string::npos : colon - 1);
+
+							if (colon != std::string::npos && digits != std::string::npos) {
+
+								std::string prefix = item.substr(0, digits + 1);
+								int first = std::atoi(item.substr(digits + 1, colon - digits - 1).c_str());
+								int last = std::atoi(item.substr(colon + 1).c_str());
+								int step = (last >= first) ? 1 : -1;
+
+								for (int i = first; ; i += step) {
+									task->channels.push_back({ prefix + std::to_string(i), 0 });
+									if (i == last) {
+										break;
+									}
+								}
+							}
+							else {
+								task->channels.push_back({ item, 0 });
+							}
+						}
+
+						if (comma == std::string::npos) {
+							break;
+						}
+						start = comma + 1;
+					}
+				}
+
+				// Whether the clock of `task` may tick up to `total` samples: a
+				// task on the clock of another one never gets ahead of it, and
+				// gets nothing while it is stopped.
+				bool ClockAllows(SimTask* task, uInt64 total) {
+
+					std::lock_guard<std::mutex> lock(g_routeMutex);
+					SimTask* master = FindExporter(DAQmx_Val_SampleClock, task->clockSource);
+
+					if (master == nullptr || master == task) {
+						return true;
+					}
+					return master->running.load()
+						&& master->acquired.load() >= task->origin.load() + total;
+				}
+
+				// Generates the output samples up to `total`. Called with the
+				// mutex of the task held. Returns false on an underflow
+				// without regeneration.
+				bool Generate(SimTask* task, uInt64 total) {
+
+					const uInt64 written = task->written.load();
+
+					if (total > written && !task->allowRegen) {
+						return false;
+					}
+
+					const uInt32 channels = task->ChannelCount();
+					const uInt64 bufferScans = task->outputBuffer.size() / channels;
+
+					for (uInt64 g = task->acquired.load(); g < total; g++) {
+
+						if (g >= written) {
+							task->regenerated++;
+						}
+
+						if (task->generatedRecord.size() + channels <= SimGeneratedRecordLimit) {
+							const float64* scan = task->outputBuffer.data() + (g % bufferScans) * channels;
+							task->generatedRecord.insert(task->generatedRecord.end(), scan, scan + channels);
+						}
+					}
+					return true;
+				}
+
+				void RunClock(SimTask* task) {
+
+					const uInt64 bufferSize = task->BufferSize();
+					uInt32 everyN;
+					{
+						std::lock_guard<std::mutex> lock(task->callbackMutex);
+						everyN = task->everyN;
+					}
+					// Without a callback, ticks of 10 ms that fit the buffer.
+					const uInt32 n = (everyN != 0) ? everyN
+						: (uInt32)std::min<uInt64>(bufferSize,
+							std::max<uInt32>(1, (uInt32)(task->rate / 100.0)));
+					const auto period = std::chrono::duration<double>(n / task->rate);
+
+					// No sample before the start trigger.
+					while (task->armed.load() && task->running.load()) {
+						std::this_thread::sleep_for(std::chrono::microseconds(50));
+					}
+
+					const auto start = std::chrono::steady_clock::now();
+					uInt64 ticks = 0;
+
+					while (task->running.load()) {
+
+						if (task->clockMode == SimClockMode::RealTime) {
+							ticks++;
+							std::this_thread::sleep_until(start +
+								std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+									period * (double)ticks));
+						}
+						else if (task->output) {
+							// Free run: never generate what was not written.
+							while (task->running.load() &&
+								task->acquired.load() + n > task->written.load()) {
+								std::this_thread::yield();
+							}
+						}
+						else {
+							// Free run: never overwrite unread data.
+							while (task->running.load() &&
+								task->acquired.load() + n - task->readPosition.load() > bufferSize) {
+								std::this_thread::yield();
+							}
+						}
+
+						while (task->running.load()
+							&& !ClockAllows(task, task->acquired.load() + n)) {
+							std::this_thread::yield();
+						}
+
+						if (!task->running.load()) {
+							break;
+						}
+
+						uInt64 total = task->acquired.load() + n;
+
+						if (task->sampleMode == DAQmx_Val_FiniteSamps) {
+							total = std::min(total, task->finiteSamples);
+						}
+
+						bool underflow = false;
+						{
+							std::lock_guard<std::mutex> lock(task->mutex);
+
+							if (task->output && !Generate(task, total)) {
+								// Like DAQmx, stop rather than repeat old samples.
+								task->error = DAQmxErrorGenStoppedToPreventRegenOfOldSamples;
+								task->running.store(false);
+								underflow = true;
+							}
+							else {
+								task->acquired.store(total);
+							}
+						}
+						task->dataAvailable.notify_all();
+
+						DAQmxEveryNSamplesEventCallbackPtr everyNCallback;
+						void* everyNData;
+						DAQmxDoneEventCallbackPtr doneCallback;
+						void* doneData;
+						DAQmxSignalEventCallbackPtr clockCallback = nullptr;
+						void* clockData = nullptr;
+						{
+							std::lock_guard<std::mutex> lock(task->callbackMutex);
+							everyNCallback = task->everyNCallback;
+							everyNData = task->everyNData;
+							doneCallback = task->doneCallback;
+							doneData = task->doneData;
+
+							for (const SimTask::SignalCallback& signal : task->signalCallbacks) {
+								if (signal.signalId == DAQmx_Val_SampleClock) {
+									clockCallback = signal.callback;
+									clockData = signal.data;
+								}
+							}
+						}
+
+						const uInt32 delayUs = g_callbackDelayUs.load();
+						if (delayUs != 0) {
+							std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+						}
+
+						if (clockCallback != nullptr) {
+							clockCallback(task, DAQmx_Val_SampleClock, clockData);
+						}
+
+						if (underflow) {
+							if (doneCallback != nullptr) {
+								doneCallback(task, task->error, doneData);
+							}
+							break;
+						}
+
+						if (everyNCallback != nullptr) {
+							everyNCallback(task, task->output
+								? DAQmx_Val_Transferred_From_Buffer : DAQmx_Val_Acquired_Into_Buffer,
+								n, everyNData);
+						}
+
+						if (task->sampleMode == DAQmx_Val_FiniteSamps
+							&& total >= task->finiteSamples) {
+
+							if (doneCallback != nullptr) {
+								doneCallback(task, 0, doneData);
+							}
+							break;
+						}
+					}
+				}
+
+				// Waits for the next tick of a hardware-timed single-point task.
+				// A caller that missed ticks skips to the latest one and is
+				// late, as with DAQmx_RealTime_ConvLateErrorsToWarnings.
+				int32 WaitForTick(SimTask* task, float64 timeout, bool32* isLate) {
+
+					if (isLate != NULL) {
+						*isLate = FALSE;
+					}
+
+					if (!task->running.load()) {
+						return DAQmxErrorInvalidTask;
+					}
+
+					const uInt64 next = task->acquired.load() + 1;
+
+					if (task->clockMode == SimClockMode::FreeRun) {
+						task->acquired.store(next);
+						return 0;
+					}
+
+					const auto period = std::chrono::duration<double>(1.0 / task->rate);
+					const auto now = std::chrono::steady_clock::now();
+					const uInt64 elapsed = (uInt64)(std::chrono::duration<double>(
+						now - task->started).count() * task->rate);
+
+					if (elapsed > next) {
+						task->acquired.store(elapsed);
+						if (isLate != NULL) {
+							*isLate = TRUE;
+						}
+						return DAQmxWarningWaitForNextSampClkDetectedMissedSampClk;
+					}
+
+					const auto target = task->started
+						+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * (double)next);
+
+					if (timeout >= 0 && target - now > std::chrono::duration<double>(timeout)) {
+						return DAQmxErrorSamplesNotYetAvailable;
+					}
+
+					// Sleep most of the way, spin the rest: a sleep alone
+					// overshoots periods of 100 us.
+					std::this_thread::sleep_until(target - std::chrono::microseconds(100));
+					while (std::chrono::steady_clock::now() < target) {
+					}
+
+					task->acquired.store(next);
+					return 0;
+				}
+
+				// Reads `width` elements per channel and sample; `store` writes
+				// those of one channel and sample.
+				template <typename T, typename TStore>
+				int32 ReadElements(TaskHandle handle, int32 numSampsPerChan,
+					float64 timeout, bool32 fillMode, T* data, uInt32 width,
+					uInt32 arraySizeInElements, int32* sampsPerChanRead,
+					TStore store) {
+
+					SimTask* task = ToTask(handle);
+
+					if (sampsPerChanRead != NULL) {
+						*sampsPerChanRead = 0;
+					}
+
+					if (task == nullptr) {
+						return DAQmxErrorInvalidTask;
+					}
+
+					const uInt32 channels = task->ChannelCount();
+
+					if (channels == 0) {
+						return DAQmxErrorInvalidTask;
+					}
+
+					uInt64 position = task->readPosition.load();
+					uInt64 available;
+					int32 status = 0;
+
+					if (!task->timed) {
+						// Software timed: one scan on demand.
+						available = (numSampsPerChan <= 0) ? 1 : (uInt64)numSampsPerChan;
+						task->acquired.store(position + available);
+					}
+					else if (task->SinglePoint()) {
+						// The sample of the last tick; a read without a wait
+						// waits for the next one.
+						if (numSampsPerChan > 1) {
+							return DAQmxErrorInvalidAttributeValue;
+						}
+						if (task->acquired.load() == position) {
+							int32 status = WaitForTick(task, timeout, NULL);
+							if (status != 0) {
+								return status;
+							}
+						}
+						available = 1;
+						position = task->acquired.load() - 1;
+					}
+					else {
+						const uInt64 wanted = (numSampsPerChan == DAQmx_Val_Auto)
+							? 0 : (uInt64)std::max<int32>(numSampsPerChan, 0);
+
+						std::unique_lock<std::mutex> lock(task->mutex);
+						auto ready = [&]() {
+							return task->acquired.load() - position >= wanted;
+						};
+
+						if (timeout < 0) {
+							task->dataAvailable.wait(lock, ready);
+						}
+						else if (!task->dataAvailable.wait_for(lock,
+							std::chrono::duration<double>(timeout), ready)) {
+							return DAQmxErrorSamplesNotYetAvailable;
+						}
+
+						available = task->acquired.load() - position;
+
+						if (available > task->BufferSize()) {
+							return DAQmxErrorSamplesNoLongerAvailable;
+						}
+
+						if (numSampsPerChan != DAQmx_Val_Auto) {
+							available = wanted;
+						}
+
+						if (position == task->shortReadAt && available > task->shortReadSamples) {
+							available = task->shortReadSamples;
+							status = DAQmxErrorSamplesNotYetAvailable;
+						}
+					}
+
+					if (available * channels * width > arraySizeInElements) {
+						return DAQmxErrorReadBufferTooSmall;
+					}
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt64 i = 0; i < available; i++) {
+
+							const uInt64 index = (fillMode == DAQmx_Val_GroupByChannel)
+								? ch * available + i : i * channels + ch;
+							store(data + index * width, ch, task->origin.load() + position + i);
+						}
+					}
+
+					task->readPosition.store(position + available);
+
+					if (sampsPerChanRead != NULL) {
+						*sampsPerChanRead = (int32)available;
+					}
+					return status;
+				}
+
+				template <typename T, typename TConvert>
+				int32 ReadSamples(TaskHandle handle, int32 numSampsPerChan,
+					float64 timeout, bool32 fillMode, T* data,
+					uInt32 arraySizeInSamps, int32* sampsPerChanRead,
+					TConvert convert) {
+
+					return ReadElements(handle, numSampsPerChan, timeout, fillMode, data, 1,
+						arraySizeInSamps, sampsPerChanRead,
+						[&](T* element, uInt32 ch, uInt64 i) { *element = convert(ch, i); });
+				}
+
+				// Copies the samples of an analog output write into the device
+				// buffer, waiting up to `timeout` for room. Binary writes store
+				// the raw codes.
+				template <typename T>
+				int32 WriteSamples(TaskHandle handle, int32 numSampsPerChan, bool32 autoStart,
+					float64 timeout, bool32 dataLayout, const T* data,
+					int32* sampsPerChanWritten) {
+
+					SimTask* task = ToTask(handle);
+
+					if (sampsPerChanWritten != NULL) {
+						*sampsPerChanWritten = 0;
+					}
+
+					if (task == nullptr) {
+						return DAQmxErrorInvalidTask;
+					}
+
+					if (!task->output) {
+						return DAQmxErrorWriteNoOutputChansInTask;
+					}
+
+					const uInt32 channels = task->ChannelCount();
+					const uInt64 bufferSize = task->BufferSize();
+					const uInt64 n = (uInt64)std::max<int32>(numSampsPerChan, 0);
+
+					if (task->SinglePoint()) {
+						// No buffer: the scans go out on the next tick.
+						std::lock_guard<std::mutex> lock(task->mutex);
+
+						for (uInt64 i = 0; i < n; i++) {
+							for (uInt32 ch = 0; ch < channels; ch++) {
+								if (task->generatedRecord.size() < SimGeneratedRecordLimit) {
+									task->generatedRecord.push_back((float64)data[
+										(dataLayout == DAQmx_Val_GroupByChannel) ? ch * n + i : i * channels + ch]);
+								}
+							}
+						}
+						task->written.fetch_add(n);
+
+						if (sampsPerChanWritten != NULL) {
+							*sampsPerChanWritten = (int32)n;
+						}
+						return autoStart ? DAQmxStartTask(handle) : 0;
+					}
+
+					if (n > bufferSize) {
+						return DAQmxErrorWriteBufferTooSmall;
+					}
+
+					{
+						std::unique_lock<std::mutex> lock(task->mutex);
+
+						if (task->error != 0) {
+							return task->error;
+						}
+
+						if (task->outputBuffer.size() != bufferSize * channels) {
+							task->outputBuffer.assign(bufferSize * channels, 0.0);
+						}
+
+						// Samples regenerated in the meantime are not generated again.
+						if (task->written.load() < task->acquired.load()) {
+							task->written.store(task->acquired.load());
+						}
+
+						auto room = [&]() {
+							return task->error != 0 || !task->running.load()
+								|| task->written.load() + n - task->acquired.load() <= bufferSize;
+						};
+
+						if (timeout < 0) {
+							task->dataAvailable.wait(lock, room);
+						}
+						else {
+							task->dataAvailable.wait_for(lock,
+								std::chrono::duration<double>(timeout), room);
+						}
+
+						if (task->error != 0) {
+							return task->error;
+						}
+
+						const uInt64 first = task->written.load();
+
+						if (first + n - task->acquired.load() > bufferSize) {
+							return DAQmxErrorSamplesCanNotYetBeWritten;
+						}
+
+						for (uInt64 i = 0; i < n; i++) {
+
+							float64* scan = task->outputBuffer.data() + ((first + i) % bufferSize) * channels;
+
+							for (uInt32 ch = 0; ch < channels; ch++) {
+								scan[ch] = (float64)data[(dataLayout == DAQmx_Val_GroupByChannel)
+									? ch * n + i : i * channels + ch];
+							}
+						}
+
+						task->written.store(first + n);
+					}
+
+					if (sampsPerChanWritten != NULL) {
+						*sampsPerChanWritten = (int32)n;
+					}
+
+					return autoStart ? DAQmxStartTask(handle) : 0;
+				}
+
+				// Lines per channel of a digital task, 0 for analog tasks.
+				uInt32 LinesPerChannel(const SimTask* task) {
+
+					uInt32 lines = 0;
+
+					for (const SimChannel& channel : task->channels) {
+						lines = std::max(lines, channel.lines);
+					}
+					return lines;
+				}
+
+				int32 AddDigitalChannels(TaskHandle taskHandle, const char lines[],
+					int32 lineGrouping) {
+
+					SimTask* task = ToTask(taskHandle);
+
+					if (task == nullptr) {
+						return DAQmxErrorInvalidTask;
+					}
+
+					SimTask parsed;
+					AddChannels(&parsed, lines);
+
+					if (parsed.channels.empty() || parsed.channels.size() > 32) {
+						return DAQmxErrorInvalidAttributeValue;
+					}
+
+					if (lineGrouping == DAQmx_Val_ChanPerLine) {
+						for (SimChannel& channel : parsed.channels) {
+							task->channels.push_back({ channel.name, 1 });
+						}
+					}
+					else {
+						task->channels.push_back({ lines, (uInt32)parsed.channels.size() });
+					}
+					return 0;
+				}
+			}
+
+			void SimSetClockMode(SimClockMode mode) {
+				g_clockMode.store(mode);
+			}
+
+			void SimSetCallbackDelay(uInt32 microseconds) {
+				g_callbackDelayUs.store(microseconds);
+			}
+
+			int16 SimRawSample(uInt32 channel, uInt64 index) {
+				return Table().values[(index * (channel + 1) + channel * 97)
+					& (WaveTableSize - 1)];
+			}
+
+			int SimLiveTaskCount() {
+				return g_liveTasks.load();
+			}
+
+			std::vector<uInt8> SimWrittenDigitalLines(TaskHandle taskHandle) {
+
+				SimTask* task = ToTask(taskHandle);
+				return (task != nullptr) ? task->writtenLines : std::vector<uInt8>();
+			}
+
+			std::vector<float64> SimGeneratedAnalog(TaskHandle taskHandle) {
+
+				SimTask* task = ToTask(taskHandle);
+
+				if (task == nullptr) {
+					return std::vector<float64>();
+				}
+
+				std::lock_guard<std::mutex> lock(task->mutex);
+				return task->generatedRecord;
+			}
+
+			int32 SimRaiseSignal(TaskHandle taskHandle, int32 signalId) {
+
+				SimTask* task = ToTask(taskHandle);
+
+				if (task == nullptr) {
+					return DAQmxErrorInvalidTask;
+				}
+
+				DAQmxSignalEventCallbackPtr callback = nullptr;
+				void* data = nullptr;
+				{
+					std::lock_guard<std::mutex> lock(task->callbackMutex);
+
+					for (const SimTask::SignalCallback& signal : task->signalCallbacks) {
+						if (signal.signalId == signalId) {
+							callback = signal.callback;
+							data = signal.data;
+						}
+					}
+				}
+
+				if (callback != nullptr) {
+					callback(task, signalId, data);
+				}
+				return 0;
+			}
+
+			uInt64 SimRegeneratedSamples(TaskHandle taskHandle) {
+
+				SimTask* task = ToTask(taskHandle);
+
+				if (task == nullptr) {
+					return 0;
+				}
+
+				std::lock_guard<std::mutex> lock(task->mutex);
+				return task->regenerated;
+			}
+
+			int32 SimShortenRead(TaskHandle taskHandle, uInt64 firstSample, uInt32 samplesPerChannel) {
+
+				SimTask* task = ToTask(taskHandle);
+
+				if (task == nullptr) {
+					return DAQmxErrorInvalidTask;
+				}
+
+				std::lock_guard<std::mutex> lock(task->mutex);
+				task->shortReadAt = firstSample;
+				task->shortReadSamples = samplesPerChannel;
+				return 0;
+			}
+		}
+
+		using namespace Simulation;
+
+		int32 __CFUNC DAQmxCreateTask(const char taskName[], TaskHandle* taskHandle) {
+
+			if (taskHandle == NULL) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			SimTask* task = new SimTask();
+			task->name = (taskName != NULL) ? taskName : "";
+			*taskHandle = task;
+			g_liveTasks.fetch_add(1);
+
+			std::lock_guard<std::mutex> lock(g_routeMutex);
+			g_tasks.push_back(task);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxStopTask(TaskHandle taskHandle) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			task->running.store(false);
+			task->armed.store(false);
+
+			if (task->clock.joinable()) {
+				if (task->clock.get_id() == std::this_thread::get_id()) {
+					task->clock.detach();
+				}
+				else {
+					task->clock.join();
+				}
+			}
+
+			// The next generation starts from new writes.
+			if (task->output) {
+				std::lock_guard<std::mutex> lock(task->mutex);
+				task->written.store(0);
+			}
+			task->dataAvailable.notify_all();
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxClearTask(TaskHandle taskHandle) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			DAQmxStopTask(taskHandle);
+			{
+				std::lock_guard<std::mutex> lock(g_routeMutex);
+				g_tasks.erase(std::find(g_tasks.begin(), g_tasks.end(), task));
+			}
+			delete task;
+			g_liveTasks.fetch_sub(1);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxStartTask(TaskHandle taskHandle) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			if (task->running.load()) {
+				return 0;
+			}
+
+			if (task->clock.joinable()) {
+				task->clock.join();
+			}
+
+			if (task->output && task->written.load() == 0 && !task->SinglePoint()) {
+				return DAQmxErrorOutputBufferEmpty;
+			}
+
+			task->acquired.store(0);
+			task->readPosition.store(0);
+			task->clockMode = g_clockMode.load();
+			{
+				std::lock_guard<std::mutex> lock(task->mutex);
+				task->error = 0;
+				task->regenerated = 0;
+				task->generatedRecord.clear();
+			}
+			task->started = std::chrono::steady_clock::now();
+
+			std::lock_guard<std::mutex> lock(g_routeMutex);
+
+			// A task on the clock of another one that is already running
+			// and not waiting for a trigger starts with the next tick.
+			SimTask* clockMaster = FindExporter(DAQmx_Val_SampleClock, task->clockSource);
+			task->origin.store((clockMaster != nullptr && clockMaster->running.load())
+				? clockMaster->acquired.load() : 0);
+			task->armed.store(!task->triggerSource.empty());
+			task->running.store(true);
+
+			if (task->timed && !task->SinglePoint()) {
+				task->clock = std::thread(RunClock, task);
+			}
+
+			// Starting sends the start trigger to the tasks armed on it.
+			for (SimTask* other : g_tasks) {
+				if (other != task && other->armed.load()
+					&& Exports(task, DAQmx_Val_StartTrigger, other->triggerSource)) {
+
+					SimTask* otherClock = FindExporter(DAQmx_Val_SampleClock, other->clockSource);
+					other->origin.store((otherClock != nullptr && otherClock != task)
+						? otherClock->acquired.load() : 0);
+					other->armed.store(false);
+				}
+			}
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxTaskControl(TaskHandle taskHandle, int32 action) {
+
+			if (taskHandle == NULL) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			switch (action) {
+			case DAQmx_Val_Task_Start:
+				return DAQmxStartTask(taskHandle);
+			case DAQmx_Val_Task_Stop:
+			case DAQmx_Val_Task_Abort:
+				return DAQmxStopTask(taskHandle);
+			default:
+				return 0;
+			}
+		}
+
+		int32 __CFUNC DAQmxIsTaskDone(TaskHandle taskHandle, bool32* isTaskDone) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*isTaskDone = task->running.load() ? FALSE : TRUE;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxWaitForNextSampleClock(TaskHandle taskHandle, float64 timeout,
+			bool32* isLate) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			if (!task->SinglePoint()) {
+				return DAQmxErrorWaitForNextSampClkNotSupported;
+			}
+
+			return WaitForTick(task, timeout, isLate);
+		}
+
+		int32 __CFUNC DAQmxCreateAIVoltageChan(TaskHandle taskHandle,
+			const char physicalChannel[], const char /*nameToAssignToChannel*/[],
+			int32 /*terminalConfig*/, float64 /*minVal*/, float64 /*maxVal*/, int32 /*units*/,
+			const char /*customScaleName*/[]) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			AddChannels(task, physicalChannel);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxCreateAOVoltageChan(TaskHandle taskHandle,
+			const char physicalChannel[], const char /*nameToAssignToChannel*/[],
+			float64 /*minVal*/, float64 /*maxVal*/, int32 /*units*/, const char /*customScaleName*/[]) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			AddChannels(task, physicalChannel);
+			task->output = true;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxCreateDIChan(TaskHandle taskHandle, const char lines[],
+			const char /*nameToAssignToLines*/[], int32 lineGrouping) {
+
+			return AddDigitalChannels(taskHandle, lines, lineGrouping);
+		}
+
+		int32 __CFUNC DAQmxCreateDOChan(TaskHandle taskHandle, const char lines[],
+			const char /*nameToAssignToLines*/[], int32 lineGrouping) {
+
+			return AddDigitalChannels(taskHandle, lines, lineGrouping);
+		}
+
+		int32 __CFUNC DAQmxCfgSampClkTiming(TaskHandle taskHandle,
+			const char source[], float64 rate, int32 /*activeEdge*/,
+			int32 sampleMode, uInt64 sampsPerChan) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			if (rate <= 0.0) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			task->timed = true;
+			task->clockSource = (source != NULL) ? source : "";
+			task->rate = rate;
+			task->sampleMode = sampleMode;
+			task->finiteSamples = sampsPerChan;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxCfgDigEdgeStartTrig(TaskHandle taskHandle,
+			const char triggerSource[], int32 /*triggerEdge*/) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			if (triggerSource == NULL || triggerSource[0] == '\0') {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			std::lock_guard<std::mutex> lock(g_routeMutex);
+			task->triggerSource = triggerSource;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxDisableStartTrig(TaskHandle taskHandle) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			std::lock_guard<std::mutex> lock(g_routeMutex);
+			task->triggerSource.clear();
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxExportSignal(TaskHandle taskHandle, int32 signalID,
+			const char outputTerminal[]) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			if (outputTerminal == NULL || outputTerminal[0] == '\0'
+				|| (signalID != DAQmx_Val_SampleClock && signalID != DAQmx_Val_StartTrigger)) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			std::lock_guard<std::mutex> lock(g_routeMutex);
+			task->exports.emplace_back(signalID, outputTerminal);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxCfgInputBuffer(TaskHandle taskHandle, uInt32 numSampsPerChan) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			task->bufferSize = numSampsPerChan;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxCfgOutputBuffer(TaskHandle taskHandle, uInt32 numSampsPerChan) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			std::lock_guard<std::mutex> lock(task->mutex);
+			task->bufferSize = numSampsPerChan;
+			task->outputBuffer.clear();
+			task->written.store(0);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxSetWriteRegenMode(TaskHandle taskHandle, int32 data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			if (data != DAQmx_Val_AllowRegen && data != DAQmx_Val_DoNotAllowRegen) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			task->allowRegen = (data == DAQmx_Val_AllowRegen);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxRegisterEveryNSamplesEvent(TaskHandle task,
+			int32 /*everyNsamplesEventType*/, uInt32 nSamples, uInt32 /*options*/,
+			DAQmxEveryNSamplesEventCallbackPtr callbackFunction, void* callbackData) {
+
+			SimTask* simTask = ToTask(task);
+
+			if (simTask == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			std::lock_guard<std::mutex> lock(simTask->callbackMutex);
+			simTask->everyNCallback = callbackFunction;
+			simTask->everyNData = callbackData;
+			simTask->everyN = (callbackFunction != NULL) ? nSamples : 0;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxRegisterDoneEvent(TaskHandle task, uInt32 /*options*/,
+			DAQmxDoneEventCallbackPtr callbackFunction, void* callbackData) {
+
+			SimTask* simTask = ToTask(task);
+
+			if (simTask == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			std::lock_guard<std::mutex> lock(simTask->callbackMutex);
+			simTask->doneCallback = callbackFunction;
+			simTask->doneData = callbackData;
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxRegisterSignalEvent(TaskHandle task, int32 signalID, uInt32 /*options*/,
+			DAQmxSignalEventCallbackPtr callbackFunction, void* callbackData) {
+
+			SimTask* simTask = ToTask(task);
+
+			if (simTask == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			std::lock_guard<std::mutex> lock(simTask->callbackMutex);
+			auto& signals = simTask->signalCallbacks;
+
+			signals.erase(std::remove_if(signals.begin(), signals.end(),
+				[signalID](const SimTask::SignalCallback& s) { return s.signalId == signalID; }),
+				signals.end());
+
+			if (callbackFunction != NULL) {
+				signals.push_back({ signalID, callbackFunction, callbackData });
+			}
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxReadAnalogF64(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, float64 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return SimScaledSample(ch, i); });
+		}
+
+		int32 __CFUNC DAQmxReadBinaryI16(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, int16 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return SimRawSample(ch, i); });
+		}
+
+		int32 __CFUNC DAQmxReadBinaryU16(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, uInt16 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return (uInt16)(SimRawSample(ch, i) + 32768); });
+		}
+
+		int32 __CFUNC DAQmxReadBinaryI32(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, int32 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return (int32)SimRawSample(ch, i); });
+		}
+
+		int32 __CFUNC DAQmxReadBinaryU32(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, uInt32 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return (uInt32)(SimRawSample(ch, i) + 32768); });
+		}
+
+		int32 __CFUNC DAQmxReadDigitalU16(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, uInt16 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return (uInt16)SimDigitalSample(ch, i); });
+		}
+
+		int32 __CFUNC DAQmxReadDigitalU32(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, uInt32 readArray[],
+			uInt32 arraySizeInSamps, int32* sampsPerChanRead, bool32* /*reserved*/) {
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout, fillMode,
+				readArray, arraySizeInSamps, sampsPerChanRead,
+				[](uInt32 ch, uInt64 i) { return SimDigitalSample(ch, i); });
+		}
+
+		int32 __CFUNC DAQmxReadDigitalLines(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, bool32 fillMode, uInt8 readArray[], uInt32 arraySizeInBytes,
+			int32* sampsPerChanRead, int32* numBytesPerSamp, bool32* /*reserved*/) {
+
+			SimTask* task = ToTask(taskHandle);
+			const uInt32 lines = (task != nullptr) ? LinesPerChannel(task) : 0;
+
+			if (numBytesPerSamp != NULL) {
+				*numBytesPerSamp = (int32)lines;
+			}
+
+			if (task != nullptr && lines == 0) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			return ReadElements(taskHandle, numSampsPerChan, timeout, fillMode, readArray,
+				lines, arraySizeInBytes, sampsPerChanRead,
+				[lines](uInt8* element, uInt32 ch, uInt64 i) {
+					for (uInt32 line = 0; line < lines; line++) {
+						element[line] = SimDigitalLine(ch, line, i);
+					}
+				});
+		}
+
+		int32 __CFUNC DAQmxWriteDigitalLines(TaskHandle taskHandle, int32 numSampsPerChan,
+			bool32 /*autoStart*/, float64 /*timeout*/, bool32 /*dataLayout*/, const uInt8 writeArray[],
+			int32* sampsPerChanWritten, bool32* /*reserved*/) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (sampsPerChanWritten != NULL) {
+				*sampsPerChanWritten = 0;
+			}
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			const uInt32 lines = LinesPerChannel(task);
+
+			if (lines == 0 || numSampsPerChan < 0) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			const size_t bytes = (size_t)numSampsPerChan * task->ChannelCount() * lines;
+			task->writtenLines.insert(task->writtenLines.end(), writeArray, writeArray + bytes);
+
+			if (sampsPerChanWritten != NULL) {
+				*sampsPerChanWritten = numSampsPerChan;
+			}
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxWriteAnalogF64(TaskHandle taskHandle, int32 numSampsPerChan,
+			bool32 autoStart, float64 timeout, bool32 dataLayout, const float64 writeArray[],
+			int32* sampsPerChanWritten, bool32* /*reserved*/) {
+
+			return WriteSamples(taskHandle, numSampsPerChan, autoStart, timeout,
+				dataLayout, writeArray, sampsPerChanWritten);
+		}
+
+		int32 __CFUNC DAQmxWriteBinaryI16(TaskHandle taskHandle, int32 numSampsPerChan,
+			bool32 autoStart, float64 timeout, bool32 dataLayout, const int16 writeArray[],
+			int32* sampsPerChanWritten, bool32* /*reserved*/) {
+
+			return WriteSamples(taskHandle, numSampsPerChan, autoStart, timeout,
+				dataLayout, writeArray, sampsPerChanWritten);
+		}
+
+		int32 __CFUNC DAQmxReadRaw(TaskHandle taskHandle, int32 numSampsPerChan,
+			float64 timeout, void* readArray, uInt32 arraySizeInBytes,
+			int32* sampsRead, int32* numBytesPerSamp, bool32* /*reserved*/) {
+
+			// AI raw data is interleaved by scan, two bytes per sample.
+			if (numBytesPerSamp != NULL) {
+				*numBytesPerSamp = (int32)sizeof(int16);
+			}
+
+			return ReadSamples(taskHandle, numSampsPerChan, timeout,
+				DAQmx_Val_GroupByScanNumber, static_cast<int16*>(readArray),
+				arraySizeInBytes / (uInt32)sizeof(int16), sampsRead,
+				[](uInt32 ch, uInt64 i) { return SimRawSample(ch, i); });
+		}
+
+		int32 __CFUNC DAQmxGetAIDevScalingCoeff(TaskHandle taskHandle,
+			const char channel[], float64* data, uInt32 arraySizeInElements) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			for (uInt32 ch = 0; ch < task->ChannelCount(); ch++) {
+
+				if (task->channels[ch].name != channel) {
+					continue;
+				}
+
+				// Like DAQmx: without an array, report the required size.
+				if (data == NULL || arraySizeInElements == 0) {
+					return (int32)SimAICoeffCount;
+				}
+
+				float64 coeffs[SimAICoeffCount];
+				SimAICoefficients(ch, coeffs);
+
+				for (uInt32 k = 0; k < SimAICoeffCount && k < arraySizeInElements; k++) {
+					data[k] = coeffs[k];
+				}
+				return 0;
+			}
+
+			return DAQmxErrorInvalidAttributeValue;
+		}
+
+		int32 __CFUNC DAQmxGetReadTotalSampPerChanAcquired(TaskHandle taskHandle,
+			uInt64* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*data = task->acquired.load();
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetReadCurrReadPos(TaskHandle taskHandle, uInt64* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*data = task->readPosition.load();
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetReadAvailSampPerChan(TaskHandle taskHandle, uInt32* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*data = (uInt32)(task->acquired.load() - task->readPosition.load());
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetWriteTotalSampPerChanGenerated(TaskHandle taskHandle,
+			uInt64* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*data = task->acquired.load();
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetWriteSpaceAvail(TaskHandle taskHandle, uInt32* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			std::lock_guard<std::mutex> lock(task->mutex);
+			const uInt64 pending = task->written.load() - std::min(task->written.load(),
+				task->acquired.load());
+			*data = (uInt32)(task->BufferSize() - std::min<uInt64>(pending, task->BufferSize()));
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetTaskNumChans(TaskHandle taskHandle, uInt32* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*data = task->ChannelCount();
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetReadDigitalLinesBytesPerChan(TaskHandle taskHandle,
+			uInt32* data) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			*data = LinesPerChannel(task);
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetWriteDigitalLinesBytesPerChan(TaskHandle taskHandle,
+			uInt32* data) {
+
+			return DAQmxGetReadDigitalLinesBytesPerChan(taskHandle, data);
+		}
+
+		int32 __CFUNC DAQmxGetNthTaskChannel(TaskHandle taskHandle, uInt32 index,
+			char buffer[], int32 bufferSize) {
+
+			SimTask* task = ToTask(taskHandle);
+
+			if (task == nullptr) {
+				return DAQmxErrorInvalidTask;
+			}
+
+			// DAQmx indices are 1-based.
+			if (index == 0 || index > task->ChannelCount()) {
+				return DAQmxErrorInvalidAttributeValue;
+			}
+
+			std::snprintf(buffer, (size_t)bufferSize, "%s",
+				task->channels[index - 1].name.c_str());
+			return 0;
+		}
+
+		int32 __CFUNC DAQmxGetErrorString(int32 errorCode, char errorString[],
+			uInt32 bufferSize) {
+
+			std::snprintf(errorString, bufferSize, "Simulated NI-DAQmx status %d.",
+				(int)errorCode);
+			return 0;
+		}
+	}
+}
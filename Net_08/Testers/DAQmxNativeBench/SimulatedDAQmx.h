@@ -0,0 +1,176 @@
+#pragma once
+
+/*
+* Simulated NI-DAQmx stand-in used to exercise the native engines of the
+* DAQmxNETDriver on machines without the NI driver (Linux CI, laptops).
+*
+* Only the subset of the C API used by the native layer is implemented.
+* Analog input tasks produce a deterministic waveform (see SimRawSample)
+* so that consumers can verify every sample they receive; digital line
+* channels (DAQmxCreateDIChan/DOChan) produce the bits of SimDigitalSample.
+*
+* Signals exported with DAQmxExportSignal (sample clock and start trigger)
+* can be used by other tasks as clock source and digital edge start
+* trigger. A task armed on a start trigger acquires nothing until the
+* exporting task starts; a task that joins a shared clock already running
+* without a trigger starts counting at the current tick, so its samples
+* are offset from those of the clock owner exactly as on hardware. A task
+* on a shared clock never acquires ahead of the clock owner.
+*
+* Analog output tasks (DAQmxCreateAOVoltageChan) generate from a circular
+* device buffer filled by DAQmxWriteAnalogF64/WriteBinaryI16 and raise
+* EveryNSamplesTransferred events as samples are generated. When the
+* writer falls behind they repeat old data if regeneration is allowed and
+* stop with DAQmxErrorGenStoppedToPreventRegenOfOldSamples otherwise. In
+* free run they never generate what was not written. Stopping an output
+* task empties its buffer.
+*
+* Tasks timed with DAQmx_Val_HWTimedSinglePoint have no buffer and no
+* clock thread: DAQmxWaitForNextSampleClock sleeps until the next tick
+* (or returns at once in free run), reads return the sample of the last
+* tick, and writes go straight to the generated record. A wait that
+* missed ticks skips to the latest one and returns the late warning.
+*
+* DAQmxRegisterSignalEvent callbacks for DAQmx_Val_SampleClock run on the
+* clock thread once per block it produces, not once per sample. Other
+* signals (change detection, counter output events, ...) are raised by
+* SimRaiseSignal on the calling thread, as a driver thread would.
+*/
+
+#include <vector>
+
+#include "Native/NativeDAQmx.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNetApi {
+
+		namespace Simulation {
+
+			/**
+			* @brief Pacing of the simulated sample clock.
+			*/
+			enum class SimClockMode {
+
+				/** Samples are produced at the configured rate. */
+				RealTime,
+
+				/** Samples are produced as fast as the reader drains them.
+				*   Used to measure the cost of the consumer path. */
+				FreeRun
+			};
+
+			/**
+			* @brief Selects the pacing of tasks started after the call.
+			*/
+			void SimSetClockMode(SimClockMode mode);
+
+			/**
+			* @brief Time the clock thread waits between picking the callbacks
+			*        of a block and calling them, so that a callback
+			*        unregistered meanwhile is still called. `0` by default.
+			*/
+			void SimSetCallbackDelay(uInt32 microseconds);
+
+			/**
+			* @brief Raw (unscaled) code of sample `index` of channel `channel`.
+			*/
+			int16 SimRawSample(uInt32 channel, uInt64 index);
+
+			/**
+			* @brief Number of scaling coefficients reported per simulated AI channel.
+			*/
+			constexpr uInt32 SimAICoeffCount = 4;
+
+			/**
+			* @brief Device scaling polynomial of simulated AI channel `channel`,
+			*        constant term first. Every channel gets a slightly different
+			*        offset, gain and curvature so per-channel scaling is exercised.
+			*/
+			inline void SimAICoefficients(uInt32 channel, float64 coeffs[SimAICoeffCount]) {
+				coeffs[0] = 0.001 * channel;
+				coeffs[1] = (10.0 / 32768.0) * (1.0 + 0.0001 * channel);
+				coeffs[2] = 1.0e-12 * channel;
+				coeffs[3] = 0.0;
+			}
+
+			/**
+			* @brief Scaled value of sample `index` of channel `channel`, i.e. what
+			*        DAQmxReadAnalogF64 returns for it.
+			*/
+			inline float64 SimScaledSample(uInt32 channel, uInt64 index) {
+				float64 c[SimAICoeffCount];
+				SimAICoefficients(channel, c);
+				const float64 x = (float64)SimRawSample(channel, index);
+				return ((c[3] * x + c[2]) * x + c[1]) * x + c[0];
+			}
+
+			/**
+			* @brief Port value of sample `index` of channel `channel`, i.e. what
+			*        DAQmxReadDigitalU32 returns for it. DAQmxReadDigitalU16
+			*        returns the low 16 bits.
+			*/
+			inline uInt32 SimDigitalSample(uInt32 channel, uInt64 index) {
+				return (uInt32)(uInt16)SimRawSample(channel, index) ^ ((uInt32)index << 16);
+			}
+
+			/**
+			* @brief State of line `line` of digital channel `channel` at sample
+			*        `index`, i.e. what DAQmxReadDigitalLines returns for it: bit
+			*        `line` of `SimDigitalSample`.
+			*/
+			inline uInt8 SimDigitalLine(uInt32 channel, uInt32 line, uInt64 index) {
+				return (uInt8)((SimDigitalSample(channel, index) >> (line & 31)) & 1);
+			}
+
+			/**
+			* @brief Number of simulated tasks currently alive.
+			*/
+			int SimLiveTaskCount();
+
+			/**
+			* @brief Line bytes written to `task` with DAQmxWriteDigitalLines so
+			*        far, in the layout they were written in.
+			*/
+			std::vector<uInt8> SimWrittenDigitalLines(TaskHandle task);
+
+			/**
+			* @brief Most samples `SimGeneratedAnalog` keeps per task.
+			*/
+			constexpr size_t SimGeneratedRecordLimit = 1 << 22;
+
+			/**
+			* @brief Samples generated by analog output task `task` since it was
+			*        last started, interleaved by scan, up to
+			*        `SimGeneratedRecordLimit`. Binary writes are recorded as
+			*        their raw codes.
+			*/
+			std::vector<float64> SimGeneratedAnalog(TaskHandle task);
+
+			/**
+			* @brief Calls the DAQmxRegisterSignalEvent callback of `task` for
+			*        `signalId`, if any, on the calling thread.
+			*
+			* @return `0`, or `DAQmxErrorInvalidTask`.
+			*/
+			int32 SimRaiseSignal(TaskHandle task, int32 signalId);
+
+			/**
+			* @brief Samples per channel that `task` generated again from old
+			*        data because nothing new had been written (regeneration).
+			*/
+			uInt64 SimRegeneratedSamples(TaskHandle task);
+
+			/**
+			* @brief Cuts short the buffered read of `task` that starts at
+			*        sample `firstSample`: it returns at most
+			*        `samplesPerChannel` samples per channel and
+			*        `DAQmxErrorSamplesNotYetAvailable`, as a read that timed
+			*        out part way does. The rest is left for the next read.
+			*
+			* @return `0`, or `DAQmxErrorInvalidTask`.
+			*/
+			int32 SimShortenRead(TaskHandle task, uInt64 firstSample, uInt32 samplesPerChannel);
+		}
+	}
+}
@@ -0,0 +1,613 @@
+// Checks the per-block statistics stage (BlockStatisticsCore +
+// StatisticsKernels) against a long double two-pass reference for every SIMD
+// level, layout and block split, reads it from a second thread while blocks
+// are published, runs it inside the acquisition engine, then measures its
+// throughput against a per-sample integrator.
+
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AcquisitionEngineCore.h"
+#include "Native/BlockStatisticsCore.h"
+#include "Native/CpuFeatures.h"
+#include "Native/NativeStatus.h"
+#include "Native/RawScalingCore.h"
+#include "Native/StatisticsKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			struct Reference {
+				uInt64 count;
+				long double sum;
+				long double min;
+				long double max;
+				long double m2;
+			};
+
+			template <typename T>
+			Reference ComputeReference(const std::vector<T>& x, size_t begin, size_t count,
+				size_t stride, long double offset, long double gain) {
+
+				Reference r = { count, 0.0L, INFINITY, -INFINITY, 0.0L };
+
+				for (size_t i = 0; i < count; i++) {
+					const long double v = offset + gain * (long double)x[begin + i * stride];
+					r.sum += v;
+					r.min = (v < r.min) ? v : r.min;
+					r.max = (v > r.max) ? v : r.max;
+				}
+
+				const long double mean = (count > 0) ? r.sum / count : 0.0L;
+
+				for (size_t i = 0; i < count; i++) {
+					const long double d = offset + gain * (long double)x[begin + i * stride] - mean;
+					r.m2 += d * d;
+				}
+				return r;
+			}
+
+			void MergeReference(Reference& into, const Reference& run) {
+
+				if (run.count == 0) {
+					return;
+				}
+
+				const long double na = (long double)into.count;
+				const long double nb = (long double)run.count;
+				const long double delta = (into.count > 0)
+					? run.sum / nb - into.sum / na : 0.0L;
+
+				into.m2 += run.m2 + delta * delta * (na * nb / (na + nb));
+				into.count += run.count;
+				into.sum += run.sum;
+				into.min = (run.min < into.min) ? run.min : into.min;
+				into.max = (run.max > into.max) ? run.max : into.max;
+			}
+
+			bool Close(long double actual, long double expected, long double tolerance,
+				long double scale) {
+				return std::fabs(actual - expected) <= tolerance * (scale + std::fabs(expected));
+			}
+
+			bool Matches(const ChannelMoments& m, const Reference& r) {
+
+				if (m.count != r.count) {
+					return false;
+				}
+				if (r.count == 0) {
+					return m.sum == 0.0 && m.m2 == 0.0;
+				}
+
+				const long double spread = std::fabs(r.max) + std::fabs(r.min);
+				return m.min == (float64)r.min && m.max == (float64)r.max
+					&& Close((long double)m.sum + m.compensation, r.sum, 1e-14L, spread)
+					&& Close(m.m2, r.m2, 1e-9L, 1e-300L);
+			}
+
+			bool Matches(const ChannelStatistics& s, const Reference& r) {
+
+				if (s.count != r.count) {
+					return false;
+				}
+				if (r.count == 0) {
+					return s.sum == 0.0 && std::isnan(s.mean) && std::isnan(s.variance);
+				}
+
+				const long double n = (long double)r.count;
+				const long double mean = r.sum / n;
+				const long double variance = r.m2 / n;
+				const long double spread = std::fabs(r.max) + std::fabs(r.min);
+
+				return Close(s.min, r.min, 1e-15L, 0.0L) && Close(s.max, r.max, 1e-15L, 0.0L)
+					&& Close(s.sum, r.sum, 1e-13L, spread * n)
+					&& Close(s.mean, mean, 1e-13L, spread)
+					&& Close(s.variance, variance, 1e-9L, 1e-300L)
+					&& Close(s.rms, std::sqrt(variance + mean * mean), 1e-9L, 1e-300L);
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				BlockStatisticsCore statistics;
+				ChannelStatistics s[2];
+				uInt64 blocks = 0;
+				float64 data[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+				BENCH_CHECK(statistics.GetStatistics(s, s, 2, blocks) == NativeErrorInvalidState,
+					failures);
+				BENCH_CHECK(statistics.Accumulate(data, SampleFormat::Float64, 2,
+					DAQmx_Val_GroupByChannel) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(statistics.Configure(0) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(statistics.Configure(2) == NativeSuccess, failures);
+				BENCH_CHECK(statistics.Accumulate(data, SampleFormat::Int32, 2,
+					DAQmx_Val_GroupByChannel) == NativeErrorUnsupportedFormat, failures);
+				BENCH_CHECK(statistics.Accumulate(data, SampleFormat::Float64, 2, 12345)
+					== NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(statistics.Accumulate(nullptr, SampleFormat::Float64, 2,
+					DAQmx_Val_GroupByChannel) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(statistics.Accumulate(nullptr, SampleFormat::Float64, 0,
+					DAQmx_Val_GroupByChannel) == NativeSuccess, failures);
+
+				// An empty block counts as a block with empty statistics.
+				BENCH_CHECK(statistics.GetStatistics(s, nullptr, 2, blocks) == 2, failures);
+				BENCH_CHECK(blocks == 1 && s[0].count == 0 && std::isnan(s[1].mean), failures);
+				BENCH_CHECK(statistics.GetStatistics(s, nullptr, 1, blocks) == 1, failures);
+				return failures;
+			}
+
+			// Kernels against the reference over ragged lengths, around the
+			// vector widths and past the 32-bit widening point of the I16 sums.
+			int CheckKernels() {
+
+				int failures = 0;
+				uInt32 bad = 0;
+				std::mt19937_64 random(7);
+				const size_t sizes[] = { 0, 1, 7, 8, 15, 16, 17, 33, 1000, 16 * 16384 * 2 + 9 };
+
+				for (size_t size : sizes) {
+
+					std::vector<float64> f64(size);
+					std::vector<float64> offsetF64(size);
+					std::vector<int16> i16(size);
+					std::vector<int16> lowest(size, -32768);
+					std::vector<int16> highest(size, 32767);
+					std::normal_distribution<float64> noise(0.0, 1.0);
+					std::uniform_int_distribution<int32> codes(-32768, 32767);
+
+					for (size_t i = 0; i < size; i++) {
+						f64[i] = 5.0 * noise(random);
+						offsetF64[i] = 1.0e8 + 1.0e-3 * noise(random);
+						i16[i] = (int16)codes(random);
+					}
+
+					bad += !Matches(ComputeMomentsF64(f64.data(), size),
+						ComputeReference(f64, 0, size, 1, 0.0L, 1.0L));
+					bad += !Matches(ComputeMomentsF64(offsetF64.data(), size),
+						ComputeReference(offsetF64, 0, size, 1, 0.0L, 1.0L));
+					bad += !Matches(ComputeMomentsI16(i16.data(), size),
+						ComputeReference(i16, 0, size, 1, 0.0L, 1.0L));
+					bad += !Matches(ComputeMomentsI16(lowest.data(), size),
+						ComputeReference(lowest, 0, size, 1, 0.0L, 1.0L));
+					bad += !Matches(ComputeMomentsI16(highest.data(), size),
+						ComputeReference(highest, 0, size, 1, 0.0L, 1.0L));
+
+					// Split at an odd point and merged back.
+					if (size > 2) {
+						ChannelMoments m = ComputeMomentsF64(offsetF64.data(), size / 3);
+						MergeMoments(m, ComputeMomentsF64(offsetF64.data() + size / 3,
+							size - size / 3));
+						bad += !Matches(m, ComputeReference(offsetF64, 0, size, 1, 0.0L, 1.0L));
+					}
+				}
+
+				BENCH_CHECK(bad == 0, failures);
+				return failures;
+			}
+
+			// Streams ragged blocks of the simulated waveform through the stage
+			// and compares the last block and the running statistics after each.
+			int CheckStream(uInt32 channels, SampleFormat format, int32 fillMode,
+				const RawScalingCore* scaling) {
+
+				int failures = 0;
+				const uInt32 blockSizes[] = { 1, 7, 333, 1000, 0, 64, 2, 2500 };
+
+				BlockStatisticsCore statistics;
+				BENCH_CHECK(statistics.Configure(channels) == NativeSuccess, failures);
+				BENCH_CHECK(statistics.SetScaling(scaling) == NativeSuccess, failures);
+
+				std::vector<long double> offsets(channels, 0.0L);
+				std::vector<long double> gains(channels, 1.0L);
+
+				for (uInt32 ch = 0; ch < channels && scaling != nullptr; ch++) {
+					float64 coeffs[SimAICoeffCount];
+					SimAICoefficients(ch, coeffs);
+					offsets[ch] = coeffs[0];
+					gains[ch] = coeffs[1];
+				}
+
+				std::vector<Reference> totals(channels, Reference{ 0, 0.0L, INFINITY, -INFINITY, 0.0L });
+				std::vector<ChannelStatistics> last(channels);
+				std::vector<ChannelStatistics> total(channels);
+				uInt64 position = 0;
+				uInt64 expectedBlocks = 0;
+				uInt32 bad = 0;
+
+				for (int pass = 0; pass < 3; pass++) {
+					for (uInt32 n : blockSizes) {
+
+						std::vector<float64> f64((size_t)channels * n);
+						std::vector<int16> i16((size_t)channels * n);
+
+						for (uInt32 i = 0; i < n; i++) {
+							for (uInt32 ch = 0; ch < channels; ch++) {
+								const size_t at = (fillMode == DAQmx_Val_GroupByChannel)
+									? (size_t)ch * n + i : (size_t)i * channels + ch;
+								f64[at] = SimScaledSample(ch, position + i) + 50.0;
+								i16[at] = SimRawSample(ch, position + i);
+							}
+						}
+
+						const void* data = (format == SampleFormat::Float64)
+							? static_cast<const void*>(f64.data()) : static_cast<const void*>(i16.data());
+						BENCH_CHECK(statistics.Accumulate(data, format, n, fillMode) == NativeSuccess,
+							failures);
+						expectedBlocks++;
+
+						uInt64 blocks = 0;
+						BENCH_CHECK(statistics.GetStatistics(last.data(), total.data(), channels,
+							blocks) == (int32)channels, failures);
+						bad += (blocks != expectedBlocks);
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+
+							const size_t begin = (fillMode == DAQmx_Val_GroupByChannel) ? (size_t)ch * n : ch;
+							const size_t stride = (fillMode == DAQmx_Val_GroupByChannel) ? 1 : channels;
+							const Reference block = (format == SampleFormat::Float64)
+								? ComputeReference(f64, begin, n, stride, 0.0L, 1.0L)
+								: ComputeReference(i16, begin, n, stride, offsets[ch], gains[ch]);
+
+							MergeReference(totals[ch], block);
+							bad += !Matches(last[ch], block);
+							bad += !Matches(total[ch], totals[ch]);
+						}
+						position += n;
+					}
+				}
+
+				statistics.Reset();
+				uInt64 blocks = 1;
+				statistics.GetStatistics(last.data(), total.data(), channels, blocks);
+				bad += (blocks != 0 || total[0].count != 0 || !std::isnan(total[0].mean));
+
+				std::printf("    %u ch %s %-8s%s: %u bad\n", channels,
+					(format == SampleFormat::Float64) ? "F64" : "I16",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "by chan" : "by scan",
+					(scaling != nullptr) ? " scaled" : "", bad);
+
+				BENCH_CHECK(bad == 0, failures);
+				return failures;
+			}
+
+			int CheckAll() {
+
+				int failures = 0;
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("statistics", &task);
+				DAQmxCreateAIVoltageChan(task, "SimDev1/ai0:7", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				RawScalingCore scaling;
+				BENCH_CHECK(scaling.Capture(task) == NativeSuccess, failures);
+				DAQmxClearTask(task);
+
+				failures += CheckKernels();
+
+				for (uInt32 channels : { 1u, 3u, 8u }) {
+					for (int32 fillMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+						failures += CheckStream(channels, SampleFormat::Float64, fillMode, nullptr);
+						failures += CheckStream(channels, SampleFormat::Int16, fillMode, nullptr);
+					}
+				}
+
+				failures += CheckStream(8, SampleFormat::Int16, DAQmx_Val_GroupByScanNumber, &scaling);
+				failures += CheckStream(8, SampleFormat::Int16, DAQmx_Val_GroupByChannel, &scaling);
+				return failures;
+			}
+
+			// Every sample of block k is k, so a snapshot is consistent when the
+			// last block and the running statistics agree with its block count.
+			int CheckConcurrentReader(uInt32 blocksToWrite) {
+
+				int failures = 0;
+				const uInt32 channels = 4;
+				const uInt32 samples = 256;
+
+				BlockStatisticsCore statistics;
+				statistics.Configure(channels);
+
+				std::atomic<bool> done(false);
+				std::atomic<uInt32> torn(0);
+				std::atomic<uInt32> snapshots(0);
+
+				std::thread reader([&]() {
+
+					ChannelStatistics last[channels];
+					ChannelStatistics total[channels];
+
+					while (!done.load()) {
+
+						uInt64 blocks = 0;
+						statistics.GetStatistics(last, total, channels, blocks);
+						snapshots.fetch_add(1);
+
+						for (uInt32 ch = 0; ch < channels && blocks > 0; ch++) {
+
+							const float64 k = (float64)(blocks - 1);
+							const bool ok = last[ch].count == samples && last[ch].min == k
+								&& last[ch].max == k && total[ch].count == blocks * samples
+								&& total[ch].max == k && total[ch].min == 0.0;
+							torn.fetch_add(ok ? 0 : 1);
+						}
+					}
+				});
+
+				std::vector<float64> block((size_t)channels * samples);
+
+				for (uInt32 k = 0; k < blocksToWrite; k++) {
+					std::fill(block.begin(), block.end(), (float64)k);
+					statistics.Accumulate(block.data(), SampleFormat::Float64, samples,
+						DAQmx_Val_GroupByScanNumber);
+				}
+
+				done.store(true);
+				reader.join();
+
+				std::printf("  concurrent reader: %u blocks, %u snapshots, %u torn\n",
+					blocksToWrite, snapshots.load(), torn.load());
+
+				BENCH_CHECK(torn.load() == 0, failures);
+				return failures;
+			}
+
+			int CheckEngine(uInt32 blocks) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				const uInt32 channels = 8;
+				const uInt32 blockSamples = 1000;
+
+				BlockStatisticsCore statistics;
+				BENCH_CHECK(statistics.Configure(channels) == NativeSuccess, failures);
+
+				BlockStatisticsCore wrongChannels;
+				wrongChannels.Configure(channels - 1);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = channels;
+				config.samplesPerBlock = blockSamples;
+				config.ringBlocks = 16;
+				config.format = SampleFormat::Float64;
+				config.fillMode = DAQmx_Val_GroupByScanNumber;
+				config.ownsTask = true;
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("statistics", &task);
+				DAQmxCreateAIVoltageChan(task, "SimDev1/ai0:7", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", 250000.0, DAQmx_Val_Rising, DAQmx_Val_ContSamps, 0);
+
+				BENCH_CHECK(engine.SetStatistics(&statistics) == NativeErrorNotAttached, failures);
+				BENCH_CHECK(engine.Attach(task, config) == 0, failures);
+				BENCH_CHECK(engine.SetStatistics(&wrongChannels) == NativeErrorInvalidArgument,
+					failures);
+				BENCH_CHECK(engine.SetStatistics(&statistics) == NativeSuccess, failures);
+				BENCH_CHECK(engine.Start() == 0, failures);
+				BENCH_CHECK(engine.SetStatistics(nullptr) == NativeErrorAlreadyRunning, failures);
+
+				uInt32 consumed = 0;
+				uInt32 bad = 0;
+				BlockView view;
+				ChannelStatistics last[channels];
+				ChannelStatistics total[channels];
+
+				while (consumed < blocks && engine.WaitAcquireBlock(view, 2000)) {
+
+					uInt64 published = 0;
+					statistics.GetStatistics(last, total, channels, published);
+
+					// The consumer may lag behind, never lead.
+					bad += (published < consumed + 1);
+					bad += (last[0].count != blockSamples);
+					bad += !(total[0].min >= -10.5 && total[0].max <= 10.5);
+
+					engine.ReleaseBlock();
+					consumed++;
+				}
+
+				engine.Stop();
+				const AcquisitionEngineCounters counters = engine.Counters();
+				engine.Detach();
+
+				uInt64 published = 0;
+				statistics.GetStatistics(last, total, channels, published);
+
+				std::printf("  engine F64/ByScan: %u blocks, %llu blocks in statistics, "
+					"%llu dropped, %u bad\n", consumed, (unsigned long long)published,
+					(unsigned long long)counters.blocksDropped, bad);
+
+				BENCH_CHECK(consumed == blocks, failures);
+				BENCH_CHECK(bad == 0, failures);
+				// Dropped blocks are still in the statistics.
+				BENCH_CHECK(published == counters.blocksRead + counters.blocksDropped, failures);
+				BENCH_CHECK(total[channels - 1].count == published * blockSamples, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			double MeasureStatistics(SampleFormat format, int32 fillMode, uInt32 channels,
+				uInt32 samples, double seconds) {
+
+				BlockStatisticsCore statistics;
+				statistics.Configure(channels);
+
+				const size_t total = (size_t)channels * samples;
+				std::vector<float64> inF64(total);
+				std::vector<int16> inI16(total);
+
+				for (size_t i = 0; i < total; i++) {
+					inF64[i] = SimScaledSample((uInt32)(i % channels), i / channels);
+					inI16[i] = SimRawSample((uInt32)(i % channels), i / channels);
+				}
+
+				const void* data = (format == SampleFormat::Float64)
+					? static_cast<const void*>(inF64.data()) : static_cast<const void*>(inI16.data());
+				uInt64 processed = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 8; rep++) {
+						statistics.Accumulate(data, format, samples, fillMode);
+						processed += total;
+					}
+				} while (SecondsSince(start) < seconds);
+
+				ChannelStatistics s;
+				uInt64 blocks = 0;
+				statistics.GetStatistics(&s, nullptr, 1, blocks);
+				KeepAlive(s.mean);
+				return processed / SecondsSince(start);
+			}
+
+			// What DoubleArrayIntegrator does per scan: copy the scan into an
+			// array and add it channel by channel, each access between full
+			// barriers. It yields the sum and count only.
+			double MeasureIntegrator(uInt32 channels, uInt32 samples, double seconds) {
+
+				const size_t total = (size_t)channels * samples;
+				std::vector<float64> in(total);
+
+				for (size_t i = 0; i < total; i++) {
+					in[i] = SimScaledSample((uInt32)(i % channels), i / channels);
+				}
+
+				std::vector<float64> accumulators(channels, 0.0);
+				std::vector<int32> counters(channels, 0);
+				std::vector<float64> scan(channels);
+				uInt64 processed = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (uInt32 i = 0; i < samples; i++) {
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							scan[ch] = in[(size_t)i * channels + ch];
+						}
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							std::atomic_thread_fence(std::memory_order_seq_cst);
+							const float64 a = accumulators[ch];
+							std::atomic_thread_fence(std::memory_order_seq_cst);
+							accumulators[ch] = a + scan[ch];
+							std::atomic_thread_fence(std::memory_order_seq_cst);
+							counters[ch]++;
+							std::atomic_thread_fence(std::memory_order_seq_cst);
+						}
+					}
+					processed += total;
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(accumulators[0] / counters[0]);
+				return processed / SecondsSince(start);
+			}
+
+			// Variance of a signal riding on a large offset, from running sums
+			// of values and squares as a per-sample accumulator would keep them.
+			void ReportOffsetAccuracy() {
+
+				const size_t count = 1000000;
+				std::vector<float64> x(count);
+				std::mt19937_64 random(11);
+				std::normal_distribution<float64> noise(0.0, 1.0e-3);
+
+				for (size_t i = 0; i < count; i++) {
+					x[i] = 1000.0 + noise(random);
+				}
+
+				const Reference r = ComputeReference(x, 0, count, 1, 0.0L, 1.0L);
+				const long double variance = r.m2 / count;
+
+				float64 sum = 0.0, squares = 0.0;
+				for (size_t i = 0; i < count; i++) {
+					sum += x[i];
+					squares += x[i] * x[i];
+				}
+				const float64 naive = squares / count - (sum / count) * (sum / count);
+				const ChannelMoments m = ComputeMomentsF64(x.data(), count);
+
+				std::printf("  variance at offset 1000, sigma 1e-3: relative error %.1e "
+					"(sum of squares: %.1e)\n",
+					(double)std::fabs(m.m2 / count - variance) / (double)variance,
+					(double)std::fabs(naive - variance) / (double)variance);
+			}
+		}
+
+		int RunStatisticsBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			failures += CheckArguments();
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				std::printf("  correctness %s:\n", SimdLevelName(level));
+				failures += CheckAll();
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+			failures += CheckConcurrentReader(options.quick ? 20000 : 200000);
+			failures += CheckEngine(options.quick ? 100 : 2000);
+			ReportOffsetAccuracy();
+
+			const uInt32 channels = 8;
+			const uInt32 samples = 10000;
+			const double seconds = options.quick ? 0.1 : 1.0;
+			const double acquired = channels * 250000.0;
+
+			std::printf("  %u ch, blocks of %u:\n", channels, samples);
+
+			const double integrator = MeasureIntegrator(channels, samples, seconds);
+			std::printf("  %-7s per-sample integrator (sum only): %7.1f MS/s (%.1f%% of a "
+				"core at %u ch x 250 kS/s)\n", "baseline", integrator / 1e6,
+				100.0 * acquired / integrator, channels);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+
+				const double f64Channel = MeasureStatistics(SampleFormat::Float64,
+					DAQmx_Val_GroupByChannel, channels, samples, seconds);
+				const double f64Scan = MeasureStatistics(SampleFormat::Float64,
+					DAQmx_Val_GroupByScanNumber, channels, samples, seconds);
+				const double i16Scan = MeasureStatistics(SampleFormat::Int16,
+					DAQmx_Val_GroupByScanNumber, channels, samples, seconds);
+
+				std::printf("  %-8s F64 by chan %7.1f MS/s, F64 by scan %7.1f MS/s (%.1f%%), "
+					"I16 by scan %7.1f MS/s (%.1f%%)\n", SimdLevelName(level),
+					f64Channel / 1e6, f64Scan / 1e6, 100.0 * acquired / f64Scan,
+					i16Scan / 1e6, 100.0 * acquired / i16Scan);
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
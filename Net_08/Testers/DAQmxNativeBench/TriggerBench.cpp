@@ -0,0 +1,699 @@
+// Checks the software trigger (SoftwareTriggerCore + TriggerKernels): the
+// threshold searches against a scalar loop for every SIMD level, the detector
+// and its captured windows against a per-sample reference model over ragged
+// blocks, then runs it inside the acquisition engine and measures how fast it
+// scans compared with a per-sample state machine.
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AcquisitionEngineCore.h"
+#include "Native/CpuFeatures.h"
+#include "Native/NativeStatus.h"
+#include "Native/RawScalingCore.h"
+#include "Native/SoftwareTriggerCore.h"
+#include "Native/TriggerKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const CrossingTest AllTests[] = { CrossingTest::Below, CrossingTest::AtOrAbove,
+				CrossingTest::Above, CrossingTest::AtOrBelow };
+
+			template <typename T, typename U>
+			bool Passes(T x, CrossingTest test, U t) {
+				switch (test) {
+				case CrossingTest::Below: return x < t;
+				case CrossingTest::AtOrAbove: return x >= t;
+				case CrossingTest::Above: return x > t;
+				default: return x <= t;
+				}
+			}
+
+			template <typename T, typename U>
+			size_t FindReference(const T* x, size_t count, CrossingTest test, U t) {
+				for (size_t i = 0; i < count; i++) {
+					if (Passes(x[i], test, t)) {
+						return i;
+					}
+				}
+				return count;
+			}
+
+			// Plants a single passing sample at every position of ragged runs,
+			// so each lane and each tail is the first hit once.
+			int CheckKernels() {
+
+				int failures = 0;
+				uInt32 bad = 0;
+				std::mt19937 random(3);
+
+				for (size_t count : { 0, 1, 3, 8, 15, 31, 32, 33, 64, 100 }) {
+					for (CrossingTest test : AllTests) {
+
+						const bool upward = (test == CrossingTest::AtOrAbove || test == CrossingTest::Above);
+						std::vector<float64> f64(count);
+						std::vector<int16> i16(count);
+
+						for (size_t hit = 0; hit <= count; hit++) {
+
+							for (size_t i = 0; i < count; i++) {
+								f64[i] = upward ? -1.0 - (random() % 100) : 1.0 + (random() % 100);
+								i16[i] = (int16)(upward ? -1 - (int)(random() % 100) : 1 + (int)(random() % 100));
+							}
+							if (hit < count) {
+								f64[hit] = 0.0;
+								i16[hit] = 0;
+							}
+							if (count > 2 && hit != 0) {
+								f64[0] = NAN;
+							}
+
+							bad += FindFirstF64(f64.data(), count, test, 0.0)
+								!= FindReference(f64.data(), count, test, 0.0);
+							bad += FindFirstI16(i16.data(), count, test, 0)
+								!= FindReference(i16.data(), count, test, 0);
+						}
+
+						// Extremes and thresholds beyond the I16 range.
+						for (int32 t : { -40000, -32769, -32768, -32767, 32766, 32767, 32768, 40000 }) {
+							for (size_t i = 0; i < count; i++) {
+								i16[i] = (int16)((random() % 3 == 0) ? -32768 : (random() % 2) ? 32767 : 0);
+							}
+							bad += FindFirstI16(i16.data(), count, test, t)
+								!= FindReference(i16.data(), count, test, t);
+						}
+					}
+				}
+
+				BENCH_CHECK(bad == 0, failures);
+				return failures;
+			}
+
+			struct Event {
+				uInt64 sample;
+				TriggerSlope slope;
+			};
+
+			// Per-sample model of the detector, on scaled values.
+			std::vector<Event> ReferenceTriggers(const std::vector<float64>& x,
+				const SoftwareTriggerConfig& config) {
+
+				std::vector<Event> events;
+				bool armed[2] = { false, false };
+				const bool use[2] = { config.slope != TriggerSlope::Falling,
+					config.slope != TriggerSlope::Rising };
+				uInt64 idleUntil = config.preTriggerSamples;
+
+				for (uInt64 t = 0; t < x.size(); t++) {
+
+					if (t < idleUntil) {
+						continue;
+					}
+
+					for (int s = 0; s < 2; s++) {
+
+						if (!use[s]) {
+							continue;
+						}
+
+						const bool arm = (s == 0) ? x[t] < config.level - config.hysteresis
+							: x[t] > config.level + config.hysteresis;
+						const bool fire = (s == 0) ? x[t] >= config.level : x[t] <= config.level;
+
+						if (!armed[s]) {
+							armed[s] = arm;
+						}
+						else if (fire) {
+							armed[s] = false;
+							events.push_back({ t, (s == 0) ? TriggerSlope::Rising : TriggerSlope::Falling });
+							idleUntil = t + ((config.holdoffSamples > 0) ? config.holdoffSamples : 1);
+							break;
+						}
+					}
+				}
+				return events;
+			}
+
+			// Noisy sine in codes on every channel, with a different phase
+			// per channel.
+			int16 TestCode(uInt32 ch, uInt64 i, uInt32 period, const std::vector<int16>& noise) {
+				const double phase = 2.0 * 3.14159265358979 * (double)i / period + ch;
+				const double v = 20000.0 * std::sin(phase) + noise[(i * 7 + ch * 13) % noise.size()];
+				return (int16)std::lround(v);
+			}
+
+			int CheckDetector(uInt32 channels, SampleFormat format, int32 fillMode,
+				int32 captureFillMode, TriggerSlope slope, float64 hysteresis, uInt32 holdoff,
+				const RawScalingCore* scaling) {
+
+				int failures = 0;
+				const uInt32 blockSizes[] = { 1, 7, 333, 1000, 0, 64, 2, 2500, 999 };
+				const uInt64 total = 60000;
+				const uInt32 period = 997;
+
+				std::mt19937 random(channels * 31 + (uInt32)slope);
+				std::vector<int16> noise(4099);
+				for (int16& n : noise) {
+					n = (int16)((int)(random() % 6001) - 3000);
+				}
+
+				SoftwareTriggerConfig config = DefaultSoftwareTriggerConfig();
+				config.channels = channels;
+				config.sourceChannel = channels - 1;
+				config.format = format;
+				config.slope = slope;
+				config.preTriggerSamples = 150;
+				config.postTriggerSamples = 420;
+				config.holdoffSamples = holdoff;
+				config.maxSamplesPerChannel = 2500;
+				config.captureSlots = 64;
+				config.captureFillMode = captureFillMode;
+
+				float64 offset = 0.0, gain = 1.0;
+				if (scaling != nullptr) {
+					float64 coeffs[MaxScalingCoeffs];
+					scaling->GetChannelCoefficients(config.sourceChannel, coeffs, MaxScalingCoeffs);
+					offset = coeffs[0];
+					gain = coeffs[1];
+				}
+
+				config.level = offset + gain * 1234.4;
+				config.hysteresis = std::fabs(gain) * hysteresis;
+
+				SoftwareTriggerCore trigger;
+				BENCH_CHECK(trigger.Configure(config) == NativeSuccess, failures);
+				if (scaling != nullptr) {
+					BENCH_CHECK(trigger.SetScaling(scaling) == NativeSuccess, failures);
+				}
+
+				// Stream in codes, and the source channel as the trigger sees it.
+				std::vector<int16> codes((size_t)total * channels);
+				std::vector<float64> source(total);
+
+				for (uInt64 i = 0; i < total; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						codes[(size_t)i * channels + ch] = TestCode(ch, i, period, noise);
+					}
+					const float64 c = codes[(size_t)i * channels + config.sourceChannel];
+					source[i] = (format == SampleFormat::Int16) ? offset + gain * c : c;
+				}
+
+				const std::vector<Event> expected = ReferenceTriggers(source, config);
+				const uInt32 window = config.preTriggerSamples + config.postTriggerSamples;
+				size_t captured = 0;
+				uInt32 bad = 0;
+				uInt64 position = 0;
+				int32 fired = 0;
+
+				for (size_t b = 0; position < total; b++) {
+
+					uInt32 n = blockSizes[b % (sizeof(blockSizes) / sizeof(blockSizes[0]))];
+					n = (uInt32)((total - position < n) ? total - position : n);
+
+					std::vector<float64> f64((size_t)channels * n);
+					std::vector<int16> i16((size_t)channels * n);
+
+					for (uInt32 i = 0; i < n; i++) {
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							const size_t at = (fillMode == DAQmx_Val_GroupByChannel)
+								? (size_t)ch * n + i : (size_t)i * channels + ch;
+							i16[at] = codes[(size_t)(position + i) * channels + ch];
+							f64[at] = i16[at];
+						}
+					}
+
+					const void* data = (format == SampleFormat::Float64)
+						? static_cast<const void*>(f64.data()) : static_cast<const void*>(i16.data());
+					const int32 r = trigger.Process(data, n, fillMode);
+					bad += (r < 0);
+					fired += (r > 0) ? r : 0;
+					position += n;
+
+					TriggerCapture capture;
+
+					while (trigger.TryAcquireCapture(capture)) {
+
+						if (captured >= expected.size()) {
+							bad++;
+						}
+						else {
+
+							const Event& e = expected[captured];
+							bad += capture.triggerSample != e.sample || capture.slope != e.slope
+								|| capture.firstSample != e.sample - config.preTriggerSamples
+								|| capture.samplesPerChannel != window || capture.sequence != captured
+								|| capture.fillMode != captureFillMode;
+
+							for (uInt32 i = 0; i < window; i++) {
+								for (uInt32 ch = 0; ch < channels; ch++) {
+
+									const size_t at = (captureFillMode == DAQmx_Val_GroupByChannel)
+										? (size_t)ch * window + i : (size_t)i * channels + ch;
+									const int16 c = codes[(size_t)(capture.firstSample + i) * channels + ch];
+									bad += (format == SampleFormat::Float64)
+										? static_cast<const float64*>(capture.data)[at] != (float64)c
+										: static_cast<const int16*>(capture.data)[at] != c;
+								}
+							}
+						}
+
+						captured++;
+						trigger.ReleaseCapture();
+					}
+				}
+
+				// Triggers too close to the end have no complete window.
+				size_t complete = 0;
+				for (const Event& e : expected) {
+					complete += (e.sample + config.postTriggerSamples <= total);
+				}
+
+				const TriggerCounters counters = trigger.Counters();
+
+				std::printf("    %u ch %s %-8s->%-8s %-7s h=%-4g holdoff %-4u%s: "
+					"%zu triggers, %zu captures, %u bad\n", channels,
+					(format == SampleFormat::Float64) ? "F64" : "I16",
+					(fillMode == DAQmx_Val_GroupByChannel) ? "by chan" : "by scan",
+					(captureFillMode == DAQmx_Val_GroupByChannel) ? "by chan" : "by scan",
+					(slope == TriggerSlope::Rising) ? "rising" : (slope == TriggerSlope::Falling)
+						? "falling" : "either", hysteresis, holdoff,
+					(scaling != nullptr) ? " scaled" : "", expected.size(), captured, bad);
+
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(expected.size() > 10, failures);
+				BENCH_CHECK(captured == complete, failures);
+				BENCH_CHECK((size_t)fired == expected.size(), failures);
+				BENCH_CHECK(counters.triggers == expected.size(), failures);
+				BENCH_CHECK(counters.capturesDropped == 0, failures);
+				BENCH_CHECK(counters.samplesScanned == total, failures);
+				return failures;
+			}
+
+			int CheckArguments() {
+
+				int failures = 0;
+				SoftwareTriggerCore trigger;
+				SoftwareTriggerConfig config = DefaultSoftwareTriggerConfig();
+				float64 data[4] = { 0.0, 0.0, 0.0, 0.0 };
+				TriggerCapture capture;
+
+				BENCH_CHECK(trigger.Process(data, 4, DAQmx_Val_GroupByChannel)
+					== NativeErrorInvalidState, failures);
+				BENCH_CHECK(!trigger.TryAcquireCapture(capture), failures);
+
+				config.format = SampleFormat::Int32;
+				BENCH_CHECK(trigger.Configure(config) == NativeErrorUnsupportedFormat, failures);
+				config = DefaultSoftwareTriggerConfig();
+				config.sourceChannel = 1;
+				BENCH_CHECK(trigger.Configure(config) == NativeErrorInvalidArgument, failures);
+				config = DefaultSoftwareTriggerConfig();
+				config.hysteresis = -1.0;
+				BENCH_CHECK(trigger.Configure(config) == NativeErrorInvalidArgument, failures);
+				config = DefaultSoftwareTriggerConfig();
+				config.preTriggerSamples = config.postTriggerSamples = 0;
+				BENCH_CHECK(trigger.Configure(config) == NativeErrorInvalidArgument, failures);
+
+				config = DefaultSoftwareTriggerConfig();
+				config.maxSamplesPerChannel = 4;
+				BENCH_CHECK(trigger.Configure(config) == NativeSuccess, failures);
+				BENCH_CHECK(trigger.Process(data, 5, DAQmx_Val_GroupByChannel)
+					== NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(trigger.Process(data, 4, 12345) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(trigger.Process(data, 4, DAQmx_Val_GroupByChannel) == 0, failures);
+				BENCH_CHECK(!trigger.WaitAcquireCapture(capture, 1), failures);
+
+				RawScalingCore flat;
+				flat.Reset(1);
+				const float64 zeroGain[2] = { 1.0, 0.0 };
+				flat.SetChannelCoefficients(0, zeroGain, 2);
+				BENCH_CHECK(trigger.SetScaling(&flat) == NativeErrorInvalidArgument, failures);
+				return failures;
+			}
+
+			// A consumer that does not keep up loses whole windows, never parts.
+			int CheckOverflow() {
+
+				int failures = 0;
+				SoftwareTriggerConfig config = DefaultSoftwareTriggerConfig();
+				config.level = 0.5;
+				config.preTriggerSamples = 10;
+				config.postTriggerSamples = 10;
+				config.maxSamplesPerChannel = 100;
+				config.captureSlots = 2;
+
+				SoftwareTriggerCore trigger;
+				BENCH_CHECK(trigger.Configure(config) == NativeSuccess, failures);
+
+				// Square wave: 10 samples at 0, 10 at 1. The first full
+				// pre-trigger window ends at 10, so triggers are at 30, 50, ...
+				std::vector<float64> block(100);
+
+				for (uInt64 first = 0; first < 1000; first += 100) {
+					for (uInt64 i = 0; i < 100; i++) {
+						block[i] = ((first + i) % 20 < 10) ? 0.0 : 1.0;
+					}
+					trigger.Process(block.data(), 100, DAQmx_Val_GroupByChannel);
+				}
+
+				const TriggerCounters counters = trigger.Counters();
+				BENCH_CHECK(counters.triggers == 49, failures);
+				BENCH_CHECK(trigger.PendingCaptures() == 2, failures);
+				BENCH_CHECK(counters.capturesDropped == 47, failures);
+
+				TriggerCapture capture;
+				uInt32 bad = 0;
+
+				for (uInt64 expected : { 30u, 50u }) {
+
+					BENCH_CHECK(trigger.TryAcquireCapture(capture), failures);
+					const float64* data = static_cast<const float64*>(capture.data);
+					bad += capture.triggerSample != expected || data[9] != 0.0 || data[10] != 1.0;
+					trigger.ReleaseCapture();
+				}
+
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(!trigger.TryAcquireCapture(capture), failures);
+
+				trigger.Reset();
+				BENCH_CHECK(trigger.Counters().triggers == 0 && trigger.Position() == 0, failures);
+				return failures;
+			}
+
+			int CheckAll() {
+
+				int failures = 0;
+
+				RawScalingCore scaling;
+				RawScalingCore inverted;
+				scaling.Reset(3);
+				inverted.Reset(3);
+
+				for (uInt32 ch = 0; ch < 3; ch++) {
+					const float64 forward[3] = { 0.01 * ch, 10.0 / 32768.0, 1.0e-12 };
+					const float64 backward[2] = { -0.25, -10.0 / 32768.0 };
+					scaling.SetChannelCoefficients(ch, forward, 3);
+					inverted.SetChannelCoefficients(ch, backward, 2);
+				}
+
+				failures += CheckKernels();
+
+				for (uInt32 channels : { 1u, 3u }) {
+					for (int32 fillMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+						for (TriggerSlope slope : { TriggerSlope::Rising, TriggerSlope::Falling,
+							TriggerSlope::Either }) {
+
+							const int32 captureFill = (slope == TriggerSlope::Falling) ? fillMode
+								: (fillMode == DAQmx_Val_GroupByChannel)
+									? DAQmx_Val_GroupByScanNumber : DAQmx_Val_GroupByChannel;
+
+							failures += CheckDetector(channels, SampleFormat::Float64, fillMode,
+								captureFill, slope, 2000.0, 0, nullptr);
+							failures += CheckDetector(channels, SampleFormat::Int16, fillMode,
+								captureFill, slope, 0.0, 300, nullptr);
+						}
+					}
+				}
+
+				failures += CheckDetector(3, SampleFormat::Int16, DAQmx_Val_GroupByScanNumber,
+					DAQmx_Val_GroupByChannel, TriggerSlope::Either, 500.0, 50, &scaling);
+				failures += CheckDetector(3, SampleFormat::Int16, DAQmx_Val_GroupByChannel,
+					DAQmx_Val_GroupByScanNumber, TriggerSlope::Rising, 500.0, 0, &inverted);
+				return failures;
+			}
+
+			int CheckEngine(uInt32 blocks) {
+
+				int failures = 0;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				const uInt32 channels = 8;
+				const uInt32 blockSamples = 1000;
+
+				SoftwareTriggerConfig triggerConfig = DefaultSoftwareTriggerConfig();
+				triggerConfig.channels = channels;
+				triggerConfig.sourceChannel = 2;
+				triggerConfig.level = 0.0;
+				triggerConfig.hysteresis = 0.5;
+				triggerConfig.preTriggerSamples = 200;
+				triggerConfig.postTriggerSamples = 800;
+				triggerConfig.maxSamplesPerChannel = blockSamples;
+				triggerConfig.captureSlots = 64;
+
+				SoftwareTriggerCore trigger;
+				BENCH_CHECK(trigger.Configure(triggerConfig) == NativeSuccess, failures);
+
+				AcquisitionEngineCore engine;
+				AcquisitionEngineConfig config = DefaultAcquisitionEngineConfig();
+				config.channels = channels;
+				config.samplesPerBlock = blockSamples;
+				config.ringBlocks = 16;
+				config.format = SampleFormat::Int16;
+				config.fillMode = DAQmx_Val_GroupByScanNumber;
+				config.ownsTask = true;
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("trigger", &task);
+				DAQmxCreateAIVoltageChan(task, "SimDev1/ai0:7", "", DAQmx_Val_Cfg_Default,
+					-10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", 250000.0, DAQmx_Val_Rising, DAQmx_Val_ContSamps, 0);
+
+				BENCH_CHECK(engine.SetTrigger(&trigger) == NativeErrorNotAttached, failures);
+				BENCH_CHECK(engine.Attach(task, config) == 0, failures);
+				BENCH_CHECK(engine.SetTrigger(&trigger) == NativeErrorUnsupportedFormat, failures);
+
+				// Level in volts on raw I16 blocks.
+				RawScalingCore scaling;
+				BENCH_CHECK(scaling.Capture(task) == NativeSuccess, failures);
+				triggerConfig.format = SampleFormat::Int16;
+				BENCH_CHECK(trigger.Configure(triggerConfig) == NativeSuccess, failures);
+				BENCH_CHECK(trigger.SetScaling(&scaling) == NativeSuccess, failures);
+				BENCH_CHECK(engine.SetTrigger(&trigger) == NativeSuccess, failures);
+				BENCH_CHECK(engine.Start() == 0, failures);
+				BENCH_CHECK(engine.SetTrigger(nullptr) == NativeErrorAlreadyRunning, failures);
+
+				uInt32 consumed = 0;
+				uInt32 captures = 0;
+				uInt32 bad = 0;
+				BlockView view;
+				TriggerCapture capture;
+				const uInt32 window = triggerConfig.preTriggerSamples + triggerConfig.postTriggerSamples;
+
+				while (consumed < blocks && engine.WaitAcquireBlock(view, 2000)) {
+
+					engine.ReleaseBlock();
+					consumed++;
+
+					while (trigger.TryAcquireCapture(capture)) {
+
+						const int16* data = static_cast<const int16*>(capture.data);
+						const uInt64 t = capture.triggerSample;
+
+						// Captured by channel; the source crosses 0 V at the trigger.
+						bad += SimScaledSample(2, t) < 0.0 || SimScaledSample(2, t - 1) >= 0.0;
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							for (uInt32 i : { 0u, triggerConfig.preTriggerSamples, window - 1 }) {
+								bad += data[(size_t)ch * window + i]
+									!= SimRawSample(ch, capture.firstSample + i);
+							}
+						}
+
+						captures++;
+						trigger.ReleaseCapture();
+					}
+				}
+
+				engine.Stop();
+				const AcquisitionEngineCounters counters = engine.Counters();
+				engine.Detach();
+				const TriggerCounters triggerCounters = trigger.Counters();
+
+				std::printf("  engine I16/ByScan, trigger at 0 V: %u blocks, %llu samples scanned, "
+					"%llu triggers, %u captures checked, %u bad\n", consumed,
+					(unsigned long long)triggerCounters.samplesScanned,
+					(unsigned long long)triggerCounters.triggers, captures, bad);
+
+				BENCH_CHECK(consumed == blocks, failures);
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(captures > 0, failures);
+				BENCH_CHECK(triggerCounters.samplesScanned
+					== (counters.blocksRead + counters.blocksDropped) * blockSamples, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+				return failures;
+			}
+
+			double MeasureTrigger(SampleFormat format, int32 fillMode, uInt32 channels,
+				uInt32 samples, float64 level, double seconds, uInt64& triggers) {
+
+				SoftwareTriggerConfig config = DefaultSoftwareTriggerConfig();
+				config.channels = channels;
+				config.format = format;
+				config.level = level;
+				config.hysteresis = (format == SampleFormat::Int16) ? 1000.0 : 0.3;
+				config.maxSamplesPerChannel = samples;
+				config.captureSlots = 64;
+
+				SoftwareTriggerCore trigger;
+				trigger.Configure(config);
+
+				const size_t total = (size_t)channels * samples;
+				std::vector<float64> inF64(total);
+				std::vector<int16> inI16(total);
+
+				for (uInt32 i = 0; i < samples; i++) {
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						const size_t at = (fillMode == DAQmx_Val_GroupByChannel)
+							? (size_t)ch * samples + i : (size_t)i * channels + ch;
+						inF64[at] = SimScaledSample(ch, i);
+						inI16[at] = SimRawSample(ch, i);
+					}
+				}
+
+				const void* data = (format == SampleFormat::Float64)
+					? static_cast<const void*>(inF64.data()) : static_cast<const void*>(inI16.data());
+				uInt64 processed = 0;
+				TriggerCapture capture;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					for (int rep = 0; rep < 4; rep++) {
+
+						trigger.Process(data, samples, fillMode);
+						processed += total;
+
+						while (trigger.TryAcquireCapture(capture)) {
+							trigger.ReleaseCapture();
+						}
+					}
+				} while (SecondsSince(start) < seconds);
+
+				const double rate = processed / SecondsSince(start);
+				triggers = trigger.Counters().triggers;
+				return rate;
+			}
+
+			// What a per-sample managed detector does: copy the block out,
+			// then run the state machine on every sample of the source channel
+			// and keep a history of every scan.
+			double MeasurePerSample(uInt32 channels, uInt32 samples, float64 level,
+				double seconds) {
+
+				const size_t total = (size_t)channels * samples;
+				std::vector<float64> in(total);
+				for (size_t i = 0; i < total; i++) {
+					in[i] = SimScaledSample((uInt32)(i % channels), i / channels);
+				}
+
+				std::vector<float64> copy(total);
+				std::vector<float64> history(total * 2);
+				size_t historyPosition = 0;
+				bool armed = false;
+				uInt64 triggers = 0;
+				uInt64 processed = 0;
+				const auto start = std::chrono::steady_clock::now();
+
+				do {
+					std::memcpy(copy.data(), in.data(), total * sizeof(float64));
+
+					for (uInt32 i = 0; i < samples; i++) {
+
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							history[historyPosition] = copy[(size_t)i * channels + ch];
+							historyPosition = (historyPosition + 1) % history.size();
+						}
+
+						const float64 x = copy[(size_t)i * channels];
+						if (!armed) {
+							armed = x < level - 0.3;
+						}
+						else if (x >= level) {
+							armed = false;
+							triggers++;
+						}
+					}
+					processed += total;
+				} while (SecondsSince(start) < seconds);
+
+				KeepAlive(triggers + history[0]);
+				return processed / SecondsSince(start);
+			}
+		}
+
+		int RunTriggerBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const SimdLevel detected = DetectedSimdLevel();
+			const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+			std::printf("  detected SIMD level: %s\n", SimdLevelName(detected));
+
+			failures += CheckArguments();
+			failures += CheckOverflow();
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+				std::printf("  correctness %s:\n", SimdLevelName(level));
+				failures += CheckAll();
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+			failures += CheckEngine(options.quick ? 100 : 2000);
+
+			const uInt32 channels = 8;
+			const uInt32 samples = 10000;
+			const double seconds = options.quick ? 0.1 : 1.0;
+			const double acquired = channels * 250000.0;
+
+			std::printf("  %u ch, blocks of %u, MS/s over all channels:\n", channels, samples);
+
+			const double perSample = MeasurePerSample(channels, samples, 0.0, seconds);
+			std::printf("  %-8s per-sample state machine + copy: %7.1f MS/s (%.1f%% of a core "
+				"at %u ch x 250 kS/s)\n", "baseline", perSample / 1e6,
+				100.0 * acquired / perSample, channels);
+
+			for (SimdLevel level : levels) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+
+				SetSimdLevelLimit(level);
+
+				uInt64 quiet = 0, busy = 0, raw = 0;
+				const double f64Quiet = MeasureTrigger(SampleFormat::Float64,
+					DAQmx_Val_GroupByChannel, channels, samples, 100.0, seconds, quiet);
+				const double f64Busy = MeasureTrigger(SampleFormat::Float64,
+					DAQmx_Val_GroupByScanNumber, channels, samples, 0.0, seconds, busy);
+				const double i16Busy = MeasureTrigger(SampleFormat::Int16,
+					DAQmx_Val_GroupByScanNumber, channels, samples, 0.0, seconds, raw);
+
+				std::printf("  %-8s F64 no triggers %7.1f, F64 by scan %7.1f (%llu triggers, "
+					"%.1f%%), I16 by scan %7.1f (%.1f%%)\n", SimdLevelName(level),
+					f64Quiet / 1e6, f64Busy / 1e6, (unsigned long long)busy,
+					100.0 * acquired / f64Busy, i16Busy / 1e6, 100.0 * acquired / i16Busy);
+
+				BENCH_CHECK(quiet == 0 && busy > 0 && raw > 0, failures);
+			}
+
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,597 @@
+// Checks the waveform kernels against std::sin references at every SIMD
+// level, the phase continuity of the generator across arbitrary block
+// sizes, its formats and layouts, live parameter changes, and rendering in
+// place into the analog output engine. Compares its speed with building a
+// double array with std::sin and converting it in a second pass.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Native/AnalogOutputEngineCore.h"
+#include "Native/CpuFeatures.h"
+#include "Native/NativeStatus.h"
+#include "Native/WaveformGeneratorCore.h"
+#include "Native/WaveformKernels.h"
+
+namespace Grumpy {
+
+	namespace DAQmxNativeBench {
+
+		using namespace Grumpy::DAQmxNetApi::Native;
+		using namespace Grumpy::DAQmxNetApi::Simulation;
+
+		namespace {
+
+			const long double TwoPi = 6.283185307179586476925286766559L;
+
+			float64 ReferenceSine(long double cycles) {
+				return (float64)std::sin(TwoPi * (cycles - std::floor(cycles)));
+			}
+
+			float64 MaxDifference(const std::vector<float64>& a, const std::vector<float64>& b) {
+
+				float64 worst = 0.0;
+				for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+					worst = std::max(worst, std::fabs(a[i] - b[i]));
+				}
+				return (a.size() == b.size()) ? worst : 1e300;
+			}
+
+			int CheckKernels() {
+
+				int failures = 0;
+				const size_t count = 10007;
+				const float64 phase = 0.3;
+				const float64 step = 0.0123456789;
+				std::vector<float64> out(count);
+				std::vector<float64> expected(count);
+
+				RenderSine(out.data(), count, phase, step, 2.5, 0.5);
+				for (size_t i = 0; i < count; i++) {
+					expected[i] = 0.5 + 2.5 * ReferenceSine((long double)phase + (long double)i * step);
+				}
+				const float64 sine = MaxDifference(out, expected);
+				BENCH_CHECK(sine < 1e-12, failures);
+
+				for (size_t i = 0; i < count; i++) {
+					expected[i] += 0.75 * ReferenceSine(0.1L + (long double)i * 0.031);
+				}
+				AddSine(out.data(), count, 0.1, 0.031, 0.75);
+				BENCH_CHECK(MaxDifference(out, expected) < 1e-12, failures);
+
+				const float64 increment = 1e-6;
+				RenderChirp(out.data(), count, phase, step, increment, 1.0, 0.0);
+				for (size_t i = 0; i < count; i++) {
+					const long double k = (long double)i;
+					expected[i] = ReferenceSine((long double)phase + k * step + k * (k - 1) / 2 * increment);
+				}
+				const float64 chirp = MaxDifference(out, expected);
+				BENCH_CHECK(chirp < 1e-11, failures);
+
+				RenderSquare(out.data(), count, phase, step, 1.5, 1.0, 0.25);
+				size_t squareBad = 0;
+				for (size_t i = 0; i < count; i++) {
+					const float64 x = phase + i * step;
+					const float64 v = ((x - std::floor(x)) < 0.25) ? 2.5 : -0.5;
+					squareBad += (out[i] != v) ? 1 : 0;
+				}
+				BENCH_CHECK(squareBad == 0, failures);
+
+				RenderTriangle(out.data(), count, phase, step, 2.0, 0.0);
+				for (size_t i = 0; i < count; i++) {
+					const long double x = (long double)phase + (long double)i * step + 0.25L;
+					const long double r = x - std::floor(x);
+					expected[i] = (float64)(2.0L * (1.0L - 4.0L * std::fabs(r - 0.5L)));
+				}
+				BENCH_CHECK(MaxDifference(out, expected) < 1e-12, failures);
+				BENCH_CHECK(std::fabs(out[0] - 2.0 * (1.0 - 4.0 * std::fabs(0.55 - 0.5))) < 1e-12,
+					failures);
+
+				// One cycle of a cosine, 64 points plus the guard point.
+				const uInt32 points = 64;
+				std::vector<float64> table(points + 1);
+				for (uInt32 k = 0; k <= points; k++) {
+					table[k] = std::cos(2.0 * 3.14159265358979323846 * (k % points) / points);
+				}
+				RenderTable(out.data(), count, phase, step, table.data(), points, 3.0, -1.0);
+				for (size_t i = 0; i < count; i++) {
+					const long double x = (long double)phase + (long double)i * step;
+					const long double position = (x - std::floor(x)) * points;
+					const uInt32 k = std::min<uInt32>((uInt32)position, points - 1);
+					const long double t = position - k;
+					expected[i] = (float64)(-1.0L + 3.0L * (table[k] + t * (table[k + 1] - table[k])));
+				}
+				BENCH_CHECK(MaxDifference(out, expected) < 1e-12, failures);
+
+				// Rounding to nearest even, saturation, NaN to the low end.
+				const float64 values[] = { -40000.0, -2.5, -1.5, 0.4999, 0.5, 1.5, 2.5, 32767.4, 40000.0, NAN };
+				const int16 expectedI16[] = { -32768, -2, -2, 0, 0, 2, 2, 32767, 32767, -32768 };
+				std::vector<float64> many;
+				std::vector<int16> manyExpected;
+				for (int rep = 0; rep < 9; rep++) {
+					for (size_t k = 0; k < 10; k++) {
+						many.push_back(values[k]);
+						manyExpected.push_back(expectedI16[k]);
+					}
+				}
+				std::vector<int16> codes(many.size());
+				BENCH_CHECK(QuantizeSamples(many.data(), codes.data(), many.size(),
+					SampleFormat::Int16, 0.0, 1.0), failures);
+				BENCH_CHECK(codes == manyExpected, failures);
+
+				uInt32 words[3];
+				const float64 digital[] = { -1.0, 0.6, 5e9 };
+				QuantizeSamples(digital, words, 3, SampleFormat::UInt32, 0.0, 1.0);
+				BENCH_CHECK(words[0] == 0 && words[1] == 1 && words[2] == 0xFFFFFFFFu, failures);
+
+				std::printf("  kernels %-7s: sine error %.1e, chirp error %.1e\n",
+					SimdLevelName(ActiveSimdLevel()), sine, chirp);
+				return failures;
+			}
+
+			WaveformGeneratorConfig MakeConfig(uInt32 channels, SampleFormat format, int32 fillMode) {
+
+				WaveformGeneratorConfig config = DefaultWaveformGeneratorConfig();
+				config.channels = channels;
+				config.sampleRate = 100000.0;
+				config.format = format;
+				config.fillMode = fillMode;
+				return config;
+			}
+
+			// Sine, chirp and multi-tone on channels 0 to 2, then square,
+			// triangle and table.
+			void SetupChannels(WaveformGeneratorCore& generator) {
+
+				const uInt32 channels = generator.Config().channels;
+
+				for (uInt32 ch = 0; ch < channels; ch++) {
+
+					WaveformChannel w = DefaultWaveformChannel();
+					w.shape = (WaveformShape)(ch % 6);
+					w.frequency = 1234.5 + 100.0 * ch;
+					w.amplitude = 1.0 + 0.5 * ch;
+					w.offset = 0.1 * ch;
+					w.phase = 0.05 * ch;
+					w.dutyCycle = 0.3;
+					w.stopFrequency = 20000.0;
+					w.sweepSeconds = 0.0137;
+					generator.SetChannel(ch, w);
+
+					const WaveformTone tones[] = { { 50.0, 0.5, 0.0 }, { 3000.0, 0.25, 0.25 },
+						{ 17123.0, 0.125, 0.5 } };
+					generator.SetTones(ch, tones, 3);
+
+					std::vector<float64> table(100);
+					for (size_t k = 0; k < table.size(); k++) {
+						table[k] = (k < 50) ? (float64)k / 50.0 : std::sin((float64)k);
+					}
+					generator.SetTable(ch, table.data(), (uInt32)table.size());
+				}
+				generator.Reset();
+			}
+
+			/**
+			* Blocks of random sizes give the same stream as one large block,
+			* and a sine holds its phase over a million samples.
+			*/
+			int CheckContinuity() {
+
+				int failures = 0;
+				const uInt32 channels = 6;
+				const uInt32 total = 100000;
+
+				WaveformGeneratorCore whole;
+				WaveformGeneratorCore pieces;
+				BENCH_CHECK(whole.Configure(MakeConfig(channels, SampleFormat::Float64,
+					DAQmx_Val_GroupByChannel)) == 0, failures);
+				BENCH_CHECK(pieces.Configure(MakeConfig(channels, SampleFormat::Float64,
+					DAQmx_Val_GroupByChannel)) == 0, failures);
+				SetupChannels(whole);
+				SetupChannels(pieces);
+
+				std::vector<float64> expected((size_t)channels * total);
+				BENCH_CHECK(whole.Render(expected.data(), total) == 0, failures);
+
+				std::mt19937 random(7);
+				std::vector<float64> block;
+				float64 worst = 0.0;
+				uInt32 done = 0;
+
+				while (done < total) {
+
+					const uInt32 n = std::min<uInt32>(total - done, 1 + random() % 3000);
+					block.resize((size_t)channels * n);
+					pieces.Render(block.data(), n);
+
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						for (uInt32 i = 0; i < n; i++) {
+							worst = std::max(worst, std::fabs(block[(size_t)ch * n + i]
+								- expected[(size_t)ch * total + done + i]));
+						}
+					}
+					done += n;
+				}
+				BENCH_CHECK(worst < 1e-9, failures);
+				BENCH_CHECK(pieces.Position() == total, failures);
+
+				// No drift: a long sine against the closed form.
+				WaveformGeneratorCore longRun;
+				longRun.Configure(MakeConfig(1, SampleFormat::Float64, DAQmx_Val_GroupByChannel));
+				WaveformChannel w = DefaultWaveformChannel();
+				w.frequency = 1234.567;
+				longRun.SetChannel(0, w);
+
+				const uInt32 length = 1000000;
+				std::vector<float64> run(length);
+				for (uInt32 first = 0; first < length; first += 1000) {
+					longRun.Render(run.data() + first, 1000);
+				}
+
+				float64 drift = 0.0;
+				for (uInt32 i = length - 1000; i < length; i++) {
+					const long double cycles = (long double)i * 1234.567L / 100000.0L;
+					drift = std::max(drift, std::fabs(run[i] - ReferenceSine(cycles)));
+				}
+				BENCH_CHECK(drift < 1e-9, failures);
+
+				std::printf("  continuity: random blocks vs one block %.1e, sine after 1e6 samples %.1e\n",
+					worst, drift);
+				return failures;
+			}
+
+			/**
+			* Integer formats and blocks grouped by scan hold the same values
+			* as `Float64` grouped by channel.
+			*/
+			int CheckFormats() {
+
+				int failures = 0;
+				const uInt32 channels = 6;
+				const uInt32 samples = 3001;
+				const float64 c0 = 5.0;
+				const float64 c1 = 3276.7;
+
+				WaveformGeneratorCore reference;
+				reference.Configure(MakeConfig(channels, SampleFormat::Float64, DAQmx_Val_GroupByChannel));
+				SetupChannels(reference);
+				std::vector<float64> volts((size_t)channels * samples);
+				reference.Render(volts.data(), samples);
+
+				WaveformGeneratorCore byScan;
+				byScan.Configure(MakeConfig(channels, SampleFormat::Float64, DAQmx_Val_GroupByScanNumber));
+				SetupChannels(byScan);
+				std::vector<float64> scans((size_t)channels * samples);
+				byScan.Render(scans.data(), samples);
+
+				size_t bad = 0;
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					for (uInt32 i = 0; i < samples; i++) {
+						bad += (scans[(size_t)i * channels + ch] != volts[(size_t)ch * samples + i]) ? 1 : 0;
+					}
+				}
+				BENCH_CHECK(bad == 0, failures);
+
+				for (int32 fillMode : { DAQmx_Val_GroupByChannel, DAQmx_Val_GroupByScanNumber }) {
+
+					WaveformGeneratorCore codes;
+					codes.Configure(MakeConfig(channels, SampleFormat::Int16, fillMode));
+					SetupChannels(codes);
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						codes.SetCodeScaling(ch, c0, c1);
+					}
+					std::vector<int16> out((size_t)channels * samples);
+					codes.Render(out.data(), samples);
+
+					std::vector<int16> expected(samples);
+					bad = 0;
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						QuantizeSamples(volts.data() + (size_t)ch * samples, expected.data(), samples,
+							SampleFormat::Int16, c0, c1);
+						for (uInt32 i = 0; i < samples; i++) {
+							const size_t at = (fillMode == DAQmx_Val_GroupByChannel)
+								? (size_t)ch * samples + i : (size_t)i * channels + ch;
+							bad += (out[at] != expected[i]) ? 1 : 0;
+						}
+					}
+					BENCH_CHECK(bad == 0, failures);
+				}
+
+				// A digital pulse train: a square between codes 0 and 0xFF.
+				WaveformGeneratorCore digital;
+				digital.Configure(MakeConfig(1, SampleFormat::UInt32, DAQmx_Val_GroupByChannel));
+				WaveformChannel w = DefaultWaveformChannel();
+				w.shape = WaveformShape::Square;
+				w.frequency = 1000.0;
+				w.amplitude = 0.5;
+				w.offset = 0.5;
+				w.dutyCycle = 0.25;
+				digital.SetChannel(0, w);
+				digital.SetCodeScaling(0, 0.0, 255.0);
+				digital.Reset();
+
+				std::vector<uInt32> words(100000);
+				digital.Render(words.data(), (uInt32)words.size());
+				size_t high = 0;
+				size_t other = 0;
+				for (uInt32 word : words) {
+					high += (word == 0xFF) ? 1 : 0;
+					other += (word != 0xFF && word != 0) ? 1 : 0;
+				}
+				BENCH_CHECK(other == 0, failures);
+				BENCH_CHECK(high == words.size() / 4, failures);
+
+				std::printf("  formats: I16 and by-scan blocks match F64 by channel, "
+					"U32 pulse train high %.3f of the time\n", (double)high / words.size());
+				return failures;
+			}
+
+			int CheckUpdates() {
+
+				int failures = 0;
+				const uInt32 n = 1000;
+
+				WaveformGeneratorCore generator;
+				generator.Configure(MakeConfig(1, SampleFormat::Float64, DAQmx_Val_GroupByChannel));
+				WaveformChannel w = DefaultWaveformChannel();
+				w.frequency = 1500.0;
+				generator.SetChannel(0, w);
+
+				std::vector<float64> block(n);
+				generator.Render(block.data(), n);
+
+				// New amplitude and frequency: no phase jump.
+				w.amplitude = 3.0;
+				w.frequency = 2500.0;
+				BENCH_CHECK(generator.SetChannel(0, w) == 0, failures);
+				generator.Render(block.data(), n);
+
+				const long double phase = (long double)n * 1500.0L / 100000.0L;
+				float64 worst = 0.0;
+				for (uInt32 i = 0; i < n; i++) {
+					worst = std::max(worst, std::fabs(block[i]
+						- 3.0 * ReferenceSine(phase + (long double)i * 2500.0L / 100000.0L)));
+				}
+				BENCH_CHECK(worst < 1e-12, failures);
+
+				// A new shape restarts at its phase.
+				w.shape = WaveformShape::Triangle;
+				w.phase = 0.25;
+				generator.SetChannel(0, w);
+				generator.Render(block.data(), n);
+				BENCH_CHECK(std::fabs(block[0] - 3.0) < 1e-12, failures);
+
+				BENCH_CHECK(generator.Position() == 3 * n, failures);
+				generator.Reset();
+				BENCH_CHECK(generator.Position() == 0, failures);
+
+				// Settings changed from another thread while rendering.
+				std::atomic<bool> stop(false);
+				std::thread tweaker([&]() {
+					WaveformChannel t = DefaultWaveformChannel();
+					for (uInt32 k = 0; !stop.load(); k++) {
+						t.amplitude = 1.0 + (k % 3);
+						t.frequency = 100.0 + (k % 50);
+						generator.SetChannel(0, t);
+						std::this_thread::yield();
+					}
+				});
+
+				float64 peak = 0.0;
+				for (int k = 0; k < 2000; k++) {
+					generator.Render(block.data(), n);
+					for (float64 v : block) {
+						peak = std::max(peak, std::fabs(v));
+					}
+				}
+				stop.store(true);
+				tweaker.join();
+				BENCH_CHECK(peak <= 3.0 + 1e-12, failures);
+
+				// Arguments.
+				WaveformGeneratorCore bad;
+				BENCH_CHECK(bad.Render(block.data(), n) == NativeErrorInvalidState, failures);
+				BENCH_CHECK(bad.SetChannel(0, w) == NativeErrorInvalidState, failures);
+				WaveformGeneratorConfig config = MakeConfig(0, SampleFormat::Float64, DAQmx_Val_GroupByChannel);
+				BENCH_CHECK(bad.Configure(config) == NativeErrorInvalidArgument, failures);
+				config = MakeConfig(1, (SampleFormat)42, DAQmx_Val_GroupByChannel);
+				BENCH_CHECK(bad.Configure(config) == NativeErrorUnsupportedFormat, failures);
+				config = MakeConfig(1, SampleFormat::Float64, DAQmx_Val_GroupByChannel);
+				config.sampleRate = 0.0;
+				BENCH_CHECK(bad.Configure(config) == NativeErrorInvalidArgument, failures);
+
+				w = DefaultWaveformChannel();
+				w.dutyCycle = 1.5;
+				BENCH_CHECK(generator.SetChannel(0, w) == NativeErrorInvalidArgument, failures);
+				w = DefaultWaveformChannel();
+				w.shape = WaveformShape::Chirp;
+				w.sweepSeconds = 0.0;
+				BENCH_CHECK(generator.SetChannel(0, w) == NativeErrorInvalidArgument, failures);
+				w.sweepSeconds = 1.0;
+				w.amplitude = NAN;
+				BENCH_CHECK(generator.SetChannel(0, w) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(generator.SetChannel(1, DefaultWaveformChannel()) == NativeErrorInvalidArgument,
+					failures);
+				BENCH_CHECK(generator.SetTable(0, block.data(), 0) == NativeErrorInvalidArgument, failures);
+				BENCH_CHECK(generator.SetTones(0, nullptr, MaxWaveformTones + 1) == NativeErrorInvalidArgument,
+					failures);
+				BENCH_CHECK(generator.Render(nullptr, n) == NativeErrorInvalidArgument, failures);
+
+				std::printf("  updates: amplitude/frequency change error %.1e, peak under "
+					"concurrent updates %.3f\n", worst, peak);
+				return failures;
+			}
+
+			/**
+			* Renders straight into the blocks of the output engine; the
+			* device generates exactly what a separate generator renders.
+			*/
+			int CheckEngine(uInt32 blocks) {
+
+				int failures = 0;
+				const uInt32 channels = 3;
+				const uInt32 spb = 1000;
+				SimSetClockMode(SimClockMode::FreeRun);
+
+				TaskHandle task = NULL;
+				DAQmxCreateTask("bench", &task);
+				DAQmxCreateAOVoltageChan(task, "SimDev1/ao0:2", "", -10.0, 10.0, DAQmx_Val_Volts, NULL);
+				DAQmxCfgSampClkTiming(task, "", 100000.0, DAQmx_Val_Rising, DAQmx_Val_ContSamps, 0);
+
+				AnalogOutputEngineConfig engineConfig = DefaultAnalogOutputEngineConfig();
+				engineConfig.channels = channels;
+				engineConfig.samplesPerBlock = spb;
+				engineConfig.ringBlocks = 16;
+				engineConfig.fillMode = DAQmx_Val_GroupByScanNumber;
+				engineConfig.ownsTask = true;
+
+				AnalogOutputEngineCore engine;
+				BENCH_CHECK(engine.Attach(task, engineConfig) == 0, failures);
+
+				WaveformGeneratorCore generator;
+				WaveformGeneratorCore reference;
+				generator.Configure(MakeConfig(channels, SampleFormat::Float64, DAQmx_Val_GroupByScanNumber));
+				reference.Configure(MakeConfig(channels, SampleFormat::Float64, DAQmx_Val_GroupByScanNumber));
+				SetupChannels(generator);
+				SetupChannels(reference);
+
+				for (uInt32 k = 0; k < blocks; k++) {
+
+					if (k == engineConfig.ringBlocks) {
+						BENCH_CHECK(engine.Start() == 0, failures);
+					}
+
+					void* slot = engine.WaitWriteBlock(1000);
+					BENCH_CHECK(slot != nullptr, failures);
+					if (slot == nullptr) {
+						break;
+					}
+					generator.Render(slot, spb);
+					engine.CommitWriteBlock();
+				}
+
+				const auto start = std::chrono::steady_clock::now();
+				while (engine.SamplesGenerated() < (uInt64)blocks * spb && SecondsSince(start) < 10.0) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				engine.Stop();
+
+				const std::vector<float64> record = SimGeneratedAnalog(engine.Task());
+				engine.Detach();
+
+				std::vector<float64> expected((size_t)channels * spb);
+				size_t bad = (record.size() == (size_t)blocks * spb * channels) ? 0 : 1;
+
+				for (uInt32 k = 0; k < blocks && bad == 0; k++) {
+					reference.Render(expected.data(), spb);
+					for (size_t i = 0; i < expected.size(); i++) {
+						bad += (record[(size_t)k * expected.size() + i] != expected[i]) ? 1 : 0;
+					}
+				}
+				BENCH_CHECK(bad == 0, failures);
+				BENCH_CHECK(SimLiveTaskCount() == 0, failures);
+
+				std::printf("  engine: %u blocks rendered in place, %zu differences\n", blocks, bad);
+				return failures;
+			}
+
+			/**
+			* Samples per second, all channels, of the generator and of the
+			* two-pass std::sin baseline, into `Float64` or `Int16` by scan.
+			*/
+			void MeasureThroughput(double seconds) {
+
+				const uInt32 channels = 8;
+				const uInt32 spb = 10000;
+				std::vector<float64> f64((size_t)channels * spb);
+				std::vector<int16> i16((size_t)channels * spb);
+
+				WaveformGeneratorCore volts;
+				WaveformGeneratorCore codes;
+				volts.Configure(MakeConfig(channels, SampleFormat::Float64, DAQmx_Val_GroupByScanNumber));
+				codes.Configure(MakeConfig(channels, SampleFormat::Int16, DAQmx_Val_GroupByScanNumber));
+				for (uInt32 ch = 0; ch < channels; ch++) {
+					codes.SetCodeScaling(ch, 0.0, 3276.7);
+				}
+
+				auto measure = [&](auto render) {
+					const auto start = std::chrono::steady_clock::now();
+					uInt64 rendered = 0;
+					do {
+						render();
+						rendered += (uInt64)channels * spb;
+					} while (SecondsSince(start) < seconds);
+					return rendered / SecondsSince(start) / 1e6;
+				};
+
+				// The managed way: fill a double array with Math.Sin, then
+				// convert it for the device in a second pass.
+				std::vector<float64> phases(channels, 0.0);
+				auto baseline = [&](bool toCodes) {
+					for (uInt32 i = 0; i < spb; i++) {
+						for (uInt32 ch = 0; ch < channels; ch++) {
+							f64[(size_t)i * channels + ch] = std::sin(6.283185307179586 * (phases[ch] + i * 0.01234));
+						}
+					}
+					for (uInt32 ch = 0; ch < channels; ch++) {
+						phases[ch] = WrapPhase(phases[ch] + spb * 0.01234);
+					}
+					if (toCodes) {
+						for (size_t k = 0; k < i16.size(); k++) {
+							i16[k] = (int16)std::lrint(f64[k] * 3276.7);
+						}
+					}
+				};
+
+				std::printf("  8 ch sine by scan, MS/s: std::sin F64 %.0f, std::sin + I16 pass %.0f\n",
+					measure([&]() { baseline(false); }), measure([&]() { baseline(true); }));
+
+				const SimdLevel detected = DetectedSimdLevel();
+				for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 }) {
+
+					if ((int32)level > (int32)detected) {
+						continue;
+					}
+					SetSimdLevelLimit(level);
+
+					std::printf("  %-7s generator F64 %7.0f, I16 %7.0f\n", SimdLevelName(level),
+						measure([&]() { volts.Render(f64.data(), spb); }),
+						measure([&]() { codes.Render(i16.data(), spb); }));
+				}
+				SetSimdLevelLimit(SimdLevel::Avx2);
+
+				KeepAlive(f64[spb / 2]);
+				KeepAlive(i16[spb / 2]);
+			}
+		}
+
+		int RunWaveformBench(const BenchOptions& options) {
+
+			int failures = 0;
+			const SimdLevel detected = DetectedSimdLevel();
+
+			for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 }) {
+
+				if ((int32)level > (int32)detected) {
+					continue;
+				}
+				SetSimdLevelLimit(level);
+				failures += CheckKernels();
+			}
+			SetSimdLevelLimit(SimdLevel::Avx2);
+
+			failures += CheckContinuity();
+			failures += CheckFormats();
+			failures += CheckUpdates();
+			failures += CheckEngine(options.quick ? 100 : 1000);
+
+			MeasureThroughput(options.quick ? 0.1 : 1.0);
+			return failures;
+		}
+	}
+}